@@ -0,0 +1,369 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bench.h"
+
+#define BENCH_WARMUP 100
+
+/*
+ * The allocation count is shared by all threads, so that the allocations of
+ * worker threads are counted too. A suspension only applies to the thread
+ * that requested it.
+ */
+static size_t bench_alloc_count;
+static __thread unsigned int bench_suspended;
+static __thread uint64_t bench_suspended_ns;
+static __thread uint64_t bench_suspend_start;
+
+/*
+ * Heap allocations are counted by interposing malloc, calloc, realloc,
+ * reallocarray and the aligned allocators. This relies on the glibc internal entry points so it's only available
+ * there. Everywhere else the allocation column reads 'n/a'.
+ */
+#ifdef __GLIBC__
+#define BENCH_COUNT_ALLOCS 1
+
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+extern void *__libc_memalign (size_t alignment, size_t size);
+
+void*
+malloc (size_t size)
+{
+    if (!bench_suspended) {
+        __atomic_fetch_add (&bench_alloc_count, 1, __ATOMIC_RELAXED);
+    }
+    return __libc_malloc (size);
+}
+
+void*
+calloc (size_t nmemb, size_t size)
+{
+    if (!bench_suspended) {
+        __atomic_fetch_add (&bench_alloc_count, 1, __ATOMIC_RELAXED);
+    }
+    return __libc_calloc (nmemb, size);
+}
+
+/* Growing, shrinking and moving a block may all allocate; only a call that
+   frees the block can't. */
+void*
+realloc (void *ptr, size_t size)
+{
+    if (!bench_suspended && (ptr == NULL || size != 0)) {
+        __atomic_fetch_add (&bench_alloc_count, 1, __ATOMIC_RELAXED);
+    }
+    return __libc_realloc (ptr, size);
+}
+
+void*
+reallocarray (void *ptr, size_t nmemb, size_t size)
+{
+    if (size != 0 && nmemb > SIZE_MAX / size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return realloc (ptr, nmemb * size);
+}
+
+void*
+memalign (size_t alignment, size_t size)
+{
+    if (!bench_suspended) {
+        __atomic_fetch_add (&bench_alloc_count, 1, __ATOMIC_RELAXED);
+    }
+    return __libc_memalign (alignment, size);
+}
+
+void*
+aligned_alloc (size_t alignment, size_t size)
+{
+    return memalign (alignment, size);
+}
+
+int
+posix_memalign (void **memptr, size_t alignment, size_t size)
+{
+    void *ptr;
+
+    if (alignment % sizeof (void*) != 0 ||
+        (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    ptr = memalign (alignment, size);
+    if (ptr == NULL) {
+        return ENOMEM;
+    }
+    *memptr = ptr;
+    return 0;
+}
+#endif /* __GLIBC__ */
+
+uint64_t
+bench_now_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void
+bench_suspend (void)
+{
+    if (bench_suspended++ == 0) {
+        bench_suspend_start = bench_now_ns ();
+    }
+}
+
+void
+bench_resume (void)
+{
+    if (--bench_suspended == 0) {
+        bench_suspended_ns += bench_now_ns () - bench_suspend_start;
+    }
+}
+
+static int
+bench_compare (
+    const void *a,
+    const void *b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+void
+bench_print_header (void)
+{
+    printf ("%-32s %12s %10s %10s %12s\n",
+            "benchmark", "ops/sec", "p50 us", "p99 us", "allocs/call");
+}
+
+void
+bench_print_bytes_header (void)
+{
+    printf ("%-32s %12s %10s %10s\n",
+            "benchmark", "bytes", "ns/call", "ns/byte");
+}
+
+int
+bench_run (
+    const char *name,
+    bench_fn fn,
+    void *data,
+    size_t iterations)
+{
+    uint64_t *latency, start, suspended, total = 0;
+    size_t allocs, i;
+    TSS2_RC rc;
+
+    if (iterations == 0) {
+        return -1;
+    }
+    latency = calloc (iterations, sizeof (*latency));
+    if (latency == NULL) {
+        fprintf (stderr, "%s: out of memory\n", name);
+        return -1;
+    }
+    for (i = 0; i < BENCH_WARMUP; i++) {
+        rc = fn (data);
+        if (rc != TSS2_RC_SUCCESS) {
+            goto fail;
+        }
+    }
+
+    allocs = __atomic_load_n (&bench_alloc_count, __ATOMIC_RELAXED);
+    for (i = 0; i < iterations; i++) {
+        suspended = bench_suspended_ns;
+        start = bench_now_ns ();
+        rc = fn (data);
+        latency [i] = bench_now_ns () - start -
+                      (bench_suspended_ns - suspended);
+        if (rc != TSS2_RC_SUCCESS) {
+            goto fail;
+        }
+        total += latency [i];
+    }
+    allocs = __atomic_load_n (&bench_alloc_count, __ATOMIC_RELAXED) - allocs;
+
+    qsort (latency, iterations, sizeof (*latency), bench_compare);
+    printf ("%-32s %12.0f %10.2f %10.2f ", name,
+            iterations * 1e9 / (total ? total : 1),
+            latency [iterations / 2] / 1e3,
+            latency [(iterations * 99) / 100] / 1e3);
+#ifdef BENCH_COUNT_ALLOCS
+    printf ("%12.2f\n", (double)allocs / iterations);
+#else
+    (void)allocs;
+    printf ("%12s\n", "n/a");
+#endif
+    free (latency);
+    return 0;
+
+fail:
+    fprintf (stderr, "%s: call %zu failed with 0x%" PRIx32 "\n", name, i, rc);
+    free (latency);
+    return -1;
+}
+
+int
+bench_run_bytes (
+    const char *name,
+    bench_fn fn,
+    void *data,
+    size_t iterations,
+    size_t bytes)
+{
+    uint64_t start, suspended, total;
+    size_t i;
+    TSS2_RC rc;
+
+    if (iterations == 0 || bytes == 0) {
+        return -1;
+    }
+    for (i = 0; i < BENCH_WARMUP; i++) {
+        rc = fn (data);
+        if (rc != TSS2_RC_SUCCESS) {
+            goto fail;
+        }
+    }
+
+    suspended = bench_suspended_ns;
+    start = bench_now_ns ();
+    for (i = 0; i < iterations; i++) {
+        rc = fn (data);
+        if (rc != TSS2_RC_SUCCESS) {
+            goto fail;
+        }
+    }
+    total = bench_now_ns () - start - (bench_suspended_ns - suspended);
+
+    printf ("%-32s %12zu %10.1f %10.3f\n", name, bytes,
+            (double)total / iterations,
+            (double)total / iterations / bytes);
+    return 0;
+
+fail:
+    fprintf (stderr, "%s: call %zu failed with 0x%" PRIx32 "\n", name, i, rc);
+    return -1;
+}
+
+typedef struct {
+    bench_fn fn;
+    void *data;
+    uint64_t *latency;
+    size_t iterations;
+    pthread_barrier_t *barrier;
+    TSS2_RC rc;
+} bench_thread_t;
+
+static void*
+bench_thread (void *arg)
+{
+    bench_thread_t *thread = arg;
+    uint64_t start;
+    size_t i;
+
+    for (i = 0; i < BENCH_WARMUP / 10; i++) {
+        thread->rc = thread->fn (thread->data);
+        if (thread->rc != TSS2_RC_SUCCESS) {
+            break;
+        }
+    }
+    pthread_barrier_wait (thread->barrier);
+    if (thread->rc != TSS2_RC_SUCCESS) {
+        return NULL;
+    }
+    for (i = 0; i < thread->iterations; i++) {
+        start = bench_now_ns ();
+        thread->rc = thread->fn (thread->data);
+        thread->latency [i] = bench_now_ns () - start;
+        if (thread->rc != TSS2_RC_SUCCESS) {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+int
+bench_run_threads (
+    const char *name,
+    bench_fn fn,
+    void **data,
+    size_t threads,
+    size_t iterations)
+{
+    bench_thread_t *state = NULL;
+    pthread_t *ids = NULL;
+    pthread_barrier_t barrier;
+    uint64_t *latency = NULL, start, total;
+    size_t i, count, per_thread;
+    int ret = -1;
+
+    per_thread = iterations / (threads ? threads : 1);
+    if (per_thread == 0) {
+        return -1;
+    }
+    count = per_thread * threads;
+    latency = calloc (count, sizeof (*latency));
+    state = calloc (threads, sizeof (*state));
+    ids = calloc (threads, sizeof (*ids));
+    if (latency == NULL || state == NULL || ids == NULL ||
+        pthread_barrier_init (&barrier, NULL, threads + 1) != 0) {
+        fprintf (stderr, "%s: out of memory\n", name);
+        goto out;
+    }
+
+    for (i = 0; i < threads; i++) {
+        state [i].fn = fn;
+        state [i].data = data [i];
+        state [i].latency = &latency [i * per_thread];
+        state [i].iterations = per_thread;
+        state [i].barrier = &barrier;
+        if (pthread_create (&ids [i], NULL, bench_thread, &state [i]) != 0) {
+            fprintf (stderr, "%s: can't start thread %zu\n", name, i);
+            abort ();
+        }
+    }
+    /* All threads start timing once they are warmed up. */
+    pthread_barrier_wait (&barrier);
+    start = bench_now_ns ();
+    for (i = 0; i < threads; i++) {
+        pthread_join (ids [i], NULL);
+    }
+    total = bench_now_ns () - start;
+    pthread_barrier_destroy (&barrier);
+    for (i = 0; i < threads; i++) {
+        if (state [i].rc != TSS2_RC_SUCCESS) {
+            fprintf (stderr, "%s: thread %zu failed with 0x%" PRIx32 "\n",
+                     name, i, state [i].rc);
+            goto out;
+        }
+    }
+
+    qsort (latency, count, sizeof (*latency), bench_compare);
+    printf ("%-32s %12.0f %10.2f %10.2f %12s\n", name,
+            count * 1e9 / (total ? total : 1),
+            latency [count / 2] / 1e3,
+            latency [(count * 99) / 100] / 1e3, "n/a");
+    ret = 0;
+
+out:
+    free (ids);
+    free (state);
+    free (latency);
+    return ret;
+}
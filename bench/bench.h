@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+
+#include "tss2_common.h"
+
+/* A single operation under test. 'data' is passed through from bench_run. */
+typedef TSS2_RC (*bench_fn) (void *data);
+
+/* The monotonic clock in nanoseconds. */
+uint64_t
+bench_now_ns (void);
+
+/*
+ * Time spent and allocations made between bench_suspend and bench_resume
+ * are not counted. The bench TCTI uses this to keep the cost of generating
+ * responses out of the numbers. Calls nest.
+ */
+void
+bench_suspend (void);
+void
+bench_resume (void);
+
+/*
+ * Run 'fn' 'iterations' times after a short warm-up and print a result
+ * line: operations per second, median and 99th percentile latency and
+ * heap allocations per call. Returns -1 if any call failed.
+ */
+int
+bench_run (
+    const char *name,
+    bench_fn fn,
+    void *data,
+    size_t iterations);
+
+/*
+ * Run 'fn' from 'threads' threads at once, 'iterations' times in total,
+ * with data[i] passed to the calls of thread i, and print a result line
+ * like bench_run. Operations per second are measured over the wall clock
+ * time of all threads. Allocations are not counted. Returns -1 if any call
+ * failed.
+ */
+int
+bench_run_threads (
+    const char *name,
+    bench_fn fn,
+    void **data,
+    size_t threads,
+    size_t iterations);
+
+/*
+ * Run 'fn' 'iterations' times after a short warm-up, where each call
+ * processes 'bytes' bytes of input, and print a result line: bytes per
+ * call, nanoseconds per call and nanoseconds per byte. Returns -1 if any
+ * call failed.
+ */
+int
+bench_run_bytes (
+    const char *name,
+    bench_fn fn,
+    void *data,
+    size_t iterations,
+    size_t bytes);
+
+void
+bench_print_header (void);
+void
+bench_print_bytes_header (void);
+
+#endif /* BENCH_H */
@@ -0,0 +1,923 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tss2_mu.h"
+#include "tss2_tcti.h"
+
+#include "esys_crypto.h"
+#include "esys_iutil.h"
+#include "bench.h"
+#include "tcti-bench.h"
+
+/*
+ * The bench TCTI is an in-process loopback TCTI answering the small set of
+ * commands used by the benchmarks. Responses are generated in transmit:
+ * response nonces, response parameter encryption and response HMACs are
+ * computed with the ESYS crypto backend so that ESYS accepts them. The
+ * time and the allocations spent here are not attributed to the benchmark.
+ */
+
+#define BENCH_AUTHS_MAX 3
+#define BENCH_NV_SIZE 4096
+#define BENCH_NV_BUFFER_MAX 512
+#define BENCH_SEALED_SIZE 32
+#define BENCH_INPUT_BUFFER 1024
+
+typedef struct {
+    tpm_header_t header;
+    UINT32 handles [2];
+    size_t handle_count;
+    TPMS_AUTH_COMMAND auths [BENCH_AUTHS_MAX];
+    size_t auth_count;
+    const uint8_t *params;
+    size_t params_size;
+} bench_command_t;
+
+/*
+ * Response handlers marshal the response handle (if any) and parameters
+ * into 'buf' at 'offset' and return the TPM response code. Commands
+ * returning a handle are never sent with sessions, so the handle and
+ * parameters can be written in one go.
+ */
+typedef TPM2_RC (*bench_handler_fn) (
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench,
+    const bench_command_t *cmd,
+    uint8_t *buf,
+    size_t size,
+    size_t *offset);
+
+#define bench_return_if_error(rc, tpm_rc) \
+    do { \
+        if (rc != TSS2_RC_SUCCESS) { \
+            return tpm_rc; \
+        } \
+    } while (0)
+
+static void
+bench_pattern (
+    uint8_t *buf,
+    size_t size,
+    UINT32 seed)
+{
+    for (size_t i = 0; i < size; i++) {
+        buf [i] = (uint8_t)(seed + i);
+    }
+}
+
+static void
+bench_nv_public (TPM2B_NV_PUBLIC *nv_public)
+{
+    memset (nv_public, 0, sizeof (*nv_public));
+    nv_public->nvPublic.nvIndex = TCTI_BENCH_NV_INDEX;
+    nv_public->nvPublic.nameAlg = TPM2_ALG_SHA256;
+    nv_public->nvPublic.attributes = TPMA_NV_AUTHREAD | TPMA_NV_AUTHWRITE |
+                                     TPMA_NV_WRITTEN;
+    nv_public->nvPublic.dataSize = BENCH_NV_SIZE;
+}
+
+static void
+bench_sealed_public (TPM2B_PUBLIC *public)
+{
+    memset (public, 0, sizeof (*public));
+    public->publicArea.type = TPM2_ALG_KEYEDHASH;
+    public->publicArea.nameAlg = TPM2_ALG_SHA256;
+    public->publicArea.objectAttributes = TPMA_OBJECT_USERWITHAUTH |
+                                          TPMA_OBJECT_FIXEDTPM |
+                                          TPMA_OBJECT_FIXEDPARENT;
+    public->publicArea.parameters.keyedHashDetail.scheme.scheme =
+        TPM2_ALG_NULL;
+    public->publicArea.unique.keyedHash.size = 32;
+    bench_pattern (public->publicArea.unique.keyedHash.buffer, 32, 0x5e);
+}
+
+static tcti_bench_session_t*
+bench_session_find (
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench,
+    TPM2_HANDLE handle)
+{
+    for (size_t i = 0; i < TCTI_BENCH_SESSIONS_MAX; i++) {
+        if (tcti_bench->sessions [i].handle == handle) {
+            return &tcti_bench->sessions [i];
+        }
+    }
+    return NULL;
+}
+
+static TPM2_RC
+bench_get_random (
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench,
+    const bench_command_t *cmd,
+    uint8_t *buf,
+    size_t size,
+    size_t *offset)
+{
+    TPM2B_DIGEST random = { 0 };
+    size_t param_offset = 0;
+    UINT16 requested;
+    TSS2_RC rc;
+
+    rc = Tss2_MU_UINT16_Unmarshal (cmd->params, cmd->params_size,
+                                   &param_offset, &requested);
+    bench_return_if_error (rc, TPM2_RC_COMMAND_SIZE);
+    random.size = requested > sizeof (random.buffer) ?
+                  sizeof (random.buffer) : requested;
+    bench_pattern (random.buffer, random.size, tcti_bench->nonce_counter++);
+    rc = Tss2_MU_TPM2B_DIGEST_Marshal (&random, buf, size, offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    return TPM2_RC_SUCCESS;
+}
+
+static TPM2_RC
+bench_pcr_read (
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench,
+    const bench_command_t *cmd,
+    uint8_t *buf,
+    size_t size,
+    size_t *offset)
+{
+    TPML_PCR_SELECTION selection;
+    TPML_DIGEST values = { 0 };
+    size_t param_offset = 0, digest_size;
+    TSS2_RC rc;
+
+    rc = Tss2_MU_TPML_PCR_SELECTION_Unmarshal (cmd->params, cmd->params_size,
+                                               &param_offset, &selection);
+    bench_return_if_error (rc, TPM2_RC_COMMAND_SIZE);
+    /* Return a digest per selected PCR, up to the capacity of TPML_DIGEST,
+       and deselect the PCRs that didn't fit. */
+    for (UINT32 i = 0; i < selection.count; i++) {
+        TPMS_PCR_SELECTION *sel = &selection.pcrSelections [i];
+        if (iesys_crypto_hash_get_digest_size (sel->hash, &digest_size) !=
+            TSS2_RC_SUCCESS) {
+            return TPM2_RC_HASH | TPM2_RC_P | TPM2_RC_1;
+        }
+        for (size_t bit = 0; bit < sel->sizeofSelect * 8u; bit++) {
+            if (!(sel->pcrSelect [bit / 8] & (1 << (bit % 8)))) {
+                continue;
+            }
+            if (values.count == sizeof (values.digests) /
+                                sizeof (values.digests [0])) {
+                sel->pcrSelect [bit / 8] &= ~(1 << (bit % 8));
+                continue;
+            }
+            values.digests [values.count].size = digest_size;
+            bench_pattern (values.digests [values.count].buffer, digest_size,
+                           bit);
+            values.count++;
+        }
+    }
+    rc = Tss2_MU_UINT32_Marshal (tcti_bench->nonce_counter++, buf, size,
+                                 offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    rc = Tss2_MU_TPML_PCR_SELECTION_Marshal (&selection, buf, size, offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    rc = Tss2_MU_TPML_DIGEST_Marshal (&values, buf, size, offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    return TPM2_RC_SUCCESS;
+}
+
+/*
+ * Only unbound and unsalted sessions are supported: their session key is
+ * empty, so the HMAC and encryption keys are derived from the authValue
+ * alone.
+ */
+static TPM2_RC
+bench_start_auth_session (
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench,
+    const bench_command_t *cmd,
+    uint8_t *buf,
+    size_t size,
+    size_t *offset)
+{
+    tcti_bench_session_t *session;
+    TPM2B_NONCE nonce_caller, nonce_tpm;
+    TPM2B_ENCRYPTED_SECRET salt;
+    TPM2_SE session_type;
+    TPMT_SYM_DEF symmetric;
+    TPMI_ALG_HASH auth_hash;
+    size_t param_offset = 0;
+    TSS2_RC rc;
+
+    if (cmd->handles [0] != TPM2_RH_NULL) {
+        return TPM2_RC_HANDLE | TPM2_RC_1;
+    }
+    if (cmd->handles [1] != TPM2_RH_NULL) {
+        return TPM2_RC_HANDLE | TPM2_RC_2;
+    }
+    rc = Tss2_MU_TPM2B_NONCE_Unmarshal (cmd->params, cmd->params_size,
+                                        &param_offset, &nonce_caller);
+    bench_return_if_error (rc, TPM2_RC_COMMAND_SIZE);
+    rc = Tss2_MU_TPM2B_ENCRYPTED_SECRET_Unmarshal (cmd->params,
+                                                   cmd->params_size,
+                                                   &param_offset, &salt);
+    bench_return_if_error (rc, TPM2_RC_COMMAND_SIZE);
+    rc = Tss2_MU_TPM2_SE_Unmarshal (cmd->params, cmd->params_size,
+                                    &param_offset, &session_type);
+    bench_return_if_error (rc, TPM2_RC_COMMAND_SIZE);
+    rc = Tss2_MU_TPMT_SYM_DEF_Unmarshal (cmd->params, cmd->params_size,
+                                         &param_offset, &symmetric);
+    bench_return_if_error (rc, TPM2_RC_COMMAND_SIZE);
+    rc = Tss2_MU_UINT16_Unmarshal (cmd->params, cmd->params_size,
+                                   &param_offset, &auth_hash);
+    bench_return_if_error (rc, TPM2_RC_COMMAND_SIZE);
+    if (salt.size != 0) {
+        return TPM2_RC_VALUE | TPM2_RC_P | TPM2_RC_2;
+    }
+
+    session = bench_session_find (tcti_bench, 0);
+    if (session == NULL) {
+        return TPM2_RC_SESSION_HANDLES;
+    }
+    session->handle = (session_type == TPM2_SE_HMAC ?
+                       TPM2_HMAC_SESSION_FIRST : TPM2_POLICY_SESSION_FIRST) +
+                      (session - tcti_bench->sessions);
+    session->auth_hash = auth_hash;
+    session->symmetric = symmetric;
+
+    nonce_tpm.size = nonce_caller.size;
+    bench_pattern (nonce_tpm.buffer, nonce_tpm.size,
+                   tcti_bench->nonce_counter++);
+    rc = Tss2_MU_TPM2_HANDLE_Marshal (session->handle, buf, size, offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    rc = Tss2_MU_TPM2B_NONCE_Marshal (&nonce_tpm, buf, size, offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    return TPM2_RC_SUCCESS;
+}
+
+static TPM2_RC
+bench_flush_context (
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench,
+    const bench_command_t *cmd,
+    uint8_t *buf,
+    size_t size,
+    size_t *offset)
+{
+    tcti_bench_session_t *session;
+    size_t param_offset = 0;
+    TPM2_HANDLE handle;
+    TSS2_RC rc;
+
+    rc = Tss2_MU_TPM2_HANDLE_Unmarshal (cmd->params, cmd->params_size,
+                                        &param_offset, &handle);
+    bench_return_if_error (rc, TPM2_RC_COMMAND_SIZE);
+    session = bench_session_find (tcti_bench, handle);
+    if (session != NULL) {
+        memset (session, 0, sizeof (*session));
+    }
+    return TPM2_RC_SUCCESS;
+}
+
+static TPM2_RC
+bench_get_capability (
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench,
+    const bench_command_t *cmd,
+    uint8_t *buf,
+    size_t size,
+    size_t *offset)
+{
+    TPMS_CAPABILITY_DATA data = { .capability = TPM2_CAP_TPM_PROPERTIES };
+    TPML_TAGGED_TPM_PROPERTY *props = &data.data.tpmProperties;
+    size_t param_offset = 0;
+    UINT32 capability, property, count;
+    TSS2_RC rc;
+
+    rc = Tss2_MU_UINT32_Unmarshal (cmd->params, cmd->params_size,
+                                     &param_offset, &capability);
+    bench_return_if_error (rc, TPM2_RC_COMMAND_SIZE);
+    rc = Tss2_MU_UINT32_Unmarshal (cmd->params, cmd->params_size,
+                                   &param_offset, &property);
+    bench_return_if_error (rc, TPM2_RC_COMMAND_SIZE);
+    rc = Tss2_MU_UINT32_Unmarshal (cmd->params, cmd->params_size,
+                                   &param_offset, &count);
+    bench_return_if_error (rc, TPM2_RC_COMMAND_SIZE);
+    if (capability != TPM2_CAP_TPM_PROPERTIES) {
+        return TPM2_RC_VALUE | TPM2_RC_P | TPM2_RC_1;
+    }
+    /* Only the properties the TSS itself asks for */
+    if (count > 0 && property <= TPM2_PT_INPUT_BUFFER) {
+        props->tpmProperty [0].property = TPM2_PT_INPUT_BUFFER;
+        props->tpmProperty [0].value = BENCH_INPUT_BUFFER;
+        props->count = 1;
+    } else if (count > 0 && property <= TPM2_PT_NV_BUFFER_MAX) {
+        props->tpmProperty [0].property = TPM2_PT_NV_BUFFER_MAX;
+        props->tpmProperty [0].value = BENCH_NV_BUFFER_MAX;
+        props->count = 1;
+    }
+    rc = Tss2_MU_BYTE_Marshal (TPM2_NO, buf, size, offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    rc = Tss2_MU_TPMS_CAPABILITY_DATA_Marshal (&data, buf, size, offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    return TPM2_RC_SUCCESS;
+}
+
+static TPM2_RC
+bench_nv_read_public (
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench,
+    const bench_command_t *cmd,
+    uint8_t *buf,
+    size_t size,
+    size_t *offset)
+{
+    TPM2B_NV_PUBLIC nv_public;
+    TPM2B_NAME name;
+    TSS2_RC rc;
+
+    if (cmd->handles [0] != TCTI_BENCH_NV_INDEX) {
+        return TPM2_RC_HANDLE | TPM2_RC_1;
+    }
+    bench_nv_public (&nv_public);
+    rc = iesys_nv_get_name (&nv_public, &name);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    rc = Tss2_MU_TPM2B_NV_PUBLIC_Marshal (&nv_public, buf, size, offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    rc = Tss2_MU_TPM2B_NAME_Marshal (&name, buf, size, offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    return TPM2_RC_SUCCESS;
+}
+
+static TPM2_RC
+bench_read_public (
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench,
+    const bench_command_t *cmd,
+    uint8_t *buf,
+    size_t size,
+    size_t *offset)
+{
+    TPM2B_PUBLIC public;
+    TPM2B_NAME name;
+    TSS2_RC rc;
+
+    if (cmd->handles [0] != TCTI_BENCH_SEALED_OBJECT) {
+        return TPM2_RC_HANDLE | TPM2_RC_1;
+    }
+    bench_sealed_public (&public);
+    rc = iesys_get_name (&public, &name);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    rc = Tss2_MU_TPM2B_PUBLIC_Marshal (&public, buf, size, offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    rc = Tss2_MU_TPM2B_NAME_Marshal (&name, buf, size, offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    /* The qualified name isn't checked by anyone, the name will do. */
+    rc = Tss2_MU_TPM2B_NAME_Marshal (&name, buf, size, offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    return TPM2_RC_SUCCESS;
+}
+
+static TPM2_RC
+bench_nv_read (
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench,
+    const bench_command_t *cmd,
+    uint8_t *buf,
+    size_t size,
+    size_t *offset)
+{
+    TPM2B_MAX_NV_BUFFER data;
+    size_t param_offset = 0;
+    UINT16 read_size, read_offset;
+    TSS2_RC rc;
+
+    if (cmd->handles [1] != TCTI_BENCH_NV_INDEX) {
+        return TPM2_RC_HANDLE | TPM2_RC_2;
+    }
+    rc = Tss2_MU_UINT16_Unmarshal (cmd->params, cmd->params_size,
+                                   &param_offset, &read_size);
+    bench_return_if_error (rc, TPM2_RC_COMMAND_SIZE);
+    rc = Tss2_MU_UINT16_Unmarshal (cmd->params, cmd->params_size,
+                                   &param_offset, &read_offset);
+    bench_return_if_error (rc, TPM2_RC_COMMAND_SIZE);
+    if (read_size > BENCH_NV_BUFFER_MAX ||
+        (size_t)read_size + read_offset > BENCH_NV_SIZE) {
+        return TPM2_RC_NV_RANGE;
+    }
+    data.size = read_size;
+    bench_pattern (data.buffer, data.size, read_offset);
+    rc = Tss2_MU_TPM2B_MAX_NV_BUFFER_Marshal (&data, buf, size, offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    return TPM2_RC_SUCCESS;
+}
+
+static TPM2_RC
+bench_unseal (
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench,
+    const bench_command_t *cmd,
+    uint8_t *buf,
+    size_t size,
+    size_t *offset)
+{
+    TPM2B_SENSITIVE_DATA data;
+    TSS2_RC rc;
+
+    if (cmd->handles [0] != TCTI_BENCH_SEALED_OBJECT) {
+        return TPM2_RC_HANDLE | TPM2_RC_1;
+    }
+    data.size = BENCH_SEALED_SIZE;
+    bench_pattern (data.buffer, data.size, 0x5e);
+    rc = Tss2_MU_TPM2B_SENSITIVE_DATA_Marshal (&data, buf, size, offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    return TPM2_RC_SUCCESS;
+}
+
+static TPM2_RC
+bench_hash_sequence_start (
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench,
+    const bench_command_t *cmd,
+    uint8_t *buf,
+    size_t size,
+    size_t *offset)
+{
+    TSS2_RC rc;
+
+    rc = Tss2_MU_TPM2_HANDLE_Marshal (TCTI_BENCH_SEQUENCE, buf, size, offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    return TPM2_RC_SUCCESS;
+}
+
+static TPM2_RC
+bench_sequence_update (
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench,
+    const bench_command_t *cmd,
+    uint8_t *buf,
+    size_t size,
+    size_t *offset)
+{
+    if (cmd->handles [0] != TCTI_BENCH_SEQUENCE) {
+        return TPM2_RC_HANDLE | TPM2_RC_1;
+    }
+    return TPM2_RC_SUCCESS;
+}
+
+static TPM2_RC
+bench_sequence_complete (
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench,
+    const bench_command_t *cmd,
+    uint8_t *buf,
+    size_t size,
+    size_t *offset)
+{
+    TPM2B_DIGEST result = { .size = TPM2_SHA256_DIGEST_SIZE };
+    TPMT_TK_HASHCHECK validation = {
+        .tag = TPM2_ST_HASHCHECK,
+        .hierarchy = TPM2_RH_NULL,
+    };
+    TSS2_RC rc;
+
+    if (cmd->handles [0] != TCTI_BENCH_SEQUENCE) {
+        return TPM2_RC_HANDLE | TPM2_RC_1;
+    }
+    bench_pattern (result.buffer, result.size, 0x5a);
+    rc = Tss2_MU_TPM2B_DIGEST_Marshal (&result, buf, size, offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    rc = Tss2_MU_TPMT_TK_HASHCHECK_Marshal (&validation, buf, size, offset);
+    bench_return_if_error (rc, TPM2_RC_FAILURE);
+    return TPM2_RC_SUCCESS;
+}
+
+static const struct {
+    TPM2_CC code;
+    size_t handle_count;
+    bench_handler_fn handler;
+} bench_commands [] = {
+    { TPM2_CC_GetRandom, 0, bench_get_random },
+    { TPM2_CC_PCR_Read, 0, bench_pcr_read },
+    { TPM2_CC_StartAuthSession, 2, bench_start_auth_session },
+    { TPM2_CC_FlushContext, 0, bench_flush_context },
+    { TPM2_CC_GetCapability, 0, bench_get_capability },
+    { TPM2_CC_NV_ReadPublic, 1, bench_nv_read_public },
+    { TPM2_CC_ReadPublic, 1, bench_read_public },
+    { TPM2_CC_NV_Read, 2, bench_nv_read },
+    { TPM2_CC_Unseal, 1, bench_unseal },
+    { TPM2_CC_HashSequenceStart, 0, bench_hash_sequence_start },
+    { TPM2_CC_SequenceUpdate, 1, bench_sequence_update },
+    { TPM2_CC_SequenceComplete, 1, bench_sequence_complete },
+};
+
+/*
+ * Split a command into its header, handles, authorization area and
+ * parameters. Returns a TPM response code.
+ */
+static TPM2_RC
+bench_parse_command (
+    const uint8_t *command_buffer,
+    size_t command_size,
+    size_t handle_count,
+    bench_command_t *cmd)
+{
+    size_t offset = TPM_HEADER_SIZE, auth_end;
+    UINT32 auth_size;
+    TSS2_RC rc;
+
+    cmd->handle_count = handle_count;
+    for (size_t i = 0; i < handle_count; i++) {
+        rc = Tss2_MU_UINT32_Unmarshal (command_buffer, command_size, &offset,
+                                       &cmd->handles [i]);
+        bench_return_if_error (rc, TPM2_RC_COMMAND_SIZE);
+    }
+    cmd->auth_count = 0;
+    if (cmd->header.tag == TPM2_ST_SESSIONS) {
+        rc = Tss2_MU_UINT32_Unmarshal (command_buffer, command_size, &offset,
+                                       &auth_size);
+        bench_return_if_error (rc, TPM2_RC_COMMAND_SIZE);
+        if (auth_size > command_size - offset) {
+            return TPM2_RC_AUTHSIZE;
+        }
+        auth_end = offset + auth_size;
+        while (offset < auth_end) {
+            if (cmd->auth_count == BENCH_AUTHS_MAX) {
+                return TPM2_RC_AUTHSIZE;
+            }
+            rc = Tss2_MU_TPMS_AUTH_COMMAND_Unmarshal (
+                     command_buffer, auth_end, &offset,
+                     &cmd->auths [cmd->auth_count++]);
+            bench_return_if_error (rc, TPM2_RC_AUTHSIZE);
+        }
+    }
+    cmd->params = &command_buffer [offset];
+    cmd->params_size = command_size - offset;
+    return TPM2_RC_SUCCESS;
+}
+
+/*
+ * Encrypt the first response parameter for the first session with the
+ * encrypt attribute set, the way a TPM does it for AES in CFB mode.
+ */
+static TSS2_RC
+bench_encrypt_response (
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench,
+    const tcti_bench_session_t *session,
+    const TPM2B_NONCE *nonce_tpm,
+    const TPM2B_NONCE *nonce_caller,
+    uint8_t *params,
+    size_t params_size)
+{
+    const TPMT_SYM_DEF *sym = &session->symmetric;
+    uint8_t key [TPM2_MAX_SYM_KEY_BYTES + TPM2_MAX_SYM_BLOCK_SIZE +
+                 sizeof (TPMU_HA)];
+    size_t offset = 0, key_size = (sym->keyBits.aes + 7) / 8;
+    UINT16 data_size;
+    TSS2_RC rc;
+
+    if (sym->algorithm != TPM2_ALG_AES || sym->mode.aes != TPM2_ALG_CFB) {
+        return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+    }
+    rc = Tss2_MU_UINT16_Unmarshal (params, params_size, &offset, &data_size);
+    if (rc != TSS2_RC_SUCCESS || data_size > params_size - offset) {
+        return TSS2_TCTI_RC_GENERAL_FAILURE;
+    }
+    rc = iesys_crypto_KDFa (NULL, session->auth_hash,
+                            tcti_bench->auth.buffer, tcti_bench->auth.size,
+                            "CFB", (TPM2B_NONCE*)nonce_tpm,
+                            (TPM2B_NONCE*)nonce_caller,
+                            sym->keyBits.aes + AES_BLOCK_SIZE_IN_BYTES * 8,
+                            NULL, key, false);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    return iesys_crypto_sym_aes_encrypt (NULL, key, sym->algorithm,
+                                         sym->keyBits.aes, sym->mode.aes,
+                                         AES_BLOCK_SIZE_IN_BYTES,
+                                         &params [offset], data_size,
+                                         &key [key_size]);
+}
+
+/*
+ * Append the response authorization area. For HMAC and policy sessions a
+ * new nonceTPM is generated, the response parameters are encrypted when
+ * requested and the response HMAC is computed over the result.
+ */
+static TSS2_RC
+bench_auth_response (
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench,
+    const bench_command_t *cmd,
+    uint8_t *buf,
+    size_t size,
+    size_t params_start,
+    size_t *offset)
+{
+    TPMS_AUTH_RESPONSE auths [BENCH_AUTHS_MAX] = { 0 };
+    tcti_bench_session_t *sessions [BENCH_AUTHS_MAX] = { NULL };
+    uint8_t rc_buf [4] = { 0 }, cc_buf [4] = { 0 };
+    uint8_t rp_hash [sizeof (TPMU_HA)];
+    size_t rp_hash_size, params_size = *offset - params_start;
+    bool encrypted = false;
+    TSS2_RC rc;
+
+    for (size_t i = 0; i < cmd->auth_count; i++) {
+        auths [i].sessionAttributes = cmd->auths [i].sessionAttributes &
+                                      TPMA_SESSION_CONTINUESESSION;
+        if (cmd->auths [i].sessionHandle == TPM2_RS_PW) {
+            continue;
+        }
+        sessions [i] = bench_session_find (tcti_bench,
+                                           cmd->auths [i].sessionHandle);
+        if (sessions [i] == NULL) {
+            return TSS2_TCTI_RC_BAD_VALUE;
+        }
+        auths [i].sessionAttributes = cmd->auths [i].sessionAttributes;
+        auths [i].nonce.size = cmd->auths [i].nonce.size;
+        bench_pattern (auths [i].nonce.buffer, auths [i].nonce.size,
+                       tcti_bench->nonce_counter++);
+        if (!encrypted &&
+            (cmd->auths [i].sessionAttributes & TPMA_SESSION_ENCRYPT)) {
+            rc = bench_encrypt_response (tcti_bench, sessions [i],
+                                         &auths [i].nonce,
+                                         &cmd->auths [i].nonce,
+                                         &buf [params_start], params_size);
+            if (rc != TSS2_RC_SUCCESS) {
+                return rc;
+            }
+            encrypted = true;
+        }
+    }
+
+    Tss2_MU_TPM2_CC_Marshal (cmd->header.code, cc_buf, sizeof (cc_buf), NULL);
+    for (size_t i = 0; i < cmd->auth_count; i++) {
+        if (sessions [i] != NULL) {
+            rp_hash_size = sizeof (rp_hash);
+            rc = iesys_crypto_rpHash (NULL, sessions [i]->auth_hash, rc_buf,
+                                      cc_buf, &buf [params_start],
+                                      params_size, rp_hash, &rp_hash_size);
+            if (rc != TSS2_RC_SUCCESS) {
+                return rc;
+            }
+            auths [i].hmac.size = sizeof (auths [i].hmac.buffer);
+            rc = iesys_crypto_authHmac (NULL, sessions [i]->auth_hash,
+                                        tcti_bench->auth.buffer,
+                                        tcti_bench->auth.size,
+                                        rp_hash, rp_hash_size,
+                                        &auths [i].nonce,
+                                        &cmd->auths [i].nonce, NULL, NULL,
+                                        auths [i].sessionAttributes,
+                                        &auths [i].hmac);
+            if (rc != TSS2_RC_SUCCESS) {
+                return rc;
+            }
+        }
+        rc = Tss2_MU_TPMS_AUTH_RESPONSE_Marshal (&auths [i], buf, size,
+                                                 offset);
+        if (rc != TSS2_RC_SUCCESS) {
+            return rc;
+        }
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+bench_respond (
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench,
+    const uint8_t *command_buffer,
+    size_t command_size)
+{
+    tpm_header_t response = { .tag = TPM2_ST_NO_SESSIONS };
+    bench_command_t cmd;
+    uint8_t *buf = tcti_bench->response;
+    size_t size = sizeof (tcti_bench->response);
+    size_t offset = TPM_HEADER_SIZE, size_offset, params_start, i;
+    TSS2_RC rc;
+
+    rc = header_unmarshal (command_buffer, &cmd.header);
+    if (rc != TSS2_RC_SUCCESS || cmd.header.size != command_size) {
+        response.code = TPM2_RC_COMMAND_SIZE;
+        goto out;
+    }
+    for (i = 0; i < sizeof (bench_commands) / sizeof (bench_commands [0]);
+         i++) {
+        if (bench_commands [i].code == cmd.header.code) {
+            break;
+        }
+    }
+    if (i == sizeof (bench_commands) / sizeof (bench_commands [0])) {
+        response.code = TPM2_RC_COMMAND_CODE;
+        goto out;
+    }
+    response.code = bench_parse_command (command_buffer, command_size,
+                                         bench_commands [i].handle_count,
+                                         &cmd);
+    if (response.code != TPM2_RC_SUCCESS) {
+        goto out;
+    }
+
+    if (cmd.header.tag == TPM2_ST_SESSIONS) {
+        offset += sizeof (UINT32);
+    }
+    params_start = offset;
+    response.code = bench_commands [i].handler (tcti_bench, &cmd, buf, size,
+                                                &offset);
+    if (response.code != TPM2_RC_SUCCESS) {
+        offset = TPM_HEADER_SIZE;
+        goto out;
+    }
+    if (cmd.header.tag == TPM2_ST_SESSIONS) {
+        response.tag = TPM2_ST_SESSIONS;
+        size_offset = TPM_HEADER_SIZE;
+        rc = Tss2_MU_UINT32_Marshal (offset - params_start, buf, size,
+                                     &size_offset);
+        if (rc != TSS2_RC_SUCCESS) {
+            return rc;
+        }
+        rc = bench_auth_response (tcti_bench, &cmd, buf, size, params_start,
+                                  &offset);
+        if (rc != TSS2_RC_SUCCESS) {
+            return rc;
+        }
+    }
+
+out:
+    response.size = offset;
+    tcti_bench->response_size = offset;
+    return header_marshal (&response, buf);
+}
+
+TSS2_RC
+tcti_bench_transmit (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t command_size,
+    const uint8_t *command_buffer)
+{
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench = (TSS2_TCTI_BENCH_CONTEXT*)tctiContext;
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common = &tcti_bench->common;
+    TSS2_RC rc;
+
+    if (tctiContext == NULL ||
+        TSS2_TCTI_MAGIC (tctiContext) != TCTI_BENCH_MAGIC) {
+        return TSS2_TCTI_RC_BAD_CONTEXT;
+    }
+    rc = tcti_common_transmit_checks (tcti_common, command_buffer);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    if (command_size < TPM_HEADER_SIZE) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
+    if (tcti_bench->replay) {
+        tcti_bench->replay = 0;
+        tcti_common->state = TCTI_STATE_RECEIVE;
+        return TSS2_RC_SUCCESS;
+    }
+    bench_suspend ();
+    rc = bench_respond (tcti_bench, command_buffer, command_size);
+    bench_resume ();
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    tcti_bench->ready_ns = bench_now_ns () + tcti_bench->latency_ns;
+    tcti_common->state = TCTI_STATE_RECEIVE;
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC
+tcti_bench_receive (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t *response_size,
+    uint8_t *response_buffer,
+    int32_t timeout)
+{
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench = (TSS2_TCTI_BENCH_CONTEXT*)tctiContext;
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common = &tcti_bench->common;
+    TSS2_RC rc;
+
+    if (tctiContext == NULL ||
+        TSS2_TCTI_MAGIC (tctiContext) != TCTI_BENCH_MAGIC) {
+        return TSS2_TCTI_RC_BAD_CONTEXT;
+    }
+    rc = tcti_common_receive_checks (tcti_common, response_size);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    if (response_buffer == NULL) {
+        *response_size = tcti_bench->response_size;
+        return TSS2_RC_SUCCESS;
+    }
+    if (*response_size < tcti_bench->response_size) {
+        *response_size = tcti_bench->response_size;
+        return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+    }
+    /* The simulated TPM is busy; the wait is part of the measured time */
+    if (timeout == TSS2_TCTI_TIMEOUT_NONE &&
+        bench_now_ns () < tcti_bench->ready_ns) {
+        return TSS2_TCTI_RC_TRY_AGAIN;
+    }
+    while (bench_now_ns () < tcti_bench->ready_ns);
+    memcpy (response_buffer, tcti_bench->response, tcti_bench->response_size);
+    *response_size = tcti_bench->response_size;
+    tcti_common->state = TCTI_STATE_TRANSMIT;
+    return TSS2_RC_SUCCESS;
+}
+
+void
+tcti_bench_finalize (
+    TSS2_TCTI_CONTEXT *tctiContext)
+{
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench = (TSS2_TCTI_BENCH_CONTEXT*)tctiContext;
+
+    if (tctiContext == NULL ||
+        TSS2_TCTI_MAGIC (tctiContext) != TCTI_BENCH_MAGIC) {
+        return;
+    }
+    tcti_bench->common.state = TCTI_STATE_FINAL;
+}
+
+TSS2_RC
+tcti_bench_cancel (
+    TSS2_TCTI_CONTEXT *tctiContext)
+{
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+}
+
+TSS2_RC
+tcti_bench_get_poll_handles (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    TSS2_TCTI_POLL_HANDLE *handles,
+    size_t *num_handles)
+{
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+}
+
+TSS2_RC
+tcti_bench_set_locality (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    uint8_t locality)
+{
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+}
+
+TSS2_RC
+tcti_bench_replay (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    const uint8_t *response,
+    size_t size)
+{
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench = (TSS2_TCTI_BENCH_CONTEXT*)tctiContext;
+
+    if (tctiContext == NULL ||
+        TSS2_TCTI_MAGIC (tctiContext) != TCTI_BENCH_MAGIC) {
+        return TSS2_TCTI_RC_BAD_CONTEXT;
+    }
+    if (size > sizeof (tcti_bench->response)) {
+        return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+    }
+    memcpy (tcti_bench->response, response, size);
+    tcti_bench->response_size = size;
+    tcti_bench->replay = 1;
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC
+tcti_bench_set_latency (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    uint64_t latency_ns)
+{
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench = (TSS2_TCTI_BENCH_CONTEXT*)tctiContext;
+
+    if (tctiContext == NULL ||
+        TSS2_TCTI_MAGIC (tctiContext) != TCTI_BENCH_MAGIC) {
+        return TSS2_TCTI_RC_BAD_CONTEXT;
+    }
+    tcti_bench->latency_ns = latency_ns;
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC
+tcti_bench_init (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t *size,
+    const TPM2B_AUTH *auth)
+{
+    TSS2_TCTI_BENCH_CONTEXT *tcti_bench;
+
+    if (tctiContext == NULL && size == NULL) {
+        return TSS2_TCTI_RC_BAD_VALUE;
+    }
+    if (tctiContext == NULL) {
+        *size = sizeof (TSS2_TCTI_BENCH_CONTEXT);
+        return TSS2_RC_SUCCESS;
+    }
+    if (*size < sizeof (TSS2_TCTI_BENCH_CONTEXT)) {
+        return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+    }
+
+    tcti_bench = (TSS2_TCTI_BENCH_CONTEXT*)tctiContext;
+    memset (tcti_bench, 0, sizeof (*tcti_bench));
+    TSS2_TCTI_MAGIC (tctiContext) = TCTI_BENCH_MAGIC;
+    TSS2_TCTI_VERSION (tctiContext) = TCTI_VERSION;
+    TSS2_TCTI_TRANSMIT (tctiContext) = tcti_bench_transmit;
+    TSS2_TCTI_RECEIVE (tctiContext) = tcti_bench_receive;
+    TSS2_TCTI_FINALIZE (tctiContext) = tcti_bench_finalize;
+    TSS2_TCTI_CANCEL (tctiContext) = tcti_bench_cancel;
+    TSS2_TCTI_GET_POLL_HANDLES (tctiContext) = tcti_bench_get_poll_handles;
+    TSS2_TCTI_SET_LOCALITY (tctiContext) = tcti_bench_set_locality;
+    TSS2_TCTI_MAKE_STICKY (tctiContext) = tcti_make_sticky_not_implemented;
+    tcti_bench->common.state = TCTI_STATE_TRANSMIT;
+    if (auth != NULL) {
+        tcti_bench->auth = *auth;
+    }
+
+    return TSS2_RC_SUCCESS;
+}
@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+#ifndef TCTI_BENCH_H
+#define TCTI_BENCH_H
+
+#include "tss2_tcti.h"
+#include "tss2_tpm2_types.h"
+
+#include "tss2-tcti/tcti-common.h"
+
+#define TCTI_BENCH_MAGIC 0x62656e6368746374ULL
+#define TCTI_BENCH_SESSIONS_MAX 8
+
+/* Handles of the TPM resources the bench TCTI knows about */
+#define TCTI_BENCH_NV_INDEX      0x01800001
+#define TCTI_BENCH_SEALED_OBJECT 0x80000001
+#define TCTI_BENCH_SEQUENCE      0x80000002
+
+/*
+ * The bench TCTI keeps the parameters of each session started through it,
+ * enough to compute the response HMAC and the response parameter
+ * encryption for unbound and unsalted sessions.
+ */
+typedef struct {
+    TPMI_SH_AUTH_SESSION handle;
+    TPMI_ALG_HASH auth_hash;
+    TPMT_SYM_DEF symmetric;
+} tcti_bench_session_t;
+
+/*
+ * This is the bench TCTI context. It is an in-process loopback that answers
+ * each command with a canned response generated in transmit and handed out
+ * by receive. The 'auth' member is the authValue of all entities. If
+ * 'replay' is set, the next command is answered with the response already
+ * in 'response' instead. Receive does not hand out a response before
+ * 'latency_ns' have passed since its command was transmitted, at
+ * 'ready_ns'.
+ */
+typedef struct {
+    TSS2_TCTI_COMMON_CONTEXT common;
+    TPM2B_AUTH auth;
+    tcti_bench_session_t sessions [TCTI_BENCH_SESSIONS_MAX];
+    UINT32 nonce_counter;
+    int replay;
+    uint64_t latency_ns;
+    uint64_t ready_ns;
+    size_t response_size;
+    uint8_t response [TPM2_MAX_COMMAND_SIZE];
+} TSS2_TCTI_BENCH_CONTEXT;
+
+TSS2_RC
+tcti_bench_init (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    size_t *size,
+    const TPM2B_AUTH *auth);
+
+/*
+ * Answer the next command with the recorded response 'response' of 'size'
+ * bytes.
+ */
+TSS2_RC
+tcti_bench_replay (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    const uint8_t *response,
+    size_t size);
+
+/*
+ * Make every following command take 'latency_ns' nanoseconds of wall time
+ * on the simulated TPM, 0 to answer immediately.
+ */
+TSS2_RC
+tcti_bench_set_latency (
+    TSS2_TCTI_CONTEXT *tctiContext,
+    uint64_t latency_ns);
+
+#endif /* TCTI_BENCH_H */
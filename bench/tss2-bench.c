@@ -0,0 +1,1497 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "tss2_esys.h"
+#include "tss2_mu.h"
+#include "tss2_sys.h"
+#include "tss2_tcti_mssim.h"
+
+#include "esys_iutil.h"
+
+#include "util/io.h"
+
+#include "bench.h"
+#include "tcti-bench.h"
+
+/*
+ * Micro-benchmarks for representative SYS and ESYS calls. All commands go
+ * through the in-process bench TCTI so the numbers only reflect the cost of
+ * the TSS itself: marshalling, session HMACs and parameter encryption.
+ *
+ * Usage: tss2-bench [iterations]
+ */
+
+#define BENCH_ITERATIONS 10000
+#define BENCH_RANDOM_SIZE 32
+#define BENCH_NV_READ_SIZE 128
+#define BENCH_NV_BULK_SIZE 4096
+#define BENCH_NV_CHUNK_SIZE 512
+#define BENCH_HASH_SIZE 16384
+#define BENCH_HASH_CHUNK_SIZE 1024
+#define BENCH_HASH_LATENCY_NS 20000
+#define BENCH_NONCE_SIZE 32
+#define BENCH_NONCE_SESSIONS 3
+#define BENCH_SHARED_MAX_THREADS 64
+
+typedef struct {
+    TSS2_TCTI_CONTEXT *tcti;
+    TSS2_SYS_CONTEXT *sys;
+    ESYS_CONTEXT *esys;
+    ESYS_TR nv_index;
+    ESYS_TR sealed;
+    ESYS_TR hmac_session;
+    ESYS_TR enc_session;
+    IESYS_RANDOM_POOL random_pool;
+    ESYS_SESSION_POOL *session_pool;
+    ESYS_CONTEXT *esys_cached;
+    char cache_path[32];
+} bench_state_t;
+
+static const TPM2B_AUTH bench_auth = {
+    .size = 16,
+    .buffer = { 0x62, 0x65, 0x6e, 0x63, 0x68, 0x2d, 0x61, 0x75,
+                0x74, 0x68, 0x2d, 0x76, 0x61, 0x6c, 0x75, 0x65 },
+};
+
+static TSS2_RC
+bench_sys_get_random (void *data)
+{
+    bench_state_t *state = data;
+    TPM2B_DIGEST random = { 0 };
+
+    return Tss2_Sys_GetRandom (state->sys, NULL, BENCH_RANDOM_SIZE, &random,
+                               NULL);
+}
+
+static TSS2_RC
+bench_esys_get_random (void *data)
+{
+    bench_state_t *state = data;
+    TPM2B_DIGEST *random = NULL;
+    TSS2_RC rc;
+
+    rc = Esys_GetRandom (state->esys, ESYS_TR_NONE, ESYS_TR_NONE,
+                         ESYS_TR_NONE, BENCH_RANDOM_SIZE, &random);
+    Esys_Free (random);
+    return rc;
+}
+
+static TSS2_RC
+bench_esys_get_random_into (void *data)
+{
+    bench_state_t *state = data;
+    TPM2B_DIGEST random;
+    TSS2_RC rc;
+
+    rc = Esys_GetRandom_Async (state->esys, ESYS_TR_NONE, ESYS_TR_NONE,
+                               ESYS_TR_NONE, BENCH_RANDOM_SIZE);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    do {
+        rc = Esys_GetRandom_FinishInto (state->esys, &random);
+    } while ((rc & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN);
+    return rc;
+}
+
+static TSS2_RC
+bench_esys_nv_read (void *data)
+{
+    bench_state_t *state = data;
+    TPM2B_MAX_NV_BUFFER *nv_data = NULL;
+    TSS2_RC rc;
+
+    rc = Esys_NV_Read (state->esys, state->nv_index, state->nv_index,
+                       state->hmac_session, ESYS_TR_NONE, ESYS_TR_NONE,
+                       BENCH_NV_READ_SIZE, 0, &nv_data);
+    Esys_Free (nv_data);
+    return rc;
+}
+
+static TSS2_RC
+bench_esys_nv_read_chunks (void *data)
+{
+    bench_state_t *state = data;
+    uint8_t buf [BENCH_NV_BULK_SIZE];
+    TPM2B_MAX_NV_BUFFER *nv_data = NULL;
+    TSS2_RC rc;
+
+    for (UINT16 offset = 0; offset < BENCH_NV_BULK_SIZE;
+         offset += BENCH_NV_CHUNK_SIZE) {
+        rc = Esys_NV_Read (state->esys, state->nv_index, state->nv_index,
+                           ESYS_TR_PASSWORD, ESYS_TR_NONE, ESYS_TR_NONE,
+                           BENCH_NV_CHUNK_SIZE, offset, &nv_data);
+        if (rc != TSS2_RC_SUCCESS) {
+            return rc;
+        }
+        memcpy (&buf [offset], nv_data->buffer, nv_data->size);
+        Esys_Free (nv_data);
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+bench_esys_nv_read_bulk (void *data)
+{
+    bench_state_t *state = data;
+    uint8_t buf [BENCH_NV_BULK_SIZE];
+
+    return Esys_NV_ReadBulk (state->esys, state->nv_index, state->nv_index,
+                             ESYS_TR_PASSWORD, ESYS_TR_NONE, ESYS_TR_NONE,
+                             BENCH_NV_BULK_SIZE, 0, buf);
+}
+
+static const uint8_t bench_hash_data [BENCH_HASH_SIZE];
+
+/*
+ * Hash through the sequence commands the way an application does without
+ * Esys_HashStream: one Esys_SequenceUpdate per chunk, the last chunk with
+ * Esys_SequenceComplete.
+ */
+static TSS2_RC
+bench_esys_hash_loop (void *data)
+{
+    bench_state_t *state = data;
+    TPM2B_MAX_BUFFER chunk;
+    TPM2B_DIGEST *result = NULL;
+    TPMT_TK_HASHCHECK *validation = NULL;
+    ESYS_TR sequence;
+    size_t offset;
+    TSS2_RC rc;
+
+    rc = Esys_HashSequenceStart (state->esys, ESYS_TR_NONE, ESYS_TR_NONE,
+                                 ESYS_TR_NONE, NULL, TPM2_ALG_SHA256,
+                                 &sequence);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    for (offset = 0; offset + BENCH_HASH_CHUNK_SIZE < BENCH_HASH_SIZE;
+         offset += BENCH_HASH_CHUNK_SIZE) {
+        chunk.size = BENCH_HASH_CHUNK_SIZE;
+        memcpy (chunk.buffer, &bench_hash_data [offset], chunk.size);
+        rc = Esys_SequenceUpdate (state->esys, sequence, ESYS_TR_PASSWORD,
+                                  ESYS_TR_NONE, ESYS_TR_NONE, &chunk);
+        if (rc != TSS2_RC_SUCCESS) {
+            Esys_FlushContext (state->esys, sequence);
+            return rc;
+        }
+    }
+    chunk.size = BENCH_HASH_SIZE - offset;
+    memcpy (chunk.buffer, &bench_hash_data [offset], chunk.size);
+    rc = Esys_SequenceComplete (state->esys, sequence, ESYS_TR_PASSWORD,
+                                ESYS_TR_NONE, ESYS_TR_NONE, &chunk,
+                                TPM2_RH_NULL, &result, &validation);
+    Esys_Free (result);
+    Esys_Free (validation);
+    return rc;
+}
+
+static TSS2_RC
+bench_esys_hash_stream (void *data)
+{
+    bench_state_t *state = data;
+    ESYS_HASH_STREAM *stream = NULL;
+    TPM2B_DIGEST *result = NULL;
+    TPMT_TK_HASHCHECK *validation = NULL;
+    TSS2_RC rc;
+
+    rc = Esys_HashStream_Begin (state->esys, ESYS_TR_NONE, TPM2_ALG_SHA256,
+                                TPM2_RH_NULL, NULL, ESYS_TR_PASSWORD,
+                                ESYS_TR_NONE, ESYS_TR_NONE, &stream);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    rc = Esys_HashStream_Update (stream, bench_hash_data,
+                                 sizeof (bench_hash_data));
+    if (rc != TSS2_RC_SUCCESS) {
+        Esys_HashStream_Abort (&stream);
+        return rc;
+    }
+    rc = Esys_HashStream_End (&stream, &result, &validation);
+    Esys_Free (result);
+    Esys_Free (validation);
+    return rc;
+}
+
+/*
+ * Hashing 16 KiB with password sessions, by hand and with Esys_HashStream,
+ * against an immediate TPM and against one taking BENCH_HASH_LATENCY_NS per
+ * command. The capability cache spares Esys_HashStream_Begin the input
+ * buffer query, which the hand-written loop hardcodes.
+ */
+static int
+bench_hash (bench_state_t *state, size_t iterations)
+{
+    static const uint64_t latencies [] = { 0, BENCH_HASH_LATENCY_NS };
+    char name [64];
+    int ret = 0;
+
+    if (Esys_CapabilityCache_Enable (state->esys, TPM2_YES) !=
+        TSS2_RC_SUCCESS) {
+        return -1;
+    }
+    for (size_t i = 0; i < sizeof (latencies) / sizeof (latencies [0]); i++) {
+        tcti_bench_set_latency (state->tcti, latencies [i]);
+        snprintf (name, sizeof (name), "16 KiB hash (SequenceUpdate loop%s)",
+                  latencies [i] ? ", 20 us TPM" : "");
+        ret |= bench_run (name, bench_esys_hash_loop, state, iterations);
+        snprintf (name, sizeof (name), "16 KiB hash (Esys_HashStream%s)",
+                  latencies [i] ? ", 20 us TPM" : "");
+        ret |= bench_run (name, bench_esys_hash_stream, state, iterations);
+    }
+    tcti_bench_set_latency (state->tcti, 0);
+    Esys_CapabilityCache_Enable (state->esys, TPM2_NO);
+    return ret;
+}
+
+static TSS2_RC
+bench_esys_unseal (void *data)
+{
+    bench_state_t *state = data;
+    TPM2B_SENSITIVE_DATA *out_data = NULL;
+    TSS2_RC rc;
+
+    rc = Esys_Unseal (state->esys, state->sealed, state->enc_session,
+                      ESYS_TR_NONE, ESYS_TR_NONE, &out_data);
+    Esys_Free (out_data);
+    return rc;
+}
+
+static TSS2_RC
+bench_esys_unseal_into (void *data)
+{
+    bench_state_t *state = data;
+    TPM2B_SENSITIVE_DATA out_data;
+    TSS2_RC rc;
+
+    rc = Esys_Unseal_Async (state->esys, state->sealed, state->enc_session,
+                            ESYS_TR_NONE, ESYS_TR_NONE);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    do {
+        rc = Esys_Unseal_FinishInto (state->esys, &out_data);
+    } while ((rc & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN);
+    return rc;
+}
+
+static TSS2_RC
+bench_esys_pcr_read (void *data)
+{
+    bench_state_t *state = data;
+    TPML_PCR_SELECTION selection = {
+        .count = 1,
+        .pcrSelections = {
+            { .hash = TPM2_ALG_SHA256,
+              .sizeofSelect = 3,
+              .pcrSelect = { 0xff, 0x00, 0x00 } },
+        },
+    };
+    TPML_PCR_SELECTION *selection_out = NULL;
+    TPML_DIGEST *values = NULL;
+    UINT32 update_counter;
+    TSS2_RC rc;
+
+    rc = Esys_PCR_Read (state->esys, ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                        &selection, &update_counter, &selection_out, &values);
+    Esys_Free (selection_out);
+    Esys_Free (values);
+    return rc;
+}
+
+/*
+ * The caller nonces ESYS draws for a command with three sessions, straight
+ * from the crypto backend and from a random pool.
+ */
+static TSS2_RC
+bench_nonces_backend (void *data)
+{
+    TPM2B_NONCE nonce;
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+    size_t i;
+
+    (void)data;
+    for (i = 0; i < BENCH_NONCE_SESSIONS && rc == TSS2_RC_SUCCESS; i++) {
+        rc = iesys_crypto_random2b (&nonce, BENCH_NONCE_SIZE);
+    }
+    return rc;
+}
+
+static TSS2_RC
+bench_nonces_pool (void *data)
+{
+    bench_state_t *state = data;
+    TPM2B_NONCE nonce;
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+    size_t i;
+
+    for (i = 0; i < BENCH_NONCE_SESSIONS && rc == TSS2_RC_SUCCESS; i++) {
+        rc = iesys_crypto_random_pool_get (&state->random_pool, &nonce,
+                                           BENCH_NONCE_SIZE);
+    }
+    return rc;
+}
+
+/*
+ * Getting an HMAC session for one request and giving it up again, with a
+ * fresh session each time and from a session pool.
+ */
+static const ESYS_SESSION_TEMPLATE bench_session_template = {
+    .tpmKey = ESYS_TR_NONE,
+    .bind = ESYS_TR_NONE,
+    .sessionType = TPM2_SE_HMAC,
+    .symmetric = { .algorithm = TPM2_ALG_NULL },
+    .authHash = TPM2_ALG_SHA256,
+};
+
+static TSS2_RC
+bench_session_start_flush (void *data)
+{
+    bench_state_t *state = data;
+    const ESYS_SESSION_TEMPLATE *t = &bench_session_template;
+    ESYS_TR session;
+    TSS2_RC rc;
+
+    rc = Esys_StartAuthSession (state->esys, t->tpmKey, t->bind,
+                                ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                                NULL, t->sessionType, &t->symmetric,
+                                t->authHash, &session);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    return Esys_FlushContext (state->esys, session);
+}
+
+static TSS2_RC
+bench_session_pool (void *data)
+{
+    bench_state_t *state = data;
+    ESYS_TR session;
+    TSS2_RC rc;
+
+    rc = Esys_SessionPool_Acquire (state->session_pool, &session);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    return Esys_SessionPool_Release (state->session_pool, session);
+}
+
+static TSS2_RC
+bench_from_tpm_public (ESYS_CONTEXT *esys)
+{
+    ESYS_TR object;
+    TSS2_RC rc;
+
+    rc = Esys_TR_FromTPMPublic (esys, TCTI_BENCH_NV_INDEX, ESYS_TR_NONE,
+                                ESYS_TR_NONE, ESYS_TR_NONE, &object);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    return Esys_TR_Close (esys, &object);
+}
+
+static TSS2_RC
+bench_from_tpm_public_tpm (void *data)
+{
+    bench_state_t *state = data;
+
+    return bench_from_tpm_public (state->esys);
+}
+
+static TSS2_RC
+bench_from_tpm_public_cached (void *data)
+{
+    bench_state_t *state = data;
+
+    return bench_from_tpm_public (state->esys_cached);
+}
+
+/*
+ * Fill a metadata cache file with the bench NV index and open it again in a
+ * second ESYS context, as a service would at startup.
+ */
+static TSS2_RC
+bench_setup_metadata_cache (bench_state_t *state)
+{
+    TSS2_RC rc;
+    int fd;
+
+    strcpy (state->cache_path, "/tmp/tss2-bench-XXXXXX");
+    fd = mkstemp (state->cache_path);
+    if (fd < 0) {
+        state->cache_path[0] = '\0';
+        return TSS2_BASE_RC_IO_ERROR;
+    }
+    close (fd);
+    unlink (state->cache_path);
+
+    rc = Esys_Initialize (&state->esys_cached, state->tcti, NULL);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    rc = Esys_MetadataCache_Open (state->esys_cached, state->cache_path);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    rc = bench_from_tpm_public (state->esys_cached);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    rc = Esys_MetadataCache_Save (state->esys_cached);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    rc = Esys_MetadataCache_Close (state->esys_cached);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    return Esys_MetadataCache_Open (state->esys_cached, state->cache_path);
+}
+
+static TSS2_RC
+bench_start_session (
+    bench_state_t *state,
+    const TPMT_SYM_DEF *symmetric,
+    TPMA_SESSION attributes,
+    ESYS_TR *session)
+{
+    TSS2_RC rc;
+
+    rc = Esys_StartAuthSession (state->esys, ESYS_TR_NONE, ESYS_TR_NONE,
+                                ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                                NULL, TPM2_SE_HMAC, symmetric,
+                                TPM2_ALG_SHA256, session);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    return Esys_TRSess_SetAttributes (state->esys, *session, attributes,
+                                      0xff);
+}
+
+static TSS2_RC
+bench_shared_get_random_job (
+    ESYS_CONTEXT *esys,
+    void *userdata)
+{
+    TPM2B_DIGEST *random = NULL;
+    TSS2_RC rc;
+
+    (void)userdata;
+    rc = Esys_GetRandom (esys, ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                         BENCH_RANDOM_SIZE, &random);
+    Esys_Free (random);
+    return rc;
+}
+
+static TSS2_RC
+bench_shared_get_random (void *data)
+{
+    return Esys_Shared_Call (data, bench_shared_get_random_job, NULL);
+}
+
+/*
+ * Esys_GetRandom through a shared context from 1 to 64 threads, each with
+ * its own client. The shared context gets its own bench TCTI.
+ */
+static int
+bench_shared (size_t iterations)
+{
+    ESYS_SHARED_CLIENT *clients [BENCH_SHARED_MAX_THREADS] = { NULL };
+    ESYS_SHARED *shared = NULL;
+    TSS2_TCTI_CONTEXT *tcti;
+    size_t size = 0, threads, i;
+    char name [40];
+    int ret = 0;
+    TSS2_RC rc;
+
+    rc = tcti_bench_init (NULL, &size, NULL);
+    if (rc != TSS2_RC_SUCCESS) {
+        return -1;
+    }
+    tcti = calloc (1, size);
+    if (tcti == NULL) {
+        return -1;
+    }
+    rc = tcti_bench_init (tcti, &size, &bench_auth);
+    if (rc == TSS2_RC_SUCCESS) {
+        rc = Esys_Shared_Initialize (&shared, tcti, NULL);
+    }
+    if (rc != TSS2_RC_SUCCESS) {
+        fprintf (stderr, "shared context setup failed with 0x%" PRIx32 "\n",
+                 rc);
+        ret = -1;
+        goto out;
+    }
+
+    for (threads = 1; threads <= BENCH_SHARED_MAX_THREADS; threads *= 2) {
+        for (i = 0; i < threads && rc == TSS2_RC_SUCCESS; i++) {
+            rc = Esys_Shared_ClientOpen (shared, &clients [i]);
+        }
+        if (rc == TSS2_RC_SUCCESS) {
+            snprintf (name, sizeof (name), "Shared GetRandom (%zu threads)",
+                      threads);
+            ret |= bench_run_threads (name, bench_shared_get_random,
+                                      (void**)clients, threads, iterations);
+        } else {
+            fprintf (stderr, "client open failed with 0x%" PRIx32 "\n", rc);
+            ret = -1;
+        }
+        for (i = 0; i < threads; i++) {
+            if (clients [i] != NULL) {
+                Esys_Shared_ClientClose (&clients [i]);
+            }
+        }
+        if (ret != 0) {
+            break;
+        }
+    }
+
+out:
+    if (shared != NULL) {
+        Esys_Shared_Finalize (&shared);
+    }
+    Tss2_Tcti_Finalize (tcti);
+    free (tcti);
+    return ret;
+}
+
+typedef struct {
+    ESYS_CONTEXT *esys;
+    size_t count;
+    size_t next;
+} bench_tr_lookup_t;
+
+static TSS2_RC
+bench_tr_lookup_one (void *data)
+{
+    bench_tr_lookup_t *lookup = data;
+    RSRC_NODE_T *node;
+    ESYS_TR handle = ESYS_TR_MIN_OBJECT + lookup->next;
+
+    if (++lookup->next == lookup->count) {
+        lookup->next = 0;
+    }
+    return esys_GetResourceObject (lookup->esys, handle, &node);
+}
+
+/*
+ * ESYS_TR lookups in a context holding 10 up to 100k resource objects. The
+ * objects are only created locally, no TPM command is involved.
+ */
+static int
+bench_tr_lookup (size_t iterations)
+{
+    static const size_t counts [] = { 10, 100, 1000, 10000, 100000 };
+    bench_tr_lookup_t lookup = { 0 };
+    RSRC_NODE_T *node;
+    char name [40];
+    size_t c, i;
+    int ret = 0;
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    lookup.esys = calloc (1, sizeof (ESYS_CONTEXT));
+    if (lookup.esys == NULL) {
+        return -1;
+    }
+    for (c = 0; c < sizeof (counts) / sizeof (counts [0]); c++) {
+        for (i = 0; i < counts [c] && rc == TSS2_RC_SUCCESS; i++) {
+            rc = esys_CreateResourceObject (lookup.esys,
+                                            ESYS_TR_MIN_OBJECT + i, &node);
+        }
+        if (rc != TSS2_RC_SUCCESS) {
+            fprintf (stderr, "object setup failed with 0x%" PRIx32 "\n", rc);
+            ret = -1;
+            break;
+        }
+        lookup.count = counts [c];
+        lookup.next = 0;
+        snprintf (name, sizeof (name), "ESYS_TR lookup (%zu objects)",
+                  counts [c]);
+        ret |= bench_run (name, bench_tr_lookup_one, &lookup, iterations);
+        iesys_DeleteAllResourceObjects (lookup.esys);
+    }
+    iesys_DeleteAllResourceObjects (lookup.esys);
+    free (lookup.esys);
+    return ret;
+}
+
+static const uint8_t bench_mssim_command [] = {
+    0x80, 0x01,             /* TPM2_ST_NO_SESSIONS */
+    0x00, 0x00, 0x00, 0x0c, /* size */
+    0x00, 0x00, 0x01, 0x7b, /* TPM2_CC_GetRandom */
+    0x00, 0x10 };
+static const uint8_t bench_mssim_response [] = {
+    0x80, 0x01,             /* TPM2_ST_NO_SESSIONS */
+    0x00, 0x00, 0x00, 0x0a, /* size */
+    0x00, 0x00, 0x00, 0x00 };
+
+typedef struct {
+    TSS2_TCTI_CONTEXT *tcti;
+    TSS2_TCTI_POLL_HANDLE handle;
+} bench_mssim_t;
+
+static int
+bench_mssim_listen (uint16_t port)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons (port),
+        .sin_addr.s_addr = htonl (INADDR_LOOPBACK),
+    };
+    int one = 1;
+    int sock = socket (AF_INET, SOCK_STREAM, 0);
+
+    if (sock < 0) {
+        return -1;
+    }
+    setsockopt (sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one));
+    if (bind (sock, (struct sockaddr*)&addr, sizeof (addr)) < 0 ||
+        listen (sock, 1) < 0) {
+        close (sock);
+        return -1;
+    }
+    return sock;
+}
+
+/*
+ * The simulator side of the protocol. Platform commands get a 4 byte 0
+ * response, TPM commands get the size of the response, the response and
+ * 4 bytes of 0's.
+ */
+static void
+bench_mssim_simulator (int tpm_listen, int platform_listen)
+{
+    uint8_t buf [4096];
+    uint8_t zero [4] = { 0 };
+    uint8_t reply [sizeof (UINT32) + sizeof (bench_mssim_response) +
+                   sizeof (UINT32)] = { 0 };
+    UINT32 cmd_size;
+    size_t offset;
+    int tpm = accept (tpm_listen, NULL, NULL);
+    int platform = accept (platform_listen, NULL, NULL);
+
+    if (tpm < 0 || platform < 0) {
+        _exit (1);
+    }
+    /* MS_SIM_POWER_ON and MS_SIM_NV_ON */
+    for (int i = 0; i < 2; i++) {
+        if (read_all (platform, buf, 4) != 4 ||
+            write_all (platform, zero, sizeof (zero)) != sizeof (zero)) {
+            _exit (1);
+        }
+    }
+    /* The reply is sent with a single write so Nagle's algorithm can't delay
+       its second half. */
+    Tss2_MU_UINT32_Marshal (sizeof (bench_mssim_response), reply,
+                            sizeof (reply), NULL);
+    memcpy (&reply [sizeof (UINT32)], bench_mssim_response,
+            sizeof (bench_mssim_response));
+    /* MS_SIM_TPM_SEND_COMMAND, locality and size, then the command */
+    while (read_all (tpm, buf, 9) == 9) {
+        offset = 5;
+        if (Tss2_MU_UINT32_Unmarshal (buf, 9, &offset,
+                                      &cmd_size) != TSS2_RC_SUCCESS ||
+            cmd_size > sizeof (buf) ||
+            read_all (tpm, buf, cmd_size) != (ssize_t)cmd_size ||
+            write_all (tpm, reply, sizeof (reply)) != sizeof (reply)) {
+            _exit (1);
+        }
+    }
+    _exit (0);
+}
+
+static TSS2_RC
+bench_mssim_check (const uint8_t *buf, size_t size)
+{
+    if (size != sizeof (bench_mssim_response) ||
+        memcmp (buf, bench_mssim_response, size) != 0) {
+        return TSS2_TCTI_RC_MALFORMED_RESPONSE;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+bench_mssim_blocking (void *data)
+{
+    bench_mssim_t *mssim = data;
+    uint8_t buf [64];
+    size_t size = sizeof (buf);
+    TSS2_RC rc;
+
+    rc = Tss2_Tcti_Transmit (mssim->tcti, sizeof (bench_mssim_command),
+                             bench_mssim_command);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    rc = Tss2_Tcti_Receive (mssim->tcti, &size, buf, TSS2_TCTI_TIMEOUT_BLOCK);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    return bench_mssim_check (buf, size);
+}
+
+static TSS2_RC
+bench_mssim_poll (void *data)
+{
+    bench_mssim_t *mssim = data;
+    uint8_t buf [64];
+    size_t size;
+    TSS2_RC rc;
+
+    rc = Tss2_Tcti_Transmit (mssim->tcti, sizeof (bench_mssim_command),
+                             bench_mssim_command);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    do {
+        size = sizeof (buf);
+        rc = Tss2_Tcti_Receive (mssim->tcti, &size, buf,
+                                TSS2_TCTI_TIMEOUT_NONE);
+        if (rc == TSS2_TCTI_RC_TRY_AGAIN &&
+            poll (&mssim->handle, 1, -1) != 1) {
+            return TSS2_TCTI_RC_IO_ERROR;
+        }
+    } while (rc == TSS2_TCTI_RC_TRY_AGAIN);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    return bench_mssim_check (buf, size);
+}
+
+/*
+ * Round trips of the mssim TCTI over loopback TCP, with blocking receives
+ * and with non-blocking receives driven by the TCTI poll handle. A forked
+ * child process plays the simulator.
+ */
+static int
+bench_mssim (size_t iterations)
+{
+    bench_mssim_t mssim = { 0 };
+    int tpm_listen = -1, platform_listen = -1;
+    size_t num_handles = 1, size = 0;
+    uint16_t port;
+    pid_t simulator;
+    char conf [32];
+    int status, ret = 0;
+    TSS2_RC rc;
+
+    /* The simulator uses two consecutive ports */
+    for (port = 20000 + getpid () % 20000; port < 60000; port += 2) {
+        tpm_listen = bench_mssim_listen (port);
+        platform_listen = bench_mssim_listen (port + 1);
+        if (tpm_listen >= 0 && platform_listen >= 0) {
+            break;
+        }
+        if (tpm_listen >= 0) close (tpm_listen);
+        if (platform_listen >= 0) close (platform_listen);
+    }
+    if (port >= 60000) {
+        fprintf (stderr, "mssim: no free port pair\n");
+        return -1;
+    }
+
+    simulator = fork ();
+    if (simulator < 0) {
+        close (tpm_listen);
+        close (platform_listen);
+        return -1;
+    }
+    if (simulator == 0) {
+        bench_mssim_simulator (tpm_listen, platform_listen);
+    }
+    close (tpm_listen);
+    close (platform_listen);
+
+    snprintf (conf, sizeof (conf), "host=127.0.0.1,port=%" PRIu16, port);
+    rc = Tss2_Tcti_Mssim_Init (NULL, &size, conf);
+    if (rc == TSS2_RC_SUCCESS) {
+        mssim.tcti = calloc (1, size);
+        rc = mssim.tcti ? Tss2_Tcti_Mssim_Init (mssim.tcti, &size, conf) :
+                          TSS2_BASE_RC_MEMORY;
+    }
+    if (rc == TSS2_RC_SUCCESS) {
+        rc = Tss2_Tcti_GetPollHandles (mssim.tcti, &mssim.handle,
+                                       &num_handles);
+    }
+    if (rc == TSS2_RC_SUCCESS) {
+        ret |= bench_run ("mssim round trip (blocking)", bench_mssim_blocking,
+                          &mssim, iterations);
+        ret |= bench_run ("mssim round trip (poll)", bench_mssim_poll,
+                          &mssim, iterations);
+    } else {
+        fprintf (stderr, "mssim setup failed with 0x%" PRIx32 "\n", rc);
+        ret = -1;
+    }
+
+    if (mssim.tcti != NULL) {
+        Tss2_Tcti_Finalize (mssim.tcti);
+        free (mssim.tcti);
+    } else {
+        kill (simulator, SIGTERM);
+    }
+    waitpid (simulator, &status, 0);
+    return ret;
+}
+
+/*
+ * Decoding recorded responses: the _Complete functions against the Tss2_MU
+ * calls they are made of, so the difference is the cost of the SYS layer
+ * around the MU calls. Each response is replayed through the bench TCTI
+ * once; the _Complete function then decodes it again on every call.
+ */
+#define BENCH_DECODE_PCRS 8
+#define BENCH_DECODE_PROPERTIES 48
+
+typedef struct {
+    TSS2_SYS_CONTEXT *sys;
+    TPM2_ST tag;
+    size_t params;
+    size_t params_size;
+    size_t size;
+    uint8_t response [TPM2_MAX_COMMAND_SIZE];
+} bench_decode_t;
+
+static const TSS2L_SYS_AUTH_COMMAND bench_decode_auths = {
+    .count = 1,
+    .auths = {{ .sessionHandle = TPM2_RS_PW }},
+};
+
+/*
+ * Start a response with 'handles' response handles and, for responses with
+ * sessions, room for the parameter size.
+ */
+static void
+bench_decode_begin (bench_decode_t *decode, TPM2_ST tag, size_t handles)
+{
+    decode->size = sizeof (TPM2_ST) + 2 * sizeof (UINT32) +
+                   handles * sizeof (TPM2_HANDLE);
+    if (tag == TPM2_ST_SESSIONS) {
+        decode->size += sizeof (UINT32);
+    }
+    decode->tag = tag;
+    decode->params = decode->size;
+}
+
+/* Fill in the header and, with sessions, the size and a password session */
+static TSS2_RC
+bench_decode_end (bench_decode_t *decode)
+{
+    uint8_t *buf = decode->response;
+    size_t size = sizeof (decode->response);
+    size_t offset;
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+
+    decode->params_size = decode->size - decode->params;
+    if (decode->tag == TPM2_ST_SESSIONS) {
+        offset = decode->params - sizeof (UINT32);
+        rc |= Tss2_MU_UINT32_Marshal (decode->params_size, buf, size,
+                                      &offset);
+        rc |= Tss2_MU_UINT16_Marshal (0, buf, size, &decode->size);
+        rc |= Tss2_MU_UINT8_Marshal (TPMA_SESSION_CONTINUESESSION, buf, size,
+                                     &decode->size);
+        rc |= Tss2_MU_UINT16_Marshal (0, buf, size, &decode->size);
+    }
+    offset = 0;
+    rc |= Tss2_MU_TPM2_ST_Marshal (decode->tag, buf, size, &offset);
+    rc |= Tss2_MU_UINT32_Marshal (decode->size, buf, size, &offset);
+    rc |= Tss2_MU_UINT32_Marshal (TPM2_RC_SUCCESS, buf, size, &offset);
+    return rc;
+}
+
+/* Run the command once to get the recorded response into the SYS context */
+static TSS2_RC
+bench_decode_execute (
+    bench_state_t *state,
+    bench_decode_t *decode,
+    TSS2_RC rc)
+{
+    if (rc == TSS2_RC_SUCCESS && decode->tag == TPM2_ST_SESSIONS) {
+        rc = Tss2_Sys_SetCmdAuths (state->sys, &bench_decode_auths);
+    }
+    if (rc == TSS2_RC_SUCCESS) {
+        rc = tcti_bench_replay (state->tcti, decode->response, decode->size);
+    }
+    if (rc == TSS2_RC_SUCCESS) {
+        rc = Tss2_Sys_Execute (state->sys);
+    }
+    decode->sys = state->sys;
+    return rc;
+}
+
+/* TPM2_Quote with an RSA-2048 signature */
+static TSS2_RC
+bench_decode_quote_setup (bench_state_t *state, bench_decode_t *decode)
+{
+    TPM2B_ATTEST quoted = { .size = 145 };
+    TPMT_SIGNATURE signature = {
+        .sigAlg = TPM2_ALG_RSASSA,
+        .signature.rsassa = {
+            .hash = TPM2_ALG_SHA256,
+            .sig = { .size = 256 },
+        },
+    };
+    TPMT_SIG_SCHEME scheme = { .scheme = TPM2_ALG_NULL };
+    TPML_PCR_SELECTION pcrs = { .count = 0 };
+    uint8_t *buf = decode->response;
+    size_t size = sizeof (decode->response);
+    TSS2_RC rc;
+
+    memset (quoted.attestationData, 0x11, quoted.size);
+    memset (signature.signature.rsassa.sig.buffer, 0x22, 256);
+    bench_decode_begin (decode, TPM2_ST_SESSIONS, 0);
+    rc = Tss2_MU_TPM2B_ATTEST_Marshal (&quoted, buf, size, &decode->size);
+    rc |= Tss2_MU_TPMT_SIGNATURE_Marshal (&signature, buf, size,
+                                          &decode->size);
+    rc |= bench_decode_end (decode);
+    if (rc == TSS2_RC_SUCCESS) {
+        rc = Tss2_Sys_Quote_Prepare (state->sys, TCTI_BENCH_SEALED_OBJECT,
+                                     NULL, &scheme, &pcrs);
+    }
+    return bench_decode_execute (state, decode, rc);
+}
+
+static TSS2_RC
+bench_decode_quote (void *data)
+{
+    bench_decode_t *decode = data;
+    TPM2B_ATTEST quoted;
+    TPMT_SIGNATURE signature;
+
+    return Tss2_Sys_Quote_Complete (decode->sys, &quoted, &signature);
+}
+
+static TSS2_RC
+bench_decode_quote_checked (void *data)
+{
+    bench_decode_t *decode = data;
+    TPM2B_ATTEST quoted;
+    TPMT_SIGNATURE signature;
+    size_t offset = decode->params;
+    TSS2_RC rc;
+
+    rc = Tss2_MU_TPM2B_ATTEST_Unmarshal (decode->response, decode->size,
+                                         &offset, &quoted);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    return Tss2_MU_TPMT_SIGNATURE_Unmarshal (decode->response, decode->size,
+                                             &offset, &signature);
+}
+
+/* TPM2_CreatePrimary of an RSA-2048 storage key with creation data */
+static TSS2_RC
+bench_decode_create_primary_setup (
+    bench_state_t *state,
+    bench_decode_t *decode)
+{
+    TPM2B_PUBLIC public = {
+        .publicArea = {
+            .type = TPM2_ALG_RSA,
+            .nameAlg = TPM2_ALG_SHA256,
+            .objectAttributes = TPMA_OBJECT_RESTRICTED |
+                                TPMA_OBJECT_DECRYPT |
+                                TPMA_OBJECT_FIXEDTPM |
+                                TPMA_OBJECT_FIXEDPARENT |
+                                TPMA_OBJECT_SENSITIVEDATAORIGIN |
+                                TPMA_OBJECT_USERWITHAUTH,
+            .parameters.rsaDetail = {
+                .symmetric = {
+                    .algorithm = TPM2_ALG_AES,
+                    .keyBits.aes = 128,
+                    .mode.aes = TPM2_ALG_CFB,
+                },
+                .scheme = { .scheme = TPM2_ALG_NULL },
+                .keyBits = 2048,
+            },
+            .unique.rsa = { .size = 256 },
+        },
+    };
+    TPM2B_CREATION_DATA creation = {
+        .creationData = {
+            .pcrSelect = {
+                .count = 1,
+                .pcrSelections = {{ TPM2_ALG_SHA256, 3, { 0xff, 0, 0 } }},
+            },
+            .pcrDigest = { .size = 32 },
+            .locality = TPMA_LOCALITY_TPM2_LOC_ZERO,
+            .parentNameAlg = TPM2_ALG_NULL,
+            .parentName = { .size = 4 },
+            .parentQualifiedName = { .size = 4 },
+        },
+    };
+    TPM2B_DIGEST hash = { .size = 32 };
+    TPMT_TK_CREATION ticket = {
+        .tag = TPM2_ST_CREATION,
+        .hierarchy = TPM2_RH_OWNER,
+        .digest = { .size = 32 },
+    };
+    TPM2B_NAME name = { .size = 34 };
+    TPM2B_SENSITIVE_CREATE in_sensitive = { .size = 0 };
+    TPM2B_DATA outside_info = { .size = 0 };
+    TPML_PCR_SELECTION creation_pcr = { .count = 0 };
+    uint8_t *buf = decode->response;
+    size_t size = sizeof (decode->response);
+    size_t offset;
+    TSS2_RC rc;
+
+    memset (public.publicArea.unique.rsa.buffer, 0x33, 256);
+    memset (creation.creationData.pcrDigest.buffer, 0x44, 32);
+    memset (hash.buffer, 0x55, 32);
+    memset (ticket.digest.buffer, 0x66, 32);
+    memset (name.name, 0x77, 34);
+    bench_decode_begin (decode, TPM2_ST_SESSIONS, 1);
+    offset = decode->params - 2 * sizeof (UINT32);
+    rc = Tss2_MU_UINT32_Marshal (TCTI_BENCH_SEALED_OBJECT, buf, size,
+                                 &offset);
+    rc |= Tss2_MU_TPM2B_PUBLIC_Marshal (&public, buf, size, &decode->size);
+    rc |= Tss2_MU_TPM2B_CREATION_DATA_Marshal (&creation, buf, size,
+                                               &decode->size);
+    rc |= Tss2_MU_TPM2B_DIGEST_Marshal (&hash, buf, size, &decode->size);
+    rc |= Tss2_MU_TPMT_TK_CREATION_Marshal (&ticket, buf, size,
+                                            &decode->size);
+    rc |= Tss2_MU_TPM2B_NAME_Marshal (&name, buf, size, &decode->size);
+    rc |= bench_decode_end (decode);
+    if (rc == TSS2_RC_SUCCESS) {
+        public.size = 0;
+        rc = Tss2_Sys_CreatePrimary_Prepare (state->sys, TPM2_RH_OWNER,
+                                             &in_sensitive, &public,
+                                             &outside_info, &creation_pcr);
+    }
+    return bench_decode_execute (state, decode, rc);
+}
+
+static TSS2_RC
+bench_decode_create_primary (void *data)
+{
+    bench_decode_t *decode = data;
+    TPM2B_PUBLIC public = { .size = 0 };
+    TPM2B_CREATION_DATA creation = { .size = 0 };
+    TPM2B_DIGEST hash;
+    TPMT_TK_CREATION ticket;
+    TPM2B_NAME name;
+    TPM2_HANDLE handle;
+
+    return Tss2_Sys_CreatePrimary_Complete (decode->sys, &handle, &public,
+                                            &creation, &hash, &ticket, &name);
+}
+
+static TSS2_RC
+bench_decode_create_primary_checked (void *data)
+{
+    bench_decode_t *decode = data;
+    TPM2B_PUBLIC public = { .size = 0 };
+    TPM2B_CREATION_DATA creation = { .size = 0 };
+    TPM2B_DIGEST hash;
+    TPMT_TK_CREATION ticket;
+    TPM2B_NAME name;
+    size_t offset = decode->params;
+    TSS2_RC rc;
+
+    rc = Tss2_MU_TPM2B_PUBLIC_Unmarshal (decode->response, decode->size,
+                                         &offset, &public);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    rc = Tss2_MU_TPM2B_CREATION_DATA_Unmarshal (decode->response,
+                                                decode->size, &offset,
+                                                &creation);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    rc = Tss2_MU_TPM2B_DIGEST_Unmarshal (decode->response, decode->size,
+                                         &offset, &hash);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    rc = Tss2_MU_TPMT_TK_CREATION_Unmarshal (decode->response, decode->size,
+                                             &offset, &ticket);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    return Tss2_MU_TPM2B_NAME_Unmarshal (decode->response, decode->size,
+                                         &offset, &name);
+}
+
+/* TPM2_PCR_Read of eight SHA-256 PCRs */
+static TSS2_RC
+bench_decode_pcr_read_setup (bench_state_t *state, bench_decode_t *decode)
+{
+    TPML_PCR_SELECTION selection = {
+        .count = 1,
+        .pcrSelections = {{ TPM2_ALG_SHA256, 3, { 0xff, 0x00, 0x00 } }},
+    };
+    TPML_DIGEST values = { .count = BENCH_DECODE_PCRS };
+    uint8_t *buf = decode->response;
+    size_t size = sizeof (decode->response);
+    size_t i;
+    TSS2_RC rc;
+
+    for (i = 0; i < BENCH_DECODE_PCRS; i++) {
+        values.digests [i].size = TPM2_SHA256_DIGEST_SIZE;
+        memset (values.digests [i].buffer, i, TPM2_SHA256_DIGEST_SIZE);
+    }
+    bench_decode_begin (decode, TPM2_ST_NO_SESSIONS, 0);
+    rc = Tss2_MU_UINT32_Marshal (42, buf, size, &decode->size);
+    rc |= Tss2_MU_TPML_PCR_SELECTION_Marshal (&selection, buf, size,
+                                              &decode->size);
+    rc |= Tss2_MU_TPML_DIGEST_Marshal (&values, buf, size, &decode->size);
+    rc |= bench_decode_end (decode);
+    if (rc == TSS2_RC_SUCCESS) {
+        rc = Tss2_Sys_PCR_Read_Prepare (state->sys, &selection);
+    }
+    return bench_decode_execute (state, decode, rc);
+}
+
+static TSS2_RC
+bench_decode_pcr_read (void *data)
+{
+    bench_decode_t *decode = data;
+    TPML_PCR_SELECTION selection;
+    TPML_DIGEST values;
+    UINT32 counter;
+
+    return Tss2_Sys_PCR_Read_Complete (decode->sys, &counter, &selection,
+                                       &values);
+}
+
+static TSS2_RC
+bench_decode_pcr_read_checked (void *data)
+{
+    bench_decode_t *decode = data;
+    TPML_PCR_SELECTION selection;
+    TPML_DIGEST values;
+    UINT32 counter;
+    size_t offset = decode->params;
+    TSS2_RC rc;
+
+    rc = Tss2_MU_UINT32_Unmarshal (decode->response, decode->size, &offset,
+                                   &counter);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    rc = Tss2_MU_TPML_PCR_SELECTION_Unmarshal (decode->response,
+                                               decode->size, &offset,
+                                               &selection);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    return Tss2_MU_TPML_DIGEST_Unmarshal (decode->response, decode->size,
+                                          &offset, &values);
+}
+
+/* TPM2_GetCapability of the fixed TPM properties */
+static TSS2_RC
+bench_decode_get_capability_setup (
+    bench_state_t *state,
+    bench_decode_t *decode)
+{
+    TPMS_CAPABILITY_DATA data = { .capability = TPM2_CAP_TPM_PROPERTIES };
+    TPML_TAGGED_TPM_PROPERTY *properties = &data.data.tpmProperties;
+    uint8_t *buf = decode->response;
+    size_t size = sizeof (decode->response);
+    size_t i;
+    TSS2_RC rc;
+
+    properties->count = BENCH_DECODE_PROPERTIES;
+    for (i = 0; i < BENCH_DECODE_PROPERTIES; i++) {
+        properties->tpmProperty [i].property = TPM2_PT_FIXED + i;
+        properties->tpmProperty [i].value = i;
+    }
+    bench_decode_begin (decode, TPM2_ST_NO_SESSIONS, 0);
+    rc = Tss2_MU_UINT8_Marshal (TPM2_NO, buf, size, &decode->size);
+    rc |= Tss2_MU_TPMS_CAPABILITY_DATA_Marshal (&data, buf, size,
+                                                &decode->size);
+    rc |= bench_decode_end (decode);
+    if (rc == TSS2_RC_SUCCESS) {
+        rc = Tss2_Sys_GetCapability_Prepare (state->sys,
+                                             TPM2_CAP_TPM_PROPERTIES,
+                                             TPM2_PT_FIXED,
+                                             BENCH_DECODE_PROPERTIES);
+    }
+    return bench_decode_execute (state, decode, rc);
+}
+
+static TSS2_RC
+bench_decode_get_capability (void *data)
+{
+    bench_decode_t *decode = data;
+    TPMS_CAPABILITY_DATA capability_data;
+    TPMI_YES_NO more;
+
+    return Tss2_Sys_GetCapability_Complete (decode->sys, &more,
+                                            &capability_data);
+}
+
+static TSS2_RC
+bench_decode_get_capability_checked (void *data)
+{
+    bench_decode_t *decode = data;
+    TPMS_CAPABILITY_DATA capability_data;
+    TPMI_YES_NO more;
+    size_t offset = decode->params;
+    TSS2_RC rc;
+
+    rc = Tss2_MU_UINT8_Unmarshal (decode->response, decode->size, &offset,
+                                  &more);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    return Tss2_MU_TPMS_CAPABILITY_DATA_Unmarshal (decode->response,
+                                                   decode->size, &offset,
+                                                   &capability_data);
+}
+
+static const struct {
+    const char *name;
+    TSS2_RC (*setup) (bench_state_t *state, bench_decode_t *decode);
+    bench_fn complete;
+    bench_fn checked;
+} bench_decodes [] = {
+    { "Quote", bench_decode_quote_setup, bench_decode_quote,
+      bench_decode_quote_checked },
+    { "CreatePrimary", bench_decode_create_primary_setup,
+      bench_decode_create_primary, bench_decode_create_primary_checked },
+    { "PCR_Read", bench_decode_pcr_read_setup, bench_decode_pcr_read,
+      bench_decode_pcr_read_checked },
+    { "GetCapability", bench_decode_get_capability_setup,
+      bench_decode_get_capability, bench_decode_get_capability_checked },
+};
+
+/*
+ * Per-byte cost of decoding the response parameters with Tss2_MU and with
+ * the _Complete functions.
+ */
+static int
+bench_decode (bench_state_t *state, size_t iterations)
+{
+    bench_decode_t *decode;
+    char name [40];
+    size_t i;
+    int ret = 0;
+    TSS2_RC rc;
+
+    decode = calloc (1, sizeof (*decode));
+    if (decode == NULL) {
+        return -1;
+    }
+
+    printf ("\n");
+    bench_print_bytes_header ();
+    for (i = 0; i < sizeof (bench_decodes) / sizeof (bench_decodes [0]);
+         i++) {
+        rc = bench_decodes [i].setup (state, decode);
+        if (rc != TSS2_RC_SUCCESS) {
+            fprintf (stderr, "%s: replay failed with 0x%" PRIx32 "\n",
+                     bench_decodes [i].name, rc);
+            ret = -1;
+            continue;
+        }
+        snprintf (name, sizeof (name), "%s (Tss2_MU)",
+                  bench_decodes [i].name);
+        ret |= bench_run_bytes (name, bench_decodes [i].checked, decode,
+                                iterations, decode->params_size);
+        snprintf (name, sizeof (name), "%s_Complete",
+                  bench_decodes [i].name);
+        ret |= bench_run_bytes (name, bench_decodes [i].complete, decode,
+                                iterations, decode->params_size);
+    }
+
+    free (decode);
+    return ret;
+}
+
+static TSS2_RC
+bench_setup (bench_state_t *state)
+{
+    TPMT_SYM_DEF sym_null = { .algorithm = TPM2_ALG_NULL };
+    TPMT_SYM_DEF sym_aes = {
+        .algorithm = TPM2_ALG_AES,
+        .keyBits = { .aes = 128 },
+        .mode = { .aes = TPM2_ALG_CFB },
+    };
+    size_t size = 0;
+    TSS2_ABI_VERSION abi_version = TSS2_ABI_VERSION_CURRENT;
+    TSS2_RC rc;
+
+    memset (state, 0, sizeof (*state));
+    state->hmac_session = ESYS_TR_NONE;
+    state->enc_session = ESYS_TR_NONE;
+    rc = tcti_bench_init (NULL, &size, NULL);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    state->tcti = calloc (1, size);
+    if (state->tcti == NULL) {
+        return TSS2_BASE_RC_MEMORY;
+    }
+    rc = tcti_bench_init (state->tcti, &size, &bench_auth);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+
+    size = Tss2_Sys_GetContextSize (0);
+    state->sys = calloc (1, size);
+    if (state->sys == NULL) {
+        return TSS2_BASE_RC_MEMORY;
+    }
+    rc = Tss2_Sys_Initialize (state->sys, size, state->tcti, &abi_version);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+
+    rc = Esys_Initialize (&state->esys, state->tcti, NULL);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    rc = Esys_TR_FromTPMPublic (state->esys, TCTI_BENCH_NV_INDEX,
+                                ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                                &state->nv_index);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    rc = Esys_TR_SetAuth (state->esys, state->nv_index, &bench_auth);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    rc = Esys_TR_FromTPMPublic (state->esys, TCTI_BENCH_SEALED_OBJECT,
+                                ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                                &state->sealed);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    rc = Esys_TR_SetAuth (state->esys, state->sealed, &bench_auth);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    rc = Esys_SessionPool_Create (state->esys, &bench_session_template, 1, 1,
+                                  &state->session_pool);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    rc = bench_setup_metadata_cache (state);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    rc = bench_start_session (state, &sym_null, TPMA_SESSION_CONTINUESESSION,
+                              &state->hmac_session);
+    if (rc != TSS2_RC_SUCCESS) {
+        return rc;
+    }
+    return bench_start_session (state, &sym_aes,
+                                TPMA_SESSION_CONTINUESESSION |
+                                TPMA_SESSION_ENCRYPT,
+                                &state->enc_session);
+}
+
+static void
+bench_teardown (bench_state_t *state)
+{
+    if (state->esys != NULL) {
+        if (state->hmac_session != ESYS_TR_NONE) {
+            Esys_FlushContext (state->esys, state->hmac_session);
+        }
+        if (state->enc_session != ESYS_TR_NONE) {
+            Esys_FlushContext (state->esys, state->enc_session);
+        }
+        Esys_SessionPool_Free (&state->session_pool);
+        Esys_Finalize (&state->esys);
+    }
+    if (state->esys_cached != NULL) {
+        Esys_Finalize (&state->esys_cached);
+    }
+    if (state->cache_path[0] != '\0') {
+        unlink (state->cache_path);
+    }
+    iesys_crypto_random_pool_free (&state->random_pool);
+    if (state->sys != NULL) {
+        Tss2_Sys_Finalize (state->sys);
+        free (state->sys);
+    }
+    if (state->tcti != NULL) {
+        Tss2_Tcti_Finalize (state->tcti);
+        free (state->tcti);
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+    bench_state_t state;
+    size_t iterations = BENCH_ITERATIONS;
+    char *end;
+    int ret = 0;
+    TSS2_RC rc;
+
+    if (argc > 2) {
+        fprintf (stderr, "usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+    if (argc == 2) {
+        iterations = strtoul (argv[1], &end, 10);
+        if (*end != '\0' || iterations == 0) {
+            fprintf (stderr, "invalid iteration count: %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    rc = bench_setup (&state);
+    if (rc != TSS2_RC_SUCCESS) {
+        fprintf (stderr, "setup failed with 0x%" PRIx32 "\n", rc);
+        bench_teardown (&state);
+        return 1;
+    }
+
+    bench_print_header ();
+    ret |= bench_run ("Tss2_Sys_GetRandom", bench_sys_get_random, &state,
+                      iterations);
+    ret |= bench_run ("Esys_GetRandom", bench_esys_get_random, &state,
+                      iterations);
+    ret |= bench_run ("Esys_GetRandom_FinishInto", bench_esys_get_random_into,
+                      &state, iterations);
+    ret |= bench_run ("Esys_NV_Read (HMAC session)", bench_esys_nv_read,
+                      &state, iterations);
+    ret |= bench_run ("4 KiB NV read (Esys_NV_Read loop)",
+                      bench_esys_nv_read_chunks, &state, iterations);
+    ret |= bench_run ("4 KiB NV read (Esys_NV_ReadBulk)",
+                      bench_esys_nv_read_bulk, &state, iterations);
+    ret |= bench_run ("Esys_Unseal (AES-CFB session)", bench_esys_unseal,
+                      &state, iterations);
+    ret |= bench_run ("Esys_Unseal_FinishInto (AES-CFB)",
+                      bench_esys_unseal_into, &state, iterations);
+    ret |= bench_run ("Esys_PCR_Read", bench_esys_pcr_read, &state,
+                      iterations);
+    ret |= bench_run ("3 nonces (backend RNG)", bench_nonces_backend,
+                      &state, iterations);
+    ret |= bench_run ("3 nonces (random pool)", bench_nonces_pool, &state,
+                      iterations);
+    ret |= bench_run ("HMAC session (start+flush)",
+                      bench_session_start_flush, &state, iterations);
+    ret |= bench_run ("HMAC session (pool)", bench_session_pool, &state,
+                      iterations);
+    ret |= bench_run ("TR_FromTPMPublic (TPM)", bench_from_tpm_public_tpm,
+                      &state, iterations);
+    ret |= bench_run ("TR_FromTPMPublic (metadata cache)",
+                      bench_from_tpm_public_cached, &state, iterations);
+    ret |= bench_hash (&state, iterations);
+    ret |= bench_shared (iterations);
+    ret |= bench_tr_lookup (iterations);
+    ret |= bench_mssim (iterations);
+    ret |= bench_decode (&state, iterations);
+
+    bench_teardown (&state);
+    return ret ? 1 : 0;
+}
@@ -95,6 +95,11 @@ Esys_SetTimeout(
     ESYS_CONTEXT *esys_context,
     int32_t timeout);
 
+TSS2_RC
+Esys_SetRandomPoolSize(
+    ESYS_CONTEXT *esys_context,
+    size_t size);
+
 TSS2_RC
 Esys_TR_Serialize(
     ESYS_CONTEXT *esys_context,
@@ -167,6 +172,229 @@ Esys_TRSess_GetNonceTPM(
     ESYS_TR session,
     TPM2B_NONCE **nonceTPM);
 
+/*
+ * Session pool: auth sessions started ahead of time from one template
+ */
+
+typedef struct {
+    ESYS_TR tpmKey;
+    ESYS_TR bind;
+    TPM2_SE sessionType;
+    TPMT_SYM_DEF symmetric;
+    TPMI_ALG_HASH authHash;
+    TPMA_SESSION sessionAttributes;
+} ESYS_SESSION_TEMPLATE;
+
+typedef struct ESYS_SESSION_POOL ESYS_SESSION_POOL;
+
+TSS2_RC
+Esys_SessionPool_Create(
+    ESYS_CONTEXT *esysContext,
+    const ESYS_SESSION_TEMPLATE *sessionTemplate,
+    size_t min,
+    size_t max,
+    ESYS_SESSION_POOL **pool);
+
+TSS2_RC
+Esys_SessionPool_Free(
+    ESYS_SESSION_POOL **pool);
+
+TSS2_RC
+Esys_SessionPool_Acquire(
+    ESYS_SESSION_POOL *pool,
+    ESYS_TR *session);
+
+TSS2_RC
+Esys_SessionPool_Release(
+    ESYS_SESSION_POOL *pool,
+    ESYS_TR session);
+
+TSS2_RC
+Esys_SessionPool_Refill(
+    ESYS_SESSION_POOL *pool);
+
+TSS2_RC
+Esys_SessionPool_Refill_Async(
+    ESYS_SESSION_POOL *pool);
+
+TSS2_RC
+Esys_SessionPool_Refill_Finish(
+    ESYS_SESSION_POOL *pool);
+
+/*
+ * Swapping of transient objects and sessions out of the TPM
+ */
+
+typedef struct {
+    UINT64 hits;
+    UINT64 misses;
+    UINT64 swapOuts;
+} ESYS_SWAP_STATS;
+
+TSS2_RC
+Esys_SetSwapLimits(
+    ESYS_CONTEXT *esysContext,
+    UINT32 maxObjects,
+    UINT32 maxSessions);
+
+TSS2_RC
+Esys_GetSwapStats(
+    ESYS_CONTEXT *esysContext,
+    ESYS_SWAP_STATS *stats);
+
+/*
+ * Metadata cache of persistent objects and NV indices
+ */
+
+TSS2_RC
+Esys_MetadataCache_Open(
+    ESYS_CONTEXT *esysContext,
+    const char *path);
+
+TSS2_RC
+Esys_MetadataCache_Remove(
+    ESYS_CONTEXT *esysContext,
+    TPM2_HANDLE tpmHandle);
+
+TSS2_RC
+Esys_MetadataCache_Save(
+    ESYS_CONTEXT *esysContext);
+
+TSS2_RC
+Esys_MetadataCache_Close(
+    ESYS_CONTEXT *esysContext);
+
+/*
+ * Hashing and HMAC of large data over sequence objects
+ */
+
+typedef struct ESYS_HASH_STREAM ESYS_HASH_STREAM;
+
+TSS2_RC
+Esys_HashStream_Begin(
+    ESYS_CONTEXT *esysContext,
+    ESYS_TR hmacKey,
+    TPMI_ALG_HASH hashAlg,
+    TPMI_RH_HIERARCHY hierarchy,
+    const TPM2B_AUTH *auth,
+    ESYS_TR shandle1,
+    ESYS_TR shandle2,
+    ESYS_TR shandle3,
+    ESYS_HASH_STREAM **stream);
+
+TSS2_RC
+Esys_HashStream_Update(
+    ESYS_HASH_STREAM *stream,
+    const uint8_t *buffer,
+    size_t size);
+
+TSS2_RC
+Esys_HashStream_UpdateFd(
+    ESYS_HASH_STREAM *stream,
+    int fd);
+
+TSS2_RC
+Esys_HashStream_End(
+    ESYS_HASH_STREAM **stream,
+    TPM2B_DIGEST **result,
+    TPMT_TK_HASHCHECK **validation);
+
+TSS2_RC
+Esys_HashStream_Abort(
+    ESYS_HASH_STREAM **stream);
+
+/*
+ * Cache of stable TPM capabilities
+ */
+
+TSS2_RC
+Esys_CapabilityCache_Enable(
+    ESYS_CONTEXT *esysContext,
+    TPMI_YES_NO enable);
+
+TSS2_RC
+Esys_CapabilityCache_Invalidate(
+    ESYS_CONTEXT *esysContext);
+
+/*
+ * Sharing one ESYS_CONTEXT between threads (requires POSIX threads)
+ */
+#ifndef _WIN32
+
+typedef struct ESYS_SHARED ESYS_SHARED;
+typedef struct ESYS_SHARED_CLIENT ESYS_SHARED_CLIENT;
+typedef struct ESYS_SHARED_FUTURE ESYS_SHARED_FUTURE;
+
+typedef TSS2_RC (*ESYS_SHARED_CALLBACK)(
+    ESYS_CONTEXT *esysContext,
+    void *userdata);
+
+TSS2_RC
+Esys_Shared_Initialize(
+    ESYS_SHARED **shared,
+    TSS2_TCTI_CONTEXT *tcti,
+    TSS2_ABI_VERSION *abiVersion);
+
+void
+Esys_Shared_Finalize(
+    ESYS_SHARED **shared);
+
+TSS2_RC
+Esys_Shared_ClientOpen(
+    ESYS_SHARED *shared,
+    ESYS_SHARED_CLIENT **client);
+
+TSS2_RC
+Esys_Shared_ClientClose(
+    ESYS_SHARED_CLIENT **client);
+
+TSS2_RC
+Esys_Shared_Submit(
+    ESYS_SHARED_CLIENT *client,
+    ESYS_SHARED_CALLBACK callback,
+    void *userdata,
+    ESYS_SHARED_FUTURE **future);
+
+TSS2_RC
+Esys_Shared_Wait(
+    ESYS_SHARED_FUTURE **future,
+    int32_t timeout);
+
+TSS2_RC
+Esys_Shared_Call(
+    ESYS_SHARED_CLIENT *client,
+    ESYS_SHARED_CALLBACK callback,
+    void *userdata);
+#endif /* _WIN32 */
+
+/*
+ * Reading and writing NV indices of any size
+ */
+
+TSS2_RC
+Esys_NV_ReadBulk(
+    ESYS_CONTEXT *esysContext,
+    ESYS_TR authHandle,
+    ESYS_TR nvIndex,
+    ESYS_TR shandle1,
+    ESYS_TR shandle2,
+    ESYS_TR shandle3,
+    UINT16 size,
+    UINT16 offset,
+    uint8_t *data);
+
+TSS2_RC
+Esys_NV_WriteBulk(
+    ESYS_CONTEXT *esysContext,
+    ESYS_TR authHandle,
+    ESYS_TR nvIndex,
+    ESYS_TR shandle1,
+    ESYS_TR shandle2,
+    ESYS_TR shandle3,
+    const uint8_t *data,
+    UINT16 size,
+    UINT16 offset);
+
 /* Table 5 - TPM2_Startup Command */
 
 TSS2_RC
@@ -539,6 +767,11 @@ Esys_Unseal_Finish(
     ESYS_CONTEXT *esysContext,
     TPM2B_SENSITIVE_DATA **outData);
 
+TSS2_RC
+Esys_Unseal_FinishInto(
+    ESYS_CONTEXT *esysContext,
+    TPM2B_SENSITIVE_DATA *outData);
+
 /* Table 33 - TPM2_ObjectChangeAuth Command */
 
 TSS2_RC
@@ -1021,6 +1254,11 @@ Esys_GetRandom_Finish(
     ESYS_CONTEXT *esysContext,
     TPM2B_DIGEST **randomBytes);
 
+TSS2_RC
+Esys_GetRandom_FinishInto(
+    ESYS_CONTEXT *esysContext,
+    TPM2B_DIGEST *randomBytes);
+
 /* Table 68 - TPM2_StirRandom Command */
 
 TSS2_RC
@@ -1497,6 +1735,11 @@ Esys_Sign_Finish(
     ESYS_CONTEXT *esysContext,
     TPMT_SIGNATURE **signature);
 
+TSS2_RC
+Esys_Sign_FinishInto(
+    ESYS_CONTEXT *esysContext,
+    TPMT_SIGNATURE *signature);
+
 /* Table 101 - TPM2_SetCommandCodeAuditStatus Command */
 
 TSS2_RC
@@ -1603,6 +1846,13 @@ Esys_PCR_Read_Finish(
     TPML_PCR_SELECTION **pcrSelectionOut,
     TPML_DIGEST **pcrValues);
 
+TSS2_RC
+Esys_PCR_Read_FinishInto(
+    ESYS_CONTEXT *esysContext,
+    UINT32 *pcrUpdateCounter,
+    TPML_PCR_SELECTION *pcrSelectionOut,
+    TPML_DIGEST *pcrValues);
+
 /* Table 109 - TPM2_PCR_Allocate Command */
 
 TSS2_RC
@@ -2283,6 +2533,15 @@ Esys_CreatePrimary_Finish(
     TPM2B_DIGEST **creationHash,
     TPMT_TK_CREATION **creationTicket);
 
+TSS2_RC
+Esys_CreatePrimary_FinishInto(
+    ESYS_CONTEXT *esysContext,
+    ESYS_TR *objectHandle,
+    TPM2B_PUBLIC *outPublic,
+    TPM2B_CREATION_DATA *creationData,
+    TPM2B_DIGEST *creationHash,
+    TPMT_TK_CREATION *creationTicket);
+
 /* Table 159 - TPM2_HierarchyControl Command */
 
 TSS2_RC
@@ -3111,6 +3370,11 @@ Esys_NV_Read_Finish(
     ESYS_CONTEXT *esysContext,
     TPM2B_MAX_NV_BUFFER **data);
 
+TSS2_RC
+Esys_NV_Read_FinishInto(
+    ESYS_CONTEXT *esysContext,
+    TPM2B_MAX_NV_BUFFER *data);
+
 /* Table 227 - TPM2_NV_ReadLock Command */
 
 TSS2_RC
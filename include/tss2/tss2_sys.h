@@ -58,6 +58,11 @@ TSS2_RC Tss2_Sys_GetDecryptParam(
     size_t *decryptParamSize,
     const uint8_t **decryptParamBuffer);
 
+TSS2_RC Tss2_Sys_GetDecryptParamBuffer(
+    TSS2_SYS_CONTEXT *sysContext,
+    size_t *decryptParamSize,
+    uint8_t **decryptParamBuffer);
+
 TSS2_RC Tss2_Sys_SetDecryptParam(
     TSS2_SYS_CONTEXT *sysContext,
     size_t decryptParamSize,
@@ -72,6 +77,10 @@ TSS2_RC Tss2_Sys_SetCmdAuths(
     TSS2_SYS_CONTEXT *sysContext,
     const TSS2L_SYS_AUTH_COMMAND *cmdAuthsArray);
 
+TSS2_RC Tss2_Sys_ReserveCmdAuths(
+    TSS2_SYS_CONTEXT *sysContext,
+    const TSS2L_SYS_AUTH_COMMAND *cmdAuthsLayout);
+
 /* Command Execution Functions */
 TSS2_RC Tss2_Sys_ExecuteAsync(
     TSS2_SYS_CONTEXT *sysContext);
@@ -83,6 +92,11 @@ TSS2_RC Tss2_Sys_ExecuteFinish(
 TSS2_RC Tss2_Sys_Execute(
     TSS2_SYS_CONTEXT *sysContext);
 
+TSS2_RC Tss2_Sys_ExecuteBatch(
+    TSS2_SYS_CONTEXT *sysContexts[],
+    size_t count,
+    size_t *executed);
+
 /* Command Completion functions */
 TSS2_RC Tss2_Sys_GetCommandCode(
     TSS2_SYS_CONTEXT *sysContext,
@@ -97,6 +111,11 @@ TSS2_RC Tss2_Sys_GetEncryptParam(
     size_t *encryptParamSize,
     const uint8_t **encryptParamBuffer);
 
+TSS2_RC Tss2_Sys_GetEncryptParamBuffer(
+    TSS2_SYS_CONTEXT *sysContext,
+    size_t *encryptParamSize,
+    uint8_t **encryptParamBuffer);
+
 TSS2_RC Tss2_Sys_SetEncryptParam(
     TSS2_SYS_CONTEXT *sysContext,
     size_t encryptParamSize,
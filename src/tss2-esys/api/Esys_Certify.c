@@ -204,6 +204,11 @@ Esys_Certify_Async(
     r = esys_GetResourceObject(esysContext, signHandle, &signHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "signHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_Certify, shandle1, shandle2,
+                              shandle3, objectHandleNode, signHandleNode, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_Certify_Prepare(esysContext->sys,
                                  (objectHandleNode == NULL) ? TPM2_RH_NULL
@@ -234,6 +234,12 @@ Esys_CertifyCreation_Async(
     r = esys_GetResourceObject(esysContext, objectHandle, &objectHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "objectHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_CertifyCreation, shandle1,
+                              shandle2, shandle3, signHandleNode,
+                              objectHandleNode, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_CertifyCreation_Prepare(esysContext->sys,
                                          (signHandleNode == NULL) ? TPM2_RH_NULL
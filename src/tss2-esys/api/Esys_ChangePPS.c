@@ -170,6 +170,11 @@ Esys_ChangePPS_Async(
     r = esys_GetResourceObject(esysContext, authHandle, &authHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "authHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_ChangePPS, shandle1,
+                              shandle2, shandle3, authHandleNode, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_ChangePPS_Prepare(esysContext->sys,
                                    (authHandleNode == NULL) ? TPM2_RH_NULL
@@ -176,6 +176,11 @@ Esys_ClockSet_Async(
     r = esys_GetResourceObject(esysContext, auth, &authNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "auth unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_ClockSet, shandle1, shandle2,
+                              shandle3, authNode, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_ClockSet_Prepare(esysContext->sys,
                                   (authNode == NULL) ? TPM2_RH_NULL
@@ -158,6 +158,11 @@ Esys_ContextLoad_Async(
     context = &tpmContext;
 
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_ContextLoad, ESYS_TR_NONE,
+                              ESYS_TR_NONE, ESYS_TR_NONE, NULL, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_ContextLoad_Prepare(esysContext->sys, context);
     return_state_if_error(r, _ESYS_STATE_INIT, "SAPI Prepare returned error.");
@@ -135,6 +135,12 @@ Esys_ContextSave_Async(
     r = esys_GetResourceObject(esysContext, saveHandle, &saveHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "saveHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_ContextSave, ESYS_TR_NONE,
+                              ESYS_TR_NONE, ESYS_TR_NONE, saveHandleNode, NULL,
+                              NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_ContextSave_Prepare(esysContext->sys,
                                      (saveHandleNode == NULL) ? TPM2_RH_NULL
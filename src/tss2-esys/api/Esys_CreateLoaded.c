@@ -197,6 +197,11 @@ Esys_CreateLoaded_Async(
     r = esys_GetResourceObject(esysContext, parentHandle, &parentHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "parentHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_CreateLoaded, shandle1,
+                              shandle2, shandle3, parentHandleNode, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_CreateLoaded_Prepare(esysContext->sys,
                                       (parentHandleNode == NULL) ? TPM2_RH_NULL
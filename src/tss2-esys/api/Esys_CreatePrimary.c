@@ -234,6 +234,12 @@ Esys_CreatePrimary_Async(
     r = esys_GetResourceObject(esysContext, primaryHandle, &primaryHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "primaryHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_CreatePrimary, shandle1,
+                              shandle2, shandle3, primaryHandleNode, NULL,
+                              NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_CreatePrimary_Prepare(esysContext->sys,
                                        (primaryHandleNode == NULL) ? TPM2_RH_NULL
@@ -272,23 +278,24 @@ Esys_CreatePrimary_Async(
     return r;
 }
 
-/** Asynchronous finish function for TPM2_CreatePrimary
+/** Asynchronous finish function for TPM2_CreatePrimary with caller-provided outputs
  *
  * This function returns the results of a TPM2_CreatePrimary command
- * invoked via Esys_CreatePrimary_Finish. All non-simple output parameters
- * are allocated by the function's implementation. NULL can be passed for every
- * output parameter if the value is not required.
+ * invoked via Esys_CreatePrimary_Async. Unlike Esys_CreatePrimary_Finish no
+ * memory is allocated for the output parameters; the response is unmarshaled
+ * directly into the storage provided by the caller. NULL can be passed for
+ * every output parameter if the value is not required.
  *
  * @param[in,out] esysContext The ESYS_CONTEXT.
  * @param[out] outPublic The public portion of the created object.
- *             (callee-allocated)
+ *             (caller-allocated)
  * @param[out] creationData Contains a TPMT_CREATION_DATA.
- *             (callee-allocated)
+ *             (caller-allocated)
  * @param[out] creationHash Digest of creationData using nameAlg of outPublic.
- *             (callee-allocated)
+ *             (caller-allocated)
  * @param[out] creationTicket Ticket used by TPM2_CertifyCreation() to validate
  *             that the creation data was produced by the TPM.
- *             (callee-allocated)
+ *             (caller-allocated)
  * @param[out] objectHandle  ESYS_TR handle of ESYS resource for TPM2_HANDLE.
  * @retval TSS2_RC_SUCCESS on success
  * @retval ESYS_RC_SUCCESS if the function call was a success.
@@ -296,7 +303,7 @@ Esys_CreatePrimary_Async(
  *         pointers or required output handle references are NULL.
  * @retval TSS2_ESYS_RC_BAD_CONTEXT: if esysContext corruption is detected.
  * @retval TSS2_ESYS_RC_MEMORY: if the ESAPI cannot allocate enough memory for
- *         internal operations or return parameters.
+ *         internal operations.
  * @retval TSS2_ESYS_RC_BAD_SEQUENCE: if the context has an asynchronous
  *         operation already pending.
  * @retval TSS2_ESYS_RC_TRY_AGAIN: if the timeout counter expires before the
@@ -310,14 +317,15 @@ Esys_CreatePrimary_Async(
  *         returned to the caller unaltered unless handled internally.
  */
 TSS2_RC
-Esys_CreatePrimary_Finish(
+Esys_CreatePrimary_FinishInto(
     ESYS_CONTEXT *esysContext, ESYS_TR *objectHandle,
-    TPM2B_PUBLIC **outPublic,
-    TPM2B_CREATION_DATA **creationData,
-    TPM2B_DIGEST **creationHash,
-    TPMT_TK_CREATION **creationTicket)
+    TPM2B_PUBLIC *outPublic,
+    TPM2B_CREATION_DATA *creationData,
+    TPM2B_DIGEST *creationHash,
+    TPMT_TK_CREATION *creationTicket)
 {
-    TPM2B_PUBLIC *loutPublic = NULL;
+    TPM2B_PUBLIC lPublic;
+    TPM2B_PUBLIC *loutPublic = (outPublic != NULL) ? outPublic : &lPublic;
     TSS2_RC r;
     LOG_TRACE("context=%p, objectHandle=%p, outPublic=%p,"
               "creationData=%p, creationHash=%p, creationTicket=%p",
@@ -338,13 +346,6 @@ Esys_CreatePrimary_Finish(
     TPM2B_NAME name;
     RSRC_NODE_T *objectHandleNode = NULL;
 
-    /* Initialize parameter to avoid unitialized usage */
-    if (creationHash != NULL)
-        *creationHash = NULL;
-    if (creationTicket != NULL)
-        *creationTicket = NULL;
-
-    /* Allocate memory for response parameters */
     if (objectHandle == NULL) {
         LOG_ERROR("Handle objectHandle may not be NULL");
         return TSS2_ESYS_RC_BAD_REFERENCE;
@@ -354,29 +355,6 @@ Esys_CreatePrimary_Finish(
     if (r != TSS2_RC_SUCCESS)
         return r;
 
-    loutPublic = calloc(sizeof(TPM2B_PUBLIC), 1);
-    if (loutPublic == NULL) {
-        goto_error(r, TSS2_ESYS_RC_MEMORY, "Out of memory", error_cleanup);
-    }
-    if (creationData != NULL) {
-        *creationData = calloc(sizeof(TPM2B_CREATION_DATA), 1);
-        if (*creationData == NULL) {
-            goto_error(r, TSS2_ESYS_RC_MEMORY, "Out of memory", error_cleanup);
-        }
-    }
-    if (creationHash != NULL) {
-        *creationHash = calloc(sizeof(TPM2B_DIGEST), 1);
-        if (*creationHash == NULL) {
-            goto_error(r, TSS2_ESYS_RC_MEMORY, "Out of memory", error_cleanup);
-        }
-    }
-    if (creationTicket != NULL) {
-        *creationTicket = calloc(sizeof(TPMT_TK_CREATION), 1);
-        if (*creationTicket == NULL) {
-            goto_error(r, TSS2_ESYS_RC_MEMORY, "Out of memory", error_cleanup);
-        }
-    }
-
     /*Receive the TPM response and handle resubmissions if necessary. */
     r = Tss2_Sys_ExecuteFinish(esysContext->sys, esysContext->timeout);
     if ((r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN) {
@@ -439,13 +417,8 @@ Esys_CreatePrimary_Finish(
      */
     r = Tss2_Sys_CreatePrimary_Complete(esysContext->sys,
                                         &objectHandleNode->rsrc.handle,
-                                        loutPublic,
-                                        (creationData != NULL) ? *creationData
-                                         : NULL,
-                                        (creationHash != NULL) ? *creationHash
-                                         : NULL,
-                                        (creationTicket != NULL)
-                                         ? *creationTicket : NULL, &name);
+                                        loutPublic, creationData,
+                                        creationHash, creationTicket, &name);
     goto_state_if_error(r, _ESYS_STATE_INTERNALERROR,
                         "Received error from SAPI unmarshaling" ,
                         error_cleanup);
@@ -466,10 +439,6 @@ Esys_CreatePrimary_Finish(
     objectHandleNode->rsrc.name = name;
     objectHandleNode->rsrc.rsrcType = IESYSC_KEY_RSRC;
     objectHandleNode->rsrc.misc.rsrc_key_pub = *loutPublic;
-    if (outPublic != NULL)
-        *outPublic = loutPublic;
-    else
-        SAFE_FREE(loutPublic);
 
     esysContext->state = _ESYS_STATE_INIT;
 
@@ -477,13 +446,112 @@ Esys_CreatePrimary_Finish(
 
 error_cleanup:
     Esys_TR_Close(esysContext, objectHandle);
-    SAFE_FREE(loutPublic);
+
+    return r;
+}
+
+/** Asynchronous finish function for TPM2_CreatePrimary
+ *
+ * This function returns the results of a TPM2_CreatePrimary command
+ * invoked via Esys_CreatePrimary_Finish. All non-simple output parameters
+ * are allocated by the function's implementation on success. NULL can be
+ * passed for every output parameter if the value is not required.
+ *
+ * @param[in,out] esysContext The ESYS_CONTEXT.
+ * @param[out] outPublic The public portion of the created object.
+ *             (callee-allocated)
+ * @param[out] creationData Contains a TPMT_CREATION_DATA.
+ *             (callee-allocated)
+ * @param[out] creationHash Digest of creationData using nameAlg of outPublic.
+ *             (callee-allocated)
+ * @param[out] creationTicket Ticket used by TPM2_CertifyCreation() to validate
+ *             that the creation data was produced by the TPM.
+ *             (callee-allocated)
+ * @param[out] objectHandle  ESYS_TR handle of ESYS resource for TPM2_HANDLE.
+ * @retval TSS2_RC_SUCCESS on success
+ * @retval ESYS_RC_SUCCESS if the function call was a success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or required input
+ *         pointers or required output handle references are NULL.
+ * @retval TSS2_ESYS_RC_BAD_CONTEXT: if esysContext corruption is detected.
+ * @retval TSS2_ESYS_RC_MEMORY: if the ESAPI cannot allocate enough memory for
+ *         internal operations or return parameters.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE: if the context has an asynchronous
+ *         operation already pending.
+ * @retval TSS2_ESYS_RC_TRY_AGAIN: if the timeout counter expires before the
+ *         TPM response is received.
+ * @retval TSS2_ESYS_RC_INSUFFICIENT_RESPONSE: if the TPM's response does not
+ *         at least contain the tag, response length, and response code.
+ * @retval TSS2_ESYS_RC_RSP_AUTH_FAILED: if the response HMAC from the TPM did
+ *         not verify.
+ * @retval TSS2_ESYS_RC_MALFORMED_RESPONSE: if the TPM's response is corrupted.
+ * @retval TSS2_RCs produced by lower layers of the software stack may be
+ *         returned to the caller unaltered unless handled internally.
+ */
+TSS2_RC
+Esys_CreatePrimary_Finish(
+    ESYS_CONTEXT *esysContext, ESYS_TR *objectHandle,
+    TPM2B_PUBLIC **outPublic,
+    TPM2B_CREATION_DATA **creationData,
+    TPM2B_DIGEST **creationHash,
+    TPMT_TK_CREATION **creationTicket)
+{
+    TPM2B_PUBLIC *loutPublic = NULL;
+    TPM2B_CREATION_DATA *lcreationData = NULL;
+    TPM2B_DIGEST *lcreationHash = NULL;
+    TPMT_TK_CREATION *lcreationTicket = NULL;
+    TSS2_RC r;
+
+    /* Allocate memory for response parameters. This is done before the
+       response is received, since a successful FinishInto has created the
+       object on the TPM and its ESYS_TR, which must not be lost to a failed
+       allocation afterwards. The outputs are only set on success. */
+    if (outPublic != NULL) {
+        loutPublic = calloc(sizeof(TPM2B_PUBLIC), 1);
+        if (loutPublic == NULL) {
+            goto_error(r, TSS2_ESYS_RC_MEMORY, "Out of memory", error_cleanup);
+        }
+    }
+    if (creationData != NULL) {
+        lcreationData = calloc(sizeof(TPM2B_CREATION_DATA), 1);
+        if (lcreationData == NULL) {
+            goto_error(r, TSS2_ESYS_RC_MEMORY, "Out of memory", error_cleanup);
+        }
+    }
+    if (creationHash != NULL) {
+        lcreationHash = calloc(sizeof(TPM2B_DIGEST), 1);
+        if (lcreationHash == NULL) {
+            goto_error(r, TSS2_ESYS_RC_MEMORY, "Out of memory", error_cleanup);
+        }
+    }
+    if (creationTicket != NULL) {
+        lcreationTicket = calloc(sizeof(TPMT_TK_CREATION), 1);
+        if (lcreationTicket == NULL) {
+            goto_error(r, TSS2_ESYS_RC_MEMORY, "Out of memory", error_cleanup);
+        }
+    }
+
+    r = Esys_CreatePrimary_FinishInto(esysContext, objectHandle, loutPublic,
+                                      lcreationData, lcreationHash,
+                                      lcreationTicket);
+    if (r != TSS2_RC_SUCCESS)
+        goto error_cleanup;
+
+    if (outPublic != NULL)
+        *outPublic = loutPublic;
     if (creationData != NULL)
-        SAFE_FREE(*creationData);
+        *creationData = lcreationData;
     if (creationHash != NULL)
-        SAFE_FREE(*creationHash);
+        *creationHash = lcreationHash;
     if (creationTicket != NULL)
-        SAFE_FREE(*creationTicket);
+        *creationTicket = lcreationTicket;
+
+    return TSS2_RC_SUCCESS;
+
+error_cleanup:
+    SAFE_FREE(loutPublic);
+    SAFE_FREE(lcreationData);
+    SAFE_FREE(lcreationHash);
+    SAFE_FREE(lcreationTicket);
 
     return r;
 }
@@ -170,6 +170,12 @@ Esys_DictionaryAttackLockReset_Async(
     r = esys_GetResourceObject(esysContext, lockHandle, &lockHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "lockHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_DictionaryAttackLockReset,
+                              shandle1, shandle2, shandle3, lockHandleNode,
+                              NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_DictionaryAttackLockReset_Prepare(esysContext->sys,
                                                    (lockHandleNode == NULL)
@@ -213,6 +213,12 @@ Esys_Duplicate_Async(
     r = esys_GetResourceObject(esysContext, newParentHandle, &newParentHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "newParentHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_Duplicate, shandle1,
+                              shandle2, shandle3, objectHandleNode,
+                              newParentHandleNode, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_Duplicate_Prepare(esysContext->sys,
                                    (objectHandleNode == NULL) ? TPM2_RH_NULL
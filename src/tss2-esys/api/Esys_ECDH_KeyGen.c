@@ -170,6 +170,11 @@ Esys_ECDH_KeyGen_Async(
     r = esys_GetResourceObject(esysContext, keyHandle, &keyHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "keyHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_ECDH_KeyGen, shandle1,
+                              shandle2, shandle3, keyHandleNode, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_ECDH_KeyGen_Prepare(esysContext->sys,
                                      (keyHandleNode == NULL) ? TPM2_RH_NULL
@@ -159,6 +159,11 @@ Esys_EC_Ephemeral_Async(
     return_state_if_error(r, _ESYS_STATE_INIT, "Check session usage");
     store_input_parameters(esysContext, curveID);
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_EC_Ephemeral, shandle1,
+                              shandle2, shandle3, NULL, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_EC_Ephemeral_Prepare(esysContext->sys, curveID);
     return_state_if_error(r, _ESYS_STATE_INIT, "SAPI Prepare returned error.");
@@ -204,6 +204,11 @@ Esys_EncryptDecrypt2_Async(
     r = esys_GetResourceObject(esysContext, keyHandle, &keyHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "keyHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_EncryptDecrypt2, shandle1,
+                              shandle2, shandle3, keyHandleNode, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_EncryptDecrypt2_Prepare(esysContext->sys,
                                          (keyHandleNode == NULL) ? TPM2_RH_NULL
@@ -189,6 +189,12 @@ Esys_EventSequenceComplete_Async(
     r = esys_GetResourceObject(esysContext, sequenceHandle, &sequenceHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "sequenceHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_EventSequenceComplete,
+                              shandle1, shandle2, shandle3, pcrHandleNode,
+                              sequenceHandleNode, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_EventSequenceComplete_Prepare(esysContext->sys,
                                                (pcrHandleNode == NULL)
@@ -194,6 +194,12 @@ Esys_EvictControl_Async(
         persistentHandle = objectHandleNode->rsrc.handle;
     }
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_EvictControl, shandle1,
+                              shandle2, shandle3, authNode, objectHandleNode,
+                              NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_EvictControl_Prepare(esysContext->sys,
                                       (authNode == NULL) ? TPM2_RH_NULL
@@ -367,6 +373,8 @@ Esys_EvictControl_Finish(
     /* The object was already persistent */
     if (iesys_get_handle_type(objectHandleNode->rsrc.handle) == TPM2_HT_PERSISTENT) {
         *newObjectHandle = ESYS_TR_NONE;
+        /* The persistent object was evicted */
+        iesys_metadata_cache_invalidate(esysContext, objectHandle);
     } else {
         /* A new resource is created and updated with date from the not persistent object */
         RSRC_NODE_T *newObjectHandleNode = NULL;
@@ -165,6 +165,11 @@ Esys_FieldUpgradeData_Async(
     return_state_if_error(r, _ESYS_STATE_INIT, "Check session usage");
     store_input_parameters(esysContext, fuData);
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_FieldUpgradeData, shandle1,
+                              shandle2, shandle3, NULL, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_FieldUpgradeData_Prepare(esysContext->sys, fuData);
     return_state_if_error(r, _ESYS_STATE_INIT, "SAPI Prepare returned error.");
@@ -327,6 +332,9 @@ Esys_FieldUpgradeData_Finish(
                         "Received error from SAPI unmarshaling" ,
                         error_cleanup);
 
+    /* The firmware may have changed */
+    iesys_capability_cache_invalidate(esysContext);
+
     esysContext->state = _ESYS_STATE_INIT;
 
     return TSS2_RC_SUCCESS;
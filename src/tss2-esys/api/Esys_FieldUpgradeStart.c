@@ -206,6 +206,12 @@ Esys_FieldUpgradeStart_Async(
     r = esys_GetResourceObject(esysContext, keyHandle, &keyHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "keyHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_FieldUpgradeStart, shandle1,
+                              shandle2, shandle3, authorizationNode,
+                              keyHandleNode, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_FieldUpgradeStart_Prepare(esysContext->sys,
                                            (authorizationNode == NULL)
@@ -355,6 +361,9 @@ Esys_FieldUpgradeStart_Finish(
     return_state_if_error(r, _ESYS_STATE_INTERNALERROR,
                           "Received error from SAPI unmarshaling" );
 
+    /* The firmware may have changed */
+    iesys_capability_cache_invalidate(esysContext);
+
     esysContext->state = _ESYS_STATE_INIT;
 
     return TSS2_RC_SUCCESS;
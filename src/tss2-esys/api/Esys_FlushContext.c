@@ -131,6 +131,28 @@ Esys_FlushContext_Async(
     /* Retrieve the metadata objects for provided handles */
     r = esys_GetResourceObject(esysContext, flushHandle, &flushHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "flushHandle unknown.");
+    r = iesys_check_session_owner(esysContext, flushHandle);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Check session owner.");
+
+    /* A swapped out object only exists as its saved context, which the
+       _Finish call frees without a TPM command. A saved session keeps its
+       handle and is flushed without being loaded again. */
+    esysContext->swap.drop = false;
+    if (flushHandleNode != NULL && flushHandleNode->swapped != NULL &&
+        flushHandleNode->rsrc.rsrcType != IESYSC_SESSION_RSRC) {
+        LOG_DEBUG("Dropping swapped out object");
+        esysContext->swap.drop = true;
+        esysContext->state = _ESYS_STATE_SENT;
+        return TSS2_RC_SUCCESS;
+    }
+
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_FlushContext, ESYS_TR_NONE,
+                              ESYS_TR_NONE, ESYS_TR_NONE,
+                              (flushHandleNode != NULL &&
+                               flushHandleNode->swapped != NULL) ? NULL
+                               : flushHandleNode, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
 
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_FlushContext_Prepare(esysContext->sys,
@@ -194,6 +216,11 @@ Esys_FlushContext_Finish(
     }
     esysContext->state = _ESYS_STATE_INTERNALERROR;
 
+    if (esysContext->swap.drop) {
+        esysContext->swap.drop = false;
+        goto invalidate;
+    }
+
     /*Receive the TPM response and handle resubmissions if necessary. */
     r = Tss2_Sys_ExecuteFinish(esysContext->sys, esysContext->timeout);
     if ((r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN) {
@@ -238,6 +265,7 @@ Esys_FlushContext_Finish(
     return_state_if_error(r, _ESYS_STATE_INTERNALERROR,
                           "Received error from SAPI unmarshaling" );
 
+invalidate:
     /* The ESYS_TR object has to be invalidated */
     r = Esys_TR_Close(esysContext, &esysContext->in.FlushContext.flushHandle);
     return_if_error(r, "invalidate object");
@@ -182,6 +182,23 @@ Esys_GetCapability_Async(
     return_state_if_error(r, _ESYS_STATE_INIT, "Check session usage");
     store_input_parameters(esysContext, capability, property, propertyCount);
 
+    /* Without sessions the response may be taken from the capability cache */
+    if (shandle1 == ESYS_TR_NONE && shandle2 == ESYS_TR_NONE &&
+        shandle3 == ESYS_TR_NONE) {
+        esysContext->capability_cache.hit =
+            iesys_capability_cache_get(esysContext, capability, property,
+                                       propertyCount);
+        if (esysContext->capability_cache.hit != NULL) {
+            esysContext->state = _ESYS_STATE_SENT;
+            return TSS2_RC_SUCCESS;
+        }
+    }
+
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_GetCapability, shandle1,
+                              shandle2, shandle3, NULL, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_GetCapability_Prepare(esysContext->sys, capability, property,
                                        propertyCount);
@@ -274,6 +291,17 @@ Esys_GetCapability_Finish(
         }
     }
 
+    /* The response was taken from the capability cache */
+    if (esysContext->capability_cache.hit != NULL) {
+        if (moreData != NULL)
+            *moreData = esysContext->capability_cache.hit->moreData;
+        if (capabilityData != NULL)
+            **capabilityData = esysContext->capability_cache.hit->data;
+        esysContext->capability_cache.hit = NULL;
+        esysContext->state = _ESYS_STATE_INIT;
+        return TSS2_RC_SUCCESS;
+    }
+
     /*Receive the TPM response and handle resubmissions if necessary. */
     r = Tss2_Sys_ExecuteFinish(esysContext->sys, esysContext->timeout);
     if ((r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN) {
@@ -338,6 +366,20 @@ Esys_GetCapability_Finish(
                         "Received error from SAPI unmarshaling" ,
                         error_cleanup);
 
+    /* Only responses to commands without sessions are cached */
+    if (esysContext->session_type[0] == ESYS_TR_NONE &&
+        esysContext->session_type[1] == ESYS_TR_NONE &&
+        esysContext->session_type[2] == ESYS_TR_NONE &&
+        moreData != NULL && capabilityData != NULL) {
+        r = iesys_capability_cache_put(esysContext,
+                                       esysContext->in.GetCapability.capability,
+                                       esysContext->in.GetCapability.property,
+                                       esysContext->in.GetCapability.propertyCount,
+                                       *moreData, *capabilityData);
+        if (r != TSS2_RC_SUCCESS)
+            LOG_WARNING("Capability not cached");
+    }
+
     esysContext->state = _ESYS_STATE_INIT;
 
     return TSS2_RC_SUCCESS;
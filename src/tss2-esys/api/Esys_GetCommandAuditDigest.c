@@ -206,6 +206,12 @@ Esys_GetCommandAuditDigest_Async(
     r = esys_GetResourceObject(esysContext, signHandle, &signHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "signHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_GetCommandAuditDigest,
+                              shandle1, shandle2, shandle3, privacyHandleNode,
+                              signHandleNode, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_GetCommandAuditDigest_Prepare(esysContext->sys,
                                                (privacyHandleNode == NULL)
@@ -157,6 +157,11 @@ Esys_GetRandom_Async(
     return_state_if_error(r, _ESYS_STATE_INIT, "Check session usage");
     store_input_parameters(esysContext, bytesRequested);
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_GetRandom, shandle1,
+                              shandle2, shandle3, NULL, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_GetRandom_Prepare(esysContext->sys, bytesRequested);
     return_state_if_error(r, _ESYS_STATE_INIT, "SAPI Prepare returned error.");
@@ -187,23 +192,24 @@ Esys_GetRandom_Async(
     return r;
 }
 
-/** Asynchronous finish function for TPM2_GetRandom
+/** Asynchronous finish function for TPM2_GetRandom with caller-provided outputs
  *
  * This function returns the results of a TPM2_GetRandom command
- * invoked via Esys_GetRandom_Finish. All non-simple output parameters
- * are allocated by the function's implementation. NULL can be passed for every
- * output parameter if the value is not required.
+ * invoked via Esys_GetRandom_Async. Unlike Esys_GetRandom_Finish no
+ * memory is allocated for the output parameters; the response is unmarshaled
+ * directly into the storage provided by the caller. NULL can be passed for
+ * every output parameter if the value is not required.
  *
  * @param[in,out] esysContext The ESYS_CONTEXT.
  * @param[out] randomBytes The random octets.
- *             (callee-allocated)
+ *             (caller-allocated)
  * @retval TSS2_RC_SUCCESS on success
  * @retval ESYS_RC_SUCCESS if the function call was a success.
  * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or required input
  *         pointers or required output handle references are NULL.
  * @retval TSS2_ESYS_RC_BAD_CONTEXT: if esysContext corruption is detected.
  * @retval TSS2_ESYS_RC_MEMORY: if the ESAPI cannot allocate enough memory for
- *         internal operations or return parameters.
+ *         internal operations.
  * @retval TSS2_ESYS_RC_BAD_SEQUENCE: if the context has an asynchronous
  *         operation already pending.
  * @retval TSS2_ESYS_RC_TRY_AGAIN: if the timeout counter expires before the
@@ -217,9 +223,9 @@ Esys_GetRandom_Async(
  *         returned to the caller unaltered unless handled internally.
  */
 TSS2_RC
-Esys_GetRandom_Finish(
+Esys_GetRandom_FinishInto(
     ESYS_CONTEXT *esysContext,
-    TPM2B_DIGEST **randomBytes)
+    TPM2B_DIGEST *randomBytes)
 {
     TSS2_RC r;
     LOG_TRACE("context=%p, randomBytes=%p",
@@ -237,14 +243,6 @@ Esys_GetRandom_Finish(
     }
     esysContext->state = _ESYS_STATE_INTERNALERROR;
 
-    /* Allocate memory for response parameters */
-    if (randomBytes != NULL) {
-        *randomBytes = calloc(sizeof(TPM2B_DIGEST), 1);
-        if (*randomBytes == NULL) {
-            return_error(TSS2_ESYS_RC_MEMORY, "Out of memory");
-        }
-    }
-
     /*Receive the TPM response and handle resubmissions if necessary. */
     r = Tss2_Sys_ExecuteFinish(esysContext->sys, esysContext->timeout);
     if ((r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN) {
@@ -300,9 +298,7 @@ Esys_GetRandom_Finish(
      * After the verification of the response we call the complete function
      * to deliver the result.
      */
-    r = Tss2_Sys_GetRandom_Complete(esysContext->sys,
-                                    (randomBytes != NULL) ? *randomBytes
-                                     : NULL);
+    r = Tss2_Sys_GetRandom_Complete(esysContext->sys, randomBytes);
     goto_state_if_error(r, _ESYS_STATE_INTERNALERROR,
                         "Received error from SAPI unmarshaling" ,
                         error_cleanup);
@@ -312,8 +308,61 @@ Esys_GetRandom_Finish(
     return TSS2_RC_SUCCESS;
 
 error_cleanup:
-    if (randomBytes != NULL)
-        SAFE_FREE(*randomBytes);
-
     return r;
 }
+
+/** Asynchronous finish function for TPM2_GetRandom
+ *
+ * This function returns the results of a TPM2_GetRandom command
+ * invoked via Esys_GetRandom_Finish. All non-simple output parameters
+ * are allocated by the function's implementation on success. NULL can be
+ * passed for every output parameter if the value is not required.
+ *
+ * @param[in,out] esysContext The ESYS_CONTEXT.
+ * @param[out] randomBytes The random octets.
+ *             (callee-allocated)
+ * @retval TSS2_RC_SUCCESS on success
+ * @retval ESYS_RC_SUCCESS if the function call was a success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or required input
+ *         pointers or required output handle references are NULL.
+ * @retval TSS2_ESYS_RC_BAD_CONTEXT: if esysContext corruption is detected.
+ * @retval TSS2_ESYS_RC_MEMORY: if the ESAPI cannot allocate enough memory for
+ *         internal operations or return parameters.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE: if the context has an asynchronous
+ *         operation already pending.
+ * @retval TSS2_ESYS_RC_TRY_AGAIN: if the timeout counter expires before the
+ *         TPM response is received.
+ * @retval TSS2_ESYS_RC_INSUFFICIENT_RESPONSE: if the TPM's response does not
+ *         at least contain the tag, response length, and response code.
+ * @retval TSS2_ESYS_RC_RSP_AUTH_FAILED: if the response HMAC from the TPM did
+ *         not verify.
+ * @retval TSS2_ESYS_RC_MALFORMED_RESPONSE: if the TPM's response is corrupted.
+ * @retval TSS2_RCs produced by lower layers of the software stack may be
+ *         returned to the caller unaltered unless handled internally.
+ */
+TSS2_RC
+Esys_GetRandom_Finish(
+    ESYS_CONTEXT *esysContext,
+    TPM2B_DIGEST **randomBytes)
+{
+    TPM2B_DIGEST lrandomBytes;
+    TSS2_RC r;
+
+    /* The response is received into local storage, so polling with
+       TRY_AGAIN does not allocate and errors leave *randomBytes unchanged. */
+    r = Esys_GetRandom_FinishInto(esysContext,
+                                  (randomBytes != NULL) ? &lrandomBytes : NULL);
+    if (r != TSS2_RC_SUCCESS)
+        return r;
+
+    /* Allocate memory for response parameters */
+    if (randomBytes != NULL) {
+        *randomBytes = calloc(sizeof(TPM2B_DIGEST), 1);
+        if (*randomBytes == NULL) {
+            return_error(TSS2_ESYS_RC_MEMORY, "Out of memory");
+        }
+        **randomBytes = lrandomBytes;
+    }
+
+    return TSS2_RC_SUCCESS;
+}
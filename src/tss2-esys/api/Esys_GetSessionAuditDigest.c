@@ -218,6 +218,13 @@ Esys_GetSessionAuditDigest_Async(
     r = esys_GetResourceObject(esysContext, sessionHandle, &sessionHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "sessionHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_GetSessionAuditDigest,
+                              shandle1, shandle2, shandle3,
+                              privacyAdminHandleNode, signHandleNode,
+                              sessionHandleNode);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_GetSessionAuditDigest_Prepare(esysContext->sys,
                                                (privacyAdminHandleNode == NULL)
@@ -193,6 +193,11 @@ Esys_MakeCredential_Async(
     r = esys_GetResourceObject(esysContext, handle, &handleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "handle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_MakeCredential, shandle1,
+                              shandle2, shandle3, handleNode, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_MakeCredential_Prepare(esysContext->sys,
                                         (handleNode == NULL) ? TPM2_RH_NULL
@@ -231,6 +231,12 @@ Esys_NV_Certify_Async(
     r = esys_GetResourceObject(esysContext, nvIndex, &nvIndexNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "nvIndex unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_NV_Certify, shandle1,
+                              shandle2, shandle3, signHandleNode,
+                              authHandleNode, nvIndexNode);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_NV_Certify_Prepare(esysContext->sys,
                                     (signHandleNode == NULL) ? TPM2_RH_NULL
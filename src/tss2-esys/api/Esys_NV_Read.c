@@ -191,6 +191,11 @@ Esys_NV_Read_Async(
     r = esys_GetResourceObject(esysContext, nvIndex, &nvIndexNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "nvIndex unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_NV_Read, shandle1, shandle2,
+                              shandle3, authHandleNode, nvIndexNode, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_NV_Read_Prepare(esysContext->sys,
                                  (authHandleNode == NULL) ? TPM2_RH_NULL
@@ -228,23 +233,24 @@ Esys_NV_Read_Async(
     return r;
 }
 
-/** Asynchronous finish function for TPM2_NV_Read
+/** Asynchronous finish function for TPM2_NV_Read with caller-provided outputs
  *
  * This function returns the results of a TPM2_NV_Read command
- * invoked via Esys_NV_Read_Finish. All non-simple output parameters
- * are allocated by the function's implementation. NULL can be passed for every
- * output parameter if the value is not required.
+ * invoked via Esys_NV_Read_Async. Unlike Esys_NV_Read_Finish no
+ * memory is allocated for the output parameters; the response is unmarshaled
+ * directly into the storage provided by the caller. NULL can be passed for
+ * every output parameter if the value is not required.
  *
  * @param[in,out] esysContext The ESYS_CONTEXT.
  * @param[out] data The data read.
- *             (callee-allocated)
+ *             (caller-allocated)
  * @retval TSS2_RC_SUCCESS on success
  * @retval ESYS_RC_SUCCESS if the function call was a success.
  * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or required input
  *         pointers or required output handle references are NULL.
  * @retval TSS2_ESYS_RC_BAD_CONTEXT: if esysContext corruption is detected.
  * @retval TSS2_ESYS_RC_MEMORY: if the ESAPI cannot allocate enough memory for
- *         internal operations or return parameters.
+ *         internal operations.
  * @retval TSS2_ESYS_RC_BAD_SEQUENCE: if the context has an asynchronous
  *         operation already pending.
  * @retval TSS2_ESYS_RC_TRY_AGAIN: if the timeout counter expires before the
@@ -258,9 +264,9 @@ Esys_NV_Read_Async(
  *         returned to the caller unaltered unless handled internally.
  */
 TSS2_RC
-Esys_NV_Read_Finish(
+Esys_NV_Read_FinishInto(
     ESYS_CONTEXT *esysContext,
-    TPM2B_MAX_NV_BUFFER **data)
+    TPM2B_MAX_NV_BUFFER *data)
 {
     TSS2_RC r;
     LOG_TRACE("context=%p, data=%p",
@@ -278,14 +284,6 @@ Esys_NV_Read_Finish(
     }
     esysContext->state = _ESYS_STATE_INTERNALERROR;
 
-    /* Allocate memory for response parameters */
-    if (data != NULL) {
-        *data = calloc(sizeof(TPM2B_MAX_NV_BUFFER), 1);
-        if (*data == NULL) {
-            return_error(TSS2_ESYS_RC_MEMORY, "Out of memory");
-        }
-    }
-
     /*Receive the TPM response and handle resubmissions if necessary. */
     r = Tss2_Sys_ExecuteFinish(esysContext->sys, esysContext->timeout);
     if ((r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN) {
@@ -344,8 +342,7 @@ Esys_NV_Read_Finish(
      * After the verification of the response we call the complete function
      * to deliver the result.
      */
-    r = Tss2_Sys_NV_Read_Complete(esysContext->sys,
-                                  (data != NULL) ? *data : NULL);
+    r = Tss2_Sys_NV_Read_Complete(esysContext->sys, data);
     goto_state_if_error(r, _ESYS_STATE_INTERNALERROR,
                         "Received error from SAPI unmarshaling" ,
                         error_cleanup);
@@ -355,8 +352,61 @@ Esys_NV_Read_Finish(
     return TSS2_RC_SUCCESS;
 
 error_cleanup:
-    if (data != NULL)
-        SAFE_FREE(*data);
-
     return r;
 }
+
+/** Asynchronous finish function for TPM2_NV_Read
+ *
+ * This function returns the results of a TPM2_NV_Read command
+ * invoked via Esys_NV_Read_Finish. All non-simple output parameters
+ * are allocated by the function's implementation on success. NULL can be
+ * passed for every output parameter if the value is not required.
+ *
+ * @param[in,out] esysContext The ESYS_CONTEXT.
+ * @param[out] data The data read.
+ *             (callee-allocated)
+ * @retval TSS2_RC_SUCCESS on success
+ * @retval ESYS_RC_SUCCESS if the function call was a success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or required input
+ *         pointers or required output handle references are NULL.
+ * @retval TSS2_ESYS_RC_BAD_CONTEXT: if esysContext corruption is detected.
+ * @retval TSS2_ESYS_RC_MEMORY: if the ESAPI cannot allocate enough memory for
+ *         internal operations or return parameters.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE: if the context has an asynchronous
+ *         operation already pending.
+ * @retval TSS2_ESYS_RC_TRY_AGAIN: if the timeout counter expires before the
+ *         TPM response is received.
+ * @retval TSS2_ESYS_RC_INSUFFICIENT_RESPONSE: if the TPM's response does not
+ *         at least contain the tag, response length, and response code.
+ * @retval TSS2_ESYS_RC_RSP_AUTH_FAILED: if the response HMAC from the TPM did
+ *         not verify.
+ * @retval TSS2_ESYS_RC_MALFORMED_RESPONSE: if the TPM's response is corrupted.
+ * @retval TSS2_RCs produced by lower layers of the software stack may be
+ *         returned to the caller unaltered unless handled internally.
+ */
+TSS2_RC
+Esys_NV_Read_Finish(
+    ESYS_CONTEXT *esysContext,
+    TPM2B_MAX_NV_BUFFER **data)
+{
+    TPM2B_MAX_NV_BUFFER ldata;
+    TSS2_RC r;
+
+    /* The response is received into local storage, so polling with
+       TRY_AGAIN does not allocate and errors leave *data unchanged. */
+    r = Esys_NV_Read_FinishInto(esysContext,
+                                (data != NULL) ? &ldata : NULL);
+    if (r != TSS2_RC_SUCCESS)
+        return r;
+
+    /* Allocate memory for response parameters */
+    if (data != NULL) {
+        *data = calloc(sizeof(TPM2B_MAX_NV_BUFFER), 1);
+        if (*data == NULL) {
+            return_error(TSS2_ESYS_RC_MEMORY, "Out of memory");
+        }
+        **data = ldata;
+    }
+
+    return TSS2_RC_SUCCESS;
+}
@@ -179,6 +179,12 @@ Esys_NV_UndefineSpace_Async(
     r = esys_GetResourceObject(esysContext, nvIndex, &nvIndexNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "nvIndex unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_NV_UndefineSpace, shandle1,
+                              shandle2, shandle3, authHandleNode, nvIndexNode,
+                              NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_NV_UndefineSpace_Prepare(esysContext->sys,
                                           (authHandleNode == NULL) ? TPM2_RH_NULL
@@ -324,6 +330,10 @@ Esys_NV_UndefineSpace_Finish(
     return_state_if_error(r, _ESYS_STATE_INTERNALERROR,
                           "Received error from SAPI unmarshaling" );
 
+    /* The NV index is neither cached nor known to the ESYS_CONTEXT anymore */
+    iesys_metadata_cache_invalidate(esysContext,
+                                    esysContext->in.NV_UndefineSpace.nvIndex);
+
     /* The ESYS_TR object (nvIndex) has to be invalidated */
     r = Esys_TR_Close(esysContext, &esysContext->in.NV_UndefineSpace.nvIndex);
     return_if_error(r, "invalidate object");
@@ -179,6 +179,12 @@ Esys_NV_UndefineSpaceSpecial_Async(
     r = esys_GetResourceObject(esysContext, platform, &platformNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "platform unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_NV_UndefineSpaceSpecial,
+                              shandle1, shandle2, shandle3, nvIndexNode,
+                              platformNode, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_NV_UndefineSpaceSpecial_Prepare(esysContext->sys,
                                                  (nvIndexNode == NULL)
@@ -331,6 +337,11 @@ Esys_NV_UndefineSpaceSpecial_Finish(
     }
 
     session->rsrc.misc.rsrc_session.sizeHmacValue -= nvIndexNode->auth.size;
+    iesys_invalidate_session_hmac(session);
+
+    /* The NV index is not cached anymore. This has to happen before the
+       ESYS_TR is closed, since the TPM handle is taken from it. */
+    iesys_metadata_cache_invalidate(esysContext, nvIndex);
 
     /* The ESYS_TR object (nvIndex) has to be invalidated */
     r = Esys_TR_Close(esysContext,
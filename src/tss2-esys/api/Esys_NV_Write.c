@@ -194,6 +194,11 @@ Esys_NV_Write_Async(
     r = esys_GetResourceObject(esysContext, nvIndex, &nvIndexNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "nvIndex unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_NV_Write, shandle1, shandle2,
+                              shandle3, authHandleNode, nvIndexNode, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_NV_Write_Prepare(esysContext->sys,
                                   (authHandleNode == NULL) ? TPM2_RH_NULL
@@ -177,6 +177,11 @@ Esys_PCR_Read_Async(
     return_state_if_error(r, _ESYS_STATE_INIT, "Check session usage");
     store_input_parameters(esysContext, pcrSelectionIn);
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_PCR_Read, shandle1, shandle2,
+                              shandle3, NULL, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_PCR_Read_Prepare(esysContext->sys, pcrSelectionIn);
     return_state_if_error(r, _ESYS_STATE_INIT, "SAPI Prepare returned error.");
@@ -207,28 +212,29 @@ Esys_PCR_Read_Async(
     return r;
 }
 
-/** Asynchronous finish function for TPM2_PCR_Read
+/** Asynchronous finish function for TPM2_PCR_Read with caller-provided outputs
  *
  * This function returns the results of a TPM2_PCR_Read command
- * invoked via Esys_PCR_Read_Finish. All non-simple output parameters
- * are allocated by the function's implementation. NULL can be passed for every
- * output parameter if the value is not required.
+ * invoked via Esys_PCR_Read_Async. Unlike Esys_PCR_Read_Finish no
+ * memory is allocated for the output parameters; the response is unmarshaled
+ * directly into the storage provided by the caller. NULL can be passed for
+ * every output parameter if the value is not required.
  *
  * @param[in,out] esysContext The ESYS_CONTEXT.
  * @param[out] pcrUpdateCounter The current value of the PCR update counter.
- *             (callee-allocated)
+ *             (caller-allocated)
  * @param[out] pcrSelectionOut The PCR in the returned list.
- *             (callee-allocated)
+ *             (caller-allocated)
  * @param[out] pcrValues The contents of the PCR indicated in pcrSelectOut->
  *             pcrSelection[] as tagged digests.
- *             (callee-allocated)
+ *             (caller-allocated)
  * @retval TSS2_RC_SUCCESS on success
  * @retval ESYS_RC_SUCCESS if the function call was a success.
  * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or required input
  *         pointers or required output handle references are NULL.
  * @retval TSS2_ESYS_RC_BAD_CONTEXT: if esysContext corruption is detected.
  * @retval TSS2_ESYS_RC_MEMORY: if the ESAPI cannot allocate enough memory for
- *         internal operations or return parameters.
+ *         internal operations.
  * @retval TSS2_ESYS_RC_BAD_SEQUENCE: if the context has an asynchronous
  *         operation already pending.
  * @retval TSS2_ESYS_RC_TRY_AGAIN: if the timeout counter expires before the
@@ -242,11 +248,11 @@ Esys_PCR_Read_Async(
  *         returned to the caller unaltered unless handled internally.
  */
 TSS2_RC
-Esys_PCR_Read_Finish(
+Esys_PCR_Read_FinishInto(
     ESYS_CONTEXT *esysContext,
     UINT32 *pcrUpdateCounter,
-    TPML_PCR_SELECTION **pcrSelectionOut,
-    TPML_DIGEST **pcrValues)
+    TPML_PCR_SELECTION *pcrSelectionOut,
+    TPML_DIGEST *pcrValues)
 {
     TSS2_RC r;
     LOG_TRACE("context=%p, pcrUpdateCounter=%p, pcrSelectionOut=%p,"
@@ -266,20 +272,6 @@ Esys_PCR_Read_Finish(
     }
     esysContext->state = _ESYS_STATE_INTERNALERROR;
 
-    /* Allocate memory for response parameters */
-    if (pcrSelectionOut != NULL) {
-        *pcrSelectionOut = calloc(sizeof(TPML_PCR_SELECTION), 1);
-        if (*pcrSelectionOut == NULL) {
-            return_error(TSS2_ESYS_RC_MEMORY, "Out of memory");
-        }
-    }
-    if (pcrValues != NULL) {
-        *pcrValues = calloc(sizeof(TPML_DIGEST), 1);
-        if (*pcrValues == NULL) {
-            goto_error(r, TSS2_ESYS_RC_MEMORY, "Out of memory", error_cleanup);
-        }
-    }
-
     /*Receive the TPM response and handle resubmissions if necessary. */
     r = Tss2_Sys_ExecuteFinish(esysContext->sys, esysContext->timeout);
     if ((r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN) {
@@ -336,9 +328,7 @@ Esys_PCR_Read_Finish(
      * to deliver the result.
      */
     r = Tss2_Sys_PCR_Read_Complete(esysContext->sys, pcrUpdateCounter,
-                                   (pcrSelectionOut != NULL) ? *pcrSelectionOut
-                                    : NULL,
-                                   (pcrValues != NULL) ? *pcrValues : NULL);
+                                   pcrSelectionOut, pcrValues);
     goto_state_if_error(r, _ESYS_STATE_INTERNALERROR,
                         "Received error from SAPI unmarshaling" ,
                         error_cleanup);
@@ -347,11 +337,85 @@ Esys_PCR_Read_Finish(
 
     return TSS2_RC_SUCCESS;
 
+error_cleanup:
+    return r;
+}
+
+/** Asynchronous finish function for TPM2_PCR_Read
+ *
+ * This function returns the results of a TPM2_PCR_Read command
+ * invoked via Esys_PCR_Read_Finish. All non-simple output parameters
+ * are allocated by the function's implementation on success. NULL can be
+ * passed for every output parameter if the value is not required.
+ *
+ * @param[in,out] esysContext The ESYS_CONTEXT.
+ * @param[out] pcrUpdateCounter The current value of the PCR update counter.
+ *             (callee-allocated)
+ * @param[out] pcrSelectionOut The PCR in the returned list.
+ *             (callee-allocated)
+ * @param[out] pcrValues The contents of the PCR indicated in pcrSelectOut->
+ *             pcrSelection[] as tagged digests.
+ *             (callee-allocated)
+ * @retval TSS2_RC_SUCCESS on success
+ * @retval ESYS_RC_SUCCESS if the function call was a success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or required input
+ *         pointers or required output handle references are NULL.
+ * @retval TSS2_ESYS_RC_BAD_CONTEXT: if esysContext corruption is detected.
+ * @retval TSS2_ESYS_RC_MEMORY: if the ESAPI cannot allocate enough memory for
+ *         internal operations or return parameters.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE: if the context has an asynchronous
+ *         operation already pending.
+ * @retval TSS2_ESYS_RC_TRY_AGAIN: if the timeout counter expires before the
+ *         TPM response is received.
+ * @retval TSS2_ESYS_RC_INSUFFICIENT_RESPONSE: if the TPM's response does not
+ *         at least contain the tag, response length, and response code.
+ * @retval TSS2_ESYS_RC_RSP_AUTH_FAILED: if the response HMAC from the TPM did
+ *         not verify.
+ * @retval TSS2_ESYS_RC_MALFORMED_RESPONSE: if the TPM's response is corrupted.
+ * @retval TSS2_RCs produced by lower layers of the software stack may be
+ *         returned to the caller unaltered unless handled internally.
+ */
+TSS2_RC
+Esys_PCR_Read_Finish(
+    ESYS_CONTEXT *esysContext,
+    UINT32 *pcrUpdateCounter,
+    TPML_PCR_SELECTION **pcrSelectionOut,
+    TPML_DIGEST **pcrValues)
+{
+    TPML_PCR_SELECTION lpcrSelectionOut;
+    TPML_DIGEST lpcrValues;
+    TSS2_RC r;
+
+    /* The response is received into local storage, so polling with
+       TRY_AGAIN does not allocate and errors leave the outputs unchanged. */
+    r = Esys_PCR_Read_FinishInto(esysContext, pcrUpdateCounter,
+                                 (pcrSelectionOut != NULL) ? &lpcrSelectionOut
+                                  : NULL,
+                                 (pcrValues != NULL) ? &lpcrValues : NULL);
+    if (r != TSS2_RC_SUCCESS)
+        return r;
+
+    /* Allocate memory for response parameters */
+    if (pcrSelectionOut != NULL) {
+        *pcrSelectionOut = calloc(sizeof(TPML_PCR_SELECTION), 1);
+        if (*pcrSelectionOut == NULL) {
+            return_error(TSS2_ESYS_RC_MEMORY, "Out of memory");
+        }
+        **pcrSelectionOut = lpcrSelectionOut;
+    }
+    if (pcrValues != NULL) {
+        *pcrValues = calloc(sizeof(TPML_DIGEST), 1);
+        if (*pcrValues == NULL) {
+            goto_error(r, TSS2_ESYS_RC_MEMORY, "Out of memory", error_cleanup);
+        }
+        **pcrValues = lpcrValues;
+    }
+
+    return TSS2_RC_SUCCESS;
+
 error_cleanup:
     if (pcrSelectionOut != NULL)
         SAFE_FREE(*pcrSelectionOut);
-    if (pcrValues != NULL)
-        SAFE_FREE(*pcrValues);
 
     return r;
 }
@@ -171,6 +171,11 @@ Esys_PCR_Reset_Async(
     r = esys_GetResourceObject(esysContext, pcrHandle, &pcrHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "pcrHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_PCR_Reset, shandle1,
+                              shandle2, shandle3, pcrHandleNode, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_PCR_Reset_Prepare(esysContext->sys,
                                    (pcrHandleNode == NULL) ? TPM2_RH_NULL
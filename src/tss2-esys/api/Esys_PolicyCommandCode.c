@@ -177,6 +177,12 @@ Esys_PolicyCommandCode_Async(
     r = esys_GetResourceObject(esysContext, policySession, &policySessionNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "policySession unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_PolicyCommandCode, shandle1,
+                              shandle2, shandle3, policySessionNode, NULL,
+                              NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_PolicyCommandCode_Prepare(esysContext->sys,
                                            (policySessionNode == NULL)
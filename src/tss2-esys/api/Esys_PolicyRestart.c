@@ -171,6 +171,12 @@ Esys_PolicyRestart_Async(
     r = esys_GetResourceObject(esysContext, sessionHandle, &sessionHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "sessionHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_PolicyRestart, shandle1,
+                              shandle2, shandle3, sessionHandleNode, NULL,
+                              NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_PolicyRestart_Prepare(esysContext->sys,
                                        (sessionHandleNode == NULL) ? TPM2_RH_NULL
@@ -230,6 +230,12 @@ Esys_PolicySecret_Async(
     r = esys_GetResourceObject(esysContext, policySession, &policySessionNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "policySession unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_PolicySecret, shandle1,
+                              shandle2, shandle3, authHandleNode,
+                              policySessionNode, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_PolicySecret_Prepare(esysContext->sys,
                                       (authHandleNode == NULL) ? TPM2_RH_NULL
@@ -242,6 +242,12 @@ Esys_PolicySigned_Async(
     r = esys_GetResourceObject(esysContext, policySession, &policySessionNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "policySession unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_PolicySigned, shandle1,
+                              shandle2, shandle3, authObjectNode,
+                              policySessionNode, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_PolicySigned_Prepare(esysContext->sys,
                                       (authObjectNode == NULL) ? TPM2_RH_NULL
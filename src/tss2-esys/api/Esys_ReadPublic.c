@@ -174,6 +174,11 @@ Esys_ReadPublic_Async(
     r = esys_GetResourceObject(esysContext, objectHandle, &objectHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "objectHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_ReadPublic, shandle1,
+                              shandle2, shandle3, objectHandleNode, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_ReadPublic_Prepare(esysContext->sys,
                                     (objectHandleNode == NULL) ? TPM2_RH_NULL
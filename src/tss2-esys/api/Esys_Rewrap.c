@@ -217,6 +217,11 @@ Esys_Rewrap_Async(
     r = esys_GetResourceObject(esysContext, newParent, &newParentNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "newParent unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_Rewrap, shandle1, shandle2,
+                              shandle3, oldParentNode, newParentNode, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_Rewrap_Prepare(esysContext->sys,
                                 (oldParentNode == NULL) ? TPM2_RH_NULL
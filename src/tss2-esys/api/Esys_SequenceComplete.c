@@ -185,6 +185,12 @@ Esys_SequenceComplete_Async(
     r = esys_GetResourceObject(esysContext, sequenceHandle, &sequenceHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "sequenceHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_SequenceComplete, shandle1,
+                              shandle2, shandle3, sequenceHandleNode, NULL,
+                              NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_SequenceComplete_Prepare(esysContext->sys,
                                           (sequenceHandleNode == NULL)
@@ -208,6 +208,11 @@ Esys_Sign_Async(
     r = esys_GetResourceObject(esysContext, keyHandle, &keyHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "keyHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_Sign, shandle1, shandle2,
+                              shandle3, keyHandleNode, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_Sign_Prepare(esysContext->sys,
                               (keyHandleNode == NULL) ? TPM2_RH_NULL
@@ -244,23 +249,24 @@ Esys_Sign_Async(
     return r;
 }
 
-/** Asynchronous finish function for TPM2_Sign
+/** Asynchronous finish function for TPM2_Sign with caller-provided outputs
  *
  * This function returns the results of a TPM2_Sign command
- * invoked via Esys_Sign_Finish. All non-simple output parameters
- * are allocated by the function's implementation. NULL can be passed for every
- * output parameter if the value is not required.
+ * invoked via Esys_Sign_Async. Unlike Esys_Sign_Finish no
+ * memory is allocated for the output parameters; the response is unmarshaled
+ * directly into the storage provided by the caller. NULL can be passed for
+ * every output parameter if the value is not required.
  *
  * @param[in,out] esysContext The ESYS_CONTEXT.
  * @param[out] signature The signature.
- *             (callee-allocated)
+ *             (caller-allocated)
  * @retval TSS2_RC_SUCCESS on success
  * @retval ESYS_RC_SUCCESS if the function call was a success.
  * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or required input
  *         pointers or required output handle references are NULL.
  * @retval TSS2_ESYS_RC_BAD_CONTEXT: if esysContext corruption is detected.
  * @retval TSS2_ESYS_RC_MEMORY: if the ESAPI cannot allocate enough memory for
- *         internal operations or return parameters.
+ *         internal operations.
  * @retval TSS2_ESYS_RC_BAD_SEQUENCE: if the context has an asynchronous
  *         operation already pending.
  * @retval TSS2_ESYS_RC_TRY_AGAIN: if the timeout counter expires before the
@@ -274,9 +280,9 @@ Esys_Sign_Async(
  *         returned to the caller unaltered unless handled internally.
  */
 TSS2_RC
-Esys_Sign_Finish(
+Esys_Sign_FinishInto(
     ESYS_CONTEXT *esysContext,
-    TPMT_SIGNATURE **signature)
+    TPMT_SIGNATURE *signature)
 {
     TSS2_RC r;
     LOG_TRACE("context=%p, signature=%p",
@@ -294,14 +300,6 @@ Esys_Sign_Finish(
     }
     esysContext->state = _ESYS_STATE_INTERNALERROR;
 
-    /* Allocate memory for response parameters */
-    if (signature != NULL) {
-        *signature = calloc(sizeof(TPMT_SIGNATURE), 1);
-        if (*signature == NULL) {
-            return_error(TSS2_ESYS_RC_MEMORY, "Out of memory");
-        }
-    }
-
     /*Receive the TPM response and handle resubmissions if necessary. */
     r = Tss2_Sys_ExecuteFinish(esysContext->sys, esysContext->timeout);
     if ((r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN) {
@@ -360,8 +358,7 @@ Esys_Sign_Finish(
      * After the verification of the response we call the complete function
      * to deliver the result.
      */
-    r = Tss2_Sys_Sign_Complete(esysContext->sys,
-                               (signature != NULL) ? *signature : NULL);
+    r = Tss2_Sys_Sign_Complete(esysContext->sys, signature);
     goto_state_if_error(r, _ESYS_STATE_INTERNALERROR,
                         "Received error from SAPI unmarshaling" ,
                         error_cleanup);
@@ -371,8 +368,61 @@ Esys_Sign_Finish(
     return TSS2_RC_SUCCESS;
 
 error_cleanup:
-    if (signature != NULL)
-        SAFE_FREE(*signature);
-
     return r;
 }
+
+/** Asynchronous finish function for TPM2_Sign
+ *
+ * This function returns the results of a TPM2_Sign command
+ * invoked via Esys_Sign_Finish. All non-simple output parameters
+ * are allocated by the function's implementation on success. NULL can be
+ * passed for every output parameter if the value is not required.
+ *
+ * @param[in,out] esysContext The ESYS_CONTEXT.
+ * @param[out] signature The signature.
+ *             (callee-allocated)
+ * @retval TSS2_RC_SUCCESS on success
+ * @retval ESYS_RC_SUCCESS if the function call was a success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or required input
+ *         pointers or required output handle references are NULL.
+ * @retval TSS2_ESYS_RC_BAD_CONTEXT: if esysContext corruption is detected.
+ * @retval TSS2_ESYS_RC_MEMORY: if the ESAPI cannot allocate enough memory for
+ *         internal operations or return parameters.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE: if the context has an asynchronous
+ *         operation already pending.
+ * @retval TSS2_ESYS_RC_TRY_AGAIN: if the timeout counter expires before the
+ *         TPM response is received.
+ * @retval TSS2_ESYS_RC_INSUFFICIENT_RESPONSE: if the TPM's response does not
+ *         at least contain the tag, response length, and response code.
+ * @retval TSS2_ESYS_RC_RSP_AUTH_FAILED: if the response HMAC from the TPM did
+ *         not verify.
+ * @retval TSS2_ESYS_RC_MALFORMED_RESPONSE: if the TPM's response is corrupted.
+ * @retval TSS2_RCs produced by lower layers of the software stack may be
+ *         returned to the caller unaltered unless handled internally.
+ */
+TSS2_RC
+Esys_Sign_Finish(
+    ESYS_CONTEXT *esysContext,
+    TPMT_SIGNATURE **signature)
+{
+    TPMT_SIGNATURE lsignature;
+    TSS2_RC r;
+
+    /* The response is received into local storage, so polling with
+       TRY_AGAIN does not allocate and errors leave *signature unchanged. */
+    r = Esys_Sign_FinishInto(esysContext,
+                             (signature != NULL) ? &lsignature : NULL);
+    if (r != TSS2_RC_SUCCESS)
+        return r;
+
+    /* Allocate memory for response parameters */
+    if (signature != NULL) {
+        *signature = calloc(sizeof(TPMT_SIGNATURE), 1);
+        if (*signature == NULL) {
+            return_error(TSS2_ESYS_RC_MEMORY, "Out of memory");
+        }
+        **signature = lsignature;
+    }
+
+    return TSS2_RC_SUCCESS;
+}
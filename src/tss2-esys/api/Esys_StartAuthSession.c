@@ -227,8 +227,9 @@ Esys_StartAuthSession_Async(
             LOG_ERROR("Error: initialize auth session (%x).", r2);
             return r2;
         }
-        r2 = iesys_crypto_random2b(&esysContext->in.StartAuthSession.nonceCallerData,
-                                   authHash_size);
+        r2 = iesys_crypto_random_pool_get(&esysContext->random_pool,
+                                          &esysContext->in.StartAuthSession.nonceCallerData,
+                                          authHash_size);
         if (r2 != TSS2_RC_SUCCESS) {
             LOG_ERROR("Error: initialize auth session (%x).", r2);
             return r2;
@@ -238,6 +239,11 @@ Esys_StartAuthSession_Async(
         nonceCaller = esysContext->in.StartAuthSession.nonceCaller;
     }
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_StartAuthSession, shandle1,
+                              shandle2, shandle3, tpmKeyNode, bindNode, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_StartAuthSession_Prepare(esysContext->sys,
                                           (tpmKeyNode == NULL) ? TPM2_RH_NULL
@@ -471,7 +477,8 @@ Esys_StartAuthSession_Finish(
                                        &bindNode->auth,
                                        &sessionHandleNode->rsrc.misc.rsrc_session.bound_entity);
         LOGBLOB_DEBUG(secret, secret_size, "ESYS Session Secret");
-        r = iesys_crypto_KDFa(esysContext->in.StartAuthSession.authHash, secret,
+        r = iesys_crypto_KDFa(&esysContext->crypto_cache,
+                              esysContext->in.StartAuthSession.authHash, secret,
                               secret_size, "ATH",
                                &lnonceTPM, esysContext->in.StartAuthSession.nonceCaller,
                                authHash_size*8, NULL,
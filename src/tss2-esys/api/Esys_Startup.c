@@ -122,6 +122,11 @@ Esys_Startup_Async(
     esysContext->state = _ESYS_STATE_INTERNALERROR;
     store_input_parameters(esysContext, startupType);
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_Startup, ESYS_TR_NONE,
+                              ESYS_TR_NONE, ESYS_TR_NONE, NULL, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_Startup_Prepare(esysContext->sys, startupType);
     return_state_if_error(r, _ESYS_STATE_INIT, "SAPI Prepare returned error.");
@@ -226,6 +231,9 @@ Esys_Startup_Finish(
     return_state_if_error(r, _ESYS_STATE_INTERNALERROR,
                           "Received error from SAPI unmarshaling" );
 
+    /* A TPM reset may change the capabilities */
+    iesys_capability_cache_invalidate(esysContext);
+
     esysContext->state = _ESYS_STATE_INIT;
 
     return TSS2_RC_SUCCESS;
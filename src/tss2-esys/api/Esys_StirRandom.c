@@ -160,6 +160,11 @@ Esys_StirRandom_Async(
     return_state_if_error(r, _ESYS_STATE_INIT, "Check session usage");
     store_input_parameters(esysContext, inData);
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_StirRandom, shandle1,
+                              shandle2, shandle3, NULL, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_StirRandom_Prepare(esysContext->sys, inData);
     return_state_if_error(r, _ESYS_STATE_INIT, "SAPI Prepare returned error.");
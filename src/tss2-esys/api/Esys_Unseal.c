@@ -168,6 +168,11 @@ Esys_Unseal_Async(
     r = esys_GetResourceObject(esysContext, itemHandle, &itemHandleNode);
     return_state_if_error(r, _ESYS_STATE_INIT, "itemHandle unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_Unseal, shandle1, shandle2,
+                              shandle3, itemHandleNode, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_Unseal_Prepare(esysContext->sys,
                                 (itemHandleNode == NULL) ? TPM2_RH_NULL
@@ -203,23 +208,24 @@ Esys_Unseal_Async(
     return r;
 }
 
-/** Asynchronous finish function for TPM2_Unseal
+/** Asynchronous finish function for TPM2_Unseal with caller-provided outputs
  *
  * This function returns the results of a TPM2_Unseal command
- * invoked via Esys_Unseal_Finish. All non-simple output parameters
- * are allocated by the function's implementation. NULL can be passed for every
- * output parameter if the value is not required.
+ * invoked via Esys_Unseal_Async. Unlike Esys_Unseal_Finish no
+ * memory is allocated for the output parameters; the response is unmarshaled
+ * directly into the storage provided by the caller. NULL can be passed for
+ * every output parameter if the value is not required.
  *
  * @param[in,out] esysContext The ESYS_CONTEXT.
  * @param[out] outData Unsealed data.
- *             (callee-allocated)
+ *             (caller-allocated)
  * @retval TSS2_RC_SUCCESS on success
  * @retval ESYS_RC_SUCCESS if the function call was a success.
  * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or required input
  *         pointers or required output handle references are NULL.
  * @retval TSS2_ESYS_RC_BAD_CONTEXT: if esysContext corruption is detected.
  * @retval TSS2_ESYS_RC_MEMORY: if the ESAPI cannot allocate enough memory for
- *         internal operations or return parameters.
+ *         internal operations.
  * @retval TSS2_ESYS_RC_BAD_SEQUENCE: if the context has an asynchronous
  *         operation already pending.
  * @retval TSS2_ESYS_RC_TRY_AGAIN: if the timeout counter expires before the
@@ -233,9 +239,9 @@ Esys_Unseal_Async(
  *         returned to the caller unaltered unless handled internally.
  */
 TSS2_RC
-Esys_Unseal_Finish(
+Esys_Unseal_FinishInto(
     ESYS_CONTEXT *esysContext,
-    TPM2B_SENSITIVE_DATA **outData)
+    TPM2B_SENSITIVE_DATA *outData)
 {
     TSS2_RC r;
     LOG_TRACE("context=%p, outData=%p",
@@ -253,14 +259,6 @@ Esys_Unseal_Finish(
     }
     esysContext->state = _ESYS_STATE_INTERNALERROR;
 
-    /* Allocate memory for response parameters */
-    if (outData != NULL) {
-        *outData = calloc(sizeof(TPM2B_SENSITIVE_DATA), 1);
-        if (*outData == NULL) {
-            return_error(TSS2_ESYS_RC_MEMORY, "Out of memory");
-        }
-    }
-
     /*Receive the TPM response and handle resubmissions if necessary. */
     r = Tss2_Sys_ExecuteFinish(esysContext->sys, esysContext->timeout);
     if ((r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN) {
@@ -316,8 +314,7 @@ Esys_Unseal_Finish(
      * After the verification of the response we call the complete function
      * to deliver the result.
      */
-    r = Tss2_Sys_Unseal_Complete(esysContext->sys,
-                                 (outData != NULL) ? *outData : NULL);
+    r = Tss2_Sys_Unseal_Complete(esysContext->sys, outData);
     goto_state_if_error(r, _ESYS_STATE_INTERNALERROR,
                         "Received error from SAPI unmarshaling" ,
                         error_cleanup);
@@ -327,8 +324,61 @@ Esys_Unseal_Finish(
     return TSS2_RC_SUCCESS;
 
 error_cleanup:
-    if (outData != NULL)
-        SAFE_FREE(*outData);
-
     return r;
 }
+
+/** Asynchronous finish function for TPM2_Unseal
+ *
+ * This function returns the results of a TPM2_Unseal command
+ * invoked via Esys_Unseal_Finish. All non-simple output parameters
+ * are allocated by the function's implementation on success. NULL can be
+ * passed for every output parameter if the value is not required.
+ *
+ * @param[in,out] esysContext The ESYS_CONTEXT.
+ * @param[out] outData Unsealed data.
+ *             (callee-allocated)
+ * @retval TSS2_RC_SUCCESS on success
+ * @retval ESYS_RC_SUCCESS if the function call was a success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or required input
+ *         pointers or required output handle references are NULL.
+ * @retval TSS2_ESYS_RC_BAD_CONTEXT: if esysContext corruption is detected.
+ * @retval TSS2_ESYS_RC_MEMORY: if the ESAPI cannot allocate enough memory for
+ *         internal operations or return parameters.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE: if the context has an asynchronous
+ *         operation already pending.
+ * @retval TSS2_ESYS_RC_TRY_AGAIN: if the timeout counter expires before the
+ *         TPM response is received.
+ * @retval TSS2_ESYS_RC_INSUFFICIENT_RESPONSE: if the TPM's response does not
+ *         at least contain the tag, response length, and response code.
+ * @retval TSS2_ESYS_RC_RSP_AUTH_FAILED: if the response HMAC from the TPM did
+ *         not verify.
+ * @retval TSS2_ESYS_RC_MALFORMED_RESPONSE: if the TPM's response is corrupted.
+ * @retval TSS2_RCs produced by lower layers of the software stack may be
+ *         returned to the caller unaltered unless handled internally.
+ */
+TSS2_RC
+Esys_Unseal_Finish(
+    ESYS_CONTEXT *esysContext,
+    TPM2B_SENSITIVE_DATA **outData)
+{
+    TPM2B_SENSITIVE_DATA loutData;
+    TSS2_RC r;
+
+    /* The response is received into local storage, so polling with
+       TRY_AGAIN does not allocate and errors leave *outData unchanged. */
+    r = Esys_Unseal_FinishInto(esysContext,
+                               (outData != NULL) ? &loutData : NULL);
+    if (r != TSS2_RC_SUCCESS)
+        return r;
+
+    /* Allocate memory for response parameters */
+    if (outData != NULL) {
+        *outData = calloc(sizeof(TPM2B_SENSITIVE_DATA), 1);
+        if (*outData == NULL) {
+            return_error(TSS2_ESYS_RC_MEMORY, "Out of memory");
+        }
+        **outData = loutData;
+    }
+
+    return TSS2_RC_SUCCESS;
+}
@@ -205,6 +205,11 @@ Esys_ZGen_2Phase_Async(
     r = esys_GetResourceObject(esysContext, keyA, &keyANode);
     return_state_if_error(r, _ESYS_STATE_INIT, "keyA unknown.");
 
+    /* Load swapped out objects and reserve the auth area of the sessions */
+    r = iesys_prepare_command(esysContext, TPM2_CC_ZGen_2Phase, shandle1,
+                              shandle2, shandle3, keyANode, NULL, NULL);
+    return_state_if_error(r, _ESYS_STATE_INIT, "Prepare command.");
+
     /* Initial invocation of SAPI to prepare the command buffer with parameters */
     r = Tss2_Sys_ZGen_2Phase_Prepare(esysContext->sys,
                                      (keyANode == NULL) ? TPM2_RH_NULL
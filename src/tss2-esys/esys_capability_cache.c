@@ -0,0 +1,229 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tss2_esys.h"
+
+#include "esys_iutil.h"
+#define LOGMODULE esys
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/*
+ * The capability cache keeps the responses of TPM2_GetCapability calls
+ * without sessions whose data only changes with a TPM reset, a firmware
+ * upgrade or the commands that reconfigure the TPM: the fixed TPM properties,
+ * the implemented algorithms, commands and ECC curves and the PCR banks.
+ * Responses are keyed by the exact request (capability, property,
+ * propertyCount) and filled lazily by Esys_GetCapability_Finish.
+ */
+
+/** Check whether a capability response only holds stable values.
+ *
+ * @param capability [in] The requested capability.
+ * @param property [in] The requested first property.
+ * @param data [in] The response.
+ * @retval true if the response can be cached.
+ */
+static bool
+capability_cacheable(TPM2_CAP capability, UINT32 property,
+                     const TPMS_CAPABILITY_DATA *data)
+{
+    const TPML_TAGGED_TPM_PROPERTY *props = &data->data.tpmProperties;
+
+    if (data->capability != capability)
+        return false;
+
+    switch (capability) {
+    case TPM2_CAP_ALGS:
+    case TPM2_CAP_COMMANDS:
+    case TPM2_CAP_PCRS:
+    case TPM2_CAP_ECC_CURVES:
+        return true;
+    case TPM2_CAP_TPM_PROPERTIES:
+        if (property >= TPM2_PT_VAR)
+            return false;
+        for (UINT32 i = 0; i < props->count; i++) {
+            if (props->tpmProperty[i].property >= TPM2_PT_VAR)
+                return false;
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+/** Look up a capability response in the capability cache.
+ *
+ * @param esys_context [in] The ESYS_CONTEXT.
+ * @param capability [in] The requested capability.
+ * @param property [in] The requested first property.
+ * @param propertyCount [in] The requested number of properties.
+ * @retval The cached response or NULL if the cache is disabled or does not
+ *         hold the request.
+ */
+const IESYS_CAPABILITY_RECORD *
+iesys_capability_cache_get(ESYS_CONTEXT *esys_context, TPM2_CAP capability,
+                           UINT32 property, UINT32 propertyCount)
+{
+    IESYS_CAPABILITY_CACHE *cache = &esys_context->capability_cache;
+
+    if (!cache->enabled)
+        return NULL;
+
+    for (size_t i = 0; i < cache->count; i++) {
+        if (cache->records[i].capability == capability &&
+            cache->records[i].property == property &&
+            cache->records[i].propertyCount == propertyCount)
+            return &cache->records[i];
+    }
+    return NULL;
+}
+
+/** Add a capability response to the capability cache.
+ *
+ * Responses with variable data are ignored.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param capability [in] The requested capability.
+ * @param property [in] The requested first property.
+ * @param propertyCount [in] The requested number of properties.
+ * @param moreData [in] The moreData flag of the response.
+ * @param data [in] The capability data of the response.
+ * @retval TSS2_RC_SUCCESS on success or if the response was ignored.
+ * @retval TSS2_ESYS_RC_MEMORY if the cache can not grow.
+ */
+TSS2_RC
+iesys_capability_cache_put(ESYS_CONTEXT *esys_context, TPM2_CAP capability,
+                           UINT32 property, UINT32 propertyCount,
+                           TPMI_YES_NO moreData,
+                           const TPMS_CAPABILITY_DATA *data)
+{
+    IESYS_CAPABILITY_CACHE *cache = &esys_context->capability_cache;
+    IESYS_CAPABILITY_RECORD *records;
+
+    if (!cache->enabled || !capability_cacheable(capability, property, data))
+        return TSS2_RC_SUCCESS;
+    if (iesys_capability_cache_get(esys_context, capability, property,
+                                   propertyCount) != NULL)
+        return TSS2_RC_SUCCESS;
+
+    records = realloc(cache->records, (cache->count + 1) * sizeof(*records));
+    return_if_null(records, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+    cache->records = records;
+
+    records[cache->count].capability = capability;
+    records[cache->count].property = property;
+    records[cache->count].propertyCount = propertyCount;
+    records[cache->count].moreData = moreData;
+    records[cache->count].data = *data;
+    cache->count++;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Drop all responses of the capability cache.
+ *
+ * Called after commands that change the TPM's capabilities.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ */
+void
+iesys_capability_cache_invalidate(ESYS_CONTEXT *esys_context)
+{
+    IESYS_CAPABILITY_CACHE *cache = &esys_context->capability_cache;
+
+    if (cache->count > 0)
+        LOG_DEBUG("Dropping %zu cached capabilities", cache->count);
+    SAFE_FREE(cache->records);
+    cache->count = 0;
+    cache->hit = NULL;
+}
+
+/** Get the value of a single TPM property.
+ *
+ * The property is requested through Esys_GetCapability, so that it is
+ * answered from the capability cache while the cache is enabled.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param property [in] The requested TPM property.
+ * @param value [out] The value of the property, or 0 if the TPM does not
+ *        report it.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_RCs produced by Esys_GetCapability.
+ */
+TSS2_RC
+iesys_capability_get_property(ESYS_CONTEXT *esys_context, TPM2_PT property,
+                              UINT32 *value)
+{
+    TSS2_RC r;
+    TPMI_YES_NO moreData;
+    TPMS_CAPABILITY_DATA *capabilityData = NULL;
+    TPML_TAGGED_TPM_PROPERTY *props;
+
+    *value = 0;
+    r = Esys_GetCapability(esys_context,
+                           ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                           TPM2_CAP_TPM_PROPERTIES, property, 1,
+                           &moreData, &capabilityData);
+    return_if_error(r, "Get TPM property");
+
+    props = &capabilityData->data.tpmProperties;
+    if (props->count == 1 && props->tpmProperty[0].property == property)
+        *value = props->tpmProperty[0].value;
+    free(capabilityData);
+    return TSS2_RC_SUCCESS;
+}
+
+/** Enable or disable the capability cache.
+ *
+ * While enabled, Esys_GetCapability calls without sessions for fixed TPM
+ * properties (TPM2_PT_FIXED group), algorithms, commands, ECC curves or PCR
+ * banks are answered from earlier responses to the same request. The cache
+ * is dropped by Esys_Startup, Esys_PCR_Allocate, Esys_SetAlgorithmSet and
+ * Esys_FieldUpgradeStart/Data; changes the ESYS_CONTEXT does not see, e.g.
+ * a TPM reset by another application, require
+ * Esys_CapabilityCache_Invalidate. Disabling drops the cache.
+ * @param esysContext [in,out] The ESYS_CONTEXT.
+ * @param enable [in] TPM2_YES to enable, TPM2_NO to disable the cache.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext is NULL.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if a command is outstanding.
+ */
+TSS2_RC
+Esys_CapabilityCache_Enable(ESYS_CONTEXT *esysContext, TPMI_YES_NO enable)
+{
+    _ESYS_ASSERT_NON_NULL(esysContext);
+
+    if (esysContext->state != _ESYS_STATE_INIT) {
+        LOG_ERROR("Esys called in bad sequence.");
+        return TSS2_ESYS_RC_BAD_SEQUENCE;
+    }
+
+    if (!enable)
+        iesys_capability_cache_invalidate(esysContext);
+    esysContext->capability_cache.enabled = (enable != TPM2_NO);
+    return TSS2_RC_SUCCESS;
+}
+
+/** Drop all responses of the capability cache.
+ *
+ * @param esysContext [in,out] The ESYS_CONTEXT.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext is NULL.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if a command is outstanding.
+ */
+TSS2_RC
+Esys_CapabilityCache_Invalidate(ESYS_CONTEXT *esysContext)
+{
+    _ESYS_ASSERT_NON_NULL(esysContext);
+
+    if (esysContext->state != _ESYS_STATE_INIT) {
+        LOG_ERROR("Esys called in bad sequence.");
+        return TSS2_ESYS_RC_BAD_SEQUENCE;
+    }
+
+    iesys_capability_cache_invalidate(esysContext);
+    return TSS2_RC_SUCCESS;
+}
@@ -122,6 +122,12 @@ Esys_Finalize(ESYS_CONTEXT ** esys_context)
     /* Flush from TPM and free all resource objects first */
     iesys_DeleteAllResourceObjects(*esys_context);
 
+    /* Release the cached hash and HMAC contexts */
+    iesys_crypto_cache_free(&(*esys_context)->crypto_cache);
+
+    /* Wipe the unused random bytes */
+    iesys_crypto_random_pool_free(&(*esys_context)->random_pool);
+
     /* If no tcti context was provided during initialization, then we need to
        finalize the tcti context. So we retrieve here before finalizing the
        SAPI context. */
@@ -133,6 +139,18 @@ Esys_Finalize(ESYS_CONTEXT ** esys_context)
         }
     }
 
+    /* Close the metadata cache without saving it */
+    iesys_metadata_cache_free(*esys_context);
+
+    /* Release the SYS context used for swapping */
+    iesys_swap_free(*esys_context);
+
+    /* Release the SYS contexts used for bulk NV commands */
+    iesys_nv_bulk_free(*esys_context);
+
+    /* Drop the cached capabilities */
+    iesys_capability_cache_invalidate(*esys_context);
+
     /* Finalize the syscontext */
     Tss2_Sys_Finalize((*esys_context)->sys);
     free((*esys_context)->sys);
@@ -229,3 +247,24 @@ Esys_SetTimeout(ESYS_CONTEXT * esys_context, int32_t timeout)
     esys_context->timeout = timeout;
     return TSS2_RC_SUCCESS;
 }
+
+/** Set the reseed byte budget of the random pool.
+ *
+ * Caller nonces and salts are served from a pool of random bytes that is
+ * refilled from the crypto backend size bytes at a time. A smaller size
+ * draws from the backend more often. The unused bytes of the pool are
+ * discarded.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param size [in] The number of bytes per refill, at least the size of the
+ *        largest digest and at most IESYS_RANDOM_POOL_SIZE (1024 by
+ *        default), or 0 to restore the default.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if esysContext is NULL.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if size is out of range.
+ */
+TSS2_RC
+Esys_SetRandomPoolSize(ESYS_CONTEXT * esys_context, size_t size)
+{
+    _ESYS_ASSERT_NON_NULL(esys_context);
+    return iesys_crypto_random_pool_set_size(&esys_context->random_pool, size);
+}
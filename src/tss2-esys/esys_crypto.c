@@ -7,6 +7,13 @@
 #define _GNU_SOURCE
 
 #include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
 
 #include "tss2_esys.h"
 
@@ -58,12 +65,345 @@ iesys_crypto_hash_get_digest_size(TPM2_ALG_ID hashAlg, size_t * size)
     return TSS2_RC_SUCCESS;
 }
 
+/** Get the slot of a hash algorithm inside a crypto context cache.
+ *
+ * @param[in] hashAlg The hash algorithm.
+ * @retval The index of the slot or -1 if the algorithm is not cached.
+ */
+static int
+iesys_crypto_cache_index(TPM2_ALG_ID hashAlg)
+{
+    switch (hashAlg) {
+    case TPM2_ALG_SHA1:
+        return 0;
+    case TPM2_ALG_SHA256:
+        return 1;
+    case TPM2_ALG_SHA384:
+        return 2;
+    case TPM2_ALG_SHA512:
+        return 3;
+    case TPM2_ALG_SM3_256:
+        return 4;
+    default:
+        return -1;
+    }
+}
+
+/** Provide a digest object, preferably taken from a crypto context cache.
+ *
+ * If the cache holds a context for the hash algorithm it is reset and handed
+ * out; otherwise a new context is created. The context is owned by the caller
+ * until it is passed to iesys_crypto_cache_hash_finish or released with
+ * iesys_crypto_hash_abort.
+ * @param[in,out] cache The crypto context cache (may be NULL).
+ * @param[out] context The digest object.
+ * @param[in] hashAlg The hash algorithm of the digest object.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_MEMORY Memory cannot be allocated.
+ * @retval TSS2_ESYS_RC_NOT_IMPLEMENTED if hashAlg is not supported.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_crypto_cache_hash_start(IESYS_CRYPTO_CACHE * cache,
+                              IESYS_CRYPTO_CONTEXT_BLOB ** context,
+                              TPM2_ALG_ID hashAlg)
+{
+    TSS2_RC r;
+    int idx = iesys_crypto_cache_index(hashAlg);
+
+    return_if_null(context, "Context is NULL", TSS2_ESYS_RC_BAD_REFERENCE);
+    if (cache == NULL || idx < 0 || cache->hash[idx] == NULL)
+        return iesys_crypto_hash_start(context, hashAlg);
+
+    r = iesys_crypto_hash_reset(cache->hash[idx]);
+    return_if_error(r, "Reset hash context");
+    *context = cache->hash[idx];
+    cache->hash[idx] = NULL;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Get the digest value of a digest object and return it to the cache.
+ *
+ * If the cache slot of the hash algorithm is occupied, the digest object is
+ * released instead.
+ * @param[in,out] cache The crypto context cache (may be NULL).
+ * @param[in] hashAlg The hash algorithm of the digest object.
+ * @param[in,out] context The digest object; set to NULL on success.
+ * @param[out] buffer The buffer for the digest value (caller-allocated).
+ * @param[in,out] size The size of the buffer and the size of the digest.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_BAD_SIZE if the buffer is too small.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_crypto_cache_hash_finish(IESYS_CRYPTO_CACHE * cache,
+                               TPM2_ALG_ID hashAlg,
+                               IESYS_CRYPTO_CONTEXT_BLOB ** context,
+                               uint8_t * buffer, size_t * size)
+{
+    TSS2_RC r;
+    int idx = iesys_crypto_cache_index(hashAlg);
+
+    if (context == NULL || *context == NULL) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Null-Pointer passed");
+    }
+    if (cache == NULL || idx < 0 || cache->hash[idx] != NULL)
+        return iesys_crypto_hash_finish(context, buffer, size);
+
+    r = iesys_crypto_hash_final(*context, buffer, size);
+    return_if_error(r, "Finalize hash");
+    cache->hash[idx] = *context;
+    *context = NULL;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Provide an HMAC object, preferably taken from a crypto context cache.
+ *
+ * If the cache holds a context for the hash algorithm it is rekeyed and
+ * handed out; otherwise a new context is created. The context is owned by the
+ * caller until it is passed to iesys_crypto_cache_hmac_finish or released with
+ * iesys_crypto_hmac_abort.
+ * @param[in,out] cache The crypto context cache (may be NULL).
+ * @param[out] context The HMAC object.
+ * @param[in] hmacAlg The hash algorithm of the HMAC object.
+ * @param[in] key The byte buffer of the HMAC key.
+ * @param[in] size The size of the HMAC key.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_MEMORY Memory cannot be allocated.
+ * @retval TSS2_ESYS_RC_NOT_IMPLEMENTED if hmacAlg is not supported.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_crypto_cache_hmac_start(IESYS_CRYPTO_CACHE * cache,
+                              IESYS_CRYPTO_CONTEXT_BLOB ** context,
+                              TPM2_ALG_ID hmacAlg,
+                              const uint8_t * key, size_t size)
+{
+    TSS2_RC r;
+    int idx = iesys_crypto_cache_index(hmacAlg);
+
+    return_if_null(context, "Context is NULL", TSS2_ESYS_RC_BAD_REFERENCE);
+    if (cache == NULL || idx < 0 || cache->hmac[idx] == NULL)
+        return iesys_crypto_hmac_start(context, hmacAlg, key, size);
+
+    r = iesys_crypto_hmac_rekey(cache->hmac[idx], key, size);
+    return_if_error(r, "Rekey hmac context");
+    *context = cache->hmac[idx];
+    cache->hmac[idx] = NULL;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Get the digest value of an HMAC object and return it to the cache.
+ *
+ * If the cache slot of the hash algorithm is occupied, the HMAC object is
+ * released instead.
+ * @param[in,out] cache The crypto context cache (may be NULL).
+ * @param[in] hmacAlg The hash algorithm of the HMAC object.
+ * @param[in,out] context The HMAC object; set to NULL on success.
+ * @param[out] buffer The buffer for the digest value (caller-allocated).
+ * @param[in,out] size The size of the buffer and the size of the digest.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_BAD_SIZE if the buffer is too small.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_crypto_cache_hmac_finish(IESYS_CRYPTO_CACHE * cache,
+                               TPM2_ALG_ID hmacAlg,
+                               IESYS_CRYPTO_CONTEXT_BLOB ** context,
+                               uint8_t * buffer, size_t * size)
+{
+    TSS2_RC r;
+    int idx = iesys_crypto_cache_index(hmacAlg);
+
+    if (context == NULL || *context == NULL) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Null-Pointer passed");
+    }
+    if (cache == NULL || idx < 0 || cache->hmac[idx] != NULL)
+        return iesys_crypto_hmac_finish(context, buffer, size);
+
+    r = iesys_crypto_hmac_final(*context, buffer, size);
+    return_if_error(r, "Finalize hmac");
+    cache->hmac[idx] = *context;
+    *context = NULL;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Release all contexts of a crypto context cache.
+ *
+ * @param[in,out] cache The crypto context cache.
+ */
+void
+iesys_crypto_cache_free(IESYS_CRYPTO_CACHE * cache)
+{
+    if (cache == NULL)
+        return;
+
+    for (size_t i = 0; i < IESYS_CRYPTO_CACHE_SIZE; i++) {
+        iesys_crypto_hash_abort(&cache->hash[i]);
+        iesys_crypto_hmac_abort(&cache->hmac[i]);
+    }
+    iesys_crypto_cipher_free(&cache->cipher);
+}
+
+/** Check whether a converted public key can be reused for a key.
+ *
+ * The crypto backends convert a TPM public key into their own key objects
+ * once and keep them in an IESYS_CRYPTO_PUBKEY. Those objects only depend on
+ * the key material, so the conversion may be reused as long as the type,
+ * the RSA exponent and modulus or the ECC curve and point are unchanged.
+ * @param[in] cached The public area the key objects were built from.
+ * @param[in] key The public area of the key to be used.
+ * @retval true if the key objects built from cached also represent key.
+ * @retval false otherwise.
+ */
+bool
+iesys_crypto_pubkey_matches(const TPMT_PUBLIC * cached,
+                            const TPMT_PUBLIC * key)
+{
+    if (cached->type != key->type)
+        return false;
+
+    switch (key->type) {
+    case TPM2_ALG_RSA:
+        return cached->parameters.rsaDetail.exponent ==
+                   key->parameters.rsaDetail.exponent &&
+               cached->parameters.rsaDetail.keyBits ==
+                   key->parameters.rsaDetail.keyBits &&
+               cached->unique.rsa.size == key->unique.rsa.size &&
+               memcmp(&cached->unique.rsa.buffer[0],
+                      &key->unique.rsa.buffer[0], key->unique.rsa.size) == 0;
+    case TPM2_ALG_ECC:
+        return cached->parameters.eccDetail.curveID ==
+                   key->parameters.eccDetail.curveID &&
+               cached->unique.ecc.x.size == key->unique.ecc.x.size &&
+               cached->unique.ecc.y.size == key->unique.ecc.y.size &&
+               memcmp(&cached->unique.ecc.x.buffer[0],
+                      &key->unique.ecc.x.buffer[0],
+                      key->unique.ecc.x.size) == 0 &&
+               memcmp(&cached->unique.ecc.y.buffer[0],
+                      &key->unique.ecc.y.buffer[0],
+                      key->unique.ecc.y.size) == 0;
+    default:
+        return false;
+    }
+}
+
+/** Compute random TPM2B data from a random pool.
+ *
+ * Works like iesys_crypto_random2b but serves the bytes from the pool,
+ * refilling it from the crypto backend when it runs dry or when the process
+ * has forked since the pool was filled.
+ * @param[in,out] pool The random pool (may be NULL, then the backend is
+ *                called directly).
+ * @param[out] nonce The TPM2B structure for the random data (caller-allocated).
+ * @param[in] num_bytes The number of bytes to be generated.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE If nonce is NULL.
+ * @retval TSS2_ESYS_RC_BAD_VALUE If num_bytes exceeds the size of a nonce.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE The internal crypto engine failed.
+ */
+TSS2_RC
+iesys_crypto_random_pool_get(IESYS_RANDOM_POOL * pool,
+                             TPM2B_NONCE * nonce,
+                             size_t num_bytes)
+{
+    TSS2_RC r;
+    IESYS_PID pid;
+    size_t refill_size;
+    uint8_t *bytes;
+
+    if (pool == NULL)
+        return iesys_crypto_random2b(nonce, num_bytes);
+
+    if (nonce == NULL)
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+
+    if (num_bytes == 0)
+        num_bytes = sizeof(TPMU_HA);
+    if (num_bytes > sizeof(nonce->buffer)) {
+        LOG_ERROR("Nonce size %zu too large.", num_bytes);
+        return TSS2_ESYS_RC_BAD_VALUE;
+    }
+
+    pid = getpid();
+    if (pool->available < num_bytes || pool->pid != pid) {
+        refill_size = pool->refill_size ? pool->refill_size
+                                        : sizeof(pool->buffer);
+        bytes = &pool->buffer[sizeof(pool->buffer) - refill_size];
+        r = iesys_crypto_get_random(bytes, refill_size);
+        if (r != TSS2_RC_SUCCESS) {
+            iesys_crypto_random_pool_free(pool);
+            return_error(r, "Refilling random pool.");
+        }
+        pool->available = refill_size;
+        pool->pid = pid;
+    }
+
+    bytes = &pool->buffer[sizeof(pool->buffer) - pool->available];
+    memcpy(&nonce->buffer[0], bytes, num_bytes);
+    memset(bytes, 0, num_bytes);
+    pool->available -= num_bytes;
+    nonce->size = num_bytes;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Set the number of bytes a random pool draws per refill.
+ *
+ * The unused bytes of the pool are wiped so that the next draw refills it
+ * with the new size.
+ * @param[in,out] pool The random pool.
+ * @param[in] refill_size The number of bytes drawn from the crypto backend
+ *            per refill, or 0 for IESYS_RANDOM_POOL_SIZE.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE If pool is NULL.
+ * @retval TSS2_ESYS_RC_BAD_VALUE If refill_size is smaller than the largest
+ *         nonce or larger than IESYS_RANDOM_POOL_SIZE.
+ */
+TSS2_RC
+iesys_crypto_random_pool_set_size(IESYS_RANDOM_POOL * pool,
+                                  size_t refill_size)
+{
+    if (pool == NULL)
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+
+    if (refill_size != 0 && (refill_size < sizeof(TPMU_HA) ||
+                             refill_size > sizeof(pool->buffer))) {
+        LOG_ERROR("Random pool size %zu out of range.", refill_size);
+        return TSS2_ESYS_RC_BAD_VALUE;
+    }
+
+    iesys_crypto_random_pool_free(pool);
+    pool->refill_size = refill_size;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Wipe a random pool and mark it empty.
+ *
+ * The refill size of the pool is kept.
+ * @param[in,out] pool The random pool.
+ */
+void
+iesys_crypto_random_pool_free(IESYS_RANDOM_POOL * pool)
+{
+    if (pool == NULL)
+        return;
+
+    memset(&pool->buffer[0], 0, sizeof(pool->buffer));
+    pool->available = 0;
+}
+
 /** Compute the command or response parameter hash.
  *
  * These hashes are needed for the computation of the HMAC used for the
  * authorization of commands, or for the HMAC used for checking the responses.
  * The name parameters are only used for the command parameter hash (cp) and
  * must be NULL for the computation of the response parameter rp hash (rp).
+ * @param[in,out] cache The crypto context cache (may be NULL).
  * @param[in] alg The hash algorithm.
  * @param[in] rcBuffer The response code in marshaled form.
  * @param[in] ccBuffer The command code in marshaled form.
@@ -78,7 +418,8 @@ iesys_crypto_hash_get_digest_size(TPM2_ALG_ID hashAlg, size_t * size)
  */
 
 TSS2_RC
-iesys_crypto_pHash(TPM2_ALG_ID alg,
+iesys_crypto_pHash(IESYS_CRYPTO_CACHE * cache,
+                   TPM2_ALG_ID alg,
                    const uint8_t rcBuffer[4],
                    const uint8_t ccBuffer[4],
                    const TPM2B_NAME * name1,
@@ -96,7 +437,7 @@ iesys_crypto_pHash(TPM2_ALG_ID alg,
 
     IESYS_CRYPTO_CONTEXT_BLOB *cryptoContext;
 
-    TSS2_RC r = iesys_crypto_hash_start(&cryptoContext, alg);
+    TSS2_RC r = iesys_crypto_cache_hash_start(cache, &cryptoContext, alg);
     return_if_error(r, "Error");
 
     if (rcBuffer != NULL) {
@@ -125,7 +466,8 @@ iesys_crypto_pHash(TPM2_ALG_ID alg,
     r = iesys_crypto_hash_update(cryptoContext, pBuffer, pBuffer_size);
     goto_if_error(r, "Error", error);
 
-    r = iesys_crypto_hash_finish(&cryptoContext, pHash, pHash_size);
+    r = iesys_crypto_cache_hash_finish(cache, alg, &cryptoContext, pHash,
+                                       pHash_size);
     goto_if_error(r, "Error", error);
 
     return r;
@@ -135,11 +477,181 @@ iesys_crypto_pHash(TPM2_ALG_ID alg,
     return r;
 }
 
+/** The number of bytes of the command or response buffer that are fed into
+ *  each digest object before the next part of the buffer is processed by
+ *  iesys_crypto_pHash_multi. It is small enough to stay in the L1 cache. */
+#define IESYS_CRYPTO_PHASH_CHUNK_SIZE 2048
+
+/** Compute the command or response parameter hash for several algorithms.
+ *
+ * All digests are computed in a single pass over the command or response
+ * buffer. The buffer is processed in chunks which are fed into every digest
+ * object in turn, so each part of a large buffer is only read from memory
+ * once. If only one algorithm is requested iesys_crypto_pHash is used.
+ * @param[in,out] cache The crypto context cache (may be NULL).
+ * @param[in] count The number of hash algorithms
+ *            (at most IESYS_CRYPTO_PHASH_MULTI_MAX).
+ * @param[in] alg The hash algorithms.
+ * @param[in] rcBuffer The response code in marshaled form.
+ * @param[in] ccBuffer The command code in marshaled form.
+ * @param[in] name1, name2, name3 The names associated with the corresponding
+ *            handle. Must be NULL if no handle is passed.
+ * @param[in] pBuffer The byte buffer or the command or the response.
+ * @param[in] pBuffer_size The size of the command or response.
+ * @param[out] pHash The result digests, one buffer per algorithm.
+ * @param[in,out] pHash_size The sizes of the result digest buffers and the
+ *            sizes of the result digests.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if count exceeds
+ *         IESYS_CRYPTO_PHASH_MULTI_MAX.
+ * @retval TSS2_ESYS_RC_NOT_IMPLEMENTED if a hash algorithm is not implemented.
+ */
+TSS2_RC
+iesys_crypto_pHash_multi(IESYS_CRYPTO_CACHE * cache,
+                         size_t count,
+                         const TPM2_ALG_ID alg[],
+                         const uint8_t rcBuffer[4],
+                         const uint8_t ccBuffer[4],
+                         const TPM2B_NAME * name1,
+                         const TPM2B_NAME * name2,
+                         const TPM2B_NAME * name3,
+                         const uint8_t * pBuffer,
+                         size_t pBuffer_size,
+                         uint8_t * pHash[], size_t * pHash_size[])
+{
+    LOG_TRACE("called");
+    if (alg == NULL || ccBuffer == NULL || pBuffer == NULL || pHash == NULL
+        || pHash_size == NULL) {
+        LOG_ERROR("Null-Pointer passed");
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+    if (count > IESYS_CRYPTO_PHASH_MULTI_MAX) {
+        LOG_ERROR("Too many hash algorithms: %zu", count);
+        return TSS2_ESYS_RC_BAD_VALUE;
+    }
+    if (count == 1)
+        return iesys_crypto_pHash(cache, alg[0], rcBuffer, ccBuffer,
+                                  name1, name2, name3, pBuffer, pBuffer_size,
+                                  pHash[0], pHash_size[0]);
+
+    IESYS_CRYPTO_CONTEXT_BLOB *cryptoContext[IESYS_CRYPTO_PHASH_MULTI_MAX] =
+        { NULL };
+    const TPM2B_NAME *names[] = { name1, name2, name3 };
+    size_t i, n, offset;
+    TSS2_RC r = TSS2_RC_SUCCESS;
+
+    for (i = 0; i < count; i++) {
+        r = iesys_crypto_cache_hash_start(cache, &cryptoContext[i], alg[i]);
+        goto_if_error(r, "Error", error);
+
+        if (rcBuffer != NULL) {
+            r = iesys_crypto_hash_update(cryptoContext[i], &rcBuffer[0], 4);
+            goto_if_error(r, "Error", error);
+        }
+
+        r = iesys_crypto_hash_update(cryptoContext[i], &ccBuffer[0], 4);
+        goto_if_error(r, "Error", error);
+
+        for (n = 0; n < sizeof(names) / sizeof(names[0]); n++) {
+            if (names[n] == NULL)
+                continue;
+            r = iesys_crypto_hash_update2b(cryptoContext[i],
+                                           (TPM2B *) names[n]);
+            goto_if_error(r, "Error", error);
+        }
+    }
+
+    for (offset = 0; offset < pBuffer_size; offset += n) {
+        n = pBuffer_size - offset;
+        if (n > IESYS_CRYPTO_PHASH_CHUNK_SIZE)
+            n = IESYS_CRYPTO_PHASH_CHUNK_SIZE;
+        for (i = 0; i < count; i++) {
+            r = iesys_crypto_hash_update(cryptoContext[i], &pBuffer[offset],
+                                         n);
+            goto_if_error(r, "Error", error);
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        r = iesys_crypto_cache_hash_finish(cache, alg[i], &cryptoContext[i],
+                                           pHash[i], pHash_size[i]);
+        goto_if_error(r, "Error", error);
+    }
+
+    return r;
+
+ error:
+    for (i = 0; i < count; i++)
+        iesys_crypto_hash_abort(&cryptoContext[i]);
+    return r;
+}
+
+/** Feed the authorization HMAC input into an HMAC object.
+ *
+ * @param[in,out] cryptoContext The keyed HMAC object.
+ * @param[in] pHash The command parameter hash byte buffer.
+ * @param[in] pHash_size The size of the command parameter hash byte buffer.
+ * @param[in] nonceNewer The TPM nonce.
+ * @param[in] nonceOlder The caller nonce.
+ * @param[in] nonceDecrypt The decrypt nonce (NULL if not used).
+ * @param[in] nonceEncrypt The encrypt nonce (NULL if not used).
+ * @param[in] sessionAttributes The attributes used for the current
+ *            authentication.
+ * @retval TSS2_RC_SUCCESS on success
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE If a pointer is invalid.
+ */
+static TSS2_RC
+iesys_crypto_authHmac_update(IESYS_CRYPTO_CONTEXT_BLOB * cryptoContext,
+                             const uint8_t * pHash,
+                             size_t pHash_size,
+                             const TPM2B_NONCE * nonceNewer,
+                             const TPM2B_NONCE * nonceOlder,
+                             const TPM2B_NONCE * nonceDecrypt,
+                             const TPM2B_NONCE * nonceEncrypt,
+                             TPMA_SESSION sessionAttributes)
+{
+    uint8_t sessionAttribs[sizeof(sessionAttributes)];
+    size_t sessionAttribs_size = 0;
+
+    TSS2_RC r = iesys_crypto_hmac_update(cryptoContext, pHash, pHash_size);
+    return_if_error(r, "Error");
+
+    r = iesys_crypto_hmac_update2b(cryptoContext, (TPM2B *) nonceNewer);
+    return_if_error(r, "Error");
+
+    r = iesys_crypto_hmac_update2b(cryptoContext, (TPM2B *) nonceOlder);
+    return_if_error(r, "Error");
+
+    if (nonceDecrypt != NULL) {
+        r = iesys_crypto_hmac_update2b(cryptoContext, (TPM2B *) nonceDecrypt);
+        return_if_error(r, "Error");
+    }
+
+    if (nonceEncrypt != NULL) {
+        r = iesys_crypto_hmac_update2b(cryptoContext, (TPM2B *) nonceEncrypt);
+        return_if_error(r, "Error");
+    }
+
+    r = Tss2_MU_TPMA_SESSION_Marshal(sessionAttributes,
+                                     &sessionAttribs[0],
+                                     sizeof(sessionAttribs),
+                                     &sessionAttribs_size);
+    return_if_error(r, "Error");
+
+    r = iesys_crypto_hmac_update(cryptoContext, &sessionAttribs[0],
+                                 sessionAttribs_size);
+    return_if_error(r, "Error");
+
+    return TSS2_RC_SUCCESS;
+}
+
 /** Compute the HMAC for authorization.
  *
  * Based on the session nonces, caller nonce, TPM nonce, if used encryption and
  * decryption nonce, the command parameter hash, and the session attributes the
  * HMAC used for authorization is computed.
+ * @param[in,out] cache The crypto context cache (may be NULL).
  * @param[in] alg The hash algorithm used for HMAC computation.
  * @param[in] hmacKey The HMAC key byte buffer.
  * @param[in] hmacKeySize The size of the HMAC key byte buffer.
@@ -156,7 +668,8 @@ iesys_crypto_pHash(TPM2_ALG_ID alg,
  * @retval TSS2_ESYS_RC_BAD_REFERENCE If a pointer is invalid.
  */
 TSS2_RC
-iesys_crypto_authHmac(TPM2_ALG_ID alg,
+iesys_crypto_authHmac(IESYS_CRYPTO_CACHE * cache,
+                      TPM2_ALG_ID alg,
                       uint8_t * hmacKey, size_t hmacKeySize,
                       const uint8_t * pHash,
                       size_t pHash_size,
@@ -173,59 +686,88 @@ iesys_crypto_authHmac(TPM2_ALG_ID alg,
         return TSS2_ESYS_RC_BAD_REFERENCE;
     }
 
-    uint8_t sessionAttribs[sizeof(sessionAttributes)];
-    size_t sessionAttribs_size = 0;
-
     IESYS_CRYPTO_CONTEXT_BLOB *cryptoContext;
 
-    TSS2_RC r =
-        iesys_crypto_hmac_start(&cryptoContext, alg, hmacKey, hmacKeySize);
+    TSS2_RC r = iesys_crypto_cache_hmac_start(cache, &cryptoContext, alg,
+                                              hmacKey, hmacKeySize);
     return_if_error(r, "Error");
 
-    r = iesys_crypto_hmac_update(cryptoContext, pHash, pHash_size);
+    r = iesys_crypto_authHmac_update(cryptoContext, pHash, pHash_size,
+                                     nonceNewer, nonceOlder, nonceDecrypt,
+                                     nonceEncrypt, sessionAttributes);
     goto_if_error(r, "Error", error);
 
-    r = iesys_crypto_hmac_update2b(cryptoContext, (TPM2B *) nonceNewer);
-    goto_if_error(r, "Error", error);
-
-    r = iesys_crypto_hmac_update2b(cryptoContext, (TPM2B *) nonceOlder);
+    size_t hmac_size = hmac->size;
+    r = iesys_crypto_cache_hmac_finish(cache, alg, &cryptoContext,
+                                       &hmac->buffer[0], &hmac_size);
     goto_if_error(r, "Error", error);
+    hmac->size = hmac_size;
 
-    if (nonceDecrypt != NULL) {
-        r = iesys_crypto_hmac_update2b(cryptoContext, (TPM2B *) nonceDecrypt);
-        goto_if_error(r, "Error", error);
-    }
+    return r;
 
-    if (nonceEncrypt != NULL) {
-        r = iesys_crypto_hmac_update2b(cryptoContext, (TPM2B *) nonceEncrypt);
-        goto_if_error(r, "Error", error);
-    }
+ error:
+    iesys_crypto_hmac_abort(&cryptoContext);
+    return r;
 
-    r = Tss2_MU_TPMA_SESSION_Marshal(sessionAttributes,
-                                     &sessionAttribs[0],
-                                     sizeof(sessionAttribs),
-                                     &sessionAttribs_size);
-    goto_if_error(r, "Error", error);
+}
 
-    r = iesys_crypto_hmac_update(cryptoContext, &sessionAttribs[0],
-                                 sessionAttribs_size);
-    goto_if_error(r, "Error", error);
+/** Compute the HMAC for authorization with a keyed HMAC object.
+ *
+ * Same as iesys_crypto_authHmac, but the HMAC object already holds the key.
+ * It is reset to its keyed state, so only the message is hashed. The object
+ * stays owned by the caller.
+ * @param[in,out] cryptoContext The keyed HMAC object.
+ * @param[in] pHash The command parameter hash byte buffer.
+ * @param[in] pHash_size The size of the command parameter hash byte buffer.
+ * @param[in] nonceNewer The TPM nonce.
+ * @param[in] nonceOlder The caller nonce.
+ * @param[in] nonceDecrypt The decrypt nonce (NULL if not used).
+ * @param[in] nonceEncrypt The encrypt nonce (NULL if not used).
+ * @param[in] sessionAttributes The attributes used for the current
+ *            authentication.
+ * @param[out] hmac The computed HMAC.
+ * @retval TSS2_RC_SUCCESS on success
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE If a pointer is invalid.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_crypto_authHmac_keyed(IESYS_CRYPTO_CONTEXT_BLOB * cryptoContext,
+                            const uint8_t * pHash,
+                            size_t pHash_size,
+                            const TPM2B_NONCE * nonceNewer,
+                            const TPM2B_NONCE * nonceOlder,
+                            const TPM2B_NONCE * nonceDecrypt,
+                            const TPM2B_NONCE * nonceEncrypt,
+                            TPMA_SESSION sessionAttributes, TPM2B_AUTH * hmac)
+{
+    LOG_TRACE("called");
+    if (cryptoContext == NULL || pHash == NULL || nonceNewer == NULL ||
+        nonceOlder == NULL || hmac == NULL) {
+        LOG_ERROR("Null-Pointer passed");
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
 
-    r = iesys_crypto_hmac_finish2b(&cryptoContext, (TPM2B *) hmac);
-    goto_if_error(r, "Error", error);
+    TSS2_RC r = iesys_crypto_hmac_reset(cryptoContext);
+    return_if_error(r, "Reset HMAC");
 
-    return r;
+    r = iesys_crypto_authHmac_update(cryptoContext, pHash, pHash_size,
+                                     nonceNewer, nonceOlder, nonceDecrypt,
+                                     nonceEncrypt, sessionAttributes);
+    return_if_error(r, "Error");
 
- error:
-    iesys_crypto_hmac_abort(&cryptoContext);
-    return r;
+    size_t hmac_size = hmac->size;
+    r = iesys_crypto_hmac_final(cryptoContext, &hmac->buffer[0], &hmac_size);
+    return_if_error(r, "Error");
+    hmac->size = hmac_size;
 
+    return TSS2_RC_SUCCESS;
 }
 
 /**
  * HMAC computation for inner loop of KDFa key derivation.
  *
  * Except of ECDH this function is used for key derivation.
+ * @param[in,out] cache The crypto context cache (may be NULL).
  * @param[in] alg The algorithm used for the HMAC.
  * @param[in] hmacKey The hmacKey used in KDFa.
  * @param[in] hmacKeySize The size of the HMAC key.
@@ -240,7 +782,8 @@ iesys_crypto_authHmac(TPM2_ALG_ID alg,
  * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
  */
 TSS2_RC
-iesys_crypto_KDFaHmac(TPM2_ALG_ID alg,
+iesys_crypto_KDFaHmac(IESYS_CRYPTO_CACHE * cache,
+                      TPM2_ALG_ID alg,
                       uint8_t * hmacKey,
                       size_t hmacKeySize,
                       uint32_t counter,
@@ -260,8 +803,8 @@ iesys_crypto_KDFaHmac(TPM2_ALG_ID alg,
 
     IESYS_CRYPTO_CONTEXT_BLOB *cryptoContext;
 
-    TSS2_RC r =
-        iesys_crypto_hmac_start(&cryptoContext, alg, hmacKey, hmacKeySize);
+    TSS2_RC r = iesys_crypto_cache_hmac_start(cache, &cryptoContext, alg,
+                                              hmacKey, hmacKeySize);
     return_if_error(r, "Error");
 
     r = Tss2_MU_UINT32_Marshal(counter, &buffer32[0], sizeof(UINT32),
@@ -289,7 +832,8 @@ iesys_crypto_KDFaHmac(TPM2_ALG_ID alg,
     r = iesys_crypto_hmac_update(cryptoContext, &buffer32[0], buffer32_size);
     goto_if_error(r, "Error", error);
 
-    r = iesys_crypto_hmac_finish(&cryptoContext, hmac, hmacSize);
+    r = iesys_crypto_cache_hmac_finish(cache, alg, &cryptoContext, hmac,
+                                       hmacSize);
     goto_if_error(r, "Error", error);
 
     return r;
@@ -303,6 +847,7 @@ iesys_crypto_KDFaHmac(TPM2_ALG_ID alg,
  * KDFa Key derivation.
  *
  * Except of ECDH this function is used for key derivation.
+ * @param[in,out] cache The crypto context cache (may be NULL).
  * @param[in] hashAlg The hash algorithm to use.
  * @param[in] hmacKey The hmacKey used in KDFa.
  * @param[in] hmacKeySize The size of the HMAC key.
@@ -321,7 +866,8 @@ iesys_crypto_KDFaHmac(TPM2_ALG_ID alg,
  * @retval TSS2_ESYS_RC_BAD_VALUE if hashAlg is unknown or unsupported.
  */
 TSS2_RC
-iesys_crypto_KDFa(TPM2_ALG_ID hashAlg,
+iesys_crypto_KDFa(IESYS_CRYPTO_CACHE * cache,
+                  TPM2_ALG_ID hashAlg,
                   uint8_t * hmacKey,
                   size_t hmacKeySize,
                   const char *label,
@@ -359,7 +905,7 @@ iesys_crypto_KDFa(TPM2_ALG_ID hashAlg,
         //if(bytes < (INT32)hlen)
         //    hlen = bytes;
         counter++;
-        r = iesys_crypto_KDFaHmac(hashAlg, hmacKey,
+        r = iesys_crypto_KDFaHmac(cache, hashAlg, hmacKey,
                                   hmacKeySize, counter, label, contextU,
                                   contextV, bitLength, &subKey[0], &hlen);
         return_if_error(r, "Error");
@@ -470,6 +1016,7 @@ iesys_crypto_KDFe(TPM2_ALG_ID hashAlg,
  * The application of this function to data encrypted with this function will
  * produce the origin data. The key for XOR obfuscation will be derived with
  * KDFa form the passed key the session nonces, and the hash algorithm.
+ * @param[in,out] cache The crypto context cache (may be NULL).
  * @param[in] hash_alg The algorithm used for key derivation.
  * @param[in] key key used for obfuscation
  * @param[in] key_size Key size in bits.
@@ -482,7 +1029,8 @@ iesys_crypto_KDFe(TPM2_ALG_ID hashAlg,
  * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
  */
 TSS2_RC
-iesys_xor_parameter_obfuscation(TPM2_ALG_ID hash_alg,
+iesys_xor_parameter_obfuscation(IESYS_CRYPTO_CACHE * cache,
+                                TPM2_ALG_ID hash_alg,
                                 uint8_t *key,
                                 size_t key_size,
                                 TPM2B_NONCE * contextU,
@@ -506,7 +1054,7 @@ iesys_xor_parameter_obfuscation(TPM2_ALG_ID hash_alg,
     r = iesys_crypto_hash_get_digest_size(hash_alg, &digest_size);
     return_if_error(r, "Hash alg not supported");
     while(rest_size > 0) {
-        r = iesys_crypto_KDFa(hash_alg, key, key_size, "XOR",
+        r = iesys_crypto_KDFa(cache, hash_alg, key, key_size, "XOR",
                               contextU, contextV, data_size_bits, &counter,
                               kdfa_result, TRUE);
         return_if_error(r, "iesys_crypto_KDFa failed");
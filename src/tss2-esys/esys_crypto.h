@@ -6,7 +6,11 @@
 #ifndef ESYS_CRYPTO_H
 #define ESYS_CRYPTO_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#ifndef _WIN32
+#include <sys/types.h>
+#endif
 #include "tss2_tpm2_types.h"
 #include "tss2-sys/sysapi_util.h"
 #ifdef OSSL
@@ -21,9 +25,102 @@ extern "C" {
 
 #define AES_BLOCK_SIZE_IN_BYTES 16
 
+/** The number of hash algorithms with a slot in IESYS_CRYPTO_CACHE. */
+#define IESYS_CRYPTO_CACHE_SIZE 5
+
+/** Cache of initialized hash, HMAC and cipher contexts.
+ *
+ * One context per hash algorithm is kept and reset or rekeyed instead of
+ * being reallocated for every digest computation. The same holds for the
+ * cipher used for parameter encryption.
+ */
+typedef struct {
+    IESYS_CRYPTO_CONTEXT_BLOB *hash[IESYS_CRYPTO_CACHE_SIZE]; /**< The cached
+                                                digest objects. */
+    IESYS_CRYPTO_CONTEXT_BLOB *hmac[IESYS_CRYPTO_CACHE_SIZE]; /**< The cached
+                                                HMAC objects. */
+    IESYS_CRYPTO_CIPHER *cipher; /**< The cached AES cipher object. */
+} IESYS_CRYPTO_CACHE;
+
+TSS2_RC iesys_crypto_cache_hash_start(
+    IESYS_CRYPTO_CACHE *cache,
+    IESYS_CRYPTO_CONTEXT_BLOB **context,
+    TPM2_ALG_ID hashAlg);
+
+TSS2_RC iesys_crypto_cache_hash_finish(
+    IESYS_CRYPTO_CACHE *cache,
+    TPM2_ALG_ID hashAlg,
+    IESYS_CRYPTO_CONTEXT_BLOB **context,
+    uint8_t *buffer,
+    size_t *size);
+
+TSS2_RC iesys_crypto_cache_hmac_start(
+    IESYS_CRYPTO_CACHE *cache,
+    IESYS_CRYPTO_CONTEXT_BLOB **context,
+    TPM2_ALG_ID hmacAlg,
+    const uint8_t *key,
+    size_t size);
+
+TSS2_RC iesys_crypto_cache_hmac_finish(
+    IESYS_CRYPTO_CACHE *cache,
+    TPM2_ALG_ID hmacAlg,
+    IESYS_CRYPTO_CONTEXT_BLOB **context,
+    uint8_t *buffer,
+    size_t *size);
+
+void iesys_crypto_cache_free(IESYS_CRYPTO_CACHE *cache);
+
+/** The maximum and default number of random bytes drawn from the backend per
+ *  pool refill. */
+#ifndef IESYS_RANDOM_POOL_SIZE
+#define IESYS_RANDOM_POOL_SIZE 1024
+#endif
+
+/** The process ID type used to detect a fork. */
+#ifdef _WIN32
+typedef int IESYS_PID;
+#else
+typedef pid_t IESYS_PID;
+#endif
+
+/** Pool of random bytes for caller nonces and salts.
+ *
+ * The pool is filled from the crypto backend's random number generator
+ * refill_size bytes at a time instead of once per nonce. Bytes are wiped as
+ * they are handed out. A pool filled before a fork is discarded so that
+ * parent and child never hand out the same bytes. A zero-initialized pool is
+ * empty and refills IESYS_RANDOM_POOL_SIZE bytes at a time.
+ */
+typedef struct {
+    uint8_t buffer[IESYS_RANDOM_POOL_SIZE]; /**< The random bytes. The unused
+                                                 ones are at the end. */
+    size_t available;                       /**< The number of unused bytes. */
+    size_t refill_size;                     /**< The number of bytes drawn per
+                                                 refill, or 0 for
+                                                 IESYS_RANDOM_POOL_SIZE. */
+    IESYS_PID pid;                          /**< The process that filled the
+                                                 pool. */
+} IESYS_RANDOM_POOL;
+
+TSS2_RC iesys_crypto_random_pool_get(
+    IESYS_RANDOM_POOL *pool,
+    TPM2B_NONCE *nonce,
+    size_t num_bytes);
+
+TSS2_RC iesys_crypto_random_pool_set_size(
+    IESYS_RANDOM_POOL *pool,
+    size_t refill_size);
+
+void iesys_crypto_random_pool_free(IESYS_RANDOM_POOL *pool);
+
+bool iesys_crypto_pubkey_matches(
+    const TPMT_PUBLIC *cached,
+    const TPMT_PUBLIC *key);
+
 TSS2_RC iesys_crypto_hash_get_digest_size(TPM2_ALG_ID hashAlg, size_t *size);
 
 TSS2_RC iesys_crypto_pHash(
+    IESYS_CRYPTO_CACHE *cache,
     TPM2_ALG_ID alg,
     const uint8_t rcBuffer[4],
     const uint8_t ccBuffer[4],
@@ -35,17 +132,35 @@ TSS2_RC iesys_crypto_pHash(
     uint8_t *pHash,
     size_t *pHash_size);
 
-#define iesys_crypto_cpHash(alg, ccBuffer, name1, name2, name3, \
+#define iesys_crypto_cpHash(cache, alg, ccBuffer, name1, name2, name3, \
                             cpBuffer, cpBuffer_size, cpHash, cpHash_size) \
-        iesys_crypto_pHash(alg, NULL, ccBuffer, name1, name2, name3, cpBuffer, \
-                           cpBuffer_size, cpHash, cpHash_size)
-#define iesys_crypto_rpHash(alg, rcBuffer, ccBuffer, rpBuffer, rpBuffer_size, \
-                            rpHash, rpHash_size)                        \
-        iesys_crypto_pHash(alg, rcBuffer, ccBuffer, NULL, NULL, NULL, rpBuffer, \
-                           rpBuffer_size, rpHash, rpHash_size)
+        iesys_crypto_pHash(cache, alg, NULL, ccBuffer, name1, name2, name3, \
+                           cpBuffer, cpBuffer_size, cpHash, cpHash_size)
+#define iesys_crypto_rpHash(cache, alg, rcBuffer, ccBuffer, rpBuffer, \
+                            rpBuffer_size, rpHash, rpHash_size)         \
+        iesys_crypto_pHash(cache, alg, rcBuffer, ccBuffer, NULL, NULL, NULL, \
+                           rpBuffer, rpBuffer_size, rpHash, rpHash_size)
+
+/** The maximum number of digests computed by iesys_crypto_pHash_multi. */
+#define IESYS_CRYPTO_PHASH_MULTI_MAX IESYS_CRYPTO_CACHE_SIZE
+
+TSS2_RC iesys_crypto_pHash_multi(
+    IESYS_CRYPTO_CACHE *cache,
+    size_t count,
+    const TPM2_ALG_ID alg[],
+    const uint8_t rcBuffer[4],
+    const uint8_t ccBuffer[4],
+    const TPM2B_NAME *name1,
+    const TPM2B_NAME *name2,
+    const TPM2B_NAME *name3,
+    const uint8_t *pBuffer,
+    size_t pBuffer_size,
+    uint8_t *pHash[],
+    size_t *pHash_size[]);
 
 
 TSS2_RC iesys_crypto_authHmac(
+    IESYS_CRYPTO_CACHE *cache,
     TPM2_ALG_ID alg,
     uint8_t *hmacKey,
     size_t hmacKeySize,
@@ -58,7 +173,19 @@ TSS2_RC iesys_crypto_authHmac(
     TPMA_SESSION sessionAttributes,
     TPM2B_AUTH *hmac);
 
+TSS2_RC iesys_crypto_authHmac_keyed(
+    IESYS_CRYPTO_CONTEXT_BLOB *cryptoContext,
+    const uint8_t *pHash,
+    size_t pHash_size,
+    const TPM2B_NONCE *nonceNewer,
+    const TPM2B_NONCE *nonceOlder,
+    const TPM2B_NONCE *nonceDecrypt,
+    const TPM2B_NONCE *nonceEncrypt,
+    TPMA_SESSION sessionAttributes,
+    TPM2B_AUTH *hmac);
+
 TSS2_RC iesys_crypto_KDFaHmac(
+    IESYS_CRYPTO_CACHE *cache,
     TPM2_ALG_ID alg,
     uint8_t *hmacKey,
     size_t hmacKeySize,
@@ -71,6 +198,7 @@ TSS2_RC iesys_crypto_KDFaHmac(
     size_t *hmacSize);
 
 TSS2_RC iesys_crypto_KDFa(
+    IESYS_CRYPTO_CACHE *cache,
     TPM2_ALG_ID hashAlg,
     uint8_t *hmacKey,
     size_t hmacKeySize,
@@ -83,6 +211,7 @@ TSS2_RC iesys_crypto_KDFa(
     BOOL use_digest_size);
 
 TSS2_RC iesys_xor_parameter_obfuscation(
+    IESYS_CRYPTO_CACHE *cache,
     TPM2_ALG_ID hash_alg,
     uint8_t *key,
     size_t key_size,
@@ -178,28 +178,57 @@ iesys_cryptogcry_hash_update2b(IESYS_CRYPTO_CONTEXT_BLOB * context, TPM2B * b)
     return ret;
 }
 
-/** Get the digest value of a digest object and close the context.
+/** Reset a digest object for a new digest computation.
  *
- * The digest value will written to a passed buffer and the resources of the
- * digest object are released.
- * @param[in,out] context The context of the digest object to be released
+ * The context is re-initialized with its hash algorithm; the resources of
+ * the crypto library are reused.
+ * @param[in,out] context The context of the digest object.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ */
+TSS2_RC
+iesys_cryptogcry_hash_reset(IESYS_CRYPTO_CONTEXT_BLOB * context)
+{
+    LOG_TRACE("called for context %p", context);
+    if (context == NULL) {
+        LOG_ERROR("Null-Pointer passed");
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+    IESYS_CRYPTOGCRY_CONTEXT *mycontext = (IESYS_CRYPTOGCRY_CONTEXT *) context;
+    if (mycontext->type != IESYS_CRYPTOGCRY_TYPE_HASH) {
+        LOG_ERROR("bad context");
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+
+    gcry_md_reset(mycontext->hash.gcry_context);
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Get the digest value of a digest object without closing the context.
+ *
+ * The digest value will written to a passed buffer. The context has to be
+ * reset before it can be used for another digest computation.
+ * @param[in,out] context The context of the digest object.
  * @param[out] buffer The buffer for the digest value (caller-allocated).
  * @param[out] size The size of the digest.
  * @retval TSS2_RC_SUCCESS on success.
  * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_BAD_SIZE if the size passed is lower than the digest
+ *         length.
  * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
  */
 TSS2_RC
-iesys_cryptogcry_hash_finish(IESYS_CRYPTO_CONTEXT_BLOB ** context,
-                             uint8_t * buffer, size_t * size)
+iesys_cryptogcry_hash_final(IESYS_CRYPTO_CONTEXT_BLOB * context,
+                            uint8_t * buffer, size_t * size)
 {
-    LOG_TRACE("called for context-pointer %p, buffer %p and size-pointer %p",
+    LOG_TRACE("called for context %p, buffer %p and size-pointer %p",
               context, buffer, size);
-    if (context == NULL || *context == NULL || buffer == NULL || size == NULL) {
+    if (context == NULL || buffer == NULL || size == NULL) {
         LOG_ERROR("Null-Pointer passed");
         return TSS2_ESYS_RC_BAD_REFERENCE;
     }
-    IESYS_CRYPTOGCRY_CONTEXT *mycontext = * context;
+    IESYS_CRYPTOGCRY_CONTEXT *mycontext = (IESYS_CRYPTOGCRY_CONTEXT *) context;
     if (mycontext->type != IESYS_CRYPTOGCRY_TYPE_HASH) {
         LOG_ERROR("bad context");
         return TSS2_ESYS_RC_BAD_REFERENCE;
@@ -219,6 +248,35 @@ iesys_cryptogcry_hash_finish(IESYS_CRYPTO_CONTEXT_BLOB ** context,
     *size = mycontext->hash.hash_len;
     memmove(buffer, cpHash, *size);
 
+    return TSS2_RC_SUCCESS;
+}
+
+/** Get the digest value of a digest object and close the context.
+ *
+ * The digest value will written to a passed buffer and the resources of the
+ * digest object are released.
+ * @param[in,out] context The context of the digest object to be released
+ * @param[out] buffer The buffer for the digest value (caller-allocated).
+ * @param[out] size The size of the digest.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_cryptogcry_hash_finish(IESYS_CRYPTO_CONTEXT_BLOB ** context,
+                             uint8_t * buffer, size_t * size)
+{
+    LOG_TRACE("called for context-pointer %p, buffer %p and size-pointer %p",
+              context, buffer, size);
+    if (context == NULL || *context == NULL || buffer == NULL || size == NULL) {
+        LOG_ERROR("Null-Pointer passed");
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+
+    TSS2_RC r = iesys_cryptogcry_hash_final(*context, buffer, size);
+    return_if_error(r, "Finalize hash");
+
+    IESYS_CRYPTOGCRY_CONTEXT *mycontext = * context;
     gcry_md_close(mycontext->hash.gcry_context);
 
     free(mycontext);
@@ -384,10 +442,75 @@ iesys_cryptogcry_hmac_update2b(IESYS_CRYPTO_CONTEXT_BLOB * context, TPM2B * b)
     return ret;
 }
 
-/** Write the HMAC digest value to a byte buffer and close the context.
+/** Set the key of an HMAC digest object.
  *
- * The digest value will written to a passed buffer and the resources of the
- * HMAC object are released.
+ * Setting the key resets the HMAC state; the resources of the crypto library
+ * are reused.
+ * @param[in,out] context The context of the HMAC object.
+ * @param[in] key The byte buffer of the HMAC key.
+ * @param[in] size The size of the HMAC key.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_cryptogcry_hmac_rekey(IESYS_CRYPTO_CONTEXT_BLOB * context,
+                            const uint8_t * key, size_t size)
+{
+    LOG_TRACE("called for context %p", context);
+    if (context == NULL || key == NULL) {
+        LOG_ERROR("Null-Pointer passed");
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+    IESYS_CRYPTOGCRY_CONTEXT *mycontext = (IESYS_CRYPTOGCRY_CONTEXT *) context;
+    if (mycontext->type != IESYS_CRYPTOGCRY_TYPE_HMAC) {
+        LOG_ERROR("bad context");
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+
+    if (gcry_mac_setkey(mycontext->hmac.gcry_context, key, size) != 0) {
+        LOG_ERROR("GCry error.");
+        return TSS2_ESYS_RC_GENERAL_FAILURE;
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Reset an HMAC digest object to the state after setting its key.
+ *
+ * gcrypt keeps the keyed inner and outer midstates of the HMAC, so the key
+ * schedule does not have to be recomputed for another HMAC with the same key.
+ * @param[in,out] context The context of the HMAC object.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_cryptogcry_hmac_reset(IESYS_CRYPTO_CONTEXT_BLOB * context)
+{
+    LOG_TRACE("called for context %p", context);
+    if (context == NULL) {
+        LOG_ERROR("Null-Pointer passed");
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+    IESYS_CRYPTOGCRY_CONTEXT *mycontext = (IESYS_CRYPTOGCRY_CONTEXT *) context;
+    if (mycontext->type != IESYS_CRYPTOGCRY_TYPE_HMAC) {
+        LOG_ERROR("bad context");
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+
+    if (gcry_mac_reset(mycontext->hmac.gcry_context) != 0) {
+        LOG_ERROR("GCry error.");
+        return TSS2_ESYS_RC_GENERAL_FAILURE;
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Write the HMAC digest value to a byte buffer without closing the context.
+ *
+ * The context has to be reset or rekeyed before it can be used for another
+ * HMAC computation.
  * @param[in,out] context The context of the HMAC object.
  * @param[out] buffer The buffer for the digest value (caller-allocated).
  * @param[out] size The size of the digest.
@@ -397,17 +520,16 @@ iesys_cryptogcry_hmac_update2b(IESYS_CRYPTO_CONTEXT_BLOB * context, TPM2B * b)
  * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
  */
 TSS2_RC
-iesys_cryptogcry_hmac_finish(IESYS_CRYPTO_CONTEXT_BLOB ** context,
-                             uint8_t * buffer, size_t * size)
+iesys_cryptogcry_hmac_final(IESYS_CRYPTO_CONTEXT_BLOB * context,
+                            uint8_t * buffer, size_t * size)
 {
-    LOG_TRACE("called for context-pointer %p, buffer %p and size-pointer %p",
+    LOG_TRACE("called for context %p, buffer %p and size-pointer %p",
               context, buffer, size);
-    if (context == NULL || *context == NULL || buffer == NULL || size == NULL) {
+    if (context == NULL || buffer == NULL || size == NULL) {
         LOG_ERROR("Null-Pointer passed");
         return TSS2_ESYS_RC_BAD_REFERENCE;
     }
-    IESYS_CRYPTOGCRY_CONTEXT *mycontext =
-        (IESYS_CRYPTOGCRY_CONTEXT *) * context;
+    IESYS_CRYPTOGCRY_CONTEXT *mycontext = (IESYS_CRYPTOGCRY_CONTEXT *) context;
     if (mycontext->type != IESYS_CRYPTOGCRY_TYPE_HMAC) {
         LOG_ERROR("bad context");
         return TSS2_ESYS_RC_BAD_REFERENCE;
@@ -426,6 +548,37 @@ iesys_cryptogcry_hmac_finish(IESYS_CRYPTO_CONTEXT_BLOB ** context,
 
     LOGBLOB_TRACE(buffer, *size, "read hmac result");
 
+    return TSS2_RC_SUCCESS;
+}
+
+/** Write the HMAC digest value to a byte buffer and close the context.
+ *
+ * The digest value will written to a passed buffer and the resources of the
+ * HMAC object are released.
+ * @param[in,out] context The context of the HMAC object.
+ * @param[out] buffer The buffer for the digest value (caller-allocated).
+ * @param[out] size The size of the digest.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_BAD_SIZE If the size passed is lower than the HMAC length.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_cryptogcry_hmac_finish(IESYS_CRYPTO_CONTEXT_BLOB ** context,
+                             uint8_t * buffer, size_t * size)
+{
+    LOG_TRACE("called for context-pointer %p, buffer %p and size-pointer %p",
+              context, buffer, size);
+    if (context == NULL || *context == NULL || buffer == NULL || size == NULL) {
+        LOG_ERROR("Null-Pointer passed");
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+
+    TSS2_RC r = iesys_cryptogcry_hmac_final(*context, buffer, size);
+    return_if_error(r, "Finalize hmac");
+
+    IESYS_CRYPTOGCRY_CONTEXT *mycontext =
+        (IESYS_CRYPTOGCRY_CONTEXT *) * context;
     gcry_mac_close(mycontext->hmac.gcry_context);
 
     free(mycontext);
@@ -487,6 +640,26 @@ iesys_cryptogcry_hmac_abort(IESYS_CRYPTO_CONTEXT_BLOB ** context)
     }
 }
 
+/** Compute random bytes.
+ *
+ * @param[out] buffer The buffer for the random data (caller-allocated).
+ * @param[in] size The number of bytes to be generated.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE If buffer is NULL.
+ */
+TSS2_RC
+iesys_cryptogcry_get_random(uint8_t * buffer, size_t size)
+{
+    if (!buffer) return TSS2_ESYS_RC_BAD_REFERENCE;
+
+    /*
+     * possible values for random level:
+     *  GCRY_WEAK_RANDOM GCRY_STRONG_RANDOM  GCRY_VERY_STRONG_RANDOM
+     */
+    gcry_randomize(buffer, size, GCRY_STRONG_RANDOM);
+    return TSS2_RC_SUCCESS;
+}
+
 /** Compute random TPM2B data.
  *
  * The random data will be generated and written to a passed TPM2B structure.
@@ -504,18 +677,190 @@ iesys_cryptogcry_random2b(TPM2B_NONCE * nonce, size_t num_bytes)
     } else {
         nonce->size = num_bytes;
     }
-    /*
-     * possible values for random level:
-     *  GCRY_WEAK_RANDOM GCRY_STRONG_RANDOM  GCRY_VERY_STRONG_RANDOM
-     */
-    gcry_randomize(&nonce->buffer[0], nonce->size, GCRY_STRONG_RANDOM);
+    return iesys_cryptogcry_get_random(&nonce->buffer[0], nonce->size);
+}
+
+/** Context for a TPM public key converted to gcrypt objects.
+ *
+ * The conversion is kept with the key's resource object so that repeated
+ * salted sessions with the same tpmKey don't convert the key every time.
+ */
+typedef struct _IESYS_CRYPTO_PUBKEY {
+    TPMT_PUBLIC public;      /**< The public area the objects were built from. */
+    gcry_sexp_t sexp_key;    /**< The RSA public key, or NULL for ECC keys. */
+    gcry_ctx_t ec_ctx;       /**< The curve of an ECC key, or NULL. */
+    gcry_mpi_point_t point;  /**< The public point of an ECC key, or NULL. */
+} IESYS_CRYPTO_PUBKEY;
+
+/** Release a converted public key.
+ *
+ * @param[in,out] pubkey The converted key. (Will be freed and set to NULL.)
+ */
+void
+iesys_cryptogcry_pubkey_free(IESYS_CRYPTO_PUBKEY ** pubkey)
+{
+    if (pubkey == NULL || *pubkey == NULL)
+        return;
+
+    gcry_sexp_release((*pubkey)->sexp_key);
+    gcry_mpi_point_release((*pubkey)->point);
+    gcry_ctx_release((*pubkey)->ec_ctx);
+    SAFE_FREE(*pubkey);
+}
+
+/** Get the gcrypt name and the coordinate size of a TPM curve.
+ *
+ * @param[in] curve The TPM curve.
+ * @param[out] curveId The quoted curve name for gcrypt sexps.
+ * @param[out] size The size of a coordinate in bytes.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_VALUE The curve is not supported.
+ */
+static TSS2_RC
+iesys_cryptogcry_curve(TPMI_ECC_CURVE curve, const char **curveId,
+                       size_t *size)
+{
+    switch (curve) {
+    case TPM2_ECC_NIST_P192:
+        *curveId = "\"NIST P-192\"";
+        *size = (192+7)/8;
+        break;
+    case TPM2_ECC_NIST_P224:
+        *curveId = "\"NIST P-224\"";
+        *size = (224+7)/8;
+        break;
+    case TPM2_ECC_NIST_P256:
+        *curveId = "\"NIST P-256\"";
+        *size = (256+7)/8;
+        break;
+    case TPM2_ECC_NIST_P384:
+        *curveId = "\"NIST P-384\"";
+        *size = (384+7)/8;
+        break;
+    case TPM2_ECC_NIST_P521:
+        *curveId = "\"NIST P-521\"";
+        *size = (521+7)/8;
+        break;
+    default:
+        LOG_ERROR("Illegal ECC curve ID");
+        return TSS2_ESYS_RC_BAD_VALUE;
+    }
     return TSS2_RC_SUCCESS;
 }
 
+/** Get the gcrypt objects for a TPM public key.
+ *
+ * A conversion in *pubkey is reused if it was built from the same key
+ * material. Otherwise it is replaced with a new conversion of key.
+ * @param[in,out] pubkey The converted key (*pubkey may be NULL).
+ * @param[in] key The TPM public key.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_VALUE The key type or curve is not supported.
+ * @retval TSS2_ESYS_RC_MEMORY Memory can not be allocated.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE The internal crypto engine failed.
+ */
+static TSS2_RC
+iesys_cryptogcry_pubkey_get(IESYS_CRYPTO_PUBKEY **pubkey, TPM2B_PUBLIC *key)
+{
+/*
+ * Format strings for some gcrypt sexps have to be created with sprintf due to
+ * a bug in libgcrypt. %s does not work in libgcypt with these sexps.
+ */
+#define SEXP_ECC_POINT "(ecc (curve %s) (q.x  %sb) (q.y %sb))"
+
+    TSS2_RC r;
+    IESYS_CRYPTO_PUBKEY *converted;
+    BYTE exponent[4] = { 0x00, 0x01, 0x00, 0x01 };
+    gcry_sexp_t sexp_point = NULL;
+    const char *curveId;
+    size_t offset = 0;
+    size_t size;
+    UINT32 exp;
+
+    if (*pubkey != NULL) {
+        if (iesys_crypto_pubkey_matches(&(*pubkey)->public, &key->publicArea))
+            return TSS2_RC_SUCCESS;
+        iesys_cryptogcry_pubkey_free(pubkey);
+    }
+
+    converted = calloc(1, sizeof(IESYS_CRYPTO_PUBKEY));
+    return_if_null(converted, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+    converted->public = key->publicArea;
+
+    switch (key->publicArea.type) {
+    case TPM2_ALG_RSA:
+        if (key->publicArea.parameters.rsaDetail.exponent == 0)
+            exp = 65537;
+        else
+            exp = key->publicArea.parameters.rsaDetail.exponent;
+        r = Tss2_MU_UINT32_Marshal(exp, &exponent[0], sizeof(UINT32), &offset);
+        goto_if_error(r, "Marshaling", error);
+
+        if (gcry_sexp_build(&converted->sexp_key, NULL,
+                            "(public-key (rsa (n %b) (e %b)))",
+                            (int)key->publicArea.unique.rsa.size,
+                            &key->publicArea.unique.rsa.buffer[0],
+                            4, exponent) != GPG_ERR_NO_ERROR) {
+            goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
+                       "Function gcry_sexp_build", error);
+        }
+        break;
+    case TPM2_ALG_ECC:
+        r = iesys_cryptogcry_curve(key->publicArea.parameters.eccDetail.curveID,
+                                   &curveId, &size);
+        goto_if_error(r, "Unsupported curve", error);
+
+        { /* scope for sexp_format */
+            char sexp_format [sizeof(SEXP_ECC_POINT) + strlen(curveId)
+                              - 4];  /* -4 = (-2 for %s -2 for 2*%sb) */
+
+            if (sprintf(&sexp_format[0], SEXP_ECC_POINT,
+                        curveId, "%", "%") < 1) {
+                goto_error(r, TSS2_ESYS_RC_MEMORY, "sprintf", error);
+            }
+
+            if (gcry_sexp_build(&sexp_point, NULL, sexp_format,
+                                key->publicArea.unique.ecc.x.size,
+                                &key->publicArea.unique.ecc.x.buffer[0],
+                                key->publicArea.unique.ecc.y.size,
+                                &key->publicArea.unique.ecc.y.buffer[0])) {
+                goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
+                           "Function gcry_sexp_build", error);
+            }
+        }
+
+        if (gcry_mpi_ec_new(&converted->ec_ctx, sexp_point, curveId)) {
+            goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "create ec curve",
+                       error);
+        }
+        converted->point = gcry_mpi_ec_get_point("q", converted->ec_ctx, 1);
+        if (converted->point == NULL) {
+            goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "Get ecc point",
+                       error);
+        }
+        gcry_sexp_release(sexp_point);
+        break;
+    default:
+        LOG_ERROR("Key type not implemented");
+        r = TSS2_ESYS_RC_BAD_VALUE;
+        goto error;
+    }
+
+    *pubkey = converted;
+    return TSS2_RC_SUCCESS;
+
+ error:
+    gcry_sexp_release(sexp_point);
+    iesys_cryptogcry_pubkey_free(&converted);
+    return r;
+}
+
 /** Encryption of a buffer using a public (RSA) key.
  *
  * Encrypting a buffer using a public key is used for example during
  * Esys_StartAuthSession in order to encrypt the salt value.
+ * @param[in,out] pubkey The converted key (may be NULL, then a temporary
+ *                conversion is used).
  * @param[in] key The key to be used for encryption.
  * @param[in] in_size The size of the buffer to be encrypted.
  * @param[in] in_buffer The data buffer to be encrypted.
@@ -528,7 +873,8 @@ iesys_cryptogcry_random2b(TPM2B_NONCE * nonce, size_t num_bytes)
  * @retval TSS2_ESYS_RC_GENERAL_FAILURE The internal crypto engine failed.
  */
 TSS2_RC
-iesys_cryptogcry_pk_encrypt(TPM2B_PUBLIC * key,
+iesys_cryptogcry_pk_encrypt(IESYS_CRYPTO_PUBKEY ** pubkey,
+                            TPM2B_PUBLIC * key,
                             size_t in_size,
                             BYTE * in_buffer,
                             size_t max_out_size,
@@ -539,11 +885,11 @@ iesys_cryptogcry_pk_encrypt(TPM2B_PUBLIC * key,
     gcry_error_t err;
     char *hash_alg;
     size_t lsize = 0;
-    BYTE exponent[4] = { 0x00, 0x01, 0x00, 0x01 };
     char *padding;
-    gcry_sexp_t sexp_data, sexp_key, sexp_cipher, sexp_cipher_a;
+    IESYS_CRYPTO_PUBKEY *tmp_pubkey = NULL;
+    gcry_sexp_t sexp_data, sexp_cipher, sexp_cipher_a;
     padding = NULL; hash_alg = NULL; err = 0; r = 0;
-    sexp_data = NULL; sexp_key = NULL; sexp_cipher = NULL; sexp_cipher_a = NULL;   
+    sexp_data = NULL; sexp_cipher = NULL; sexp_cipher_a = NULL;
     
     if (!key || !in_buffer || !out_buffer || !out_size) return TSS2_ESYS_RC_BAD_REFERENCE;
 
@@ -574,16 +920,14 @@ iesys_cryptogcry_pk_encrypt(TPM2B_PUBLIC * key,
         LOG_ERROR("Illegal RSA scheme");
         return TSS2_ESYS_RC_BAD_VALUE;
     }
-    size_t offset = 0;
-    UINT32 exp;
-    if (key->publicArea.parameters.rsaDetail.exponent == 0)
-        exp = 65537;
-    else
-        exp = key->publicArea.parameters.rsaDetail.exponent;
-    r = Tss2_MU_UINT32_Marshal(exp, &exponent[0], sizeof(UINT32), &offset);
-    if (r != TSS2_RC_SUCCESS) {
-        LOG_ERROR("Marshaling");
-        return r;
+    if (pubkey == NULL)
+        pubkey = &tmp_pubkey;
+    r = iesys_cryptogcry_pubkey_get(pubkey, key);
+    return_if_error(r, "Convert TPM public key");
+    if ((*pubkey)->sexp_key == NULL) {
+        iesys_cryptogcry_pubkey_free(&tmp_pubkey);
+        LOG_ERROR("Not an RSA key");
+        return TSS2_ESYS_RC_BAD_VALUE;
     }
     err = gcry_sexp_build(&sexp_data, NULL,
                           "(data (flags %s) (hash-algo %s) (label %b) (value %b) )",
@@ -591,19 +935,10 @@ iesys_cryptogcry_pk_encrypt(TPM2B_PUBLIC * key,
                           in_buffer);
     if (err != GPG_ERR_NO_ERROR) {
         LOG_ERROR("Function gcry_sexp_build");
+        iesys_cryptogcry_pubkey_free(&tmp_pubkey);
         return TSS2_ESYS_RC_GENERAL_FAILURE;
     }
-    err = gcry_sexp_build(&sexp_key, NULL, "(public-key (rsa (n %b) (e %b)))",
-                          (int)key->publicArea.unique.rsa.size,
-                          &key->publicArea.unique.rsa.buffer[0], 4, exponent);
-    if (err != GPG_ERR_NO_ERROR) {
-        LOG_ERROR("Function gcry_sexp_build");
-
-        SAFE_FREE(sexp_data);
-
-        return TSS2_ESYS_RC_GENERAL_FAILURE;
-    }
-    err = gcry_pk_encrypt(&sexp_cipher, sexp_data, sexp_key);
+    err = gcry_pk_encrypt(&sexp_cipher, sexp_data, (*pubkey)->sexp_key);
     if (err != GPG_ERR_NO_ERROR) {
         fprintf (stderr, "Failure: %s/%s\n",
                  gcry_strsource (err),
@@ -611,7 +946,7 @@ iesys_cryptogcry_pk_encrypt(TPM2B_PUBLIC * key,
         LOG_ERROR("Function gcry_pk_encrypt");
 
         SAFE_FREE(sexp_data);
-        SAFE_FREE(sexp_key);
+        iesys_cryptogcry_pubkey_free(&tmp_pubkey);
 
         return TSS2_ESYS_RC_GENERAL_FAILURE;
     }
@@ -620,23 +955,24 @@ iesys_cryptogcry_pk_encrypt(TPM2B_PUBLIC * key,
 
     if (!mpi_cipher) {
         SAFE_FREE(sexp_data);
-        SAFE_FREE(sexp_key);
         SAFE_FREE(sexp_cipher);
         SAFE_FREE(sexp_cipher_a);
+        iesys_cryptogcry_pubkey_free(&tmp_pubkey);
         return TSS2_ESYS_RC_GENERAL_FAILURE;
     }
 
     err = mpi2bin(mpi_cipher, &out_buffer[0], key->publicArea.unique.rsa.size, max_out_size);
     if (err != GPG_ERR_NO_ERROR) {
         LOG_ERROR("Function gcry_mpi_print");
+        iesys_cryptogcry_pubkey_free(&tmp_pubkey);
         return TSS2_ESYS_RC_GENERAL_FAILURE;
     }
 
     *out_size = key->publicArea.unique.rsa.size;
     free(sexp_data);
-    free(sexp_key);
     free(sexp_cipher);
     free(sexp_cipher_a);
+    iesys_cryptogcry_pubkey_free(&tmp_pubkey);
     return TSS2_RC_SUCCESS;
 }
 
@@ -645,6 +981,8 @@ iesys_cryptogcry_pk_encrypt(TPM2B_PUBLIC * key,
  * According to the description in  TPM spec part 1 C 6.1 a shared secret
  * between application and TPM is computed (ECDH). An ephemeral ECC key and a
  * TPM keyare used for the ECDH key exchange.
+ * @param[in,out] pubkey The converted key of the TPM key (may be NULL, then a
+ *                temporary conversion is used).
  * @param[in] key The key to be used for ECDH key exchange.
  * @param[in] max_out_size the max size for the output of the public key of the
  *            computed ephemeral key.
@@ -658,7 +996,8 @@ iesys_cryptogcry_pk_encrypt(TPM2B_PUBLIC * key,
  * @retval TSS2_ESYS_RC_GENERAL_FAILURE The internal crypto engine failed.
  */
 TSS2_RC
-iesys_cryptogcry_get_ecdh_point(TPM2B_PUBLIC *key,
+iesys_cryptogcry_get_ecdh_point(IESYS_CRYPTO_PUBKEY **pubkey,
+                                TPM2B_PUBLIC *key,
                                 size_t max_out_size,
                                 TPM2B_ECC_PARAMETER *Z,
                                 TPMS_ECC_POINT *Q,
@@ -670,18 +1009,17 @@ iesys_cryptogcry_get_ecdh_point(TPM2B_PUBLIC *key,
  * a bug in libgcrypt. %s does not work in libgcypt with these sexps.
  */
 #define SEXP_GENKEY_ECC  "(genkey (ecc (curve %s)))"
-#define SEXP_ECC_POINT "(ecc (curve %s) (q.x  %sb) (q.y %sb))"
 
     TSS2_RC r;
-    char *curveId;
-    gcry_sexp_t mpi_tpm_sq = NULL;     /* sexp for public part of TPM  key*/
+    const char *curveId;
+    IESYS_CRYPTO_PUBKEY *tmp_pubkey = NULL;
     gcry_sexp_t mpi_sd = NULL;         /* sexp for private part of ephemeral key */
     gcry_sexp_t mpi_s_pub_q = NULL;    /* sexp for public part of ephemeral key */
     gcry_mpi_point_t mpi_q = NULL;     /* public point of ephemeral key */
-    gcry_mpi_point_t mpi_tpm_q = NULL; /* public point of TPM key */
     gcry_mpi_t mpi_d = NULL;           /* private part of ephemeral key */
     gcry_mpi_point_t mpi_qd = NULL;    /* result of mpi_tpm_q * mpi_d */
     gcry_ctx_t ctx = NULL;             /* context for ec curves */
+    gcry_sexp_t ekey_spec = NULL, ekey_pair = NULL;
     size_t offset = 0;
     gcry_mpi_t mpi_x = gcry_mpi_new(521);  /* big number for x coordinate */
     gcry_mpi_t mpi_y = gcry_mpi_new(521);  /* big number for y coordinate */
@@ -690,34 +1028,20 @@ iesys_cryptogcry_get_ecdh_point(TPM2B_PUBLIC *key,
     if (!key || !Z || !Q ) return TSS2_ESYS_RC_BAD_REFERENCE;
 
     /* Set libcrypt constant for curve type */
-    switch (key->publicArea.parameters.eccDetail.curveID) {
-    case TPM2_ECC_NIST_P192:
-        curveId = "\"NIST P-192\"";
-        max_ecc_size = (192+7)/8;
-        break;
-    case TPM2_ECC_NIST_P224:
-        curveId = "\"NIST P-224\"";
-        max_ecc_size = (224+7)/8;
-        break;
-    case TPM2_ECC_NIST_P256:
-        curveId = "\"NIST P-256\"";
-        max_ecc_size = (256+7)/8;
-        break;
-    case TPM2_ECC_NIST_P384:
-        curveId = "\"NIST P-384\"";
-        max_ecc_size = (384+7)/8;
-        break;
-    case TPM2_ECC_NIST_P521:
-        curveId = "\"NIST P-521\"";
-        max_ecc_size = (521+7)/8;
-        break;
-    default:
-        LOG_ERROR("Illegal ECC curve ID");
-        return TSS2_ESYS_RC_BAD_VALUE;
+    r = iesys_cryptogcry_curve(key->publicArea.parameters.eccDetail.curveID,
+                               &curveId, &max_ecc_size);
+    goto_if_error(r, "Unsupported curve", cleanup);
+
+    /* Get the curve and the public point of the TPM key */
+    if (pubkey == NULL)
+        pubkey = &tmp_pubkey;
+    r = iesys_cryptogcry_pubkey_get(pubkey, key);
+    goto_if_error(r, "Convert TPM public key", cleanup);
+    if ((*pubkey)->ec_ctx == NULL) {
+        goto_error(r, TSS2_ESYS_RC_BAD_VALUE, "Not an ECC key", cleanup);
     }
 
     /* compute ephemeral ecc key */
-    gcry_sexp_t ekey_spec = NULL, ekey_pair = NULL;
     { /* scope for sexp_ecc_key */
         char sexp_ecc_key [sizeof(SEXP_GENKEY_ECC)+strlen(curveId)
                            -1];  // -1 = (-2 for %s +1 for \0)
@@ -788,48 +1112,21 @@ iesys_cryptogcry_get_ecdh_point(TPM2B_PUBLIC *key,
     Q->x.size = max_ecc_size;
     Q->y.size = max_ecc_size;
     SAFE_FREE(ctx);
-    { /* scope for sexp_point */
 
-        /* Get public point from TPM key */
-        char sexp_point [sizeof(SEXP_ECC_POINT) + strlen(curveId)
-                         + key->publicArea.unique.ecc.x.size
-                         + key->publicArea.unique.ecc.y.size
-                         - 5];  /* -1 = (-4 for 2*%sb -2 for %s +1 for \0) */
-
-        if (sprintf(&sexp_point[0], SEXP_ECC_POINT,
-                    curveId, "%", "%") <1 ) {
-            goto_error(r, TSS2_ESYS_RC_MEMORY, "asprintf", cleanup);
-        }
-
-        if ( gcry_sexp_build(&mpi_tpm_sq, NULL,
-                              sexp_point,
-                              key->publicArea.unique.ecc.x.size,
-                              &key->publicArea.unique.ecc.x.buffer[0],
-                              key->publicArea.unique.ecc.y.size,
-                             &key->publicArea.unique.ecc.y.buffer[0])) {
-            goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                       "Function gcry_mpi_scan", cleanup);
-
-        }
-    }
     offset = 0;
     r = Tss2_MU_TPMS_ECC_POINT_Marshal(Q,  &out_buffer[0], max_out_size, &offset);
-    return_if_error(r, "Error marshaling");
+    goto_if_error(r, "Error marshaling", cleanup);
 
     if (out_size) {
         *out_size = offset;
     }
 
     /* Multiply d and Q */
-    if (gcry_mpi_ec_new (&ctx, mpi_tpm_sq, curveId)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "create ec curve", cleanup);
-    }
-    mpi_tpm_q =  gcry_mpi_ec_get_point ("q", ctx, 1);
     mpi_qd = gcry_mpi_point_new(256);
-    gcry_mpi_ec_mul(mpi_qd , mpi_d, mpi_tpm_q, ctx);
+    gcry_mpi_ec_mul(mpi_qd , mpi_d, (*pubkey)->point, (*pubkey)->ec_ctx);
 
     /* Store the x coordinate of d*Q in Z which will be used for KDFe */
-    if (gcry_mpi_ec_get_affine (mpi_x, mpi_y, mpi_qd, ctx)) {
+    if (gcry_mpi_ec_get_affine (mpi_x, mpi_y, mpi_qd, (*pubkey)->ec_ctx)) {
         goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
                    "Point is at infinity", cleanup);
     }
@@ -846,20 +1143,44 @@ iesys_cryptogcry_get_ecdh_point(TPM2B_PUBLIC *key,
     SAFE_FREE(ctx);
     SAFE_FREE(mpi_x);
     SAFE_FREE(mpi_y);
-    SAFE_FREE(mpi_tpm_q);
     SAFE_FREE(mpi_qd);
     SAFE_FREE(mpi_q);
-    SAFE_FREE(mpi_tpm_q);
-    SAFE_FREE(mpi_tpm_sq);
     SAFE_FREE(ekey_spec);
     SAFE_FREE(mpi_s_pub_q);
+    iesys_cryptogcry_pubkey_free(&tmp_pubkey);
 
     return r;
 }
 
+/** Cipher object for AES parameter encryption.
+ *
+ * The gcrypt cipher handle is kept between operations; it is only rekeyed
+ * if the cipher stays the same.
+ */
+typedef struct _IESYS_CRYPTO_CIPHER {
+    gcry_cipher_hd_t gcry_context; /**< The cipher handle, or NULL. */
+    int gcry_cipher_alg;           /**< The cipher of gcry_context. */
+} IESYS_CRYPTO_CIPHER;
+
+/** Release a cipher object.
+ *
+ * @param[in,out] cipher The cipher object. (Will be freed and set to NULL.)
+ */
+void
+iesys_cryptogcry_cipher_free(IESYS_CRYPTO_CIPHER ** cipher)
+{
+    if (cipher == NULL || *cipher == NULL)
+        return;
+
+    gcry_cipher_close((*cipher)->gcry_context);
+    SAFE_FREE(*cipher);
+}
+
 /** Initialize AES context for encryption / decryption.
  *
- * @param[out] handle for AES context
+ * The cipher object is created if *cipher is NULL. Its handle is only
+ * reopened if the cipher differs from the one of the last operation.
+ * @param[in,out] cipher The cipher object.
  * @param[in] key key used for AES.
  * @param[in] tpm_sym_alg AES type in TSS2 notation.
  * @param[in] key_bits Key size in bits.
@@ -868,11 +1189,11 @@ iesys_cryptogcry_get_ecdh_point(TPM2B_PUBLIC *key,
  * @param[in] iv_len Length of initialization vector (iv) in byte.
  * @param[in] iv The initialization vector.
  * @retval TSS2_RC_SUCCESS on success, or TSS2_ESYS_RC_BAD_VALUE for invalid
- *         parameters, TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto
- *         library.
+ *         parameters, TSS2_ESYS_RC_MEMORY if memory can not be allocated,
+ *         TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
  */
-TSS2_RC
-iesys_cryptogcry_sym_aes_init(gcry_cipher_hd_t * cipher_hd,
+static TSS2_RC
+iesys_cryptogcry_sym_aes_init(IESYS_CRYPTO_CIPHER ** cipher,
                               uint8_t * key,
                               TPM2_ALG_ID tpm_sym_alg,
                               TPMI_AES_KEY_BITS key_bits,
@@ -918,26 +1239,33 @@ iesys_cryptogcry_sym_aes_init(gcry_cipher_hd_t * cipher_hd,
         return TSS2_ESYS_RC_BAD_VALUE;
     }
     key_len = (len + 7) / 8;
-    err = gcry_cipher_open(cipher_hd, algo, mode, 0);
-    if (err != GPG_ERR_NO_ERROR) {
-        LOG_ERROR("Opening gcrypt context");
-        return TSS2_ESYS_RC_GENERAL_FAILURE;
+
+    if (*cipher == NULL) {
+        *cipher = calloc(1, sizeof(IESYS_CRYPTO_CIPHER));
+        return_if_null(*cipher, "Out of memory.", TSS2_ESYS_RC_MEMORY);
     }
-    if (iv_len != 0) {
-        err = gcry_cipher_setiv(*cipher_hd, &iv[0], iv_len);
+    if ((*cipher)->gcry_context == NULL ||
+        (*cipher)->gcry_cipher_alg != algo) {
+        gcry_cipher_close((*cipher)->gcry_context);
+        (*cipher)->gcry_context = NULL;
+        err = gcry_cipher_open(&(*cipher)->gcry_context, algo, mode, 0);
         if (err != GPG_ERR_NO_ERROR) {
-            LOG_ERROR("Function gcry_cipher_setiv");
+            (*cipher)->gcry_context = NULL;
+            LOG_ERROR("Opening gcrypt context");
             return TSS2_ESYS_RC_GENERAL_FAILURE;
         }
+        (*cipher)->gcry_cipher_alg = algo;
     }
 
-    if (!key) {
+    err = gcry_cipher_setkey((*cipher)->gcry_context, key, key_len);
+    if (err != GPG_ERR_NO_ERROR) {
+        LOG_ERROR("Function gcry_cipher_setkey");
         return TSS2_ESYS_RC_GENERAL_FAILURE;
     }
-
-    err = gcry_cipher_setkey(*cipher_hd, key, key_len);
+    /* Always set the iv; this also resets the state of the last operation */
+    err = gcry_cipher_setiv((*cipher)->gcry_context, &iv[0], iv_len);
     if (err != GPG_ERR_NO_ERROR) {
-        LOG_ERROR("Function gcry_cipher_setkey");
+        LOG_ERROR("Function gcry_cipher_setiv");
         return TSS2_ESYS_RC_GENERAL_FAILURE;
     }
     return TSS2_RC_SUCCESS;
@@ -945,6 +1273,9 @@ iesys_cryptogcry_sym_aes_init(gcry_cipher_hd_t * cipher_hd,
 
 /** Encrypt data with AES.
  *
+ * @param[in,out] cipher The cipher object to reuse, or NULL. It is created
+ *                if *cipher is NULL and released with
+ *                iesys_cryptogcry_cipher_free.
  * @param[in] key key used for AES.
  * @param[in] tpm_sym_alg AES type in TSS2 notation (must be TPM2_ALG_AES).
  * @param[in] key_bits Key size in bits.
@@ -956,10 +1287,12 @@ iesys_cryptogcry_sym_aes_init(gcry_cipher_hd_t * cipher_hd,
  * @param[in] iv The initialization vector. The size is equal to blk_len.
  * @retval TSS2_RC_SUCCESS on success, or TSS2_ESYS_RC_BAD_VALUE and
  * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters,
+ * @retval TSS2_ESYS_RC_MEMORY Memory can not be allocated.
  * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
  */
 TSS2_RC
-iesys_cryptogcry_sym_aes_encrypt(uint8_t * key,
+iesys_cryptogcry_sym_aes_encrypt(IESYS_CRYPTO_CIPHER ** cipher,
+                                 uint8_t * key,
                                  TPM2_ALG_ID tpm_sym_alg,
                                  TPMI_AES_KEY_BITS key_bits,
                                  TPM2_ALG_ID tpm_mode,
@@ -968,7 +1301,7 @@ iesys_cryptogcry_sym_aes_encrypt(uint8_t * key,
                                  size_t buffer_size,
                                  uint8_t * iv)
 {
-    gcry_cipher_hd_t cipher_hd;
+    IESYS_CRYPTO_CIPHER *tmp_cipher = NULL;
     gcry_error_t err;
     TSS2_RC r;
 
@@ -977,23 +1310,31 @@ iesys_cryptogcry_sym_aes_encrypt(uint8_t * key,
         return TSS2_ESYS_RC_BAD_REFERENCE;
     }
 
-    r = iesys_cryptogcry_sym_aes_init(&cipher_hd, key, tpm_sym_alg,
+    if (cipher == NULL)
+        cipher = &tmp_cipher;
+    r = iesys_cryptogcry_sym_aes_init(cipher, key, tpm_sym_alg,
                                       key_bits, tpm_mode, blk_len, iv);
     if (r != TSS2_RC_SUCCESS)
-        return r;
+        goto cleanup;
     LOGBLOB_TRACE(buffer, buffer_size, "IESYS AES input");
-    err = gcry_cipher_encrypt(cipher_hd, buffer, buffer_size, NULL, 0);
+    err = gcry_cipher_encrypt((*cipher)->gcry_context, buffer, buffer_size,
+                              NULL, 0);
     LOGBLOB_TRACE(buffer, buffer_size, "IESYS AES output");
     if (err != GPG_ERR_NO_ERROR) {
         LOG_ERROR("Function gcry_cipher_encrypt");
-        return TSS2_ESYS_RC_GENERAL_FAILURE;
+        r = TSS2_ESYS_RC_GENERAL_FAILURE;
     }
-    gcry_cipher_close(cipher_hd);
-    return TSS2_RC_SUCCESS;
+
+ cleanup:
+    iesys_cryptogcry_cipher_free(&tmp_cipher);
+    return r;
 }
 
 /** Decrypt data with AES.
  *
+ * @param[in,out] cipher The cipher object to reuse, or NULL. It is created
+ *                if *cipher is NULL and released with
+ *                iesys_cryptogcry_cipher_free.
  * @param[in] key key used for AES.
  * @param[in] tpm_sym_alg AES type in TSS2 notation (must be TPM2_ALG_AES).
  * @param[in] key_bits Key size in bits.
@@ -1005,10 +1346,12 @@ iesys_cryptogcry_sym_aes_encrypt(uint8_t * key,
  * @param[in] iv The initialization vector. The size is equal to blk_len.
  * @retval TSS2_RC_SUCCESS on success, or TSS2_ESYS_RC_BAD_VALUE and
  * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters,
+ * @retval TSS2_ESYS_RC_MEMORY Memory can not be allocated.
  * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
  */
 TSS2_RC
-iesys_cryptogcry_sym_aes_decrypt(uint8_t * key,
+iesys_cryptogcry_sym_aes_decrypt(IESYS_CRYPTO_CIPHER ** cipher,
+                                 uint8_t * key,
                                  TPM2_ALG_ID tpm_sym_alg,
                                  TPMI_AES_KEY_BITS key_bits,
                                  TPM2_ALG_ID tpm_mode,
@@ -1017,7 +1360,7 @@ iesys_cryptogcry_sym_aes_decrypt(uint8_t * key,
                                  size_t buffer_size,
                                  uint8_t * iv)
 {
-    gcry_cipher_hd_t cipher_hd;
+    IESYS_CRYPTO_CIPHER *tmp_cipher = NULL;
     gcry_error_t err;
     TSS2_RC r;
 
@@ -1031,17 +1374,22 @@ iesys_cryptogcry_sym_aes_decrypt(uint8_t * key,
         return TSS2_ESYS_RC_BAD_VALUE;
     }
 
-    r = iesys_cryptogcry_sym_aes_init(&cipher_hd, key, tpm_sym_alg,
+    if (cipher == NULL)
+        cipher = &tmp_cipher;
+    r = iesys_cryptogcry_sym_aes_init(cipher, key, tpm_sym_alg,
                                       key_bits, tpm_mode, blk_len, iv);
     if (r != TSS2_RC_SUCCESS)
-        return r;
-    err = gcry_cipher_decrypt(cipher_hd, buffer, buffer_size, NULL, 0);
+        goto cleanup;
+    err = gcry_cipher_decrypt((*cipher)->gcry_context, buffer, buffer_size,
+                              NULL, 0);
     if (err != GPG_ERR_NO_ERROR) {
         LOG_ERROR("Function gcry_cipher_decrypt");
-        return TSS2_ESYS_RC_GENERAL_FAILURE;
+        r = TSS2_ESYS_RC_GENERAL_FAILURE;
     }
-    gcry_cipher_close(cipher_hd);
-    return TSS2_RC_SUCCESS;
+
+ cleanup:
+    iesys_cryptogcry_cipher_free(&tmp_cipher);
+    return r;
 }
 
 /** Initialize gcrypt crypto backend.
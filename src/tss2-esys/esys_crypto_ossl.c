@@ -7,9 +7,15 @@
 #define _GNU_SOURCE
 
 #include <openssl/evp.h>
+#include <openssl/hmac.h>
 #include <openssl/aes.h>
 #include <openssl/rsa.h>
 #include <openssl/engine.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#endif
+#include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
 
 #include "tss2_esys.h"
@@ -25,16 +31,52 @@
 #include "esys_crypto_ossl.h"
 
 static ENGINE *engine = NULL;
+static pthread_once_t engine_once = PTHREAD_ONCE_INIT;
 
-ENGINE *get_engine()
+static void
+init_engine(void)
 {
-    if (engine)
-        return engine;
     engine = ENGINE_by_id("openssl");
+}
+
+/*
+ * OpenSSL 3 has no built-in "openssl" engine. The lookup then fails after
+ * trying to load a dynamic engine, so it is done only once, under a once-guard
+ * since contexts may be used from several threads.
+ */
+ENGINE *get_engine()
+{
+    pthread_once(&engine_once, init_engine);
     return engine;
 }
 
-int BN_bn2binpad(const BIGNUM *bn, unsigned char *bin, int bin_length)
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+static HMAC_CTX *
+HMAC_CTX_new(void)
+{
+    HMAC_CTX *ctx = OPENSSL_malloc(sizeof(*ctx));
+    if (ctx)
+        HMAC_CTX_init(ctx);
+    return ctx;
+}
+
+static void
+HMAC_CTX_free(HMAC_CTX *ctx)
+{
+    if (ctx) {
+        HMAC_CTX_cleanup(ctx);
+        OPENSSL_free(ctx);
+    }
+}
+#endif
+
+/*
+ * Local replacement of BN_bn2binpad, which older OpenSSL versions lack. It is
+ * static so it does not interpose the libcrypto symbol used internally by
+ * OpenSSL (e.g. for the RSA ciphertext length).
+ */
+static int
+iesys_bn2binpad(const BIGNUM *bn, unsigned char *bin, int bin_length)
 {
     if (!bn) return 0;
 
@@ -58,7 +100,11 @@ typedef struct _IESYS_CRYPTO_CONTEXT {
             size_t hash_len;
         } hash; /**< the state variables for a hash context */
         struct {
-            EVP_MD_CTX *ossl_context;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+            EVP_MAC_CTX *ossl_context;
+#else
+            HMAC_CTX *ossl_context;
+#endif
             const EVP_MD *ossl_hash_alg;
             size_t hmac_len;
         } hmac; /**< the state variables for an hmac context */
@@ -221,29 +267,61 @@ iesys_cryptossl_hash_update2b(IESYS_CRYPTO_CONTEXT_BLOB * context, TPM2B * b)
     return ret;
 }
 
-/** Get the digest value of a digest object and close the context.
+/** Reset a digest object for a new digest computation.
  *
- * The digest value will written to a passed buffer and the resources of the
- * digest object are released.
- * @param[in,out] context The context of the digest object to be released
+ * The context is re-initialized with its hash algorithm; the resources of
+ * the crypto library are reused.
+ * @param[in,out] context The context of the digest object.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_cryptossl_hash_reset(IESYS_CRYPTO_CONTEXT_BLOB * context)
+{
+    LOG_TRACE("called for context %p", context);
+    if (context == NULL) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Null-Pointer passed");
+    }
+    IESYS_CRYPTOSSL_CONTEXT *mycontext = (IESYS_CRYPTOSSL_CONTEXT *) context;
+    if (mycontext->type != IESYS_CRYPTOSSL_TYPE_HASH) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "bad context");
+    }
+
+    if (1 != EVP_DigestInit_ex(mycontext->hash.ossl_context,
+                               mycontext->hash.ossl_hash_alg,
+                               get_engine())) {
+        return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "Errror EVP_DigestInit_ex");
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Get the digest value of a digest object without closing the context.
+ *
+ * The digest value will written to a passed buffer. The context has to be
+ * reset before it can be used for another digest computation.
+ * @param[in,out] context The context of the digest object.
  * @param[out] buffer The buffer for the digest value (caller-allocated).
  * @param[out] size The size of the digest.
  * @retval TSS2_RC_SUCCESS on success.
  * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_BAD_SIZE if the size passed is lower than the digest
+ *         length.
  * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
  */
 TSS2_RC
-iesys_cryptossl_hash_finish(IESYS_CRYPTO_CONTEXT_BLOB ** context,
-                            uint8_t * buffer, size_t * size)
+iesys_cryptossl_hash_final(IESYS_CRYPTO_CONTEXT_BLOB * context,
+                           uint8_t * buffer, size_t * size)
 {
     unsigned int digest_size = 0;
 
-    LOG_TRACE("called for context-pointer %p, buffer %p and size-pointer %p",
+    LOG_TRACE("called for context %p, buffer %p and size-pointer %p",
               context, buffer, size);
-    if (context == NULL || *context == NULL || buffer == NULL || size == NULL) {
+    if (context == NULL || buffer == NULL || size == NULL) {
         return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Null-Pointer passed");
     }
-    IESYS_CRYPTOSSL_CONTEXT *mycontext = * context;
+    IESYS_CRYPTOSSL_CONTEXT *mycontext = (IESYS_CRYPTOSSL_CONTEXT *) context;
     if (mycontext->type != IESYS_CRYPTOSSL_TYPE_HASH) {
         return_error(TSS2_ESYS_RC_BAD_REFERENCE, "bad context");
     }
@@ -264,6 +342,35 @@ iesys_cryptossl_hash_finish(IESYS_CRYPTO_CONTEXT_BLOB ** context,
     LOGBLOB_TRACE(buffer, mycontext->hash.hash_len, "read hash result");
 
     *size = mycontext->hash.hash_len;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Get the digest value of a digest object and close the context.
+ *
+ * The digest value will written to a passed buffer and the resources of the
+ * digest object are released.
+ * @param[in,out] context The context of the digest object to be released
+ * @param[out] buffer The buffer for the digest value (caller-allocated).
+ * @param[out] size The size of the digest.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_cryptossl_hash_finish(IESYS_CRYPTO_CONTEXT_BLOB ** context,
+                            uint8_t * buffer, size_t * size)
+{
+    LOG_TRACE("called for context-pointer %p, buffer %p and size-pointer %p",
+              context, buffer, size);
+    if (context == NULL || *context == NULL || buffer == NULL || size == NULL) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Null-Pointer passed");
+    }
+
+    TSS2_RC r = iesys_cryptossl_hash_final(*context, buffer, size);
+    return_if_error(r, "Finalize hash");
+
+    IESYS_CRYPTOSSL_CONTEXT *mycontext = * context;
     EVP_MD_CTX_destroy(mycontext->hash.ossl_context);
     free(mycontext);
     *context = NULL;
@@ -298,6 +405,104 @@ iesys_cryptossl_hash_abort(IESYS_CRYPTO_CONTEXT_BLOB ** context)
 
 /* HMAC */
 
+/** Set the key of an HMAC digest object.
+ *
+ * The HMAC context of the crypto library is reused, thus no resources are
+ * allocated for the new key.
+ * @param[in,out] context The context of the HMAC object.
+ * @param[in] key The byte buffer of the HMAC key.
+ * @param[in] size The size of the HMAC key.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_BAD_SIZE if the key is too large.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_cryptossl_hmac_rekey(IESYS_CRYPTO_CONTEXT_BLOB * context,
+                           const uint8_t * key, size_t size)
+{
+    LOG_TRACE("called for context %p", context);
+    if (context == NULL || key == NULL) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Null-Pointer passed");
+    }
+    IESYS_CRYPTOSSL_CONTEXT *mycontext = (IESYS_CRYPTOSSL_CONTEXT *) context;
+    if (mycontext->type != IESYS_CRYPTOSSL_TYPE_HMAC) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "bad context");
+    }
+    if (size > INT_MAX) {
+        return_error(TSS2_ESYS_RC_BAD_SIZE, "HMAC key too large");
+    }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST,
+            (char *) EVP_MD_get0_name(mycontext->hmac.ossl_hash_alg), 0),
+        OSSL_PARAM_construct_end()
+    };
+
+    if (1 != EVP_MAC_init(mycontext->hmac.ossl_context, key, size, params)) {
+        return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "HMAC init");
+    }
+#else
+    if (1 != HMAC_Init_ex(mycontext->hmac.ossl_context, key, (int) size,
+                          mycontext->hmac.ossl_hash_alg, get_engine())) {
+        return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "HMAC init");
+    }
+#endif
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Reset an HMAC digest object to the state after setting its key.
+ *
+ * The crypto library keeps the keyed inner and outer midstates, so the key
+ * schedule does not have to be recomputed for another HMAC with the same key.
+ * @param[in,out] context The context of the HMAC object.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_cryptossl_hmac_reset(IESYS_CRYPTO_CONTEXT_BLOB * context)
+{
+    LOG_TRACE("called for context %p", context);
+    if (context == NULL) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Null-Pointer passed");
+    }
+    IESYS_CRYPTOSSL_CONTEXT *mycontext = (IESYS_CRYPTOSSL_CONTEXT *) context;
+    if (mycontext->type != IESYS_CRYPTOSSL_TYPE_HMAC) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "bad context");
+    }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    /* Without a key the provider reinitializes from the keyed midstates. */
+    if (1 != EVP_MAC_init(mycontext->hmac.ossl_context, NULL, 0, NULL)) {
+        return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "HMAC reset");
+    }
+#else
+    if (1 != HMAC_Init_ex(mycontext->hmac.ossl_context, NULL, 0, NULL, NULL)) {
+        return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "HMAC reset");
+    }
+#endif
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Release the HMAC context of an HMAC object and the object itself.
+ *
+ * @param[in] mycontext The HMAC object.
+ */
+static void
+iesys_cryptossl_hmac_free(IESYS_CRYPTOSSL_CONTEXT *mycontext)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    EVP_MAC_CTX_free(mycontext->hmac.ossl_context);
+#else
+    HMAC_CTX_free(mycontext->hmac.ossl_context);
+#endif
+    free(mycontext);
+}
+
 /** Provide the context an HMAC digest object from a byte buffer key.
  *
  * The context will be created and initialized according to the hash function
@@ -317,8 +522,6 @@ iesys_cryptossl_hmac_start(IESYS_CRYPTO_CONTEXT_BLOB ** context,
                            const uint8_t * key, size_t size)
 {
     TSS2_RC r = TSS2_RC_SUCCESS;
-    EVP_PKEY *hkey = NULL;
-
 
     LOG_TRACE("called for context-pointer %p and hmacAlg %d", context, hashAlg);
     LOGBLOB_TRACE(key, size, "Starting  hmac with");
@@ -339,34 +542,38 @@ iesys_cryptossl_hmac_start(IESYS_CRYPTO_CONTEXT_BLOB ** context,
                    "Unsupported hash algorithm (%"PRIu16")", cleanup, hashAlg);
     }
 
-    if (!(mycontext->hmac.ossl_context =  EVP_MD_CTX_create())) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    EVP_MAC *mac = EVP_MAC_fetch(NULL, OSSL_MAC_NAME_HMAC, NULL);
+    if (mac == NULL) {
         goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Error EVP_MD_CTX_create", cleanup);
+                   "Error EVP_MAC_fetch", cleanup);
     }
-
-    if (!(hkey = EVP_PKEY_new_mac_key(EVP_PKEY_HMAC, get_engine(), key, size))) {
+    /* The context holds its own reference to the MAC. */
+    mycontext->hmac.ossl_context = EVP_MAC_CTX_new(mac);
+    EVP_MAC_free(mac);
+    if (!mycontext->hmac.ossl_context) {
         goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "EVP_PKEY_new_mac_key", cleanup);
+                   "Error EVP_MAC_CTX_new", cleanup);
     }
-
-    if(1 != EVP_DigestSignInit(mycontext->hmac.ossl_context, NULL,
-                               mycontext->hmac.ossl_hash_alg, get_engine(), hkey)) {
+#else
+    if (!(mycontext->hmac.ossl_context = HMAC_CTX_new())) {
         goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "DigestSignInit", cleanup);
+                   "Error HMAC_CTX_new", cleanup);
     }
+#endif
 
     mycontext->type = IESYS_CRYPTOSSL_TYPE_HMAC;
 
+    r = iesys_cryptossl_hmac_rekey((IESYS_CRYPTO_CONTEXT_BLOB *) mycontext,
+                                   key, size);
+    goto_if_error(r, "Set HMAC key", cleanup);
+
     *context = (IESYS_CRYPTO_CONTEXT_BLOB *) mycontext;
 
     return TSS2_RC_SUCCESS;
 
  cleanup:
-    if (mycontext->hmac.ossl_context)
-        EVP_MD_CTX_destroy(mycontext->hmac.ossl_context);
-    if(hkey)
-        EVP_PKEY_free(hkey);
-    SAFE_FREE(mycontext);
+    iesys_cryptossl_hmac_free(mycontext);
     return r;
 }
 
@@ -397,9 +604,15 @@ iesys_cryptossl_hmac_update(IESYS_CRYPTO_CONTEXT_BLOB * context,
     LOGBLOB_TRACE(buffer, size, "Updating hmac with");
 
     /* Call update with the message */
-    if(1 != EVP_DigestSignUpdate(mycontext->hmac.ossl_context, buffer, size)) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    if(1 != EVP_MAC_update(mycontext->hmac.ossl_context, buffer, size)) {
         return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "OSSL HMAC update");
     }
+#else
+    if(1 != HMAC_Update(mycontext->hmac.ossl_context, buffer, size)) {
+        return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "OSSL HMAC update");
+    }
+#endif
 
     return TSS2_RC_SUCCESS;
 }
@@ -424,6 +637,59 @@ iesys_cryptossl_hmac_update2b(IESYS_CRYPTO_CONTEXT_BLOB * context, TPM2B * b)
     return ret;
 }
 
+/** Write the HMAC digest value to a byte buffer without closing the context.
+ *
+ * The context has to be reset or rekeyed before it can be used for another
+ * HMAC computation.
+ * @param[in,out] context The context of the HMAC object.
+ * @param[out] buffer The buffer for the digest value (caller-allocated).
+ * @param[out] size The size of the digest.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters.
+ * @retval TSS2_ESYS_RC_BAD_SIZE If the size passed is lower than the HMAC length.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+TSS2_RC
+iesys_cryptossl_hmac_final(IESYS_CRYPTO_CONTEXT_BLOB * context,
+                           uint8_t * buffer, size_t * size)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    size_t digest_size = 0;
+#else
+    unsigned int digest_size = 0;
+#endif
+
+    LOG_TRACE("called for context %p, buffer %p and size-pointer %p",
+              context, buffer, size);
+    if (context == NULL || buffer == NULL || size == NULL) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Null-Pointer passed");
+    }
+    IESYS_CRYPTOSSL_CONTEXT *mycontext = (IESYS_CRYPTOSSL_CONTEXT *) context;
+    if (mycontext->type != IESYS_CRYPTOSSL_TYPE_HMAC) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "bad context");
+    }
+
+    if (*size < mycontext->hmac.hmac_len) {
+        return_error(TSS2_ESYS_RC_BAD_SIZE, "Buffer too small");
+    }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    if (1 != EVP_MAC_final(mycontext->hmac.ossl_context, buffer, &digest_size,
+                           *size)) {
+        return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "HMAC final");
+    }
+#else
+    if (1 != HMAC_Final(mycontext->hmac.ossl_context, buffer, &digest_size)) {
+        return_error(TSS2_ESYS_RC_GENERAL_FAILURE, "HMAC final");
+    }
+#endif
+    *size = digest_size;
+
+    LOGBLOB_TRACE(buffer, *size, "read hmac result");
+
+    return TSS2_RC_SUCCESS;
+}
+
 /** Write the HMAC digest value to a byte buffer and close the context.
  *
  * The digest value will written to a passed buffer and the resources of the
@@ -458,15 +724,9 @@ iesys_cryptossl_hmac_finish(IESYS_CRYPTO_CONTEXT_BLOB ** context,
         return_error(TSS2_ESYS_RC_BAD_SIZE, "Buffer too small");
     }
 
-    if (1 != EVP_DigestSignFinal(mycontext->hmac.ossl_context, buffer, size)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "DigestSignFinal", cleanup);
-    }
-
-    LOGBLOB_TRACE(buffer, *size, "read hmac result");
+    r = iesys_cryptossl_hmac_final(*context, buffer, size);
 
- cleanup:
-    EVP_MD_CTX_destroy(mycontext->hmac.ossl_context);
-    SAFE_FREE(mycontext);
+    iesys_cryptossl_hmac_free(mycontext);
     *context = NULL;
     return r;
 }
@@ -516,13 +776,32 @@ iesys_cryptossl_hmac_abort(IESYS_CRYPTO_CONTEXT_BLOB ** context)
             return;
         }
 
-        EVP_MD_CTX_destroy(mycontext->hmac.ossl_context);
-
-        free(mycontext);
+        iesys_cryptossl_hmac_free(mycontext);
         *context = NULL;
     }
 }
 
+/** Compute random bytes.
+ *
+ * @param[out] buffer The buffer for the random data (caller-allocated).
+ * @param[in] size The number of bytes to be generated.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE If buffer is NULL.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE The internal crypto engine failed.
+ */
+TSS2_RC
+iesys_cryptossl_get_random(uint8_t * buffer, size_t size)
+{
+    if (!buffer) return TSS2_ESYS_RC_BAD_REFERENCE;
+
+    if (size > INT_MAX || 1 != RAND_bytes(buffer, (int) size)) {
+        return_error(TSS2_ESYS_RC_GENERAL_FAILURE,
+                     "Failure in random number generator.");
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
 /** Compute random TPM2B data.
  *
  * The random data will be generated and written to a passed TPM2B structure.
@@ -540,18 +819,255 @@ iesys_cryptossl_random2b(TPM2B_NONCE * nonce, size_t num_bytes)
     } else {
         nonce->size = num_bytes;
     }
-    if (1 != RAND_bytes(&nonce->buffer[0], nonce->size)) {
-        return_error(TSS2_ESYS_RC_GENERAL_FAILURE,
-                     "Failure in random number generator.");
+    return iesys_cryptossl_get_random(&nonce->buffer[0], nonce->size);
+}
+
+/** Computation of OSSL ec public point from TPM public point.
+ *
+ * @param[in] group The definition of the used ec curve.
+ * @param[in] key The TPM public key.
+ * @param[out] The TPM's public point in OSSL format.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE The internal crypto engine failed.
+ */
+TSS2_RC
+tpm_pub_to_ossl_pub(EC_GROUP *group, TPM2B_PUBLIC *key, EC_POINT **tpm_pub_key)
+{
+
+    TSS2_RC r = TSS2_RC_SUCCESS;
+    BIGNUM *bn_x = NULL;
+    BIGNUM *bn_y = NULL;
+    BN_CTX *bctx = NULL;
+
+    if (!tpm_pub_key || !key || !group) {
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Bad reference");
+    }
+
+    bctx = BN_CTX_new();
+
+    /* Create the big numbers for the coordinates of the point */
+    if (!(bn_x = BN_bin2bn(&key->publicArea.unique.ecc.x.buffer[0],
+                           key->publicArea.unique.ecc.x.size,
+                           NULL))) {
+        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
+                   "Create big num from byte buffer.", cleanup);
+    }
+
+    if (!(bn_y = BN_bin2bn(&key->publicArea.unique.ecc.y.buffer[0],
+                           key->publicArea.unique.ecc.y.size,
+                           NULL))) {
+        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
+                   "Create big num from byte buffer.", cleanup);
+    }
+
+    /* Create the ec point with the affine coordinates of the TPM point */
+    if (!(*tpm_pub_key = EC_POINT_new(group))) {
+        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
+                   "Create point.", cleanup);
     }
 
+    if (1 != EC_POINT_set_affine_coordinates_GFp(group,
+                                                 *tpm_pub_key, bn_x,
+                                                 bn_y, bctx)) {
+        OSSL_FREE(*tpm_pub_key, EC_POINT);
+        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
+                   "Set affine coordinates", cleanup);
+    }
+
+    if (1 != EC_POINT_is_on_curve(group, *tpm_pub_key, bctx)) {
+        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
+                   "The TPM point is not on the curve", cleanup);
+    }
+
+ cleanup:
+    OSSL_FREE(bn_x, BN);
+    OSSL_FREE(bn_y, BN);
+    OSSL_FREE(bctx, BN_CTX);
+
+    return r;
+}
+
+
+/** Context for a TPM public key converted to OSSL key objects.
+ *
+ * The conversion is kept with the key's resource object so that repeated
+ * salted sessions with the same tpmKey don't convert the key every time.
+ */
+typedef struct _IESYS_CRYPTO_PUBKEY {
+    TPMT_PUBLIC public;     /**< The public area the objects were built from. */
+    EVP_PKEY *rsa_key;      /**< The RSA key, or NULL for ECC keys. */
+    EC_GROUP *group;        /**< The curve of an ECC key, or NULL. */
+    EC_POINT *point;        /**< The public point of an ECC key, or NULL. */
+} IESYS_CRYPTO_PUBKEY;
+
+/** Release a converted public key.
+ *
+ * @param[in,out] pubkey The converted key. (Will be freed and set to NULL.)
+ */
+void
+iesys_cryptossl_pubkey_free(IESYS_CRYPTO_PUBKEY ** pubkey)
+{
+    if (pubkey == NULL || *pubkey == NULL)
+        return;
+
+    OSSL_FREE((*pubkey)->rsa_key, EVP_PKEY);
+    OSSL_FREE((*pubkey)->point, EC_POINT);
+    OSSL_FREE((*pubkey)->group, EC_GROUP);
+    SAFE_FREE(*pubkey);
+}
+
+/** Convert the modulus and exponent of a TPM RSA key to an OSSL key.
+ *
+ * @param[in] key The TPM public key.
+ * @param[out] evp_rsa_key The OSSL key.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_MEMORY Memory can not be allocated.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE The internal crypto engine failed.
+ */
+static TSS2_RC
+tpm_pub_to_ossl_rsa(TPM2B_PUBLIC *key, EVP_PKEY **evp_rsa_key)
+{
+    TSS2_RC r = TSS2_RC_SUCCESS;
+    RSA *rsa_key = NULL;
+    BIGNUM *n = NULL;
+    BIGNUM *e = NULL;
+    UINT32 exp;
+
+    if (key->publicArea.parameters.rsaDetail.exponent == 0)
+        exp = 65537;
+    else
+        exp = key->publicArea.parameters.rsaDetail.exponent;
+
+    if (!(e = BN_new()) || 1 != BN_set_word(e, exp)) {
+        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
+                   "Could not set exponent.", cleanup);
+    }
+
+    if (!(n = BN_bin2bn(key->publicArea.unique.rsa.buffer,
+                        key->publicArea.unique.rsa.size,
+                        NULL))) {
+        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
+                   "Could not create rsa n.", cleanup);
+    }
+
+    if (!(rsa_key = RSA_new())) {
+        goto_error(r, TSS2_ESYS_RC_MEMORY,
+                   "Could not allocate RSA key", cleanup);
+    }
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    rsa_key->n = n;
+    rsa_key->e = e;
+#else
+    if (1 != RSA_set0_key(rsa_key, n, e, NULL)) {
+        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
+                   "Could not set rsa n.", cleanup);
+    }
+#endif
+    /* n and e are owned by rsa_key now */
+    n = NULL;
+    e = NULL;
+
+    if (!(*evp_rsa_key = EVP_PKEY_new())) {
+        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
+                   "Could not create evp key.", cleanup);
+    }
+
+    if (1 != EVP_PKEY_set1_RSA(*evp_rsa_key, rsa_key)) {
+        OSSL_FREE(*evp_rsa_key, EVP_PKEY);
+        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
+                   "Could not set rsa key.", cleanup);
+    }
+
+ cleanup:
+    OSSL_FREE(rsa_key, RSA);
+    OSSL_FREE(n, BN);
+    OSSL_FREE(e, BN);
+    return r;
+}
+
+/** Get the OSSL key objects for a TPM public key.
+ *
+ * A conversion in *pubkey is reused if it was built from the same key
+ * material. Otherwise it is replaced with a new conversion of key.
+ * @param[in,out] pubkey The converted key (*pubkey may be NULL).
+ * @param[in] key The TPM public key.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_NOT_IMPLEMENTED The key type or curve is not supported.
+ * @retval TSS2_ESYS_RC_MEMORY Memory can not be allocated.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE The internal crypto engine failed.
+ */
+static TSS2_RC
+iesys_cryptossl_pubkey_get(IESYS_CRYPTO_PUBKEY **pubkey, TPM2B_PUBLIC *key)
+{
+    TSS2_RC r;
+    IESYS_CRYPTO_PUBKEY *converted;
+    int curveId;
+
+    if (*pubkey != NULL) {
+        if (iesys_crypto_pubkey_matches(&(*pubkey)->public, &key->publicArea))
+            return TSS2_RC_SUCCESS;
+        iesys_cryptossl_pubkey_free(pubkey);
+    }
+
+    converted = calloc(1, sizeof(IESYS_CRYPTO_PUBKEY));
+    return_if_null(converted, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+    converted->public = key->publicArea;
+
+    switch (key->publicArea.type) {
+    case TPM2_ALG_RSA:
+        r = tpm_pub_to_ossl_rsa(key, &converted->rsa_key);
+        goto_if_error(r, "Convert TPM RSA key", error);
+        break;
+    case TPM2_ALG_ECC:
+        switch (key->publicArea.parameters.eccDetail.curveID) {
+        case TPM2_ECC_NIST_P192:
+            curveId = NID_X9_62_prime192v1;
+            break;
+        case TPM2_ECC_NIST_P224:
+            curveId = NID_secp224r1;
+            break;
+        case TPM2_ECC_NIST_P256:
+            curveId = NID_X9_62_prime256v1;
+            break;
+        case TPM2_ECC_NIST_P384:
+            curveId = NID_secp384r1;
+            break;
+        case TPM2_ECC_NIST_P521:
+            curveId = NID_secp521r1;
+            break;
+        default:
+            goto_error(r, TSS2_ESYS_RC_NOT_IMPLEMENTED,
+                       "ECC curve not implemented.", error);
+        }
+
+        if (!(converted->group = EC_GROUP_new_by_curve_name(curveId))) {
+            goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
+                       "Create group for curve", error);
+        }
+
+        r = tpm_pub_to_ossl_pub(converted->group, key, &converted->point);
+        goto_if_error(r, "Convert TPM pub point to ossl pub point", error);
+        break;
+    default:
+        goto_error(r, TSS2_ESYS_RC_NOT_IMPLEMENTED,
+                   "Key type not implemented.", error);
+    }
+
+    *pubkey = converted;
     return TSS2_RC_SUCCESS;
+
+ error:
+    iesys_cryptossl_pubkey_free(&converted);
+    return r;
 }
 
 /** Encryption of a buffer using a public (RSA) key.
  *
  * Encrypting a buffer using a public key is used for example during
  * Esys_StartAuthSession in order to encrypt the salt value.
+ * @param[in,out] pubkey The converted key (may be NULL, then a temporary
+ *                conversion is used).
  * @param[in] key The key to be used for encryption.
  * @param[in] in_size The size of the buffer to be encrypted.
  * @param[in] in_buffer The data buffer to be encrypted.
@@ -564,7 +1080,8 @@ iesys_cryptossl_random2b(TPM2B_NONCE * nonce, size_t num_bytes)
  * @retval TSS2_ESYS_RC_GENERAL_FAILURE The internal crypto engine failed.
  */
 TSS2_RC
-iesys_cryptossl_pk_encrypt(TPM2B_PUBLIC * pub_tpm_key,
+iesys_cryptossl_pk_encrypt(IESYS_CRYPTO_PUBKEY ** pubkey,
+                           TPM2B_PUBLIC * pub_tpm_key,
                            size_t in_size,
                            BYTE * in_buffer,
                            size_t max_out_size,
@@ -573,14 +1090,11 @@ iesys_cryptossl_pk_encrypt(TPM2B_PUBLIC * pub_tpm_key,
 {
     TSS2_RC r = TSS2_RC_SUCCESS;
     const EVP_MD * hashAlg = NULL;
-    RSA * rsa_key = NULL;
-    EVP_PKEY *evp_rsa_key = NULL;
+    IESYS_CRYPTO_PUBKEY *tmp_pubkey = NULL;
     EVP_PKEY_CTX *ctx = NULL;
-    BIGNUM* bne = BN_new();
+    char *label_copy = NULL;
+    size_t label_size;
     int padding;
-#if OPENSSL_VERSION_NUMBER >= 0x10100000L
-    BIGNUM *n = NULL;
-#endif
 
     if (!pub_tpm_key || !in_buffer || !out_buffer || !out_size || !label) {
         return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Bad reference");
@@ -606,56 +1120,15 @@ iesys_cryptossl_pk_encrypt(TPM2B_PUBLIC * pub_tpm_key,
         goto_error(r, TSS2_ESYS_RC_BAD_VALUE, "Illegal RSA scheme", cleanup);
     }
 
-    UINT32 exp;
-    if (pub_tpm_key->publicArea.parameters.rsaDetail.exponent == 0)
-        exp = 65537;
-    else
-        exp = pub_tpm_key->publicArea.parameters.rsaDetail.exponent;
-    if (1 != BN_set_word(bne, exp)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Could not set exponent.", cleanup);
-    }
-
-    if (!(rsa_key = RSA_new())) {
-        goto_error(r, TSS2_ESYS_RC_MEMORY,
-                   "Could not allocate RSA key", cleanup);
-    }
-
-    if (1 != RSA_generate_key_ex(rsa_key,
-                                 pub_tpm_key->publicArea.parameters.rsaDetail.keyBits,
-                                 bne, NULL)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "Could not generate RSA key",
-                   cleanup);
-    }
-
-    if (!(evp_rsa_key = EVP_PKEY_new())) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Could not create evp key.", cleanup);
-    }
-#if OPENSSL_VERSION_NUMBER < 0x10100000L
-    rsa_key->n = BN_bin2bn(pub_tpm_key->publicArea.unique.rsa.buffer,
-                           pub_tpm_key->publicArea.unique.rsa.size,
-                           NULL);
-#else
-    if (!(n = BN_bin2bn(pub_tpm_key->publicArea.unique.rsa.buffer,
-                        pub_tpm_key->publicArea.unique.rsa.size,
-                        NULL))) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Could not create rsa n.", cleanup);
+    if (pubkey == NULL)
+        pubkey = &tmp_pubkey;
+    r = iesys_cryptossl_pubkey_get(pubkey, pub_tpm_key);
+    goto_if_error(r, "Convert TPM public key", cleanup);
+    if ((*pubkey)->rsa_key == NULL) {
+        goto_error(r, TSS2_ESYS_RC_BAD_VALUE, "Not an RSA key", cleanup);
     }
 
-    if (1 != RSA_set0_key(rsa_key, n, NULL, NULL)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Could not set rsa n.", cleanup);
-    }
-#endif
-
-    if (1 != EVP_PKEY_set1_RSA(evp_rsa_key, rsa_key)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Could not set rsa key.", cleanup);
-    }
-
-    if (!(ctx = EVP_PKEY_CTX_new(evp_rsa_key, get_engine()))) {
+    if (!(ctx = EVP_PKEY_CTX_new((*pubkey)->rsa_key, get_engine()))) {
         goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
                    "Could not create evp context.", cleanup);
     }
@@ -670,10 +1143,18 @@ iesys_cryptossl_pk_encrypt(TPM2B_PUBLIC * pub_tpm_key,
                    "Could not set RSA passing.", cleanup);
     }
 
-    if (1 != EVP_PKEY_CTX_set0_rsa_oaep_label(ctx, label, strlen(label)+1)) {
+    /* The context takes ownership of the label */
+    label_size = strlen(label) + 1;
+    if (!(label_copy = OPENSSL_malloc(label_size))) {
+        goto_error(r, TSS2_ESYS_RC_MEMORY,
+                   "Could not allocate RSA label.", cleanup);
+    }
+    memcpy(label_copy, label, label_size);
+    if (1 != EVP_PKEY_CTX_set0_rsa_oaep_label(ctx, label_copy, label_size)) {
         goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
                    "Could not set RSA label.", cleanup);
     }
+    label_copy = NULL;
 
     if (1 != EVP_PKEY_CTX_set_rsa_oaep_md(ctx, hashAlg)) {
         goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
@@ -697,81 +1178,10 @@ iesys_cryptossl_pk_encrypt(TPM2B_PUBLIC * pub_tpm_key,
                    "Could not encrypt data.", cleanup);
     }
 
-    return TSS2_RC_SUCCESS;
-
  cleanup:
+    OPENSSL_free(label_copy);
     OSSL_FREE(ctx, EVP_PKEY_CTX);
-    OSSL_FREE(rsa_key, RSA);
-    OSSL_FREE(evp_rsa_key, EVP_PKEY);
-    OSSL_FREE(bne, BN);
-#if OPENSSL_VERSION_NUMBER >= 0x10100000L
-    OSSL_FREE(n, BN);
-#endif
-    return r;
-}
-
-/** Computation of OSSL ec public point from TPM public point.
- *
- * @param[in] group The definition of the used ec curve.
- * @param[in] key The TPM public key.
- * @param[out] The TPM's public point in OSSL format.
- * @retval TSS2_RC_SUCCESS on success.
- * @retval TSS2_ESYS_RC_GENERAL_FAILURE The internal crypto engine failed.
- */
-TSS2_RC
-tpm_pub_to_ossl_pub(EC_GROUP *group, TPM2B_PUBLIC *key, EC_POINT **tpm_pub_key)
-{
-
-    TSS2_RC r = TSS2_RC_SUCCESS;
-    BIGNUM *bn_x = NULL;
-    BIGNUM *bn_y = NULL;
-    BN_CTX *bctx = NULL;
-
-    if (!tpm_pub_key || !key || !group) {
-        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Bad reference");
-    }
-
-    bctx = BN_CTX_new();
-
-    /* Create the big numbers for the coordinates of the point */
-    if (!(bn_x = BN_bin2bn(&key->publicArea.unique.ecc.x.buffer[0],
-                           key->publicArea.unique.ecc.x.size,
-                           NULL))) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Create big num from byte buffer.", cleanup);
-    }
-
-    if (!(bn_y = BN_bin2bn(&key->publicArea.unique.ecc.y.buffer[0],
-                           key->publicArea.unique.ecc.y.size,
-                           NULL))) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Create big num from byte buffer.", cleanup);
-    }
-
-    /* Create the ec point with the affine coordinates of the TPM point */
-    if (!(*tpm_pub_key = EC_POINT_new(group))) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Create point.", cleanup);
-    }
-
-    if (1 != EC_POINT_set_affine_coordinates_GFp(group,
-                                                 *tpm_pub_key, bn_x,
-                                                 bn_y, bctx)) {
-        OSSL_FREE(*tpm_pub_key, EC_POINT);
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Set affine coordinates", cleanup);
-    }
-
-    if (1 != EC_POINT_is_on_curve(group, *tpm_pub_key, bctx)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "The TPM point is not on the curve", cleanup);
-    }
-
- cleanup:
-    OSSL_FREE(bn_x, BN);
-    OSSL_FREE(bn_y, BN);
-    OSSL_FREE(bctx, BN_CTX);
-
+    iesys_cryptossl_pubkey_free(&tmp_pubkey);
     return r;
 }
 
@@ -780,6 +1190,8 @@ tpm_pub_to_ossl_pub(EC_GROUP *group, TPM2B_PUBLIC *key, EC_POINT **tpm_pub_key)
  * According to the description in  TPM spec part 1 C 6.1 a shared secret
  * between application and TPM is computed (ECDH). An ephemeral ECC key and a
  * TPM keyare used for the ECDH key exchange.
+ * @param[in,out] pubkey The converted key of the TPM key (may be NULL, then a
+ *                temporary conversion is used).
  * @param[in] key The key to be used for ECDH key exchange.
  * @param[in] max_out_size the max size for the output of the public key of the
  *            computed ephemeral key.
@@ -793,7 +1205,8 @@ tpm_pub_to_ossl_pub(EC_GROUP *group, TPM2B_PUBLIC *key, EC_POINT **tpm_pub_key)
  * @retval TSS2_ESYS_RC_GENERAL_FAILURE The internal crypto engine failed.
  */
 TSS2_RC
-iesys_cryptossl_get_ecdh_point(TPM2B_PUBLIC *key,
+iesys_cryptossl_get_ecdh_point(IESYS_CRYPTO_PUBKEY **pubkey,
+                               TPM2B_PUBLIC *key,
                                size_t max_out_size,
                                TPM2B_ECC_PARAMETER *Z,
                                TPMS_ECC_POINT *Q,
@@ -802,40 +1215,36 @@ iesys_cryptossl_get_ecdh_point(TPM2B_PUBLIC *key,
 {
     TSS2_RC r = TSS2_RC_SUCCESS;
     BN_CTX *bctx = NULL;                  /* Context used for big number operations */
-    EC_GROUP *group = NULL;               /* Group defines the used curve */
+    IESYS_CRYPTO_PUBKEY *tmp_pubkey = NULL;
+    const EC_GROUP *group = NULL;         /* Group defines the used curve */
     EC_KEY *eph_ec_key = NULL;            /* Ephemeral ec key of application */
     const EC_POINT *eph_pub_key = NULL;   /* Public part of ephemeral key */
-    EC_POINT *tpm_pub_key = NULL;         /* Public part of TPM key */
+    const EC_POINT *tpm_pub_key = NULL;   /* Public part of TPM key */
+    EC_POINT *mul_eph_tpm = NULL;
     BIGNUM *bn_x = NULL;
     BIGNUM *bn_y = NULL;
     size_t key_size;
-    int curveId;
     size_t offset;
 
     if (!key || !Z || !Q || !out_buffer || !out_size) {
         return TSS2_ESYS_RC_BAD_REFERENCE;
     }
 
-    /* Set ossl constant for curve type and create group for curve */
+    /* Set the coordinate size for the curve type */
     switch (key->publicArea.parameters.eccDetail.curveID) {
     case TPM2_ECC_NIST_P192:
-        curveId = NID_X9_62_prime192v1;
         key_size = 24;
         break;
     case TPM2_ECC_NIST_P224:
-        curveId = NID_secp224r1;
         key_size = 38;
         break;
     case TPM2_ECC_NIST_P256:
-        curveId = NID_X9_62_prime256v1;
         key_size = 32;
         break;
     case TPM2_ECC_NIST_P384:
-        curveId = NID_secp384r1;
         key_size = 48;
         break;
     case TPM2_ECC_NIST_P521:
-        curveId = NID_secp521r1;
         key_size = 66;
         break;
     default:
@@ -843,10 +1252,16 @@ iesys_cryptossl_get_ecdh_point(TPM2B_PUBLIC *key,
                      "ECC curve not implemented.");
     }
 
-    if (!(group = EC_GROUP_new_by_curve_name(curveId))) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Create group for curve", cleanup);
+    /* Get the group for the curve and the TPM public point */
+    if (pubkey == NULL)
+        pubkey = &tmp_pubkey;
+    r = iesys_cryptossl_pubkey_get(pubkey, key);
+    goto_if_error(r, "Convert TPM public key", cleanup);
+    if ((*pubkey)->group == NULL) {
+        goto_error(r, TSS2_ESYS_RC_BAD_VALUE, "Not an ECC key", cleanup);
     }
+    group = (*pubkey)->group;
+    tpm_pub_key = (*pubkey)->point;
 
     /* Create ephemeral key */
     if (!(eph_ec_key = EC_KEY_new())) {
@@ -891,12 +1306,12 @@ iesys_cryptossl_get_ecdh_point(TPM2B_PUBLIC *key,
                    "Get affine x coordinate", cleanup);
     }
 
-    if (1 != BN_bn2binpad(bn_x, &Q->x.buffer[0], key_size)) {
+    if (1 != iesys_bn2binpad(bn_x, &Q->x.buffer[0], key_size)) {
         goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
                    "Write big num byte buffer", cleanup);
     }
 
-    if (1 != BN_bn2binpad(bn_y, &Q->y.buffer[0], key_size)) {
+    if (1 != iesys_bn2binpad(bn_y, &Q->y.buffer[0], key_size)) {
         goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
                    "Write big num byte buffer", cleanup);
     }
@@ -904,12 +1319,7 @@ iesys_cryptossl_get_ecdh_point(TPM2B_PUBLIC *key,
     Q->x.size = key_size;
     Q->y.size = key_size;
 
-    /* Create an OSSL EC point from the TPM public point */
-    r = tpm_pub_to_ossl_pub(group, key, &tpm_pub_key);
-    goto_if_error(r, "Convert TPM pub point to ossl pub point", cleanup);
-
     /* Multiply the ephemeral private key with TPM public key */
-    EC_POINT *mul_eph_tpm = NULL;
     const BIGNUM * eph_priv_key = EC_KEY_get0_private_key(eph_ec_key);
 
     if (!(mul_eph_tpm = EC_POINT_new(group))) {
@@ -929,7 +1339,7 @@ iesys_cryptossl_get_ecdh_point(TPM2B_PUBLIC *key,
                    "Get affine x coordinate", cleanup);
     }
 
-    if (1 != BN_bn2binpad(bn_x, &Z->buffer[0], key_size)) {
+    if (1 != iesys_bn2binpad(bn_x, &Z->buffer[0], key_size)) {
         goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
                    "Write big num byte buffer", cleanup);
     }
@@ -943,16 +1353,87 @@ iesys_cryptossl_get_ecdh_point(TPM2B_PUBLIC *key,
     *out_size = offset;
 
  cleanup:
-    OSSL_FREE(group,EC_GROUP);
+    OSSL_FREE(mul_eph_tpm, EC_POINT);
     OSSL_FREE(eph_ec_key, EC_KEY);
     /* Note: free of eph_pub_key already done by free of eph_ec_key */
     OSSL_FREE(bn_x, BN);
     OSSL_FREE(bn_y, BN);
+    OSSL_FREE(bctx, BN_CTX);
+    iesys_cryptossl_pubkey_free(&tmp_pubkey);
     return r;
 }
 
+/** Cipher object for AES parameter encryption.
+ *
+ * The OpenSSL cipher context is kept between operations; it is only rekeyed
+ * if the cipher stays the same.
+ */
+typedef struct _IESYS_CRYPTO_CIPHER {
+    EVP_CIPHER_CTX *ossl_context;      /**< The cipher context. */
+    const EVP_CIPHER *ossl_cipher_alg; /**< The cipher ossl_context is set up
+                                            for, or NULL. */
+} IESYS_CRYPTO_CIPHER;
+
+/** Release a cipher object.
+ *
+ * @param[in,out] cipher The cipher object. (Will be freed and set to NULL.)
+ */
+void
+iesys_cryptossl_cipher_free(IESYS_CRYPTO_CIPHER ** cipher)
+{
+    if (cipher == NULL || *cipher == NULL)
+        return;
+
+    OSSL_FREE((*cipher)->ossl_context, EVP_CIPHER_CTX);
+    SAFE_FREE(*cipher);
+}
+
+/** Set up a cipher object for an operation with a key and iv.
+ *
+ * The object is created if *cipher is NULL. The cipher is only set up again
+ * if it differs from the one of the last operation.
+ * @param[in,out] cipher The cipher object.
+ * @param[in] cipher_alg The cipher to use.
+ * @param[in] enc 1 for encryption, 0 for decryption.
+ * @param[in] key The key.
+ * @param[in] iv The initialization vector.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_MEMORY Memory can not be allocated.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+static TSS2_RC
+iesys_cryptossl_cipher_init(IESYS_CRYPTO_CIPHER ** cipher,
+                            const EVP_CIPHER * cipher_alg, int enc,
+                            const uint8_t * key, const uint8_t * iv)
+{
+    if (*cipher == NULL) {
+        *cipher = calloc(1, sizeof(IESYS_CRYPTO_CIPHER));
+        return_if_null(*cipher, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+    }
+    if ((*cipher)->ossl_context == NULL &&
+        !((*cipher)->ossl_context = EVP_CIPHER_CTX_new())) {
+        return_error(TSS2_ESYS_RC_GENERAL_FAILURE,
+                     "Initialize cipher context");
+    }
+
+    /* For the same cipher as before only key, iv and direction are set */
+    if (1 != EVP_CipherInit_ex((*cipher)->ossl_context,
+                               ((*cipher)->ossl_cipher_alg == cipher_alg)
+                                   ? NULL : cipher_alg,
+                               get_engine(), key, iv, enc)) {
+        (*cipher)->ossl_cipher_alg = NULL;
+        return_error(TSS2_ESYS_RC_GENERAL_FAILURE,
+                     "Initialize cipher operation");
+    }
+    (*cipher)->ossl_cipher_alg = cipher_alg;
+    return TSS2_RC_SUCCESS;
+}
+
 /** Encrypt data with AES.
  *
+ * @param[in,out] cipher The cipher object to reuse, or NULL. It is created
+ *                if *cipher is NULL and released with
+ *                iesys_cryptossl_cipher_free.
  * @param[in] key key used for AES.
  * @param[in] tpm_sym_alg AES type in TSS2 notation (must be TPM2_ALG_AES).
  * @param[in] key_bits Key size in bits.
@@ -965,10 +1446,12 @@ iesys_cryptossl_get_ecdh_point(TPM2B_PUBLIC *key,
  * @param[in] iv The initialization vector. The size is equal to blk_len.
  * @retval TSS2_RC_SUCCESS on success, or TSS2_ESYS_RC_BAD_VALUE and
  * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters,
+ * @retval TSS2_ESYS_RC_MEMORY Memory can not be allocated.
  * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
  */
 TSS2_RC
-iesys_cryptossl_sym_aes_encrypt(uint8_t * key,
+iesys_cryptossl_sym_aes_encrypt(IESYS_CRYPTO_CIPHER ** cipher,
+                                uint8_t * key,
                                 TPM2_ALG_ID tpm_sym_alg,
                                 TPMI_AES_KEY_BITS key_bits,
                                 TPM2_ALG_ID tpm_mode,
@@ -979,7 +1462,7 @@ iesys_cryptossl_sym_aes_encrypt(uint8_t * key,
 {
     TSS2_RC r = TSS2_RC_SUCCESS;
     const EVP_CIPHER  *cipher_alg = NULL;
-    EVP_CIPHER_CTX *ctx = NULL;
+    IESYS_CRYPTO_CIPHER *tmp_cipher = NULL;
     int cipher_len;
 
     if (key == NULL || buffer == NULL) {
@@ -998,49 +1481,45 @@ iesys_cryptossl_sym_aes_encrypt(uint8_t * key,
     else if (key_bits == 256 && tpm_mode == TPM2_ALG_CFB)
         cipher_alg = EVP_aes_256_cfb();
     else {
-        goto_error(r, TSS2_ESYS_RC_BAD_VALUE,
-                   "AES algorithm not implemented or illegal mode (CFB expected).",
-                   cleanup);
+        return_error(TSS2_ESYS_RC_BAD_VALUE,
+                     "AES algorithm not implemented or illegal mode (CFB expected).");
     }
 
     if (tpm_sym_alg != TPM2_ALG_AES) {
-        goto_error(r, TSS2_ESYS_RC_BAD_VALUE,
-                   "AES encrypt called with wrong algorithm.", cleanup);
+        return_error(TSS2_ESYS_RC_BAD_VALUE,
+                     "AES encrypt called with wrong algorithm.");
     }
 
-    /* Create and initialize the context */
-    if(!(ctx = EVP_CIPHER_CTX_new())) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Initialize cipher context", cleanup);
-    }
-
-    if (1 != EVP_EncryptInit_ex(ctx, cipher_alg, get_engine(), key, iv)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Initialize cipher operation", cleanup);
-    }
-    if (1 != EVP_EncryptInit_ex(ctx, NULL, get_engine(), key, iv)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "Set key and iv", cleanup);
-    }
+    if (cipher == NULL)
+        cipher = &tmp_cipher;
+    r = iesys_cryptossl_cipher_init(cipher, cipher_alg, 1, key, iv);
+    goto_if_error(r, "Set up cipher", cleanup);
 
     /* Perform the encryption */
-    if (1 != EVP_EncryptUpdate(ctx, buffer, &cipher_len, buffer, buffer_size)) {
+    if (1 != EVP_EncryptUpdate((*cipher)->ossl_context, buffer, &cipher_len,
+                               buffer, buffer_size)) {
         goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "Encrypt update", cleanup);
     }
 
-    if (1 != EVP_EncryptFinal_ex(ctx, buffer, &cipher_len)) {
+    if (1 != EVP_EncryptFinal_ex((*cipher)->ossl_context, buffer,
+                                 &cipher_len)) {
         goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "Encrypt final", cleanup);
     }
     LOGBLOB_TRACE(buffer, buffer_size, "IESYS AES output");
 
  cleanup:
-
-    OSSL_FREE(ctx,EVP_CIPHER_CTX);
+    if (r != TSS2_RC_SUCCESS && *cipher != NULL)
+        (*cipher)->ossl_cipher_alg = NULL;
+    iesys_cryptossl_cipher_free(&tmp_cipher);
 
     return r;
 }
 
 /** Decrypt data with AES.
  *
+ * @param[in,out] cipher The cipher object to reuse, or NULL. It is created
+ *                if *cipher is NULL and released with
+ *                iesys_cryptossl_cipher_free.
  * @param[in] key key used for AES.
  * @param[in] tpm_sym_alg AES type in TSS2 notation (must be TPM2_ALG_AES).
  * @param[in] key_bits Key size in bits.
@@ -1053,10 +1532,12 @@ iesys_cryptossl_sym_aes_encrypt(uint8_t * key,
  * @param[in] iv The initialization vector. The size is equal to blk_len.
  * @retval TSS2_RC_SUCCESS on success, or TSS2_ESYS_RC_BAD_VALUE and
  * @retval TSS2_ESYS_RC_BAD_REFERENCE for invalid parameters,
+ * @retval TSS2_ESYS_RC_MEMORY Memory can not be allocated.
  * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
  */
 TSS2_RC
-iesys_cryptossl_sym_aes_decrypt(uint8_t * key,
+iesys_cryptossl_sym_aes_decrypt(IESYS_CRYPTO_CIPHER ** cipher,
+                                uint8_t * key,
                                 TPM2_ALG_ID tpm_sym_alg,
                                 TPMI_AES_KEY_BITS key_bits,
                                 TPM2_ALG_ID tpm_mode,
@@ -1067,7 +1548,7 @@ iesys_cryptossl_sym_aes_decrypt(uint8_t * key,
 {
     TSS2_RC r = TSS2_RC_SUCCESS;
     const EVP_CIPHER *cipher_alg = NULL;
-    EVP_CIPHER_CTX *ctx = NULL;
+    IESYS_CRYPTO_CIPHER *tmp_cipher = NULL;
     int cipher_len = 0;
 
     /* Parameter blk_len needed for other crypto libraries */
@@ -1078,8 +1559,8 @@ iesys_cryptossl_sym_aes_decrypt(uint8_t * key,
     }
 
     if (tpm_sym_alg != TPM2_ALG_AES) {
-        goto_error(r, TSS2_ESYS_RC_BAD_VALUE,
-                   "AES encrypt called with wrong algorithm.", cleanup);
+        return_error(TSS2_ESYS_RC_BAD_VALUE,
+                     "AES encrypt called with wrong algorithm.");
     }
 
     if (key_bits == 128 && tpm_mode == TPM2_ALG_CFB)
@@ -1089,41 +1570,34 @@ iesys_cryptossl_sym_aes_decrypt(uint8_t * key,
     else if (key_bits == 256 && tpm_mode == TPM2_ALG_CFB)
         cipher_alg = EVP_aes_256_cfb();
     else {
-
-        goto_error(r, TSS2_ESYS_RC_NOT_IMPLEMENTED,
-                   "AES algorithm not implemented.", cleanup);
-    }
-
-    /* Create and initialize the context */
-    if(!(ctx = EVP_CIPHER_CTX_new())) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Initialize cipher context", cleanup);
+        return_error(TSS2_ESYS_RC_NOT_IMPLEMENTED,
+                     "AES algorithm not implemented.");
     }
 
     LOGBLOB_TRACE(buffer, buffer_size, "IESYS AES input");
 
-    if (1 != EVP_DecryptInit_ex(ctx, cipher_alg, get_engine(), key, iv)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE,
-                   "Initialize cipher operation", cleanup);
-    }
-
-    if (1 != EVP_DecryptInit_ex(ctx, NULL, get_engine(), key, iv)) {
-        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "Set key and iv", cleanup);
-    }
+    if (cipher == NULL)
+        cipher = &tmp_cipher;
+    r = iesys_cryptossl_cipher_init(cipher, cipher_alg, 0, key, iv);
+    goto_if_error(r, "Set up cipher", cleanup);
 
     /* Perform the decryption */
-    if (1 != EVP_DecryptUpdate(ctx, buffer, &cipher_len, buffer, buffer_size)) {
+    if (1 != EVP_DecryptUpdate((*cipher)->ossl_context, buffer, &cipher_len,
+                               buffer, buffer_size)) {
         goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "Encrypt update", cleanup);
     }
 
-    if (1 != EVP_DecryptFinal_ex(ctx, buffer, &cipher_len)) {
+    if (1 != EVP_DecryptFinal_ex((*cipher)->ossl_context, buffer,
+                                 &cipher_len)) {
         goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "Encrypt final", cleanup);
     }
     LOGBLOB_TRACE(buffer, buffer_size, "IESYS AES output");
 
  cleanup:
+    if (r != TSS2_RC_SUCCESS && *cipher != NULL)
+        (*cipher)->ossl_cipher_alg = NULL;
+    iesys_cryptossl_cipher_free(&tmp_cipher);
 
-    OSSL_FREE(ctx,EVP_CIPHER_CTX);
     return r;
 }
 
@@ -17,6 +17,8 @@ extern "C" {
 #define OSSL_FREE(S,TYPE) if((S) != NULL) {TYPE##_free((void*) (S)); (S)=NULL;}
 
 typedef struct _IESYS_CRYPTO_CONTEXT IESYS_CRYPTO_CONTEXT_BLOB;
+typedef struct _IESYS_CRYPTO_PUBKEY IESYS_CRYPTO_PUBKEY;
+typedef struct _IESYS_CRYPTO_CIPHER IESYS_CRYPTO_CIPHER;
 
 TSS2_RC iesys_cryptossl_hash_start(
     IESYS_CRYPTO_CONTEXT_BLOB **context,
@@ -41,6 +43,13 @@ TSS2_RC iesys_cryptossl_hash_finish2b(
 
 void iesys_cryptossl_hash_abort(IESYS_CRYPTO_CONTEXT_BLOB **context);
 
+TSS2_RC iesys_cryptossl_hash_reset(IESYS_CRYPTO_CONTEXT_BLOB *context);
+
+TSS2_RC iesys_cryptossl_hash_final(
+    IESYS_CRYPTO_CONTEXT_BLOB *context,
+    uint8_t *buffer,
+    size_t *size);
+
 #define iesys_crypto_pk_encrypt iesys_cryptossl_pk_encrypt
 #define iesys_crypto_hash_start iesys_cryptossl_hash_start
 #define iesys_crypto_hash_update iesys_cryptossl_hash_update
@@ -48,6 +57,8 @@ void iesys_cryptossl_hash_abort(IESYS_CRYPTO_CONTEXT_BLOB **context);
 #define iesys_crypto_hash_finish iesys_cryptossl_hash_finish
 #define iesys_crypto_hash_finish2b iesys_cryptossl_hash_finish2b
 #define iesys_crypto_hash_abort iesys_cryptossl_hash_abort
+#define iesys_crypto_hash_reset iesys_cryptossl_hash_reset
+#define iesys_crypto_hash_final iesys_cryptossl_hash_final
 
 TSS2_RC iesys_cryptossl_hmac_start(
     IESYS_CRYPTO_CONTEXT_BLOB **context,
@@ -80,6 +91,18 @@ TSS2_RC iesys_cryptossl_hmac_finish2b(
 
 void iesys_cryptossl_hmac_abort(IESYS_CRYPTO_CONTEXT_BLOB **context);
 
+TSS2_RC iesys_cryptossl_hmac_rekey(
+    IESYS_CRYPTO_CONTEXT_BLOB *context,
+    const uint8_t *key,
+    size_t size);
+
+TSS2_RC iesys_cryptossl_hmac_reset(IESYS_CRYPTO_CONTEXT_BLOB *context);
+
+TSS2_RC iesys_cryptossl_hmac_final(
+    IESYS_CRYPTO_CONTEXT_BLOB *context,
+    uint8_t *buffer,
+    size_t *size);
+
 #define iesys_crypto_hmac_start iesys_cryptossl_hmac_start
 #define iesys_crypto_hmac_start2b iesys_cryptossl_hmac_start2b
 #define iesys_crypto_hmac_update iesys_cryptossl_hmac_update
@@ -87,10 +110,15 @@ void iesys_cryptossl_hmac_abort(IESYS_CRYPTO_CONTEXT_BLOB **context);
 #define iesys_crypto_hmac_finish iesys_cryptossl_hmac_finish
 #define iesys_crypto_hmac_finish2b iesys_cryptossl_hmac_finish2b
 #define iesys_crypto_hmac_abort iesys_cryptossl_hmac_abort
+#define iesys_crypto_hmac_rekey iesys_cryptossl_hmac_rekey
+#define iesys_crypto_hmac_reset iesys_cryptossl_hmac_reset
+#define iesys_crypto_hmac_final iesys_cryptossl_hmac_final
 
+TSS2_RC iesys_cryptossl_get_random(uint8_t *buffer, size_t size);
 TSS2_RC iesys_cryptossl_random2b(TPM2B_NONCE *nonce, size_t num_bytes);
 
 TSS2_RC iesys_cryptossl_pk_encrypt(
+    IESYS_CRYPTO_PUBKEY **pubkey,
     TPM2B_PUBLIC *key,
     size_t in_size,
     BYTE *in_buffer,
@@ -101,6 +129,7 @@ TSS2_RC iesys_cryptossl_pk_encrypt(
 
 
 TSS2_RC iesys_cryptossl_sym_aes_encrypt(
+    IESYS_CRYPTO_CIPHER **cipher,
     uint8_t *key,
     TPM2_ALG_ID tpm_sym_alg,
     TPMI_AES_KEY_BITS key_bits,
@@ -111,6 +140,7 @@ TSS2_RC iesys_cryptossl_sym_aes_encrypt(
     uint8_t *iv);
 
 TSS2_RC iesys_cryptossl_sym_aes_decrypt(
+    IESYS_CRYPTO_CIPHER **cipher,
     uint8_t *key,
     TPM2_ALG_ID tpm_sym_alg,
     TPMI_AES_KEY_BITS key_bits,
@@ -120,7 +150,12 @@ TSS2_RC iesys_cryptossl_sym_aes_decrypt(
     size_t dst_size,
     uint8_t *iv);
 
+void iesys_cryptossl_cipher_free(IESYS_CRYPTO_CIPHER **cipher);
+
+void iesys_cryptossl_pubkey_free(IESYS_CRYPTO_PUBKEY **pubkey);
+
 TSS2_RC iesys_cryptossl_get_ecdh_point(
+    IESYS_CRYPTO_PUBKEY **pubkey,
     TPM2B_PUBLIC *key,
     size_t max_out_size,
     TPM2B_ECC_PARAMETER *Z,
@@ -128,10 +163,13 @@ TSS2_RC iesys_cryptossl_get_ecdh_point(
     BYTE * out_buffer,
     size_t * out_size);
 
+#define iesys_crypto_get_random iesys_cryptossl_get_random
 #define iesys_crypto_random2b iesys_cryptossl_random2b
 #define iesys_crypto_get_ecdh_point iesys_cryptossl_get_ecdh_point
+#define iesys_crypto_pubkey_free iesys_cryptossl_pubkey_free
 #define iesys_crypto_sym_aes_encrypt iesys_cryptossl_sym_aes_encrypt
 #define iesys_crypto_sym_aes_decrypt iesys_cryptossl_sym_aes_decrypt
+#define iesys_crypto_cipher_free iesys_cryptossl_cipher_free
 
 TSS2_RC iesys_cryptossl_init();
 
@@ -0,0 +1,575 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#define read _read
+#else
+#include <unistd.h>
+#endif
+
+#include "tss2_esys.h"
+
+#include "esys_iutil.h"
+#define LOGMODULE esys
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/** The number of SYS contexts of a password-authorized stream: one for the
+    SequenceUpdate in flight and one for the next, prepared meanwhile. */
+#define HASH_STREAM_SYS 2
+
+/** A hash or HMAC sequence fed in chunks of the TPM's input buffer size.
+ *
+ * Data is collected in the chunk being filled. A full chunk is only sent once
+ * more data arrives, so the last chunk always travels with
+ * TPM2_SequenceComplete. While a TPM2_SequenceUpdate is in flight, the next
+ * chunk is filled from the caller's buffer or file descriptor. If the only
+ * session is ESYS_TR_PASSWORD, the next command is also marshaled into a
+ * second SYS context during that time, since its auth area does not depend on
+ * the response. Every Esys_HashStream_Update* call waits for its last
+ * command, so the ESYS_CONTEXT can be used for other commands between calls.
+ */
+struct ESYS_HASH_STREAM {
+    ESYS_CONTEXT *esys_context;      /**< The context of the sequence. */
+    ESYS_TR sequence;                /**< The sequence object. */
+    ESYS_TR shandle1;                /**< The sessions used for the sequence */
+    ESYS_TR shandle2;                /**< commands. */
+    ESYS_TR shandle3;
+    TPMI_RH_HIERARCHY hierarchy;     /**< The hierarchy of the ticket. */
+    UINT16 chunk_size;               /**< The bytes per TPM command. */
+    bool in_flight;                  /**< Whether a SequenceUpdate is
+                                          outstanding. */
+    TSS2_SYS_CONTEXT *sys[HASH_STREAM_SYS]; /**< The SYS contexts of
+                                          password-authorized updates, or
+                                          NULL if updates go through ESYS. */
+    TPM2_HANDLE tpm_sequence;        /**< The TPM handle of the sequence
+                                          during an update call. */
+    TSS2L_SYS_AUTH_COMMAND auths;    /**< The password auth of the sequence. */
+    size_t fill;                     /**< The index of the chunk being
+                                          filled. */
+    TPM2B_MAX_BUFFER chunks[HASH_STREAM_SYS]; /**< The data not sent yet and,
+                                          for SYS updates, the data of the
+                                          outstanding one. */
+};
+
+/** Check whether the updates of a stream can be prepared ahead.
+ *
+ * Only a single password authorization has an auth area that does not
+ * depend on the previous response.
+ */
+static bool
+hash_stream_is_prebuilt(ESYS_TR shandle1, ESYS_TR shandle2, ESYS_TR shandle3)
+{
+    return shandle1 == ESYS_TR_PASSWORD && shandle2 == ESYS_TR_NONE &&
+        shandle3 == ESYS_TR_NONE;
+}
+
+/** Check whether a TPM response code asks for a resubmission.
+ *
+ * These are handled by resending the chunk through ESYS.
+ */
+static bool
+hash_stream_is_retry(TSS2_RC r)
+{
+    return r == TPM2_RC_RETRY || r == TPM2_RC_TESTING || r == TPM2_RC_YIELDED;
+}
+
+/** Release the SYS contexts of a stream.
+ *
+ * Later updates of the stream go through ESYS.
+ * @param stream [in,out] The hash stream.
+ */
+static void
+hash_stream_free_sys(ESYS_HASH_STREAM *stream)
+{
+    for (size_t i = 0; i < HASH_STREAM_SYS; i++) {
+        if (stream->sys[i] == NULL)
+            continue;
+        Tss2_Sys_Finalize(stream->sys[i]);
+        SAFE_FREE(stream->sys[i]);
+    }
+}
+
+/** Allocate the SYS contexts for password-authorized updates.
+ *
+ * @param stream [in,out] The hash stream.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_MEMORY if a SYS context can not be allocated.
+ * @retval TSS2_RCs produced by Tss2_Sys_Initialize.
+ */
+static TSS2_RC
+hash_stream_init_sys(ESYS_HASH_STREAM *stream)
+{
+    TSS2_RC r;
+    TSS2_TCTI_CONTEXT *tcti;
+    size_t syssize = Tss2_Sys_GetContextSize(0);
+
+    r = Tss2_Sys_GetTctiContext(stream->esys_context->sys, &tcti);
+    return_if_error(r, "Get TCTI context");
+
+    for (size_t i = 0; i < HASH_STREAM_SYS; i++) {
+        stream->sys[i] = calloc(1, syssize);
+        goto_if_null(stream->sys[i], "Out of memory.", TSS2_ESYS_RC_MEMORY,
+                     error_cleanup);
+
+        r = Tss2_Sys_Initialize(stream->sys[i], syssize, tcti, NULL);
+        if (r != TSS2_RC_SUCCESS) {
+            SAFE_FREE(stream->sys[i]);
+            LOG_ERROR("During syscontext initialization");
+            goto error_cleanup;
+        }
+    }
+    return TSS2_RC_SUCCESS;
+
+error_cleanup:
+    hash_stream_free_sys(stream);
+    return r;
+}
+
+/** Look up the sequence object for the SYS updates of an update call.
+ *
+ * The sequence may have been swapped out by commands between the update
+ * calls, so it is loaded again and its current TPM handle is used.
+ * @param stream [in,out] The hash stream.
+ * @retval TSS2_RC_SUCCESS on success or if updates go through ESYS.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if a command is outstanding.
+ * @retval TSS2_RCs produced by the swap commands.
+ */
+static TSS2_RC
+hash_stream_load(ESYS_HASH_STREAM *stream)
+{
+    ESYS_CONTEXT *esysContext = stream->esys_context;
+    RSRC_NODE_T *sequenceNode;
+    TSS2_RC r;
+
+    if (stream->sys[0] == NULL)
+        return TSS2_RC_SUCCESS;
+
+    if (esysContext->state != _ESYS_STATE_INIT) {
+        LOG_ERROR("Esys called in bad sequence.");
+        return TSS2_ESYS_RC_BAD_SEQUENCE;
+    }
+
+    r = esys_GetResourceObject(esysContext, stream->sequence, &sequenceNode);
+    return_if_error(r, "sequenceHandle unknown");
+    r = iesys_swap_in(esysContext, TPM2_CC_SequenceUpdate, sequenceNode, NULL,
+                      NULL);
+    return_if_error(r, "Swap in sequence");
+
+    stream->tpm_sequence = sequenceNode->rsrc.handle;
+    stream->auths.count = 1;
+    stream->auths.auths[0].sessionHandle = TPM2_RS_PW;
+    stream->auths.auths[0].hmac = sequenceNode->auth;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Get the number of bytes the TPM accepts per sequence command.
+ *
+ * TPM2_PT_INPUT_BUFFER is a fixed property, so it is answered from the
+ * capability cache while that is enabled.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param chunk_size [out] TPM2_PT_INPUT_BUFFER, at most the size of a
+ *        TPM2B_MAX_BUFFER.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_RCs produced by Esys_GetCapability.
+ */
+static TSS2_RC
+hash_stream_chunk_size(ESYS_CONTEXT *esys_context, UINT16 *chunk_size)
+{
+    TSS2_RC r;
+    UINT32 input_buffer;
+
+    r = iesys_capability_get_property(esys_context, TPM2_PT_INPUT_BUFFER,
+                                      &input_buffer);
+    return_if_error(r, "Get TPM input buffer size");
+
+    *chunk_size = sizeof(((TPM2B_MAX_BUFFER *)0)->buffer);
+    if (input_buffer > 0 && input_buffer < *chunk_size)
+        *chunk_size = input_buffer;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Wait for the outstanding SequenceUpdate of a stream.
+ *
+ * A SYS update the TPM asks to resubmit is sent again through ESYS.
+ * @param stream [in,out] The hash stream.
+ * @retval TSS2_RC_SUCCESS if no command was outstanding or it succeeded.
+ * @retval TSS2_RCs produced by Esys_SequenceUpdate_Finish, the SYS layer or
+ *         the TPM. On errors below the TPM, the SYS contexts are released.
+ */
+static TSS2_RC
+hash_stream_wait(ESYS_HASH_STREAM *stream)
+{
+    ESYS_CONTEXT *esysContext = stream->esys_context;
+    int32_t timeouttmp = esysContext->timeout;
+    size_t sent = 1 - stream->fill;
+    TSS2_RC r;
+
+    if (!stream->in_flight)
+        return TSS2_RC_SUCCESS;
+
+    if (stream->sys[0] != NULL) {
+        r = Tss2_Sys_ExecuteFinish(stream->sys[sent],
+                                   TSS2_TCTI_TIMEOUT_BLOCK);
+        stream->in_flight = false;
+        if (r == TSS2_RC_SUCCESS) {
+            r = Tss2_Sys_SequenceUpdate_Complete(stream->sys[sent]);
+        } else if (hash_stream_is_retry(r)) {
+            LOG_DEBUG("TPM returned RETRY, TESTING or YIELDED, which triggers "
+                      "a resubmission: %" PRIx32, r);
+            r = Esys_SequenceUpdate(esysContext, stream->sequence,
+                                    stream->shandle1, stream->shandle2,
+                                    stream->shandle3, &stream->chunks[sent]);
+        } else if (!iesys_tpm_error(r)) {
+            /* The contexts may be stuck in a receive stage */
+            hash_stream_free_sys(stream);
+        }
+        return_if_error(r, "Error SequenceUpdate");
+        return TSS2_RC_SUCCESS;
+    }
+
+    esysContext->timeout = -1;
+    do {
+        r = Esys_SequenceUpdate_Finish(esysContext);
+    } while ((r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN);
+    esysContext->timeout = timeouttmp;
+
+    stream->in_flight = false;
+    return_if_error(r, "Error SequenceUpdate");
+    return TSS2_RC_SUCCESS;
+}
+
+/** Send the full chunk of a stream and start an empty one.
+ *
+ * The previous SequenceUpdate is completed first. The chunk is copied by
+ * Esys_SequenceUpdate_Async, so it can be refilled while the command is in
+ * flight. SYS updates are marshaled before the previous one is completed,
+ * and the chunk is kept for a resubmission while the other one is filled.
+ * @param stream [in,out] The hash stream.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_RCs produced by Esys_SequenceUpdate_Async or _Finish, or by
+ *         the SYS layer.
+ */
+static TSS2_RC
+hash_stream_send(ESYS_HASH_STREAM *stream)
+{
+    TSS2_RC r;
+    TSS2_SYS_CONTEXT *sys = stream->sys[stream->fill];
+    TPM2B_MAX_BUFFER *chunk = &stream->chunks[stream->fill];
+
+    if (sys == NULL) {
+        r = hash_stream_wait(stream);
+        return_if_error(r, "Completing previous chunk");
+
+        r = Esys_SequenceUpdate_Async(stream->esys_context, stream->sequence,
+                                      stream->shandle1, stream->shandle2,
+                                      stream->shandle3, chunk);
+        return_if_error(r, "Error SequenceUpdate");
+
+        stream->in_flight = true;
+        chunk->size = 0;
+        return TSS2_RC_SUCCESS;
+    }
+
+    /* Write the password auth in place instead of moving the chunk */
+    r = Tss2_Sys_ReserveCmdAuths(sys, &stream->auths);
+    return_if_error(r, "Reserve command auths");
+    r = Tss2_Sys_SequenceUpdate_Prepare(sys, stream->tpm_sequence, chunk);
+    return_if_error(r, "Prepare SequenceUpdate");
+    r = Tss2_Sys_SetCmdAuths(sys, &stream->auths);
+    return_if_error(r, "Set command auths");
+
+    r = hash_stream_wait(stream);
+    return_if_error(r, "Completing previous chunk");
+
+    r = Tss2_Sys_ExecuteAsync(sys);
+    if (r != TSS2_RC_SUCCESS) {
+        hash_stream_free_sys(stream);
+        return_error(r, "Error SequenceUpdate");
+    }
+
+    stream->in_flight = true;
+    stream->fill = 1 - stream->fill;
+    stream->chunks[stream->fill].size = 0;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Start a hash or HMAC sequence for data of arbitrary size.
+ *
+ * The data is passed to the TPM in chunks of the TPM's TPM2_PT_INPUT_BUFFER
+ * size. The sessions are used for all sequence commands; since the sequence
+ * object requires authorization, shandle1 must be given (e.g. as
+ * ESYS_TR_PASSWORD). Hash sequences are started without sessions, HMAC
+ * sequences authorize the key with shandle1. If the only session is
+ * ESYS_TR_PASSWORD, the updates are sent through SYS contexts of the stream,
+ * so that the next command is prepared while the TPM processes the previous
+ * one.
+ * @param esysContext [in,out] The ESYS_CONTEXT.
+ * @param hmacKey [in] The HMAC key, or ESYS_TR_NONE for a hash sequence.
+ * @param hashAlg [in] The hash algorithm, or TPM2_ALG_NULL to use the
+ *        HMAC key's scheme.
+ * @param hierarchy [in] The hierarchy of the ticket of a hash sequence.
+ * @param auth [in] The authValue of the sequence object (optional).
+ * @param shandle1 [in] Session for the sequence (required).
+ * @param shandle2 [in] Session for the sequence (optional).
+ * @param shandle3 [in] Session for the sequence (optional).
+ * @param stream [out] The new hash stream.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or stream is NULL.
+ * @retval TSS2_ESYS_RC_MEMORY if the stream or its SYS contexts can not be
+ *         allocated.
+ * @retval TSS2_RCs produced by Esys_GetCapability, Esys_HashSequenceStart or
+ *         Esys_HMAC_Start.
+ */
+TSS2_RC
+Esys_HashStream_Begin(
+    ESYS_CONTEXT *esysContext,
+    ESYS_TR hmacKey,
+    TPMI_ALG_HASH hashAlg,
+    TPMI_RH_HIERARCHY hierarchy,
+    const TPM2B_AUTH *auth,
+    ESYS_TR shandle1,
+    ESYS_TR shandle2,
+    ESYS_TR shandle3,
+    ESYS_HASH_STREAM **stream)
+{
+    TSS2_RC r;
+    TPM2B_AUTH noAuth = { .size = 0 };
+    ESYS_HASH_STREAM *s;
+
+    _ESYS_ASSERT_NON_NULL(esysContext);
+    _ESYS_ASSERT_NON_NULL(stream);
+    *stream = NULL;
+
+    s = calloc(1, sizeof(ESYS_HASH_STREAM));
+    return_if_null(s, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+    s->esys_context = esysContext;
+    s->shandle1 = shandle1;
+    s->shandle2 = shandle2;
+    s->shandle3 = shandle3;
+    s->hierarchy = hierarchy;
+
+    r = hash_stream_chunk_size(esysContext, &s->chunk_size);
+    goto_if_error(r, "Get chunk size", error_cleanup);
+
+    if (hash_stream_is_prebuilt(shandle1, shandle2, shandle3)) {
+        r = hash_stream_init_sys(s);
+        goto_if_error(r, "Init SYS contexts", error_cleanup);
+    }
+
+    if (hmacKey == ESYS_TR_NONE)
+        r = Esys_HashSequenceStart(esysContext, ESYS_TR_NONE, ESYS_TR_NONE,
+                                   ESYS_TR_NONE, auth, hashAlg, &s->sequence);
+    else
+        r = Esys_HMAC_Start(esysContext, hmacKey, shandle1, shandle2, shandle3,
+                            auth, hashAlg, &s->sequence);
+    goto_if_error(r, "Start sequence", error_cleanup);
+
+    /* Esys_HashSequenceStart does not record the authValue */
+    r = Esys_TR_SetAuth(esysContext, s->sequence,
+                        (auth != NULL) ? auth : &noAuth);
+    if (r != TSS2_RC_SUCCESS) {
+        LOG_ERROR("Set sequence auth " TPM2_ERROR_FORMAT, TPM2_ERROR_TEXT(r));
+        Esys_FlushContext(esysContext, s->sequence);
+        goto error_cleanup;
+    }
+
+    *stream = s;
+    return TSS2_RC_SUCCESS;
+
+error_cleanup:
+    hash_stream_free_sys(s);
+    free(s);
+    return r;
+}
+
+/** Add data from a buffer to a hash stream.
+ *
+ * @param stream [in,out] The hash stream.
+ * @param buffer [in] The data.
+ * @param size [in] The size of buffer.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if stream or buffer (with size > 0)
+ *         is NULL.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if a command is outstanding.
+ * @retval TSS2_RCs produced by Esys_SequenceUpdate, the SYS layer or the
+ *         TPM.
+ */
+TSS2_RC
+Esys_HashStream_Update(
+    ESYS_HASH_STREAM *stream,
+    const uint8_t *buffer,
+    size_t size)
+{
+    TSS2_RC r = TSS2_RC_SUCCESS;
+
+    _ESYS_ASSERT_NON_NULL(stream);
+    if (size > 0)
+        _ESYS_ASSERT_NON_NULL(buffer);
+
+    r = hash_stream_load(stream);
+    return_if_error(r, "Load sequence");
+
+    while (size > 0) {
+        TPM2B_MAX_BUFFER *chunk = &stream->chunks[stream->fill];
+        size_t n;
+
+        if (chunk->size == stream->chunk_size) {
+            r = hash_stream_send(stream);
+            goto_if_error(r, "Send chunk", error_cleanup);
+            chunk = &stream->chunks[stream->fill];
+        }
+
+        n = stream->chunk_size - chunk->size;
+        if (n > size)
+            n = size;
+        memcpy(&chunk->buffer[chunk->size], buffer, n);
+        chunk->size += n;
+        buffer += n;
+        size -= n;
+    }
+
+error_cleanup:
+    if (r == TSS2_RC_SUCCESS)
+        return hash_stream_wait(stream);
+    hash_stream_wait(stream);
+    return r;
+}
+
+/** Add all data read from a file descriptor to a hash stream.
+ *
+ * Reads until end of file. The next chunk is read while the previous one is
+ * processed by the TPM.
+ * @param stream [in,out] The hash stream.
+ * @param fd [in] The file descriptor.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if stream is NULL.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if a command is outstanding.
+ * @retval TSS2_ESYS_RC_IO_ERROR if reading fails.
+ * @retval TSS2_RCs produced by Esys_SequenceUpdate, the SYS layer or the
+ *         TPM.
+ */
+TSS2_RC
+Esys_HashStream_UpdateFd(
+    ESYS_HASH_STREAM *stream,
+    int fd)
+{
+    TSS2_RC r = TSS2_RC_SUCCESS;
+
+    _ESYS_ASSERT_NON_NULL(stream);
+
+    r = hash_stream_load(stream);
+    return_if_error(r, "Load sequence");
+
+    for (;;) {
+        TPM2B_MAX_BUFFER *chunk = &stream->chunks[stream->fill];
+        int n;
+
+        if (chunk->size == stream->chunk_size) {
+            r = hash_stream_send(stream);
+            goto_if_error(r, "Send chunk", error_cleanup);
+            chunk = &stream->chunks[stream->fill];
+        }
+
+        n = read(fd, &chunk->buffer[chunk->size],
+                 stream->chunk_size - chunk->size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) {
+            LOG_ERROR("Reading data to hash failed: %s", strerror(errno));
+            r = TSS2_ESYS_RC_IO_ERROR;
+            goto error_cleanup;
+        }
+        if (n == 0)
+            break;
+        chunk->size += n;
+    }
+
+error_cleanup:
+    if (r == TSS2_RC_SUCCESS)
+        return hash_stream_wait(stream);
+    hash_stream_wait(stream);
+    return r;
+}
+
+/** Complete a hash stream and release it.
+ *
+ * The remaining data is passed with TPM2_SequenceComplete. The sequence
+ * object is flushed by the TPM, or explicitly if completion fails.
+ * @param stream [in,out] The hash stream. Set to NULL.
+ * @param result [out] The digest or HMAC (callee-allocated, may be NULL).
+ * @param validation [out] The ticket of a hash sequence (callee-allocated,
+ *        may be NULL).
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if stream is NULL.
+ * @retval TSS2_RCs produced by Esys_SequenceComplete.
+ */
+TSS2_RC
+Esys_HashStream_End(
+    ESYS_HASH_STREAM **stream,
+    TPM2B_DIGEST **result,
+    TPMT_TK_HASHCHECK **validation)
+{
+    TSS2_RC r;
+    ESYS_HASH_STREAM *s;
+    TPM2B_DIGEST *lresult = NULL;
+    TPMT_TK_HASHCHECK *lvalidation = NULL;
+
+    _ESYS_ASSERT_NON_NULL(stream);
+    _ESYS_ASSERT_NON_NULL(*stream);
+    s = *stream;
+    *stream = NULL;
+    hash_stream_free_sys(s);
+
+    r = Esys_SequenceComplete(s->esys_context, s->sequence,
+                              s->shandle1, s->shandle2, s->shandle3,
+                              &s->chunks[s->fill], s->hierarchy, &lresult,
+                              &lvalidation);
+    if (r != TSS2_RC_SUCCESS) {
+        Esys_FlushContext(s->esys_context, s->sequence);
+        free(s);
+        return_error(r, "Error SequenceComplete");
+    }
+
+    if (result != NULL)
+        *result = lresult;
+    else
+        free(lresult);
+    if (validation != NULL)
+        *validation = lvalidation;
+    else
+        free(lvalidation);
+    free(s);
+    return TSS2_RC_SUCCESS;
+}
+
+/** Abort a hash stream and release it.
+ *
+ * @param stream [in,out] The hash stream. Set to NULL.
+ * @retval TSS2_RC_SUCCESS on success or if *stream is NULL.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if stream is NULL.
+ * @retval TSS2_RCs produced by Esys_FlushContext.
+ */
+TSS2_RC
+Esys_HashStream_Abort(
+    ESYS_HASH_STREAM **stream)
+{
+    TSS2_RC r;
+
+    _ESYS_ASSERT_NON_NULL(stream);
+    if (*stream == NULL)
+        return TSS2_RC_SUCCESS;
+
+    hash_stream_free_sys(*stream);
+    r = Esys_FlushContext((*stream)->esys_context, (*stream)->sequence);
+    SAFE_FREE(*stream);
+    return_if_error(r, "Flush sequence");
+    return TSS2_RC_SUCCESS;
+}
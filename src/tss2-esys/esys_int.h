@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 #include "esys_types.h"
+#include "esys_crypto.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -24,6 +25,20 @@ typedef struct RSRC_NODE_T {
     TPM2B_AUTH auth;            /**< The authValue for this resource object. */
     IESYS_RESOURCE rsrc;        /**< The meta data for this resource object. */
     struct RSRC_NODE_T * next;  /**< The next object in the linked list. */
+    struct RSRC_NODE_T * prev;  /**< The previous object in the linked list. */
+    IESYS_CRYPTO_CONTEXT_BLOB *hmac_context; /**< The HMAC object of a session
+                                     keyed with its HMAC key, or NULL. */
+    BOOL hmac_context_keyed;    /**< Whether hmac_context holds the current
+                                     HMAC key of the session. */
+    IESYS_CRYPTO_PUBKEY *pubkey; /**< The public key of a key object converted
+                                     for the crypto backend, or NULL. */
+    TPMS_CONTEXT *swapped;      /**< The saved context of a transient object or
+                                     session swapped out of the TPM, or NULL if
+                                     it is loaded. */
+    UINT64 last_use;            /**< The swap tick of the last command that
+                                     referenced this resource object. */
+    const void *owner;          /**< The shared context client that created
+                                     this resource object, or NULL. */
 } RSRC_NODE_T;
 
 
@@ -932,6 +947,86 @@ enum _ESYS_STATE {
                                    ESAPI code. */
 };
 
+/** The state of the transient object and session swapping.
+ */
+typedef struct {
+    TSS2_SYS_CONTEXT *sys;       /**< The SYS context used to swap resources
+                                      in and out, or NULL if swapping is
+                                      disabled. */
+    UINT32 max_objects;          /**< The number of transient objects kept
+                                      loaded in the TPM. */
+    UINT32 max_sessions;         /**< The number of sessions kept loaded in
+                                      the TPM. */
+    UINT64 tick;                 /**< The number of commands issued so far. */
+    ESYS_SWAP_STATS stats;       /**< The swap counters. */
+    bool drop;                   /**< Whether the pending TPM2_FlushContext
+                                      drops a swapped out object without
+                                      sending a command. */
+} IESYS_SWAP;
+
+/** A record of the metadata cache that supersedes the cache file.
+ */
+typedef struct {
+    TPM2_HANDLE handle;          /**< The TPM handle of the record. */
+    uint8_t *buffer;             /**< The serialized IESYS_RESOURCE, or NULL
+                                      if the handle was removed. */
+    size_t size;                 /**< The size of buffer. */
+    bool verified;               /**< Whether the name in buffer has been
+                                      checked against its public area. */
+} IESYS_METADATA_RECORD;
+
+/** The metadata cache of persistent objects and NV indices.
+ *
+ * The cache file is mapped read-only; records added or removed since it was
+ * opened are kept in records until Esys_MetadataCache_Save.
+ */
+typedef struct {
+    char *path;                  /**< The path of the cache file. */
+    uint8_t *map;                /**< The contents of the cache file, or NULL
+                                      if it did not exist. */
+    size_t map_size;             /**< The size of map. */
+    UINT32 map_count;            /**< The number of records in map. */
+    bool *map_verified;          /**< For each record in map, whether its name
+                                      has been checked against its public
+                                      area. */
+    IESYS_METADATA_RECORD *records; /**< The records added or removed. */
+    size_t records_count;        /**< The number of entries in records. */
+    ESYS_TR hit;                 /**< The ESYS_TR created from the cache by
+                                      Esys_TR_FromTPMPublic_Async, or
+                                      ESYS_TR_NONE. */
+} IESYS_METADATA_CACHE;
+
+/** A cached TPM2_GetCapability response.
+ */
+typedef struct {
+    TPM2_CAP capability;         /**< The requested capability. */
+    UINT32 property;             /**< The requested first property. */
+    UINT32 propertyCount;        /**< The requested number of properties. */
+    TPMI_YES_NO moreData;        /**< The moreData flag of the response. */
+    TPMS_CAPABILITY_DATA data;   /**< The capability data of the response. */
+} IESYS_CAPABILITY_RECORD;
+
+/** The cache of stable TPM2_GetCapability responses.
+ */
+typedef struct {
+    bool enabled;                /**< Whether responses are cached. */
+    IESYS_CAPABILITY_RECORD *records; /**< The cached responses. */
+    size_t count;                /**< The number of entries in records. */
+    const IESYS_CAPABILITY_RECORD *hit;/**< The response found by
+                                      Esys_GetCapability_Async, or NULL. */
+} IESYS_CAPABILITY_CACHE;
+
+/** The number of NV commands prepared ahead by the bulk NV functions. */
+#define IESYS_NV_BULK_BATCH 8
+
+/** The state of Esys_NV_ReadBulk and Esys_NV_WriteBulk.
+ */
+typedef struct {
+    TSS2_SYS_CONTEXT *sys[IESYS_NV_BULK_BATCH]; /**< The SYS contexts for
+                                      password-authorized chunks, or NULL
+                                      before the first use. */
+} IESYS_NV_BULK;
+
 /** The data structure holding internal state information.
  *
  * Each ESYS_CONTEXT respresents a logically independent connection to the TPM.
@@ -944,6 +1039,12 @@ struct ESYS_CONTEXT {
                                       the TPM. */
     ESYS_TR esys_handle_cnt;     /**< The next free ESYS_TR number. */
     RSRC_NODE_T *rsrc_list;      /**< The linked list of all ESYS_TR objects. */
+    RSRC_NODE_T **rsrc_table;    /**< Open addressing hash table indexing
+                                      rsrc_list by ESYS_TR. */
+    size_t rsrc_table_size;      /**< The number of slots in rsrc_table. */
+    size_t rsrc_count;           /**< The number of objects in rsrc_table. */
+    size_t rsrc_deleted;         /**< The number of deleted slots in
+                                      rsrc_table. */
     int32_t timeout;             /**< The timeout to be used during
                                       Tss2_Sys_ExecuteFinish. */
     ESYS_TR session_type[3];     /**< The list of TPM session handles in the
@@ -970,6 +1071,20 @@ struct ESYS_CONTEXT {
                                            to be returned from Esys_GetTcti().*/
     void *dlhandle;              /**< The handle of dlopen if the tcti was
                                       automatically loaded. */
+    IESYS_CRYPTO_CACHE crypto_cache;/**< The hash and HMAC contexts reused
+                                         for session computations. */
+    IESYS_RANDOM_POOL random_pool;/**< The random bytes for caller nonces
+                                       and salts. */
+    IESYS_SWAP swap;             /**< The state of the transient object and
+                                      session swapping. */
+    IESYS_METADATA_CACHE *metadata_cache;/**< The metadata cache used by
+                                              Esys_TR_FromTPMPublic, or NULL. */
+    IESYS_NV_BULK nv_bulk;       /**< The state of the bulk NV functions. */
+    IESYS_CAPABILITY_CACHE capability_cache;/**< The cache of stable
+                                                 TPM2_GetCapability
+                                                 responses. */
+    const void *owner;           /**< The shared context client whose job is
+                                      currently running, or NULL. */
 };
 
 /** The number of authomatic resubmissions.
@@ -15,6 +15,14 @@
 #include "util/aux_util.h"
 #include <limits.h>
 
+/** The size of a buffer for a parameter encryption key and iv from KDFa.
+ *
+ * KDFa writes whole digests, so the largest key and block are rounded up by
+ * at most one digest.
+ */
+#define IESYS_SYM_KEY_BUFFER_SIZE \
+    (TPM2_MAX_SYM_KEY_BYTES + TPM2_MAX_SYM_BLOCK_SIZE + sizeof(TPMU_HA))
+
 /**
  * Compare variables of type UINT16.
  * @param[in] in1 Variable to be compared with:
@@ -150,14 +158,124 @@ init_session_tab(ESYS_CONTEXT *esys_context,
             r = esys_GetResourceObject(esys_context, handle_tab[i],
                                        &esys_context->session_tab[i]);
             return_if_error(r, "Unknown resource.");
+            r = iesys_check_session_owner(esys_context, handle_tab[i]);
+            return_if_error(r, "Check session owner.");
         }
     }
-    return r;
+    return iesys_swap_in_sessions(esys_context);
+}
+
+/** Marker for a deleted slot of the ESYS_TR hash table. */
+static RSRC_NODE_T iesys_rsrc_deleted;
+
+/** Initial number of slots of the ESYS_TR hash table (power of two). */
+#define IESYS_RSRC_TABLE_MIN_SIZE 32
+
+/** Compute the home slot of an ESYS_TR in the resource hash table.
+ *
+ * The handle bits are mixed, since ESYS_TR values are handed out sequentially
+ * and the table size is a power of two.
+ * @param[in] esys_handle The ESYS_TR to be hashed.
+ * @param[in] size The number of slots of the table.
+ * @retval The index of the home slot.
+ */
+static size_t
+iesys_rsrc_hash(ESYS_TR esys_handle, size_t size)
+{
+    uint32_t h = esys_handle;
+
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+    h ^= h >> 16;
+    return h & (size - 1);
+}
+
+/** Search the slot of an ESYS_TR in the resource hash table.
+ *
+ * @param[in] esys_context The ESYS_CONTEXT.
+ * @param[in] esys_handle The ESYS_TR to be searched.
+ * @retval The slot holding the object or NULL if the object does not exist.
+ */
+static RSRC_NODE_T **
+iesys_rsrc_table_find(ESYS_CONTEXT * esys_context, ESYS_TR esys_handle)
+{
+    size_t size = esys_context->rsrc_table_size;
+    size_t i;
+
+    if (esys_context->rsrc_table == NULL)
+        return NULL;
+
+    for (i = iesys_rsrc_hash(esys_handle, size);
+         esys_context->rsrc_table[i] != NULL; i = (i + 1) & (size - 1)) {
+        if (esys_context->rsrc_table[i] != &iesys_rsrc_deleted &&
+            esys_context->rsrc_table[i]->esys_handle == esys_handle)
+            return &esys_context->rsrc_table[i];
+    }
+    return NULL;
+}
+
+/** Store an object in a free slot of a resource hash table.
+ *
+ * The table must contain at least one empty slot.
+ * @param[in,out] table The slots of the hash table.
+ * @param[in] size The number of slots of the table.
+ * @param[in] node The object to be stored.
+ */
+static void
+iesys_rsrc_table_put(RSRC_NODE_T ** table, size_t size, RSRC_NODE_T * node)
+{
+    size_t i;
+
+    for (i = iesys_rsrc_hash(node->esys_handle, size);
+         table[i] != NULL && table[i] != &iesys_rsrc_deleted;
+         i = (i + 1) & (size - 1));
+    table[i] = node;
+}
+
+/** Rebuild the resource hash table with a new number of slots.
+ *
+ * The objects are rehashed in the order of rsrc_list; deleted slots are
+ * dropped.
+ * @param[in,out] esys_context The ESYS_CONTEXT.
+ * @param[in] size The new number of slots (power of two).
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_MEMORY if the table can not be allocated.
+ */
+static TSS2_RC
+iesys_rsrc_table_resize(ESYS_CONTEXT * esys_context, size_t size)
+{
+    RSRC_NODE_T **table = calloc(size, sizeof(RSRC_NODE_T *));
+    RSRC_NODE_T *node;
+
+    return_if_null(table, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+
+    for (node = esys_context->rsrc_list; node != NULL; node = node->next)
+        iesys_rsrc_table_put(table, size, node);
+
+    SAFE_FREE(esys_context->rsrc_table);
+    esys_context->rsrc_table = table;
+    esys_context->rsrc_table_size = size;
+    esys_context->rsrc_deleted = 0;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Release a resource object and the crypto state attached to it.
+ *
+ * @param[in] node The resource object.
+ */
+static void
+iesys_free_resource_object(RSRC_NODE_T * node)
+{
+    iesys_crypto_hmac_abort(&node->hmac_context);
+    iesys_crypto_pubkey_free(&node->pubkey);
+    free(node->swapped);
+    free(node);
 }
 
 /** Delete all resource objects stored in the esys context.
  *
- * All resource objects stored in a linked list of the esys context are deleted.
+ * All resource objects stored in a linked list of the esys context are deleted
+ * in list order and the hash table indexing them is released.
  * @param[in,out] esys_context The ESYS_CONTEXT
  */
 void
@@ -170,9 +288,51 @@ iesys_DeleteAllResourceObjects(ESYS_CONTEXT * esys_context)
     for (node_rsrc = esys_context->rsrc_list; node_rsrc != NULL;
          node_rsrc = next_node_rsrc) {
         next_node_rsrc = node_rsrc->next;
-        SAFE_FREE(node_rsrc);
+        iesys_free_resource_object(node_rsrc);
     }
+    esys_context->rsrc_list = NULL;
+    SAFE_FREE(esys_context->rsrc_table);
+    esys_context->rsrc_table_size = 0;
+    esys_context->rsrc_count = 0;
+    esys_context->rsrc_deleted = 0;
+}
+
+/** Delete a single resource object stored in the esys context.
+ *
+ * The object is removed from the hash table and unlinked from rsrc_list.
+ * @param[in,out] esys_context The ESYS_CONTEXT
+ * @param[in] esys_handle The esys handle of the object to be deleted.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_TR if the esys handle does not exist.
+ */
+TSS2_RC
+esys_DeleteResourceObject(ESYS_CONTEXT * esys_context, ESYS_TR esys_handle)
+{
+    RSRC_NODE_T **slot;
+    RSRC_NODE_T *node;
+
+    _ESYS_ASSERT_NON_NULL(esys_context);
+
+    slot = iesys_rsrc_table_find(esys_context, esys_handle);
+    if (slot == NULL)
+        return TSS2_ESYS_RC_BAD_TR;
+
+    node = *slot;
+    *slot = &iesys_rsrc_deleted;
+    esys_context->rsrc_count--;
+    esys_context->rsrc_deleted++;
+
+    if (node->prev != NULL)
+        node->prev->next = node->next;
+    else
+        esys_context->rsrc_list = node->next;
+    if (node->next != NULL)
+        node->next->prev = node->prev;
+
+    iesys_free_resource_object(node);
+    return TSS2_RC_SUCCESS;
 }
+
 /**  Compute the TPM nonce of the session used for parameter encryption.
  *
  * Since only encryption session can be used an error is signaled if
@@ -217,6 +377,7 @@ iesys_compute_encrypt_nonce(ESYS_CONTEXT * esys_context,
  * hashes must be calculated.
  * The names of objects with an auth index and the command buffer are used
  * to compute the cp hash with the hash algorithm of the corresponding session.
+ * All cp hashes are computed in a single pass over the command buffer.
  * The result is stored in table together with the used hash algorithm.
  * @param[in] esys_context The ESYS_CONTEXT
  * @param[in] name1 The name of the first object with an auth index.
@@ -258,28 +419,38 @@ iesys_compute_cp_hashtab(ESYS_CONTEXT * esys_context,
             /* We do not want to compute cpHashes multiple times for the same
                algorithm to save time and space */
             for (int j = 0; j < *cpHashNum; j++)
-                /* Check if cpHash for this algorithm was already computed */
+                /* Check if cpHash for this algorithm was already requested */
                 if (cp_hash_tab[j].alg ==
                     session->rsrc.misc.rsrc_session.authHash) {
                     cpHashFound = true;
                     break;
                 }
-            /* If not, we compute it and append it to the list */
+            /* If not, we append it to the list */
             if (!cpHashFound) {
-                cp_hash_tab[*cpHashNum].size = sizeof(TPMU_HA);
-                r = iesys_crypto_cpHash(session->rsrc.misc.rsrc_session.
-                                        authHash, ccBuffer, name1, name2, name3,
-                                        cpBuffer, cpBuffer_size,
-                                        &cp_hash_tab[*cpHashNum].digest[0],
-                                        &cp_hash_tab[*cpHashNum].size);
-                return_if_error(r, "crypto cpHash");
-
                 cp_hash_tab[*cpHashNum].alg =
                     session->rsrc.misc.rsrc_session.authHash;
+                cp_hash_tab[*cpHashNum].size = sizeof(TPMU_HA);
                 *cpHashNum += 1;
             }
         }
     }
+    if (*cpHashNum == 0)
+        return r;
+
+    /* Compute all cpHashes in one pass over the command buffer */
+    TPM2_ALG_ID algs[3];
+    uint8_t *digests[3];
+    size_t *sizes[3];
+    for (int j = 0; j < *cpHashNum; j++) {
+        algs[j] = cp_hash_tab[j].alg;
+        digests[j] = &cp_hash_tab[j].digest[0];
+        sizes[j] = &cp_hash_tab[j].size;
+    }
+    r = iesys_crypto_pHash_multi(&esys_context->crypto_cache, *cpHashNum,
+                                 &algs[0], NULL, ccBuffer, name1, name2, name3,
+                                 cpBuffer, cpBuffer_size, &digests[0],
+                                 &sizes[0]);
+    return_if_error(r, "crypto cpHash");
     return r;
 }
 
@@ -289,6 +460,7 @@ iesys_compute_cp_hashtab(ESYS_CONTEXT * esys_context,
  * hashes must be calculated.
  * The names of objects with an auth index and the command buffer are used
  * to compute the cp hash with the hash algorithm of the corresponding session.
+ * All rp hashes are computed in a single pass over the response buffer.
  * The result is stored in table together with the used hash algorithm.
  * @param[in] esys_context The ESYS_CONTEXT
  * @param[in] rspAuths List of response
@@ -319,6 +491,7 @@ iesys_compute_rp_hashtab(ESYS_CONTEXT * esys_context,
     TSS2_RC r = Tss2_Sys_GetCommandCode(esys_context->sys, &ccBuffer[0]);
     return_if_error(r, "Error: get command code");
 
+    uint8_t first = *rpHashNum;
     for (int i = 0; i < esys_context->authsCount; i++) {
         RSRC_NODE_T *session = esys_context->session_tab[i];
         if (session == NULL)
@@ -331,25 +504,37 @@ iesys_compute_rp_hashtab(ESYS_CONTEXT * esys_context,
                 rpHashFound = true;
                 break;
             }
-        /* If not, we compute it and append it to the list */
+        /* If not, we append it to the list */
         if (!rpHashFound) {
-            rp_hash_tab[*rpHashNum].size = sizeof(TPMU_HA);
-            r = iesys_crypto_rpHash(session->rsrc.misc.rsrc_session.authHash,
-                                    rcBuffer, ccBuffer, rpBuffer, rpBuffer_size,
-                                    &rp_hash_tab[*rpHashNum].digest[0],
-                                    &rp_hash_tab[*rpHashNum].size);
-            return_if_error(r, "crypto rpHash");
             rp_hash_tab[*rpHashNum].alg =
                 session->rsrc.misc.rsrc_session.authHash;
+            rp_hash_tab[*rpHashNum].size = sizeof(TPMU_HA);
             *rpHashNum += 1;
         }
     }
+    if (*rpHashNum == first)
+        return TPM2_RC_SUCCESS;
+
+    /* Compute all new rpHashes in one pass over the response buffer */
+    TPM2_ALG_ID algs[3];
+    uint8_t *digests[3];
+    size_t *sizes[3];
+    for (int j = first; j < *rpHashNum; j++) {
+        algs[j - first] = rp_hash_tab[j].alg;
+        digests[j - first] = &rp_hash_tab[j].digest[0];
+        sizes[j - first] = &rp_hash_tab[j].size;
+    }
+    r = iesys_crypto_pHash_multi(&esys_context->crypto_cache,
+                                 *rpHashNum - first, &algs[0], rcBuffer,
+                                 ccBuffer, NULL, NULL, NULL, rpBuffer,
+                                 rpBuffer_size, &digests[0], &sizes[0]);
+    return_if_error(r, "crypto rpHash");
     return TPM2_RC_SUCCESS;
 }
 /** Create an esys resource object corresponding to a TPM object.
  *
- * The esys object is appended to the resource list stored in the esys context
- * (rsrc_list).
+ * The esys object is prepended to the resource list stored in the esys context
+ * (rsrc_list) and indexed in the hash table (rsrc_table).
  * @param[in] esys_context The ESYS_CONTEXT
  * @param[in] esys_handle The esys handle which will be used for this object.
  * @param[out] esys_object The new resource object.
@@ -360,23 +545,43 @@ TSS2_RC
 esys_CreateResourceObject(ESYS_CONTEXT * esys_context,
                           ESYS_TR esys_handle, RSRC_NODE_T ** esys_object)
 {
+    TSS2_RC r;
+
     _ESYS_ASSERT_NON_NULL(esys_context);
     _ESYS_ASSERT_NON_NULL(esys_object);
 
+    size_t size = esys_context->rsrc_table_size;
+
+    /* Keep the load factor including deleted slots below 3/4. If the table
+       is mostly filled with deleted slots, it is only rehashed in place. */
+    if ((esys_context->rsrc_count + esys_context->rsrc_deleted + 1) * 4
+            > size * 3) {
+        if (size < IESYS_RSRC_TABLE_MIN_SIZE)
+            size = IESYS_RSRC_TABLE_MIN_SIZE;
+        else if ((esys_context->rsrc_count + 1) * 2 > size)
+            size *= 2;
+        r = iesys_rsrc_table_resize(esys_context, size);
+        return_if_error(r, "Resizing resource table.");
+    }
+
     RSRC_NODE_T *new_esys_object = calloc(1, sizeof(RSRC_NODE_T));
     if (new_esys_object == NULL)
         return_error(TSS2_ESYS_RC_MEMORY, "Out of memory.");
-    if (esys_context->rsrc_list == NULL) {
-        /* The first object of the list will be added */
-        esys_context->rsrc_list = new_esys_object;
-        new_esys_object->next = NULL;
-    } else {
-        /* The new object will become the first element of the list */
-        new_esys_object->next = esys_context->rsrc_list;
-        esys_context->rsrc_list = new_esys_object;
-    }
-    *esys_object = new_esys_object;
+
+    /* The new object will become the first element of the list */
+    new_esys_object->next = esys_context->rsrc_list;
+    new_esys_object->prev = NULL;
+    if (esys_context->rsrc_list != NULL)
+        esys_context->rsrc_list->prev = new_esys_object;
+    esys_context->rsrc_list = new_esys_object;
+
     new_esys_object->esys_handle = esys_handle;
+    new_esys_object->last_use = esys_context->swap.tick;
+    new_esys_object->owner = esys_context->owner;
+    iesys_rsrc_table_put(esys_context->rsrc_table,
+                         esys_context->rsrc_table_size, new_esys_object);
+    esys_context->rsrc_count++;
+    *esys_object = new_esys_object;
     return TSS2_RC_SUCCESS;
 }
 
@@ -517,13 +722,15 @@ iesys_compute_encrypted_salt(ESYS_CONTEXT * esys_context,
     switch (pub.publicArea.type) {
     case TPM2_ALG_RSA:
 
-        iesys_crypto_random2b((TPM2B_NONCE *) & esys_context->salt,
-                              keyHash_size);
+        r = iesys_crypto_random_pool_get(&esys_context->random_pool,
+                                         (TPM2B_NONCE *) & esys_context->salt,
+                                         keyHash_size);
+        return_if_error(r, "Error: computing salt.");
 
         /* When encrypting salts, the encryption scheme of a key is ignored and
            TPM2_ALG_OAEP is always used. */
         pub.publicArea.parameters.rsaDetail.scheme.scheme = TPM2_ALG_OAEP;
-        r = iesys_crypto_pk_encrypt(&pub,
+        r = iesys_crypto_pk_encrypt(&tpmKeyNode->pubkey, &pub,
                                     keyHash_size, &esys_context->salt.buffer[0],
                                     sizeof(TPMU_ENCRYPTED_SECRET),
                                     (BYTE *) &encryptedSalt->secret[0], &cSize,
@@ -533,7 +740,8 @@ iesys_compute_encrypted_salt(ESYS_CONTEXT * esys_context,
         encryptedSalt->size = cSize;
         break;
     case TPM2_ALG_ECC:
-        r = iesys_crypto_get_ecdh_point(&pub, sizeof(TPMU_ENCRYPTED_SECRET),
+        r = iesys_crypto_get_ecdh_point(&tpmKeyNode->pubkey, &pub,
+                                        sizeof(TPMU_ENCRYPTED_SECRET),
                                         &Z, &Q,
                                         (BYTE *) &encryptedSalt->secret[0],
                                         &cSize);
@@ -583,8 +791,9 @@ iesys_gen_caller_nonces(ESYS_CONTEXT * esys_context)
                                               authHash, &authHash_size);
         return_if_error(r, "Error: initialize auth session.");
 
-        r = iesys_crypto_random2b(&session->rsrc.misc.rsrc_session.nonceCaller,
-                                authHash_size);
+        r = iesys_crypto_random_pool_get(&esys_context->random_pool,
+                                         &session->rsrc.misc.rsrc_session.nonceCaller,
+                                         authHash_size);
         return_if_error(r, "Error: computing caller nonce (%x).");
     }
     return TSS2_RC_SUCCESS;
@@ -638,24 +847,17 @@ iesys_encrypt_param(ESYS_CONTEXT * esys_context,
                                TSS2_ESYS_RC_MULTIPLE_DECRYPT_SESSIONS);
             *decryptNonceIdx = i;
             *decryptNonce = &rsrc_session->nonceTPM;
-            size_t hlen;
-            r = iesys_crypto_hash_get_digest_size(rsrc_session->authHash, &hlen);
-            return_if_error(r, "get digest size");
-            size_t key_len = TPM2_MAX_SYM_KEY_BYTES + TPM2_MAX_SYM_BLOCK_SIZE;
-            if (key_len % hlen > 0)
-                key_len = key_len + hlen - (key_len % hlen);
-            uint8_t symKey[key_len];
+            uint8_t symKey[IESYS_SYM_KEY_BUFFER_SIZE];
             size_t paramSize = 0;
-            const uint8_t *paramBuffer;
-            r = Tss2_Sys_GetDecryptParam(esys_context->sys, &paramSize,
-                                         &paramBuffer);
+            uint8_t *paramBuffer;
+            /* The parameter is encrypted in place in the command buffer */
+            r = Tss2_Sys_GetDecryptParamBuffer(esys_context->sys, &paramSize,
+                                               &paramBuffer);
             return_if_error(r, "Encryption not possible");
 
             if (paramSize == 0)
                 continue;
 
-            BYTE encrypt_buffer[paramSize];
-            memcpy(&encrypt_buffer[0], paramBuffer, paramSize);
             LOGBLOB_DEBUG(paramBuffer, paramSize, "param to encrypt");
 
             /* AES encryption with key derived with KDFa */
@@ -664,7 +866,8 @@ iesys_encrypt_param(ESYS_CONTEXT * esys_context,
                     return_error(TSS2_ESYS_RC_BAD_VALUE,
                                  "Invalid symmetric mode (must be CFB)");
                 }
-                r = iesys_crypto_KDFa(rsrc_session->authHash,
+                r = iesys_crypto_KDFa(&esys_context->crypto_cache,
+                                      rsrc_session->authHash,
                                       &rsrc_session->sessionValue[0],
                                       rsrc_session->sizeSessionValue, "CFB",
                                       &rsrc_session->nonceCaller,
@@ -674,34 +877,31 @@ iesys_encrypt_param(ESYS_CONTEXT * esys_context,
                 return_if_error(r, "while computing KDFa");
 
                 size_t aes_off = ( symDef->keyBits.aes + 7) / 8;
-                r = iesys_crypto_sym_aes_encrypt(&symKey[0],
+                r = iesys_crypto_sym_aes_encrypt(&esys_context->crypto_cache.cipher,
+                                                 &symKey[0],
                                                  symDef->algorithm,
                                                  symDef->keyBits.aes,
                                                  symDef->mode.aes,
                                                  AES_BLOCK_SIZE_IN_BYTES,
-                                                 &encrypt_buffer[0], paramSize,
+                                                 paramBuffer, paramSize,
                                                  &symKey[aes_off]);
                 return_if_error(r, "AES encryption not possible");
             }
             /* XOR obfuscation of parameter */
             else if (symDef->algorithm == TPM2_ALG_XOR) {
-                r = iesys_xor_parameter_obfuscation(rsrc_session->authHash,
+                r = iesys_xor_parameter_obfuscation(&esys_context->crypto_cache,
+                                                    rsrc_session->authHash,
                                                     &rsrc_session->sessionValue[0],
                                                     rsrc_session->sizeSessionValue,
                                                     &rsrc_session->nonceCaller,
                                                     &rsrc_session->nonceTPM,
-                                                    &encrypt_buffer[0],
-                                                    paramSize);
+                                                    paramBuffer, paramSize);
                 return_if_error(r, "XOR obfuscation not possible.");
 
             } else {
                 return_error(TSS2_ESYS_RC_BAD_VALUE,
                              "Invalid symmetric algorithm (should be XOR or AES)");
             }
-            r = Tss2_Sys_SetDecryptParam(esys_context->sys, paramSize,
-                                         &encrypt_buffer[0]);
-            return_if_error(r, "Set encrypt parameter not possible");
-
         }
     }
     return r;
@@ -710,10 +910,9 @@ iesys_encrypt_param(ESYS_CONTEXT * esys_context,
 /** Parameter decryption with AES or XOR obfuscation.
  *
  * One parameter of a TPM response will be decrypted with the selected method.
- * @param[in]  esys_context The ESYS_CONTEXT.
- * @param[in,out] rpBuffer The buffer to be encrypted. The ecrypted data will be
- *                overridden by the result.
- * @param[in] rpBuffer_size The size of the encrypted data buffer.
+ * The parameter is decrypted in place in the response buffer of the SAPI
+ * context; it is determined with Tss2_Sys_GetEncryptParamBuffer.
+ * @param[in,out] esys_context The ESYS_CONTEXT.
  * @retval TSS2_RC_SUCCESS on success.
  * @retval TSS2_ESYS_RC_MEMORY Memory can not be allocated.
  * @retval TSS2_ESYS_RC_BAD_VALUE for invalid parameters.
@@ -723,33 +922,21 @@ iesys_encrypt_param(ESYS_CONTEXT * esys_context,
  * @retval TSS2_SYS_RC_* for SAPI errors.
  */
  TSS2_RC
-iesys_decrypt_param(ESYS_CONTEXT * esys_context,
-                    const uint8_t * rpBuffer, size_t rpBuffer_size)
+iesys_decrypt_param(ESYS_CONTEXT * esys_context)
 {
     _ESYS_ASSERT_NON_NULL(esys_context);
-    _ESYS_ASSERT_NON_NULL(rpBuffer);
 
-    size_t hlen;
     RSRC_NODE_T *session;
     session = esys_context->session_tab[esys_context->encryptNonceIdx];
     IESYS_SESSION *rsrc_session = &session->rsrc.misc.rsrc_session;
     TPMT_SYM_DEF *symDef = &rsrc_session->symmetric;
-    TSS2_RC r = iesys_crypto_hash_get_digest_size(rsrc_session->authHash, &hlen);
-    return_if_error(r, "Error");
-    size_t key_len = TPM2_MAX_SYM_KEY_BYTES + TPM2_MAX_SYM_BLOCK_SIZE;
-
-    if (key_len % hlen > 0)
-        key_len = key_len + hlen - (key_len % hlen);
-    uint8_t symKey[key_len];
-    UINT16 p2BSize = 0;
-    size_t offset = 0;
-    r = Tss2_MU_UINT16_Unmarshal(rpBuffer, rpBuffer_size, &offset, &p2BSize);
-    return_if_error(r, "Unmarshal error");
-    if (p2BSize > rpBuffer_size) {
-        return_error(TSS2_ESYS_RC_BAD_VALUE,
-                     "Invalid length encrypted response.");
-    }
-    LOGBLOB_DEBUG(rpBuffer, p2BSize, "IESYS encrypt data");
+    uint8_t symKey[IESYS_SYM_KEY_BUFFER_SIZE];
+    size_t p2BSize = 0;
+    uint8_t *p2BBuffer;
+    TSS2_RC r = Tss2_Sys_GetEncryptParamBuffer(esys_context->sys, &p2BSize,
+                                               &p2BBuffer);
+    return_if_error(r, "Invalid encrypted response parameter");
+    LOGBLOB_DEBUG(p2BBuffer, p2BSize, "IESYS encrypt data");
 
     if (symDef->algorithm == TPM2_ALG_AES) {
 
@@ -762,7 +949,8 @@ iesys_decrypt_param(ESYS_CONTEXT * esys_context,
                       rsrc_session->sessionKey.size,
                       "IESYS encrypt session key");
 
-        r = iesys_crypto_KDFa(rsrc_session->authHash,
+        r = iesys_crypto_KDFa(&esys_context->crypto_cache,
+                              rsrc_session->authHash,
                               &rsrc_session->sessionValue[0],
                               rsrc_session->sizeSessionValue,
                               "CFB", &rsrc_session->nonceTPM,
@@ -777,25 +965,26 @@ iesys_decrypt_param(ESYS_CONTEXT * esys_context,
                       "IESYS encrypt KDFa key");
 
         size_t aes_off = ( symDef->keyBits.aes + 7) / 8;
-        r = iesys_crypto_sym_aes_decrypt(&symKey[0],
+        r = iesys_crypto_sym_aes_decrypt(&esys_context->crypto_cache.cipher,
+                                     &symKey[0],
                                      symDef->algorithm,
                                      symDef->keyBits.aes,
                                      symDef->mode.aes,
                                      AES_BLOCK_SIZE_IN_BYTES,
-                                     (uint8_t *) & rpBuffer[2], p2BSize,
+                                     p2BBuffer, p2BSize,
                                      &symKey[aes_off]);
         return_if_error(r, "Decryption error");
 
     } else if (symDef->algorithm == TPM2_ALG_XOR) {
 
         /* Parameter decryption with XOR obfuscation */
-        r = iesys_xor_parameter_obfuscation(rsrc_session->authHash,
+        r = iesys_xor_parameter_obfuscation(&esys_context->crypto_cache,
+                                            rsrc_session->authHash,
                                             &rsrc_session->sessionValue[0],
                                             rsrc_session->sizeSessionValue,
                                             &rsrc_session->nonceTPM,
                                             &rsrc_session->nonceCaller,
-                                            (uint8_t *) & rpBuffer[2],
-                                            p2BSize);
+                                            p2BBuffer, p2BSize);
         return_if_error(r, "XOR obfuscation not possible.");
 
     } else {
@@ -805,6 +994,41 @@ iesys_decrypt_param(ESYS_CONTEXT * esys_context,
     return TSS2_RC_SUCCESS;
 }
 
+/** Provide the HMAC object of a session keyed with its HMAC key.
+ *
+ * The object is created on first use and rekeyed only if the HMAC key of the
+ * session was changed since, so the key schedule is computed once per key.
+ * @param[in,out] session The session resource object.
+ * @param[out] context The keyed HMAC object (owned by the session).
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_MEMORY Memory can not be allocated.
+ * @retval TSS2_ESYS_RC_NOT_IMPLEMENTED if hash algorithm is not implemented.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE for errors of the crypto library.
+ */
+static TSS2_RC
+iesys_session_hmac_context(RSRC_NODE_T * session,
+                           IESYS_CRYPTO_CONTEXT_BLOB ** context)
+{
+    TSS2_RC r;
+    IESYS_SESSION *rsrc_session = &session->rsrc.misc.rsrc_session;
+
+    if (session->hmac_context == NULL) {
+        r = iesys_crypto_hmac_start(&session->hmac_context,
+                                    rsrc_session->authHash,
+                                    &rsrc_session->sessionValue[0],
+                                    rsrc_session->sizeHmacValue);
+        return_if_error(r, "Start session HMAC");
+    } else if (!session->hmac_context_keyed) {
+        r = iesys_crypto_hmac_rekey(session->hmac_context,
+                                    &rsrc_session->sessionValue[0],
+                                    rsrc_session->sizeHmacValue);
+        return_if_error(r, "Rekey session HMAC");
+    }
+    session->hmac_context_keyed = TRUE;
+    *context = session->hmac_context;
+    return TSS2_RC_SUCCESS;
+}
+
 /** Check the HMAC values of the response for all sessions.
  *
  * The HMAC values are computed based on the session secrets, the used nonces,
@@ -830,6 +1054,7 @@ iesys_check_rp_hmacs(ESYS_CONTEXT * esys_context,
     _ESYS_ASSERT_NON_NULL(rp_hash_tab);
 
     TSS2_RC r;
+    IESYS_CRYPTO_CONTEXT_BLOB *hmac_context;
     for (int i = 0; i < rspAuths->count; i++) {
         RSRC_NODE_T *session = esys_context->session_tab[i];
         if (session == NULL)
@@ -863,15 +1088,15 @@ iesys_check_rp_hmacs(ESYS_CONTEXT * esys_context,
         rsrc_session->nonceTPM = rspAuths->auths[i].nonce;
         rsrc_session->sessionAttributes =
             rspAuths->auths[i].sessionAttributes;
-        r = iesys_crypto_authHmac(rsrc_session->authHash,
-                                  &rsrc_session->sessionValue[0],
-                                  rsrc_session->sizeHmacValue,
-                                  &rp_hash_tab[hi].digest[0],
-                                  rp_hash_tab[hi].size,
-                                  &rsrc_session->nonceTPM,
-                                  &rsrc_session->nonceCaller, NULL, NULL,
-                                  rspAuths->auths[i].sessionAttributes,
-                                  &rp_hmac);
+        r = iesys_session_hmac_context(session, &hmac_context);
+        return_if_error(r, "HMAC error");
+        r = iesys_crypto_authHmac_keyed(hmac_context,
+                                        &rp_hash_tab[hi].digest[0],
+                                        rp_hash_tab[hi].size,
+                                        &rsrc_session->nonceTPM,
+                                        &rsrc_session->nonceCaller, NULL, NULL,
+                                        rspAuths->auths[i].sessionAttributes,
+                                        &rp_hmac);
         return_if_error(r, "HMAC error");
 
         if (!cmp_TPM2B_AUTH(&rspAuths->auths[i].hmac, &rp_hmac)) {
@@ -956,13 +1181,11 @@ iesys_is_object_bound(const TPM2B_NAME * name,
  * @param[in] auth_value auth value of the object to be authorized
  *             (NULL if no authorization)
  */
-void
-iesys_compute_session_value(RSRC_NODE_T * session,
-                            const TPM2B_NAME * name,
-                            const TPM2B_AUTH * auth_value)
+static void
+iesys_update_session_value(RSRC_NODE_T * session,
+                           const TPM2B_NAME * name,
+                           const TPM2B_AUTH * auth_value)
 {
-    if (session == NULL)
-        return;
 
     /* First the session Key is copied into the sessionValue */
     session->rsrc.misc.rsrc_session.sizeSessionValue
@@ -1006,6 +1229,53 @@ iesys_compute_session_value(RSRC_NODE_T * session,
     session->rsrc.misc.rsrc_session.sizeHmacValue += auth_value->size; 
 }
 
+/** Compute the session value.
+ *
+ * See iesys_update_session_value. The keyed HMAC object of the session is
+ * invalidated if the HMAC key (the first sizeHmacValue bytes of the session
+ * value) changes.
+ * @param[in,out] session for which the session value will be computed.
+ * @param[in] name name of the object to be authorized (NULL if no authorization)
+ * @param[in] auth_value auth value of the object to be authorized
+ *             (NULL if no authorization)
+ */
+void
+iesys_compute_session_value(RSRC_NODE_T * session,
+                            const TPM2B_NAME * name,
+                            const TPM2B_AUTH * auth_value)
+{
+    if (session == NULL)
+        return;
+
+    IESYS_SESSION *rsrc_session = &session->rsrc.misc.rsrc_session;
+    UINT16 sizeHmacValue = rsrc_session->sizeHmacValue;
+    BYTE hmacValue[sizeof(rsrc_session->sessionValue)];
+
+    if (sizeHmacValue > sizeof(hmacValue))
+        sizeHmacValue = sizeof(hmacValue);
+    memcpy(&hmacValue[0], &rsrc_session->sessionValue[0], sizeHmacValue);
+
+    iesys_update_session_value(session, name, auth_value);
+
+    if (rsrc_session->sizeHmacValue != sizeHmacValue ||
+        memcmp(&hmacValue[0], &rsrc_session->sessionValue[0],
+               sizeHmacValue) != 0)
+        iesys_invalidate_session_hmac(session);
+}
+
+/** Invalidate the keyed HMAC object of a session.
+ *
+ * Has to be called whenever the HMAC key of the session changes. The object
+ * is rekeyed when the next HMAC is computed.
+ * @param[in,out] session The session resource object.
+ */
+void
+iesys_invalidate_session_hmac(RSRC_NODE_T * session)
+{
+    if (session != NULL)
+        session->hmac_context_keyed = FALSE;
+}
+
 /**
  * Lookup the object to a handle from inside the context.
  *
@@ -1029,6 +1299,7 @@ esys_GetResourceObject(ESYS_CONTEXT * esys_context,
                        ESYS_TR esys_handle, RSRC_NODE_T ** esys_object)
 {
     RSRC_NODE_T *esys_object_aux = NULL;
+    RSRC_NODE_T **slot;
     TPM2_HANDLE tpm_handle;
     size_t offset = 0;
     TSS2_RC r;
@@ -1045,17 +1316,15 @@ esys_GetResourceObject(ESYS_CONTEXT * esys_context,
     }
 
     /* The typical case is that we have a resource object already within the
-       esys context's linked list. We iterate through the list and search
-       for the corresponding object and return it if found.
+       esys context's hash table. We look up the corresponding object and
+       return it if found.
        If no object is found, this can be an erroneous handle number or it
        can be because of a reference "global" object that does not require
        previous initialization. */
-    for (esys_object_aux = esys_context->rsrc_list; esys_object_aux != NULL;
-         esys_object_aux = esys_object_aux->next) {
-        if (esys_object_aux->esys_handle == esys_handle) {
-            *esys_object = esys_object_aux;
-            return TPM2_RC_SUCCESS;
-        }
+    slot = iesys_rsrc_table_find(esys_context, esys_handle);
+    if (slot != NULL) {
+        *esys_object = *slot;
+        return TPM2_RC_SUCCESS;
     }
 
     /* All objects with a TR-handle larger than ESYS_TR_MIN_OBJECT must have
@@ -1089,6 +1358,32 @@ esys_GetResourceObject(ESYS_CONTEXT * esys_context,
     return TSS2_RC_SUCCESS;
 }
 
+/** Check that a session may be used by the current client.
+ *
+ * Within a shared context, sessions are private to the client that started
+ * them. Handles that are unknown or do not refer to a session pass; their
+ * errors are reported by the lookup of the caller.
+ * @param[in] esys_context The esys context.
+ * @param[in] esys_handle The ESYS_TR used by the current client.
+ * @retval TSS2_RC_SUCCESS if the handle may be used.
+ * @retval TSS2_ESYS_RC_BAD_TR if the session belongs to another client.
+ */
+TSS2_RC
+iesys_check_session_owner(ESYS_CONTEXT * esys_context, ESYS_TR esys_handle)
+{
+    RSRC_NODE_T **slot;
+
+    if (esys_context->owner == NULL)
+        return TSS2_RC_SUCCESS;
+    slot = iesys_rsrc_table_find(esys_context, esys_handle);
+    if (slot == NULL || (*slot)->rsrc.rsrcType != IESYSC_SESSION_RSRC)
+        return TSS2_RC_SUCCESS;
+    if ((*slot)->owner != NULL && (*slot)->owner != esys_context->owner) {
+        return_error(TSS2_ESYS_RC_BAD_TR, "Session owned by another client.");
+    }
+    return TSS2_RC_SUCCESS;
+}
+
 /**
  * Check that the esys context is ready for an _async call.
  *
@@ -1165,6 +1460,8 @@ check_session_feasibility(ESYS_TR shandle1, ESYS_TR shandle2, ESYS_TR shandle3,
  * The HMAC is computed from the appropriate cp hash, the caller nonce, the TPM
  * nonce and the session attributes. If an encrypt session is not the first
  * session also the encrypt and the decrypt nonce have to be included.
+ * The HMAC object of the session is reused as long as its HMAC key does not
+ * change.
  * @param[in] session The session for which the HMAC has to be computed.
  * @param[in] cp_hash_tab The table of computed cp hash values.
  * @param[in] cpHashNum The number of computed cp hash values which depens on
@@ -1192,6 +1489,7 @@ iesys_compute_hmac(RSRC_NODE_T * session,
 {
     TSS2_RC r;
     size_t authHash_size = 0;
+    IESYS_CRYPTO_CONTEXT_BLOB *hmac_context;
 
     if (session != NULL) {
         _ESYS_ASSERT_NON_NULL(auth);
@@ -1213,15 +1511,16 @@ iesys_compute_hmac(RSRC_NODE_T * session,
         /* if other than first session is used for for parameter encryption
            the corresponding nonces have to be included into the hmac
            computation of the first session */
-        r = iesys_crypto_authHmac(rsrc_session->authHash,
-                                  &rsrc_session->sessionValue[0],
-                                  rsrc_session->sizeHmacValue,
-                                  &cp_hash_tab[hi].digest[0],
-                                  cp_hash_tab[hi].size,
-                                  &rsrc_session->nonceCaller,
-                                  &rsrc_session->nonceTPM,
-                                  decryptNonce, encryptNonce,
-                                  rsrc_session->sessionAttributes, &auth->hmac);
+        r = iesys_session_hmac_context(session, &hmac_context);
+        return_if_error(r, "HMAC error");
+        r = iesys_crypto_authHmac_keyed(hmac_context,
+                                        &cp_hash_tab[hi].digest[0],
+                                        cp_hash_tab[hi].size,
+                                        &rsrc_session->nonceCaller,
+                                        &rsrc_session->nonceTPM,
+                                        decryptNonce, encryptNonce,
+                                        rsrc_session->sessionAttributes,
+                                        &auth->hmac);
         return_if_error(r, "HMAC error");
         auth->sessionHandle = session->rsrc.handle;
         auth->nonce = rsrc_session->nonceCaller;
@@ -1231,6 +1530,95 @@ iesys_compute_hmac(RSRC_NODE_T * session,
     return TSS2_RC_SUCCESS;
 }
 
+/** Reserve the authorization area of the next command in the SAPI buffer.
+ *
+ * Declares the number of authorizations and the sizes of their nonces and
+ * HMACs, as iesys_gen_auths will produce them, before the command is
+ * prepared. Tss2_Sys_SetCmdAuths then writes the authorizations into the
+ * reserved gap instead of moving the marshalled parameters. Unknown session
+ * handles or hash algorithms leave the area unreserved; the errors are
+ * reported by init_session_tab and iesys_gen_auths.
+ * @param[in] esys_context The esys context to issue the command on.
+ * @param[in] shandle1-3 The session handles of the command.
+ * @param[in] h1-3 The resource objects authorized by the sessions.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_SYS_RC_* for SAPI errors.
+ */
+static TSS2_RC
+iesys_reserve_auths(ESYS_CONTEXT * esys_context,
+                    ESYS_TR shandle1, ESYS_TR shandle2, ESYS_TR shandle3,
+                    RSRC_NODE_T * h1, RSRC_NODE_T * h2, RSRC_NODE_T * h3)
+{
+    ESYS_TR shandles[] = { shandle1, shandle2, shandle3 };
+    RSRC_NODE_T *objects[] = { h1, h2, h3 };
+    TSS2L_SYS_AUTH_COMMAND layout = { .count = 0 };
+    TPMS_AUTH_COMMAND *auth;
+    RSRC_NODE_T *session;
+    size_t authHash_size;
+    TSS2_RC r;
+
+    for (int i = 0; i < 3; i++) {
+        if (shandles[i] == ESYS_TR_NONE)
+            continue;
+        auth = &layout.auths[layout.count++];
+        if (shandles[i] == ESYS_TR_PASSWORD) {
+            auth->hmac.size = (objects[i] == NULL) ? 0 : objects[i]->auth.size;
+            continue;
+        }
+        if (esys_GetResourceObject(esys_context, shandles[i], &session)
+                != TSS2_RC_SUCCESS)
+            goto none;
+        IESYS_SESSION *rsrc_session = &session->rsrc.misc.rsrc_session;
+        if (rsrc_session->type_policy_session == POLICY_PASSWORD) {
+            auth->hmac.size = (objects[i] == NULL) ? 0 : objects[i]->auth.size;
+            continue;
+        }
+        if (iesys_crypto_hash_get_digest_size(rsrc_session->authHash,
+                                              &authHash_size)
+                != TSS2_RC_SUCCESS)
+            goto none;
+        auth->nonce.size = authHash_size;
+        auth->hmac.size = authHash_size;
+    }
+    r = Tss2_Sys_ReserveCmdAuths(esys_context->sys, &layout);
+    return_if_error(r, "Reserve command auths");
+    return TSS2_RC_SUCCESS;
+
+none:
+    r = Tss2_Sys_ReserveCmdAuths(esys_context->sys, NULL);
+    return_if_error(r, "Reserve command auths");
+    return TSS2_RC_SUCCESS;
+}
+
+/** Prepare the ESYS_CONTEXT for the next command.
+ *
+ * Called by all Esys_*_Async functions once the handles of the command are
+ * resolved and before the command is prepared in the SAPI buffer. Loads the
+ * swapped out objects and sessions referenced by the command handles and
+ * reserves the authorization area of the sessions.
+ * @param[in,out] esys_context The esys context to issue the command on.
+ * @param[in] command_code The command code of the command.
+ * @param[in] shandle1-3 The session handles of the command.
+ * @param[in,out] h1-3 The resource objects of the command handles.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_RCs produced by iesys_swap_in or Tss2_Sys_ReserveCmdAuths.
+ */
+TSS2_RC
+iesys_prepare_command(ESYS_CONTEXT * esys_context, TPM2_CC command_code,
+                      ESYS_TR shandle1, ESYS_TR shandle2, ESYS_TR shandle3,
+                      RSRC_NODE_T * h1, RSRC_NODE_T * h2, RSRC_NODE_T * h3)
+{
+    TSS2_RC r;
+
+    r = iesys_swap_in(esys_context, command_code, h1, h2, h3);
+    return_if_error(r, "Swap in objects");
+
+    r = iesys_reserve_auths(esys_context, shandle1, shandle2, shandle3,
+                            h1, h2, h3);
+    return_if_error(r, "Reserve auths");
+    return TSS2_RC_SUCCESS;
+}
+
 /** Compute the auth values (HMACs) for all sessions.
  *
  * The caller nonce, the encrypt nonces, the cp hashes, and the HMAC values for
@@ -1398,7 +1786,7 @@ iesys_check_response(ESYS_CONTEXT * esys_context)
         return_if_error(r, "Error: response hmac check");
 
         if (esys_context->encryptNonce != NULL) {
-            r = iesys_decrypt_param(esys_context, rpBuffer, rpBuffer_size);
+            r = iesys_decrypt_param(esys_context);
             return_if_error(r, "Error: while decrypting parameter.");
         }
     }
@@ -37,9 +37,17 @@ TSS2_RC init_session_tab(
     ESYS_CONTEXT *esysContext,
     ESYS_TR shandle1, ESYS_TR shandle2, ESYS_TR shandle3);
 
+TSS2_RC iesys_check_session_owner(
+    ESYS_CONTEXT *esys_context,
+    ESYS_TR esys_handle);
+
 void iesys_DeleteAllResourceObjects(
     ESYS_CONTEXT *esys_context);
 
+TSS2_RC esys_DeleteResourceObject(
+    ESYS_CONTEXT *esys_context,
+    ESYS_TR esys_handle);
+
 TSS2_RC iesys_compute_encrypt_nonce(
     ESYS_CONTEXT *esysContext,
     int *encryptNonceIdx,
@@ -97,9 +105,7 @@ TSS2_RC iesys_encrypt_param(
     int *decryptNonceIdx);
 
 TSS2_RC iesys_decrypt_param(
-    ESYS_CONTEXT *esysContext,
-    const uint8_t *rpBuffer,
-    size_t rpBuffer_size);
+    ESYS_CONTEXT *esysContext);
 
 TSS2_RC iesys_check_rp_hmacs(
     ESYS_CONTEXT *esysContext,
@@ -131,6 +137,9 @@ void iesys_compute_session_value(
     const TPM2B_NAME *name,
     const TPM2B_AUTH *auth_value);
 
+void iesys_invalidate_session_hmac(
+    RSRC_NODE_T *session);
+
 TSS2_RC iesys_compute_hmac(
     RSRC_NODE_T *session,
     HASH_TAB_ITEM cp_hash_tab[3],
@@ -139,6 +148,16 @@ TSS2_RC iesys_compute_hmac(
     TPM2B_NONCE *encryptNonce,
     TPMS_AUTH_COMMAND *auth);
 
+TSS2_RC iesys_prepare_command(
+    ESYS_CONTEXT *esysContext,
+    TPM2_CC command_code,
+    ESYS_TR shandle1,
+    ESYS_TR shandle2,
+    ESYS_TR shandle3,
+    RSRC_NODE_T *h1,
+    RSRC_NODE_T *h2,
+    RSRC_NODE_T *h3);
+
 TSS2_RC iesys_gen_auths(
     ESYS_CONTEXT *esysContext,
     RSRC_NODE_T *h1,
@@ -160,6 +179,60 @@ TSS2_RC iesys_get_name(
 bool iesys_tpm_error(
     TSS2_RC r);
 
+TSS2_RC iesys_swap_in(
+    ESYS_CONTEXT *esys_context,
+    TPM2_CC command_code,
+    RSRC_NODE_T *node1,
+    RSRC_NODE_T *node2,
+    RSRC_NODE_T *node3);
+
+TSS2_RC iesys_swap_in_sessions(
+    ESYS_CONTEXT *esys_context);
+
+void iesys_swap_free(
+    ESYS_CONTEXT *esys_context);
+
+bool iesys_metadata_cache_get(
+    ESYS_CONTEXT *esys_context,
+    TPM2_HANDLE tpm_handle,
+    IESYS_RESOURCE *rsrc);
+
+TSS2_RC iesys_metadata_cache_put(
+    ESYS_CONTEXT *esys_context,
+    const IESYS_RESOURCE *rsrc);
+
+void iesys_metadata_cache_invalidate(
+    ESYS_CONTEXT *esys_context,
+    ESYS_TR esys_handle);
+
+void iesys_metadata_cache_free(
+    ESYS_CONTEXT *esys_context);
+
+void iesys_nv_bulk_free(
+    ESYS_CONTEXT *esys_context);
+
+const IESYS_CAPABILITY_RECORD *iesys_capability_cache_get(
+    ESYS_CONTEXT *esys_context,
+    TPM2_CAP capability,
+    UINT32 property,
+    UINT32 propertyCount);
+
+TSS2_RC iesys_capability_cache_put(
+    ESYS_CONTEXT *esys_context,
+    TPM2_CAP capability,
+    UINT32 property,
+    UINT32 propertyCount,
+    TPMI_YES_NO moreData,
+    const TPMS_CAPABILITY_DATA *data);
+
+void iesys_capability_cache_invalidate(
+    ESYS_CONTEXT *esys_context);
+
+TSS2_RC iesys_capability_get_property(
+    ESYS_CONTEXT *esys_context,
+    TPM2_PT property,
+    UINT32 *value);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
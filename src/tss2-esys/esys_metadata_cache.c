@@ -0,0 +1,715 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "tss2_esys.h"
+#include "tss2_mu.h"
+#include "esys_mu.h"
+
+#include "esys_iutil.h"
+#define LOGMODULE esys
+#include "util/log.h"
+#include "util/aux_util.h"
+#ifndef _WIN32
+#include "util/io.h"
+#endif
+
+/*
+ * The cache file holds the Esys_TR_Serialize records of persistent objects
+ * and NV indices, so that Esys_TR_FromTPMPublic does not need a round trip
+ * to the TPM. All integers are stored big endian:
+ *
+ *   UINT32 magic, UINT32 version, UINT32 count
+ *   count index entries { UINT32 handle, UINT32 offset, UINT32 size }
+ *     sorted by handle, offset relative to the start of the file
+ *   the records
+ *
+ * The file is mapped read-only and searched in place. It is rewritten as a
+ * whole by Esys_MetadataCache_Save.
+ */
+
+#define METADATA_CACHE_MAGIC 0x45534d43 /* 'ESMC' */
+#define METADATA_CACHE_VERSION 1
+#define METADATA_CACHE_HEADER_SIZE (3 * sizeof(UINT32))
+#define METADATA_CACHE_ENTRY_SIZE (3 * sizeof(UINT32))
+
+/** An index entry of the cache file. */
+typedef struct {
+    TPM2_HANDLE handle;
+    const uint8_t *buffer;
+    size_t size;
+    bool *verified;
+} metadata_entry;
+
+/** Check whether the metadata of a TPM handle can be cached.
+ *
+ * Only persistent objects and NV indices keep their handle across
+ * TPM resets.
+ * @param tpm_handle [in] The TPM handle.
+ * @retval true if the handle can be cached.
+ */
+static bool
+metadata_cacheable(TPM2_HANDLE tpm_handle)
+{
+    TPM2_HT type = iesys_get_handle_type(tpm_handle);
+
+    return type == TPM2_HT_PERSISTENT || type == TPM2_HT_NV_INDEX;
+}
+
+/** Read an index entry of the cache file.
+ *
+ * @param cache [in] The metadata cache.
+ * @param i [in] The number of the index entry (< map_count).
+ * @param entry [out] The index entry.
+ * @retval true if the entry lies within the file.
+ */
+static bool
+metadata_map_entry(IESYS_METADATA_CACHE *cache, UINT32 i,
+                   metadata_entry *entry)
+{
+    size_t offset = METADATA_CACHE_HEADER_SIZE + i * METADATA_CACHE_ENTRY_SIZE;
+    UINT32 record_offset, record_size;
+
+    Tss2_MU_UINT32_Unmarshal(cache->map, cache->map_size, &offset,
+                             &entry->handle);
+    Tss2_MU_UINT32_Unmarshal(cache->map, cache->map_size, &offset,
+                             &record_offset);
+    Tss2_MU_UINT32_Unmarshal(cache->map, cache->map_size, &offset,
+                             &record_size);
+    if (record_offset > cache->map_size ||
+        record_size > cache->map_size - record_offset)
+        return false;
+
+    entry->buffer = &cache->map[record_offset];
+    entry->size = record_size;
+    entry->verified = &cache->map_verified[i];
+    return true;
+}
+
+/** Search the record of a TPM handle added or removed since opening.
+ *
+ * @param cache [in] The metadata cache.
+ * @param tpm_handle [in] The TPM handle.
+ * @retval The record or NULL if there is none.
+ */
+static IESYS_METADATA_RECORD *
+metadata_record(IESYS_METADATA_CACHE *cache, TPM2_HANDLE tpm_handle)
+{
+    for (size_t i = 0; i < cache->records_count; i++) {
+        if (cache->records[i].handle == tpm_handle)
+            return &cache->records[i];
+    }
+    return NULL;
+}
+
+/** Search the serialized metadata of a TPM handle.
+ *
+ * @param cache [in] The metadata cache.
+ * @param tpm_handle [in] The TPM handle.
+ * @param entry [out] The serialized metadata.
+ * @retval true if the handle is cached.
+ */
+static bool
+metadata_find(IESYS_METADATA_CACHE *cache, TPM2_HANDLE tpm_handle,
+              metadata_entry *entry)
+{
+    IESYS_METADATA_RECORD *record = metadata_record(cache, tpm_handle);
+    UINT32 low = 0, high = cache->map_count;
+
+    if (record != NULL) {
+        entry->handle = tpm_handle;
+        entry->buffer = record->buffer;
+        entry->size = record->size;
+        entry->verified = &record->verified;
+        return record->buffer != NULL;
+    }
+
+    while (low < high) {
+        UINT32 mid = low + (high - low) / 2;
+
+        if (!metadata_map_entry(cache, mid, entry))
+            return false;
+        if (entry->handle == tpm_handle)
+            return true;
+        if (entry->handle < tpm_handle)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return false;
+}
+
+/** Replace the record of a TPM handle.
+ *
+ * @param cache [in,out] The metadata cache.
+ * @param tpm_handle [in] The TPM handle.
+ * @param buffer [in] The serialized metadata (taken over), or NULL to remove
+ *        the handle.
+ * @param size [in] The size of buffer.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_MEMORY if the record can not be allocated.
+ */
+static TSS2_RC
+metadata_set(IESYS_METADATA_CACHE *cache, TPM2_HANDLE tpm_handle,
+             uint8_t *buffer, size_t size)
+{
+    IESYS_METADATA_RECORD *record = metadata_record(cache, tpm_handle);
+
+    if (record == NULL) {
+        record = realloc(cache->records, (cache->records_count + 1) *
+                         sizeof(IESYS_METADATA_RECORD));
+        if (record == NULL) {
+            free(buffer);
+            return_error(TSS2_ESYS_RC_MEMORY, "Out of memory.");
+        }
+        cache->records = record;
+        record = &cache->records[cache->records_count++];
+        record->handle = tpm_handle;
+        record->buffer = NULL;
+    }
+
+    free(record->buffer);
+    record->buffer = buffer;
+    record->size = size;
+    record->verified = false;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Release the cache file and the records of a metadata cache.
+ *
+ * @param cache [in,out] The metadata cache.
+ */
+static void
+metadata_unload(IESYS_METADATA_CACHE *cache)
+{
+    if (cache->map != NULL) {
+#ifdef _WIN32
+        free(cache->map);
+#else
+        munmap(cache->map, cache->map_size);
+#endif
+        cache->map = NULL;
+    }
+    cache->map_size = 0;
+    cache->map_count = 0;
+    SAFE_FREE(cache->map_verified);
+
+    for (size_t i = 0; i < cache->records_count; i++)
+        free(cache->records[i].buffer);
+    SAFE_FREE(cache->records);
+    cache->records_count = 0;
+}
+
+/** Map the cache file.
+ *
+ * A missing file is treated as an empty cache, a malformed one is ignored.
+ * @param cache [in,out] The metadata cache without a mapped file.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_MEMORY if the file contents or the verification
+ *         flags can not be allocated.
+ * @retval TSS2_ESYS_RC_IO_ERROR if the file can not be read.
+ */
+static TSS2_RC
+metadata_load(IESYS_METADATA_CACHE *cache)
+{
+    size_t offset = 0;
+    UINT32 magic, version, count;
+
+#ifdef _WIN32
+    FILE *file = fopen(cache->path, "rb");
+    long size;
+
+    if (file == NULL)
+        return TSS2_RC_SUCCESS;
+    if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0 ||
+        fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file);
+        return_error(TSS2_ESYS_RC_IO_ERROR, "Reading metadata cache.");
+    }
+    cache->map = malloc(size + 1);
+    if (cache->map == NULL) {
+        fclose(file);
+        return_error(TSS2_ESYS_RC_MEMORY, "Out of memory.");
+    }
+    if (fread(cache->map, 1, size, file) != (size_t) size) {
+        fclose(file);
+        SAFE_FREE(cache->map);
+        return_error(TSS2_ESYS_RC_IO_ERROR, "Reading metadata cache.");
+    }
+    fclose(file);
+    cache->map_size = size;
+#else
+    struct stat st;
+    int fd = open(cache->path, O_RDONLY);
+
+    if (fd < 0)
+        return TSS2_RC_SUCCESS;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return_error(TSS2_ESYS_RC_IO_ERROR, "Reading metadata cache.");
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return TSS2_RC_SUCCESS;
+    }
+    cache->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (cache->map == MAP_FAILED) {
+        cache->map = NULL;
+        return_error(TSS2_ESYS_RC_IO_ERROR, "Mapping metadata cache.");
+    }
+    cache->map_size = st.st_size;
+#endif
+
+    if (Tss2_MU_UINT32_Unmarshal(cache->map, cache->map_size, &offset,
+                                 &magic) != TSS2_RC_SUCCESS ||
+        Tss2_MU_UINT32_Unmarshal(cache->map, cache->map_size, &offset,
+                                 &version) != TSS2_RC_SUCCESS ||
+        Tss2_MU_UINT32_Unmarshal(cache->map, cache->map_size, &offset,
+                                 &count) != TSS2_RC_SUCCESS ||
+        magic != METADATA_CACHE_MAGIC || version != METADATA_CACHE_VERSION ||
+        count > (cache->map_size - offset) / METADATA_CACHE_ENTRY_SIZE) {
+        LOG_WARNING("Ignoring malformed metadata cache %s", cache->path);
+        metadata_unload(cache);
+        return TSS2_RC_SUCCESS;
+    }
+    cache->map_verified = calloc(count + 1, sizeof(bool));
+    if (cache->map_verified == NULL) {
+        metadata_unload(cache);
+        return_error(TSS2_ESYS_RC_MEMORY, "Out of memory.");
+    }
+    cache->map_count = count;
+    return TSS2_RC_SUCCESS;
+}
+
+static int
+metadata_entry_cmp(const void *a, const void *b)
+{
+    const metadata_entry *ea = a, *eb = b;
+
+    return (ea->handle > eb->handle) - (ea->handle < eb->handle);
+}
+
+/** Write the contents of the cache file to a new temporary file.
+ *
+ * The file is created exclusively from tmp_path, whose trailing XXXXXX are
+ * replaced by a unique suffix, and its data is synced to disk before it is
+ * closed, so renaming it over the cache file never exposes a partial file.
+ * @param tmp_path [in,out] The template of the file name.
+ * @param buffer [in] The contents of the file.
+ * @param size [in] The size of buffer.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_IO_ERROR if the file can not be written. The file is
+ *         removed again if it was created.
+ */
+static TSS2_RC
+metadata_write_tmp(char *tmp_path, const uint8_t *buffer, size_t size)
+{
+    TSS2_RC r = TSS2_RC_SUCCESS;
+#ifdef _WIN32
+    FILE *file;
+
+    if (_mktemp_s(tmp_path, strlen(tmp_path) + 1) != 0 ||
+        (file = fopen(tmp_path, "wb")) == NULL) {
+        LOG_ERROR("Creating %s failed.", tmp_path);
+        return TSS2_ESYS_RC_IO_ERROR;
+    }
+    if (fwrite(buffer, 1, size, file) != size || fflush(file) != 0 ||
+        _commit(_fileno(file)) != 0)
+        r = TSS2_ESYS_RC_IO_ERROR;
+    if (fclose(file) != 0)
+        r = TSS2_ESYS_RC_IO_ERROR;
+#else
+    int fd = mkstemp(tmp_path);
+
+    if (fd < 0) {
+        LOG_ERROR("Creating %s failed.", tmp_path);
+        return TSS2_ESYS_RC_IO_ERROR;
+    }
+    if (write_all(fd, buffer, size) != (ssize_t) size || fsync(fd) != 0)
+        r = TSS2_ESYS_RC_IO_ERROR;
+    if (close(fd) != 0)
+        r = TSS2_ESYS_RC_IO_ERROR;
+#endif
+    if (r != TSS2_RC_SUCCESS) {
+        LOG_ERROR("Writing %s failed.", tmp_path);
+        remove(tmp_path);
+    }
+    return r;
+}
+
+/** Write the cache file.
+ *
+ * The file is written to a temporary file next to it first, which then
+ * replaces the file atomically.
+ * @param path [in] The path of the file.
+ * @param entries [in] The records sorted by handle.
+ * @param count [in] The number of entries.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_MEMORY if the file contents can not be allocated.
+ * @retval TSS2_ESYS_RC_IO_ERROR if the file can not be written.
+ */
+static TSS2_RC
+metadata_write(const char *path, const metadata_entry *entries, size_t count)
+{
+    TSS2_RC r;
+    size_t size = METADATA_CACHE_HEADER_SIZE + count * METADATA_CACHE_ENTRY_SIZE;
+    size_t data = size;
+    size_t offset = 0;
+    uint8_t *buffer;
+    char *tmp_path;
+
+    for (size_t i = 0; i < count; i++)
+        size += entries[i].size;
+    if (size > UINT32_MAX)
+        return_error(TSS2_ESYS_RC_BAD_SIZE, "Metadata cache too large.");
+
+    buffer = malloc(size);
+    return_if_null(buffer, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+
+    Tss2_MU_UINT32_Marshal(METADATA_CACHE_MAGIC, buffer, size, &offset);
+    Tss2_MU_UINT32_Marshal(METADATA_CACHE_VERSION, buffer, size, &offset);
+    Tss2_MU_UINT32_Marshal(count, buffer, size, &offset);
+    for (size_t i = 0; i < count; i++) {
+        Tss2_MU_UINT32_Marshal(entries[i].handle, buffer, size, &offset);
+        Tss2_MU_UINT32_Marshal(data, buffer, size, &offset);
+        Tss2_MU_UINT32_Marshal(entries[i].size, buffer, size, &offset);
+        memcpy(&buffer[data], entries[i].buffer, entries[i].size);
+        data += entries[i].size;
+    }
+
+    tmp_path = malloc(strlen(path) + sizeof(".XXXXXX"));
+    if (tmp_path == NULL) {
+        free(buffer);
+        return_error(TSS2_ESYS_RC_MEMORY, "Out of memory.");
+    }
+    sprintf(tmp_path, "%s.XXXXXX", path);
+
+    r = metadata_write_tmp(tmp_path, buffer, size);
+    free(buffer);
+    if (r == TSS2_RC_SUCCESS) {
+#ifdef _WIN32
+        remove(path);
+#endif
+        if (rename(tmp_path, path) != 0) {
+            LOG_ERROR("Replacing %s failed.", path);
+            remove(tmp_path);
+            r = TSS2_ESYS_RC_IO_ERROR;
+        }
+    }
+    free(tmp_path);
+    return r;
+}
+
+/** Get the cached metadata of a persistent object or NV index.
+ *
+ * The record is only used if it holds the requested handle and its name
+ * matches the name computed from its public area. The name is only computed
+ * the first time a record is served; the result is remembered until the
+ * record is replaced or the file is mapped again. An invalid record is
+ * dropped from the cache, so the metadata is read from the TPM and cached
+ * again.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param tpm_handle [in] The TPM handle.
+ * @param rsrc [out] The metadata.
+ * @retval true if the metadata was found in the cache.
+ */
+bool
+iesys_metadata_cache_get(ESYS_CONTEXT *esys_context, TPM2_HANDLE tpm_handle,
+                         IESYS_RESOURCE *rsrc)
+{
+    IESYS_METADATA_CACHE *cache = esys_context->metadata_cache;
+    metadata_entry entry;
+    TPM2B_NAME name;
+    size_t offset = 0;
+    TSS2_RC r;
+
+    if (cache == NULL || !metadata_cacheable(tpm_handle) ||
+        !metadata_find(cache, tpm_handle, &entry))
+        return false;
+
+    r = iesys_MU_IESYS_RESOURCE_Unmarshal(entry.buffer, entry.size, &offset,
+                                          rsrc);
+    if (r != TSS2_RC_SUCCESS || rsrc->handle != tpm_handle)
+        goto invalid;
+
+    if (rsrc->rsrcType != IESYSC_KEY_RSRC &&
+        (rsrc->rsrcType != IESYSC_NV_RSRC ||
+         rsrc->misc.rsrc_nv_pub.nvPublic.nvIndex != tpm_handle))
+        goto invalid;
+    if (*entry.verified)
+        return true;
+
+    if (rsrc->rsrcType == IESYSC_KEY_RSRC)
+        r = iesys_get_name(&rsrc->misc.rsrc_key_pub, &name);
+    else
+        r = iesys_nv_get_name(&rsrc->misc.rsrc_nv_pub, &name);
+    if (r != TSS2_RC_SUCCESS || !cmp_TPM2B_NAME(&name, &rsrc->name))
+        goto invalid;
+
+    *entry.verified = true;
+    return true;
+
+invalid:
+    LOG_WARNING("Dropping invalid metadata cache record of 0x%08"PRIx32,
+                tpm_handle);
+    if (metadata_set(cache, tpm_handle, NULL, 0) != TSS2_RC_SUCCESS)
+        LOG_WARNING("Metadata cache record of 0x%08"PRIx32" not removed",
+                    tpm_handle);
+    return false;
+}
+
+/** Store the metadata of a persistent object or NV index in the cache.
+ *
+ * Metadata of other handles is ignored.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param rsrc [in] The metadata.
+ * @retval TSS2_RC_SUCCESS on success or if no cache is open.
+ * @retval TSS2_ESYS_RC_MEMORY if the record can not be allocated.
+ * @retval TSS2_RCs produced by iesys_MU_IESYS_RESOURCE_Size and
+ *         iesys_MU_IESYS_RESOURCE_Marshal.
+ */
+TSS2_RC
+iesys_metadata_cache_put(ESYS_CONTEXT *esys_context,
+                         const IESYS_RESOURCE *rsrc)
+{
+    IESYS_METADATA_CACHE *cache = esys_context->metadata_cache;
+    uint8_t *buffer;
+    size_t size = 0, offset = 0;
+    TSS2_RC r;
+
+    if (cache == NULL || !metadata_cacheable(rsrc->handle) ||
+        (rsrc->rsrcType != IESYSC_KEY_RSRC && rsrc->rsrcType != IESYSC_NV_RSRC))
+        return TSS2_RC_SUCCESS;
+
+    r = iesys_MU_IESYS_RESOURCE_Size(rsrc, &size);
+    return_if_error(r, "Size of resource object");
+
+    buffer = malloc(size);
+    return_if_null(buffer, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+
+    r = iesys_MU_IESYS_RESOURCE_Marshal(rsrc, buffer, size, &offset);
+    if (r != TSS2_RC_SUCCESS) {
+        free(buffer);
+        return_error(r, "Marshal resource object");
+    }
+
+    return metadata_set(cache, rsrc->handle, buffer, size);
+}
+
+/** Remove the metadata of an ESYS_TR's TPM handle from the cache.
+ *
+ * Called when a persistent object is evicted or an NV index is undefined.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param esys_handle [in] The ESYS_TR of the object.
+ */
+void
+iesys_metadata_cache_invalidate(ESYS_CONTEXT *esys_context,
+                                ESYS_TR esys_handle)
+{
+    RSRC_NODE_T *node;
+
+    if (esys_context->metadata_cache == NULL ||
+        esys_GetResourceObject(esys_context, esys_handle, &node)
+            != TSS2_RC_SUCCESS || node == NULL)
+        return;
+
+    if (Esys_MetadataCache_Remove(esys_context, node->rsrc.handle)
+            != TSS2_RC_SUCCESS)
+        LOG_WARNING("Metadata cache record of 0x%08"PRIx32" not removed",
+                    node->rsrc.handle);
+}
+
+/** Release the metadata cache of an ESYS_CONTEXT.
+ *
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ */
+void
+iesys_metadata_cache_free(ESYS_CONTEXT *esys_context)
+{
+    IESYS_METADATA_CACHE *cache = esys_context->metadata_cache;
+
+    if (cache == NULL)
+        return;
+
+    metadata_unload(cache);
+    free(cache->path);
+    SAFE_FREE(esys_context->metadata_cache);
+}
+
+/** Open the metadata cache of an ESYS_CONTEXT.
+ *
+ * Esys_TR_FromTPMPublic called without sessions creates the ESYS_TR of a
+ * persistent object or NV index from the cache if the handle is cached, so no
+ * command is sent to the TPM. Otherwise, and whenever a session is passed,
+ * the metadata is read from the TPM and added to the cache.
+ *
+ * A cached name is checked against the cached public area the first time
+ * it is served. Whether the handle still refers to the cached entity is only
+ * verified by the TPM when the ESYS_TR is used in a command with an HMAC or
+ * policy session, since the name is part of the command parameter hash; a
+ * stale record then fails the command's authorization. Password sessions do
+ * not bind the name, so a stale record goes unnoticed there. Callers that
+ * authorize with passwords and may see the TPM changed behind the cache
+ * should pass a session to Esys_TR_FromTPMPublic, which reads the public area
+ * from the TPM instead.
+ * @param esysContext [in,out] The ESYS_CONTEXT.
+ * @param path [in] The path of the cache file. A missing file is created by
+ *        Esys_MetadataCache_Save.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or path is NULL.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if a cache is already open.
+ * @retval TSS2_ESYS_RC_MEMORY if the cache can not be allocated.
+ * @retval TSS2_ESYS_RC_IO_ERROR if the file can not be read.
+ */
+TSS2_RC
+Esys_MetadataCache_Open(ESYS_CONTEXT *esysContext, const char *path)
+{
+    TSS2_RC r;
+    IESYS_METADATA_CACHE *cache;
+
+    _ESYS_ASSERT_NON_NULL(esysContext);
+    _ESYS_ASSERT_NON_NULL(path);
+
+    if (esysContext->metadata_cache != NULL)
+        return_error(TSS2_ESYS_RC_BAD_SEQUENCE, "Metadata cache already open.");
+
+    cache = calloc(1, sizeof(IESYS_METADATA_CACHE));
+    return_if_null(cache, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+    cache->hit = ESYS_TR_NONE;
+    cache->path = strdup(path);
+    if (cache->path == NULL) {
+        free(cache);
+        return_error(TSS2_ESYS_RC_MEMORY, "Out of memory.");
+    }
+
+    r = metadata_load(cache);
+    if (r != TSS2_RC_SUCCESS) {
+        free(cache->path);
+        free(cache);
+        return_error(r, "Loading metadata cache");
+    }
+
+    esysContext->metadata_cache = cache;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Remove a TPM handle from the metadata cache.
+ *
+ * Needed if a persistent object or NV index is removed or changed outside of
+ * this ESYS_CONTEXT.
+ * @param esysContext [in,out] The ESYS_CONTEXT.
+ * @param tpmHandle [in] The TPM handle.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext is NULL.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if no cache is open.
+ * @retval TSS2_ESYS_RC_MEMORY if the record can not be allocated.
+ */
+TSS2_RC
+Esys_MetadataCache_Remove(ESYS_CONTEXT *esysContext, TPM2_HANDLE tpmHandle)
+{
+    metadata_entry entry;
+
+    _ESYS_ASSERT_NON_NULL(esysContext);
+
+    if (esysContext->metadata_cache == NULL)
+        return_error(TSS2_ESYS_RC_BAD_SEQUENCE, "No metadata cache open.");
+
+    if (!metadata_find(esysContext->metadata_cache, tpmHandle, &entry))
+        return TSS2_RC_SUCCESS;
+
+    return metadata_set(esysContext->metadata_cache, tpmHandle, NULL, 0);
+}
+
+/** Write the metadata cache back to its file.
+ *
+ * The cached metadata is refreshed from the ESYS_TR objects of the
+ * ESYS_CONTEXT first, so that changes like the TPMA_NV_WRITTEN attribute set
+ * by Esys_NV_Write are picked up. The file is replaced atomically and mapped
+ * again.
+ * @param esysContext [in,out] The ESYS_CONTEXT.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext is NULL.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if no cache is open.
+ * @retval TSS2_ESYS_RC_MEMORY if memory can not be allocated.
+ * @retval TSS2_ESYS_RC_IO_ERROR if the file can not be written.
+ */
+TSS2_RC
+Esys_MetadataCache_Save(ESYS_CONTEXT *esysContext)
+{
+    TSS2_RC r;
+    IESYS_METADATA_CACHE *cache;
+    metadata_entry *entries;
+    size_t count = 0;
+    RSRC_NODE_T *node;
+
+    _ESYS_ASSERT_NON_NULL(esysContext);
+
+    cache = esysContext->metadata_cache;
+    if (cache == NULL)
+        return_error(TSS2_ESYS_RC_BAD_SEQUENCE, "No metadata cache open.");
+
+    for (node = esysContext->rsrc_list; node != NULL; node = node->next) {
+        metadata_entry entry;
+
+        if (!metadata_find(cache, node->rsrc.handle, &entry))
+            continue;
+        r = iesys_metadata_cache_put(esysContext, &node->rsrc);
+        return_if_error(r, "Store metadata");
+    }
+
+    entries = calloc(cache->map_count + cache->records_count + 1,
+                     sizeof(metadata_entry));
+    return_if_null(entries, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+
+    for (UINT32 i = 0; i < cache->map_count; i++) {
+        if (metadata_map_entry(cache, i, &entries[count]) &&
+            metadata_record(cache, entries[count].handle) == NULL)
+            count++;
+    }
+    for (size_t i = 0; i < cache->records_count; i++) {
+        if (cache->records[i].buffer == NULL)
+            continue;
+        entries[count].handle = cache->records[i].handle;
+        entries[count].buffer = cache->records[i].buffer;
+        entries[count].size = cache->records[i].size;
+        count++;
+    }
+    qsort(entries, count, sizeof(metadata_entry), metadata_entry_cmp);
+
+    r = metadata_write(cache->path, entries, count);
+    free(entries);
+    return_if_error(r, "Writing metadata cache");
+
+    metadata_unload(cache);
+    return metadata_load(cache);
+}
+
+/** Close the metadata cache without saving it.
+ *
+ * @param esysContext [in,out] The ESYS_CONTEXT.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext is NULL.
+ */
+TSS2_RC
+Esys_MetadataCache_Close(ESYS_CONTEXT *esysContext)
+{
+    _ESYS_ASSERT_NON_NULL(esysContext);
+
+    iesys_metadata_cache_free(esysContext);
+    return TSS2_RC_SUCCESS;
+}
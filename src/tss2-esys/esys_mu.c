@@ -570,6 +570,68 @@ iesys_MU_IESYS_SESSION_Unmarshal(
     return TSS2_RC_SUCCESS;
 }
 
+/** Compute the size of a marshaled IESYS_SESSION structure.
+ *
+ * @param[in] src variable to be sized.
+ * @param[out] size the number of bytes iesys_MU_IESYS_SESSION_Marshal writes.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_SYS_RC_BAD_REFERENCE if src==NULL.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if size==NULL.
+ */
+TSS2_RC
+iesys_MU_IESYS_SESSION_Size(
+    const IESYS_SESSION *src,
+    size_t *size)
+{
+    LOG_TRACE("called: src=%p size=%p", src, size);
+    if (src == NULL) {
+        LOG_ERROR("src=NULL");
+        return TSS2_SYS_RC_BAD_REFERENCE;
+    }
+    return_if_null(size, "size=NULL", TSS2_ESYS_RC_BAD_REFERENCE);
+    TSS2_RC ret;
+    size_t size_loc = 0, field;
+    ret = Tss2_MU_TPM2B_NAME_Size(&src->bound_entity, &field);
+    return_if_error(ret, "Error sizing subfield bound_entity");
+    size_loc += field;
+
+    ret = Tss2_MU_TPM2B_ENCRYPTED_SECRET_Size(&src->encryptedSalt, &field);
+    return_if_error(ret, "Error sizing subfield encryptedSalt");
+    size_loc += field;
+
+    ret = Tss2_MU_TPM2B_DATA_Size(&src->salt, &field);
+    return_if_error(ret, "Error sizing subfield salt");
+    size_loc += field;
+
+    ret = Tss2_MU_TPMT_SYM_DEF_Size(&src->symmetric, &field);
+    return_if_error(ret, "Error sizing subfield symmetric");
+    size_loc += field;
+
+    size_loc += sizeof(TPMI_ALG_HASH);
+
+    ret = Tss2_MU_TPM2B_DIGEST_Size(&src->sessionKey, &field);
+    return_if_error(ret, "Error sizing subfield sessionKey");
+    size_loc += field;
+
+    size_loc += sizeof(TPM2_SE) + sizeof(TPMA_SESSION);
+
+    ret = Tss2_MU_TPM2B_NONCE_Size(&src->nonceCaller, &field);
+    return_if_error(ret, "Error sizing subfield nonceCaller");
+    size_loc += field;
+
+    ret = Tss2_MU_TPM2B_NONCE_Size(&src->nonceTPM, &field);
+    return_if_error(ret, "Error sizing subfield nonceTPM");
+    size_loc += field;
+
+    /* encrypt, decrypt and type_policy_session are marshaled as UINT32. */
+    size_loc += 3 * sizeof(UINT32);
+    size_loc += sizeof(UINT16) + src->sizeSessionValue;
+    size_loc += sizeof(UINT16);
+
+    *size = size_loc;
+    return TSS2_RC_SUCCESS;
+}
+
 /** Marshal a IESYSC_RESOURCE_TYPE type into a byte buffer.
  *
  * @param[in] src constant to be marshaled.
@@ -737,6 +799,43 @@ iesys_MU_IESYS_RSRC_UNION_Unmarshal(
     };
 }
 
+/** Compute the size of a marshaled IESYS_RSRC_UNION union.
+ *
+ * @param[in] src variable to be sized.
+ * @param[in] selector the selector value.
+ * @param[out] size the number of bytes iesys_MU_IESYS_RSRC_UNION_Marshal
+ *             writes.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if src==NULL or size==NULL.
+ * @retval TSS2_SYS_RC_BAD_VALUE for an unknown selector.
+ */
+TSS2_RC
+iesys_MU_IESYS_RSRC_UNION_Size(
+    const IESYS_RSRC_UNION *src,
+    UINT32 selector,
+    size_t *size)
+{
+    LOG_TRACE("called: src=%p size=%p", src, size);
+    if (src == NULL) {
+        LOG_ERROR("src=NULL");
+        return TSS2_ESYS_RC_BAD_REFERENCE;
+    }
+
+    switch (selector) {
+    case IESYSC_KEY_RSRC:
+        return Tss2_MU_TPM2B_PUBLIC_Size(&src->rsrc_key_pub, size);
+    case IESYSC_NV_RSRC:
+        return Tss2_MU_TPM2B_NV_PUBLIC_Size(&src->rsrc_nv_pub, size);
+    case IESYSC_SESSION_RSRC:
+        return iesys_MU_IESYS_SESSION_Size(&src->rsrc_session, size);
+    case IESYSC_WITHOUT_MISC_RSRC:
+        return Tss2_MU_TPMS_EMPTY_Size(&src->rsrc_empty, size);
+    default:
+        LOG_ERROR("Selector value %"PRIu32 " not found", selector);
+        return TSS2_SYS_RC_BAD_VALUE;
+    };
+}
+
 /** Marshal a IESYS_RESOURCE structure into a byte buffer.
  *
  * @param[in] src variable to be marshaled.
@@ -833,6 +932,41 @@ iesys_MU_IESYS_RESOURCE_Unmarshal(
     return TSS2_RC_SUCCESS;
 }
 
+/** Compute the size of a marshaled IESYS_RESOURCE structure.
+ *
+ * @param[in] src variable to be sized.
+ * @param[out] size the number of bytes iesys_MU_IESYS_RESOURCE_Marshal writes.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_SYS_RC_BAD_REFERENCE if src==NULL.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if size==NULL.
+ */
+TSS2_RC
+iesys_MU_IESYS_RESOURCE_Size(
+    const IESYS_RESOURCE *src,
+    size_t *size)
+{
+    LOG_TRACE("called: src=%p size=%p", src, size);
+    if (src == NULL) {
+        LOG_ERROR("src=NULL");
+        return TSS2_SYS_RC_BAD_REFERENCE;
+    }
+    return_if_null(size, "size=NULL", TSS2_ESYS_RC_BAD_REFERENCE);
+    TSS2_RC ret;
+    size_t size_loc = sizeof(TPM2_HANDLE), field;
+    ret = Tss2_MU_TPM2B_NAME_Size(&src->name, &field);
+    return_if_error(ret, "Error sizing subfield name");
+    size_loc += field;
+
+    size_loc += sizeof(IESYSC_RESOURCE_TYPE);
+
+    ret = iesys_MU_IESYS_RSRC_UNION_Size(&src->misc, src->rsrcType, &field);
+    return_if_error(ret, "Error sizing subfield misc");
+    size_loc += field;
+
+    *size = size_loc;
+    return TSS2_RC_SUCCESS;
+}
+
 /** Marshal a IESYS_METADATA structure into a byte buffer.
  *
  * @param[in] src variable to be marshaled.
@@ -913,6 +1047,34 @@ iesys_MU_IESYS_METADATA_Unmarshal(
     return TSS2_RC_SUCCESS;
 }
 
+/** Compute the size of a marshaled IESYS_METADATA structure.
+ *
+ * @param[in] src variable to be sized.
+ * @param[out] size the number of bytes iesys_MU_IESYS_METADATA_Marshal writes.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_SYS_RC_BAD_REFERENCE if src==NULL.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if size==NULL.
+ */
+TSS2_RC
+iesys_MU_IESYS_METADATA_Size(
+    const IESYS_METADATA *src,
+    size_t *size)
+{
+    LOG_TRACE("called: src=%p size=%p", src, size);
+    if (src == NULL) {
+        LOG_ERROR("src=NULL");
+        return TSS2_SYS_RC_BAD_REFERENCE;
+    }
+    return_if_null(size, "size=NULL", TSS2_ESYS_RC_BAD_REFERENCE);
+    TSS2_RC ret;
+    size_t field;
+    ret = iesys_MU_IESYS_RESOURCE_Size(&src->data, &field);
+    return_if_error(ret, "Error sizing subfield data");
+
+    *size = sizeof(UINT16) + field;
+    return TSS2_RC_SUCCESS;
+}
+
 /** Marshal a IESYS_CONTEXT_DATA structure into a byte buffer.
  *
  * @param[in] src variable to be marshaled.
@@ -999,3 +1161,37 @@ iesys_MU_IESYS_CONTEXT_DATA_Unmarshal(
         *offset = offset_loc;
     return TSS2_RC_SUCCESS;
 }
+
+/** Compute the size of a marshaled IESYS_CONTEXT_DATA structure.
+ *
+ * @param[in] src variable to be sized.
+ * @param[out] size the number of bytes iesys_MU_IESYS_CONTEXT_DATA_Marshal
+ *             writes.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_SYS_RC_BAD_REFERENCE if src==NULL.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if size==NULL.
+ */
+TSS2_RC
+iesys_MU_IESYS_CONTEXT_DATA_Size(
+    const IESYS_CONTEXT_DATA *src,
+    size_t *size)
+{
+    LOG_TRACE("called: src=%p size=%p", src, size);
+    if (src == NULL) {
+        LOG_ERROR("src=NULL");
+        return TSS2_SYS_RC_BAD_REFERENCE;
+    }
+    return_if_null(size, "size=NULL", TSS2_ESYS_RC_BAD_REFERENCE);
+    TSS2_RC ret;
+    size_t size_loc = sizeof(UINT32), field;
+    ret = Tss2_MU_TPM2B_CONTEXT_DATA_Size(&src->tpmContext, &field);
+    return_if_error(ret, "Error sizing subfield tpmContext");
+    size_loc += field;
+
+    ret = iesys_MU_IESYS_METADATA_Size(&src->esysMetadata, &field);
+    return_if_error(ret, "Error sizing subfield esysMetadata");
+    size_loc += field;
+
+    *size = size_loc;
+    return TSS2_RC_SUCCESS;
+}
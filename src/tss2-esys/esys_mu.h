@@ -89,6 +89,11 @@ iesys_MU_IESYS_SESSION_Unmarshal(const uint8_t *buffer,
     size_t *offset,
     IESYS_SESSION *out);
 
+TSS2_RC
+iesys_MU_IESYS_SESSION_Size(
+    const IESYS_SESSION *in,
+    size_t *size);
+
 
 TSS2_RC
 iesys_MU_IESYSC_RESOURCE_TYPE_Marshal(
@@ -124,6 +129,12 @@ iesys_MU_IESYS_RSRC_UNION_Unmarshal(
     UINT32 selector,
     IESYS_RSRC_UNION *out);
 
+TSS2_RC
+iesys_MU_IESYS_RSRC_UNION_Size(
+    const IESYS_RSRC_UNION *in,
+    UINT32 selector,
+    size_t *size);
+
 
 TSS2_RC
 iesys_MU_IESYS_RESOURCE_Marshal(
@@ -138,6 +149,11 @@ iesys_MU_IESYS_RESOURCE_Unmarshal(const uint8_t *buffer,
     size_t *offset,
     IESYS_RESOURCE *out);
 
+TSS2_RC
+iesys_MU_IESYS_RESOURCE_Size(
+    const IESYS_RESOURCE *in,
+    size_t *size);
+
 
 TSS2_RC
 iesys_MU_IESYS_METADATA_Marshal(
@@ -152,6 +168,11 @@ iesys_MU_IESYS_METADATA_Unmarshal(const uint8_t *buffer,
     size_t *offset,
     IESYS_METADATA *out);
 
+TSS2_RC
+iesys_MU_IESYS_METADATA_Size(
+    const IESYS_METADATA *in,
+    size_t *size);
+
 
 TSS2_RC
 iesys_MU_IESYS_CONTEXT_DATA_Marshal(
@@ -166,6 +187,11 @@ iesys_MU_IESYS_CONTEXT_DATA_Unmarshal(const uint8_t *buffer,
     size_t *offset,
     IESYS_CONTEXT_DATA *out);
 
+TSS2_RC
+iesys_MU_IESYS_CONTEXT_DATA_Size(
+    const IESYS_CONTEXT_DATA *in,
+    size_t *size);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,475 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tss2_esys.h"
+
+#include "esys_iutil.h"
+#define LOGMODULE esys
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/** Get the number of bytes the TPM accepts per NV command.
+ *
+ * TPM2_PT_NV_BUFFER_MAX is a fixed property, so it is answered from the
+ * capability cache while that is enabled.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param chunk_size [out] TPM2_PT_NV_BUFFER_MAX, at most the size of a
+ *        TPM2B_MAX_NV_BUFFER.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE if the TPM does not report the
+ *         property.
+ * @retval TSS2_RCs produced by Esys_GetCapability.
+ */
+static TSS2_RC
+nv_bulk_chunk_size(ESYS_CONTEXT *esys_context, UINT16 *chunk_size)
+{
+    TSS2_RC r;
+    UINT32 buffer_max;
+
+    r = iesys_capability_get_property(esys_context, TPM2_PT_NV_BUFFER_MAX,
+                                      &buffer_max);
+    return_if_error(r, "Get TPM NV buffer size");
+
+    if (buffer_max == 0) {
+        LOG_ERROR("TPM does not report its NV buffer size.");
+        return TSS2_ESYS_RC_GENERAL_FAILURE;
+    }
+    if (buffer_max > sizeof(((TPM2B_MAX_NV_BUFFER *)0)->buffer))
+        buffer_max = sizeof(((TPM2B_MAX_NV_BUFFER *)0)->buffer);
+
+    *chunk_size = buffer_max;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Check whether the sessions of a bulk command allow batching.
+ *
+ * Only a single password authorization has an auth area that does not
+ * depend on the previous response.
+ */
+static bool
+nv_bulk_is_batchable(ESYS_TR shandle1, ESYS_TR shandle2, ESYS_TR shandle3)
+{
+    return shandle1 == ESYS_TR_PASSWORD && shandle2 == ESYS_TR_NONE &&
+        shandle3 == ESYS_TR_NONE;
+}
+
+/** Check whether a TPM response code asks for a resubmission.
+ *
+ * These are handled by the ESYS path of the bulk commands.
+ */
+static bool
+nv_bulk_is_retry(TSS2_RC r)
+{
+    return r == TPM2_RC_RETRY || r == TPM2_RC_TESTING || r == TPM2_RC_YIELDED;
+}
+
+/** Allocate the SYS contexts for batched chunks.
+ *
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_MEMORY if a SYS context can not be allocated.
+ * @retval TSS2_RCs produced by Tss2_Sys_Initialize.
+ */
+static TSS2_RC
+nv_bulk_init_sys(ESYS_CONTEXT *esys_context)
+{
+    TSS2_RC r;
+    TSS2_TCTI_CONTEXT *tcti;
+    size_t syssize = Tss2_Sys_GetContextSize(0);
+    TSS2_SYS_CONTEXT **sys = &esys_context->nv_bulk.sys[0];
+
+    if (sys[0] != NULL)
+        return TSS2_RC_SUCCESS;
+
+    r = Tss2_Sys_GetTctiContext(esys_context->sys, &tcti);
+    return_if_error(r, "Get TCTI context");
+
+    for (size_t i = 0; i < IESYS_NV_BULK_BATCH; i++) {
+        sys[i] = calloc(1, syssize);
+        goto_if_null(sys[i], "Out of memory.", TSS2_ESYS_RC_MEMORY,
+                     error_cleanup);
+
+        r = Tss2_Sys_Initialize(sys[i], syssize, tcti, NULL);
+        if (r != TSS2_RC_SUCCESS) {
+            SAFE_FREE(sys[i]);
+            LOG_ERROR("During syscontext initialization");
+            goto error_cleanup;
+        }
+    }
+    return TSS2_RC_SUCCESS;
+
+error_cleanup:
+    iesys_nv_bulk_free(esys_context);
+    return r;
+}
+
+/** Run up to IESYS_NV_BULK_BATCH password-authorized chunks back-to-back.
+ *
+ * All commands are prepared before the first one is sent. Read data is
+ * copied from the responses to data.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param command_code [in] TPM2_CC_NV_Read or TPM2_CC_NV_Write.
+ * @param authNode [in] The authorization object, or NULL.
+ * @param nvNode [in] The NV index.
+ * @param chunk_size [in] The bytes per command.
+ * @param data [in,out] The caller's buffer, starting at the next chunk.
+ * @param size [in] The bytes left.
+ * @param offset [in] The NV offset of the next chunk.
+ * @param done [out] The bytes transferred.
+ * @retval TSS2_RC_SUCCESS if all commands succeeded, or if the TPM asked for
+ *         a resubmission of the command at done.
+ * @retval TSS2_RCs produced by the TPM or the SYS layer. On errors below
+ *         the TPM, the SYS contexts are released.
+ */
+static TSS2_RC
+nv_bulk_batch(ESYS_CONTEXT *esys_context, TPM2_CC command_code,
+              RSRC_NODE_T *authNode, RSRC_NODE_T *nvNode, UINT16 chunk_size,
+              uint8_t *data, UINT16 size, UINT16 offset, UINT16 *done)
+{
+    TSS2_RC r;
+    TSS2_SYS_CONTEXT **sys = &esys_context->nv_bulk.sys[0];
+    TPM2_HANDLE authHandle = (authNode == NULL) ? TPM2_RH_NULL
+                                                : authNode->rsrc.handle;
+    TSS2L_SYS_AUTH_COMMAND auths = {
+        .count = 1,
+        .auths = { { .sessionHandle = TPM2_RS_PW } },
+    };
+    TPM2B_MAX_NV_BUFFER chunk;
+    size_t count, executed, i;
+    UINT16 pos = 0;
+
+    *done = 0;
+    if (authNode != NULL)
+        auths.auths[0].hmac = authNode->auth;
+
+    for (count = 0; count < IESYS_NV_BULK_BATCH && pos < size; count++) {
+        chunk.size = (size - pos < chunk_size) ? size - pos : chunk_size;
+        /* Write the password auth in place instead of moving the chunk */
+        r = Tss2_Sys_ReserveCmdAuths(sys[count], &auths);
+        return_if_error(r, "Reserve command auths");
+        if (command_code == TPM2_CC_NV_Read) {
+            r = Tss2_Sys_NV_Read_Prepare(sys[count], authHandle,
+                                         nvNode->rsrc.handle, chunk.size,
+                                         offset + pos);
+        } else {
+            memcpy(&chunk.buffer[0], &data[pos], chunk.size);
+            r = Tss2_Sys_NV_Write_Prepare(sys[count], authHandle,
+                                          nvNode->rsrc.handle, &chunk,
+                                          offset + pos);
+        }
+        return_if_error(r, "Prepare NV command");
+
+        r = Tss2_Sys_SetCmdAuths(sys[count], &auths);
+        return_if_error(r, "Set command auths");
+        pos += chunk.size;
+    }
+
+    r = Tss2_Sys_ExecuteBatch(sys, count, &executed);
+    if (r != TSS2_RC_SUCCESS && !iesys_tpm_error(r)) {
+        /* The contexts may be stuck in a transmit or receive stage */
+        iesys_nv_bulk_free(esys_context);
+        return_error(r, "Error executing NV batch");
+    }
+
+    for (i = 0; i < executed; i++) {
+        if (command_code == TPM2_CC_NV_Read) {
+            UINT16 expected = (size - *done < chunk_size) ? size - *done
+                                                           : chunk_size;
+            TSS2_RC r2 = Tss2_Sys_NV_Read_Complete(sys[i], &chunk);
+            return_if_error(r2, "Received error from SAPI unmarshaling");
+            if (chunk.size != expected) {
+                LOG_ERROR("TPM returned %" PRIu16 " instead of %" PRIu16
+                          " NV bytes.", chunk.size, expected);
+                return TSS2_ESYS_RC_MALFORMED_RESPONSE;
+            }
+            memcpy(&data[*done], &chunk.buffer[0], chunk.size);
+            *done += chunk.size;
+        } else {
+            *done += (size - *done < chunk_size) ? size - *done : chunk_size;
+        }
+    }
+
+    if (r != TSS2_RC_SUCCESS && nv_bulk_is_retry(r)) {
+        LOG_DEBUG("TPM returned RETRY, TESTING or YIELDED, which triggers a "
+                  "resubmission: %" PRIx32, r);
+        return TSS2_RC_SUCCESS;
+    }
+    return_if_error(r, "Error executing NV batch");
+    return TSS2_RC_SUCCESS;
+}
+
+/** Read one chunk through ESYS into the caller's buffer.
+ *
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_MALFORMED_RESPONSE if the TPM returned fewer bytes.
+ * @retval TSS2_RCs produced by Esys_NV_Read_Async or _FinishInto.
+ */
+static TSS2_RC
+nv_bulk_read_chunk(ESYS_CONTEXT *esysContext, ESYS_TR authHandle,
+                   ESYS_TR nvIndex, ESYS_TR shandle1, ESYS_TR shandle2,
+                   ESYS_TR shandle3, UINT16 size, UINT16 offset, uint8_t *data)
+{
+    TSS2_RC r;
+    TPM2B_MAX_NV_BUFFER chunk;
+    int32_t timeouttmp;
+
+    r = Esys_NV_Read_Async(esysContext, authHandle, nvIndex, shandle1,
+                           shandle2, shandle3, size, offset);
+    return_if_error(r, "Error in async function");
+
+    timeouttmp = esysContext->timeout;
+    esysContext->timeout = -1;
+    do {
+        r = Esys_NV_Read_FinishInto(esysContext, &chunk);
+    } while ((r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN);
+    esysContext->timeout = timeouttmp;
+    return_if_error(r, "Esys Finish");
+
+    if (chunk.size != size) {
+        LOG_ERROR("TPM returned %" PRIu16 " instead of %" PRIu16
+                  " NV bytes.", chunk.size, size);
+        return TSS2_ESYS_RC_MALFORMED_RESPONSE;
+    }
+    memcpy(data, &chunk.buffer[0], size);
+    return TSS2_RC_SUCCESS;
+}
+
+/** Look up the ESYS_TR objects of a bulk command.
+ *
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if a command is outstanding.
+ * @retval TSS2_ESYS_RC_BAD_TR if an ESYS_TR is unknown.
+ */
+static TSS2_RC
+nv_bulk_get_nodes(ESYS_CONTEXT *esysContext, ESYS_TR authHandle,
+                  ESYS_TR nvIndex, RSRC_NODE_T **authNode,
+                  RSRC_NODE_T **nvNode)
+{
+    TSS2_RC r;
+
+    if (esysContext->state != _ESYS_STATE_INIT) {
+        LOG_ERROR("Esys called in bad sequence.");
+        return TSS2_ESYS_RC_BAD_SEQUENCE;
+    }
+
+    r = esys_GetResourceObject(esysContext, authHandle, authNode);
+    return_if_error(r, "authHandle unknown");
+    r = esys_GetResourceObject(esysContext, nvIndex, nvNode);
+    return_if_error(r, "nvIndex unknown");
+    if (*nvNode == NULL) {
+        LOG_ERROR("nvIndex is ESYS_TR_NONE.");
+        return TSS2_ESYS_RC_BAD_TR;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/** Read an NV index of any size into a caller-provided buffer.
+ *
+ * The data is read in chunks of the TPM's TPM2_PT_NV_BUFFER_MAX, which is
+ * queried on each call unless the capability cache is enabled. If the only
+ * session is ESYS_TR_PASSWORD, the commands for several chunks are prepared
+ * ahead and sent back-to-back. Otherwise each chunk is read with Esys_NV_Read, so that HMAC and encrypt
+ * sessions are handled as usual.
+ * @param esysContext [in,out] The ESYS_CONTEXT.
+ * @param authHandle [in] The handle indicating the source of the
+ *        authorization value.
+ * @param nvIndex [in] The NV Index to be read.
+ * @param shandle1 [in] Session handle for authorization of authHandle.
+ * @param shandle2 [in] Second session handle.
+ * @param shandle3 [in] Third session handle.
+ * @param size [in] Number of octets to read.
+ * @param offset [in] Octet offset into the area.
+ * @param data [out] The data read (caller-allocated, size bytes).
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or data is NULL.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if a command is outstanding.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if offset + size exceeds 64 KiB.
+ * @retval TSS2_ESYS_RC_MEMORY if the SYS contexts can not be allocated.
+ * @retval TSS2_RCs produced by Esys_GetCapability, Esys_NV_Read or the TPM.
+ */
+TSS2_RC
+Esys_NV_ReadBulk(
+    ESYS_CONTEXT *esysContext,
+    ESYS_TR authHandle,
+    ESYS_TR nvIndex,
+    ESYS_TR shandle1,
+    ESYS_TR shandle2,
+    ESYS_TR shandle3,
+    UINT16 size,
+    UINT16 offset,
+    uint8_t *data)
+{
+    TSS2_RC r;
+    RSRC_NODE_T *authNode, *nvNode;
+    UINT16 chunk_size, pos = 0, done, n;
+    bool batch = nv_bulk_is_batchable(shandle1, shandle2, shandle3);
+
+    _ESYS_ASSERT_NON_NULL(esysContext);
+    if (size > 0)
+        _ESYS_ASSERT_NON_NULL(data);
+    if ((UINT32)offset + size > UINT16_MAX) {
+        LOG_ERROR("NV range exceeds 64 KiB.");
+        return TSS2_ESYS_RC_BAD_VALUE;
+    }
+
+    r = nv_bulk_get_nodes(esysContext, authHandle, nvIndex, &authNode,
+                          &nvNode);
+    return_if_error(r, "Get resource objects");
+
+    r = nv_bulk_chunk_size(esysContext, &chunk_size);
+    return_if_error(r, "Get chunk size");
+
+    if (batch) {
+        r = nv_bulk_init_sys(esysContext);
+        return_if_error(r, "Init SYS contexts");
+    }
+
+    while (pos < size) {
+        if (batch) {
+            r = nv_bulk_batch(esysContext, TPM2_CC_NV_Read, authNode, nvNode,
+                              chunk_size, &data[pos], size - pos,
+                              offset + pos, &done);
+            return_if_error(r, "Read NV batch");
+            pos += done;
+            if (pos == size || done == IESYS_NV_BULK_BATCH * chunk_size)
+                continue;
+        }
+
+        /* Not batchable, or the TPM asked for a resubmission */
+        n = (size - pos < chunk_size) ? size - pos : chunk_size;
+        r = nv_bulk_read_chunk(esysContext, authHandle, nvIndex, shandle1,
+                               shandle2, shandle3, n, offset + pos,
+                               &data[pos]);
+        return_if_error(r, "Read NV chunk");
+        pos += n;
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Write a caller-provided buffer of any size to an NV index.
+ *
+ * The data is written in chunks of the TPM's TPM2_PT_NV_BUFFER_MAX, which is
+ * queried on each call unless the capability cache is enabled. If the only
+ * session is ESYS_TR_PASSWORD, the commands for several chunks are prepared
+ * ahead and sent back-to-back; the first write to an index not written yet
+ * goes through Esys_NV_Write to update the name of nvIndex. Otherwise each
+ * chunk is written with Esys_NV_Write, and the next chunk is copied while the
+ * TPM processes the previous one.
+ * @param esysContext [in,out] The ESYS_CONTEXT.
+ * @param authHandle [in] The handle indicating the source of the
+ *        authorization value.
+ * @param nvIndex [in] The NV Index of the area to write.
+ * @param shandle1 [in] Session handle for authorization of authHandle.
+ * @param shandle2 [in] Second session handle.
+ * @param shandle3 [in] Third session handle.
+ * @param data [in] The data to write.
+ * @param size [in] The size of data.
+ * @param offset [in] The octet offset into the NV Area.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or data is NULL.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if a command is outstanding.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if offset + size exceeds 64 KiB.
+ * @retval TSS2_ESYS_RC_MEMORY if the SYS contexts can not be allocated.
+ * @retval TSS2_RCs produced by Esys_GetCapability, Esys_NV_Write or the
+ *         TPM.
+ */
+TSS2_RC
+Esys_NV_WriteBulk(
+    ESYS_CONTEXT *esysContext,
+    ESYS_TR authHandle,
+    ESYS_TR nvIndex,
+    ESYS_TR shandle1,
+    ESYS_TR shandle2,
+    ESYS_TR shandle3,
+    const uint8_t *data,
+    UINT16 size,
+    UINT16 offset)
+{
+    TSS2_RC r;
+    RSRC_NODE_T *authNode, *nvNode;
+    TPM2B_MAX_NV_BUFFER chunk;
+    UINT16 chunk_size, pos = 0, done;
+    int32_t timeouttmp;
+    bool batch = nv_bulk_is_batchable(shandle1, shandle2, shandle3);
+
+    _ESYS_ASSERT_NON_NULL(esysContext);
+    if (size > 0)
+        _ESYS_ASSERT_NON_NULL(data);
+    if ((UINT32)offset + size > UINT16_MAX) {
+        LOG_ERROR("NV range exceeds 64 KiB.");
+        return TSS2_ESYS_RC_BAD_VALUE;
+    }
+
+    r = nv_bulk_get_nodes(esysContext, authHandle, nvIndex, &authNode,
+                          &nvNode);
+    return_if_error(r, "Get resource objects");
+
+    r = nv_bulk_chunk_size(esysContext, &chunk_size);
+    return_if_error(r, "Get chunk size");
+
+    if (batch) {
+        r = nv_bulk_init_sys(esysContext);
+        return_if_error(r, "Init SYS contexts");
+    }
+
+    chunk.size = (size < chunk_size) ? size : chunk_size;
+    memcpy(&chunk.buffer[0], data, chunk.size);
+
+    while (pos < size) {
+        if (batch && (nvNode->rsrc.misc.rsrc_nv_pub.nvPublic.attributes &
+                      TPMA_NV_WRITTEN)) {
+            r = nv_bulk_batch(esysContext, TPM2_CC_NV_Write, authNode,
+                              nvNode, chunk_size, (uint8_t *)&data[pos],
+                              size - pos, offset + pos, &done);
+            return_if_error(r, "Write NV batch");
+            pos += done;
+            chunk.size = (size - pos < chunk_size) ? size - pos : chunk_size;
+            memcpy(&chunk.buffer[0], &data[pos], chunk.size);
+            if (pos == size || done == IESYS_NV_BULK_BATCH * chunk_size)
+                continue;
+        }
+
+        /* Not batchable, not written yet, or the TPM asked for a
+           resubmission */
+        r = Esys_NV_Write_Async(esysContext, authHandle, nvIndex, shandle1,
+                                shandle2, shandle3, &chunk, offset + pos);
+        return_if_error(r, "Error in async function");
+
+        /* The chunk was copied; fill it while the TPM is busy */
+        pos += chunk.size;
+        chunk.size = (size - pos < chunk_size) ? size - pos : chunk_size;
+        memcpy(&chunk.buffer[0], &data[pos], chunk.size);
+
+        timeouttmp = esysContext->timeout;
+        esysContext->timeout = -1;
+        do {
+            r = Esys_NV_Write_Finish(esysContext);
+        } while ((r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN);
+        esysContext->timeout = timeouttmp;
+        return_if_error(r, "Esys Finish");
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Release the SYS contexts used for batched NV chunks.
+ *
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ */
+void
+iesys_nv_bulk_free(ESYS_CONTEXT *esys_context)
+{
+    for (size_t i = 0; i < IESYS_NV_BULK_BATCH; i++) {
+        if (esys_context->nv_bulk.sys[i] == NULL)
+            continue;
+        Tss2_Sys_Finalize(esys_context->nv_bulk.sys[i]);
+        SAFE_FREE(esys_context->nv_bulk.sys[i]);
+    }
+}
@@ -0,0 +1,424 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <stdlib.h>
+
+#include "tss2_esys.h"
+
+#include "esys_iutil.h"
+#define LOGMODULE esys
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/** A session handed out by the pool.
+ *
+ * The TPM handle is kept next to the ESYS_TR so a session the caller flushed
+ * is recognized even if its ESYS_TR was reused for another object.
+ */
+typedef struct {
+    ESYS_TR esys_handle;             /**< The ESYS_TR of the session. */
+    TPM2_HANDLE tpm_handle;          /**< The TPM handle of the session. */
+} SESSION_POOL_ENTRY;
+
+/** A pool of auth sessions started from one template.
+ *
+ * Sessions are either ready (started but not handed out), acquired (handed
+ * out by Esys_SessionPool_Acquire and not yet released) or being started by
+ * an outstanding Esys_SessionPool_Refill_Async. The sum of the three never
+ * exceeds max, which bounds the TPM session slots used by the pool.
+ */
+struct ESYS_SESSION_POOL {
+    ESYS_CONTEXT *esys_context;      /**< The context of all sessions. */
+    ESYS_SESSION_TEMPLATE sessionTemplate; /**< The parameters of the
+                                          sessions. */
+    size_t min;                      /**< Ready sessions to refill to. */
+    size_t max;                      /**< Upper bound of sessions in the pool. */
+    size_t acquired_count;           /**< Number of entries in acquired. */
+    size_t ready_count;              /**< Number of entries in ready. */
+    bool refilling;                  /**< Whether a StartAuthSession of
+                                          Esys_SessionPool_Refill_Async is
+                                          outstanding. */
+    ESYS_TR *ready;                  /**< The ready sessions (max entries). */
+    SESSION_POOL_ENTRY *acquired;    /**< The acquired sessions (max
+                                          entries). */
+};
+
+static size_t
+session_pool_total(ESYS_SESSION_POOL *pool)
+{
+    return pool->acquired_count + pool->ready_count + (pool->refilling ? 1 : 0);
+}
+
+/** Prepare a session before it is handed out.
+ *
+ * The attributes are reset to those of the template, since the previous user
+ * may have changed them. continueSession is always set, otherwise the TPM
+ * would flush the session behind the pool's back.
+ */
+static TSS2_RC
+session_pool_prepare(ESYS_SESSION_POOL *pool, ESYS_TR session)
+{
+    return Esys_TRSess_SetAttributes(pool->esys_context, session,
+                                     pool->sessionTemplate.sessionAttributes |
+                                     TPMA_SESSION_CONTINUESESSION, 0xff);
+}
+
+/** Complete an outstanding StartAuthSession of the pool.
+ *
+ * @param pool [in,out] The session pool.
+ * @param block [in] Whether to wait for the TPM's response regardless of the
+ *        timeout of the ESYS_CONTEXT.
+ * @retval TSS2_RC_SUCCESS if no refill was outstanding or the new session was
+ *         added to the ready sessions.
+ * @retval TSS2_ESYS_RC_TRY_AGAIN if block is false and the response has not
+ *         arrived yet.
+ * @retval TSS2_RCs produced by Esys_StartAuthSession_Finish.
+ */
+static TSS2_RC
+session_pool_finish(ESYS_SESSION_POOL *pool, bool block)
+{
+    ESYS_CONTEXT *esysContext = pool->esys_context;
+    int32_t timeouttmp = esysContext->timeout;
+    ESYS_TR session;
+    TSS2_RC r;
+
+    if (!pool->refilling)
+        return TSS2_RC_SUCCESS;
+
+    if (block)
+        esysContext->timeout = -1;
+    do {
+        r = Esys_StartAuthSession_Finish(esysContext, &session);
+    } while (block && (r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN);
+    esysContext->timeout = timeouttmp;
+
+    if ((r & ~TSS2_RC_LAYER_MASK) == TSS2_BASE_RC_TRY_AGAIN)
+        return r;
+    pool->refilling = false;
+    return_if_error(r, "Start pooled session");
+
+    pool->ready[pool->ready_count++] = session;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Drop a session from the pool.
+ *
+ * The session is flushed from the TPM. If that fails (e.g. because the TPM
+ * already flushed it) its ESYS_TR is closed so the metadata does not leak.
+ */
+static TSS2_RC
+session_pool_discard(ESYS_SESSION_POOL *pool, ESYS_TR session)
+{
+    TSS2_RC r;
+
+    r = Esys_FlushContext(pool->esys_context, session);
+    if (r != TSS2_RC_SUCCESS) {
+        LOG_WARNING("Flush of pooled session failed (%" PRIx32 ")", r);
+        Esys_TR_Close(pool->esys_context, &session);
+    }
+    return r;
+}
+
+/** Create a session pool.
+ *
+ * Allocates a pool for sessions started with the parameters of
+ * sessionTemplate and starts min sessions right away. The tpmKey and bind
+ * objects of the template must stay loaded as long as the pool may start
+ * sessions.
+ * @param esysContext [in,out] The ESYS_CONTEXT the sessions are started on.
+ * @param sessionTemplate [in] The StartAuthSession parameters and the session
+ *        attributes of the pooled sessions.
+ * @param min [in] The number of ready sessions the pool is refilled to.
+ * @param max [in] The maximum number of sessions of the pool, including the
+ *        acquired ones.
+ * @param pool [out] The new pool (callee-allocated; free with
+ *        Esys_SessionPool_Free()).
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if a pointer parameter is NULL.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if max is 0 or min exceeds max.
+ * @retval TSS2_ESYS_RC_MEMORY if the pool can't be allocated.
+ * @retval TSS2_RCs produced by Esys_StartAuthSession.
+ */
+TSS2_RC
+Esys_SessionPool_Create(ESYS_CONTEXT * esysContext,
+                        const ESYS_SESSION_TEMPLATE * sessionTemplate,
+                        size_t min, size_t max, ESYS_SESSION_POOL ** pool)
+{
+    TSS2_RC r;
+
+    _ESYS_ASSERT_NON_NULL(esysContext);
+    if (sessionTemplate == NULL || pool == NULL)
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Bad reference");
+    if (max == 0 || min > max)
+        return_error(TSS2_ESYS_RC_BAD_VALUE, "Bad pool size");
+
+    *pool = calloc(1, sizeof(ESYS_SESSION_POOL));
+    return_if_null(*pool, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+    (*pool)->ready = calloc(max, sizeof(ESYS_TR));
+    (*pool)->acquired = calloc(max, sizeof(SESSION_POOL_ENTRY));
+    if ((*pool)->ready == NULL || (*pool)->acquired == NULL) {
+        free((*pool)->ready);
+        free((*pool)->acquired);
+        free(*pool);
+        *pool = NULL;
+        return_error(TSS2_ESYS_RC_MEMORY, "Out of memory.");
+    }
+    (*pool)->esys_context = esysContext;
+    (*pool)->sessionTemplate = *sessionTemplate;
+    (*pool)->min = min;
+    (*pool)->max = max;
+
+    r = Esys_SessionPool_Refill(*pool);
+    if (r != TSS2_RC_SUCCESS) {
+        LOG_ERROR("Prefill session pool (%" PRIx32 ")", r);
+        Esys_SessionPool_Free(pool);
+        return r;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/** Free a session pool.
+ *
+ * Completes an outstanding refill and flushes all ready sessions. Sessions
+ * that are still acquired are not touched; they remain valid ESYS_TR objects
+ * owned by the caller.
+ * @param pool [in,out] The pool to free. Set to NULL on return.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_RCs produced by flushing the sessions. The pool is freed in
+ *         any case.
+ */
+TSS2_RC
+Esys_SessionPool_Free(ESYS_SESSION_POOL ** pool)
+{
+    TSS2_RC r, r2;
+    size_t i;
+
+    if (pool == NULL || *pool == NULL)
+        return TSS2_RC_SUCCESS;
+
+    r = session_pool_finish(*pool, true);
+    for (i = 0; i < (*pool)->ready_count; i++) {
+        r2 = session_pool_discard(*pool, (*pool)->ready[i]);
+        if (r == TSS2_RC_SUCCESS)
+            r = r2;
+    }
+    free((*pool)->ready);
+    free((*pool)->acquired);
+    free(*pool);
+    *pool = NULL;
+    return r;
+}
+
+/** Take a session from the pool.
+ *
+ * Returns a ready session if there is one. An outstanding refill is
+ * completed first. If no session is ready a new one is started unless the
+ * pool already holds max sessions.
+ * @param pool [in,out] The session pool.
+ * @param session [out] The session. Its attributes are those of the template
+ *        plus continueSession. Hand it back with Esys_SessionPool_Release().
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if pool or session is NULL.
+ * @retval TSS2_ESYS_RC_TRY_AGAIN if all max sessions are acquired.
+ * @retval TSS2_RCs produced by Esys_StartAuthSession.
+ */
+TSS2_RC
+Esys_SessionPool_Acquire(ESYS_SESSION_POOL * pool, ESYS_TR * session)
+{
+    ESYS_SESSION_TEMPLATE *t;
+    RSRC_NODE_T *node;
+    TSS2_RC r;
+
+    if (pool == NULL || session == NULL)
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Bad reference");
+    t = &pool->sessionTemplate;
+
+    r = session_pool_finish(pool, true);
+    return_if_error(r, "Complete refill");
+
+    if (pool->ready_count > 0) {
+        *session = pool->ready[--pool->ready_count];
+    } else if (session_pool_total(pool) < pool->max) {
+        LOG_DEBUG("Session pool empty, starting session");
+        r = Esys_StartAuthSession(pool->esys_context, t->tpmKey, t->bind,
+                                  ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                                  NULL, t->sessionType, &t->symmetric,
+                                  t->authHash, session);
+        return_if_error(r, "Start session");
+    } else {
+        return_error(TSS2_ESYS_RC_TRY_AGAIN, "All sessions of the pool in use");
+    }
+
+    r = session_pool_prepare(pool, *session);
+    if (r == TSS2_RC_SUCCESS)
+        r = esys_GetResourceObject(pool->esys_context, *session, &node);
+    if (r != TSS2_RC_SUCCESS) {
+        session_pool_discard(pool, *session);
+        *session = ESYS_TR_NONE;
+        return_error(r, "Prepare session");
+    }
+    pool->acquired[pool->acquired_count].esys_handle = *session;
+    pool->acquired[pool->acquired_count].tpm_handle = node->rsrc.handle;
+    pool->acquired_count++;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Hand a session back to the pool.
+ *
+ * Policy sessions are reset with TPM2_PolicyRestart instead of being flushed
+ * and restarted. HMAC sessions are kept as they are; their nonces continue
+ * to roll. A session that can't be reset is flushed and dropped from the
+ * pool.
+ * A session the caller flushed or closed is only dropped from the pool. A
+ * session whose continueSession attribute was cleared is assumed to be
+ * flushed by the TPM after its last use; its ESYS_TR is closed and it is
+ * dropped from the pool as well.
+ * @param pool [in,out] The session pool.
+ * @param session [in] The session to hand back.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if pool is NULL.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if no session of the pool is acquired.
+ * @retval TSS2_ESYS_RC_BAD_VALUE if session is not acquired from this pool,
+ *         e.g. because it was already released.
+ * @retval TSS2_RCs produced by Esys_PolicyRestart.
+ */
+TSS2_RC
+Esys_SessionPool_Release(ESYS_SESSION_POOL * pool, ESYS_TR session)
+{
+    SESSION_POOL_ENTRY entry;
+    RSRC_NODE_T *node;
+    TSS2_RC r;
+    size_t i;
+
+    if (pool == NULL)
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Bad reference");
+    if (pool->acquired_count == 0)
+        return_error(TSS2_ESYS_RC_BAD_SEQUENCE, "No session acquired");
+    for (i = 0; i < pool->acquired_count; i++) {
+        if (pool->acquired[i].esys_handle == session)
+            break;
+    }
+    if (i == pool->acquired_count)
+        return_error(TSS2_ESYS_RC_BAD_VALUE, "Session not acquired from pool");
+
+    r = session_pool_finish(pool, true);
+    return_if_error(r, "Complete refill");
+
+    entry = pool->acquired[i];
+    pool->acquired[i] = pool->acquired[--pool->acquired_count];
+
+    r = esys_GetResourceObject(pool->esys_context, session, &node);
+    if (r != TSS2_RC_SUCCESS ||
+        node->rsrc.rsrcType != IESYSC_SESSION_RSRC ||
+        node->rsrc.handle != entry.tpm_handle) {
+        LOG_DEBUG("Pooled session was flushed by the caller");
+        return TSS2_RC_SUCCESS;
+    }
+    if (!(node->rsrc.misc.rsrc_session.sessionAttributes &
+          TPMA_SESSION_CONTINUESESSION)) {
+        LOG_DEBUG("Pooled session has continueSession cleared");
+        return Esys_TR_Close(pool->esys_context, &session);
+    }
+
+    if (pool->sessionTemplate.sessionType == TPM2_SE_POLICY ||
+        pool->sessionTemplate.sessionType == TPM2_SE_TRIAL) {
+        r = Esys_PolicyRestart(pool->esys_context, session,
+                               ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE);
+        if (r != TSS2_RC_SUCCESS) {
+            LOG_WARNING("Policy restart failed (%" PRIx32 ")", r);
+            session_pool_discard(pool, session);
+            return r;
+        }
+    }
+
+    pool->ready[pool->ready_count++] = session;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Refill the pool to min ready sessions.
+ *
+ * Blocks until the sessions are started. Use Esys_SessionPool_Refill_Async
+ * and Esys_SessionPool_Refill_Finish to refill from an event loop instead.
+ * @param pool [in,out] The session pool.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if pool is NULL.
+ * @retval TSS2_RCs produced by Esys_StartAuthSession.
+ */
+TSS2_RC
+Esys_SessionPool_Refill(ESYS_SESSION_POOL * pool)
+{
+    TSS2_RC r;
+
+    if (pool == NULL)
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Bad reference");
+
+    do {
+        r = session_pool_finish(pool, true);
+        return_if_error(r, "Complete refill");
+        r = Esys_SessionPool_Refill_Async(pool);
+        return_if_error(r, "Start refill");
+    } while (pool->refilling);
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Start one session of a refill.
+ *
+ * Sends TPM2_StartAuthSession for one session if fewer than min sessions are
+ * ready and the pool has room for it. Otherwise nothing is sent and the
+ * following Esys_SessionPool_Refill_Finish returns immediately. Like every
+ * _Async call this occupies the ESYS_CONTEXT until the _Finish call
+ * completed; call it when the context is idle.
+ * @param pool [in,out] The session pool.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if pool is NULL.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if a refill is already outstanding.
+ * @retval TSS2_RCs produced by Esys_StartAuthSession_Async.
+ */
+TSS2_RC
+Esys_SessionPool_Refill_Async(ESYS_SESSION_POOL * pool)
+{
+    ESYS_SESSION_TEMPLATE *t;
+    TSS2_RC r;
+
+    if (pool == NULL)
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Bad reference");
+    if (pool->refilling)
+        return_error(TSS2_ESYS_RC_BAD_SEQUENCE, "Refill outstanding");
+    t = &pool->sessionTemplate;
+
+    if (pool->ready_count >= pool->min ||
+        session_pool_total(pool) >= pool->max)
+        return TSS2_RC_SUCCESS;
+
+    r = Esys_StartAuthSession_Async(pool->esys_context, t->tpmKey, t->bind,
+                                    ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                                    NULL, t->sessionType, &t->symmetric,
+                                    t->authHash);
+    return_if_error(r, "Start session");
+
+    pool->refilling = true;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Complete one session of a refill.
+ *
+ * Waits for the response to Esys_SessionPool_Refill_Async according to the
+ * timeout of the ESYS_CONTEXT and adds the new session to the ready ones.
+ * @param pool [in,out] The session pool.
+ * @retval TSS2_RC_SUCCESS on Success or if no refill was outstanding.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if pool is NULL.
+ * @retval TSS2_ESYS_RC_TRY_AGAIN if the response has not arrived yet.
+ * @retval TSS2_RCs produced by Esys_StartAuthSession_Finish.
+ */
+TSS2_RC
+Esys_SessionPool_Refill_Finish(ESYS_SESSION_POOL * pool)
+{
+    if (pool == NULL)
+        return_error(TSS2_ESYS_RC_BAD_REFERENCE, "Bad reference");
+
+    return session_pool_finish(pool, false);
+}
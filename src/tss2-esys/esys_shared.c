@@ -0,0 +1,557 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "tss2_esys.h"
+
+#include "esys_iutil.h"
+#define LOGMODULE esys
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/*
+ * A shared context runs the jobs of many threads on a single ESYS_CONTEXT.
+ * Jobs are pushed onto an intrusive multi-producer single-consumer queue
+ * (Vyukov) that is drained in FIFO order by one worker thread, the only
+ * thread that ever touches the ESYS_CONTEXT and its TCTI. Producers never
+ * take a lock unless the worker went to sleep on an empty queue.
+ */
+
+/** A node of the job queue. */
+typedef struct IESYS_SHARED_NODE {
+    struct IESYS_SHARED_NODE *next; /**< The next job (accessed atomically). */
+} IESYS_SHARED_NODE;
+
+/** The kinds of jobs run by the worker. */
+typedef enum {
+    IESYS_SHARED_JOB_CALL = 0,       /**< Run the callback of the job. */
+    IESYS_SHARED_JOB_CLOSE,          /**< Release the objects of a client. */
+    IESYS_SHARED_JOB_STOP            /**< Terminate the worker. */
+} IESYS_SHARED_JOB_TYPE;
+
+/** A queued job, which is also the future of its result. */
+struct ESYS_SHARED_FUTURE {
+    IESYS_SHARED_NODE node;          /**< The queue link (first member). */
+    IESYS_SHARED_JOB_TYPE type;      /**< The kind of job. */
+    ESYS_SHARED_CLIENT *client;      /**< The client that submitted the job. */
+    ESYS_SHARED_CALLBACK callback;   /**< The function to run. */
+    void *userdata;                  /**< The argument of callback. */
+    TSS2_RC rc;                      /**< The result of the job. */
+    int done;                        /**< Whether rc is set. */
+    pthread_mutex_t mutex;           /**< Protects done and rc. */
+    pthread_cond_t cond;             /**< Signalled when done is set. */
+};
+
+/** A client of a shared context. Its address identifies the owner of the
+ *  sessions and objects created by its jobs. */
+struct ESYS_SHARED_CLIENT {
+    ESYS_SHARED *shared;             /**< The shared context. */
+};
+
+struct ESYS_SHARED {
+    ESYS_CONTEXT *esys_context;      /**< The context all jobs run on. */
+    IESYS_SHARED_NODE *head;         /**< The last pushed node (producers). */
+    IESYS_SHARED_NODE *tail;         /**< The next node to pop (worker). */
+    IESYS_SHARED_NODE stub;          /**< The placeholder of an empty queue. */
+    int sleeping;                    /**< Whether the worker waits on cond. */
+    pthread_mutex_t mutex;           /**< Protects the sleep of the worker. */
+    pthread_cond_t cond;             /**< Wakes the worker. */
+    pthread_t worker;                /**< The thread running the jobs. */
+    size_t clients;                  /**< The number of open clients. */
+};
+
+/** Append a node to the job queue.
+ *
+ * Safe to be called from any number of threads at once.
+ * @param shared [in,out] The shared context.
+ * @param node [in] The node to be appended.
+ */
+static void
+shared_push(ESYS_SHARED *shared, IESYS_SHARED_NODE *node)
+{
+    IESYS_SHARED_NODE *prev;
+
+    __atomic_store_n(&node->next, NULL, __ATOMIC_RELAXED);
+    prev = __atomic_exchange_n(&shared->head, node, __ATOMIC_SEQ_CST);
+    /* Until this store, the worker sees a non-empty queue that it can not
+       pop from yet. */
+    __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+}
+
+/** Remove the first node from the job queue.
+ *
+ * Must only be called by the worker.
+ * @param shared [in,out] The shared context.
+ * @retval The first node or NULL if the queue is empty or the first node is
+ *         still being appended.
+ */
+static IESYS_SHARED_NODE *
+shared_pop(ESYS_SHARED *shared)
+{
+    IESYS_SHARED_NODE *tail = shared->tail;
+    IESYS_SHARED_NODE *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+    if (tail == &shared->stub) {
+        if (next == NULL)
+            return NULL;
+        shared->tail = next;
+        tail = next;
+        next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    }
+    if (next != NULL) {
+        shared->tail = next;
+        return tail;
+    }
+    if (tail != __atomic_load_n(&shared->head, __ATOMIC_SEQ_CST))
+        return NULL;
+    /* tail is the last node; put the stub behind it to be able to pop it. */
+    shared_push(shared, &shared->stub);
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (next != NULL) {
+        shared->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+/** Check whether the job queue holds no node at all.
+ *
+ * Must only be called by the worker.
+ * @param shared [in] The shared context.
+ * @retval true if the queue is empty.
+ */
+static bool
+shared_empty(ESYS_SHARED *shared)
+{
+    return shared->tail == &shared->stub &&
+        __atomic_load_n(&shared->head, __ATOMIC_SEQ_CST) == &shared->stub;
+}
+
+/** Append a job and wake the worker if it is sleeping.
+ *
+ * @param shared [in,out] The shared context.
+ * @param job [in] The job to be run.
+ */
+static void
+shared_submit(ESYS_SHARED *shared, ESYS_SHARED_FUTURE *job)
+{
+    shared_push(shared, &job->node);
+    /* Pairs with the store of sleeping in shared_wait_for_job: either the
+       worker sees the new node or this thread sees the worker sleeping. */
+    if (__atomic_load_n(&shared->sleeping, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&shared->mutex);
+        pthread_cond_signal(&shared->cond);
+        pthread_mutex_unlock(&shared->mutex);
+    }
+}
+
+/** Take the next job from the queue, sleeping while it is empty.
+ *
+ * @param shared [in,out] The shared context.
+ * @retval The next job.
+ */
+static ESYS_SHARED_FUTURE *
+shared_wait_for_job(ESYS_SHARED *shared)
+{
+    IESYS_SHARED_NODE *node;
+
+    for (;;) {
+        node = shared_pop(shared);
+        if (node != NULL)
+            return (ESYS_SHARED_FUTURE *) node;
+        if (!shared_empty(shared)) {
+            /* A producer is between its exchange and its link. */
+            sched_yield();
+            continue;
+        }
+        pthread_mutex_lock(&shared->mutex);
+        __atomic_store_n(&shared->sleeping, 1, __ATOMIC_SEQ_CST);
+        while (shared_empty(shared))
+            pthread_cond_wait(&shared->cond, &shared->mutex);
+        __atomic_store_n(&shared->sleeping, 0, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&shared->mutex);
+    }
+}
+
+/** Allocate a job.
+ *
+ * @param client [in] The submitting client.
+ * @param type [in] The kind of job.
+ * @param job [out] The new job.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_MEMORY if the job can't be allocated.
+ */
+static TSS2_RC
+shared_job_new(ESYS_SHARED_CLIENT *client, IESYS_SHARED_JOB_TYPE type,
+               ESYS_SHARED_FUTURE **job)
+{
+    ESYS_SHARED_FUTURE *new_job = calloc(1, sizeof(*new_job));
+
+    return_if_null(new_job, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+    if (pthread_mutex_init(&new_job->mutex, NULL) != 0) {
+        free(new_job);
+        return_error(TSS2_ESYS_RC_MEMORY, "Initializing mutex.");
+    }
+    if (pthread_cond_init(&new_job->cond, NULL) != 0) {
+        pthread_mutex_destroy(&new_job->mutex);
+        free(new_job);
+        return_error(TSS2_ESYS_RC_MEMORY, "Initializing condition.");
+    }
+    new_job->type = type;
+    new_job->client = client;
+    *job = new_job;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Free a job.
+ *
+ * @param job [in] The job to be freed.
+ */
+static void
+shared_job_free(ESYS_SHARED_FUTURE *job)
+{
+    pthread_cond_destroy(&job->cond);
+    pthread_mutex_destroy(&job->mutex);
+    free(job);
+}
+
+/** Release the resource objects of a client.
+ *
+ * The sessions of the client are flushed, since no other client may use
+ * them. Its other objects stay loaded and become available to all clients.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param client [in] The client being closed.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_RCs produced by Esys_FlushContext.
+ */
+static TSS2_RC
+shared_release_objects(ESYS_CONTEXT *esys_context, ESYS_SHARED_CLIENT *client)
+{
+    RSRC_NODE_T *node, *next;
+    TSS2_RC r, rc = TSS2_RC_SUCCESS;
+
+    for (node = esys_context->rsrc_list; node != NULL; node = next) {
+        next = node->next;
+        if (node->owner != client)
+            continue;
+        if (node->rsrc.rsrcType != IESYSC_SESSION_RSRC) {
+            node->owner = NULL;
+            continue;
+        }
+        r = Esys_FlushContext(esys_context, node->esys_handle);
+        if (r != TSS2_RC_SUCCESS) {
+            LOG_WARNING("Flush of client session failed (%" PRIx32 ")", r);
+            node->owner = NULL;
+            rc = r;
+        }
+    }
+    return rc;
+}
+
+/** The worker thread of a shared context.
+ *
+ * @param arg [in] The shared context.
+ * @retval NULL.
+ */
+static void *
+shared_worker(void *arg)
+{
+    ESYS_SHARED *shared = arg;
+    ESYS_CONTEXT *esys_context = shared->esys_context;
+    ESYS_SHARED_FUTURE *job;
+    TSS2_RC rc;
+
+    for (;;) {
+        job = shared_wait_for_job(shared);
+        switch (job->type) {
+        case IESYS_SHARED_JOB_CALL:
+            esys_context->owner = job->client;
+            rc = job->callback(esys_context, job->userdata);
+            esys_context->owner = NULL;
+            if (esys_context->state != _ESYS_STATE_INIT &&
+                esys_context->state != _ESYS_STATE_INTERNALERROR) {
+                LOG_WARNING("Shared context job left a command pending.");
+            }
+            break;
+        case IESYS_SHARED_JOB_CLOSE:
+            rc = shared_release_objects(esys_context, job->client);
+            break;
+        default:
+            /* The stop job belongs to Esys_Shared_Finalize. */
+            return NULL;
+        }
+        pthread_mutex_lock(&job->mutex);
+        job->rc = rc;
+        job->done = 1;
+        pthread_cond_signal(&job->cond);
+        pthread_mutex_unlock(&job->mutex);
+    }
+}
+
+/** Create a shared context.
+ *
+ * Initializes an ESYS_CONTEXT and starts the worker thread that runs the jobs
+ * of all clients of the shared context on it.
+ * @param shared [out] The new shared context (callee-allocated; free with
+ *        Esys_Shared_Finalize()).
+ * @param tcti [in] The TCTI passed to Esys_Initialize().
+ * @param abiVersion [in] The ABI version passed to Esys_Initialize().
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if shared is NULL.
+ * @retval TSS2_ESYS_RC_MEMORY if the context can't be allocated.
+ * @retval TSS2_ESYS_RC_GENERAL_FAILURE if the worker can't be started.
+ * @retval TSS2_RCs produced by Esys_Initialize.
+ */
+TSS2_RC
+Esys_Shared_Initialize(ESYS_SHARED **shared,
+                       TSS2_TCTI_CONTEXT *tcti,
+                       TSS2_ABI_VERSION *abiVersion)
+{
+    TSS2_RC r;
+    ESYS_SHARED *new_shared;
+
+    return_if_null(shared, "shared is NULL.", TSS2_ESYS_RC_BAD_REFERENCE);
+
+    new_shared = calloc(1, sizeof(*new_shared));
+    return_if_null(new_shared, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+
+    r = Esys_Initialize(&new_shared->esys_context, tcti, abiVersion);
+    goto_if_error(r, "Initialize ESYS context.", error_free);
+
+    new_shared->head = &new_shared->stub;
+    new_shared->tail = &new_shared->stub;
+    if (pthread_mutex_init(&new_shared->mutex, NULL) != 0) {
+        goto_error(r, TSS2_ESYS_RC_MEMORY, "Initializing mutex.",
+                   error_finalize);
+    }
+    if (pthread_cond_init(&new_shared->cond, NULL) != 0) {
+        goto_error(r, TSS2_ESYS_RC_MEMORY, "Initializing condition.",
+                   error_mutex);
+    }
+    if (pthread_create(&new_shared->worker, NULL, shared_worker,
+                       new_shared) != 0) {
+        goto_error(r, TSS2_ESYS_RC_GENERAL_FAILURE, "Starting worker.",
+                   error_cond);
+    }
+
+    *shared = new_shared;
+    return TSS2_RC_SUCCESS;
+
+error_cond:
+    pthread_cond_destroy(&new_shared->cond);
+error_mutex:
+    pthread_mutex_destroy(&new_shared->mutex);
+error_finalize:
+    Esys_Finalize(&new_shared->esys_context);
+error_free:
+    free(new_shared);
+    return r;
+}
+
+/** Finalize a shared context.
+ *
+ * Runs the jobs still queued, stops the worker and finalizes the
+ * ESYS_CONTEXT. All clients must be closed and no thread may submit jobs
+ * anymore.
+ * @param shared [in,out] The shared context. It is set to NULL.
+ */
+void
+Esys_Shared_Finalize(ESYS_SHARED **shared)
+{
+    ESYS_SHARED_FUTURE stop = { .type = IESYS_SHARED_JOB_STOP };
+
+    if (shared == NULL || *shared == NULL) {
+        LOG_WARNING("Finalizing NULL shared context.");
+        return;
+    }
+    if (__atomic_load_n(&(*shared)->clients, __ATOMIC_ACQUIRE) != 0)
+        LOG_WARNING("Finalizing shared context with open clients.");
+
+    shared_submit(*shared, &stop);
+    pthread_join((*shared)->worker, NULL);
+
+    pthread_cond_destroy(&(*shared)->cond);
+    pthread_mutex_destroy(&(*shared)->mutex);
+    Esys_Finalize(&(*shared)->esys_context);
+    free(*shared);
+    *shared = NULL;
+}
+
+/** Open a client of a shared context.
+ *
+ * Each thread (or other unit of work) uses its own client. Sessions started
+ * by the jobs of a client can only be used by the jobs of the same client.
+ * @param shared [in,out] The shared context.
+ * @param client [out] The new client (callee-allocated; free with
+ *        Esys_Shared_ClientClose()).
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if a pointer parameter is NULL.
+ * @retval TSS2_ESYS_RC_MEMORY if the client can't be allocated.
+ */
+TSS2_RC
+Esys_Shared_ClientOpen(ESYS_SHARED *shared, ESYS_SHARED_CLIENT **client)
+{
+    ESYS_SHARED_CLIENT *new_client;
+
+    return_if_null(shared, "shared is NULL.", TSS2_ESYS_RC_BAD_REFERENCE);
+    return_if_null(client, "client is NULL.", TSS2_ESYS_RC_BAD_REFERENCE);
+
+    new_client = calloc(1, sizeof(*new_client));
+    return_if_null(new_client, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+    new_client->shared = shared;
+    __atomic_add_fetch(&shared->clients, 1, __ATOMIC_RELEASE);
+
+    *client = new_client;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Close a client of a shared context.
+ *
+ * Waits for the jobs of the client submitted so far, flushes the sessions
+ * the client started and hands its other objects over to all clients.
+ * @param client [in,out] The client. It is set to NULL.
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if client is NULL.
+ * @retval TSS2_ESYS_RC_MEMORY if the job can't be allocated.
+ * @retval TSS2_RCs produced by Esys_FlushContext. The client is closed
+ *         nevertheless.
+ */
+TSS2_RC
+Esys_Shared_ClientClose(ESYS_SHARED_CLIENT **client)
+{
+    TSS2_RC r;
+    ESYS_SHARED_FUTURE *job;
+
+    return_if_null(client, "client is NULL.", TSS2_ESYS_RC_BAD_REFERENCE);
+    return_if_null(*client, "client is NULL.", TSS2_ESYS_RC_BAD_REFERENCE);
+
+    r = shared_job_new(*client, IESYS_SHARED_JOB_CLOSE, &job);
+    return_if_error(r, "Create close job.");
+    shared_submit((*client)->shared, job);
+    r = Esys_Shared_Wait(&job, TSS2_TCTI_TIMEOUT_BLOCK);
+
+    __atomic_sub_fetch(&(*client)->shared->clients, 1, __ATOMIC_RELEASE);
+    SAFE_FREE(*client);
+    return r;
+}
+
+/** Queue a job on a shared context.
+ *
+ * The callback is run on the worker thread with the ESYS_CONTEXT of the
+ * shared context. It must not keep a command pending (i.e. complete each
+ * _Async call with its _Finish call) and must not use the ESYS_CONTEXT after
+ * returning. Jobs run in the order they are submitted.
+ * @param client [in] The client submitting the job.
+ * @param callback [in] The function to run.
+ * @param userdata [in] The argument passed to callback.
+ * @param future [out] The handle of the result (callee-allocated; free with
+ *        Esys_Shared_Wait()).
+ * @retval TSS2_RC_SUCCESS on Success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if a pointer parameter is NULL.
+ * @retval TSS2_ESYS_RC_MEMORY if the job can't be allocated.
+ */
+TSS2_RC
+Esys_Shared_Submit(ESYS_SHARED_CLIENT *client,
+                   ESYS_SHARED_CALLBACK callback,
+                   void *userdata,
+                   ESYS_SHARED_FUTURE **future)
+{
+    TSS2_RC r;
+    ESYS_SHARED_FUTURE *job;
+
+    return_if_null(client, "client is NULL.", TSS2_ESYS_RC_BAD_REFERENCE);
+    return_if_null(callback, "callback is NULL.", TSS2_ESYS_RC_BAD_REFERENCE);
+    return_if_null(future, "future is NULL.", TSS2_ESYS_RC_BAD_REFERENCE);
+
+    r = shared_job_new(client, IESYS_SHARED_JOB_CALL, &job);
+    return_if_error(r, "Create job.");
+    job->callback = callback;
+    job->userdata = userdata;
+
+    /* The future must be set before the worker may complete the job. */
+    *future = job;
+    shared_submit(client->shared, job);
+    return TSS2_RC_SUCCESS;
+}
+
+/** Wait for the result of a job.
+ *
+ * @param future [in,out] The future returned by Esys_Shared_Submit(). It is
+ *        freed and set to NULL once the job is done.
+ * @param timeout [in] The time to wait in milliseconds, 0 to poll or
+ *        TSS2_TCTI_TIMEOUT_BLOCK to wait until the job is done.
+ * @retval The return value of the callback of the job.
+ * @retval TSS2_ESYS_RC_TRY_AGAIN if the job is not done within timeout.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if future is NULL.
+ */
+TSS2_RC
+Esys_Shared_Wait(ESYS_SHARED_FUTURE **future, int32_t timeout)
+{
+    TSS2_RC rc;
+    ESYS_SHARED_FUTURE *job;
+    struct timespec deadline;
+
+    return_if_null(future, "future is NULL.", TSS2_ESYS_RC_BAD_REFERENCE);
+    return_if_null(*future, "future is NULL.", TSS2_ESYS_RC_BAD_REFERENCE);
+    job = *future;
+
+    if (timeout > 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout / 1000;
+        deadline.tv_nsec += (long) (timeout % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    /* The job is only freed after taking its mutex, so that the worker has
+       released it. */
+    pthread_mutex_lock(&job->mutex);
+    while (!job->done) {
+        if (timeout == 0 ||
+            (timeout > 0 &&
+             pthread_cond_timedwait(&job->cond, &job->mutex,
+                                    &deadline) == ETIMEDOUT)) {
+            pthread_mutex_unlock(&job->mutex);
+            return TSS2_ESYS_RC_TRY_AGAIN;
+        }
+        if (timeout < 0)
+            pthread_cond_wait(&job->cond, &job->mutex);
+    }
+    rc = job->rc;
+    pthread_mutex_unlock(&job->mutex);
+
+    shared_job_free(job);
+    *future = NULL;
+    return rc;
+}
+
+/** Run a job on a shared context and wait for its result.
+ *
+ * @param client [in] The client submitting the job.
+ * @param callback [in] The function to run.
+ * @param userdata [in] The argument passed to callback.
+ * @retval The return value of callback.
+ * @retval TSS2_RCs produced by Esys_Shared_Submit.
+ */
+TSS2_RC
+Esys_Shared_Call(ESYS_SHARED_CLIENT *client,
+                 ESYS_SHARED_CALLBACK callback,
+                 void *userdata)
+{
+    TSS2_RC r;
+    ESYS_SHARED_FUTURE *future;
+
+    r = Esys_Shared_Submit(client, callback, userdata, &future);
+    return_if_error(r, "Submit job.");
+    return Esys_Shared_Wait(&future, TSS2_TCTI_TIMEOUT_BLOCK);
+}
@@ -0,0 +1,389 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <stdlib.h>
+
+#include "tss2_esys.h"
+
+#include "esys_iutil.h"
+#define LOGMODULE esys
+#include "util/log.h"
+#include "util/aux_util.h"
+#include "util/cc-attributes.h"
+
+/*
+ * Transient objects and sessions of an ESYS_CONTEXT are kept loaded in the
+ * TPM up to a limit per kind. Before a command is prepared, the resources it
+ * references are stamped with the current tick and, if they were swapped out
+ * before, loaded again. To make room the least recently used resources which
+ * are not referenced by the current command are saved with TPM2_ContextSave;
+ * objects are flushed afterwards, sessions are flushed by the save itself.
+ *
+ * The saved TPMS_CONTEXT is kept in the resource object. While a resource is
+ * swapped out, the TPM handle stored in its meta data is stale and must not
+ * be used; all commands referencing the resource pass iesys_swap_in first,
+ * which the Esys_*_Async functions call through iesys_prepare_command.
+ *
+ * Swapping runs on a SYS context of its own that shares the TCTI of the
+ * ESYS_CONTEXT, since the command buffer of the ESYS_CONTEXT's SYS context
+ * may already be prepared when the sessions are swapped in.
+ */
+
+/** Check whether a resource object can be swapped out of the TPM.
+ *
+ * @param node [in] The resource object.
+ * @retval true if the object is a transient object or a session.
+ */
+static bool
+swap_is_swappable(RSRC_NODE_T *node)
+{
+    return node->rsrc.rsrcType == IESYSC_SESSION_RSRC ||
+           (node->rsrc.handle >> TPM2_HR_SHIFT) == TPM2_HT_TRANSIENT;
+}
+
+/** Check whether a resource object is a session.
+ *
+ * @param node [in] The resource object.
+ * @retval true if the object is a session.
+ */
+static bool
+swap_is_session(RSRC_NODE_T *node)
+{
+    return node->rsrc.rsrcType == IESYSC_SESSION_RSRC;
+}
+
+/** Check whether a command creates a new transient object.
+ *
+ * Every command returning a handle loads a new object into the TPM, except
+ * for TPM2_StartAuthSession, which starts a session.
+ * @param command_code [in] The command code.
+ * @retval true if the command loads a new object into the TPM.
+ */
+static bool
+swap_creates_object(TPM2_CC command_code)
+{
+    return cc_attributes(command_code)->responseHandles != 0 &&
+           command_code != TPM2_CC_StartAuthSession;
+}
+
+/** Save a resource object and remove it from the TPM.
+ *
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param node [in,out] The loaded resource object.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_MEMORY if the context can not be allocated.
+ * @retval TSS2_RCs produced by Tss2_Sys_ContextSave or Tss2_Sys_FlushContext.
+ */
+static TSS2_RC
+swap_out(ESYS_CONTEXT *esys_context, RSRC_NODE_T *node)
+{
+    TSS2_RC r;
+    TPMS_CONTEXT *context = calloc(1, sizeof(TPMS_CONTEXT));
+
+    return_if_null(context, "Out of memory.", TSS2_ESYS_RC_MEMORY);
+
+    LOG_DEBUG("Swapping out 0x%08"PRIx32, node->rsrc.handle);
+    r = Tss2_Sys_ContextSave(esys_context->swap.sys, node->rsrc.handle,
+                             context);
+    goto_if_error(r, "Saving context", error_cleanup);
+
+    /* ContextSave flushes a session, but only copies an object. */
+    if (!swap_is_session(node)) {
+        r = Tss2_Sys_FlushContext(esys_context->swap.sys, node->rsrc.handle);
+        goto_if_error(r, "Flushing context", error_cleanup);
+    }
+
+    node->swapped = context;
+    esys_context->swap.stats.swapOuts++;
+    return TSS2_RC_SUCCESS;
+
+error_cleanup:
+    free(context);
+    return r;
+}
+
+/** Load a swapped out resource object into the TPM again.
+ *
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param node [in,out] The swapped out resource object.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_RCs produced by Tss2_Sys_ContextLoad.
+ */
+static TSS2_RC
+swap_load(ESYS_CONTEXT *esys_context, RSRC_NODE_T *node)
+{
+    TSS2_RC r;
+    TPM2_HANDLE handle;
+
+    r = Tss2_Sys_ContextLoad(esys_context->swap.sys, node->swapped, &handle);
+    return_if_error(r, "Loading context");
+
+    LOG_DEBUG("Swapped in 0x%08"PRIx32, handle);
+    node->rsrc.handle = handle;
+    SAFE_FREE(node->swapped);
+    return TSS2_RC_SUCCESS;
+}
+
+/** Swap out least recently used resources until a new one fits.
+ *
+ * Resources stamped with the current tick are used by the current command
+ * and are never evicted.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param sessions [in] Whether to make room for sessions or for objects.
+ * @param needed [in] The number of slots needed by the current command.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_RCs produced by swap_out.
+ */
+static TSS2_RC
+swap_make_room(ESYS_CONTEXT *esys_context, bool sessions, UINT32 needed)
+{
+    TSS2_RC r;
+    UINT32 limit = (sessions) ? esys_context->swap.max_sessions
+                              : esys_context->swap.max_objects;
+    UINT32 loaded = 0;
+    RSRC_NODE_T *node;
+
+    if (needed == 0)
+        return TSS2_RC_SUCCESS;
+
+    for (node = esys_context->rsrc_list; node != NULL; node = node->next) {
+        if (node->swapped == NULL && swap_is_swappable(node) &&
+            swap_is_session(node) == sessions)
+            loaded++;
+    }
+
+    while (loaded + needed > limit) {
+        RSRC_NODE_T *victim = NULL;
+
+        for (node = esys_context->rsrc_list; node != NULL; node = node->next) {
+            if (node->swapped != NULL || !swap_is_swappable(node) ||
+                swap_is_session(node) != sessions ||
+                node->last_use == esys_context->swap.tick)
+                continue;
+            if (victim == NULL || node->last_use < victim->last_use)
+                victim = node;
+        }
+        if (victim == NULL) {
+            /* Everything loaded is used by this command; let the TPM decide. */
+            LOG_DEBUG("No resource left to swap out.");
+            return TSS2_RC_SUCCESS;
+        }
+
+        r = swap_out(esys_context, victim);
+        return_if_error(r, "Swapping out");
+        loaded--;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/** Stamp the resource objects of a command and load the swapped out ones.
+ *
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param nodes [in,out] The resource objects of the command (may be NULL).
+ * @param count [in] The number of entries in nodes.
+ * @param sessions [in] Whether to handle sessions or objects.
+ * @param creating [in] Whether the command itself loads a new resource.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_RCs produced by swap_make_room or swap_load.
+ */
+static TSS2_RC
+swap_in_nodes(ESYS_CONTEXT *esys_context, RSRC_NODE_T **nodes, size_t count,
+              bool sessions, bool creating)
+{
+    TSS2_RC r;
+    UINT32 needed = (creating) ? 1 : 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (nodes[i] == NULL || !swap_is_swappable(nodes[i]) ||
+            swap_is_session(nodes[i]) != sessions ||
+            nodes[i]->last_use == esys_context->swap.tick)
+            continue;
+        nodes[i]->last_use = esys_context->swap.tick;
+        if (nodes[i]->swapped != NULL) {
+            esys_context->swap.stats.misses++;
+            needed++;
+        } else {
+            esys_context->swap.stats.hits++;
+        }
+    }
+
+    r = swap_make_room(esys_context, sessions, needed);
+    return_if_error(r, "Making room");
+
+    for (size_t i = 0; i < count; i++) {
+        if (nodes[i] == NULL || nodes[i]->swapped == NULL ||
+            swap_is_session(nodes[i]) != sessions)
+            continue;
+        r = swap_load(esys_context, nodes[i]);
+        return_if_error(r, "Swapping in");
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+/** Load the transient objects and sessions referenced by command handles.
+ *
+ * Called by iesys_prepare_command before the command is prepared. Starts
+ * a new tick, so that the referenced resources are the most recently used.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @param command_code [in] The command code of the command.
+ * @param node1 [in,out] The resource object of the first handle (may be NULL).
+ * @param node2 [in,out] The resource object of the second handle (may be NULL).
+ * @param node3 [in,out] The resource object of the third handle (may be NULL).
+ * @retval TSS2_RC_SUCCESS on success or if swapping is disabled.
+ * @retval TSS2_RCs produced by the swap commands.
+ */
+TSS2_RC
+iesys_swap_in(ESYS_CONTEXT *esys_context, TPM2_CC command_code,
+              RSRC_NODE_T *node1, RSRC_NODE_T *node2, RSRC_NODE_T *node3)
+{
+    TSS2_RC r;
+    RSRC_NODE_T *nodes[3] = { node1, node2, node3 };
+
+    esys_context->swap.tick++;
+    if (esys_context->swap.sys == NULL)
+        return TSS2_RC_SUCCESS;
+
+    r = swap_in_nodes(esys_context, nodes, 3, false,
+                      swap_creates_object(command_code));
+    return_if_error(r, "Swapping in objects");
+
+    return swap_in_nodes(esys_context, nodes, 3, true,
+                         command_code == TPM2_CC_StartAuthSession);
+}
+
+/** Load the sessions of the current command's authorization area.
+ *
+ * Called by init_session_tab after iesys_swap_in within the same tick, so that
+ * the command's objects are not evicted for its sessions.
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ * @retval TSS2_RC_SUCCESS on success or if swapping is disabled.
+ * @retval TSS2_RCs produced by the swap commands.
+ */
+TSS2_RC
+iesys_swap_in_sessions(ESYS_CONTEXT *esys_context)
+{
+    if (esys_context->swap.sys == NULL)
+        return TSS2_RC_SUCCESS;
+
+    return swap_in_nodes(esys_context, esys_context->session_tab, 3, true,
+                         false);
+}
+
+/** Release the SYS context used for swapping.
+ *
+ * @param esys_context [in,out] The ESYS_CONTEXT.
+ */
+void
+iesys_swap_free(ESYS_CONTEXT *esys_context)
+{
+    if (esys_context->swap.sys == NULL)
+        return;
+
+    Tss2_Sys_Finalize(esys_context->swap.sys);
+    SAFE_FREE(esys_context->swap.sys);
+}
+
+/** Enable swapping of transient objects and sessions.
+ *
+ * Keeps at most maxObjects transient objects and maxSessions sessions of the
+ * ESYS_CONTEXT loaded in the TPM. Before each command, the least recently used
+ * resources not referenced by the command are saved and removed from the TPM
+ * if the command would exceed a limit, and swapped out resources referenced
+ * by the command are loaded again. A limit of 0 is replaced by the minimum
+ * number of loaded objects or sessions the TPM reports to guarantee.
+ * Calling the function again changes the limits.
+ * Saved sessions still occupy one of the TPM's active session slots.
+ * With swapping enabled, the Esys_*_Async functions send the required
+ * TPM2_ContextSave, TPM2_FlushContext and TPM2_ContextLoad commands and wait
+ * for their responses before sending their own command, regardless of the
+ * timeout of the ESYS_CONTEXT.
+ * @param esysContext [in,out] The ESYS_CONTEXT.
+ * @param maxObjects [in] The number of transient objects kept loaded.
+ * @param maxSessions [in] The number of sessions kept loaded.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext is NULL.
+ * @retval TSS2_ESYS_RC_MEMORY if the SYS context can not be allocated.
+ * @retval TSS2_ESYS_RC_BAD_SEQUENCE if a command is outstanding.
+ * @retval TSS2_RCs produced by Esys_GetCapability or Tss2_Sys_Initialize.
+ */
+TSS2_RC
+Esys_SetSwapLimits(ESYS_CONTEXT *esysContext, UINT32 maxObjects,
+                   UINT32 maxSessions)
+{
+    TSS2_RC r;
+    TSS2_TCTI_CONTEXT *tcti;
+    size_t syssize;
+
+    _ESYS_ASSERT_NON_NULL(esysContext);
+
+    if (maxObjects == 0 || maxSessions == 0) {
+        TPMI_YES_NO moreData;
+        TPMS_CAPABILITY_DATA *capabilityData = NULL;
+
+        r = Esys_GetCapability(esysContext,
+                               ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                               TPM2_CAP_TPM_PROPERTIES,
+                               TPM2_PT_TPM2_HR_TRANSIENT_MIN, 3,
+                               &moreData, &capabilityData);
+        return_if_error(r, "Get TPM properties");
+
+        TPML_TAGGED_TPM_PROPERTY *props = &capabilityData->data.tpmProperties;
+        for (UINT32 i = 0; i < props->count; i++) {
+            if (props->tpmProperty[i].property == TPM2_PT_TPM2_HR_TRANSIENT_MIN &&
+                maxObjects == 0)
+                maxObjects = props->tpmProperty[i].value;
+            else if (props->tpmProperty[i].property == TPM2_PT_HR_LOADED_MIN &&
+                     maxSessions == 0)
+                maxSessions = props->tpmProperty[i].value;
+        }
+        free(capabilityData);
+
+        if (maxObjects == 0 || maxSessions == 0) {
+            LOG_ERROR("TPM does not report its loaded resource minimums.");
+            return TSS2_ESYS_RC_GENERAL_FAILURE;
+        }
+    }
+
+    if (esysContext->swap.sys == NULL) {
+        r = Tss2_Sys_GetTctiContext(esysContext->sys, &tcti);
+        return_if_error(r, "Get TCTI context");
+
+        syssize = Tss2_Sys_GetContextSize(0);
+        esysContext->swap.sys = calloc(1, syssize);
+        return_if_null(esysContext->swap.sys, "Out of memory.",
+                       TSS2_ESYS_RC_MEMORY);
+
+        r = Tss2_Sys_Initialize(esysContext->swap.sys, syssize, tcti, NULL);
+        if (r != TSS2_RC_SUCCESS) {
+            SAFE_FREE(esysContext->swap.sys);
+            return_error(r, "During syscontext initialization");
+        }
+    }
+
+    esysContext->swap.max_objects = maxObjects;
+    esysContext->swap.max_sessions = maxSessions;
+    return TSS2_RC_SUCCESS;
+}
+
+/** Get the swap counters of an ESYS_CONTEXT.
+ *
+ * A hit is a reference to a transient object or session that was loaded in
+ * the TPM, a miss one that had to be loaded again. swapOuts counts the
+ * resources saved and removed from the TPM to make room.
+ * @param esysContext [in] The ESYS_CONTEXT.
+ * @param stats [out] The swap counters.
+ * @retval TSS2_RC_SUCCESS on success.
+ * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext or stats is NULL.
+ */
+TSS2_RC
+Esys_GetSwapStats(ESYS_CONTEXT *esysContext, ESYS_SWAP_STATS *stats)
+{
+    _ESYS_ASSERT_NON_NULL(esysContext);
+    _ESYS_ASSERT_NON_NULL(stats);
+
+    *stats = esysContext->swap.stats;
+    return TSS2_RC_SUCCESS;
+}
@@ -50,9 +50,8 @@ Esys_TR_Serialize(ESYS_CONTEXT * esys_context,
         return TSS2_ESYS_RC_BAD_REFERENCE;
     }
 
-    r = iesys_MU_IESYS_RESOURCE_Marshal(&esys_object->rsrc, NULL, SIZE_MAX,
-                                        buffer_size);
-    return_if_error(r, "Marshal resource object");
+    r = iesys_MU_IESYS_RESOURCE_Size(&esys_object->rsrc, buffer_size);
+    return_if_error(r, "Size of resource object");
 
     *buffer = malloc(*buffer_size);
     return_if_null(*buffer, "Buffer could not be allocated",
@@ -146,6 +145,20 @@ Esys_TR_FromTPMPublic_Async(ESYS_CONTEXT * esys_context,
     esysHandleNode->rsrc.handle = tpm_handle;
     esys_context->esys_handle = esys_handle;
 
+    /* Without sessions the metadata may be taken from the metadata cache */
+    if (esys_context->metadata_cache != NULL && shandle1 == ESYS_TR_NONE &&
+        shandle2 == ESYS_TR_NONE && shandle3 == ESYS_TR_NONE) {
+        r = iesys_check_sequence_async(esys_context);
+        goto_if_error(r, "Check sequence", error_cleanup);
+
+        if (iesys_metadata_cache_get(esys_context, tpm_handle,
+                                     &esysHandleNode->rsrc)) {
+            esys_context->metadata_cache->hit = esys_handle;
+            return TSS2_RC_SUCCESS;
+        }
+        esysHandleNode->rsrc.handle = tpm_handle;
+    }
+
     if (tpm_handle >= TPM2_NV_INDEX_FIRST && tpm_handle <= TPM2_NV_INDEX_LAST) {
         esys_context->in.NV_ReadPublic.nvIndex = esys_handle;
         r = Esys_NV_ReadPublic_Async(esys_context, esys_handle, shandle1,
@@ -197,6 +210,14 @@ Esys_TR_FromTPMPublic_Finish(ESYS_CONTEXT * esys_context, ESYS_TR * object)
     ESYS_TR objectHandle = esys_context->esys_handle;
     RSRC_NODE_T *objectHandleNode = NULL;
 
+    /* The metadata was taken from the metadata cache */
+    if (esys_context->metadata_cache != NULL &&
+        esys_context->metadata_cache->hit == objectHandle) {
+        esys_context->metadata_cache->hit = ESYS_TR_NONE;
+        *object = objectHandle;
+        return TSS2_RC_SUCCESS;
+    }
+
     r = esys_GetResourceObject(esys_context, objectHandle, &objectHandleNode);
     goto_if_error(r, "get resource", error_cleanup);
 
@@ -241,6 +262,11 @@ Esys_TR_FromTPMPublic_Finish(ESYS_CONTEXT * esys_context, ESYS_TR * object)
         SAFE_FREE(name);
         SAFE_FREE(qualifiedName);
     }
+
+    r = iesys_metadata_cache_put(esys_context, &objectHandleNode->rsrc);
+    if (r != TSS2_RC_SUCCESS)
+        LOG_WARNING("Metadata of 0x%08"PRIx32" not cached",
+                    objectHandleNode->rsrc.handle);
     *object = objectHandle;
     return TSS2_RC_SUCCESS;
 
@@ -338,29 +364,25 @@ Esys_TR_FromTPMPublic(ESYS_CONTEXT * esys_context,
  * @retval TSS2_RC_SUCCESS on Success.
  * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext is NULL.
  * @retval TSS2_ESYS_RC_BAD_TR if the ESYS_TR object is unknown to the
- *         ESYS_CONTEXT.
+ *         ESYS_CONTEXT or is a session of another shared context client.
  */
 TSS2_RC
 Esys_TR_Close(ESYS_CONTEXT * esys_context, ESYS_TR * object)
 {
-    RSRC_NODE_T *node = NULL;
-    RSRC_NODE_T **update_ptr = NULL;
+    TSS2_RC r;
 
     _ESYS_ASSERT_NON_NULL(esys_context);
     _ESYS_ASSERT_NON_NULL(object);
-    for (node = esys_context->rsrc_list,
-         update_ptr = &esys_context->rsrc_list;
-         node != NULL;
-         update_ptr = &node->next, node = node->next) {
-        if (node->esys_handle == *object) {
-            *update_ptr = node->next;
-            SAFE_FREE(node);
-            *object = ESYS_TR_NONE;
-            return TSS2_RC_SUCCESS;
-        }
+    r = iesys_check_session_owner(esys_context, *object);
+    return_if_error(r, "Check session owner");
+    r = esys_DeleteResourceObject(esys_context, *object);
+    if (r == TSS2_ESYS_RC_BAD_TR) {
+        LOG_ERROR("Error: Esys handle does not exist (%x).", TSS2_ESYS_RC_BAD_TR);
+        return TSS2_ESYS_RC_BAD_TR;
     }
-    LOG_ERROR("Error: Esys handle does not exist (%x).", TSS2_ESYS_RC_BAD_TR);
-    return TSS2_ESYS_RC_BAD_TR;
+    return_if_error(r, "Delete resource object");
+    *object = ESYS_TR_NONE;
+    return TSS2_RC_SUCCESS;
 }
 
 /** Set the authorization value of an ESYS_TR.
@@ -377,7 +399,7 @@ Esys_TR_Close(ESYS_CONTEXT * esys_context, ESYS_TR * object)
  * @retval TSS2_RC_SUCCESS on Success.
  * @retval TSS2_ESYS_RC_BAD_REFERENCE if the esysContext is NULL.
  * @retval TSS2_ESYS_RC_BAD_TR if the ESYS_TR object is unknown to the
- *         ESYS_CONTEXT.
+ *         ESYS_CONTEXT or is a session of another shared context client.
  */
 TSS2_RC
 Esys_TR_SetAuth(ESYS_CONTEXT * esys_context, ESYS_TR esys_handle,
@@ -389,6 +411,8 @@ Esys_TR_SetAuth(ESYS_CONTEXT * esys_context, ESYS_TR esys_handle,
     r = esys_GetResourceObject(esys_context, esys_handle, &esys_object);
     if (r != TPM2_RC_SUCCESS)
         return r;
+    r = iesys_check_session_owner(esys_context, esys_handle);
+    return_if_error(r, "Check session owner");
     
     if (esys_object == NULL) {
         return TSS2_ESYS_RC_BAD_REFERENCE;
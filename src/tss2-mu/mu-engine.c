@@ -0,0 +1,1174 @@
+/* SPDX-License-Identifier: BSD-2 */
+/***********************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ *
+ * All rights reserved.
+ ***********************************************************************/
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "tss2_mu.h"
+#include "tss2_sys.h"
+
+#include "mu-engine.h"
+#include "util/tss2_endian.h"
+#define LOGMODULE marshal
+#include "util/log.h"
+
+/* The largest number of fields in a struct descriptor. */
+#define MU_MAX_FIELDS 11
+
+const MU_TYPE mu_UINT8 = { "UINT8", MU_KIND_UINT, 0, 0, 0, 1, NULL };
+const MU_TYPE mu_UINT16 = { "UINT16", MU_KIND_UINT, 0, 0, 0, 2, NULL };
+const MU_TYPE mu_UINT32 = { "UINT32", MU_KIND_UINT, 0, 0, 0, 4, NULL };
+const MU_TYPE mu_UINT64 = { "UINT64", MU_KIND_UINT, 0, 0, 0, 8, NULL };
+
+static TSS2_RC
+marshal(const MU_TYPE *type, uint8_t const *src, uint32_t selector,
+        uint8_t buffer[], size_t buffer_size, size_t *offset, int probe);
+
+static TSS2_RC
+unmarshal(const MU_TYPE *type, uint8_t const buffer[], size_t buffer_size,
+          size_t *offset, uint32_t selector, uint8_t *dest);
+
+static TSS2_RC
+unmarshal_struct(const MU_TYPE *type, uint8_t const buffer[],
+                 size_t buffer_size, size_t *offset, uint8_t *dest, int clear);
+
+/* Host order load and store of the integer fields of a C structure. */
+static uint64_t
+get_uint(uint8_t const *src, size_t size)
+{
+    UINT16 u16;
+    UINT32 u32;
+    UINT64 u64;
+
+    switch (size) {
+    case 1:
+        return *src;
+    case 2:
+        memcpy(&u16, src, sizeof(u16));
+        return u16;
+    case 4:
+        memcpy(&u32, src, sizeof(u32));
+        return u32;
+    default:
+        memcpy(&u64, src, sizeof(u64));
+        return u64;
+    }
+}
+
+static void
+set_uint(uint8_t *dest, uint64_t value, size_t size)
+{
+    UINT16 u16 = (UINT16)value;
+    UINT32 u32 = (UINT32)value;
+
+    switch (size) {
+    case 1:
+        *dest = (UINT8)value;
+        break;
+    case 2:
+        memcpy(dest, &u16, sizeof(u16));
+        break;
+    case 4:
+        memcpy(dest, &u32, sizeof(u32));
+        break;
+    default:
+        memcpy(dest, &value, sizeof(value));
+        break;
+    }
+}
+
+/* Network byte order load and store of the wire integers. */
+static uint64_t
+get_be(uint8_t const *src, size_t size)
+{
+    UINT16 u16;
+    UINT32 u32;
+    UINT64 u64;
+
+    switch (size) {
+    case 1:
+        return *src;
+    case 2:
+        memcpy(&u16, src, sizeof(u16));
+        return BE_TO_HOST_16(u16);
+    case 4:
+        memcpy(&u32, src, sizeof(u32));
+        return BE_TO_HOST_32(u32);
+    default:
+        memcpy(&u64, src, sizeof(u64));
+        return BE_TO_HOST_64(u64);
+    }
+}
+
+static void
+set_be(uint8_t *dest, uint64_t value, size_t size)
+{
+    UINT16 u16 = HOST_TO_BE_16((UINT16)value);
+    UINT32 u32 = HOST_TO_BE_32((UINT32)value);
+    UINT64 u64 = HOST_TO_BE_64(value);
+
+    switch (size) {
+    case 1:
+        *dest = (UINT8)value;
+        break;
+    case 2:
+        memcpy(dest, &u16, sizeof(u16));
+        break;
+    case 4:
+        memcpy(dest, &u32, sizeof(u32));
+        break;
+    default:
+        memcpy(dest, &u64, sizeof(u64));
+        break;
+    }
+}
+
+/*
+ * Marshal 'size' bytes from src, byte swapped as an integer if 'swap' is
+ * set. With no buffer only the offset is advanced; in probe mode (the
+ * items of a TPML sized without a buffer) the buffer space is checked as
+ * if there were one.
+ */
+static TSS2_RC
+marshal_fixed(uint8_t const *src, size_t size, int swap, uint8_t buffer[],
+              size_t buffer_size, size_t *offset, int probe)
+{
+    size_t local_offset = offset ? *offset : 0;
+
+    if (buffer == NULL && !probe) {
+        if (offset == NULL) {
+            LOG_ERROR("buffer and offset parameter are NULL");
+            return TSS2_MU_RC_BAD_REFERENCE;
+        }
+        *offset += size;
+        LOG_TRACE("buffer NULL and offset non-NULL, updating offset to %zu",
+                  *offset);
+        return TSS2_RC_SUCCESS;
+    }
+    if (buffer_size < local_offset || buffer_size - local_offset < size) {
+        LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient for "
+                    "object of size %zu", buffer_size, local_offset, size);
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+    }
+    if (buffer != NULL) {
+        if (swap)
+            set_be(&buffer[local_offset], get_uint(src, size), size);
+        else
+            memcpy(&buffer[local_offset], src, size);
+    }
+    if (offset != NULL)
+        *offset = local_offset + size;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * Unmarshal 'size' bytes to dest. Without a destination the bytes are
+ * skipped; integers are checked against the buffer first, raw byte arrays
+ * are not.
+ */
+static TSS2_RC
+unmarshal_fixed(uint8_t const buffer[], size_t buffer_size, size_t *offset,
+                uint8_t *dest, size_t size, int swap)
+{
+    size_t local_offset = offset ? *offset : 0;
+
+    if (buffer == NULL || (dest == NULL && offset == NULL)) {
+        LOG_ERROR("buffer or dest and offset parameter are NULL");
+        return TSS2_MU_RC_BAD_REFERENCE;
+    }
+    if (dest == NULL && !swap) {
+        *offset += size;
+        LOG_TRACE("dest NULL and offset non-NULL, updating offset to %zu",
+                  *offset);
+        return TSS2_RC_SUCCESS;
+    }
+    if (buffer_size < local_offset || size > buffer_size - local_offset) {
+        LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient for "
+                    "object of size %zu", buffer_size, local_offset, size);
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+    }
+    if (dest == NULL) {
+        *offset += size;
+        LOG_TRACE("dest NULL and offset non-NULL, updating offset to %zu",
+                  *offset);
+        return TSS2_RC_SUCCESS;
+    }
+    if (swap)
+        set_uint(dest, get_be(&buffer[local_offset], size), size);
+    else
+        memcpy(dest, &buffer[local_offset], size);
+    if (offset != NULL)
+        *offset = local_offset + size;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+marshal_tpm2b(const MU_TYPE *type, uint8_t const *src, uint8_t buffer[],
+              size_t buffer_size, size_t *offset, int probe)
+{
+    size_t local_offset = offset ? *offset : 0;
+    UINT16 size;
+
+    if (src == NULL) {
+        LOG_WARNING("src param is NULL");
+        return TSS2_MU_RC_BAD_REFERENCE;
+    }
+    size = (UINT16)get_uint(src, sizeof(size));
+    if (buffer == NULL && !probe) {
+        if (offset == NULL) {
+            LOG_WARNING("buffer and offset parameter are NULL");
+            return TSS2_MU_RC_BAD_REFERENCE;
+        }
+        *offset += sizeof(size) + size;
+        LOG_TRACE("buffer NULL and offset non-NULL, updating offset to %zu",
+                  *offset);
+        return TSS2_RC_SUCCESS;
+    }
+    if (buffer_size < local_offset || buffer_size - local_offset <
+        sizeof(size) + (type->kind == MU_KIND_TPM2B ? size : 0)) {
+        LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient for "
+                    "object of size %zu", buffer_size, local_offset,
+                    sizeof(size) + size);
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+    }
+
+    LOG_DEBUG("Marshalling %s from 0x%" PRIxPTR " to buffer 0x%" PRIxPTR
+              " at index 0x%zx, buffer size %zu, object size %u", type->name,
+              (uintptr_t)src, (uintptr_t)buffer, local_offset, buffer_size,
+              size);
+
+    if (type->kind == MU_KIND_TPM2B) {
+        if (buffer != NULL) {
+            set_be(&buffer[local_offset], size, sizeof(size));
+            memcpy(&buffer[local_offset + sizeof(size)], src + sizeof(size),
+                   size);
+        }
+        local_offset += sizeof(size) + size;
+    } else {
+        size_t start = local_offset;
+        TSS2_RC rc;
+
+        local_offset += sizeof(size);
+        rc = marshal(type->desc, src + type->offset, 0, buffer, buffer_size,
+                     &local_offset, probe);
+        if (rc)
+            return rc;
+        /* The size is that of the marshaled structure, not src->size. */
+        if (buffer != NULL)
+            set_be(&buffer[start], local_offset - start - sizeof(size),
+                   sizeof(size));
+    }
+
+    if (offset != NULL)
+        *offset = local_offset;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+unmarshal_tpm2b(const MU_TYPE *type, uint8_t const buffer[],
+                size_t buffer_size, size_t *offset, uint8_t *dest)
+{
+    size_t local_offset = offset ? *offset : 0;
+    UINT16 size;
+
+    if (buffer == NULL || (dest == NULL && offset == NULL)) {
+        LOG_WARNING("buffer or dest and offset parameter are NULL");
+        return TSS2_MU_RC_BAD_REFERENCE;
+    }
+    if (buffer_size < local_offset ||
+        sizeof(size) > buffer_size - local_offset) {
+        LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient for "
+                    "object of size %zu", buffer_size, local_offset,
+                    sizeof(size));
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+    }
+    if (type->kind == MU_KIND_TPM2B_SUBTYPE && dest != NULL &&
+        get_uint(dest, sizeof(size)) != 0) {
+        LOG_WARNING("Size not zero");
+        return TSS2_SYS_RC_BAD_VALUE;
+    }
+    size = (UINT16)get_be(&buffer[local_offset], sizeof(size));
+    local_offset += sizeof(size);
+
+    LOG_DEBUG("Unmarshaling %s from 0x%" PRIxPTR " to buffer 0x%" PRIxPTR
+              " at index 0x%zx, buffer size %zu, object size %u", type->name,
+              (uintptr_t)buffer, (uintptr_t)dest, local_offset, buffer_size,
+              size);
+
+    if (size > buffer_size - local_offset) {
+        LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient for "
+                    "object of size %zu", buffer_size, local_offset,
+                    (size_t)size);
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+    }
+    if (type->count < size) {
+        LOG_ERROR("The dest field size of %" PRIu32 " is too small to "
+                  "unmarshal %d bytes", type->count, size);
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+    }
+
+    if (dest == NULL) {
+        local_offset += size;
+    } else if (type->kind == MU_KIND_TPM2B) {
+        set_uint(dest, size, sizeof(size));
+        memcpy(dest + sizeof(size), &buffer[local_offset], size);
+        local_offset += size;
+    } else {
+        set_uint(dest, size, sizeof(size));
+        /*
+         * The structure is bounded by the size checked above; as in the
+         * original TPM2B_*_Unmarshal functions its own result is not
+         * reported.
+         */
+        unmarshal(type->desc, buffer, buffer_size, &local_offset, 0,
+                  dest + type->offset);
+    }
+
+    if (offset != NULL)
+        *offset = local_offset;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * The wire size of a list item made of integers only (a UINT or a struct of
+ * UINT fields), 0 for any other item. Lists of these items are checked
+ * against the buffer once and then byte swapped in a loop, without going
+ * through the descriptors of every item.
+ */
+static size_t
+leaf_size(const MU_TYPE *type)
+{
+    const MU_FIELD *field = type->desc;
+    size_t size = 0;
+    uint32_t i;
+
+    if (type->kind == MU_KIND_UINT)
+        return type->size;
+    if (type->kind != MU_KIND_STRUCT)
+        return 0;
+    for (i = 0; i < type->count; i++, field++) {
+        if (field->type->kind != MU_KIND_UINT)
+            return 0;
+        size += field->type->size;
+    }
+    return size;
+}
+
+static void
+marshal_leaves(const MU_TYPE *item, uint8_t const *src, UINT32 count,
+               uint8_t *buffer)
+{
+    const MU_FIELD *field;
+    UINT32 i, j;
+    size_t size;
+
+    if (item->kind == MU_KIND_UINT) {
+        size = item->size;
+        for (i = 0; i < count; i++, src += size, buffer += size)
+            set_be(buffer, get_uint(src, size), size);
+        return;
+    }
+    for (i = 0; i < count; i++, src += item->size) {
+        for (j = 0, field = item->desc; j < item->count; j++, field++) {
+            size = field->type->size;
+            set_be(buffer, get_uint(src + field->offset, size), size);
+            buffer += size;
+        }
+    }
+}
+
+static void
+unmarshal_leaves(const MU_TYPE *item, uint8_t const *buffer, UINT32 count,
+                 uint8_t *dest)
+{
+    const MU_FIELD *field;
+    UINT32 i, j;
+    size_t size;
+
+    if (item->kind == MU_KIND_UINT) {
+        size = item->size;
+        for (i = 0; i < count; i++, dest += size, buffer += size)
+            set_uint(dest, get_be(buffer, size), size);
+        return;
+    }
+    for (i = 0; i < count; i++, dest += item->size) {
+        for (j = 0, field = item->desc; j < item->count; j++, field++) {
+            size = field->type->size;
+            set_uint(dest + field->offset, get_be(buffer, size), size);
+            buffer += size;
+        }
+    }
+}
+
+/*
+ * The items of TPML_DIGEST and the PCR selection lists have a size prefix,
+ * so their bounds are checked one by one, but they are handled here
+ * directly instead of through marshal() / unmarshal() for every item.
+ */
+static TSS2_RC
+marshal_tpm2b_items(const MU_TYPE *item, uint8_t const *src, UINT32 count,
+                    uint8_t buffer[], size_t buffer_size, size_t *offset)
+{
+    size_t local_offset = *offset;
+    UINT32 i;
+    UINT16 size;
+
+    for (i = 0; i < count; i++, src += item->size) {
+        size = (UINT16)get_uint(src, sizeof(size));
+        if (buffer_size - local_offset < sizeof(size) + size) {
+            LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient "
+                        "for object of size %zu", buffer_size, local_offset,
+                        sizeof(size) + size);
+            return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+        }
+        if (buffer != NULL) {
+            set_be(&buffer[local_offset], size, sizeof(size));
+            memcpy(&buffer[local_offset + sizeof(size)], src + sizeof(size),
+                   size);
+        }
+        local_offset += sizeof(size) + size;
+    }
+    *offset = local_offset;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+unmarshal_tpm2b_items(const MU_TYPE *item, uint8_t const buffer[],
+                      size_t buffer_size, size_t *offset, UINT32 count,
+                      uint8_t *dest)
+{
+    size_t local_offset = *offset;
+    UINT32 i;
+    UINT16 size;
+
+    for (i = 0; i < count; i++) {
+        if (sizeof(size) > buffer_size - local_offset) {
+            LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient "
+                        "for object of size %zu", buffer_size, local_offset,
+                        sizeof(size));
+            return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+        }
+        size = (UINT16)get_be(&buffer[local_offset], sizeof(size));
+        local_offset += sizeof(size);
+        if (size > buffer_size - local_offset) {
+            LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient "
+                        "for object of size %zu", buffer_size, local_offset,
+                        (size_t)size);
+            return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+        }
+        if (item->count < size) {
+            LOG_ERROR("The dest field size of %" PRIu32 " is too small to "
+                      "unmarshal %d bytes", item->count, size);
+            return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+        }
+        if (dest != NULL) {
+            set_uint(dest, size, sizeof(size));
+            memcpy(dest + sizeof(size), &buffer[local_offset], size);
+            dest += item->size;
+        }
+        local_offset += size;
+    }
+    *offset = local_offset;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+marshal_pcr_items(const MU_TYPE *item, uint8_t const *src, UINT32 count,
+                  uint8_t buffer[], size_t buffer_size, size_t *offset)
+{
+    size_t local_offset = *offset;
+    size_t head = item->desc ? ((const MU_TYPE *)item->desc)->size : 0;
+    UINT32 i;
+    UINT8 size;
+
+    for (i = 0; i < count; i++, src += item->size) {
+        size = src[item->offset];
+        if (size > item->count) {
+            LOG_ERROR("sizeofSelect value %" PRIu8 "/%" PRIu32 " too big",
+                      size, item->count);
+            return TSS2_SYS_RC_BAD_VALUE;
+        }
+        if (buffer_size - local_offset < head + sizeof(size) + size) {
+            LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient "
+                        "for object of size %zu", buffer_size, local_offset,
+                        head + sizeof(size) + size);
+            return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+        }
+        if (buffer != NULL) {
+            if (head)
+                set_be(&buffer[local_offset], get_uint(src, head), head);
+            memcpy(&buffer[local_offset + head], &src[item->offset],
+                   sizeof(size) + size);
+        }
+        local_offset += head + sizeof(size) + size;
+    }
+    *offset = local_offset;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+unmarshal_pcr_items(const MU_TYPE *item, uint8_t const buffer[],
+                    size_t buffer_size, size_t *offset, UINT32 count,
+                    uint8_t *dest)
+{
+    size_t local_offset = *offset;
+    size_t head = item->desc ? ((const MU_TYPE *)item->desc)->size : 0;
+    UINT32 i;
+    UINT8 size;
+
+    for (i = 0; i < count; i++) {
+        if (head + sizeof(size) > buffer_size - local_offset) {
+            LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient "
+                        "for object of size %zu", buffer_size, local_offset,
+                        head + sizeof(size));
+            return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+        }
+        size = buffer[local_offset + head];
+        if (dest != NULL) {
+            if (head)
+                set_uint(dest, get_be(&buffer[local_offset], head), head);
+            dest[item->offset] = size;
+        }
+        local_offset += head + sizeof(size);
+        if (size > item->count) {
+            LOG_ERROR("sizeofSelect value %" PRIu8 " / %" PRIu32 " too big",
+                      size, item->count);
+            return TSS2_SYS_RC_MALFORMED_RESPONSE;
+        }
+        if (size > buffer_size - local_offset) {
+            LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient "
+                        "for object of size %zu", buffer_size, local_offset,
+                        (size_t)size);
+            return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+        }
+        if (dest != NULL) {
+            memcpy(&dest[item->offset + 1], &buffer[local_offset], size);
+            dest += item->size;
+        }
+        local_offset += size;
+    }
+    *offset = local_offset;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+marshal_tpml(const MU_TYPE *type, uint8_t const *src, uint8_t buffer[],
+             size_t buffer_size, size_t *offset, int probe)
+{
+    const MU_TYPE *item = type->desc;
+    size_t local_offset = offset ? *offset : 0;
+    size_t leaf;
+    UINT32 i, count;
+    TSS2_RC rc;
+
+    if (src == NULL) {
+        LOG_ERROR("src is NULL");
+        return TSS2_MU_RC_BAD_REFERENCE;
+    }
+    if (buffer == NULL && offset == NULL) {
+        LOG_ERROR("buffer and offset parameter are NULL");
+        return TSS2_MU_RC_BAD_REFERENCE;
+    }
+    if (buffer_size < local_offset ||
+        buffer_size - local_offset < sizeof(count)) {
+        LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient for "
+                    "object of size %zu", buffer_size, local_offset,
+                    sizeof(count));
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+    }
+    count = (UINT32)get_uint(src, sizeof(count));
+    if (count > type->count) {
+        LOG_WARNING("count too big");
+        return TSS2_SYS_RC_BAD_VALUE;
+    }
+
+    LOG_DEBUG("Marshalling %s from 0x%" PRIxPTR " to buffer 0x%" PRIxPTR
+              " at index 0x%zx", type->name, (uintptr_t)src,
+              (uintptr_t)buffer, local_offset);
+
+    /* Without a buffer the items are still checked against buffer_size. */
+    if (buffer == NULL)
+        probe = 1;
+    else
+        set_be(&buffer[local_offset], count, sizeof(count));
+    local_offset += sizeof(count);
+
+    src += type->offset;
+    leaf = leaf_size(item);
+    if (leaf != 0) {
+        if (buffer_size - local_offset < count * leaf) {
+            LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient "
+                        "for object of size %zu", buffer_size, local_offset,
+                        count * leaf);
+            return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+        }
+        if (buffer != NULL)
+            marshal_leaves(item, src, count, &buffer[local_offset]);
+        local_offset += count * leaf;
+    } else if (item->kind == MU_KIND_TPM2B) {
+        rc = marshal_tpm2b_items(item, src, count, buffer, buffer_size,
+                                 &local_offset);
+        if (rc)
+            return rc;
+    } else if (item->kind == MU_KIND_PCR) {
+        rc = marshal_pcr_items(item, src, count, buffer, buffer_size,
+                               &local_offset);
+        if (rc)
+            return rc;
+    } else {
+        for (i = 0; i < count; i++, src += item->size) {
+            rc = marshal(item, src, 0, buffer, buffer_size, &local_offset,
+                         probe);
+            if (rc)
+                return rc;
+        }
+    }
+
+    if (offset != NULL)
+        *offset = local_offset;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+unmarshal_tpml(const MU_TYPE *type, uint8_t const buffer[],
+               size_t buffer_size, size_t *offset, uint8_t *dest)
+{
+    const MU_TYPE *item = type->desc;
+    size_t local_offset = offset ? *offset : 0;
+    size_t leaf;
+    UINT32 i, count;
+    TSS2_RC rc;
+
+    if (buffer == NULL || (dest == NULL && offset == NULL)) {
+        LOG_ERROR("buffer or dest and offset parameter are NULL");
+        return TSS2_MU_RC_BAD_REFERENCE;
+    }
+    if (buffer_size < local_offset ||
+        sizeof(count) > buffer_size - local_offset) {
+        LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient for "
+                    "object of size %zu", buffer_size, local_offset,
+                    sizeof(count));
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+    }
+
+    LOG_DEBUG("Unmarshaling %s from 0x%" PRIxPTR " to buffer 0x%" PRIxPTR
+              " at index 0x%zx", type->name, (uintptr_t)buffer,
+              (uintptr_t)dest, local_offset);
+
+    count = (UINT32)get_be(&buffer[local_offset], sizeof(count));
+    local_offset += sizeof(count);
+    if (count > type->count) {
+        LOG_WARNING("count too big");
+        return TSS2_SYS_RC_MALFORMED_RESPONSE;
+    }
+
+    if (dest != NULL) {
+        memset(dest, 0, type->size);
+        set_uint(dest, count, sizeof(count));
+        dest += type->offset;
+    }
+    leaf = leaf_size(item);
+    if (leaf != 0) {
+        if (count * leaf > buffer_size - local_offset) {
+            LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient "
+                        "for object of size %zu", buffer_size, local_offset,
+                        count * leaf);
+            return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+        }
+        if (dest != NULL)
+            unmarshal_leaves(item, &buffer[local_offset], count, dest);
+        local_offset += count * leaf;
+    } else if (item->kind == MU_KIND_TPM2B) {
+        rc = unmarshal_tpm2b_items(item, buffer, buffer_size, &local_offset,
+                                   count, dest);
+        if (rc)
+            return rc;
+    } else if (item->kind == MU_KIND_PCR) {
+        rc = unmarshal_pcr_items(item, buffer, buffer_size, &local_offset,
+                                 count, dest);
+        if (rc)
+            return rc;
+    } else {
+        /* The list was cleared as a whole, so struct items are not cleared. */
+        for (i = 0; i < count; i++) {
+            if (item->kind == MU_KIND_STRUCT)
+                rc = unmarshal_struct(item, buffer, buffer_size,
+                                      &local_offset, dest, 0);
+            else
+                rc = unmarshal(item, buffer, buffer_size, &local_offset, 0,
+                               dest);
+            if (rc)
+                return rc;
+            if (dest != NULL)
+                dest += item->size;
+        }
+    }
+
+    if (offset != NULL)
+        *offset = local_offset;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+marshal_pcr(const MU_TYPE *type, uint8_t const *src, uint8_t buffer[],
+            size_t buffer_size, size_t *offset, int probe)
+{
+    size_t local_offset = 0;
+    UINT8 size;
+    TSS2_RC rc;
+
+    if (src == NULL) {
+        LOG_WARNING("src param is NULL");
+        return TSS2_MU_RC_BAD_REFERENCE;
+    }
+    if (offset != NULL)
+        local_offset = *offset;
+    else if (buffer == NULL)
+        return TSS2_MU_RC_BAD_REFERENCE;
+
+    LOG_DEBUG("Marshalling %s from 0x%" PRIxPTR " to buffer 0x%" PRIxPTR
+              " at index 0x%zx", type->name, (uintptr_t)src,
+              (uintptr_t)buffer, local_offset);
+
+    size = src[type->offset];
+    if (size > type->count) {
+        LOG_ERROR("sizeofSelect value %" PRIu8 "/%" PRIu32 " too big",
+                  size, type->count);
+        return TSS2_SYS_RC_BAD_VALUE;
+    }
+    if (type->desc != NULL) {
+        rc = marshal(type->desc, src, 0, buffer, buffer_size, &local_offset,
+                     probe);
+        if (rc)
+            return rc;
+    }
+    rc = marshal_fixed(&src[type->offset], sizeof(size), 0, buffer,
+                       buffer_size, &local_offset, probe);
+    if (rc)
+        return rc;
+    rc = marshal_fixed(&src[type->offset + 1], size, 0, buffer, buffer_size,
+                       &local_offset, probe);
+    if (rc)
+        return rc;
+
+    if (offset != NULL)
+        *offset = local_offset;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+unmarshal_pcr(const MU_TYPE *type, uint8_t const buffer[],
+              size_t buffer_size, size_t *offset, uint8_t *dest)
+{
+    size_t local_offset = 0;
+    UINT8 size;
+    TSS2_RC rc;
+
+    if (offset != NULL)
+        local_offset = *offset;
+    else if (dest == NULL)
+        return TSS2_MU_RC_BAD_REFERENCE;
+
+    LOG_DEBUG("Unmarshaling %s from 0x%" PRIxPTR " to buffer 0x%" PRIxPTR
+              " at index 0x%zx", type->name, (uintptr_t)buffer,
+              (uintptr_t)dest, local_offset);
+
+    if (dest != NULL)
+        memset(dest, 0, type->size);
+    if (type->desc != NULL) {
+        rc = unmarshal(type->desc, buffer, buffer_size, &local_offset, 0,
+                       dest);
+        if (rc)
+            return rc;
+    }
+    rc = unmarshal_fixed(buffer, buffer_size, &local_offset, &size,
+                         sizeof(size), 1);
+    if (rc)
+        return rc;
+    if (dest != NULL)
+        dest[type->offset] = size;
+    if (size > type->count) {
+        LOG_ERROR("sizeofSelect value %" PRIu8 " / %" PRIu32 " too big",
+                  size, type->count);
+        return TSS2_SYS_RC_MALFORMED_RESPONSE;
+    }
+    /* The select bytes are checked against the buffer even when skipped. */
+    if (buffer_size < local_offset || size > buffer_size - local_offset) {
+        LOG_WARNING("buffer_size: %zu with offset: %zu are insufficient for "
+                    "object of size %zu", buffer_size, local_offset,
+                    (size_t)size);
+        return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+    }
+    if (dest != NULL)
+        memcpy(&dest[type->offset + 1], &buffer[local_offset], size);
+    local_offset += size;
+
+    if (offset != NULL)
+        *offset = local_offset;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+marshal_struct(const MU_TYPE *type, uint8_t const *src, uint8_t buffer[],
+               size_t buffer_size, size_t *offset, int probe)
+{
+    const MU_FIELD *field = type->desc;
+    uint32_t values[MU_MAX_FIELDS];
+    size_t local_offset = 0;
+    uint32_t i;
+    TSS2_RC rc;
+
+    if (src == NULL) {
+        LOG_WARNING("src param is NULL");
+        return (type->flags & MU_FLAG_SYS_RC) ? TSS2_SYS_RC_BAD_REFERENCE :
+                                                TSS2_MU_RC_BAD_REFERENCE;
+    }
+    if (offset != NULL)
+        local_offset = *offset;
+    else if (buffer == NULL)
+        return TSS2_MU_RC_BAD_REFERENCE;
+
+    LOG_DEBUG("Marshalling %s from 0x%" PRIxPTR " to buffer 0x%" PRIxPTR
+              " at index 0x%zx", type->name, (uintptr_t)src,
+              (uintptr_t)buffer, local_offset);
+
+    for (i = 0; i < type->count; i++, field++) {
+        uint8_t const *member = src + field->offset;
+
+        if (field->type->kind == MU_KIND_UINT) {
+            size_t size = field->type->size;
+            uint64_t value = get_uint(member, size);
+
+            values[i] = (uint32_t)value;
+            if (buffer != NULL || probe) {
+                if (buffer_size < local_offset ||
+                    buffer_size - local_offset < size) {
+                    LOG_WARNING("buffer_size: %zu with offset: %zu are "
+                                "insufficient for object of size %zu",
+                                buffer_size, local_offset, size);
+                    return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+                }
+                if (buffer != NULL)
+                    set_be(&buffer[local_offset], value, size);
+            }
+            local_offset += size;
+            continue;
+        }
+        rc = marshal(field->type, member,
+                     field->selector ? values[field->selector - 1] : 0,
+                     buffer, buffer_size, &local_offset, probe);
+        if (rc)
+            return rc;
+    }
+
+    if (offset != NULL)
+        *offset = local_offset;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * Unmarshal the fields of a struct in order. 'clear' zeroes dest first; it
+ * is not set when the caller has already cleared the memory.
+ */
+static TSS2_RC
+unmarshal_struct(const MU_TYPE *type, uint8_t const buffer[],
+                 size_t buffer_size, size_t *offset, uint8_t *dest, int clear)
+{
+    const MU_FIELD *field = type->desc;
+    uint32_t values[MU_MAX_FIELDS];
+    size_t local_offset = 0;
+    uint32_t i;
+    TSS2_RC rc;
+
+    if (buffer == NULL || (dest == NULL && offset == NULL)) {
+        LOG_ERROR("buffer or dest and offset parameter are NULL");
+        return TSS2_MU_RC_BAD_REFERENCE;
+    }
+    if (offset != NULL)
+        local_offset = *offset;
+
+    LOG_DEBUG("Unmarshaling %s from 0x%" PRIxPTR " to buffer 0x%" PRIxPTR
+              " at index 0x%zx", type->name, (uintptr_t)buffer,
+              (uintptr_t)dest, local_offset);
+
+    if (dest != NULL && clear)
+        memset(dest, 0, type->size);
+
+    for (i = 0; i < type->count; i++, field++) {
+        uint8_t *member = dest ? dest + field->offset : NULL;
+
+        if (field->type->kind == MU_KIND_UINT) {
+            /* Selectors are needed even when the struct is skipped. */
+            size_t size = field->type->size;
+            uint64_t value;
+
+            if (buffer_size < local_offset ||
+                size > buffer_size - local_offset) {
+                LOG_WARNING("buffer_size: %zu with offset: %zu are "
+                            "insufficient for object of size %zu",
+                            buffer_size, local_offset, size);
+                return TSS2_MU_RC_INSUFFICIENT_BUFFER;
+            }
+            value = get_be(&buffer[local_offset], size);
+            if (member != NULL)
+                set_uint(member, value, size);
+            values[i] = (uint32_t)value;
+            local_offset += size;
+            continue;
+        }
+        rc = unmarshal(field->type, buffer, buffer_size, &local_offset,
+                       field->selector ? values[field->selector - 1] : 0,
+                       member);
+        if (rc)
+            return rc;
+    }
+
+    if (offset != NULL)
+        *offset = local_offset;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static const MU_MEMBER *
+union_member(const MU_TYPE *type, uint32_t selector)
+{
+    const MU_MEMBER *member = type->desc;
+    uint32_t i;
+
+    for (i = 0; i < type->count; i++, member++) {
+        if (member->selector == selector)
+            return member;
+    }
+    return NULL;
+}
+
+static TSS2_RC
+marshal(const MU_TYPE *type, uint8_t const *src, uint32_t selector,
+        uint8_t buffer[], size_t buffer_size, size_t *offset, int probe)
+{
+    const MU_MEMBER *member;
+
+    switch (type->kind) {
+    case MU_KIND_UINT:
+    case MU_KIND_BYTES:
+        return marshal_fixed(src, type->size, type->kind == MU_KIND_UINT,
+                             buffer, buffer_size, offset, probe);
+    case MU_KIND_TPM2B:
+    case MU_KIND_TPM2B_SUBTYPE:
+        return marshal_tpm2b(type, src, buffer, buffer_size, offset, probe);
+    case MU_KIND_TPML:
+        return marshal_tpml(type, src, buffer, buffer_size, offset, probe);
+    case MU_KIND_PCR:
+        return marshal_pcr(type, src, buffer, buffer_size, offset, probe);
+    case MU_KIND_STRUCT:
+        return marshal_struct(type, src, buffer, buffer_size, offset, probe);
+    case MU_KIND_EMPTY:
+        if (src == NULL) {
+            LOG_WARNING("src param is NULL");
+            return TSS2_MU_RC_BAD_REFERENCE;
+        }
+        return TSS2_RC_SUCCESS;
+    case MU_KIND_UNION:
+        if (src == NULL) {
+            LOG_WARNING("src param is NULL");
+            return TSS2_MU_RC_BAD_REFERENCE;
+        }
+        member = union_member(type, selector);
+        if (member == NULL)
+            return TSS2_RC_SUCCESS;
+        return marshal(member->type, src, 0, buffer, buffer_size, offset,
+                       probe);
+    default:
+        LOG_ERROR("Invalid descriptor for %s", type->name);
+        return TSS2_MU_RC_GENERAL_FAILURE;
+    }
+}
+
+static TSS2_RC
+unmarshal(const MU_TYPE *type, uint8_t const buffer[], size_t buffer_size,
+          size_t *offset, uint32_t selector, uint8_t *dest)
+{
+    const MU_MEMBER *member;
+
+    switch (type->kind) {
+    case MU_KIND_UINT:
+    case MU_KIND_BYTES:
+        return unmarshal_fixed(buffer, buffer_size, offset, dest, type->size,
+                               type->kind == MU_KIND_UINT);
+    case MU_KIND_TPM2B:
+    case MU_KIND_TPM2B_SUBTYPE:
+        return unmarshal_tpm2b(type, buffer, buffer_size, offset, dest);
+    case MU_KIND_TPML:
+        return unmarshal_tpml(type, buffer, buffer_size, offset, dest);
+    case MU_KIND_PCR:
+        return unmarshal_pcr(type, buffer, buffer_size, offset, dest);
+    case MU_KIND_STRUCT:
+        return unmarshal_struct(type, buffer, buffer_size, offset, dest,
+                                type->flags & MU_FLAG_MEMSET);
+    case MU_KIND_EMPTY:
+        if (dest == NULL) {
+            LOG_WARNING("dest param is NULL");
+            return TSS2_MU_RC_BAD_REFERENCE;
+        }
+        return TSS2_RC_SUCCESS;
+    case MU_KIND_UNION:
+        member = union_member(type, selector);
+        if (member == NULL)
+            return TSS2_RC_SUCCESS;
+        return unmarshal(member->type, buffer, buffer_size, offset, 0, dest);
+    default:
+        LOG_ERROR("Invalid descriptor for %s", type->name);
+        return TSS2_MU_RC_GENERAL_FAILURE;
+    }
+}
+
+/*
+ * Add the number of bytes 'type' marshals to from src to *size. The sizes
+ * are computed from the size and count fields alone, without a buffer;
+ * src is checked the way marshal() checks it.
+ */
+static TSS2_RC
+size_of(const MU_TYPE *type, uint8_t const *src, uint32_t selector,
+        size_t *size)
+{
+    const MU_FIELD *field;
+    const MU_TYPE *item;
+    const MU_MEMBER *member;
+    uint32_t values[MU_MAX_FIELDS];
+    size_t leaf;
+    UINT32 i, count;
+    UINT8 select;
+    TSS2_RC rc;
+
+    if (src == NULL && type->kind != MU_KIND_UINT &&
+        type->kind != MU_KIND_BYTES) {
+        LOG_WARNING("src param is NULL");
+        return (type->flags & MU_FLAG_SYS_RC) ? TSS2_SYS_RC_BAD_REFERENCE :
+                                                TSS2_MU_RC_BAD_REFERENCE;
+    }
+
+    switch (type->kind) {
+    case MU_KIND_UINT:
+    case MU_KIND_BYTES:
+        *size += type->size;
+        return TSS2_RC_SUCCESS;
+    case MU_KIND_TPM2B:
+        *size += sizeof(UINT16) + get_uint(src, sizeof(UINT16));
+        return TSS2_RC_SUCCESS;
+    case MU_KIND_TPM2B_SUBTYPE:
+        *size += sizeof(UINT16);
+        return size_of(type->desc, src + type->offset, 0, size);
+    case MU_KIND_TPML:
+        item = type->desc;
+        count = (UINT32)get_uint(src, sizeof(count));
+        if (count > type->count) {
+            LOG_WARNING("count too big");
+            return TSS2_SYS_RC_BAD_VALUE;
+        }
+        *size += sizeof(count);
+        if (item->kind == MU_KIND_BYTES) {
+            *size += (size_t)count * item->size;
+            return TSS2_RC_SUCCESS;
+        }
+        leaf = leaf_size(item);
+        if (leaf != 0) {
+            *size += (size_t)count * leaf;
+            return TSS2_RC_SUCCESS;
+        }
+        for (i = 0, src += type->offset; i < count; i++, src += item->size) {
+            rc = size_of(item, src, 0, size);
+            if (rc)
+                return rc;
+        }
+        return TSS2_RC_SUCCESS;
+    case MU_KIND_PCR:
+        select = src[type->offset];
+        if (select > type->count) {
+            LOG_ERROR("sizeofSelect value %" PRIu8 "/%" PRIu32 " too big",
+                      select, type->count);
+            return TSS2_SYS_RC_BAD_VALUE;
+        }
+        if (type->desc != NULL)
+            *size += ((const MU_TYPE *)type->desc)->size;
+        *size += sizeof(select) + select;
+        return TSS2_RC_SUCCESS;
+    case MU_KIND_STRUCT:
+        field = type->desc;
+        for (i = 0; i < type->count; i++, field++) {
+            if (field->type->kind == MU_KIND_UINT) {
+                values[i] = (uint32_t)get_uint(src + field->offset,
+                                               field->type->size);
+                *size += field->type->size;
+                continue;
+            }
+            rc = size_of(field->type, src + field->offset,
+                         field->selector ? values[field->selector - 1] : 0,
+                         size);
+            if (rc)
+                return rc;
+        }
+        return TSS2_RC_SUCCESS;
+    case MU_KIND_EMPTY:
+        return TSS2_RC_SUCCESS;
+    case MU_KIND_UNION:
+        member = union_member(type, selector);
+        if (member == NULL)
+            return TSS2_RC_SUCCESS;
+        return size_of(member->type, src, 0, size);
+    default:
+        LOG_ERROR("Invalid descriptor for %s", type->name);
+        return TSS2_MU_RC_GENERAL_FAILURE;
+    }
+}
+
+TSS2_RC
+mu_marshal(const MU_TYPE *type, void const *src, uint32_t selector,
+           uint8_t buffer[], size_t buffer_size, size_t *offset)
+{
+    return marshal(type, src, selector, buffer, buffer_size, offset, 0);
+}
+
+TSS2_RC
+mu_unmarshal(const MU_TYPE *type, uint8_t const buffer[], size_t buffer_size,
+             size_t *offset, uint32_t selector, void *dest)
+{
+    return unmarshal(type, buffer, buffer_size, offset, selector, dest);
+}
+
+TSS2_RC
+mu_size(const MU_TYPE *type, void const *src, uint32_t selector,
+        size_t *size)
+{
+    size_t local_size = 0;
+    TSS2_RC rc;
+
+    if (size == NULL) {
+        LOG_WARNING("size param is NULL");
+        return TSS2_MU_RC_BAD_REFERENCE;
+    }
+    rc = size_of(type, src, selector, &local_size);
+    if (rc)
+        return rc;
+    LOG_DEBUG("Size of %s at 0x%" PRIxPTR " is %zu", type->name,
+              (uintptr_t)src, local_size);
+    *size = local_size;
+
+    return TSS2_RC_SUCCESS;
+}
@@ -0,0 +1,292 @@
+/* SPDX-License-Identifier: BSD-2 */
+/***********************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#ifndef MU_ENGINE_H
+#define MU_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tss2_mu.h"
+
+/*
+ * The marshaling code for the composite TPM types is a single interpreter
+ * (mu-engine.c) walking constant descriptors. Every TPM2B_*, TPML_*, TPMS_*,
+ * TPMT_* and TPMU_* type has one MU_TYPE describing its wire layout, and its
+ * Tss2_MU_*_Marshal / _Unmarshal / _Size functions are one-line calls into
+ * the interpreter. The base and TPMA types keep their own functions; the
+ * interpreter handles fields of those types inline through the mu_UINT*
+ * descriptors.
+ */
+typedef enum {
+    MU_KIND_UINT,           /* integer of 'size' bytes in network byte order */
+    MU_KIND_BYTES,          /* 'size' raw bytes, e.g. the TPMU_HA members */
+    MU_KIND_TPM2B,          /* UINT16 size and up to 'count' bytes */
+    MU_KIND_TPM2B_SUBTYPE,  /* UINT16 size and the structure 'desc' */
+    MU_KIND_TPML,           /* UINT32 count and up to 'count' 'desc' items */
+    MU_KIND_PCR,            /* optional 'desc' field, UINT8 size and bytes */
+    MU_KIND_STRUCT,         /* the 'count' MU_FIELDs in 'desc' in order */
+    MU_KIND_EMPTY,          /* TPMS_EMPTY */
+    MU_KIND_UNION,          /* the MU_MEMBER of 'desc' matching the selector */
+} MU_KIND;
+
+/* Zero the destination before unmarshaling into it (the TPMS_* types). */
+#define MU_FLAG_MEMSET  0x01
+/* A NULL source is a TSS2_SYS_RC_BAD_REFERENCE (the TPMT_* types). */
+#define MU_FLAG_SYS_RC  0x02
+
+typedef struct MU_TYPE MU_TYPE;
+
+struct MU_TYPE {
+    const char *name;
+    uint8_t kind;           /* MU_KIND */
+    uint8_t flags;          /* MU_FLAG_* */
+    uint32_t count;         /* number of fields / members / list items or
+                               the capacity of a TPM2B or pcrSelect */
+    uint32_t offset;        /* offset of the list items, TPM2B_SUBTYPE
+                               member or sizeofSelect */
+    uint32_t size;          /* sizeof the C type */
+    const void *desc;       /* fields, members or the item type */
+};
+
+typedef struct {
+    const MU_TYPE *type;
+    uint32_t offset;
+    uint32_t selector;      /* 1 + index of the field selecting this union
+                               member, 0 for fields that are not unions */
+} MU_FIELD;
+
+typedef struct {
+    uint32_t selector;
+    const MU_TYPE *type;
+} MU_MEMBER;
+
+#define MU_TAB_SIZE(tab) (sizeof(tab) / sizeof(tab[0]))
+
+/* Evaluates to 0 and breaks the build if cond is false. */
+#define MU_CHECK(cond) (0 * sizeof(char [(cond) ? 1 : -1]))
+
+#define MU_SIZEOF_MEMBER(type, member) sizeof(((type *)NULL)->member)
+
+/*
+ * A field of a struct descriptor. 'mu' names both the descriptor and the C
+ * type of the field so that the sizes can be checked at compile time.
+ */
+#define MU_FIELD(type, member, mu) \
+    { &mu_##mu, offsetof(type, member) + \
+      MU_CHECK(MU_SIZEOF_MEMBER(type, member) == sizeof(mu)), 0 }
+
+/* A union field selected by the value of the field with index 'sel'. */
+#define MU_SELECTED(type, member, mu, sel) \
+    { &mu_##mu, offsetof(type, member) + \
+      MU_CHECK(MU_SIZEOF_MEMBER(type, member) == sizeof(mu)), (sel) + 1 }
+
+#define MU_MEMBER(type, sel, member, mu) \
+    { (sel) + MU_CHECK(MU_SIZEOF_MEMBER(type, member) == sizeof(mu)), \
+      &mu_##mu }
+
+#define MU_STRUCT(type, flags, ...) \
+    static const MU_FIELD mu_fields_##type[] = { __VA_ARGS__ }; \
+    const MU_TYPE mu_##type = { #type, MU_KIND_STRUCT, flags, \
+        MU_TAB_SIZE(mu_fields_##type), 0, sizeof(type), mu_fields_##type }
+
+#define MU_UNION(type, ...) \
+    static const MU_MEMBER mu_members_##type[] = { __VA_ARGS__ }; \
+    const MU_TYPE mu_##type = { #type, MU_KIND_UNION, 0, \
+        MU_TAB_SIZE(mu_members_##type), 0, sizeof(type), mu_members_##type }
+
+/* The public functions of a type are thin wrappers around the interpreter. */
+#define MU_FUNCTIONS(type) \
+TSS2_RC Tss2_MU_##type##_Marshal(type const *src, uint8_t buffer[], \
+                                 size_t buffer_size, size_t *offset) \
+{ \
+    return mu_marshal(&mu_##type, src, 0, buffer, buffer_size, offset); \
+} \
+\
+TSS2_RC Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
+                                   size_t *offset, type *dest) \
+{ \
+    return mu_unmarshal(&mu_##type, buffer, buffer_size, offset, 0, dest); \
+} \
+\
+TSS2_RC Tss2_MU_##type##_Size(type const *src, size_t *size) \
+{ \
+    return mu_size(&mu_##type, src, 0, size); \
+}
+
+#define MU_UNION_FUNCTIONS(type) \
+TSS2_RC Tss2_MU_##type##_Marshal(type const *src, uint32_t selector, \
+                                 uint8_t buffer[], size_t buffer_size, \
+                                 size_t *offset) \
+{ \
+    return mu_marshal(&mu_##type, src, selector, buffer, buffer_size, \
+                      offset); \
+} \
+\
+TSS2_RC Tss2_MU_##type##_Unmarshal(uint8_t const buffer[], size_t buffer_size, \
+                                   size_t *offset, uint32_t selector, \
+                                   type *dest) \
+{ \
+    return mu_unmarshal(&mu_##type, buffer, buffer_size, offset, selector, \
+                        dest); \
+} \
+\
+TSS2_RC Tss2_MU_##type##_Size(type const *src, uint32_t selector, \
+                              size_t *size) \
+{ \
+    return mu_size(&mu_##type, src, selector, size); \
+}
+
+TSS2_RC
+mu_marshal(
+    const MU_TYPE *type,
+    void const *src,
+    uint32_t selector,
+    uint8_t buffer[],
+    size_t buffer_size,
+    size_t *offset);
+
+TSS2_RC
+mu_unmarshal(
+    const MU_TYPE *type,
+    uint8_t const buffer[],
+    size_t buffer_size,
+    size_t *offset,
+    uint32_t selector,
+    void *dest);
+
+TSS2_RC
+mu_size(
+    const MU_TYPE *type,
+    void const *src,
+    uint32_t selector,
+    size_t *size);
+
+extern const MU_TYPE mu_UINT8;
+extern const MU_TYPE mu_UINT16;
+extern const MU_TYPE mu_UINT32;
+extern const MU_TYPE mu_UINT64;
+
+extern const MU_TYPE mu_TPM2B_DIGEST;
+extern const MU_TYPE mu_TPM2B_DATA;
+extern const MU_TYPE mu_TPM2B_EVENT;
+extern const MU_TYPE mu_TPM2B_MAX_BUFFER;
+extern const MU_TYPE mu_TPM2B_MAX_NV_BUFFER;
+extern const MU_TYPE mu_TPM2B_IV;
+extern const MU_TYPE mu_TPM2B_NAME;
+extern const MU_TYPE mu_TPM2B_ATTEST;
+extern const MU_TYPE mu_TPM2B_SYM_KEY;
+extern const MU_TYPE mu_TPM2B_SENSITIVE_DATA;
+extern const MU_TYPE mu_TPM2B_PUBLIC_KEY_RSA;
+extern const MU_TYPE mu_TPM2B_PRIVATE_KEY_RSA;
+extern const MU_TYPE mu_TPM2B_ECC_PARAMETER;
+extern const MU_TYPE mu_TPM2B_ENCRYPTED_SECRET;
+extern const MU_TYPE mu_TPM2B_PRIVATE_VENDOR_SPECIFIC;
+extern const MU_TYPE mu_TPM2B_PRIVATE;
+extern const MU_TYPE mu_TPM2B_ID_OBJECT;
+extern const MU_TYPE mu_TPM2B_CONTEXT_SENSITIVE;
+extern const MU_TYPE mu_TPM2B_CONTEXT_DATA;
+extern const MU_TYPE mu_TPM2B_NONCE;
+extern const MU_TYPE mu_TPM2B_TIMEOUT;
+extern const MU_TYPE mu_TPM2B_AUTH;
+extern const MU_TYPE mu_TPM2B_OPERAND;
+extern const MU_TYPE mu_TPM2B_TEMPLATE;
+extern const MU_TYPE mu_TPM2B_ECC_POINT;
+extern const MU_TYPE mu_TPM2B_NV_PUBLIC;
+extern const MU_TYPE mu_TPM2B_SENSITIVE;
+extern const MU_TYPE mu_TPM2B_SENSITIVE_CREATE;
+extern const MU_TYPE mu_TPM2B_CREATION_DATA;
+extern const MU_TYPE mu_TPM2B_PUBLIC;
+
+extern const MU_TYPE mu_TPML_CC;
+extern const MU_TYPE mu_TPML_CCA;
+extern const MU_TYPE mu_TPML_ALG;
+extern const MU_TYPE mu_TPML_HANDLE;
+extern const MU_TYPE mu_TPML_DIGEST;
+extern const MU_TYPE mu_TPML_ALG_PROPERTY;
+extern const MU_TYPE mu_TPML_ECC_CURVE;
+extern const MU_TYPE mu_TPML_TAGGED_TPM_PROPERTY;
+extern const MU_TYPE mu_TPML_TAGGED_PCR_PROPERTY;
+extern const MU_TYPE mu_TPML_PCR_SELECTION;
+extern const MU_TYPE mu_TPML_DIGEST_VALUES;
+extern const MU_TYPE mu_TPML_INTEL_PTT_PROPERTY;
+extern const MU_TYPE mu_TPML_AC_CAPABILITIES;
+
+extern const MU_TYPE mu_TPMS_PCR_SELECT;
+extern const MU_TYPE mu_TPMS_PCR_SELECTION;
+extern const MU_TYPE mu_TPMS_TAGGED_PCR_SELECT;
+extern const MU_TYPE mu_TPMS_ALG_PROPERTY;
+extern const MU_TYPE mu_TPMS_ALGORITHM_DESCRIPTION;
+extern const MU_TYPE mu_TPMS_TAGGED_PROPERTY;
+extern const MU_TYPE mu_TPMS_CLOCK_INFO;
+extern const MU_TYPE mu_TPMS_TIME_INFO;
+extern const MU_TYPE mu_TPMS_TIME_ATTEST_INFO;
+extern const MU_TYPE mu_TPMS_CERTIFY_INFO;
+extern const MU_TYPE mu_TPMS_COMMAND_AUDIT_INFO;
+extern const MU_TYPE mu_TPMS_SESSION_AUDIT_INFO;
+extern const MU_TYPE mu_TPMS_CREATION_INFO;
+extern const MU_TYPE mu_TPMS_NV_CERTIFY_INFO;
+extern const MU_TYPE mu_TPMS_AUTH_COMMAND;
+extern const MU_TYPE mu_TPMS_AUTH_RESPONSE;
+extern const MU_TYPE mu_TPMS_SENSITIVE_CREATE;
+extern const MU_TYPE mu_TPMS_SCHEME_HASH;
+extern const MU_TYPE mu_TPMS_SCHEME_ECDAA;
+extern const MU_TYPE mu_TPMS_SCHEME_XOR;
+extern const MU_TYPE mu_TPMS_ECC_POINT;
+extern const MU_TYPE mu_TPMS_SIGNATURE_RSA;
+extern const MU_TYPE mu_TPMS_SIGNATURE_ECC;
+extern const MU_TYPE mu_TPMS_NV_PIN_COUNTER_PARAMETERS;
+extern const MU_TYPE mu_TPMS_NV_PUBLIC;
+extern const MU_TYPE mu_TPMS_CONTEXT_DATA;
+extern const MU_TYPE mu_TPMS_CONTEXT;
+extern const MU_TYPE mu_TPMS_QUOTE_INFO;
+extern const MU_TYPE mu_TPMS_CREATION_DATA;
+extern const MU_TYPE mu_TPMS_ECC_PARMS;
+extern const MU_TYPE mu_TPMS_ATTEST;
+extern const MU_TYPE mu_TPMS_ALGORITHM_DETAIL_ECC;
+extern const MU_TYPE mu_TPMS_CAPABILITY_DATA;
+extern const MU_TYPE mu_TPMS_KEYEDHASH_PARMS;
+extern const MU_TYPE mu_TPMS_RSA_PARMS;
+extern const MU_TYPE mu_TPMS_SYMCIPHER_PARMS;
+extern const MU_TYPE mu_TPMS_EMPTY;
+extern const MU_TYPE mu_TPMS_AC_OUTPUT;
+
+extern const MU_TYPE mu_TPMT_HA;
+extern const MU_TYPE mu_TPMT_SYM_DEF;
+extern const MU_TYPE mu_TPMT_SYM_DEF_OBJECT;
+extern const MU_TYPE mu_TPMT_KEYEDHASH_SCHEME;
+extern const MU_TYPE mu_TPMT_SIG_SCHEME;
+extern const MU_TYPE mu_TPMT_KDF_SCHEME;
+extern const MU_TYPE mu_TPMT_ASYM_SCHEME;
+extern const MU_TYPE mu_TPMT_RSA_SCHEME;
+extern const MU_TYPE mu_TPMT_RSA_DECRYPT;
+extern const MU_TYPE mu_TPMT_ECC_SCHEME;
+extern const MU_TYPE mu_TPMT_SIGNATURE;
+extern const MU_TYPE mu_TPMT_SENSITIVE;
+extern const MU_TYPE mu_TPMT_PUBLIC;
+extern const MU_TYPE mu_TPMT_PUBLIC_PARMS;
+extern const MU_TYPE mu_TPMT_TK_CREATION;
+extern const MU_TYPE mu_TPMT_TK_VERIFIED;
+extern const MU_TYPE mu_TPMT_TK_AUTH;
+extern const MU_TYPE mu_TPMT_TK_HASHCHECK;
+
+extern const MU_TYPE mu_TPMU_HA;
+extern const MU_TYPE mu_TPMU_CAPABILITIES;
+extern const MU_TYPE mu_TPMU_ATTEST;
+extern const MU_TYPE mu_TPMU_SYM_KEY_BITS;
+extern const MU_TYPE mu_TPMU_SYM_MODE;
+extern const MU_TYPE mu_TPMU_SIG_SCHEME;
+extern const MU_TYPE mu_TPMU_KDF_SCHEME;
+extern const MU_TYPE mu_TPMU_ASYM_SCHEME;
+extern const MU_TYPE mu_TPMU_SCHEME_KEYEDHASH;
+extern const MU_TYPE mu_TPMU_SIGNATURE;
+extern const MU_TYPE mu_TPMU_SENSITIVE_COMPOSITE;
+extern const MU_TYPE mu_TPMU_ENCRYPTED_SECRET;
+extern const MU_TYPE mu_TPMU_PUBLIC_ID;
+extern const MU_TYPE mu_TPMU_PUBLIC_PARMS;
+extern const MU_TYPE mu_TPMU_NAME;
+
+#endif /* MU_ENGINE_H */
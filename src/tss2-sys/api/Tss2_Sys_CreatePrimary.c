@@ -88,10 +88,6 @@ TSS2_RC Tss2_Sys_CreatePrimary_Prepare(
     if (rval)
         return rval;
 
-    ctx->decryptAllowed = 1;
-    ctx->encryptAllowed = 1;
-    ctx->authAllowed = 1;
-
     rval = CommonPrepareEpilogue(ctx);
     return rval;
 }
@@ -28,10 +28,6 @@ TSS2_RC Tss2_Sys_ECDH_KeyGen_Prepare(
     if (rval)
         return rval;
 
-    ctx->decryptAllowed = 0;
-    ctx->encryptAllowed = 1;
-    ctx->authAllowed = 1;
-
     return CommonPrepareEpilogue(ctx);
 }
 
@@ -28,10 +28,6 @@ TSS2_RC Tss2_Sys_EC_Ephemeral_Prepare(
     if (rval)
         return rval;
 
-    ctx->decryptAllowed = 0;
-    ctx->encryptAllowed = 1;
-    ctx->authAllowed = 1;
-
     return CommonPrepareEpilogue(ctx);
 }
 
@@ -49,6 +45,7 @@ TSS2_RC Tss2_Sys_EC_Ephemeral_Complete(
     rval = CommonComplete(ctx);
     if (rval)
         return rval;
+
     rval = Tss2_MU_TPM2B_ECC_POINT_Unmarshal(ctx->cmdBuffer,
                                              ctx->maxCmdSize,
                                              &ctx->nextData, Q);
@@ -24,6 +24,9 @@ TSS2_RC Tss2_Sys_ExecuteAsync(TSS2_SYS_CONTEXT *sysContext)
     if (ctx->previousStage != CMD_STAGE_PREPARE)
         return TSS2_SYS_RC_BAD_SEQUENCE;
 
+    /* A reserved authorization area that was never filled is dropped. */
+    CloseAuthGap(ctx);
+
     rval = Tss2_Tcti_Transmit(ctx->tctiContext,
                               HOST_TO_BE_32(req_header_from_cxt(ctx)->commandSize),
                               ctx->cmdBuffer);
@@ -136,3 +139,49 @@ TSS2_RC Tss2_Sys_Execute(TSS2_SYS_CONTEXT *sysContext)
 
     return Tss2_Sys_ExecuteFinish(sysContext, TSS2_TCTI_TIMEOUT_BLOCK);
 }
+
+/*
+ * Execute a batch of commands, each prepared in its own SYS context, in
+ * order and back-to-back. The TCTI only allows one command in flight, so
+ * every response is received before the next command is transmitted, but
+ * no preparation or completion work happens in between. The responses
+ * stay in their contexts and are completed by the caller afterwards.
+ *
+ * The batch stops at the first command that fails. *executed is set to
+ * the number of commands that succeeded, so sysContexts[*executed] is the
+ * command that failed.
+ */
+TSS2_RC Tss2_Sys_ExecuteBatch(
+    TSS2_SYS_CONTEXT *sysContexts[],
+    size_t count,
+    size_t *executed)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx;
+    TSS2_RC rval;
+    size_t i;
+
+    if (!sysContexts || !executed)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    *executed = 0;
+
+    /* Check the whole batch before anything is sent. */
+    for (i = 0; i < count; i++) {
+        ctx = syscontext_cast(sysContexts[i]);
+        if (!ctx)
+            return TSS2_SYS_RC_BAD_REFERENCE;
+
+        if (ctx->previousStage != CMD_STAGE_PREPARE)
+            return TSS2_SYS_RC_BAD_SEQUENCE;
+    }
+
+    for (i = 0; i < count; i++) {
+        rval = Tss2_Sys_Execute(sysContexts[i]);
+        if (rval)
+            return rval;
+
+        (*executed)++;
+    }
+
+    return TSS2_RC_SUCCESS;
+}
@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: BSD-2 */
+/***********************************************************************;
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ***********************************************************************/
+
+#include "tss2_tpm2_types.h"
+#include "tss2_mu.h"
+#include "sysapi_util.h"
+#include "util/tss2_endian.h"
+
+TSS2_RC Tss2_Sys_GetEncryptParamBuffer(
+    TSS2_SYS_CONTEXT *sysContext,
+    size_t *encryptParamSize,
+    uint8_t **encryptParamBuffer)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast(sysContext);
+    uint8_t *offset;
+    size_t size;
+
+    if (!encryptParamSize || !encryptParamBuffer || !ctx)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    if (ctx->previousStage != CMD_STAGE_RECEIVE_RESPONSE)
+        return TSS2_SYS_RC_BAD_SEQUENCE;
+
+    if (ctx->encryptAllowed == 0 ||
+        BE_TO_HOST_16(resp_header_from_cxt(ctx)->tag) == TPM2_ST_NO_SESSIONS)
+        return TSS2_SYS_RC_NO_ENCRYPT_PARAM;
+
+    /* Get first parameter, interpret it as a TPM2B and return its size field
+     * and a writable pointer to its buffer area, so that it can be decrypted
+     * in place inside the response buffer. */
+    offset = ctx->cmdBuffer
+            + sizeof(TPM20_Header_Out)
+            + ctx->numResponseHandles * sizeof(TPM2_HANDLE)
+            + sizeof(TPM2_PARAMETER_SIZE);
+
+    size = BE_TO_HOST_16(*((UINT16 *)offset));
+    if (offset + sizeof(UINT16) + size >
+        ctx->cmdBuffer + BE_TO_HOST_32(resp_header_from_cxt(ctx)->responseSize))
+        return TSS2_SYS_RC_MALFORMED_RESPONSE;
+
+    *encryptParamSize = size;
+    *encryptParamBuffer = offset + sizeof(UINT16);
+
+    return TSS2_RC_SUCCESS;
+}
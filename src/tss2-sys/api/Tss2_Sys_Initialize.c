@@ -58,6 +58,7 @@ TSS2_RC Tss2_Sys_Initialize(
     ctx->tctiContext = tctiContext;
     InitSysContextPtrs(ctx, contextSize);
     InitSysContextFields(ctx);
+    ctx->reservedAuthSize = 0;
     ctx->previousStage = CMD_STAGE_INITIALIZE;
 
     return TSS2_RC_SUCCESS;
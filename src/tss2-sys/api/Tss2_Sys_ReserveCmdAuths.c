@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: BSD-2 */
+/***********************************************************************;
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ***********************************************************************/
+
+#include "tss2_tpm2_types.h"
+#include "tss2_mu.h"
+#include "sysapi_util.h"
+
+TSS2_RC Tss2_Sys_ReserveCmdAuths(
+    TSS2_SYS_CONTEXT *sysContext,
+    const TSS2L_SYS_AUTH_COMMAND *cmdAuthsLayout)
+{
+    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast(sysContext);
+    UINT32 authSize;
+    TSS2_RC rval;
+
+    if (!ctx)
+        return TSS2_SYS_RC_BAD_REFERENCE;
+
+    if (!cmdAuthsLayout || !cmdAuthsLayout->count) {
+        ctx->reservedAuthSize = 0;
+        return TSS2_RC_SUCCESS;
+    }
+
+    if (cmdAuthsLayout->count > TPM2_MAX_SESSION_NUM)
+        return TSS2_SYS_RC_BAD_VALUE;
+
+    /* Only the count and the nonce and hmac sizes of the layout are used.
+     * The next Prepare leaves a gap of this size in front of the parameters,
+     * which Tss2_Sys_SetCmdAuths fills if its authorizations match. */
+    rval = GetCmdAuthsSize(cmdAuthsLayout, &authSize);
+    if (rval) {
+        ctx->reservedAuthSize = 0;
+        return rval;
+    }
+    ctx->reservedAuthSize = authSize + sizeof(UINT32);
+
+    return TSS2_RC_SUCCESS;
+}
@@ -36,19 +36,22 @@ TSS2_RC Tss2_Sys_SetCmdAuths(
 
     ctx->authsCount = 0;
 
-    if (!cmdAuthsArray->count)
+    if (!cmdAuthsArray->count) {
+        CloseAuthGap(ctx);
+        return rval;
+    }
+
+    /* Calculate size needed for authorization area. */
+    rval = GetCmdAuthsSize(cmdAuthsArray, &authSize);
+    if (rval)
         return rval;
 
     req_header_from_cxt(ctx)->tag = HOST_TO_BE_16(TPM2_ST_SESSIONS);
 
-    /* Calculate size needed for authorization area, check for any null
-     * pointers, and check for decrypt/encrypt sessions. */
-    for (i = 0; i < cmdAuthsArray->count; i++) {
-        authSize += sizeof(TPMI_SH_AUTH_SESSION);
-        authSize += sizeof(UINT16) + cmdAuthsArray->auths[i].nonce.size;
-        authSize += sizeof(UINT8);
-        authSize += sizeof(UINT16) + cmdAuthsArray->auths[i].hmac.size;
-    }
+    /* Fall back to moving the parameters if the area reserved by
+     * Tss2_Sys_ReserveCmdAuths does not fit exactly. */
+    if (ctx->authGapSize != authSize + sizeof(UINT32))
+        CloseAuthGap(ctx);
 
     newCmdSize = authSize;
     newCmdSize += sizeof(UINT32); /* authorization size field */
@@ -60,11 +63,16 @@ TSS2_RC Tss2_Sys_SetCmdAuths(
     if (ctx->cpBufferUsedSize > ctx->maxCmdSize)
         return TSS2_SYS_RC_INSUFFICIENT_CONTEXT;
 
-    /* We're going to have to move stuff around.
-     * First move current cpBuffer down by the auth area size. */
-    memmove(ctx->cpBuffer + authSize + sizeof(UINT32),
-            ctx->cpBuffer, ctx->cpBufferUsedSize);
-
+    if (ctx->authGapSize) {
+        /* The authorization area is written into the reserved gap. */
+        ctx->cpBuffer -= ctx->authGapSize;
+        ctx->authGapSize = 0;
+    } else {
+        /* We're going to have to move stuff around.
+         * First move current cpBuffer down by the auth area size. */
+        memmove(ctx->cpBuffer + authSize + sizeof(UINT32),
+                ctx->cpBuffer, ctx->cpBufferUsedSize);
+    }
 
     /* Reset the auth size field */
     *(UINT32 *)ctx->cpBuffer = 0;
@@ -37,7 +37,7 @@ TSS2_RC Tss2_Sys_SetDecryptParam(
         return TSS2_SYS_RC_BAD_VALUE;
 
     if (BE_TO_HOST_32(req_header_from_cxt(ctx)->commandSize) +
-        param_size > ctx->maxCmdSize)
+        ctx->authGapSize + param_size > ctx->maxCmdSize)
         return TSS2_SYS_RC_INSUFFICIENT_CONTEXT;
 
     rval = Tss2_Sys_GetDecryptParam(sysContext, &curr_param_size,
@@ -11,6 +11,7 @@
 #include "tss2_mu.h"
 #include "sysapi_util.h"
 #include "util/tss2_endian.h"
+#include "util/cc-attributes.h"
 
 void InitSysContextFields(_TSS2_SYS_CONTEXT_BLOB *ctx)
 {
@@ -19,6 +20,7 @@ void InitSysContextFields(_TSS2_SYS_CONTEXT_BLOB *ctx)
     ctx->decryptNull = 0;
     ctx->authAllowed = 0;
     ctx->nextData = 0;
+    ctx->authGapSize = 0;
 }
 
 void InitSysContextPtrs(
@@ -58,7 +60,7 @@ TSS2_RC CommonPreparePrologue(
     _TSS2_SYS_CONTEXT_BLOB *ctx,
     TPM2_CC commandCode)
 {
-    int numCommandHandles;
+    const CC_ATTRIBUTES *attributes;
     TSS2_RC rval;
 
     if (!ctx)
@@ -76,26 +78,82 @@ TSS2_RC CommonPreparePrologue(
     if (rval)
         return rval;
 
+    /* Leave room for the declared authorization area in front of the
+     * handles. CommonPrepareEpilogue moves the handles down, so that the
+     * gap ends up between the handle and the parameter area. */
+    ctx->authGapSize = ctx->reservedAuthSize;
+    ctx->reservedAuthSize = 0;
+    ctx->nextData += ctx->authGapSize;
+
+    attributes = cc_attributes(commandCode);
     ctx->commandCode = commandCode;
-    ctx->numResponseHandles = GetNumResponseHandles(commandCode);
+    ctx->numResponseHandles = attributes->responseHandles;
     ctx->rspParamsSize = (UINT32 *)(ctx->cmdBuffer + sizeof(TPM20_Header_Out) +
-                         (GetNumResponseHandles(commandCode) * sizeof(UINT32)));
+                         (attributes->responseHandles * sizeof(UINT32)));
 
-    numCommandHandles = GetNumCommandHandles(commandCode);
     ctx->cpBuffer = ctx->cmdBuffer + ctx->nextData +
-                                     (numCommandHandles * sizeof(UINT32));
+                    (attributes->commandHandles * sizeof(UINT32));
     return rval;
 }
 
 TSS2_RC CommonPrepareEpilogue(_TSS2_SYS_CONTEXT_BLOB *ctx)
 {
+    const CC_ATTRIBUTES *attributes = cc_attributes(ctx->commandCode);
+    UINT8 *handles = ctx->cmdBuffer + sizeof(TPM20_Header_In);
+    size_t handlesSize;
+
+    /* Only a completely prepared command exposes its parameters for
+     * encryption and accepts an authorization area. */
+    ctx->decryptAllowed = attributes->decryptAllowed;
+    ctx->encryptAllowed = attributes->encryptAllowed;
+    ctx->authAllowed = attributes->authAllowed;
+
     ctx->cpBufferUsedSize = ctx->cmdBuffer + ctx->nextData - ctx->cpBuffer;
-    req_header_from_cxt(ctx)->commandSize = HOST_TO_BE_32(ctx->nextData);
+    if (ctx->authGapSize) {
+        handlesSize = ctx->cpBuffer - handles - ctx->authGapSize;
+        memmove(handles, handles + ctx->authGapSize, handlesSize);
+        if (!ctx->authAllowed)
+            CloseAuthGap(ctx);
+    }
+    /* An open gap is not part of the command until it is filled. */
+    req_header_from_cxt(ctx)->commandSize =
+        HOST_TO_BE_32(ctx->nextData - ctx->authGapSize);
     ctx->previousStage = CMD_STAGE_PREPARE;
 
     return TSS2_RC_SUCCESS;
 }
 
+TSS2_RC GetCmdAuthsSize(
+    const TSS2L_SYS_AUTH_COMMAND *cmdAuthsArray,
+    UINT32 *authSize)
+{
+    size_t size, total = 0;
+    uint8_t i;
+    TSS2_RC rval;
+
+    for (i = 0; i < cmdAuthsArray->count; i++) {
+        rval = Tss2_MU_TPMS_AUTH_COMMAND_Size(&cmdAuthsArray->auths[i],
+                                              &size);
+        if (rval)
+            return rval;
+        total += size;
+    }
+    *authSize = (UINT32)total;
+    return TSS2_RC_SUCCESS;
+}
+
+void CloseAuthGap(_TSS2_SYS_CONTEXT_BLOB *ctx)
+{
+    if (!ctx->authGapSize)
+        return;
+
+    memmove(ctx->cpBuffer - ctx->authGapSize, ctx->cpBuffer,
+            ctx->cpBufferUsedSize);
+    ctx->cpBuffer -= ctx->authGapSize;
+    ctx->nextData -= ctx->authGapSize;
+    ctx->authGapSize = 0;
+}
+
 TSS2_RC CommonComplete(_TSS2_SYS_CONTEXT_BLOB *ctx)
 {
     UINT32 rspSize;
@@ -160,147 +218,12 @@ TSS2_RC CommonOneCall(
     return rval;
 }
 
-COMMAND_HANDLES commandArray[] =
-{
-    { TPM2_CC_Startup, 0, 0 },
-    { TPM2_CC_Shutdown, 0, 0 },
-    { TPM2_CC_SelfTest, 0, 0 },
-    { TPM2_CC_IncrementalSelfTest, 0, 0 },
-    { TPM2_CC_GetTestResult, 0, 0 },
-    { TPM2_CC_StartAuthSession, 2, 1 },
-    { TPM2_CC_PolicyRestart, 1, 0 },
-    { TPM2_CC_Create, 1, 0 },
-    { TPM2_CC_Load, 1, 1 },
-    { TPM2_CC_LoadExternal, 0, 1 },
-    { TPM2_CC_ReadPublic, 1, 0 },
-    { TPM2_CC_ActivateCredential, 2, 0 },
-    { TPM2_CC_MakeCredential, 1, 0 },
-    { TPM2_CC_Unseal, 1, 0 },
-    { TPM2_CC_ObjectChangeAuth, 2, 0 },
-    { TPM2_CC_Duplicate, 2, 0 },
-    { TPM2_CC_Rewrap, 2, 0 },
-    { TPM2_CC_Import, 1, 0 },
-    { TPM2_CC_RSA_Encrypt, 1, 0 },
-    { TPM2_CC_RSA_Decrypt, 1, 0 },
-    { TPM2_CC_ECDH_KeyGen, 1, 0 },
-    { TPM2_CC_ECDH_ZGen, 1, 0 },
-    { TPM2_CC_ECC_Parameters, 0, 0 },
-    { TPM2_CC_ZGen_2Phase, 1, 0 },
-    { TPM2_CC_EncryptDecrypt, 1, 0 },
-    { TPM2_CC_EncryptDecrypt2, 1, 0 },
-    { TPM2_CC_Hash, 0, 0 },
-    { TPM2_CC_HMAC, 1, 0 },
-    { TPM2_CC_GetRandom, 0, 0 },
-    { TPM2_CC_StirRandom, 0, 0 },
-    { TPM2_CC_HMAC_Start, 1, 1 },
-    { TPM2_CC_HashSequenceStart, 0, 1 },
-    { TPM2_CC_SequenceUpdate, 1, 0 },
-    { TPM2_CC_SequenceComplete, 1, 0 },
-    { TPM2_CC_EventSequenceComplete, 2, 0 },
-    { TPM2_CC_Certify, 2, 0 },
-    { TPM2_CC_CertifyCreation, 2, 0 },
-    { TPM2_CC_Quote, 1, 0 },
-    { TPM2_CC_GetSessionAuditDigest, 3, 0 },
-    { TPM2_CC_GetCommandAuditDigest, 2, 0 },
-    { TPM2_CC_GetTime, 2, 0 },
-    { TPM2_CC_Commit, 1, 0 },
-    { TPM2_CC_EC_Ephemeral, 0, 0 },
-    { TPM2_CC_VerifySignature, 1, 0 },
-    { TPM2_CC_Sign, 1, 0 },
-    { TPM2_CC_SetCommandCodeAuditStatus, 1, 0 },
-    { TPM2_CC_PCR_Extend, 1, 0 },
-    { TPM2_CC_PCR_Event, 1, 0 },
-    { TPM2_CC_PCR_Read, 0, 0 },
-    { TPM2_CC_PCR_Allocate, 1, 0 },
-    { TPM2_CC_PCR_SetAuthPolicy, 1, 0 },
-    { TPM2_CC_PCR_SetAuthValue, 1, 0 },
-    { TPM2_CC_PCR_Reset, 1, 0 },
-    { TPM2_CC_PolicySigned, 2, 0 },
-    { TPM2_CC_PolicySecret, 2, 0 },
-    { TPM2_CC_PolicyTicket, 1, 0 },
-    { TPM2_CC_PolicyOR, 1, 0 },
-    { TPM2_CC_PolicyPCR, 1, 0 },
-    { TPM2_CC_PolicyLocality, 1, 0 },
-    { TPM2_CC_PolicyNV, 3, 0 },
-    { TPM2_CC_PolicyNvWritten, 1, 0 },
-    { TPM2_CC_PolicyCounterTimer, 1, 0 },
-    { TPM2_CC_PolicyCommandCode, 1, 0 },
-    { TPM2_CC_PolicyPhysicalPresence, 1, 0 },
-    { TPM2_CC_PolicyCpHash, 1, 0 },
-    { TPM2_CC_PolicyNameHash, 1, 0 },
-    { TPM2_CC_PolicyDuplicationSelect, 1, 0 },
-    { TPM2_CC_PolicyAuthorize, 1, 0 },
-    { TPM2_CC_PolicyAuthValue, 1, 0 },
-    { TPM2_CC_PolicyPassword, 1, 0 },
-    { TPM2_CC_PolicyGetDigest, 1, 0 },
-    { TPM2_CC_PolicyTemplate, 1, 0 },
-    { TPM2_CC_CreatePrimary, 1, 1 },
-    { TPM2_CC_HierarchyControl, 1, 0 },
-    { TPM2_CC_SetPrimaryPolicy, 1, 0 },
-    { TPM2_CC_ChangePPS, 1, 0 },
-    { TPM2_CC_ChangeEPS, 1, 0 },
-    { TPM2_CC_Clear, 1, 0 },
-    { TPM2_CC_ClearControl, 1, 0 },
-    { TPM2_CC_HierarchyChangeAuth, 1, 0 },
-    { TPM2_CC_DictionaryAttackLockReset, 1, 0 },
-    { TPM2_CC_DictionaryAttackParameters, 1, 0 },
-    { TPM2_CC_PP_Commands, 1, 0 },
-    { TPM2_CC_SetAlgorithmSet, 1, 0 },
-    { TPM2_CC_FieldUpgradeStart, 2, 0 },
-    { TPM2_CC_FieldUpgradeData, 0, 0 },
-    { TPM2_CC_FirmwareRead, 0, 0 },
-    { TPM2_CC_ContextSave, 1, 0 },
-    { TPM2_CC_ContextLoad, 0, 1 },
-    { TPM2_CC_FlushContext, 1, 0 },
-    { TPM2_CC_EvictControl, 2, 0 },
-    { TPM2_CC_ReadClock, 0, 0 },
-    { TPM2_CC_ClockSet, 1, 0 },
-    { TPM2_CC_ClockRateAdjust, 1, 0 },
-    { TPM2_CC_GetCapability, 0, 0 },
-    { TPM2_CC_TestParms, 0, 0 },
-    { TPM2_CC_NV_DefineSpace, 1, 0 },
-    { TPM2_CC_NV_UndefineSpace, 2, 0 },
-    { TPM2_CC_NV_UndefineSpaceSpecial, 2, 0 },
-    { TPM2_CC_NV_ReadPublic, 1, 0 },
-    { TPM2_CC_NV_Write, 2, 0 },
-    { TPM2_CC_NV_Increment, 2, 0 },
-    { TPM2_CC_NV_Extend, 2, 0 },
-    { TPM2_CC_NV_SetBits, 2, 0 },
-    { TPM2_CC_NV_WriteLock, 2, 0 },
-    { TPM2_CC_NV_GlobalWriteLock, 1, 0 },
-    { TPM2_CC_NV_Read, 2, 0 },
-    { TPM2_CC_NV_ReadLock, 2, 0 },
-    { TPM2_CC_NV_ChangeAuth, 1, 0 },
-    { TPM2_CC_NV_Certify, 3, 0 },
-    { TPM2_CC_CreateLoaded, 1, 1 },
-    { TPM2_CC_PolicyAuthorizeNV, 3, 0 },
-    { TPM2_CC_AC_GetCapability, 1, 0 },
-    { TPM2_CC_AC_Send, 3, 0 },
-    { TPM2_CC_Policy_AC_SendSelect, 1, 0 }
-};
-
-static int GetNumHandles(TPM2_CC commandCode, bool req)
-{
-    uint8_t i;
-
-    for (i = 0; i < sizeof(commandArray) / sizeof(COMMAND_HANDLES); i++) {
-        if (commandCode == commandArray[i].commandCode) {
-            if (req)
-                return commandArray[i].numCommandHandles;
-            else
-                return commandArray[i].numResponseHandles;
-        }
-    }
-
-    return 0;
-}
-
 int GetNumCommandHandles(TPM2_CC commandCode)
 {
-    return GetNumHandles(commandCode, 1);
+    return cc_attributes(commandCode)->commandHandles;
 }
 
 int GetNumResponseHandles(TPM2_CC commandCode)
 {
-    return GetNumHandles(commandCode, 0);
+    return cc_attributes(commandCode)->responseHandles;
 }
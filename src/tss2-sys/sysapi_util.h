@@ -62,6 +62,13 @@ typedef struct {
 
     /* Offset to next data in command/response buffer. */
     size_t nextData;
+
+    /* Size of the authorization area (including its size field) declared
+     * by Tss2_Sys_ReserveCmdAuths for the next Prepare. */
+    UINT32 reservedAuthSize;
+    /* Size of the unused gap reserved for the authorization area between
+     * the handle area and cpBuffer. */
+    UINT32 authGapSize;
 } _TSS2_SYS_CONTEXT_BLOB;
 
 struct TSS2_SYS_CONTEXT;
@@ -84,12 +91,6 @@ req_header_from_cxt(_TSS2_SYS_CONTEXT_BLOB *ctx)
     return (TPM20_Header_In *)ctx->cmdBuffer;
 }
 
-typedef struct {
-    TPM2_CC commandCode;
-    int numCommandHandles;
-    int numResponseHandles;
-} COMMAND_HANDLES;
-
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -111,6 +112,10 @@ TSS2_RC CommonPreparePrologue(
     TPM2_CC commandCode);
 
 TSS2_RC CommonPrepareEpilogue(_TSS2_SYS_CONTEXT_BLOB *ctx);
+TSS2_RC GetCmdAuthsSize(
+    const TSS2L_SYS_AUTH_COMMAND *cmdAuthsArray,
+    UINT32 *authSize);
+void CloseAuthGap(_TSS2_SYS_CONTEXT_BLOB *ctx);
 int GetNumCommandHandles(TPM2_CC commandCode);
 int GetNumResponseHandles(TPM2_CC commandCode);
 
@@ -13,6 +13,7 @@
 
 #ifndef _WIN32
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 #endif
 
@@ -134,17 +135,19 @@ send_sim_session_end (
 }
 
 /*
- * This function is used to send the simulator a sort of command message
- * that tells it we're about to send it a TPM command. This requires that
- * we first send it a 4 byte code that's defined by the simulator. Then
- * another byte identifying the locality and finally the size of the TPM
- * command buffer that we're about to send. After these 9 bytes are sent
- * the simulator will accept a TPM command buffer.
+ * This function is used to send the simulator a TPM command. The simulator
+ * expects a sort of command message that tells it we're about to send it a
+ * TPM command. This requires that we first send it a 4 byte code that's
+ * defined by the simulator. Then another byte identifying the locality and
+ * finally the size of the TPM command buffer that we're about to send.
+ * After these 9 bytes the simulator accepts the TPM command buffer. Both
+ * are sent with a single vectored write.
  */
 #define SIM_CMD_SIZE (sizeof (UINT32) + sizeof (UINT8) + sizeof (UINT32))
 TSS2_RC
-send_sim_cmd_setup (
+send_sim_cmd (
     TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim,
+    const uint8_t *cmd_buf,
     UINT32 size)
 {
     if (!tcti_mssim) return TSS2_TCTI_RC_BAD_REFERENCE;
@@ -152,6 +155,7 @@ send_sim_cmd_setup (
     TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_mssim_down_cast (tcti_mssim);
     uint8_t buf [SIM_CMD_SIZE] = { 0 };
     size_t offset = 0;
+    struct iovec iov [2];
     TSS2_RC rc;
 
     rc = Tss2_MU_UINT32_Marshal (MS_SIM_TPM_SEND_COMMAND,
@@ -175,7 +179,11 @@ send_sim_cmd_setup (
         return rc;
     }
 
-    return socket_xmit_buf (tcti_mssim->tpm_sock, buf, sizeof (buf));
+    iov [0].iov_base = buf;
+    iov [0].iov_len = sizeof (buf);
+    iov [1].iov_base = (void*)cmd_buf;
+    iov [1].iov_len = size;
+    return socket_xmit_bufv (tcti_mssim->tpm_sock, iov, 2);
 }
 
 TSS2_RC
@@ -208,11 +216,7 @@ tcti_mssim_transmit (
 
     LOG_DEBUG ("Sending command with TPM_CC 0x%" PRIx32 " and size %" PRIu32,
                header.code, header.size);
-    rc = send_sim_cmd_setup (tcti_mssim, header.size);
-    if (rc != TSS2_RC_SUCCESS) {
-        return rc;
-    }
-    rc = socket_xmit_buf (tcti_mssim->tpm_sock, cmd_buf, size);
+    rc = send_sim_cmd (tcti_mssim, cmd_buf, header.size);
     if (rc != TSS2_RC_SUCCESS) {
         return rc;
     }
@@ -269,16 +273,45 @@ tcti_mssim_set_locality (
     return TSS2_RC_SUCCESS;
 }
 
+/*
+ * The simulator protocol is carried over the TPM socket alone, so this is
+ * the only handle the caller needs to poll for a response.
+ */
 TSS2_RC
 tcti_mssim_get_poll_handles (
     TSS2_TCTI_CONTEXT *tctiContext,
     TSS2_TCTI_POLL_HANDLE *handles,
     size_t *num_handles)
 {
+#ifdef _WIN32
     (void)(tctiContext);
     (void)(handles);
     (void)(num_handles);
     return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+#else
+    TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim = tcti_mssim_context_cast (tctiContext);
+
+    if (tcti_mssim == NULL) {
+        return TSS2_TCTI_RC_BAD_CONTEXT;
+    }
+    if (num_handles == NULL) {
+        return TSS2_TCTI_RC_BAD_REFERENCE;
+    }
+    if (handles == NULL) {
+        *num_handles = 1;
+        return TSS2_RC_SUCCESS;
+    }
+    if (*num_handles < 1) {
+        *num_handles = 1;
+        return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+    }
+
+    *num_handles = 1;
+    handles->fd = tcti_mssim->tpm_sock;
+    handles->events = POLLIN;
+    handles->revents = 0;
+    return TSS2_RC_SUCCESS;
+#endif
 }
 
 void
@@ -296,6 +329,98 @@ tcti_mssim_finalize(
     socket_close (&tcti_mssim->tpm_sock);
 }
 
+/*
+ * Return a monotonic timestamp in milliseconds, used to bound the total
+ * time spent in 'tcti_mssim_receive'.
+ */
+static int64_t
+tcti_mssim_now_ms (void)
+{
+#ifdef _WIN32
+    return (int64_t) GetTickCount64 ();
+#else
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+/*
+ * This function receives one part of the response into the 'iovcnt'
+ * (at most MSSIM_RECV_IOV_MAX) buffers of 'iov', continuing after the
+ * 'recv_offset' bytes received by previous calls. Unless 'timeout' is
+ * TSS2_TCTI_TIMEOUT_BLOCK it waits for data until 'deadline' (as returned by
+ * 'tcti_mssim_now_ms') and returns TSS2_TCTI_RC_TRY_AGAIN if the part is not
+ * complete by then, leaving 'recv_offset' set so that the next call resumes
+ * where this one stopped.
+ */
+#define MSSIM_RECV_IOV_MAX 2
+static TSS2_RC
+tcti_mssim_receive_part (
+    TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim,
+    const struct iovec *iov,
+    int iovcnt,
+    int32_t timeout,
+    int64_t deadline)
+{
+    struct iovec rest [MSSIM_RECV_IOV_MAX];
+    int restcnt;
+    size_t size = 0, skip;
+    int64_t remaining;
+    TSS2_RC rc;
+    ssize_t ret;
+
+    for (int i = 0; i < iovcnt; i++) {
+        size += iov [i].iov_len;
+    }
+    while (tcti_mssim->recv_offset < size) {
+        if (timeout != TSS2_TCTI_TIMEOUT_BLOCK) {
+            remaining = deadline - tcti_mssim_now_ms ();
+            rc = socket_poll (tcti_mssim->tpm_sock,
+                              remaining > 0 ? (int) remaining : 0);
+            if (rc != TSS2_RC_SUCCESS) {
+                return rc;
+            }
+        }
+        /* Leave out the bytes received by previous reads */
+        skip = tcti_mssim->recv_offset;
+        restcnt = 0;
+        for (int i = 0; i < iovcnt; i++) {
+            if (skip >= iov [i].iov_len) {
+                skip -= iov [i].iov_len;
+                continue;
+            }
+            rest [restcnt].iov_base = (uint8_t*)iov [i].iov_base + skip;
+            rest [restcnt].iov_len = iov [i].iov_len - skip;
+            restcnt++;
+            skip = 0;
+        }
+        ret = socket_recv_partialv (tcti_mssim->tpm_sock, rest, restcnt);
+        if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return TSS2_TCTI_RC_TRY_AGAIN;
+        }
+        if (ret <= 0) {
+            LOG_ERROR ("Failed to receive %zu bytes from the simulator, "
+                       "got %zu", size, tcti_mssim->recv_offset);
+            return TSS2_TCTI_RC_IO_ERROR;
+        }
+        tcti_mssim->recv_offset += ret;
+    }
+    tcti_mssim->recv_offset = 0;
+
+    return TSS2_RC_SUCCESS;
+}
+
+/*
+ * The response is received in two parts: the size prefix, and the TPM
+ * response together with the four bytes of 0's appended by the simulator.
+ * With a 'timeout' other than TSS2_TCTI_TIMEOUT_BLOCK this function returns
+ * TSS2_TCTI_RC_TRY_AGAIN when the response is not complete yet. The caller
+ * then waits for the handle from 'tcti_mssim_get_poll_handles' and calls
+ * this function again with the same response buffer. The 'timeout' bounds
+ * the whole call, not each read from the socket.
+ */
 TSS2_RC
 tcti_mssim_receive (
     TSS2_TCTI_CONTEXT *tctiContext,
@@ -305,9 +430,9 @@ tcti_mssim_receive (
 {
     TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim = tcti_mssim_context_cast (tctiContext);
     TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_mssim_down_cast (tcti_mssim);
+    struct iovec iov [MSSIM_RECV_IOV_MAX];
+    int64_t deadline = 0;
     TSS2_RC rc;
-    UINT32 trash;
-    int ret;
 
     if (tcti_mssim == NULL) {
         return TSS2_TCTI_RC_BAD_CONTEXT;
@@ -317,23 +442,28 @@ tcti_mssim_receive (
         return rc;
     }
 
-    if (timeout != TSS2_TCTI_TIMEOUT_BLOCK) {
-        LOG_WARNING ("Asynchronous I/O not implemented. The 'timeout' "
-                     "parameter must be TSS2_TCTI_TIMEOUT_BLOCK.");
+    if (timeout < TSS2_TCTI_TIMEOUT_BLOCK) {
+        LOG_WARNING ("The 'timeout' parameter must be TSS2_TCTI_TIMEOUT_BLOCK "
+                     "or a number of milliseconds.");
         return TSS2_TCTI_RC_BAD_VALUE;
     }
+    if (timeout != TSS2_TCTI_TIMEOUT_BLOCK) {
+        deadline = tcti_mssim_now_ms () + timeout;
+    }
 
-    if (tcti_common->header.size == 0) {
+    if (tcti_mssim->recv_state == MSSIM_RECV_SIZE) {
         /* Receive the size of the response. */
-        uint8_t size_buf [sizeof (UINT32)] = {0};
-        ret = socket_recv_buf (tcti_mssim->tpm_sock, size_buf, sizeof (UINT32));
-        if (ret != sizeof (UINT32)) {
-            rc = TSS2_TCTI_RC_IO_ERROR;
+        iov [0].iov_base = tcti_mssim->recv_size;
+        iov [0].iov_len = sizeof (tcti_mssim->recv_size);
+        rc = tcti_mssim_receive_part (tcti_mssim, iov, 1, timeout, deadline);
+        if (rc == TSS2_TCTI_RC_TRY_AGAIN) {
+            return rc;
+        } else if (rc != TSS2_RC_SUCCESS) {
             goto out;
         }
 
-        rc = Tss2_MU_UINT32_Unmarshal (size_buf,
-                                       sizeof (size_buf),
+        rc = Tss2_MU_UINT32_Unmarshal (tcti_mssim->recv_size,
+                                       sizeof (tcti_mssim->recv_size),
                                        0,
                                        &tcti_common->header.size);
         if (rc != TSS2_RC_SUCCESS) {
@@ -343,10 +473,11 @@ tcti_mssim_receive (
         }
 
         LOG_DEBUG ("response size: %" PRIu32, tcti_common->header.size);
+        tcti_mssim->recv_state = MSSIM_RECV_BODY;
     }
 
-    *response_size = tcti_common->header.size;
     if (response_buffer == NULL) {
+        *response_size = tcti_common->header.size;
         return TSS2_RC_SUCCESS;
     }
 
@@ -354,28 +485,23 @@ tcti_mssim_receive (
         *response_size = tcti_common->header.size;
         return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
     }
+    *response_size = tcti_common->header.size;
 
-    /* Receive the TPM response. */
+    /* Receive the TPM response and the appended four bytes of 0's */
     LOG_DEBUG ("Reading response of size %" PRIu32, tcti_common->header.size);
-    ret = socket_recv_buf (tcti_mssim->tpm_sock,
-                           (unsigned char *)response_buffer,
-                           tcti_common->header.size);
-    if (ret < (ssize_t)tcti_common->header.size) {
-        rc = TSS2_TCTI_RC_IO_ERROR;
+    iov [0].iov_base = response_buffer;
+    iov [0].iov_len = tcti_common->header.size;
+    iov [1].iov_base = tcti_mssim->recv_trailer;
+    iov [1].iov_len = sizeof (tcti_mssim->recv_trailer);
+    rc = tcti_mssim_receive_part (tcti_mssim, iov, 2, timeout, deadline);
+    if (rc == TSS2_TCTI_RC_TRY_AGAIN) {
+        return rc;
+    } else if (rc != TSS2_RC_SUCCESS) {
         goto out;
     }
     LOGBLOB_DEBUG(response_buffer, tcti_common->header.size,
                   "Response buffer received:");
 
-    /* Receive the appended four bytes of 0's */
-    ret = socket_recv_buf (tcti_mssim->tpm_sock,
-                           (unsigned char *)&trash,
-                           4);
-    if (ret != 4) {
-        rc = TSS2_TCTI_RC_IO_ERROR;
-        goto out;
-    }
-
     if (tcti_mssim->cancel) {
         rc = tcti_platform_command (tctiContext, MS_SIM_CANCEL_OFF);
         tcti_mssim->cancel = 0;
@@ -387,6 +513,8 @@ tcti_mssim_receive (
      */
 out:
     tcti_common->header.size = 0;
+    tcti_mssim->recv_state = MSSIM_RECV_SIZE;
+    tcti_mssim->recv_offset = 0;
     tcti_common->state = TCTI_STATE_TRANSMIT;
 
     return rc;
@@ -550,6 +678,9 @@ Tss2_Tcti_Mssim_Init (
 
     tcti_mssim->tpm_sock = -1;
     tcti_mssim->platform_sock = -1;
+    tcti_mssim->cancel = 0;
+    tcti_mssim->recv_state = MSSIM_RECV_SIZE;
+    tcti_mssim->recv_offset = 0;
 
     rc = socket_connect (mssim_conf.host,
                          mssim_conf.port,
@@ -31,6 +31,18 @@ typedef struct {
     uint16_t port;
 } mssim_conf_t;
 
+/*
+ * The simulator prefixes every response with its size and appends four
+ * bytes of 0's. These are the parts of a response in the order they are
+ * received: the size, then the TPM response together with the 0's. A
+ * non-blocking receive that runs out of data remembers the part and the
+ * number of bytes of it already received and resumes from there.
+ */
+typedef enum {
+    MSSIM_RECV_SIZE,
+    MSSIM_RECV_BODY,
+} mssim_recv_state_t;
+
 typedef struct {
     TSS2_TCTI_COMMON_CONTEXT common;
     SOCKET platform_sock;
@@ -39,6 +51,11 @@ typedef struct {
  * This is a temporary flag, which will be changed into
  * a tcti state when support for asynch operation will be added */
     bool cancel;
+    /* Progress of the response currently being received */
+    mssim_recv_state_t recv_state;
+    size_t recv_offset;
+    uint8_t recv_size [sizeof (UINT32)];
+    uint8_t recv_trailer [sizeof (UINT32)];
 } TSS2_TCTI_MSSIM_CONTEXT;
 
 #endif /* TCTI_MSSIM_H */
@@ -0,0 +1,161 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ */
+#include <stddef.h>
+
+#include "tss2_tpm2_types.h"
+
+#include "util/cc-attributes.h"
+
+#define CC_ENTRY(cc, cmd, rsp, dec, enc, auth) \
+    [TPM2_CC_##cc - TPM2_CC_FIRST] = { cmd, rsp, dec, enc, auth }
+
+/*
+ * Command attributes indexed by command code, in the order of the codes.
+ * Columns: command handles, response handles, decrypt, encrypt, auth.
+ * Codes without a command (0x123, 0x15a, 0x15f, 0x166, 0x175) stay zero.
+ */
+static const CC_ATTRIBUTES cc_table[TPM2_CC_LAST - TPM2_CC_FIRST + 1] = {
+    CC_ENTRY(NV_UndefineSpaceSpecial,    2, 0, 0, 0, 1),
+    CC_ENTRY(EvictControl,               2, 0, 0, 0, 1),
+    CC_ENTRY(HierarchyControl,           1, 0, 0, 0, 1),
+    CC_ENTRY(NV_UndefineSpace,           2, 0, 0, 0, 1),
+    CC_ENTRY(ChangeEPS,                  1, 0, 0, 0, 1),
+    CC_ENTRY(ChangePPS,                  1, 0, 0, 0, 1),
+    CC_ENTRY(Clear,                      1, 0, 0, 0, 1),
+    CC_ENTRY(ClearControl,               1, 0, 0, 0, 1),
+    CC_ENTRY(ClockSet,                   1, 0, 0, 0, 1),
+    CC_ENTRY(HierarchyChangeAuth,        1, 0, 1, 0, 1),
+    CC_ENTRY(NV_DefineSpace,             1, 0, 1, 0, 1),
+    CC_ENTRY(PCR_Allocate,               1, 0, 0, 0, 1),
+    CC_ENTRY(PCR_SetAuthPolicy,          1, 0, 1, 0, 1),
+    CC_ENTRY(PP_Commands,                1, 0, 0, 0, 1),
+    CC_ENTRY(SetPrimaryPolicy,           1, 0, 1, 0, 1),
+    CC_ENTRY(FieldUpgradeStart,          2, 0, 1, 0, 1),
+    CC_ENTRY(ClockRateAdjust,            1, 0, 0, 0, 1),
+    CC_ENTRY(CreatePrimary,              1, 1, 1, 1, 1),
+    CC_ENTRY(NV_GlobalWriteLock,         1, 0, 0, 0, 1),
+    CC_ENTRY(GetCommandAuditDigest,      2, 0, 1, 1, 1),
+    CC_ENTRY(NV_Increment,               2, 0, 0, 0, 1),
+    CC_ENTRY(NV_SetBits,                 2, 0, 0, 0, 1),
+    CC_ENTRY(NV_Extend,                  2, 0, 1, 0, 1),
+    CC_ENTRY(NV_Write,                   2, 0, 1, 0, 1),
+    CC_ENTRY(NV_WriteLock,               2, 0, 0, 0, 1),
+    CC_ENTRY(DictionaryAttackLockReset,  1, 0, 0, 0, 1),
+    CC_ENTRY(DictionaryAttackParameters, 1, 0, 0, 0, 1),
+    CC_ENTRY(NV_ChangeAuth,              1, 0, 1, 0, 1),
+    CC_ENTRY(PCR_Event,                  1, 0, 1, 0, 1),
+    CC_ENTRY(PCR_Reset,                  1, 0, 0, 0, 1),
+    CC_ENTRY(SequenceComplete,           1, 0, 1, 1, 1),
+    CC_ENTRY(SetAlgorithmSet,            1, 0, 0, 0, 1),
+    CC_ENTRY(SetCommandCodeAuditStatus,  1, 0, 0, 0, 1),
+    CC_ENTRY(FieldUpgradeData,           0, 0, 1, 0, 1),
+    CC_ENTRY(IncrementalSelfTest,        0, 0, 0, 0, 1),
+    CC_ENTRY(SelfTest,                   0, 0, 0, 0, 1),
+    CC_ENTRY(Startup,                    0, 0, 0, 0, 0),
+    CC_ENTRY(Shutdown,                   0, 0, 0, 0, 1),
+    CC_ENTRY(StirRandom,                 0, 0, 1, 0, 1),
+    CC_ENTRY(ActivateCredential,         2, 0, 1, 1, 1),
+    CC_ENTRY(Certify,                    2, 0, 1, 1, 1),
+    CC_ENTRY(PolicyNV,                   3, 0, 1, 0, 1),
+    CC_ENTRY(CertifyCreation,            2, 0, 1, 1, 1),
+    CC_ENTRY(Duplicate,                  2, 0, 1, 1, 1),
+    CC_ENTRY(GetTime,                    2, 0, 1, 1, 1),
+    CC_ENTRY(GetSessionAuditDigest,      3, 0, 1, 1, 1),
+    CC_ENTRY(NV_Read,                    2, 0, 0, 1, 1),
+    CC_ENTRY(NV_ReadLock,                2, 0, 0, 0, 1),
+    CC_ENTRY(ObjectChangeAuth,           2, 0, 1, 1, 1),
+    CC_ENTRY(PolicySecret,               2, 0, 1, 1, 1),
+    CC_ENTRY(Rewrap,                     2, 0, 1, 1, 1),
+    CC_ENTRY(Create,                     1, 0, 1, 1, 1),
+    CC_ENTRY(ECDH_ZGen,                  1, 0, 1, 1, 1),
+    CC_ENTRY(HMAC,                       1, 0, 1, 1, 1),
+    CC_ENTRY(Import,                     1, 0, 1, 1, 1),
+    CC_ENTRY(Load,                       1, 1, 1, 1, 1),
+    CC_ENTRY(Quote,                      1, 0, 1, 1, 1),
+    CC_ENTRY(RSA_Decrypt,                1, 0, 1, 1, 1),
+    CC_ENTRY(HMAC_Start,                 1, 1, 1, 0, 1),
+    CC_ENTRY(SequenceUpdate,             1, 0, 1, 0, 1),
+    CC_ENTRY(Sign,                       1, 0, 1, 0, 1),
+    CC_ENTRY(Unseal,                     1, 0, 0, 1, 1),
+    CC_ENTRY(PolicySigned,               2, 0, 1, 1, 1),
+    CC_ENTRY(ContextLoad,                0, 1, 0, 0, 0),
+    CC_ENTRY(ContextSave,                1, 0, 0, 0, 0),
+    CC_ENTRY(ECDH_KeyGen,                1, 0, 0, 1, 1),
+    CC_ENTRY(EncryptDecrypt,             1, 0, 1, 1, 1),
+    CC_ENTRY(FlushContext,               1, 0, 0, 0, 0),
+    CC_ENTRY(LoadExternal,               0, 1, 1, 1, 1),
+    CC_ENTRY(MakeCredential,             1, 0, 1, 1, 1),
+    CC_ENTRY(NV_ReadPublic,              1, 0, 0, 1, 1),
+    CC_ENTRY(PolicyAuthorize,            1, 0, 1, 0, 1),
+    CC_ENTRY(PolicyAuthValue,            1, 0, 0, 0, 1),
+    CC_ENTRY(PolicyCommandCode,          1, 0, 0, 0, 1),
+    CC_ENTRY(PolicyCounterTimer,         1, 0, 1, 0, 1),
+    CC_ENTRY(PolicyCpHash,               1, 0, 1, 0, 1),
+    CC_ENTRY(PolicyLocality,             1, 0, 0, 0, 1),
+    CC_ENTRY(PolicyNameHash,             1, 0, 1, 0, 1),
+    CC_ENTRY(PolicyOR,                   1, 0, 0, 0, 1),
+    CC_ENTRY(PolicyTicket,               1, 0, 1, 0, 1),
+    CC_ENTRY(ReadPublic,                 1, 0, 0, 1, 1),
+    CC_ENTRY(RSA_Encrypt,                1, 0, 1, 1, 1),
+    CC_ENTRY(StartAuthSession,           2, 1, 1, 1, 1),
+    CC_ENTRY(VerifySignature,            1, 0, 1, 0, 1),
+    CC_ENTRY(ECC_Parameters,             0, 0, 0, 0, 1),
+    CC_ENTRY(FirmwareRead,               0, 0, 0, 1, 1),
+    CC_ENTRY(GetCapability,              0, 0, 0, 0, 1),
+    CC_ENTRY(GetRandom,                  0, 0, 0, 1, 1),
+    CC_ENTRY(GetTestResult,              0, 0, 0, 1, 1),
+    CC_ENTRY(Hash,                       0, 0, 1, 1, 1),
+    CC_ENTRY(PCR_Read,                   0, 0, 0, 0, 1),
+    CC_ENTRY(PolicyPCR,                  1, 0, 1, 0, 1),
+    CC_ENTRY(PolicyRestart,              1, 0, 0, 0, 1),
+    CC_ENTRY(ReadClock,                  0, 0, 0, 0, 0),
+    CC_ENTRY(PCR_Extend,                 1, 0, 0, 0, 1),
+    CC_ENTRY(PCR_SetAuthValue,           1, 0, 1, 0, 1),
+    CC_ENTRY(NV_Certify,                 3, 0, 1, 1, 1),
+    CC_ENTRY(EventSequenceComplete,      2, 0, 1, 0, 1),
+    CC_ENTRY(HashSequenceStart,          0, 1, 1, 0, 1),
+    CC_ENTRY(PolicyPhysicalPresence,     1, 0, 0, 0, 1),
+    CC_ENTRY(PolicyDuplicationSelect,    1, 0, 1, 0, 1),
+    CC_ENTRY(PolicyGetDigest,            1, 0, 0, 1, 1),
+    CC_ENTRY(TestParms,                  0, 0, 0, 0, 1),
+    CC_ENTRY(Commit,                     1, 0, 1, 1, 1),
+    CC_ENTRY(PolicyPassword,             1, 0, 0, 0, 1),
+    CC_ENTRY(ZGen_2Phase,                1, 0, 1, 1, 1),
+    CC_ENTRY(EC_Ephemeral,               0, 0, 0, 1, 1),
+    CC_ENTRY(PolicyNvWritten,            1, 0, 0, 0, 1),
+    CC_ENTRY(PolicyTemplate,             1, 0, 1, 0, 1),
+    CC_ENTRY(CreateLoaded,               1, 1, 1, 1, 1),
+    CC_ENTRY(PolicyAuthorizeNV,          3, 0, 0, 0, 1),
+    CC_ENTRY(EncryptDecrypt2,            1, 0, 1, 1, 1),
+    CC_ENTRY(AC_GetCapability,           1, 0, 0, 0, 1),
+    CC_ENTRY(AC_Send,                    3, 0, 1, 0, 1),
+    CC_ENTRY(Policy_AC_SendSelect,       1, 0, 1, 0, 1),
+};
+
+/* Vendor specific commands, outside of the range of cc_table. */
+static const struct {
+    TPM2_CC commandCode;
+    CC_ATTRIBUTES attributes;
+} cc_vendor_table[] = {
+    { TPM2_CC_Vendor_TCG_Test, { 0, 0, 1, 1, 1 } },
+};
+
+const CC_ATTRIBUTES *
+cc_attributes (TPM2_CC commandCode)
+{
+    static const CC_ATTRIBUTES unknown;
+    size_t i;
+
+    if (commandCode >= TPM2_CC_FIRST && commandCode <= TPM2_CC_LAST)
+        return &cc_table[commandCode - TPM2_CC_FIRST];
+
+    for (i = 0; i < sizeof(cc_vendor_table) / sizeof(cc_vendor_table[0]); i++) {
+        if (cc_vendor_table[i].commandCode == commandCode)
+            return &cc_vendor_table[i].attributes;
+    }
+
+    return &unknown;
+}
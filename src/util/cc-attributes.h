@@ -0,0 +1,32 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ */
+#ifndef CC_ATTRIBUTES_H
+#define CC_ATTRIBUTES_H
+
+#include "tss2_tpm2_types.h"
+
+/*
+ * Per-command metadata shared by the SYS and ESYS implementations. The
+ * attributes of every command in the TPM2_CC_FIRST .. TPM2_CC_LAST range are
+ * found by indexing with the command code; the few vendor commands live in a
+ * separate side table.
+ */
+typedef struct {
+    UINT8 commandHandles;   /**< handles in the command handle area */
+    UINT8 responseHandles;  /**< handles in the response handle area */
+    UINT8 decryptAllowed;   /**< first command parameter is a TPM2B */
+    UINT8 encryptAllowed;   /**< first response parameter is a TPM2B */
+    UINT8 authAllowed;      /**< command may carry an authorization area */
+} CC_ATTRIBUTES;
+
+/*
+ * Return the attributes of a command. Unknown command codes get an entry
+ * with all fields zero, so the result never needs to be checked for NULL.
+ */
+const CC_ATTRIBUTES *
+cc_attributes (TPM2_CC commandCode);
+
+#endif /* CC_ATTRIBUTES_H */
@@ -12,6 +12,7 @@
 #ifndef _WIN32
 #include <netdb.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <unistd.h>
 #endif
 
@@ -113,6 +114,57 @@ write_all (
     return (ssize_t)written_total;
 }
 
+ssize_t
+writev_all (
+    SOCKET fd,
+    struct iovec *iov,
+    int iovcnt)
+{
+    ssize_t written;
+    size_t written_total = 0;
+
+    if (!iov) return 0;
+
+    while (iovcnt > 0) {
+        /* Skip the buffers that have been written completely */
+        if (iov->iov_len == 0) {
+            iov++;
+            iovcnt--;
+            continue;
+        }
+#ifdef _WIN32
+        TEMP_RETRY (written, send (fd, (const char*)iov->iov_base,
+                                   iov->iov_len, 0));
+#else
+        TEMP_RETRY (written, writev (fd, iov, iovcnt));
+#endif
+        if (written < 0) {
+#ifdef _WIN32
+            LOG_ERROR ("failed to write to fd %d: %s", fd, strerror (WSAGetLastError()));
+#else
+            LOG_ERROR ("failed to write to fd %d: %s", fd, strerror (errno));
+#endif
+            return written_total;
+        }
+        written_total += (size_t)written;
+        /* Advance the buffers past the bytes that have been written */
+        while (written > 0) {
+            size_t len = (size_t)written < iov->iov_len ?
+                         (size_t)written : iov->iov_len;
+            iov->iov_base = (uint8_t*)iov->iov_base + len;
+            iov->iov_len -= len;
+            written -= len;
+            if (iov->iov_len == 0) {
+                iov++;
+                iovcnt--;
+            }
+        }
+    }
+    LOG_DEBUG ("wrote %zu bytes to fd %d", written_total, fd);
+
+    return (ssize_t)written_total;
+}
+
 ssize_t
 socket_recv_buf (
     SOCKET sock,
@@ -122,6 +174,112 @@ socket_recv_buf (
     return read_all (sock, data, size);
 }
 
+/*
+ * The 'socket_recv_partial' function performs a single read of at most
+ * 'size' bytes from 'sock'. Unlike 'read_all' it returns as soon as any
+ * data has been read, so it does not block when called on a socket that
+ * 'socket_poll' reported as readable. Interrupted system calls are retried.
+ * Returns the number of bytes read, 0 on EOF or -1 on error.
+ */
+ssize_t
+socket_recv_partial (
+    SOCKET sock,
+    uint8_t *data,
+    size_t size)
+{
+    ssize_t recvd;
+
+    if (!data) return 0;
+
+#ifdef _WIN32
+    TEMP_RETRY (recvd, recv (sock, (char *) data, size, 0));
+    if (recvd < 0) {
+        LOG_WARNING ("read on fd %d failed with errno %d: %s",
+                     sock, WSAGetLastError(), strerror (WSAGetLastError()));
+        return recvd;
+    }
+#else
+    TEMP_RETRY (recvd, read (sock, data, size));
+    if (recvd < 0) {
+        LOG_WARNING ("read on fd %d failed with errno %d: %s",
+                     sock, errno, strerror (errno));
+        return recvd;
+    }
+#endif
+    LOGBLOB_DEBUG (data, recvd, "read %zd bytes from fd %d:", recvd, sock);
+
+    return recvd;
+}
+
+/*
+ * The 'socket_recv_partialv' function is the vectored version of
+ * 'socket_recv_partial'. The bytes read fill the buffers of 'iov' in order.
+ */
+ssize_t
+socket_recv_partialv (
+    SOCKET sock,
+    struct iovec *iov,
+    int iovcnt)
+{
+    if (!iov) return 0;
+
+#ifdef _WIN32
+    /* A partial read may stop at the end of the first non-empty buffer */
+    while (iovcnt > 1 && iov->iov_len == 0) {
+        iov++;
+        iovcnt--;
+    }
+    return socket_recv_partial (sock, iov->iov_base, iov->iov_len);
+#else
+    ssize_t recvd;
+
+    TEMP_RETRY (recvd, readv (sock, iov, iovcnt));
+    if (recvd < 0) {
+        LOG_WARNING ("read on fd %d failed with errno %d: %s",
+                     sock, errno, strerror (errno));
+        return recvd;
+    }
+    LOG_DEBUG ("read %zd bytes from fd %d", recvd, sock);
+
+    return recvd;
+#endif
+}
+
+/*
+ * The 'socket_poll' function waits up to 'timeout' milliseconds for data to
+ * become available on 'sock'. A negative 'timeout' waits forever.
+ */
+TSS2_RC
+socket_poll (
+    SOCKET sock,
+    int timeout)
+{
+    struct pollfd fds = { .fd = sock, .events = POLLIN };
+    int ret;
+
+#ifdef _WIN32
+    ret = WSAPoll (&fds, 1, timeout);
+    if (ret == SOCKET_ERROR) {
+        LOG_ERROR ("Failed to poll fd %d, errno %d: %s",
+                   sock, WSAGetLastError(), strerror (WSAGetLastError()));
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+#else
+    TEMP_RETRY (ret, poll (&fds, 1, timeout));
+    if (ret < 0) {
+        LOG_ERROR ("Failed to poll fd %d, errno %d: %s",
+                   sock, errno, strerror (errno));
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+#endif
+    if (ret == 0) {
+        LOG_DEBUG ("Poll timed out on fd %d.", sock);
+        return TSS2_TCTI_RC_TRY_AGAIN;
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
 TSS2_RC
 socket_xmit_buf (
     SOCKET sock,
@@ -143,6 +301,33 @@ socket_xmit_buf (
     return TSS2_RC_SUCCESS;
 }
 
+TSS2_RC
+socket_xmit_bufv (
+    SOCKET sock,
+    struct iovec *iov,
+    int iovcnt)
+{
+    size_t size = 0;
+    ssize_t ret;
+
+    for (int i = 0; i < iovcnt; i++) {
+        LOGBLOB_DEBUG (iov [i].iov_base, iov [i].iov_len,
+                       "Writing %zu bytes to socket %d:", iov [i].iov_len,
+                       sock);
+        size += iov [i].iov_len;
+    }
+    ret = writev_all (sock, iov, iovcnt);
+    if (ret < (ssize_t) size) {
+#ifdef _WIN32
+        LOG_ERROR ("write to fd %d failed, errno %d: %s", sock, WSAGetLastError(), strerror (WSAGetLastError()));
+#else
+        LOG_ERROR ("write to fd %d failed, errno %d: %s", sock, errno, strerror (errno));
+#endif
+        return TSS2_TCTI_RC_IO_ERROR;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
 TSS2_RC
 socket_close (
     SOCKET *socket)
@@ -12,11 +12,16 @@
 #include <ws2tcpip.h>
 typedef SSIZE_T ssize_t;
 #define _HOST_NAME_MAX MAX_COMPUTERNAME_LENGTH
+struct iovec {
+    void *iov_base;
+    size_t iov_len;
+};
 
 #else
 #include <arpa/inet.h>
 #include <errno.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #define _HOST_NAME_MAX _POSIX_HOST_NAME_MAX
 #define SOCKET int
@@ -68,6 +73,17 @@ write_all (
     SOCKET fd,
     const uint8_t *buf,
     size_t size);
+/*
+ * Write all buffers described by the 'iovcnt' elements of 'iov' to file
+ * descriptor 'fd', in order and with as few calls to 'writev' as possible.
+ * Short writes and interrupted system calls are retried. The 'iov' array
+ * is modified to keep track of partial writes.
+ */
+ssize_t
+writev_all (
+    SOCKET fd,
+    struct iovec *iov,
+    int iovcnt);
 TSS2_RC
 socket_connect (
     const char *hostname,
@@ -81,11 +97,47 @@ socket_recv_buf (
     SOCKET sock,
     uint8_t *data,
     size_t size);
+/*
+ * Read at most 'size' bytes from 'sock' with a single call to 'read'.
+ * Returns the number of bytes read, 0 on EOF or -1 on error.
+ */
+ssize_t
+socket_recv_partial (
+    SOCKET sock,
+    uint8_t *data,
+    size_t size);
+/*
+ * Read at most as many bytes as fit into the 'iovcnt' buffers of 'iov' from
+ * 'sock' with a single call to 'readv'. Returns the number of bytes read,
+ * 0 on EOF or -1 on error.
+ */
+ssize_t
+socket_recv_partialv (
+    SOCKET sock,
+    struct iovec *iov,
+    int iovcnt);
+/*
+ * Wait up to 'timeout' milliseconds (forever if negative) for 'sock' to
+ * become readable. Returns TSS2_TCTI_RC_TRY_AGAIN on timeout.
+ */
+TSS2_RC
+socket_poll (
+    SOCKET sock,
+    int timeout);
 TSS2_RC
 socket_xmit_buf (
     SOCKET sock,
     const void *buf,
     size_t size);
+/*
+ * Send the 'iovcnt' buffers of 'iov' to 'sock', using a single system call
+ * unless the socket accepts only part of the data.
+ */
+TSS2_RC
+socket_xmit_bufv (
+    SOCKET sock,
+    struct iovec *iov,
+    int iovcnt);
 
 #ifdef __cplusplus
 }
@@ -80,25 +80,37 @@ doLogBlob(log_level loglevel, const char *module, log_level logdefault,
            const char *file, const char *func, int line,
            const uint8_t *blob, size_t size, const char *fmt, ...)
 {
+    static const char hex[] = "0123456789abcdef";
+
     if (unlikely(*status == LOGLEVEL_UNDEFINED))
         *status = getLogLevel(module, logdefault);
 
     if (loglevel > *status)
         return;
 
+    /*
+     * Each byte takes two characters and every line of 'width' bytes is
+     * prefixed with a newline and a tab. Only the first LOGBLOB_MAXSIZE
+     * bytes are dumped so the buffer has a fixed size.
+     */
     size_t width = 8;
-    size_t buffer_size = (size * 2) + (size / width) * 2 + 1;
-    char buffer[buffer_size];
-    buffer[0] = '\0';
-    for (size_t i = 0, off = 0; i < size && off < buffer_size; i++, off+=2) {
-        if (width < buffer_size && i % width == 0) {
-            *(&buffer[0] + off) = '\n';
-            off += 1;
-            *(&buffer[0] + off) = '\t';
-            off += 1;
+    size_t dump_size = (size > LOGBLOB_MAXSIZE) ? LOGBLOB_MAXSIZE : size;
+    char buffer[LOGBLOB_MAXSIZE * 2 + (LOGBLOB_MAXSIZE / width + 1) * 2 +
+                sizeof("\n\t...")];
+    size_t off = 0;
+    for (size_t i = 0; i < dump_size; i++) {
+        if (i % width == 0) {
+            buffer[off++] = '\n';
+            buffer[off++] = '\t';
         }
-        sprintf(&buffer[0] + off, "%02x", blob[i]);
+        buffer[off++] = hex[blob[i] >> 4];
+        buffer[off++] = hex[blob[i] & 0x0f];
+    }
+    if (dump_size < size) {
+        memcpy(&buffer[off], "\n\t...", sizeof("\n\t...") - 1);
+        off += sizeof("\n\t...") - 1;
     }
+    buffer[off] = '\0';
 
     va_list vaargs;
     va_start(vaargs, fmt);
@@ -106,8 +118,7 @@ doLogBlob(log_level loglevel, const char *module, log_level logdefault,
        snprintf(NULL, 0, ...). Until there is an alternative, messages on
        logblob are restricted to 255 characters
     int msg_len = vsnprintf(NULL, 0, fmt, vaargs); */
-    int msg_len = 255;
-    char msg[msg_len+1];
+    char msg[256];
     vsnprintf(msg, sizeof(msg), fmt, vaargs);
     va_end(vaargs);
 
@@ -127,18 +138,26 @@ doLog(log_level loglevel, const char *module, log_level logdefault,
     if (loglevel > *status)
         return;
 
-    int size = snprintf(NULL, 0, "%s:%s:%s:%d:%s() %s \n",
-                log_strings[loglevel], module, file, line, func, msg);
-    char fmt[size+1];
-    memset(fmt, 0, size+1);
-    snprintf(fmt, sizeof(fmt), "%s:%s:%s:%d:%s() %s \n",
+    /*
+     * Prefix the message format with the location so the whole line goes
+     * out in a single vfprintf call and doesn't interleave with other
+     * threads. Format strings are literals, so this fits in all but
+     * pathological cases; those are printed piecewise.
+     */
+    char fmt[512];
+    int size = snprintf(fmt, sizeof(fmt), "%s:%s:%s:%d:%s() %s \n",
                 log_strings[loglevel], module, file, line, func, msg);
 
     va_list vaargs;
     va_start(vaargs, msg);
-    vfprintf (stderr, fmt,
-        /* log_strings[loglevel], module, file, func, line, */
-        vaargs);
+    if (likely(size >= 0 && (size_t)size < sizeof(fmt))) {
+        vfprintf (stderr, fmt, vaargs);
+    } else {
+        fprintf (stderr, "%s:%s:%s:%d:%s() ",
+                 log_strings[loglevel], module, file, line, func);
+        vfprintf (stderr, msg, vaargs);
+        fputs (" \n", stderr);
+    }
     va_end(vaargs);
 }
 
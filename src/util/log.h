@@ -55,6 +55,39 @@ static log_level LOGMODULE_status COMPILER_ATTR(unused) = LOGLEVEL_UNDEFINED;
 #error "MAXLOGLEVEL undefined"
 #endif
 
+/*
+ * Blobs longer than this are truncated in the log output. This bounds the
+ * stack used by doLogBlob and keeps large buffers (that may hold secrets)
+ * out of the log.
+ */
+#ifndef LOGBLOB_MAXSIZE
+#define LOGBLOB_MAXSIZE 1024
+#endif
+
+/*
+ * The level check is done inline so a disabled level costs a single compare
+ * and no call. LOGLEVEL_UNDEFINED is larger than every level, so the first
+ * message of a module always reaches doLog / doLogBlob, which then resolve
+ * the module's level from the environment.
+ */
+#define LOG_ENABLED(LEVEL) ((LEVEL) <= LOGMODULE_status)
+
+#define LOG_GATED(LEVEL, FORMAT, ...) \
+    do { \
+        if (LOG_ENABLED(LEVEL)) \
+            doLog(LEVEL, xstr(LOGMODULE), LOGDEFAULT, &LOGMODULE_status, \
+                  __FILE__, __func__, __LINE__, \
+                  FORMAT, ## __VA_ARGS__); \
+    } while (0)
+
+#define LOGBLOB_GATED(LEVEL, BUFFER, SIZE, FORMAT, ...) \
+    do { \
+        if (LOG_ENABLED(LEVEL)) \
+            doLogBlob(LEVEL, xstr(LOGMODULE), LOGDEFAULT, &LOGMODULE_status, \
+                      __FILE__, __func__, __LINE__, \
+                      BUFFER, SIZE, FORMAT, ## __VA_ARGS__); \
+    } while (0)
+
 #if MAXLOGLEVEL > LOGL_TRACE || MAXLOGLEVEL < LOGL_ERROR
     #if MAXLOGLEVEL != LOGL_NONE
         #error "Unknown MAXLOGLEVEL"
@@ -63,17 +96,10 @@ static log_level LOGMODULE_status COMPILER_ATTR(unused) = LOGLEVEL_UNDEFINED;
 
 /* MAXLOGLEVEL is Error or "higher" */
 #if MAXLOGLEVEL >= LOGL_ERROR
-#define LOG_ERROR(FORMAT, ...) doLog(LOGLEVEL_ERROR, \
-                                     xstr(LOGMODULE), LOGDEFAULT, \
-                                     &LOGMODULE_status, \
-                                     __FILE__, __func__, __LINE__, \
-                                     FORMAT, ## __VA_ARGS__)
-#define LOGBLOB_ERROR(BUFFER, SIZE, FORMAT, ...) doLogBlob(LOGLEVEL_ERROR, \
-                                             xstr(LOGMODULE), LOGDEFAULT, \
-                                             &LOGMODULE_status, \
-                                             __FILE__, __func__, __LINE__, \
-                                             BUFFER, SIZE, \
-                                             FORMAT, ## __VA_ARGS__)
+#define LOG_ERROR(FORMAT, ...) LOG_GATED(LOGLEVEL_ERROR, FORMAT, ## __VA_ARGS__)
+#define LOGBLOB_ERROR(BUFFER, SIZE, FORMAT, ...) LOGBLOB_GATED(LOGLEVEL_ERROR, \
+                                                  BUFFER, SIZE, FORMAT, \
+                                                  ## __VA_ARGS__)
 #else /* MAXLOGLEVEL is not Error or "higher" */
 #define LOG_ERROR(FORMAT, ...) {}
 #define LOGBLOB_ERROR(FORMAT, ...) {}
@@ -81,17 +107,10 @@ static log_level LOGMODULE_status COMPILER_ATTR(unused) = LOGLEVEL_UNDEFINED;
 
 /* MAXLOGLEVEL is Warning or "higher" */
 #if MAXLOGLEVEL >= LOGL_WARNING
-#define LOG_WARNING(FORMAT, ...) doLog(LOGLEVEL_WARNING, \
-                                     xstr(LOGMODULE), LOGDEFAULT, \
-                                     &LOGMODULE_status, \
-                                     __FILE__, __func__, __LINE__, \
-                                     FORMAT, ## __VA_ARGS__)
-#define LOGBLOB_WARNING(BUFFER, SIZE, FORMAT, ...) doLogBlob(LOGLEVEL_WARNING, \
-                                                 xstr(LOGMODULE), LOGDEFAULT, \
-                                                 &LOGMODULE_status, \
-                                                 __FILE__, __func__, __LINE__, \
-                                                 BUFFER, SIZE, \
-                                                 FORMAT, ## __VA_ARGS__)
+#define LOG_WARNING(FORMAT, ...) LOG_GATED(LOGLEVEL_WARNING, FORMAT, ## __VA_ARGS__)
+#define LOGBLOB_WARNING(BUFFER, SIZE, FORMAT, ...) LOGBLOB_GATED(LOGLEVEL_WARNING, \
+                                                  BUFFER, SIZE, FORMAT, \
+                                                  ## __VA_ARGS__)
 #else /* MAXLOGLEVEL is not Warning or "higher" */
 #define LOG_WARNING(FORMAT, ...) {}
 #define LOGBLOB_WARNING(FORMAT, ...) {}
@@ -99,17 +118,10 @@ static log_level LOGMODULE_status COMPILER_ATTR(unused) = LOGLEVEL_UNDEFINED;
 
 /* MAXLOGLEVEL is Info or "higher" */
 #if MAXLOGLEVEL >= LOGL_INFO
-#define LOG_INFO(FORMAT, ...) doLog(LOGLEVEL_INFO, \
-                                     xstr(LOGMODULE), LOGDEFAULT, \
-                                     &LOGMODULE_status, \
-                                     __FILE__, __func__, __LINE__, \
-                                     FORMAT, ## __VA_ARGS__)
-#define LOGBLOB_INFO(BUFFER, SIZE, FORMAT, ...) doLogBlob(LOGLEVEL_INFO, \
-                                     xstr(LOGMODULE), LOGDEFAULT, \
-                                     &LOGMODULE_status, \
-                                     __FILE__, __func__, __LINE__, \
-                                     BUFFER, SIZE, \
-                                     FORMAT, ## __VA_ARGS__)
+#define LOG_INFO(FORMAT, ...) LOG_GATED(LOGLEVEL_INFO, FORMAT, ## __VA_ARGS__)
+#define LOGBLOB_INFO(BUFFER, SIZE, FORMAT, ...) LOGBLOB_GATED(LOGLEVEL_INFO, \
+                                                  BUFFER, SIZE, FORMAT, \
+                                                  ## __VA_ARGS__)
 #else /* MAXLOGLEVEL is not Info or "higher" */
 #define LOG_INFO(FORMAT, ...) {}
 #define LOGBLOB_INFO(FORMAT, ...) {}
@@ -117,17 +129,10 @@ static log_level LOGMODULE_status COMPILER_ATTR(unused) = LOGLEVEL_UNDEFINED;
 
 /* MAXLOGLEVEL is Debug or "higher" */
 #if MAXLOGLEVEL >= LOGL_DEBUG
-#define LOG_DEBUG(FORMAT, ...) doLog(LOGLEVEL_DEBUG, \
-                                     xstr(LOGMODULE), LOGDEFAULT, \
-                                     &LOGMODULE_status, \
-                                     __FILE__, __func__, __LINE__, \
-                                     FORMAT, ## __VA_ARGS__)
-#define LOGBLOB_DEBUG(BUFFER, SIZE, FORMAT, ...) doLogBlob(LOGLEVEL_DEBUG, \
-                                             xstr(LOGMODULE), LOGDEFAULT, \
-                                             &LOGMODULE_status, \
-                                             __FILE__, __func__, __LINE__, \
-                                             BUFFER, SIZE, \
-                                             FORMAT, ## __VA_ARGS__)
+#define LOG_DEBUG(FORMAT, ...) LOG_GATED(LOGLEVEL_DEBUG, FORMAT, ## __VA_ARGS__)
+#define LOGBLOB_DEBUG(BUFFER, SIZE, FORMAT, ...) LOGBLOB_GATED(LOGLEVEL_DEBUG, \
+                                                  BUFFER, SIZE, FORMAT, \
+                                                  ## __VA_ARGS__)
 #else /* MAXLOGLEVEL is not Debug or "higher" */
 #define LOG_DEBUG(FORMAT, ...) {}
 #define LOGBLOB_DEBUG(FORMAT, ...) {}
@@ -135,17 +140,10 @@ static log_level LOGMODULE_status COMPILER_ATTR(unused) = LOGLEVEL_UNDEFINED;
 
 /* MAXLOGLEVEL is Trace */
 #if MAXLOGLEVEL >= LOGL_TRACE
-#define LOG_TRACE(FORMAT, ...) doLog(LOGLEVEL_TRACE, \
-                                     xstr(LOGMODULE), LOGDEFAULT, \
-                                     &LOGMODULE_status, \
-                                     __FILE__, __func__, __LINE__, \
-                                     FORMAT, ## __VA_ARGS__)
-#define LOGBLOB_TRACE(BUFFER, SIZE, FORMAT, ...) doLogBlob(LOGLEVEL_TRACE, \
-                                             xstr(LOGMODULE), LOGDEFAULT, \
-                                             &LOGMODULE_status, \
-                                             __FILE__, __func__, __LINE__, \
-                                             BUFFER, SIZE, \
-                                             FORMAT, ## __VA_ARGS__)
+#define LOG_TRACE(FORMAT, ...) LOG_GATED(LOGLEVEL_TRACE, FORMAT, ## __VA_ARGS__)
+#define LOGBLOB_TRACE(BUFFER, SIZE, FORMAT, ...) LOGBLOB_GATED(LOGLEVEL_TRACE, \
+                                                  BUFFER, SIZE, FORMAT, \
+                                                  ## __VA_ARGS__)
 #else /* MAXLOGLEVEL is not Trace */
 #define LOG_TRACE(FORMAT, ...) {}
 #define LOGBLOB_TRACE(FORMAT, ...) {}
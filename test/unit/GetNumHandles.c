@@ -12,6 +12,7 @@
 
 #include "tss2_sys.h"
 #include "sysapi_util.h"
+#include "util/cc-attributes.h"
 
 /**
  * Test to be sure we get back the expected # of command handles for
@@ -67,6 +68,67 @@ GetNumResponseHandles_LAST_plus_one (void **state)
     assert_int_equal (num_handles, 0);
 }
 
+/**
+ * Table coverage check: TPM2_CC_EncryptDecrypt2 keeps the single command
+ * handle it had in the former commandArray.
+ */
+static void
+GetNumCommandHandles_EncryptDecrypt2_unit (void **state)
+{
+    int num_handles;
+    TPM2_CC command_code = TPM2_CC_EncryptDecrypt2;
+
+    num_handles = GetNumCommandHandles (command_code);
+    assert_int_equal (num_handles, 1);
+}
+
+/**
+ * Codes inside the TPM2_CC_FIRST .. TPM2_CC_LAST range without a command
+ * get an all zero entry, like the codes outside of the range.
+ */
+static void
+cc_attributes_unassigned_unit (void **state)
+{
+    const CC_ATTRIBUTES *attributes = cc_attributes (0x123);
+
+    assert_int_equal (attributes->commandHandles, 0);
+    assert_int_equal (attributes->responseHandles, 0);
+    assert_int_equal (attributes->decryptAllowed, 0);
+    assert_int_equal (attributes->encryptAllowed, 0);
+    assert_int_equal (attributes->authAllowed, 0);
+}
+
+/**
+ * Spot checks of the crypt and auth flags, including the vendor command
+ * from the side table.
+ */
+static void
+cc_attributes_flags_unit (void **state)
+{
+    const CC_ATTRIBUTES *attributes;
+
+    attributes = cc_attributes (TPM2_CC_NV_Write);
+    assert_int_equal (attributes->commandHandles, 2);
+    assert_int_equal (attributes->decryptAllowed, 1);
+    assert_int_equal (attributes->encryptAllowed, 0);
+    assert_int_equal (attributes->authAllowed, 1);
+
+    attributes = cc_attributes (TPM2_CC_FlushContext);
+    assert_int_equal (attributes->decryptAllowed, 0);
+    assert_int_equal (attributes->encryptAllowed, 0);
+    assert_int_equal (attributes->authAllowed, 0);
+
+    attributes = cc_attributes (TPM2_CC_Policy_AC_SendSelect);
+    assert_int_equal (attributes->commandHandles, 1);
+    assert_int_equal (attributes->decryptAllowed, 1);
+
+    attributes = cc_attributes (TPM2_CC_Vendor_TCG_Test);
+    assert_int_equal (attributes->commandHandles, 0);
+    assert_int_equal (attributes->decryptAllowed, 1);
+    assert_int_equal (attributes->encryptAllowed, 1);
+    assert_int_equal (attributes->authAllowed, 1);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -76,6 +138,9 @@ main (int   argc,
         cmocka_unit_test (GetNumResponseHandles_HMAC_Start_unit),
         cmocka_unit_test (GetNumCommandHandles_LAST_plus_one),
         cmocka_unit_test (GetNumResponseHandles_LAST_plus_one),
+        cmocka_unit_test (GetNumCommandHandles_EncryptDecrypt2_unit),
+        cmocka_unit_test (cc_attributes_unassigned_unit),
+        cmocka_unit_test (cc_attributes_flags_unit),
     };
     return cmocka_run_group_tests (tests, NULL, NULL);
 }
@@ -355,6 +355,71 @@ tpm2b_unmarshal_buffer_size_lt_data_nad_lt_offset(void **state)
     assert_int_equal (offset, sizeof(dgst) - 5);
 }
 
+/*
+ * A TPM2B whose size doesn't match the nested structure is decoded the way
+ * it always was: the structure is read and the offset is left behind it.
+ * A nested structure may only be unmarshaled to an empty TPM2B.
+ */
+static void
+tpm2b_unmarshal_nested_size(void **state)
+{
+    TPM2B_ECC_POINT point;
+    size_t offset = 0;
+    uint8_t buffer[] = { 0x00, 0x0e, /* size of TPM2B_ECC_POINT, 2 too many */
+                         0x00, 0x04, 0xef, 0xbe, 0xad, 0xde,   /* ECC_POINT.x - 4 bytes */
+                         0x00, 0x04, 0x44, 0x33, 0x22, 0x11,   /* ECC_POINT.y - 4 bytes */
+                         0xff, 0xff };
+    TSS2_RC rc;
+
+    memset(&point, 0xa5, sizeof(point));
+    point.size = 0;
+    rc = Tss2_MU_TPM2B_ECC_POINT_Unmarshal(buffer, sizeof(buffer), &offset, &point);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (point.size, 14);
+    assert_int_equal (point.point.x.size, 4);
+    assert_memory_equal (point.point.x.buffer, &buffer[4], 4);
+    assert_int_equal (point.point.y.size, 4);
+    assert_memory_equal (point.point.y.buffer, &buffer[10], 4);
+    assert_int_equal (offset, 14);
+
+    offset = 0;
+    rc = Tss2_MU_TPM2B_ECC_POINT_Unmarshal(buffer, sizeof(buffer), &offset, &point);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_VALUE);
+    assert_int_equal (offset, 0);
+}
+
+/*
+ * The size of a TPM2B with a nested structure is that of the marshaled
+ * structure, independent of the size field in src.
+ */
+static void
+tpm2b_size(void **state) {
+    TPM2B_DIGEST dgst = {4, {0}};
+    TPM2B_PUBLIC pub = {0};
+    uint8_t buffer[sizeof(pub)] = { 0 };
+    size_t size = 0, offset = 0;
+    TSS2_RC rc;
+
+    rc = Tss2_MU_TPM2B_DIGEST_Size(&dgst, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, 2 + 4);
+
+    pub.publicArea.type = TPM2_ALG_KEYEDHASH;
+    pub.publicArea.nameAlg = TPM2_ALG_SHA256;
+    pub.publicArea.parameters.keyedHashDetail.scheme.scheme = TPM2_ALG_NULL;
+    pub.publicArea.unique.keyedHash.size = 32;
+    rc = Tss2_MU_TPM2B_PUBLIC_Marshal(&pub, buffer, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPM2B_PUBLIC_Size(&pub, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, offset);
+
+    rc = Tss2_MU_TPM2B_DIGEST_Size(NULL, &size);
+    assert_int_equal (rc, TSS2_MU_RC_BAD_REFERENCE);
+    rc = Tss2_MU_TPM2B_DIGEST_Size(&dgst, NULL);
+    assert_int_equal (rc, TSS2_MU_RC_BAD_REFERENCE);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(tpm2b_marshal_success),
@@ -368,6 +433,8 @@ int main(void) {
         cmocka_unit_test(tpm2b_unmarshal_dest_null),
         cmocka_unit_test(tpm2b_unmarshal_dest_null_offset_valid),
         cmocka_unit_test(tpm2b_unmarshal_buffer_size_lt_data_nad_lt_offset),
+        cmocka_unit_test(tpm2b_unmarshal_nested_size),
+        cmocka_unit_test(tpm2b_size),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
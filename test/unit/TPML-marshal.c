@@ -285,6 +285,8 @@ tpml_unmarshal_success(void **state)
         0xdd, 0xee};
 
     memcpy(buffer + 4 + 4 + 4, &data[0], sizeof(data));
+    /* The parts of the list that aren't unmarshaled are cleared. */
+    memset(&sel, 0xa5, sizeof(sel));
 
     rc = Tss2_MU_TPML_PCR_SELECTION_Unmarshal(buffer, buffer_size, &offset, &sel);
     assert_int_equal (rc, TSS2_RC_SUCCESS);
@@ -298,6 +300,9 @@ tpml_unmarshal_success(void **state)
     assert_int_equal (sel.pcrSelections[1].sizeofSelect, 2);
     assert_int_equal (sel.pcrSelections[1].pcrSelect[0], 0xdd);
     assert_int_equal (sel.pcrSelections[1].pcrSelect[1], 0xee);
+    assert_int_equal (sel.pcrSelections[1].pcrSelect[2], 0);
+    assert_int_equal (sel.pcrSelections[2].hash, 0);
+    assert_int_equal (sel.pcrSelections[2].sizeofSelect, 0);
     assert_int_equal (offset, 4 + 4 + 4 + 4 + 2 + 1 + 1 + 1 + 1 + 2 + 1 + 1 + 1);
 }
 
@@ -449,6 +454,144 @@ tpml_unmarshal_invalid_count(void **state)
     assert_int_equal (rc, TSS2_SYS_RC_MALFORMED_RESPONSE);
 }
 
+/*
+ * Marshaling without a buffer reports the size of a list of nested
+ * structures, and still checks it against buffer_size.
+ */
+static void
+tpml_marshal_buffer_null_nested(void **state)
+{
+    TPML_DIGEST digests = {0};
+    uint8_t buffer[sizeof(digests)] = { 0 };
+    size_t marshaled = 0, offset = 0;
+    TSS2_RC rc;
+
+    digests.count = 2;
+    digests.digests[0].size = 20;
+    digests.digests[1].size = 32;
+
+    rc = Tss2_MU_TPML_DIGEST_Marshal(&digests, buffer, sizeof(buffer), &marshaled);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (marshaled, 4 + 2 + 20 + 2 + 32);
+
+    rc = Tss2_MU_TPML_DIGEST_Marshal(&digests, NULL, sizeof(buffer), &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset, marshaled);
+
+    offset = 0;
+    rc = Tss2_MU_TPML_DIGEST_Marshal(&digests, NULL, marshaled - 1, &offset);
+    assert_int_equal (rc, TSS2_MU_RC_INSUFFICIENT_BUFFER);
+    assert_int_equal (offset, 0);
+}
+
+/*
+ * Lists of structures made of integers only: fields of different widths,
+ * padding in the C structure and a buffer one byte short of the list.
+ */
+static void
+tpml_integer_struct_items(void **state)
+{
+    TPML_ALG_PROPERTY algs = {0};
+    TPML_ALG_PROPERTY algs_out;
+    TPML_TAGGED_TPM_PROPERTY props = {0};
+    uint8_t buffer[64] = { 0 };
+    size_t offset = 0;
+    TSS2_RC rc;
+
+    algs.count = 2;
+    algs.algProperties[0].alg = TPM2_ALG_SHA256;
+    algs.algProperties[0].algProperties = TPMA_ALGORITHM_HASH;
+    algs.algProperties[1].alg = TPM2_ALG_RSA;
+    algs.algProperties[1].algProperties = TPMA_ALGORITHM_ASYMMETRIC |
+                                          TPMA_ALGORITHM_OBJECT;
+
+    rc = Tss2_MU_TPML_ALG_PROPERTY_Marshal(&algs, buffer, sizeof(buffer),
+                                           &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    uint8_t expect [] = {
+        0, 0, 0, 2,
+        0, 0x0b, 0, 0, 0, 0x04,
+        0, 0x01, 0, 0, 0, 0x09};
+
+    assert_int_equal (offset, sizeof(expect));
+    assert_memory_equal(buffer, &expect[0], sizeof(expect));
+
+    memset(&algs_out, 0xff, sizeof(algs_out));
+    offset = 0;
+    rc = Tss2_MU_TPML_ALG_PROPERTY_Unmarshal(buffer, sizeof(expect), &offset,
+                                             &algs_out);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset, sizeof(expect));
+    assert_memory_equal(&algs_out, &algs, sizeof(algs));
+
+    props.count = 3;
+    props.tpmProperty[2].property = TPM2_PT_MANUFACTURER;
+    props.tpmProperty[2].value = 0x49424d00;
+    offset = 0;
+    rc = Tss2_MU_TPML_TAGGED_TPM_PROPERTY_Marshal(&props, buffer, 4 + 3 * 8 - 1,
+                                                  &offset);
+    assert_int_equal (rc, TSS2_MU_RC_INSUFFICIENT_BUFFER);
+    assert_int_equal (offset, 0);
+
+    rc = Tss2_MU_TPML_TAGGED_TPM_PROPERTY_Marshal(&props, buffer, 4 + 3 * 8,
+                                                  &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset, 4 + 3 * 8);
+
+    offset = 0;
+    rc = Tss2_MU_TPML_TAGGED_TPM_PROPERTY_Unmarshal(buffer, 4 + 3 * 8 - 1,
+                                                    &offset, &props);
+    assert_int_equal (rc, TSS2_MU_RC_INSUFFICIENT_BUFFER);
+    assert_int_equal (offset, 0);
+
+    memset(&props, 0, sizeof(props));
+    rc = Tss2_MU_TPML_TAGGED_TPM_PROPERTY_Unmarshal(buffer, 4 + 3 * 8,
+                                                    &offset, &props);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset, 4 + 3 * 8);
+    assert_int_equal (props.count, 3);
+    assert_int_equal (props.tpmProperty[2].property, TPM2_PT_MANUFACTURER);
+    assert_int_equal (props.tpmProperty[2].value, 0x49424d00);
+
+    rc = Tss2_MU_TPML_TAGGED_TPM_PROPERTY_Size(&props, &offset);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset, 4 + 3 * 8);
+}
+
+/*
+ * Size of lists of fixed and variable sized items, and of a list with an
+ * invalid count.
+ */
+static void
+tpml_size(void **state)
+{
+    TPML_HANDLE hndl = {0};
+    TPML_PCR_SELECTION sel = {0};
+    size_t size = 0;
+    TSS2_RC rc;
+
+    hndl.count = 2;
+    rc = Tss2_MU_TPML_HANDLE_Size(&hndl, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, 4 + 2 * 4);
+
+    sel.count = 2;
+    sel.pcrSelections[0].sizeofSelect = 3;
+    sel.pcrSelections[1].sizeofSelect = 2;
+    rc = Tss2_MU_TPML_PCR_SELECTION_Size(&sel, &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, 4 + 2 + 1 + 3 + 2 + 1 + 2);
+
+    sel.pcrSelections[1].sizeofSelect = TPM2_PCR_SELECT_MAX + 1;
+    rc = Tss2_MU_TPML_PCR_SELECTION_Size(&sel, &size);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_VALUE);
+
+    hndl.count = TPM2_MAX_CAP_HANDLES + 1;
+    rc = Tss2_MU_TPML_HANDLE_Size(&hndl, &size);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_VALUE);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test (tpml_marshal_success),
@@ -457,6 +600,9 @@ int main(void) {
         cmocka_unit_test (tpml_marshal_buffer_null_offset_null),
         cmocka_unit_test (tpml_marshal_buffer_size_lt_data_nad_lt_offset),
         cmocka_unit_test (tpml_marshal_invalid_count),
+        cmocka_unit_test (tpml_marshal_buffer_null_nested),
+        cmocka_unit_test (tpml_size),
+        cmocka_unit_test (tpml_integer_struct_items),
         cmocka_unit_test (tpml_unmarshal_success),
         cmocka_unit_test (tpml_unmarshal_dest_null_buff_null),
         cmocka_unit_test (tpml_unmarshal_buffer_null_offset_null),
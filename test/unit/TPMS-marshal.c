@@ -338,6 +338,33 @@ tpms_unmarshal_buffer_size_lt_data_nad_lt_offset(void **state)
     assert_int_equal (offset, sizeof(alg));
 }
 
+/*
+ * Skipping a TPMS_ATTEST (NULL dest) must still select the attested union
+ * member from the type field, so the offset covers the whole structure.
+ */
+static void
+tpms_unmarshal_attest_dest_null(void **state)
+{
+    TPMS_ATTEST attest = {0};
+    uint8_t buffer[sizeof(attest)] = { 0 };
+    size_t marshaled = 0, offset = 0;
+    TSS2_RC rc;
+
+    attest.magic = TPM2_GENERATED_VALUE;
+    attest.type = TPM2_ST_ATTEST_QUOTE;
+    attest.attested.quote.pcrSelect.count = 1;
+    attest.attested.quote.pcrSelect.pcrSelections[0].hash = TPM2_ALG_SHA256;
+    attest.attested.quote.pcrSelect.pcrSelections[0].sizeofSelect = 3;
+    attest.attested.quote.pcrDigest.size = 32;
+
+    rc = Tss2_MU_TPMS_ATTEST_Marshal(&attest, buffer, sizeof(buffer), &marshaled);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    rc = Tss2_MU_TPMS_ATTEST_Unmarshal(buffer, marshaled, &offset, NULL);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (offset, marshaled);
+}
+
 int main(void) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test (tpms_marshal_success),
@@ -350,6 +377,7 @@ int main(void) {
         cmocka_unit_test (tpms_unmarshal_buffer_null_offset_null),
         cmocka_unit_test (tpms_unmarshal_dest_null_offset_valid),
         cmocka_unit_test (tpms_unmarshal_buffer_size_lt_data_nad_lt_offset),
+        cmocka_unit_test (tpms_unmarshal_attest_dest_null),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -0,0 +1,375 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+#include "tss2_mu.h"
+
+#include "tss2-esys/esys_iutil.h"
+#define LOGMODULE tests
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/**
+ * This unit test checks the capability cache against a TCTI that answers
+ * TPM2_GetCapability with values that change after TPM2_Startup and
+ * TPM2_PCR_Allocate, and counts the commands it receives.
+ */
+
+#define TCTI_CAPABILITY_MAGIC 0x4341504142494c49ULL     /* 'CAPABILI' */
+#define TCTI_CAPABILITY_VERSION 0x1
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC(*finalize) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*cancel) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*getPollHandles) (TSS2_TCTI_CONTEXT * tctiContext,
+                           TSS2_TCTI_POLL_HANDLE * handles,
+                           size_t * num_handles);
+    TSS2_RC(*setLocality) (TSS2_TCTI_CONTEXT * tctiContext, uint8_t locality);
+    TPM2_CC command;
+    TPM2_CAP capability;
+    UINT32 property;
+    UINT32 propertyCount;
+    UINT32 generation;           /* Changed by Startup and PCR_Allocate */
+    size_t capabilities;         /* The number of GetCapability commands */
+} TSS2_TCTI_CONTEXT_CAPABILITY;
+
+static TSS2_RC
+tcti_capability_transmit(TSS2_TCTI_CONTEXT * tctiContext,
+                         size_t size, const uint8_t * buffer)
+{
+    TSS2_TCTI_CONTEXT_CAPABILITY *tcti =
+        (TSS2_TCTI_CONTEXT_CAPABILITY *) tctiContext;
+    size_t offset = sizeof(TPM2_ST) + sizeof(UINT32);
+
+    assert_int_equal(Tss2_MU_TPM2_CC_Unmarshal(buffer, size, &offset,
+                                               &tcti->command),
+                     TSS2_RC_SUCCESS);
+    switch (tcti->command) {
+    case TPM2_CC_GetCapability:
+        tcti->capabilities++;
+        Tss2_MU_UINT32_Unmarshal(buffer, size, &offset, &tcti->capability);
+        Tss2_MU_UINT32_Unmarshal(buffer, size, &offset, &tcti->property);
+        Tss2_MU_UINT32_Unmarshal(buffer, size, &offset, &tcti->propertyCount);
+        break;
+    case TPM2_CC_Startup:
+    case TPM2_CC_PCR_Allocate:
+        tcti->generation++;
+        break;
+    default:
+        fail_msg("Unexpected command 0x%" PRIx32, tcti->command);
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_capability_receive(TSS2_TCTI_CONTEXT * tctiContext,
+                        size_t * response_size,
+                        uint8_t * response_buffer, int32_t timeout)
+{
+    TSS2_TCTI_CONTEXT_CAPABILITY *tcti =
+        (TSS2_TCTI_CONTEXT_CAPABILITY *) tctiContext;
+    TPMS_CAPABILITY_DATA data = { .capability = tcti->capability };
+    TPML_TAGGED_TPM_PROPERTY *props = &data.data.tpmProperties;
+    TPM2_ST tag = TPM2_ST_NO_SESSIONS;
+    size_t offset = sizeof(TPM2_ST) + sizeof(UINT32) + sizeof(TPM2_RC);
+    size_t parameters = offset;
+    (void) timeout;
+
+    switch (tcti->command) {
+    case TPM2_CC_GetCapability:
+        if (tcti->capability == TPM2_CAP_TPM_PROPERTIES) {
+            for (UINT32 i = 0; i < tcti->propertyCount && i < 4; i++) {
+                props->tpmProperty[i].property = tcti->property + i;
+                props->tpmProperty[i].value = tcti->generation;
+            }
+            props->count = (tcti->propertyCount < 4) ? tcti->propertyCount
+                                                     : 4;
+        } else if (tcti->capability == TPM2_CAP_ALGS) {
+            data.data.algorithms.count = 1;
+            data.data.algorithms.algProperties[0].alg = TPM2_ALG_SHA256;
+            data.data.algorithms.algProperties[0].algProperties =
+                tcti->generation;
+        }
+        Tss2_MU_BYTE_Marshal(TPM2_YES, response_buffer, *response_size,
+                             &offset);
+        Tss2_MU_TPMS_CAPABILITY_DATA_Marshal(&data, response_buffer,
+                                             *response_size, &offset);
+        break;
+    case TPM2_CC_PCR_Allocate:
+        tag = TPM2_ST_SESSIONS;
+        offset += sizeof(UINT32);
+        Tss2_MU_BYTE_Marshal(TPM2_YES, response_buffer, *response_size,
+                             &offset);
+        Tss2_MU_UINT32_Marshal(24, response_buffer, *response_size, &offset);
+        Tss2_MU_UINT32_Marshal(0, response_buffer, *response_size, &offset);
+        Tss2_MU_UINT32_Marshal(0, response_buffer, *response_size, &offset);
+        Tss2_MU_UINT32_Marshal(offset - parameters - sizeof(UINT32),
+                               response_buffer, *response_size, &parameters);
+        Tss2_MU_UINT16_Marshal(0, response_buffer, *response_size, &offset);
+        Tss2_MU_BYTE_Marshal(TPMA_SESSION_CONTINUESESSION, response_buffer,
+                             *response_size, &offset);
+        Tss2_MU_UINT16_Marshal(0, response_buffer, *response_size, &offset);
+        break;
+    default:
+        break;
+    }
+
+    *response_size = offset;
+    offset = 0;
+    Tss2_MU_TPM2_ST_Marshal(tag, response_buffer, *response_size, &offset);
+    Tss2_MU_UINT32_Marshal(*response_size, response_buffer, *response_size,
+                           &offset);
+    Tss2_MU_UINT32_Marshal(TPM2_RC_SUCCESS, response_buffer, *response_size,
+                           &offset);
+
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+tcti_capability_finalize(TSS2_TCTI_CONTEXT * tctiContext)
+{
+    (void)(tctiContext);
+}
+
+static int
+setup(void **state)
+{
+    TSS2_RC r;
+    ESYS_CONTEXT *ectx;
+    TSS2_TCTI_CONTEXT_CAPABILITY *tcti = calloc(1, sizeof(*tcti));
+
+    if (tcti == NULL)
+        return -1;
+    TSS2_TCTI_MAGIC(tcti) = TCTI_CAPABILITY_MAGIC;
+    TSS2_TCTI_VERSION(tcti) = TCTI_CAPABILITY_VERSION;
+    TSS2_TCTI_TRANSMIT(tcti) = tcti_capability_transmit;
+    TSS2_TCTI_RECEIVE(tcti) = tcti_capability_receive;
+    TSS2_TCTI_FINALIZE(tcti) = tcti_capability_finalize;
+
+    r = Esys_Initialize(&ectx, (TSS2_TCTI_CONTEXT *) tcti, NULL);
+    if (r)
+        return (int)r;
+    *state = (void *)ectx;
+    return 0;
+}
+
+static int
+teardown(void **state)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+
+    Esys_GetTcti(ectx, &tcti);
+    Esys_Finalize(&ectx);
+    free(tcti);
+    return 0;
+}
+
+static TSS2_TCTI_CONTEXT_CAPABILITY *
+get_tcti(ESYS_CONTEXT *ectx)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+
+    assert_int_equal(Esys_GetTcti(ectx, &tcti), TSS2_RC_SUCCESS);
+    return (TSS2_TCTI_CONTEXT_CAPABILITY *) tcti;
+}
+
+/** Get a TPM property and check it against the TCTI's generation. */
+static void
+get_property(ESYS_CONTEXT *ectx, UINT32 property, UINT32 count)
+{
+    TPMI_YES_NO moreData = TPM2_NO;
+    TPMS_CAPABILITY_DATA *capabilityData = NULL;
+
+    assert_int_equal(Esys_GetCapability(ectx, ESYS_TR_NONE, ESYS_TR_NONE,
+                                        ESYS_TR_NONE, TPM2_CAP_TPM_PROPERTIES,
+                                        property, count, &moreData,
+                                        &capabilityData),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(moreData, TPM2_YES);
+    assert_int_equal(capabilityData->capability, TPM2_CAP_TPM_PROPERTIES);
+    assert_int_equal(capabilityData->data.tpmProperties.count, count);
+    for (UINT32 i = 0; i < count; i++) {
+        assert_int_equal(capabilityData->data.tpmProperties.tpmProperty[i]
+                         .property, property + i);
+        assert_int_equal(capabilityData->data.tpmProperties.tpmProperty[i]
+                         .value, get_tcti(ectx)->generation);
+    }
+    free(capabilityData);
+}
+
+static void
+test_bad_parameters(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+
+    assert_int_equal(Esys_CapabilityCache_Enable(NULL, TPM2_YES),
+                     TSS2_ESYS_RC_BAD_REFERENCE);
+    assert_int_equal(Esys_CapabilityCache_Invalidate(NULL),
+                     TSS2_ESYS_RC_BAD_REFERENCE);
+    assert_int_equal(Esys_CapabilityCache_Invalidate(ectx), TSS2_RC_SUCCESS);
+}
+
+/** Without enabling the cache every call goes to the TPM. */
+static void
+test_disabled(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_CAPABILITY *tcti = get_tcti(ectx);
+
+    get_property(ectx, TPM2_PT_NV_BUFFER_MAX, 1);
+    get_property(ectx, TPM2_PT_NV_BUFFER_MAX, 1);
+    assert_int_equal(tcti->capabilities, 2);
+
+    assert_int_equal(Esys_CapabilityCache_Enable(ectx, TPM2_YES),
+                     TSS2_RC_SUCCESS);
+    get_property(ectx, TPM2_PT_NV_BUFFER_MAX, 1);
+    get_property(ectx, TPM2_PT_NV_BUFFER_MAX, 1);
+    assert_int_equal(tcti->capabilities, 3);
+
+    assert_int_equal(Esys_CapabilityCache_Enable(ectx, TPM2_NO),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(ectx->capability_cache.count, 0);
+    get_property(ectx, TPM2_PT_NV_BUFFER_MAX, 1);
+    assert_int_equal(tcti->capabilities, 4);
+}
+
+/** Fixed properties and algorithms are cached, variable properties not. */
+static void
+test_cacheable(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_CAPABILITY *tcti = get_tcti(ectx);
+    TPMI_YES_NO moreData;
+    TPMS_CAPABILITY_DATA *capabilityData = NULL;
+
+    assert_int_equal(Esys_CapabilityCache_Enable(ectx, TPM2_YES),
+                     TSS2_RC_SUCCESS);
+
+    /* Different requests are cached separately */
+    get_property(ectx, TPM2_PT_INPUT_BUFFER, 1);
+    get_property(ectx, TPM2_PT_INPUT_BUFFER, 2);
+    get_property(ectx, TPM2_PT_INPUT_BUFFER, 1);
+    get_property(ectx, TPM2_PT_INPUT_BUFFER, 2);
+    assert_int_equal(tcti->capabilities, 2);
+
+    /* Ranges running into the variable properties are not */
+    get_property(ectx, TPM2_PT_VAR - 1, 2);
+    get_property(ectx, TPM2_PT_VAR - 1, 2);
+    get_property(ectx, TPM2_PT_HR_LOADED_AVAIL, 1);
+    get_property(ectx, TPM2_PT_HR_LOADED_AVAIL, 1);
+    assert_int_equal(tcti->capabilities, 6);
+
+    assert_int_equal(Esys_GetCapability(ectx, ESYS_TR_NONE, ESYS_TR_NONE,
+                                        ESYS_TR_NONE, TPM2_CAP_ALGS,
+                                        TPM2_ALG_FIRST, 1, &moreData,
+                                        &capabilityData),
+                     TSS2_RC_SUCCESS);
+    free(capabilityData);
+    assert_int_equal(Esys_GetCapability(ectx, ESYS_TR_NONE, ESYS_TR_NONE,
+                                        ESYS_TR_NONE, TPM2_CAP_ALGS,
+                                        TPM2_ALG_FIRST, 1, NULL,
+                                        &capabilityData),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(capabilityData->data.algorithms.count, 1);
+    assert_int_equal(capabilityData->data.algorithms.algProperties[0].alg,
+                     TPM2_ALG_SHA256);
+    free(capabilityData);
+    assert_int_equal(tcti->capabilities, 7);
+}
+
+/** Cached responses are delivered by the asynchronous functions, too. */
+static void
+test_async(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_CAPABILITY *tcti = get_tcti(ectx);
+    TPMI_YES_NO moreData = TPM2_NO;
+    TPMS_CAPABILITY_DATA *capabilityData = NULL;
+
+    assert_int_equal(Esys_CapabilityCache_Enable(ectx, TPM2_YES),
+                     TSS2_RC_SUCCESS);
+    get_property(ectx, TPM2_PT_MAX_DIGEST, 1);
+
+    assert_int_equal(Esys_GetCapability_Async(ectx, ESYS_TR_NONE,
+                                              ESYS_TR_NONE, ESYS_TR_NONE,
+                                              TPM2_CAP_TPM_PROPERTIES,
+                                              TPM2_PT_MAX_DIGEST, 1),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_CapabilityCache_Invalidate(ectx),
+                     TSS2_ESYS_RC_BAD_SEQUENCE);
+    assert_int_equal(Esys_GetCapability_Finish(ectx, &moreData,
+                                               &capabilityData),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(moreData, TPM2_YES);
+    assert_int_equal(capabilityData->data.tpmProperties.tpmProperty[0]
+                     .property, TPM2_PT_MAX_DIGEST);
+    free(capabilityData);
+    assert_int_equal(tcti->capabilities, 1);
+    assert_int_equal(Esys_GetCapability_Finish(ectx, &moreData,
+                                               &capabilityData),
+                     TSS2_ESYS_RC_BAD_SEQUENCE);
+}
+
+/** The cache is dropped by commands that change the capabilities. */
+static void
+test_invalidate(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_CAPABILITY *tcti = get_tcti(ectx);
+    TPML_PCR_SELECTION pcrAllocation = { .count = 0 };
+    TPMI_YES_NO allocationSuccess;
+    UINT32 maxPCR, sizeNeeded, sizeAvailable;
+
+    assert_int_equal(Esys_CapabilityCache_Enable(ectx, TPM2_YES),
+                     TSS2_RC_SUCCESS);
+    get_property(ectx, TPM2_PT_NV_BUFFER_MAX, 1);
+
+    assert_int_equal(Esys_Startup(ectx, TPM2_SU_CLEAR), TSS2_RC_SUCCESS);
+    get_property(ectx, TPM2_PT_NV_BUFFER_MAX, 1);
+    get_property(ectx, TPM2_PT_NV_BUFFER_MAX, 1);
+    assert_int_equal(tcti->capabilities, 2);
+
+    assert_int_equal(Esys_PCR_Allocate(ectx, ESYS_TR_RH_PLATFORM,
+                                       ESYS_TR_PASSWORD, ESYS_TR_NONE,
+                                       ESYS_TR_NONE, &pcrAllocation,
+                                       &allocationSuccess, &maxPCR,
+                                       &sizeNeeded, &sizeAvailable),
+                     TSS2_RC_SUCCESS);
+    get_property(ectx, TPM2_PT_NV_BUFFER_MAX, 1);
+    assert_int_equal(tcti->capabilities, 3);
+
+    assert_int_equal(Esys_CapabilityCache_Invalidate(ectx), TSS2_RC_SUCCESS);
+    get_property(ectx, TPM2_PT_NV_BUFFER_MAX, 1);
+    get_property(ectx, TPM2_PT_NV_BUFFER_MAX, 1);
+    assert_int_equal(tcti->capabilities, 4);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_bad_parameters, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_disabled, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_cacheable, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_async, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_invalidate, setup, teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -291,6 +291,9 @@ check_Unseal(void **state)
 
     r = Esys_Unseal_Finish(NULL, NULL);
     assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    r = Esys_Unseal_FinishInto(NULL, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
 }
 
 void
@@ -623,6 +626,9 @@ check_GetRandom(void **state)
 
     r = Esys_GetRandom_Finish(NULL, NULL);
     assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    r = Esys_GetRandom_FinishInto(NULL, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
 }
 
 void
@@ -969,6 +975,9 @@ check_Sign(void **state)
 
     r = Esys_Sign_Finish(NULL, NULL);
     assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    r = Esys_Sign_FinishInto(NULL, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
 }
 
 void
@@ -1050,6 +1059,9 @@ check_PCR_Read(void **state)
 
     r = Esys_PCR_Read_Finish(NULL, NULL, NULL, NULL);
     assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    r = Esys_PCR_Read_FinishInto(NULL, NULL, NULL, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
 }
 
 void
@@ -1553,6 +1565,9 @@ check_CreatePrimary(void **state)
 
     r = Esys_CreatePrimary_Finish(NULL, NULL, NULL, NULL, NULL, NULL);
     assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    r = Esys_CreatePrimary_FinishInto(NULL, NULL, NULL, NULL, NULL, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
 }
 
 void
@@ -2203,6 +2218,9 @@ check_NV_Read(void **state)
 
     r = Esys_NV_Read_Finish(NULL, NULL);
     assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    r = Esys_NV_Read_FinishInto(NULL, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
 }
 
 void
@@ -138,6 +138,105 @@ check_random(void **state)
     assert_int_equal (rc, TSS2_RC_SUCCESS);
 } 
 
+static void
+check_random_pool(void **state)
+{
+    TSS2_RC rc;
+    IESYS_RANDOM_POOL pool = { .available = 0 };
+    TPM2B_NONCE nonce1, nonce2;
+    size_t i;
+
+    rc = iesys_crypto_random_pool_get(&pool, NULL, 32);
+    assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    rc = iesys_crypto_random_pool_get(&pool, &nonce1, sizeof(TPMU_HA) + 1);
+    assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
+
+    /* A NULL pool falls back to the backend */
+    rc = iesys_crypto_random_pool_get(NULL, &nonce1, 0);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (nonce1.size, sizeof(TPMU_HA));
+
+    /* The first draw fills the pool and served bytes are wiped */
+    rc = iesys_crypto_random_pool_get(&pool, &nonce1, 32);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (nonce1.size, 32);
+    assert_int_equal (pool.available, IESYS_RANDOM_POOL_SIZE - 32);
+    for (i = 0; i < 32; i++)
+        assert_int_equal (pool.buffer[i], 0);
+
+    rc = iesys_crypto_random_pool_get(&pool, &nonce2, 32);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_not_equal (&nonce1.buffer[0], &nonce2.buffer[0], 32);
+
+    /* The pool is refilled once the remaining bytes don't suffice */
+    pool.available = 16;
+    rc = iesys_crypto_random_pool_get(&pool, &nonce1, 32);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (pool.available, IESYS_RANDOM_POOL_SIZE - 32);
+
+    /* A pool filled by another process is discarded */
+    pool.pid = pool.pid + 1;
+    rc = iesys_crypto_random_pool_get(&pool, &nonce1, 32);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (pool.available, IESYS_RANDOM_POOL_SIZE - 32);
+
+    iesys_crypto_random_pool_free(&pool);
+    assert_int_equal (pool.available, 0);
+}
+
+static void
+check_random_pool_size(void **state)
+{
+    TSS2_RC rc;
+    IESYS_RANDOM_POOL pool = { .available = 0 };
+    TPM2B_NONCE nonce1, nonce2;
+
+    rc = iesys_crypto_random_pool_set_size(NULL, 0);
+    assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    rc = iesys_crypto_random_pool_set_size(&pool, sizeof(TPMU_HA) - 1);
+    assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
+
+    rc = iesys_crypto_random_pool_set_size(&pool, IESYS_RANDOM_POOL_SIZE + 1);
+    assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
+
+    /* A smaller budget refills after fewer bytes */
+    rc = iesys_crypto_random_pool_set_size(&pool, 2 * sizeof(TPMU_HA));
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    rc = iesys_crypto_random_pool_get(&pool, &nonce1, sizeof(TPMU_HA));
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (pool.available, sizeof(TPMU_HA));
+
+    rc = iesys_crypto_random_pool_get(&pool, &nonce2, sizeof(TPMU_HA));
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (pool.available, 0);
+    assert_memory_not_equal (&nonce1.buffer[0], &nonce2.buffer[0],
+                             sizeof(TPMU_HA));
+
+    rc = iesys_crypto_random_pool_get(&pool, &nonce1, 32);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (pool.available, 2 * sizeof(TPMU_HA) - 32);
+
+    /* Setting the size discards the unused bytes, freeing keeps the size */
+    rc = iesys_crypto_random_pool_set_size(&pool, 0);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (pool.available, 0);
+
+    rc = iesys_crypto_random_pool_get(&pool, &nonce1, 32);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (pool.available, IESYS_RANDOM_POOL_SIZE - 32);
+
+    rc = iesys_crypto_random_pool_set_size(&pool, sizeof(TPMU_HA));
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    iesys_crypto_random_pool_free(&pool);
+    assert_int_equal (pool.refill_size, sizeof(TPMU_HA));
+
+    assert_int_equal (Esys_SetRandomPoolSize(NULL, 0),
+                      TSS2_ESYS_RC_BAD_REFERENCE);
+}
+
 static void
 check_pk_encrypt(void **state)
 {
@@ -181,15 +280,81 @@ check_pk_encrypt(void **state)
     };
    
     inPublicRSA.publicArea.nameAlg = 0;
-    rc = iesys_crypto_pk_encrypt(&inPublicRSA, size, &in_buffer[0], size, &out_buffer[0], &size, "LABEL");
+    rc = iesys_crypto_pk_encrypt(NULL, &inPublicRSA, size, &in_buffer[0], size, &out_buffer[0], &size, "LABEL");
     assert_int_equal (rc, TSS2_ESYS_RC_NOT_IMPLEMENTED);
 
     inPublicRSA.publicArea.nameAlg = TPM2_ALG_SHA1;
     inPublicRSA.publicArea.parameters.rsaDetail.scheme.scheme = 0;
-    rc = iesys_crypto_pk_encrypt(&inPublicRSA, size, &in_buffer[0], size, &out_buffer[0], &size, "LABEL");
+    rc = iesys_crypto_pk_encrypt(NULL, &inPublicRSA, size, &in_buffer[0], size, &out_buffer[0], &size, "LABEL");
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
 }
 
+static void
+check_pubkey_cache(void **state)
+{
+    TSS2_RC rc;
+    uint8_t in_buffer[32] = { 1, 2, 3, 4, 5 };
+    uint8_t out_buffer[256];
+    size_t size;
+    IESYS_CRYPTO_PUBKEY *pubkey = NULL, *first;
+    TPM2B_PUBLIC inPublicRSA = {
+        .size = 0,
+        .publicArea = {
+            .type = TPM2_ALG_RSA,
+            .nameAlg = TPM2_ALG_SHA256,
+            .parameters.rsaDetail = {
+                 .scheme = { .scheme = TPM2_ALG_OAEP },
+                 .keyBits = 2048,
+                 .exponent = 0,
+             },
+            .unique.rsa = { .size = 256 },
+        }
+    };
+    TPMT_PUBLIC other;
+
+    memset(&inPublicRSA.publicArea.unique.rsa.buffer[0], 0xa5, 256);
+    inPublicRSA.publicArea.unique.rsa.buffer[0] = 0xc3;
+
+    rc = iesys_crypto_pk_encrypt(&pubkey, &inPublicRSA, sizeof(in_buffer),
+                                 &in_buffer[0], sizeof(out_buffer),
+                                 &out_buffer[0], &size, "SECRET");
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, 256);
+    assert_non_null (pubkey);
+    first = pubkey;
+
+    /* The conversion is reused for the same key material */
+    inPublicRSA.publicArea.parameters.rsaDetail.scheme.scheme = TPM2_ALG_RSAES;
+    rc = iesys_crypto_pk_encrypt(&pubkey, &inPublicRSA, sizeof(in_buffer),
+                                 &in_buffer[0], sizeof(out_buffer),
+                                 &out_buffer[0], &size, "SECRET");
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_ptr_equal (pubkey, first);
+
+    other = inPublicRSA.publicArea;
+    assert_true (iesys_crypto_pubkey_matches(&inPublicRSA.publicArea, &other));
+    other.unique.rsa.buffer[128] ^= 1;
+    assert_false (iesys_crypto_pubkey_matches(&inPublicRSA.publicArea, &other));
+    other = inPublicRSA.publicArea;
+    other.parameters.rsaDetail.exponent = 3;
+    assert_false (iesys_crypto_pubkey_matches(&inPublicRSA.publicArea, &other));
+    other = inPublicRSA.publicArea;
+    other.type = TPM2_ALG_ECC;
+    assert_false (iesys_crypto_pubkey_matches(&inPublicRSA.publicArea, &other));
+
+    /* A different key replaces the conversion */
+    inPublicRSA.publicArea.unique.rsa.buffer[128] ^= 1;
+    rc = iesys_crypto_pk_encrypt(&pubkey, &inPublicRSA, sizeof(in_buffer),
+                                 &in_buffer[0], sizeof(out_buffer),
+                                 &out_buffer[0], &size, "SECRET");
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_non_null (pubkey);
+
+    iesys_crypto_pubkey_free(&pubkey);
+    assert_null (pubkey);
+    iesys_crypto_pubkey_free(&pubkey);
+}
+
 static void
 check_aes_encrypt(void **state)
 {
@@ -199,38 +364,300 @@ check_aes_encrypt(void **state)
     uint8_t buffer[5] = { 1, 2, 3, 4, 5 };
     size_t size = 5;
 
-    rc = iesys_crypto_sym_aes_encrypt(NULL, TPM2_ALG_AES, 192, TPM2_ALG_CFB, 16,
+    rc = iesys_crypto_sym_aes_encrypt(NULL, NULL, TPM2_ALG_AES, 192,
+                                      TPM2_ALG_CFB, 16,
                                       &buffer[0], size, &key[0]);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
     
-    rc = iesys_crypto_sym_aes_encrypt(&key[0], TPM2_ALG_AES, 192, TPM2_ALG_CFB, 16,
+    rc = iesys_crypto_sym_aes_encrypt(NULL, &key[0], TPM2_ALG_AES, 192,
+                                      TPM2_ALG_CFB, 16,
                                       &buffer[0], size, &key[0]);
     assert_int_equal (rc, TSS2_RC_SUCCESS);
-    rc = iesys_crypto_sym_aes_encrypt(&key[0], TPM2_ALG_AES, 256, TPM2_ALG_CFB, 16,
+    rc = iesys_crypto_sym_aes_encrypt(NULL, &key[0], TPM2_ALG_AES, 256,
+                                      TPM2_ALG_CFB, 16,
                                       &buffer[0], size, &key[0]);
     assert_int_equal (rc, TSS2_RC_SUCCESS);
 
-    rc = iesys_crypto_sym_aes_encrypt(&key[0], 0, 256, TPM2_ALG_CFB, 16,
+    rc = iesys_crypto_sym_aes_encrypt(NULL, &key[0], 0, 256, TPM2_ALG_CFB, 16,
                                       &buffer[0], size, &key[0]);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
 
-    rc = iesys_crypto_sym_aes_encrypt(&key[0], TPM2_ALG_AES, 256, 0, 16,
+    rc = iesys_crypto_sym_aes_encrypt(NULL, &key[0], TPM2_ALG_AES, 256, 0, 16,
                                       &buffer[0], size, &key[0]);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
 
-    rc = iesys_crypto_sym_aes_encrypt(&key[0], TPM2_ALG_AES, 999, TPM2_ALG_CFB, 16,
+    rc = iesys_crypto_sym_aes_encrypt(NULL, &key[0], TPM2_ALG_AES, 999,
+                                      TPM2_ALG_CFB, 16,
                                       &buffer[0], size, &key[0]);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
 
-    rc = iesys_crypto_sym_aes_decrypt(NULL, TPM2_ALG_AES, 192, TPM2_ALG_CFB, 16,
+    rc = iesys_crypto_sym_aes_decrypt(NULL, NULL, TPM2_ALG_AES, 192,
+                                      TPM2_ALG_CFB, 16,
                                       &buffer[0], size, &key[0]);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_REFERENCE);
 
-    rc = iesys_crypto_sym_aes_decrypt(&key[0], 0, 192, TPM2_ALG_CFB, 16,
+    rc = iesys_crypto_sym_aes_decrypt(NULL, &key[0], 0, 192, TPM2_ALG_CFB, 16,
                                       &buffer[0], size, &key[0]);
     assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
 }
 
+static void
+check_aes_cipher_reuse(void **state)
+{
+    TSS2_RC rc;
+    IESYS_CRYPTO_CIPHER *cipher = NULL;
+    uint8_t key[32] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16,
+                       1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16  };
+    uint8_t iv[16] = { 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1 };
+    uint8_t plain[37], expected[37], buffer[37];
+    TPMI_AES_KEY_BITS key_bits[] = { 128, 256, 256, 128 };
+
+    for (size_t i = 0; i < sizeof(plain); i++)
+        plain[i] = (uint8_t) i;
+
+    /* A cached cipher object gives the results of a temporary one, also
+       after switching the key size or the direction */
+    for (size_t k = 0; k < sizeof(key_bits) / sizeof(key_bits[0]); k++) {
+        key[0] = (uint8_t) k;
+        memcpy(expected, plain, sizeof(plain));
+        rc = iesys_crypto_sym_aes_encrypt(NULL, &key[0], TPM2_ALG_AES,
+                                          key_bits[k], TPM2_ALG_CFB, 16,
+                                          &expected[0], sizeof(expected),
+                                          &iv[0]);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+        memcpy(buffer, plain, sizeof(plain));
+        rc = iesys_crypto_sym_aes_encrypt(&cipher, &key[0], TPM2_ALG_AES,
+                                          key_bits[k], TPM2_ALG_CFB, 16,
+                                          &buffer[0], sizeof(buffer), &iv[0]);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_non_null (cipher);
+        assert_memory_equal (buffer, expected, sizeof(buffer));
+
+        rc = iesys_crypto_sym_aes_decrypt(&cipher, &key[0], TPM2_ALG_AES,
+                                          key_bits[k], TPM2_ALG_CFB, 16,
+                                          &buffer[0], sizeof(buffer), &iv[0]);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_memory_equal (buffer, plain, sizeof(buffer));
+    }
+
+    /* A failed call leaves the object usable */
+    rc = iesys_crypto_sym_aes_encrypt(&cipher, &key[0], TPM2_ALG_AES, 999,
+                                      TPM2_ALG_CFB, 16,
+                                      &buffer[0], sizeof(buffer), &iv[0]);
+    assert_int_equal (rc, TSS2_ESYS_RC_BAD_VALUE);
+    rc = iesys_crypto_sym_aes_encrypt(&cipher, &key[0], TPM2_ALG_AES, 128,
+                                      TPM2_ALG_CFB, 16,
+                                      &buffer[0], sizeof(buffer), &iv[0]);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (buffer, expected, sizeof(buffer));
+
+    iesys_crypto_cipher_free(&cipher);
+    assert_null (cipher);
+    iesys_crypto_cipher_free(&cipher);
+}
+
+static void
+check_crypto_cache(void **state)
+{
+    TSS2_RC rc;
+    IESYS_CRYPTO_CACHE cache = { 0 };
+    IESYS_CRYPTO_CONTEXT_BLOB *context;
+    IESYS_CRYPTO_CONTEXT_BLOB *cached;
+    uint8_t key[131];
+    uint8_t digest[sizeof(TPMU_HA)];
+    size_t size;
+    const char *data1 = "what do ya want for nothing?";
+    const char *data2 = "Test Using Larger Than Block-Size Key - Hash Key First";
+    /* RFC 4231 test cases 2 and 6 */
+    uint8_t hmac1[] = {
+        0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e, 0x6a, 0x04, 0x24, 0x26,
+        0x08, 0x95, 0x75, 0xc7, 0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83,
+        0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43 };
+    uint8_t hmac2[] = {
+        0x60, 0xe4, 0x31, 0x59, 0x1e, 0xe0, 0xb6, 0x7f, 0x0d, 0x8a, 0x26, 0xaa,
+        0xcb, 0xf5, 0xb7, 0x7f, 0x8e, 0x0b, 0xc6, 0x21, 0x37, 0x28, 0xc5, 0x14,
+        0x05, 0x46, 0x04, 0x0f, 0x0e, 0xe3, 0x7f, 0x54 };
+
+    rc = iesys_crypto_cache_hmac_start(&cache, &context, TPM2_ALG_SHA256,
+                                       (const uint8_t *) "Jefe", 4);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    cached = context;
+    rc = iesys_crypto_hmac_update(context, (const uint8_t *) data1,
+                                  strlen(data1));
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    size = sizeof(digest);
+    rc = iesys_crypto_cache_hmac_finish(&cache, TPM2_ALG_SHA256, &context,
+                                        &digest[0], &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_null(context);
+    assert_int_equal (size, sizeof(hmac1));
+    assert_memory_equal(&digest[0], &hmac1[0], size);
+
+    /* The cached context is rekeyed instead of creating a new one */
+    memset(&key[0], 0xaa, sizeof(key));
+    rc = iesys_crypto_cache_hmac_start(&cache, &context, TPM2_ALG_SHA256,
+                                       &key[0], sizeof(key));
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_ptr_equal(context, cached);
+    rc = iesys_crypto_hmac_update(context, (const uint8_t *) data2,
+                                  strlen(data2));
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    size = sizeof(digest);
+    rc = iesys_crypto_cache_hmac_finish(&cache, TPM2_ALG_SHA256, &context,
+                                        &digest[0], &size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal(&digest[0], &hmac2[0], sizeof(hmac2));
+
+    /* A cached digest object computes the same digest as a fresh one */
+    uint8_t expected[sizeof(TPMU_HA)];
+    size_t expected_size = sizeof(expected);
+    rc = iesys_crypto_hash_start(&context, TPM2_ALG_SHA1);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = iesys_crypto_hash_update(context, &key[0], sizeof(key));
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = iesys_crypto_hash_finish(&context, &expected[0], &expected_size);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    for (int i = 0; i < 2; i++) {
+        rc = iesys_crypto_cache_hash_start(&cache, &context, TPM2_ALG_SHA1);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        if (i == 0)
+            cached = context;
+        else
+            assert_ptr_equal(context, cached);
+        rc = iesys_crypto_hash_update(context, &key[0], sizeof(key));
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        size = sizeof(digest);
+        rc = iesys_crypto_cache_hash_finish(&cache, TPM2_ALG_SHA1, &context,
+                                            &digest[0], &size);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_int_equal (size, expected_size);
+        assert_memory_equal(&digest[0], &expected[0], size);
+    }
+
+    rc = iesys_crypto_cache_hash_start(&cache, &context, 0);
+    assert_int_equal (rc, TSS2_ESYS_RC_NOT_IMPLEMENTED);
+
+    iesys_crypto_cache_free(&cache);
+    assert_null(cache.hash[0]);
+    assert_null(cache.hmac[1]);
+}
+
+static void
+check_hmac_reset(void **state)
+{
+    TSS2_RC rc;
+    IESYS_CRYPTO_CONTEXT_BLOB *context;
+    uint8_t digest[sizeof(TPMU_HA)];
+    size_t size;
+    const char *data = "what do ya want for nothing?";
+    /* RFC 4231 test case 2 */
+    uint8_t hmac[] = {
+        0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e, 0x6a, 0x04, 0x24, 0x26,
+        0x08, 0x95, 0x75, 0xc7, 0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83,
+        0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43 };
+
+    rc = iesys_crypto_hmac_start(&context, TPM2_ALG_SHA256,
+                                 (const uint8_t *) "Jefe", 4);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    /* The keyed state is restored without passing the key again */
+    for (int i = 0; i < 3; i++) {
+        rc = iesys_crypto_hmac_reset(context);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        if (i == 1) {
+            rc = iesys_crypto_hmac_update(context, (const uint8_t *) "garbage",
+                                          7);
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+            rc = iesys_crypto_hmac_reset(context);
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+        }
+        rc = iesys_crypto_hmac_update(context, (const uint8_t *) data,
+                                      strlen(data));
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        size = sizeof(digest);
+        rc = iesys_crypto_hmac_final(context, &digest[0], &size);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_int_equal (size, sizeof(hmac));
+        assert_memory_equal(&digest[0], &hmac[0], size);
+    }
+    iesys_crypto_hmac_abort(&context);
+    assert_null(context);
+}
+
+static void
+check_pHash_multi(void **state)
+{
+    TSS2_RC rc;
+    IESYS_CRYPTO_CACHE cache = { 0 };
+    TPM2_ALG_ID algs[] = { TPM2_ALG_SHA1, TPM2_ALG_SHA256, TPM2_ALG_SHA384 };
+    uint8_t digest[3][sizeof(TPMU_HA)];
+    size_t size[3];
+    uint8_t *digests[3];
+    size_t *sizes[3];
+    uint8_t expected[sizeof(TPMU_HA)];
+    size_t expected_size;
+    uint8_t rcBuffer[4] = { 0 };
+    uint8_t ccBuffer[4] = { 0x00, 0x00, 0x01, 0x37 };
+    TPM2B_NAME name = { .size = 4, .name = { 0x01, 0x00, 0x00, 0x01 } };
+    size_t buffer_size = 5000;
+    uint8_t *buffer = malloc(buffer_size);
+    assert_non_null(buffer);
+
+    for (size_t i = 0; i < buffer_size; i++)
+        buffer[i] = i * 7;
+
+    for (int i = 0; i < 3; i++) {
+        digests[i] = &digest[i][0];
+        sizes[i] = &size[i];
+    }
+
+    /* Every digest of a single pass equals the digest of a separate pass */
+    for (size_t count = 1; count <= 3; count++) {
+        for (size_t i = 0; i < count; i++)
+            size[i] = sizeof(TPMU_HA);
+        rc = iesys_crypto_pHash_multi(&cache, count, &algs[0], NULL,
+                                      &ccBuffer[0], &name, NULL, &name,
+                                      buffer, buffer_size, &digests[0],
+                                      &sizes[0]);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        for (size_t i = 0; i < count; i++) {
+            expected_size = sizeof(expected);
+            rc = iesys_crypto_cpHash(NULL, algs[i], &ccBuffer[0], &name, NULL,
+                                     &name, buffer, buffer_size, &expected[0],
+                                     &expected_size);
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+            assert_int_equal (size[i], expected_size);
+            assert_memory_equal(&digest[i][0], &expected[0], expected_size);
+        }
+
+        for (size_t i = 0; i < count; i++)
+            size[i] = sizeof(TPMU_HA);
+        rc = iesys_crypto_pHash_multi(&cache, count, &algs[0], &rcBuffer[0],
+                                      &ccBuffer[0], NULL, NULL, NULL,
+                                      buffer, 10, &digests[0], &sizes[0]);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        for (size_t i = 0; i < count; i++) {
+            expected_size = sizeof(expected);
+            rc = iesys_crypto_rpHash(NULL, algs[i], &rcBuffer[0], &ccBuffer[0],
+                                     buffer, 10, &expected[0], &expected_size);
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+            assert_int_equal (size[i], expected_size);
+            assert_memory_equal(&digest[i][0], &expected[0], expected_size);
+        }
+    }
+
+    algs[1] = 0;
+    rc = iesys_crypto_pHash_multi(&cache, 2, &algs[0], NULL, &ccBuffer[0],
+                                  NULL, NULL, NULL, buffer, buffer_size,
+                                  &digests[0], &sizes[0]);
+    assert_int_equal (rc, TSS2_ESYS_RC_NOT_IMPLEMENTED);
+
+    iesys_crypto_cache_free(&cache);
+    free(buffer);
+}
+
 static void
 check_free(void **state)
 {
@@ -249,8 +676,15 @@ main(int argc, char *argv[])
         cmocka_unit_test(check_hash_functions),
         cmocka_unit_test(check_hmac_functions),
         cmocka_unit_test(check_random),
+        cmocka_unit_test(check_random_pool),
+        cmocka_unit_test(check_random_pool_size),
         cmocka_unit_test(check_pk_encrypt),
+        cmocka_unit_test(check_pubkey_cache),
         cmocka_unit_test(check_aes_encrypt),
+        cmocka_unit_test(check_aes_cipher_reuse),
+        cmocka_unit_test(check_crypto_cache),
+        cmocka_unit_test(check_hmac_reset),
+        cmocka_unit_test(check_pHash_multi),
         cmocka_unit_test(check_free),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,476 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+#include "tss2_mu.h"
+
+#include "tss2-esys/esys_iutil.h"
+#define LOGMODULE tests
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/**
+ * This unit test checks the chunking of Esys_HashStream against a TCTI that
+ * implements a hash sequence with a small input buffer. The "digest" of the
+ * TCTI is the byte-wise sum of the data at position modulo 32.
+ */
+
+#define TCTI_HASH_STREAM_MAGIC 0x53545245414d0000ULL       /* 'STREAM\0\0' */
+#define TCTI_HASH_STREAM_VERSION 0x1
+
+#define INPUT_BUFFER 64
+#define SEQUENCE_HANDLE 0x80000001
+#define MAX_CHUNKS 16
+#define MAX_DATA 1024
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC(*finalize) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*cancel) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*getPollHandles) (TSS2_TCTI_CONTEXT * tctiContext,
+                           TSS2_TCTI_POLL_HANDLE * handles,
+                           size_t * num_handles);
+    TSS2_RC(*setLocality) (TSS2_TCTI_CONTEXT * tctiContext, uint8_t locality);
+    TPM2_CC command;
+    TPM2_RC update_rc;
+    size_t update_retries;
+    bool retrying;
+    size_t updates;
+    size_t flushes;
+    size_t chunks[MAX_CHUNKS];
+    size_t data_size;
+    uint8_t data[MAX_DATA];
+    TPMI_RH_HIERARCHY hierarchy;
+} TSS2_TCTI_CONTEXT_HASH_STREAM;
+
+static void
+hash_data(const uint8_t *data, size_t size, TPM2B_DIGEST *digest)
+{
+    size_t i;
+
+    memset(digest, 0, sizeof(*digest));
+    digest->size = 32;
+    for (i = 0; i < size; i++)
+        digest->buffer[i % 32] += data[i];
+}
+
+/** Append the TPM2B_MAX_BUFFER after the auth area to the data. */
+static void
+tcti_hash_stream_data(TSS2_TCTI_CONTEXT_HASH_STREAM *tcti, size_t size,
+                      const uint8_t *buffer, size_t *offset)
+{
+    UINT32 authSize;
+    TPM2B_MAX_BUFFER chunk;
+
+    *offset += sizeof(TPM2_HANDLE);
+    assert_int_equal(Tss2_MU_UINT32_Unmarshal(buffer, size, offset,
+                                              &authSize),
+                     TSS2_RC_SUCCESS);
+    *offset += authSize;
+    assert_int_equal(Tss2_MU_TPM2B_MAX_BUFFER_Unmarshal(buffer, size, offset,
+                                                        &chunk),
+                     TSS2_RC_SUCCESS);
+    assert_true(chunk.size <= INPUT_BUFFER);
+    assert_true(tcti->data_size + chunk.size <= MAX_DATA);
+    memcpy(&tcti->data[tcti->data_size], &chunk.buffer[0], chunk.size);
+    tcti->data_size += chunk.size;
+    if (tcti->command == TPM2_CC_SequenceUpdate) {
+        assert_true(tcti->updates < MAX_CHUNKS);
+        tcti->chunks[tcti->updates++] = chunk.size;
+    }
+}
+
+static TSS2_RC
+tcti_hash_stream_transmit(TSS2_TCTI_CONTEXT * tctiContext,
+                          size_t size, const uint8_t * buffer)
+{
+    TSS2_TCTI_CONTEXT_HASH_STREAM *tcti =
+        (TSS2_TCTI_CONTEXT_HASH_STREAM *) tctiContext;
+    size_t offset = sizeof(TPM2_ST) + sizeof(UINT32);
+
+    assert_int_equal(Tss2_MU_TPM2_CC_Unmarshal(buffer, size, &offset,
+                                               &tcti->command),
+                     TSS2_RC_SUCCESS);
+    switch (tcti->command) {
+    case TPM2_CC_GetCapability:
+    case TPM2_CC_HashSequenceStart:
+        break;
+    case TPM2_CC_SequenceUpdate:
+        tcti->retrying = tcti->update_retries > 0;
+        if (tcti->retrying)
+            tcti->update_retries--;
+        else if (tcti->update_rc == TPM2_RC_SUCCESS)
+            tcti_hash_stream_data(tcti, size, buffer, &offset);
+        break;
+    case TPM2_CC_SequenceComplete:
+        tcti_hash_stream_data(tcti, size, buffer, &offset);
+        assert_int_equal(Tss2_MU_UINT32_Unmarshal(buffer, size, &offset,
+                                                  &tcti->hierarchy),
+                         TSS2_RC_SUCCESS);
+        break;
+    case TPM2_CC_FlushContext:
+        tcti->flushes++;
+        break;
+    default:
+        fail_msg("Unexpected command 0x%" PRIx32, tcti->command);
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+/** Marshal the auth area of a password session response. */
+static void
+tcti_hash_stream_auth(uint8_t *response_buffer, size_t size, size_t *offset)
+{
+    Tss2_MU_UINT16_Marshal(0, response_buffer, size, offset);
+    Tss2_MU_BYTE_Marshal(TPMA_SESSION_CONTINUESESSION, response_buffer, size,
+                         offset);
+    Tss2_MU_UINT16_Marshal(0, response_buffer, size, offset);
+}
+
+static TSS2_RC
+tcti_hash_stream_receive(TSS2_TCTI_CONTEXT * tctiContext,
+                         size_t * response_size,
+                         uint8_t * response_buffer, int32_t timeout)
+{
+    TSS2_TCTI_CONTEXT_HASH_STREAM *tcti =
+        (TSS2_TCTI_CONTEXT_HASH_STREAM *) tctiContext;
+    TPMS_CAPABILITY_DATA capabilityData = {
+        .capability = TPM2_CAP_TPM_PROPERTIES,
+        .data.tpmProperties = {
+            .count = 1,
+            .tpmProperty = { { TPM2_PT_INPUT_BUFFER, INPUT_BUFFER } },
+        },
+    };
+    TPMT_TK_HASHCHECK validation = { .tag = TPM2_ST_HASHCHECK };
+    TPM2B_DIGEST result;
+    TPM2_ST tag = TPM2_ST_NO_SESSIONS;
+    TPM2_RC rc = TPM2_RC_SUCCESS;
+    size_t offset = sizeof(TPM2_ST) + sizeof(UINT32) + sizeof(TPM2_RC);
+    size_t parameters;
+    (void) timeout;
+
+    switch (tcti->command) {
+    case TPM2_CC_GetCapability:
+        Tss2_MU_BYTE_Marshal(TPM2_NO, response_buffer, *response_size,
+                             &offset);
+        Tss2_MU_TPMS_CAPABILITY_DATA_Marshal(&capabilityData, response_buffer,
+                                             *response_size, &offset);
+        break;
+    case TPM2_CC_HashSequenceStart:
+        Tss2_MU_TPM2_HANDLE_Marshal(SEQUENCE_HANDLE, response_buffer,
+                                    *response_size, &offset);
+        break;
+    case TPM2_CC_SequenceUpdate:
+        rc = tcti->retrying ? TPM2_RC_RETRY : tcti->update_rc;
+        if (rc != TPM2_RC_SUCCESS)
+            break;
+        tag = TPM2_ST_SESSIONS;
+        Tss2_MU_UINT32_Marshal(0, response_buffer, *response_size, &offset);
+        tcti_hash_stream_auth(response_buffer, *response_size, &offset);
+        break;
+    case TPM2_CC_SequenceComplete:
+        tag = TPM2_ST_SESSIONS;
+        parameters = offset;
+        offset += sizeof(UINT32);
+        hash_data(&tcti->data[0], tcti->data_size, &result);
+        validation.hierarchy = tcti->hierarchy;
+        Tss2_MU_TPM2B_DIGEST_Marshal(&result, response_buffer, *response_size,
+                                     &offset);
+        Tss2_MU_TPMT_TK_HASHCHECK_Marshal(&validation, response_buffer,
+                                          *response_size, &offset);
+        Tss2_MU_UINT32_Marshal(offset - parameters - sizeof(UINT32),
+                               response_buffer, *response_size, &parameters);
+        tcti_hash_stream_auth(response_buffer, *response_size, &offset);
+        break;
+    default:
+        break;
+    }
+    if (rc != TPM2_RC_SUCCESS)
+        offset = sizeof(TPM2_ST) + sizeof(UINT32) + sizeof(TPM2_RC);
+
+    *response_size = offset;
+    offset = 0;
+    Tss2_MU_TPM2_ST_Marshal(tag, response_buffer, *response_size, &offset);
+    Tss2_MU_UINT32_Marshal(*response_size, response_buffer, *response_size,
+                           &offset);
+    Tss2_MU_UINT32_Marshal(rc, response_buffer, *response_size, &offset);
+
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+tcti_hash_stream_finalize(TSS2_TCTI_CONTEXT * tctiContext)
+{
+    (void)(tctiContext);
+}
+
+static int
+setup(void **state)
+{
+    TSS2_RC r;
+    ESYS_CONTEXT *ectx;
+    TSS2_TCTI_CONTEXT_HASH_STREAM *tcti = calloc(1, sizeof(*tcti));
+
+    if (tcti == NULL)
+        return -1;
+    TSS2_TCTI_MAGIC(tcti) = TCTI_HASH_STREAM_MAGIC;
+    TSS2_TCTI_VERSION(tcti) = TCTI_HASH_STREAM_VERSION;
+    TSS2_TCTI_TRANSMIT(tcti) = tcti_hash_stream_transmit;
+    TSS2_TCTI_RECEIVE(tcti) = tcti_hash_stream_receive;
+    TSS2_TCTI_FINALIZE(tcti) = tcti_hash_stream_finalize;
+
+    r = Esys_Initialize(&ectx, (TSS2_TCTI_CONTEXT *) tcti, NULL);
+    if (r)
+        return (int)r;
+    *state = (void *)ectx;
+    return 0;
+}
+
+static int
+teardown(void **state)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+
+    Esys_GetTcti(ectx, &tcti);
+    Esys_Finalize(&ectx);
+    free(tcti);
+    return 0;
+}
+
+static TSS2_TCTI_CONTEXT_HASH_STREAM *
+get_tcti(ESYS_CONTEXT *ectx)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+
+    assert_int_equal(Esys_GetTcti(ectx, &tcti), TSS2_RC_SUCCESS);
+    return (TSS2_TCTI_CONTEXT_HASH_STREAM *) tcti;
+}
+
+static void
+fill_data(uint8_t *data, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+        data[i] = (uint8_t)(i * 7 + 3);
+}
+
+static ESYS_HASH_STREAM *
+begin(ESYS_CONTEXT *ectx)
+{
+    ESYS_HASH_STREAM *stream = NULL;
+
+    assert_int_equal(Esys_HashStream_Begin(ectx, ESYS_TR_NONE,
+                                           TPM2_ALG_SHA256, TPM2_RH_OWNER,
+                                           NULL, ESYS_TR_PASSWORD,
+                                           ESYS_TR_NONE, ESYS_TR_NONE,
+                                           &stream),
+                     TSS2_RC_SUCCESS);
+    assert_non_null(stream);
+    return stream;
+}
+
+/** Complete the stream and compare the data the TPM received. */
+static void
+end(ESYS_CONTEXT *ectx, ESYS_HASH_STREAM *stream, const uint8_t *data,
+    size_t size)
+{
+    TSS2_TCTI_CONTEXT_HASH_STREAM *tcti = get_tcti(ectx);
+    TPM2B_DIGEST *result = NULL, expected;
+    TPMT_TK_HASHCHECK *validation = NULL;
+
+    assert_int_equal(Esys_HashStream_End(&stream, &result, &validation),
+                     TSS2_RC_SUCCESS);
+    assert_null(stream);
+    assert_int_equal(tcti->data_size, size);
+    assert_memory_equal(&tcti->data[0], data, size);
+
+    hash_data(data, size, &expected);
+    assert_non_null(result);
+    assert_int_equal(result->size, expected.size);
+    assert_memory_equal(&result->buffer[0], &expected.buffer[0],
+                        expected.size);
+    assert_non_null(validation);
+    assert_int_equal(validation->hierarchy, TPM2_RH_OWNER);
+    free(result);
+    free(validation);
+}
+
+static void
+test_bad_parameters(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    ESYS_HASH_STREAM *stream = NULL;
+
+    assert_int_equal(Esys_HashStream_Begin(NULL, ESYS_TR_NONE,
+                                           TPM2_ALG_SHA256, TPM2_RH_OWNER,
+                                           NULL, ESYS_TR_PASSWORD,
+                                           ESYS_TR_NONE, ESYS_TR_NONE,
+                                           &stream),
+                     TSS2_ESYS_RC_BAD_REFERENCE);
+    assert_int_equal(Esys_HashStream_Begin(ectx, ESYS_TR_NONE,
+                                           TPM2_ALG_SHA256, TPM2_RH_OWNER,
+                                           NULL, ESYS_TR_PASSWORD,
+                                           ESYS_TR_NONE, ESYS_TR_NONE,
+                                           NULL),
+                     TSS2_ESYS_RC_BAD_REFERENCE);
+    assert_int_equal(Esys_HashStream_Update(NULL, (uint8_t *)"", 0),
+                     TSS2_ESYS_RC_BAD_REFERENCE);
+    assert_int_equal(Esys_HashStream_End(&stream, NULL, NULL),
+                     TSS2_ESYS_RC_BAD_REFERENCE);
+    assert_int_equal(Esys_HashStream_Abort(&stream), TSS2_RC_SUCCESS);
+
+    stream = begin(ectx);
+    assert_int_equal(Esys_HashStream_Update(stream, NULL, 1),
+                     TSS2_ESYS_RC_BAD_REFERENCE);
+    assert_int_equal(Esys_HashStream_Update(stream, NULL, 0),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_HashStream_Abort(&stream), TSS2_RC_SUCCESS);
+    assert_null(stream);
+}
+
+/** Data of odd sizes is sent in chunks of the TPM input buffer. */
+static void
+test_chunks(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_HASH_STREAM *tcti = get_tcti(ectx);
+    ESYS_HASH_STREAM *stream = begin(ectx);
+    uint8_t data[200];
+    size_t i;
+
+    fill_data(data, sizeof(data));
+    assert_int_equal(Esys_HashStream_Update(stream, &data[0], 10),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_HashStream_Update(stream, &data[10], 150),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_HashStream_Update(stream, &data[160], 40),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->updates, 3);
+    for (i = 0; i < tcti->updates; i++)
+        assert_int_equal(tcti->chunks[i], INPUT_BUFFER);
+    end(ectx, stream, data, sizeof(data));
+}
+
+/** The last full chunk is passed with TPM2_SequenceComplete. */
+static void
+test_exact_multiple(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_HASH_STREAM *tcti = get_tcti(ectx);
+    ESYS_HASH_STREAM *stream = begin(ectx);
+    uint8_t data[2 * INPUT_BUFFER];
+
+    fill_data(data, sizeof(data));
+    assert_int_equal(Esys_HashStream_Update(stream, data, sizeof(data)),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->updates, 1);
+    end(ectx, stream, data, sizeof(data));
+
+    /* An empty stream completes without any update */
+    tcti->data_size = 0;
+    tcti->updates = 0;
+    stream = begin(ectx);
+    end(ectx, stream, data, 0);
+    assert_int_equal(tcti->updates, 0);
+}
+
+/** Data read from a file descriptor is chunked like buffers. */
+static void
+test_fd(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_HASH_STREAM *tcti = get_tcti(ectx);
+    ESYS_HASH_STREAM *stream = begin(ectx);
+    char path[] = "/tmp/esys-hash-stream-XXXXXX";
+    uint8_t data[300];
+    int fd;
+
+    fill_data(data, sizeof(data));
+    fd = mkstemp(path);
+    assert_true(fd >= 0);
+    unlink(path);
+    assert_int_equal(write(fd, data, sizeof(data)), sizeof(data));
+    assert_int_equal(lseek(fd, 0, SEEK_SET), 0);
+
+    assert_int_equal(Esys_HashStream_UpdateFd(stream, fd), TSS2_RC_SUCCESS);
+    close(fd);
+    assert_int_equal(tcti->updates, sizeof(data) / INPUT_BUFFER);
+    end(ectx, stream, data, sizeof(data));
+
+    stream = begin(ectx);
+    assert_int_equal(Esys_HashStream_UpdateFd(stream, -1),
+                     TSS2_ESYS_RC_IO_ERROR);
+    assert_int_equal(Esys_HashStream_Abort(&stream), TSS2_RC_SUCCESS);
+}
+
+/** A chunk the TPM asks to resubmit is sent again in order. */
+static void
+test_retry(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_HASH_STREAM *tcti = get_tcti(ectx);
+    ESYS_HASH_STREAM *stream = begin(ectx);
+    uint8_t data[4 * INPUT_BUFFER];
+
+    fill_data(data, sizeof(data));
+    assert_int_equal(Esys_HashStream_Update(stream, data, 2 * INPUT_BUFFER),
+                     TSS2_RC_SUCCESS);
+    tcti->update_retries = 2;
+    assert_int_equal(Esys_HashStream_Update(stream, &data[2 * INPUT_BUFFER],
+                                            2 * INPUT_BUFFER),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->update_retries, 0);
+    assert_int_equal(tcti->updates, 3);
+    end(ectx, stream, data, sizeof(data));
+}
+
+/** A failing update is reported and the sequence can be aborted. */
+static void
+test_error(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_HASH_STREAM *tcti = get_tcti(ectx);
+    ESYS_HASH_STREAM *stream = begin(ectx);
+    uint8_t data[3 * INPUT_BUFFER];
+
+    fill_data(data, sizeof(data));
+    tcti->update_rc = TPM2_RC_FAILURE;
+    assert_int_equal(Esys_HashStream_Update(stream, data, sizeof(data)),
+                     TPM2_RC_FAILURE);
+    assert_int_equal(Esys_HashStream_Abort(&stream), TSS2_RC_SUCCESS);
+    assert_null(stream);
+    assert_int_equal(tcti->flushes, 1);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_bad_parameters, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_chunks, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_exact_multiple, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_fd, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_retry, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_error, setup, teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
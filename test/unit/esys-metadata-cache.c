@@ -0,0 +1,446 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <glob.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+#include "tss2_mu.h"
+
+#include "tss2-esys/esys_iutil.h"
+#define LOGMODULE tests
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/**
+ * This unit test checks the metadata cache of Esys_TR_FromTPMPublic against
+ * a TCTI that answers TPM2_ReadPublic, TPM2_NV_ReadPublic and
+ * TPM2_NV_UndefineSpaceSpecial and counts the commands it receives.
+ */
+
+#define TCTI_METADATA_MAGIC 0x4d45544144415441ULL        /* 'METADATA' */
+#define TCTI_METADATA_VERSION 0x1
+
+#define PERSISTENT_HANDLE 0x81000001
+#define NV_HANDLE 0x01c00002
+#define POLICY_SESSION (ESYS_TR_MIN_OBJECT + 0x1000)
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC(*finalize) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*cancel) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*getPollHandles) (TSS2_TCTI_CONTEXT * tctiContext,
+                           TSS2_TCTI_POLL_HANDLE * handles,
+                           size_t * num_handles);
+    TSS2_RC(*setLocality) (TSS2_TCTI_CONTEXT * tctiContext, uint8_t locality);
+    TPM2_CC command;
+    size_t commands;
+} TSS2_TCTI_CONTEXT_METADATA;
+
+static char cache_path[] = "/tmp/esys-metadata-cache-XXXXXX";
+
+static const TPM2B_PUBLIC key_public = {
+    .publicArea = {
+        .type = TPM2_ALG_RSA,
+        .nameAlg = TPM2_ALG_SHA256,
+        .objectAttributes = TPMA_OBJECT_RESTRICTED | TPMA_OBJECT_DECRYPT |
+                            TPMA_OBJECT_FIXEDTPM | TPMA_OBJECT_FIXEDPARENT,
+        .parameters.rsaDetail = {
+            .symmetric = { .algorithm = TPM2_ALG_AES,
+                           .keyBits = { .aes = 128 },
+                           .mode = { .aes = TPM2_ALG_CFB } },
+            .scheme = { .scheme = TPM2_ALG_NULL },
+            .keyBits = 2048,
+        },
+        .unique.rsa = { .size = 256, .buffer = { 0xc3, 0x5a } },
+    },
+};
+
+static const TPM2B_NV_PUBLIC nv_public = {
+    .nvPublic = {
+        .nvIndex = NV_HANDLE,
+        .nameAlg = TPM2_ALG_SHA256,
+        .attributes = TPMA_NV_AUTHREAD | TPMA_NV_AUTHWRITE,
+        .dataSize = 32,
+    },
+};
+
+static TSS2_RC
+tcti_metadata_transmit(TSS2_TCTI_CONTEXT * tctiContext,
+                       size_t size, const uint8_t * buffer)
+{
+    TSS2_TCTI_CONTEXT_METADATA *tcti = (TSS2_TCTI_CONTEXT_METADATA *) tctiContext;
+    size_t offset = sizeof(TPM2_ST) + sizeof(UINT32);
+
+    assert_int_equal(Tss2_MU_TPM2_CC_Unmarshal(buffer, size, &offset,
+                                               &tcti->command),
+                     TSS2_RC_SUCCESS);
+    if (tcti->command != TPM2_CC_ReadPublic &&
+        tcti->command != TPM2_CC_NV_ReadPublic &&
+        tcti->command != TPM2_CC_NV_UndefineSpaceSpecial)
+        fail_msg("Unexpected command 0x%" PRIx32, tcti->command);
+    tcti->commands++;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_metadata_receive(TSS2_TCTI_CONTEXT * tctiContext,
+                      size_t * response_size,
+                      uint8_t * response_buffer, int32_t timeout)
+{
+    TSS2_TCTI_CONTEXT_METADATA *tcti = (TSS2_TCTI_CONTEXT_METADATA *) tctiContext;
+    TPM2B_PUBLIC public = key_public;
+    TPM2B_NV_PUBLIC nvPublic = nv_public;
+    TPM2B_NAME name;
+    TPMS_AUTH_RESPONSE auth = {
+        .sessionAttributes = TPMA_SESSION_CONTINUESESSION,
+    };
+    size_t offset = 0;
+    (void) timeout;
+
+    Tss2_MU_TPM2_ST_Marshal(tcti->command == TPM2_CC_NV_UndefineSpaceSpecial ?
+                            TPM2_ST_SESSIONS : TPM2_ST_NO_SESSIONS,
+                            response_buffer, *response_size, &offset);
+    offset += sizeof(UINT32);
+    Tss2_MU_UINT32_Marshal(TPM2_RC_SUCCESS, response_buffer, *response_size,
+                           &offset);
+    if (tcti->command == TPM2_CC_NV_UndefineSpaceSpecial) {
+        /* No parameters, empty auths for the policy and password session */
+        Tss2_MU_UINT32_Marshal(0, response_buffer, *response_size, &offset);
+        Tss2_MU_TPMS_AUTH_RESPONSE_Marshal(&auth, response_buffer,
+                                           *response_size, &offset);
+        Tss2_MU_TPMS_AUTH_RESPONSE_Marshal(&auth, response_buffer,
+                                           *response_size, &offset);
+    } else if (tcti->command == TPM2_CC_ReadPublic) {
+        assert_int_equal(iesys_get_name(&public, &name), TSS2_RC_SUCCESS);
+        Tss2_MU_TPM2B_PUBLIC_Marshal(&public, response_buffer,
+                                     *response_size, &offset);
+        Tss2_MU_TPM2B_NAME_Marshal(&name, response_buffer, *response_size,
+                                   &offset);
+        Tss2_MU_TPM2B_NAME_Marshal(&name, response_buffer, *response_size,
+                                   &offset);
+    } else {
+        assert_int_equal(iesys_nv_get_name(&nvPublic, &name), TSS2_RC_SUCCESS);
+        Tss2_MU_TPM2B_NV_PUBLIC_Marshal(&nvPublic, response_buffer,
+                                        *response_size, &offset);
+        Tss2_MU_TPM2B_NAME_Marshal(&name, response_buffer, *response_size,
+                                   &offset);
+    }
+    *response_size = offset;
+    offset = sizeof(TPM2_ST);
+    Tss2_MU_UINT32_Marshal(*response_size, response_buffer,
+                           sizeof(TPM2_ST) + sizeof(UINT32), &offset);
+
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+tcti_metadata_finalize(TSS2_TCTI_CONTEXT * tctiContext)
+{
+    (void)(tctiContext);
+}
+
+static int
+setup(void **state)
+{
+    TSS2_RC r;
+    ESYS_CONTEXT *ectx;
+    TSS2_TCTI_CONTEXT_METADATA *tcti = calloc(1, sizeof(*tcti));
+    int fd;
+
+    if (tcti == NULL)
+        return -1;
+    TSS2_TCTI_MAGIC(tcti) = TCTI_METADATA_MAGIC;
+    TSS2_TCTI_VERSION(tcti) = TCTI_METADATA_VERSION;
+    TSS2_TCTI_TRANSMIT(tcti) = tcti_metadata_transmit;
+    TSS2_TCTI_RECEIVE(tcti) = tcti_metadata_receive;
+    TSS2_TCTI_FINALIZE(tcti) = tcti_metadata_finalize;
+
+    /* Start without a cache file */
+    strcpy(&cache_path[sizeof(cache_path) - 7], "XXXXXX");
+    fd = mkstemp(cache_path);
+    if (fd < 0)
+        return -1;
+    close(fd);
+    unlink(cache_path);
+
+    r = Esys_Initialize(&ectx, (TSS2_TCTI_CONTEXT *) tcti, NULL);
+    if (r)
+        return (int)r;
+    *state = (void *)ectx;
+    return 0;
+}
+
+static int
+teardown(void **state)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+
+    Esys_GetTcti(ectx, &tcti);
+    Esys_Finalize(&ectx);
+    free(tcti);
+    unlink(cache_path);
+    return 0;
+}
+
+static TSS2_TCTI_CONTEXT_METADATA *
+get_tcti(ESYS_CONTEXT *ectx)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+
+    assert_int_equal(Esys_GetTcti(ectx, &tcti), TSS2_RC_SUCCESS);
+    return (TSS2_TCTI_CONTEXT_METADATA *) tcti;
+}
+
+/** Create an ESYS_TR, check its name and close it again. */
+static void
+from_tpm_public(ESYS_CONTEXT *ectx, TPM2_HANDLE tpm_handle)
+{
+    TPM2B_PUBLIC public = key_public;
+    TPM2B_NV_PUBLIC nvPublic = nv_public;
+    TPM2B_NAME expected, *name;
+    ESYS_TR object;
+
+    if (tpm_handle == NV_HANDLE)
+        assert_int_equal(iesys_nv_get_name(&nvPublic, &expected),
+                         TSS2_RC_SUCCESS);
+    else
+        assert_int_equal(iesys_get_name(&public, &expected), TSS2_RC_SUCCESS);
+
+    assert_int_equal(Esys_TR_FromTPMPublic(ectx, tpm_handle, ESYS_TR_NONE,
+                                           ESYS_TR_NONE, ESYS_TR_NONE,
+                                           &object),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_TR_GetName(ectx, object, &name), TSS2_RC_SUCCESS);
+    assert_int_equal(name->size, expected.size);
+    assert_memory_equal(&name->name[0], &expected.name[0], expected.size);
+    free(name);
+    assert_int_equal(Esys_TR_Close(ectx, &object), TSS2_RC_SUCCESS);
+}
+
+static void
+test_bad_parameters(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+
+    assert_int_equal(Esys_MetadataCache_Open(NULL, cache_path),
+                     TSS2_ESYS_RC_BAD_REFERENCE);
+    assert_int_equal(Esys_MetadataCache_Open(ectx, NULL),
+                     TSS2_ESYS_RC_BAD_REFERENCE);
+    assert_int_equal(Esys_MetadataCache_Save(ectx),
+                     TSS2_ESYS_RC_BAD_SEQUENCE);
+    assert_int_equal(Esys_MetadataCache_Remove(ectx, PERSISTENT_HANDLE),
+                     TSS2_ESYS_RC_BAD_SEQUENCE);
+
+    assert_int_equal(Esys_MetadataCache_Open(ectx, cache_path),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_MetadataCache_Open(ectx, cache_path),
+                     TSS2_ESYS_RC_BAD_SEQUENCE);
+    assert_int_equal(Esys_MetadataCache_Close(ectx), TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_MetadataCache_Close(ectx), TSS2_RC_SUCCESS);
+}
+
+/** Metadata read from the TPM is served from the cache and its file. */
+static void
+test_hit(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_METADATA *tcti = get_tcti(ectx);
+    char tmp_pattern[sizeof(cache_path) + 2];
+    glob_t tmp_files;
+
+    assert_int_equal(Esys_MetadataCache_Open(ectx, cache_path),
+                     TSS2_RC_SUCCESS);
+    from_tpm_public(ectx, PERSISTENT_HANDLE);
+    from_tpm_public(ectx, NV_HANDLE);
+    assert_int_equal(tcti->commands, 2);
+
+    from_tpm_public(ectx, PERSISTENT_HANDLE);
+    from_tpm_public(ectx, NV_HANDLE);
+    assert_int_equal(tcti->commands, 2);
+
+    assert_int_equal(Esys_MetadataCache_Save(ectx), TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_MetadataCache_Close(ectx), TSS2_RC_SUCCESS);
+    assert_int_equal(access(cache_path, F_OK), 0);
+    /* The temporary file was renamed to the cache file */
+    sprintf(tmp_pattern, "%s.*", cache_path);
+    assert_int_equal(glob(tmp_pattern, 0, NULL, &tmp_files), GLOB_NOMATCH);
+
+    /* A new cache maps the file written before */
+    assert_int_equal(Esys_MetadataCache_Open(ectx, cache_path),
+                     TSS2_RC_SUCCESS);
+    assert_non_null(ectx->metadata_cache->map);
+    assert_int_equal(ectx->metadata_cache->map_count, 2);
+    assert_false(ectx->metadata_cache->map_verified[0]);
+    assert_false(ectx->metadata_cache->map_verified[1]);
+    from_tpm_public(ectx, NV_HANDLE);
+    from_tpm_public(ectx, PERSISTENT_HANDLE);
+    assert_int_equal(tcti->commands, 2);
+
+    /* Each record's name was checked once and is not checked again */
+    assert_true(ectx->metadata_cache->map_verified[0]);
+    assert_true(ectx->metadata_cache->map_verified[1]);
+    from_tpm_public(ectx, NV_HANDLE);
+    assert_int_equal(tcti->commands, 2);
+}
+
+/** A record whose name does not match its public area is dropped. */
+static void
+test_bad_name(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_METADATA *tcti = get_tcti(ectx);
+    IESYS_RESOURCE rsrc = {
+        .handle = PERSISTENT_HANDLE,
+        .rsrcType = IESYSC_KEY_RSRC,
+        .misc.rsrc_key_pub = key_public,
+    };
+
+    assert_int_equal(Esys_MetadataCache_Open(ectx, cache_path),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(iesys_get_name(&rsrc.misc.rsrc_key_pub, &rsrc.name),
+                     TSS2_RC_SUCCESS);
+    rsrc.name.name[rsrc.name.size - 1] ^= 0xff;
+    assert_int_equal(iesys_metadata_cache_put(ectx, &rsrc), TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_MetadataCache_Save(ectx), TSS2_RC_SUCCESS);
+    assert_int_equal(ectx->metadata_cache->map_count, 1);
+
+    /* The TPM is asked instead and the record replaced */
+    from_tpm_public(ectx, PERSISTENT_HANDLE);
+    assert_int_equal(tcti->commands, 1);
+    from_tpm_public(ectx, PERSISTENT_HANDLE);
+    assert_int_equal(tcti->commands, 1);
+}
+
+/** Transient objects are never cached. */
+static void
+test_transient(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_METADATA *tcti = get_tcti(ectx);
+
+    assert_int_equal(Esys_MetadataCache_Open(ectx, cache_path),
+                     TSS2_RC_SUCCESS);
+    from_tpm_public(ectx, TPM2_TRANSIENT_FIRST);
+    from_tpm_public(ectx, TPM2_TRANSIENT_FIRST);
+    assert_int_equal(tcti->commands, 2);
+}
+
+/** Removed handles are read from the TPM again and dropped from the file. */
+static void
+test_remove(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_METADATA *tcti = get_tcti(ectx);
+
+    assert_int_equal(Esys_MetadataCache_Open(ectx, cache_path),
+                     TSS2_RC_SUCCESS);
+    from_tpm_public(ectx, PERSISTENT_HANDLE);
+    from_tpm_public(ectx, NV_HANDLE);
+    assert_int_equal(Esys_MetadataCache_Save(ectx), TSS2_RC_SUCCESS);
+
+    assert_int_equal(Esys_MetadataCache_Remove(ectx, PERSISTENT_HANDLE),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_MetadataCache_Save(ectx), TSS2_RC_SUCCESS);
+    assert_int_equal(ectx->metadata_cache->map_count, 1);
+
+    from_tpm_public(ectx, PERSISTENT_HANDLE);
+    from_tpm_public(ectx, NV_HANDLE);
+    assert_int_equal(tcti->commands, 3);
+}
+
+/** Undefining an NV index with TPM2_NV_UndefineSpaceSpecial drops its record. */
+static void
+test_undefine_space_special(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_METADATA *tcti = get_tcti(ectx);
+    RSRC_NODE_T *session;
+    ESYS_TR nvIndex;
+
+    assert_int_equal(Esys_MetadataCache_Open(ectx, cache_path),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_TR_FromTPMPublic(ectx, NV_HANDLE, ESYS_TR_NONE,
+                                           ESYS_TR_NONE, ESYS_TR_NONE,
+                                           &nvIndex),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_MetadataCache_Save(ectx), TSS2_RC_SUCCESS);
+    assert_int_equal(ectx->metadata_cache->map_count, 1);
+
+    /* A policy session satisfied by TPM2_PolicyPassword needs no HMAC */
+    assert_int_equal(esys_CreateResourceObject(ectx, POLICY_SESSION,
+                                               &session),
+                     TSS2_RC_SUCCESS);
+    session->rsrc.rsrcType = IESYSC_SESSION_RSRC;
+    session->rsrc.handle = TPM2_POLICY_SESSION_FIRST;
+    session->rsrc.misc.rsrc_session.authHash = TPM2_ALG_SHA256;
+    session->rsrc.misc.rsrc_session.sessionAttributes =
+        TPMA_SESSION_CONTINUESESSION;
+    session->rsrc.misc.rsrc_session.type_policy_session = POLICY_PASSWORD;
+
+    assert_int_equal(Esys_NV_UndefineSpaceSpecial(ectx, nvIndex,
+                                                  ESYS_TR_RH_PLATFORM,
+                                                  POLICY_SESSION,
+                                                  ESYS_TR_PASSWORD,
+                                                  ESYS_TR_NONE),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->commands, 2);
+
+    assert_int_equal(Esys_MetadataCache_Save(ectx), TSS2_RC_SUCCESS);
+    assert_int_equal(ectx->metadata_cache->map_count, 0);
+    from_tpm_public(ectx, NV_HANDLE);
+    assert_int_equal(tcti->commands, 3);
+}
+
+/** A malformed cache file is ignored and replaced on saving. */
+static void
+test_malformed(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_METADATA *tcti = get_tcti(ectx);
+    FILE *file = fopen(cache_path, "wb");
+
+    assert_non_null(file);
+    assert_int_equal(fwrite("garbage", 1, 7, file), 7);
+    fclose(file);
+
+    assert_int_equal(Esys_MetadataCache_Open(ectx, cache_path),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(ectx->metadata_cache->map_count, 0);
+    from_tpm_public(ectx, PERSISTENT_HANDLE);
+    assert_int_equal(tcti->commands, 1);
+    assert_int_equal(Esys_MetadataCache_Save(ectx), TSS2_RC_SUCCESS);
+    assert_int_equal(ectx->metadata_cache->map_count, 1);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_bad_parameters, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_hit, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_bad_name, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_transient, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_remove, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_undefine_space_special, setup,
+                                        teardown),
+        cmocka_unit_test_setup_teardown(test_malformed, setup, teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
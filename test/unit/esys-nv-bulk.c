@@ -0,0 +1,440 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+#include "tss2_mu.h"
+
+#include "tss2-esys/esys_iutil.h"
+#define LOGMODULE tests
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/**
+ * This unit test checks the chunking of Esys_NV_ReadBulk and
+ * Esys_NV_WriteBulk against a TCTI that implements a single NV index with a
+ * small NV buffer.
+ */
+
+#define TCTI_NV_BULK_MAGIC 0x4e5642554c4b0000ULL       /* 'NVBULK\0\0' */
+#define TCTI_NV_BULK_VERSION 0x1
+
+#define NV_BUFFER_MAX 64
+#define NV_HANDLE 0x01c00003
+#define NV_SIZE 1200
+
+static const TPM2B_AUTH nv_auth = { .size = 6, .buffer = "secret" };
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC(*finalize) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*cancel) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*getPollHandles) (TSS2_TCTI_CONTEXT * tctiContext,
+                           TSS2_TCTI_POLL_HANDLE * handles,
+                           size_t * num_handles);
+    TSS2_RC(*setLocality) (TSS2_TCTI_CONTEXT * tctiContext, uint8_t locality);
+    TPM2_CC command;
+    TPM2_RC rc;                  /* The response code of the command */
+    size_t capabilities;         /* The number of GetCapability commands */
+    size_t commands;             /* The number of NV_Read/NV_Write commands */
+    size_t fail_at;              /* NV command answered with fail_rc */
+    TPM2_RC fail_rc;
+    UINT16 read_size;            /* The size of the pending NV_Read */
+    UINT16 read_offset;
+    TPMA_NV attributes;
+    uint8_t nv[NV_SIZE];
+} TSS2_TCTI_CONTEXT_NV_BULK;
+
+/** Check the password auth area of an NV command. */
+static void
+tcti_nv_bulk_auth(const uint8_t *buffer, size_t size, size_t *offset)
+{
+    UINT32 authSize, sessionHandle;
+    TPM2B_NONCE nonce;
+    BYTE attributes;
+    TPM2B_AUTH hmac;
+
+    assert_int_equal(Tss2_MU_UINT32_Unmarshal(buffer, size, offset,
+                                              &authSize),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Tss2_MU_UINT32_Unmarshal(buffer, size, offset,
+                                              &sessionHandle),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(sessionHandle, TPM2_RS_PW);
+    assert_int_equal(Tss2_MU_TPM2B_NONCE_Unmarshal(buffer, size, offset,
+                                                   &nonce),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Tss2_MU_BYTE_Unmarshal(buffer, size, offset,
+                                            &attributes),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Tss2_MU_TPM2B_AUTH_Unmarshal(buffer, size, offset,
+                                                  &hmac),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(hmac.size, nv_auth.size);
+    assert_memory_equal(&hmac.buffer[0], &nv_auth.buffer[0], nv_auth.size);
+}
+
+static TSS2_RC
+tcti_nv_bulk_transmit(TSS2_TCTI_CONTEXT * tctiContext,
+                      size_t size, const uint8_t * buffer)
+{
+    TSS2_TCTI_CONTEXT_NV_BULK *tcti = (TSS2_TCTI_CONTEXT_NV_BULK *) tctiContext;
+    size_t offset = sizeof(TPM2_ST) + sizeof(UINT32);
+    TPM2B_MAX_NV_BUFFER data;
+    UINT16 nvOffset;
+
+    assert_int_equal(Tss2_MU_TPM2_CC_Unmarshal(buffer, size, &offset,
+                                               &tcti->command),
+                     TSS2_RC_SUCCESS);
+    tcti->rc = TPM2_RC_SUCCESS;
+    switch (tcti->command) {
+    case TPM2_CC_GetCapability:
+        tcti->capabilities++;
+        return TSS2_RC_SUCCESS;
+    case TPM2_CC_NV_ReadPublic:
+        return TSS2_RC_SUCCESS;
+    case TPM2_CC_NV_Read:
+    case TPM2_CC_NV_Write:
+        break;
+    default:
+        fail_msg("Unexpected command 0x%" PRIx32, tcti->command);
+    }
+
+    if (++tcti->commands == tcti->fail_at) {
+        tcti->rc = tcti->fail_rc;
+        return TSS2_RC_SUCCESS;
+    }
+
+    offset += 2 * sizeof(TPM2_HANDLE);
+    tcti_nv_bulk_auth(buffer, size, &offset);
+    if (tcti->command == TPM2_CC_NV_Read) {
+        Tss2_MU_UINT16_Unmarshal(buffer, size, &offset, &tcti->read_size);
+        Tss2_MU_UINT16_Unmarshal(buffer, size, &offset, &tcti->read_offset);
+        assert_true(tcti->read_size <= NV_BUFFER_MAX);
+        assert_true(tcti->read_offset + tcti->read_size <= NV_SIZE);
+    } else {
+        Tss2_MU_TPM2B_MAX_NV_BUFFER_Unmarshal(buffer, size, &offset, &data);
+        Tss2_MU_UINT16_Unmarshal(buffer, size, &offset, &nvOffset);
+        assert_true(data.size <= NV_BUFFER_MAX);
+        assert_true(nvOffset + data.size <= NV_SIZE);
+        memcpy(&tcti->nv[nvOffset], &data.buffer[0], data.size);
+        tcti->attributes |= TPMA_NV_WRITTEN;
+    }
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_nv_bulk_receive(TSS2_TCTI_CONTEXT * tctiContext,
+                     size_t * response_size,
+                     uint8_t * response_buffer, int32_t timeout)
+{
+    TSS2_TCTI_CONTEXT_NV_BULK *tcti = (TSS2_TCTI_CONTEXT_NV_BULK *) tctiContext;
+    TPMS_CAPABILITY_DATA capabilityData = {
+        .capability = TPM2_CAP_TPM_PROPERTIES,
+        .data.tpmProperties = {
+            .count = 1,
+            .tpmProperty = { { TPM2_PT_NV_BUFFER_MAX, NV_BUFFER_MAX } },
+        },
+    };
+    TPM2B_NV_PUBLIC nvPublic = {
+        .nvPublic = {
+            .nvIndex = NV_HANDLE,
+            .nameAlg = TPM2_ALG_SHA256,
+            .attributes = tcti->attributes,
+            .dataSize = NV_SIZE,
+        },
+    };
+    TPM2B_MAX_NV_BUFFER data;
+    TPM2B_NAME name;
+    TPM2_ST tag = TPM2_ST_NO_SESSIONS;
+    size_t offset = sizeof(TPM2_ST) + sizeof(UINT32) + sizeof(TPM2_RC);
+    size_t parameters = offset;
+    (void) timeout;
+
+    if (tcti->rc != TPM2_RC_SUCCESS)
+        goto header;
+
+    switch (tcti->command) {
+    case TPM2_CC_GetCapability:
+        Tss2_MU_BYTE_Marshal(TPM2_NO, response_buffer, *response_size,
+                             &offset);
+        Tss2_MU_TPMS_CAPABILITY_DATA_Marshal(&capabilityData, response_buffer,
+                                             *response_size, &offset);
+        break;
+    case TPM2_CC_NV_ReadPublic:
+        assert_int_equal(iesys_nv_get_name(&nvPublic, &name), TSS2_RC_SUCCESS);
+        Tss2_MU_TPM2B_NV_PUBLIC_Marshal(&nvPublic, response_buffer,
+                                        *response_size, &offset);
+        Tss2_MU_TPM2B_NAME_Marshal(&name, response_buffer, *response_size,
+                                   &offset);
+        break;
+    default:
+        tag = TPM2_ST_SESSIONS;
+        offset += sizeof(UINT32);
+        if (tcti->command == TPM2_CC_NV_Read) {
+            data.size = tcti->read_size;
+            memcpy(&data.buffer[0], &tcti->nv[tcti->read_offset],
+                   tcti->read_size);
+            Tss2_MU_TPM2B_MAX_NV_BUFFER_Marshal(&data, response_buffer,
+                                                *response_size, &offset);
+        }
+        Tss2_MU_UINT32_Marshal(offset - parameters - sizeof(UINT32),
+                               response_buffer, *response_size, &parameters);
+        Tss2_MU_UINT16_Marshal(0, response_buffer, *response_size, &offset);
+        Tss2_MU_BYTE_Marshal(TPMA_SESSION_CONTINUESESSION, response_buffer,
+                             *response_size, &offset);
+        Tss2_MU_UINT16_Marshal(0, response_buffer, *response_size, &offset);
+    }
+
+header:
+    *response_size = offset;
+    offset = 0;
+    Tss2_MU_TPM2_ST_Marshal(tag, response_buffer, *response_size, &offset);
+    Tss2_MU_UINT32_Marshal(*response_size, response_buffer, *response_size,
+                           &offset);
+    Tss2_MU_UINT32_Marshal(tcti->rc, response_buffer, *response_size, &offset);
+
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+tcti_nv_bulk_finalize(TSS2_TCTI_CONTEXT * tctiContext)
+{
+    (void)(tctiContext);
+}
+
+static int
+setup(void **state)
+{
+    TSS2_RC r;
+    ESYS_CONTEXT *ectx;
+    TSS2_TCTI_CONTEXT_NV_BULK *tcti = calloc(1, sizeof(*tcti));
+
+    if (tcti == NULL)
+        return -1;
+    TSS2_TCTI_MAGIC(tcti) = TCTI_NV_BULK_MAGIC;
+    TSS2_TCTI_VERSION(tcti) = TCTI_NV_BULK_VERSION;
+    TSS2_TCTI_TRANSMIT(tcti) = tcti_nv_bulk_transmit;
+    TSS2_TCTI_RECEIVE(tcti) = tcti_nv_bulk_receive;
+    TSS2_TCTI_FINALIZE(tcti) = tcti_nv_bulk_finalize;
+    tcti->attributes = TPMA_NV_AUTHREAD | TPMA_NV_AUTHWRITE;
+    for (size_t i = 0; i < NV_SIZE; i++)
+        tcti->nv[i] = (uint8_t)(i * 13 + 5);
+
+    r = Esys_Initialize(&ectx, (TSS2_TCTI_CONTEXT *) tcti, NULL);
+    if (r)
+        return (int)r;
+    *state = (void *)ectx;
+    return 0;
+}
+
+static int
+teardown(void **state)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+
+    Esys_GetTcti(ectx, &tcti);
+    Esys_Finalize(&ectx);
+    free(tcti);
+    return 0;
+}
+
+static TSS2_TCTI_CONTEXT_NV_BULK *
+get_tcti(ESYS_CONTEXT *ectx)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+
+    assert_int_equal(Esys_GetTcti(ectx, &tcti), TSS2_RC_SUCCESS);
+    return (TSS2_TCTI_CONTEXT_NV_BULK *) tcti;
+}
+
+static ESYS_TR
+get_nv_index(ESYS_CONTEXT *ectx)
+{
+    ESYS_TR nvIndex;
+
+    assert_int_equal(Esys_TR_FromTPMPublic(ectx, NV_HANDLE, ESYS_TR_NONE,
+                                           ESYS_TR_NONE, ESYS_TR_NONE,
+                                           &nvIndex),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_TR_SetAuth(ectx, nvIndex, &nv_auth),
+                     TSS2_RC_SUCCESS);
+    return nvIndex;
+}
+
+static void
+test_bad_parameters(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    ESYS_TR nvIndex = get_nv_index(ectx);
+    uint8_t data[1];
+
+    assert_int_equal(Esys_NV_ReadBulk(NULL, nvIndex, nvIndex,
+                                      ESYS_TR_PASSWORD, ESYS_TR_NONE,
+                                      ESYS_TR_NONE, 1, 0, data),
+                     TSS2_ESYS_RC_BAD_REFERENCE);
+    assert_int_equal(Esys_NV_ReadBulk(ectx, nvIndex, nvIndex,
+                                      ESYS_TR_PASSWORD, ESYS_TR_NONE,
+                                      ESYS_TR_NONE, 1, 0, NULL),
+                     TSS2_ESYS_RC_BAD_REFERENCE);
+    assert_int_equal(Esys_NV_WriteBulk(ectx, nvIndex, nvIndex,
+                                       ESYS_TR_PASSWORD, ESYS_TR_NONE,
+                                       ESYS_TR_NONE, NULL, 1, 0),
+                     TSS2_ESYS_RC_BAD_REFERENCE);
+    assert_int_equal(Esys_NV_ReadBulk(ectx, nvIndex, nvIndex,
+                                      ESYS_TR_PASSWORD, ESYS_TR_NONE,
+                                      ESYS_TR_NONE, 2, UINT16_MAX, data),
+                     TSS2_ESYS_RC_BAD_VALUE);
+    assert_int_equal(Esys_NV_ReadBulk(ectx, nvIndex, ESYS_TR_NONE,
+                                      ESYS_TR_PASSWORD, ESYS_TR_NONE,
+                                      ESYS_TR_NONE, 1, 0, data),
+                     TSS2_ESYS_RC_BAD_TR);
+    assert_int_equal(get_tcti(ectx)->commands, 0);
+}
+
+/** Reads are split into batches of NV_BUFFER_MAX chunks. */
+static void
+test_read(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_NV_BULK *tcti = get_tcti(ectx);
+    ESYS_TR nvIndex = get_nv_index(ectx);
+    uint8_t data[NV_SIZE];
+
+    assert_int_equal(Esys_NV_ReadBulk(ectx, nvIndex, nvIndex,
+                                      ESYS_TR_PASSWORD, ESYS_TR_NONE,
+                                      ESYS_TR_NONE, 300, 10, data),
+                     TSS2_RC_SUCCESS);
+    assert_memory_equal(data, &tcti->nv[10], 300);
+    assert_int_equal(tcti->commands, 5);
+    assert_non_null(ectx->nv_bulk.sys[0]);
+    assert_int_equal(tcti->capabilities, 1);
+
+    /* More chunks than one batch */
+    assert_int_equal(Esys_CapabilityCache_Enable(ectx, TPM2_YES),
+                     TSS2_RC_SUCCESS);
+    memset(data, 0, sizeof(data));
+    assert_int_equal(Esys_NV_ReadBulk(ectx, nvIndex, nvIndex,
+                                      ESYS_TR_PASSWORD, ESYS_TR_NONE,
+                                      ESYS_TR_NONE, NV_SIZE, 0, data),
+                     TSS2_RC_SUCCESS);
+    assert_memory_equal(data, &tcti->nv[0], NV_SIZE);
+    assert_int_equal(tcti->commands, 5 + (NV_SIZE + NV_BUFFER_MAX - 1) /
+                                     NV_BUFFER_MAX);
+    assert_int_equal(tcti->capabilities, 2);
+
+    /* The capability cache answers later queries of the buffer size */
+    assert_int_equal(Esys_NV_ReadBulk(ectx, nvIndex, nvIndex,
+                                      ESYS_TR_PASSWORD, ESYS_TR_NONE,
+                                      ESYS_TR_NONE, 10, 0, data),
+                     TSS2_RC_SUCCESS);
+    assert_memory_equal(data, &tcti->nv[0], 10);
+    assert_int_equal(tcti->capabilities, 2);
+}
+
+/** The first write of an index goes through ESYS to update its name. */
+static void
+test_write(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_NV_BULK *tcti = get_tcti(ectx);
+    ESYS_TR nvIndex = get_nv_index(ectx);
+    RSRC_NODE_T *nvNode;
+    uint8_t data[1000];
+
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t)(i * 3);
+
+    assert_int_equal(Esys_NV_WriteBulk(ectx, nvIndex, nvIndex,
+                                       ESYS_TR_PASSWORD, ESYS_TR_NONE,
+                                       ESYS_TR_NONE, data, sizeof(data), 100),
+                     TSS2_RC_SUCCESS);
+    assert_memory_equal(&tcti->nv[100], data, sizeof(data));
+    assert_int_equal(tcti->commands, (sizeof(data) + NV_BUFFER_MAX - 1) /
+                                     NV_BUFFER_MAX);
+
+    assert_int_equal(esys_GetResourceObject(ectx, nvIndex, &nvNode),
+                     TSS2_RC_SUCCESS);
+    assert_true(nvNode->rsrc.misc.rsrc_nv_pub.nvPublic.attributes &
+                TPMA_NV_WRITTEN);
+
+    /* Empty writes send nothing */
+    assert_int_equal(Esys_NV_WriteBulk(ectx, nvIndex, nvIndex,
+                                       ESYS_TR_PASSWORD, ESYS_TR_NONE,
+                                       ESYS_TR_NONE, data, 0, 0),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->commands, (sizeof(data) + NV_BUFFER_MAX - 1) /
+                                     NV_BUFFER_MAX);
+}
+
+/** A TPM2_RC_RETRY in a batch resubmits the chunk through ESYS. */
+static void
+test_retry(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_NV_BULK *tcti = get_tcti(ectx);
+    ESYS_TR nvIndex = get_nv_index(ectx);
+    uint8_t data[NV_SIZE];
+
+    tcti->fail_at = 3;
+    tcti->fail_rc = TPM2_RC_RETRY;
+    assert_int_equal(Esys_NV_ReadBulk(ectx, nvIndex, nvIndex,
+                                      ESYS_TR_PASSWORD, ESYS_TR_NONE,
+                                      ESYS_TR_NONE, NV_SIZE, 0, data),
+                     TSS2_RC_SUCCESS);
+    assert_memory_equal(data, &tcti->nv[0], NV_SIZE);
+    assert_int_equal(tcti->commands, 1 + (NV_SIZE + NV_BUFFER_MAX - 1) /
+                                     NV_BUFFER_MAX);
+}
+
+/** Other TPM errors are returned without resending the chunk. */
+static void
+test_error(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_NV_BULK *tcti = get_tcti(ectx);
+    ESYS_TR nvIndex = get_nv_index(ectx);
+    uint8_t data[NV_SIZE];
+
+    tcti->fail_at = 2;
+    tcti->fail_rc = TPM2_RC_NV_LOCKED;
+    assert_int_equal(Esys_NV_ReadBulk(ectx, nvIndex, nvIndex,
+                                      ESYS_TR_PASSWORD, ESYS_TR_NONE,
+                                      ESYS_TR_NONE, NV_SIZE, 0, data),
+                     TPM2_RC_NV_LOCKED);
+    assert_int_equal(tcti->commands, 2);
+
+    /* The context and its SYS contexts are usable again */
+    assert_int_equal(Esys_NV_ReadBulk(ectx, nvIndex, nvIndex,
+                                      ESYS_TR_PASSWORD, ESYS_TR_NONE,
+                                      ESYS_TR_NONE, NV_SIZE, 0, data),
+                     TSS2_RC_SUCCESS);
+    assert_memory_equal(data, &tcti->nv[0], NV_SIZE);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_bad_parameters, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_read, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_write, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_retry, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_error, setup, teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,201 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+
+#include "tss2-esys/esys_iutil.h"
+#include "tss2-esys/esys_int.h"
+#define LOGMODULE tests
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/**
+ * This unit test checks the hash table indexing the ESYS_TR resource objects
+ * of an ESYS_CONTEXT: lookup, close, reuse of deleted slots, the list order
+ * used by iesys_DeleteAllResourceObjects and lookups with 100k objects. The
+ * lookup cost is measured by tss2-bench.
+ */
+
+static int
+setup(void **state)
+{
+    ESYS_CONTEXT *ctx = calloc(1, sizeof(ESYS_CONTEXT));
+    assert_non_null(ctx);
+    *state = ctx;
+    return 0;
+}
+
+static int
+teardown(void **state)
+{
+    ESYS_CONTEXT *ctx = *state;
+    iesys_DeleteAllResourceObjects(ctx);
+    assert_null(ctx->rsrc_list);
+    assert_null(ctx->rsrc_table);
+    free(ctx);
+    return 0;
+}
+
+static void
+create_objects(ESYS_CONTEXT *ctx, size_t count)
+{
+    TSS2_RC r;
+    RSRC_NODE_T *node;
+
+    for (size_t i = 0; i < count; i++) {
+        r = esys_CreateResourceObject(ctx, ESYS_TR_MIN_OBJECT + i, &node);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        assert_int_equal(node->esys_handle, ESYS_TR_MIN_OBJECT + i);
+    }
+}
+
+static void
+test_lookup_close(void **state)
+{
+    ESYS_CONTEXT *ctx = *state;
+    RSRC_NODE_T *node;
+    ESYS_TR handle;
+    TSS2_RC r;
+    size_t count = 1000;
+
+    create_objects(ctx, count);
+    assert_int_equal(ctx->rsrc_count, count);
+
+    for (size_t i = 0; i < count; i++) {
+        r = esys_GetResourceObject(ctx, ESYS_TR_MIN_OBJECT + i, &node);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        assert_int_equal(node->esys_handle, ESYS_TR_MIN_OBJECT + i);
+    }
+
+    /* Close every even object */
+    for (size_t i = 0; i < count; i += 2) {
+        handle = ESYS_TR_MIN_OBJECT + i;
+        r = Esys_TR_Close(ctx, &handle);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        assert_int_equal(handle, ESYS_TR_NONE);
+    }
+    assert_int_equal(ctx->rsrc_count, count / 2);
+
+    for (size_t i = 0; i < count; i++) {
+        r = esys_GetResourceObject(ctx, ESYS_TR_MIN_OBJECT + i, &node);
+        if (i % 2) {
+            assert_int_equal(r, TSS2_RC_SUCCESS);
+            assert_int_equal(node->esys_handle, ESYS_TR_MIN_OBJECT + i);
+        } else {
+            assert_int_equal(r, TSS2_ESYS_RC_BAD_TR);
+        }
+    }
+
+    handle = ESYS_TR_MIN_OBJECT;
+    r = Esys_TR_Close(ctx, &handle);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_TR);
+
+    /* The list must still link all remaining objects in both directions */
+    size_t n = 0;
+    for (node = ctx->rsrc_list; node != NULL; node = node->next, n++) {
+        if (node->next)
+            assert_ptr_equal(node->next->prev, node);
+    }
+    assert_int_equal(n, count / 2);
+}
+
+static void
+test_deleted_slot_reuse(void **state)
+{
+    ESYS_CONTEXT *ctx = *state;
+    RSRC_NODE_T *node;
+    ESYS_TR handle;
+    TSS2_RC r;
+
+    /* Creating and closing objects must not let the table grow without
+       bounds. */
+    for (size_t i = 0; i < 100000; i++) {
+        r = esys_CreateResourceObject(ctx, ESYS_TR_MIN_OBJECT + i, &node);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        handle = ESYS_TR_MIN_OBJECT + i;
+        r = Esys_TR_Close(ctx, &handle);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+    }
+    assert_int_equal(ctx->rsrc_count, 0);
+    assert_null(ctx->rsrc_list);
+    assert_true(ctx->rsrc_table_size <= 64);
+}
+
+static void
+test_global_objects(void **state)
+{
+    ESYS_CONTEXT *ctx = *state;
+    RSRC_NODE_T *node1, *node2;
+    TSS2_RC r;
+
+    r = esys_GetResourceObject(ctx, ESYS_TR_RH_OWNER, &node1);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(node1->rsrc.handle, TPM2_RH_OWNER);
+
+    r = esys_GetResourceObject(ctx, ESYS_TR_RH_OWNER, &node2);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_ptr_equal(node1, node2);
+    assert_int_equal(ctx->rsrc_count, 1);
+
+    r = esys_GetResourceObject(ctx, ESYS_TR_NONE, &node1);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_null(node1);
+}
+
+static void
+test_list_order(void **state)
+{
+    ESYS_CONTEXT *ctx = *state;
+    RSRC_NODE_T *node;
+    size_t count = 100;
+    size_t i;
+
+    /* Growing the table must not change the order of rsrc_list */
+    create_objects(ctx, count);
+    for (node = ctx->rsrc_list, i = count; node != NULL; node = node->next)
+        assert_int_equal(node->esys_handle, ESYS_TR_MIN_OBJECT + --i);
+    assert_int_equal(i, 0);
+}
+
+static void
+test_lookup_large(void **state)
+{
+    ESYS_CONTEXT *ctx = *state;
+    RSRC_NODE_T *node;
+    TSS2_RC r;
+    size_t count = 100000;
+
+    create_objects(ctx, count);
+    for (size_t i = 0; i < count; i++) {
+        r = esys_GetResourceObject(ctx, ESYS_TR_MIN_OBJECT + i, &node);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+        assert_int_equal(node->esys_handle, ESYS_TR_MIN_OBJECT + i);
+    }
+    r = esys_GetResourceObject(ctx, ESYS_TR_MIN_OBJECT + count, &node);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_TR);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_lookup_close, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_deleted_slot_reuse, setup,
+                                        teardown),
+        cmocka_unit_test_setup_teardown(test_global_objects, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_list_order, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_lookup_large, setup, teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
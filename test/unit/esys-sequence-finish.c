@@ -53,6 +53,30 @@ tcti_failure_receive(TSS2_TCTI_CONTEXT * tctiContext,
     return TSS2_RC_SUCCESS;
 }
 
+const uint8_t getrandom_response[] = {
+    0x80, 0x01,                 /* TPM_ST_NO_SESSION */
+    0x00, 0x00, 0x00, 0x10,     /* Response Size 16 */
+    0x00, 0x00, 0x00, 0x00,     /* TPM_RC_SUCCESS */
+    0x00, 0x04,                 /* randomBytes.size */
+    0x01, 0x02, 0x03, 0x04      /* randomBytes.buffer */
+};
+
+static TSS2_RC
+tcti_getrandom_receive(TSS2_TCTI_CONTEXT * tctiContext,
+                       size_t * response_size,
+                       uint8_t * response_buffer, int32_t timeout)
+{
+    (void)(tctiContext);
+    (void)(timeout);
+
+    *response_size = sizeof(getrandom_response);
+    if (response_buffer != NULL)
+        memcpy(response_buffer, &getrandom_response[0],
+               sizeof(getrandom_response));
+
+    return TSS2_RC_SUCCESS;
+}
+
 /**
  * Prepare ESAPI context with a reference to SAPI and TCTI context.
  */
@@ -349,6 +373,8 @@ check_Unseal(void **state)
         esys_context->state = esys_states[i];
         r = Esys_Unseal_Finish(esys_context, &outData);
         assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
+        r = Esys_Unseal_FinishInto(esys_context, NULL);
+        assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
     }
 }
 
@@ -645,14 +671,60 @@ check_GetRandom(void **state)
         _ESYS_STATE_RESUBMISSION,
         _ESYS_STATE_INTERNALERROR
     };
-    TPM2B_DIGEST *randomBytes;
+    TPM2B_DIGEST unchanged;
+    TPM2B_DIGEST *randomBytes = &unchanged;
     for (size_t i = 0; i < sizeof(esys_states) / sizeof(esys_states[0]); i++) {
         esys_context->state = esys_states[i];
         r = Esys_GetRandom_Finish(esys_context, &randomBytes);
         assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
+        assert_ptr_equal(randomBytes, &unchanged);
+        r = Esys_GetRandom_FinishInto(esys_context, NULL);
+        assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
     }
 }
 
+/*
+ * The finish calls must also succeed once the TPM answered; FinishInto
+ * decodes into caller storage and Finish allocates from it.
+ */
+void
+check_GetRandom_success(void **state)
+{
+    TSS2_RC r;
+    ESYS_CONTEXT *esys_context = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT *tcti;
+    TPM2B_DIGEST randomBytes = { .size = 0 };
+    TPM2B_DIGEST *randomBytesOut = NULL;
+
+    r = Esys_GetTcti(esys_context, &tcti);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    TSS2_TCTI_RECEIVE (tcti) = tcti_getrandom_receive;
+
+    r = Esys_GetRandom_Async(esys_context, ESYS_TR_NONE, ESYS_TR_NONE,
+                             ESYS_TR_NONE, 4);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_GetRandom_FinishInto(esys_context, &randomBytes);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(randomBytes.size, 4);
+    assert_memory_equal(randomBytes.buffer, &getrandom_response[12], 4);
+
+    r = Esys_GetRandom_Async(esys_context, ESYS_TR_NONE, ESYS_TR_NONE,
+                             ESYS_TR_NONE, 4);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_GetRandom_Finish(esys_context, &randomBytesOut);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_non_null(randomBytesOut);
+    assert_int_equal(randomBytesOut->size, 4);
+    assert_memory_equal(randomBytesOut->buffer, &getrandom_response[12], 4);
+    free(randomBytesOut);
+
+    /* A finished command can't be finished twice; the output is untouched */
+    randomBytesOut = &randomBytes;
+    r = Esys_GetRandom_Finish(esys_context, &randomBytesOut);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
+    assert_ptr_equal(randomBytesOut, &randomBytes);
+}
+
 void
 check_StirRandom(void **state)
 {
@@ -949,6 +1021,8 @@ check_Sign(void **state)
         esys_context->state = esys_states[i];
         r = Esys_Sign_Finish(esys_context, &signature);
         assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
+        r = Esys_Sign_FinishInto(esys_context, NULL);
+        assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
     }
 }
 
@@ -1023,6 +1097,9 @@ check_PCR_Read(void **state)
                                  &pcrUpdateCounter,
                                  &pcrSelectionOut, &pcrValues);
         assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
+        r = Esys_PCR_Read_FinishInto(esys_context, &pcrUpdateCounter, NULL,
+                                     NULL);
+        assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
     }
 }
 
@@ -1468,6 +1545,9 @@ check_CreatePrimary(void **state)
                                       &creationData,
                                       &creationHash, &creationTicket);
         assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
+        r = Esys_CreatePrimary_FinishInto(esys_context, &objectHandle_handle,
+                                          NULL, NULL, NULL, NULL);
+        assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
     }
 }
 
@@ -2060,6 +2140,8 @@ check_NV_Read(void **state)
         esys_context->state = esys_states[i];
         r = Esys_NV_Read_Finish(esys_context, &data);
         assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
+        r = Esys_NV_Read_FinishInto(esys_context, NULL);
+        assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
     }
 }
 
@@ -2198,6 +2280,8 @@ main(void)
                                         esys_unit_teardown),
         cmocka_unit_test_setup_teardown(check_GetRandom, esys_unit_setup,
                                         esys_unit_teardown),
+        cmocka_unit_test_setup_teardown(check_GetRandom_success,
+                                        esys_unit_setup, esys_unit_teardown),
         cmocka_unit_test_setup_teardown(check_StirRandom, esys_unit_setup,
                                         esys_unit_teardown),
         cmocka_unit_test_setup_teardown(check_HMAC_Start, esys_unit_setup,
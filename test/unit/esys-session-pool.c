@@ -0,0 +1,446 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+#include "tss2_mu.h"
+
+#include "tss2-esys/esys_iutil.h"
+#define LOGMODULE tests
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/**
+ * This unit test checks the session pool against a TCTI that answers
+ * TPM2_StartAuthSession, TPM2_PolicyRestart and TPM2_FlushContext and
+ * counts the commands it receives.
+ */
+
+#define TCTI_SESSIONS_MAGIC 0x53455353494f4e00ULL        /* 'SESSION\0' */
+#define TCTI_SESSIONS_VERSION 0x1
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC(*finalize) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*cancel) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*getPollHandles) (TSS2_TCTI_CONTEXT * tctiContext,
+                           TSS2_TCTI_POLL_HANDLE * handles,
+                           size_t * num_handles);
+    TSS2_RC(*setLocality) (TSS2_TCTI_CONTEXT * tctiContext, uint8_t locality);
+    TPM2_CC command;
+    TPM2_HANDLE next_handle;
+    size_t try_again;           /* receive calls answered with TRY_AGAIN */
+    size_t started;
+    size_t restarted;
+    size_t flushed;
+} TSS2_TCTI_CONTEXT_SESSIONS;
+
+static TSS2_RC
+tcti_sessions_transmit(TSS2_TCTI_CONTEXT * tctiContext,
+                       size_t size, const uint8_t * buffer)
+{
+    TSS2_TCTI_CONTEXT_SESSIONS *tcti = (TSS2_TCTI_CONTEXT_SESSIONS *) tctiContext;
+    size_t offset = sizeof(TPM2_ST) + sizeof(UINT32);
+
+    assert_int_equal(Tss2_MU_TPM2_CC_Unmarshal(buffer, size, &offset,
+                                               &tcti->command),
+                     TSS2_RC_SUCCESS);
+    switch (tcti->command) {
+    case TPM2_CC_StartAuthSession:
+        tcti->started++;
+        break;
+    case TPM2_CC_PolicyRestart:
+        tcti->restarted++;
+        break;
+    case TPM2_CC_FlushContext:
+        tcti->flushed++;
+        break;
+    default:
+        fail_msg("Unexpected command 0x%" PRIx32, tcti->command);
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_sessions_receive(TSS2_TCTI_CONTEXT * tctiContext,
+                      size_t * response_size,
+                      uint8_t * response_buffer, int32_t timeout)
+{
+    TSS2_TCTI_CONTEXT_SESSIONS *tcti = (TSS2_TCTI_CONTEXT_SESSIONS *) tctiContext;
+    TPM2B_NONCE nonceTPM = { .size = 32 };
+    size_t offset = 0;
+    (void) timeout;
+
+    if (tcti->try_again > 0) {
+        tcti->try_again--;
+        return TSS2_TCTI_RC_TRY_AGAIN;
+    }
+
+    Tss2_MU_TPM2_ST_Marshal(TPM2_ST_NO_SESSIONS, response_buffer,
+                            *response_size, &offset);
+    offset += sizeof(UINT32);
+    Tss2_MU_UINT32_Marshal(TPM2_RC_SUCCESS, response_buffer, *response_size,
+                           &offset);
+    if (tcti->command == TPM2_CC_StartAuthSession) {
+        Tss2_MU_TPM2_HANDLE_Marshal(tcti->next_handle++, response_buffer,
+                                    *response_size, &offset);
+        memset(&nonceTPM.buffer[0], 0x5a, nonceTPM.size);
+        Tss2_MU_TPM2B_NONCE_Marshal(&nonceTPM, response_buffer,
+                                    *response_size, &offset);
+    }
+    *response_size = offset;
+    offset = sizeof(TPM2_ST);
+    Tss2_MU_UINT32_Marshal(*response_size, response_buffer,
+                           sizeof(TPM2_ST) + sizeof(UINT32), &offset);
+
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+tcti_sessions_finalize(TSS2_TCTI_CONTEXT * tctiContext)
+{
+    (void)(tctiContext);
+}
+
+static int
+setup(void **state)
+{
+    TSS2_RC r;
+    ESYS_CONTEXT *ectx;
+    TSS2_TCTI_CONTEXT_SESSIONS *tcti = calloc(1, sizeof(*tcti));
+
+    if (tcti == NULL)
+        return -1;
+    TSS2_TCTI_MAGIC(tcti) = TCTI_SESSIONS_MAGIC;
+    TSS2_TCTI_VERSION(tcti) = TCTI_SESSIONS_VERSION;
+    TSS2_TCTI_TRANSMIT(tcti) = tcti_sessions_transmit;
+    TSS2_TCTI_RECEIVE(tcti) = tcti_sessions_receive;
+    TSS2_TCTI_FINALIZE(tcti) = tcti_sessions_finalize;
+    tcti->next_handle = TPM2_HMAC_SESSION_FIRST;
+
+    r = Esys_Initialize(&ectx, (TSS2_TCTI_CONTEXT *) tcti, NULL);
+    if (r)
+        return (int)r;
+    *state = (void *)ectx;
+    return 0;
+}
+
+static int
+teardown(void **state)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+
+    Esys_GetTcti(ectx, &tcti);
+    Esys_Finalize(&ectx);
+    free(tcti);
+    return 0;
+}
+
+static TSS2_TCTI_CONTEXT_SESSIONS *
+get_tcti(ESYS_CONTEXT *ectx)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+
+    assert_int_equal(Esys_GetTcti(ectx, &tcti), TSS2_RC_SUCCESS);
+    return (TSS2_TCTI_CONTEXT_SESSIONS *) tcti;
+}
+
+static const ESYS_SESSION_TEMPLATE hmac_template = {
+    .tpmKey = ESYS_TR_NONE,
+    .bind = ESYS_TR_NONE,
+    .sessionType = TPM2_SE_HMAC,
+    .symmetric = { .algorithm = TPM2_ALG_AES,
+                   .keyBits = { .aes = 128 },
+                   .mode = { .aes = TPM2_ALG_CFB } },
+    .authHash = TPM2_ALG_SHA256,
+    .sessionAttributes = TPMA_SESSION_DECRYPT,
+};
+
+static void
+test_bad_parameters(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    ESYS_SESSION_POOL *pool = NULL;
+    ESYS_TR session;
+    TSS2_RC r;
+
+    r = Esys_SessionPool_Create(ectx, NULL, 0, 1, &pool);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+    r = Esys_SessionPool_Create(ectx, &hmac_template, 0, 0, &pool);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_VALUE);
+    r = Esys_SessionPool_Create(ectx, &hmac_template, 2, 1, &pool);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_VALUE);
+    assert_null(pool);
+
+    r = Esys_SessionPool_Create(ectx, &hmac_template, 0, 1, &pool);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_SessionPool_Acquire(pool, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+    r = Esys_SessionPool_Release(pool, ESYS_TR_MIN_OBJECT);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
+    r = Esys_SessionPool_Acquire(NULL, &session);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    assert_int_equal(Esys_SessionPool_Free(&pool), TSS2_RC_SUCCESS);
+    assert_null(pool);
+    assert_int_equal(Esys_SessionPool_Free(&pool), TSS2_RC_SUCCESS);
+}
+
+/** Acquiring and releasing HMAC sessions of a prefilled pool sends nothing. */
+static void
+test_hmac_reuse(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_SESSIONS *tcti = get_tcti(ectx);
+    ESYS_SESSION_POOL *pool;
+    ESYS_TR session, session2;
+    TPMA_SESSION flags;
+    TSS2_RC r;
+
+    r = Esys_SessionPool_Create(ectx, &hmac_template, 2, 4, &pool);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->started, 2);
+
+    r = Esys_SessionPool_Acquire(pool, &session);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_TRSess_GetAttributes(ectx, session, &flags);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(flags, TPMA_SESSION_DECRYPT | TPMA_SESSION_CONTINUESESSION);
+
+    /* The attributes are reset on the next acquire */
+    r = Esys_TRSess_SetAttributes(ectx, session, 0, TPMA_SESSION_DECRYPT);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_SessionPool_Release(pool, session);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_SessionPool_Acquire(pool, &session2);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(session2, session);
+    r = Esys_TRSess_GetAttributes(ectx, session2, &flags);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(flags, TPMA_SESSION_DECRYPT | TPMA_SESSION_CONTINUESESSION);
+    r = Esys_SessionPool_Release(pool, session2);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    assert_int_equal(tcti->started, 2);
+    assert_int_equal(tcti->restarted, 0);
+    assert_int_equal(tcti->flushed, 0);
+
+    assert_int_equal(Esys_SessionPool_Free(&pool), TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->flushed, 2);
+}
+
+/** An empty pool starts sessions on demand, up to max. */
+static void
+test_acquire_limit(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_SESSIONS *tcti = get_tcti(ectx);
+    ESYS_SESSION_POOL *pool;
+    ESYS_TR session, session2;
+    TSS2_RC r;
+
+    r = Esys_SessionPool_Create(ectx, &hmac_template, 0, 1, &pool);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->started, 0);
+
+    r = Esys_SessionPool_Acquire(pool, &session);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->started, 1);
+    r = Esys_SessionPool_Acquire(pool, &session2);
+    assert_int_equal(r, TSS2_ESYS_RC_TRY_AGAIN);
+
+    r = Esys_SessionPool_Release(pool, session);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_SessionPool_Acquire(pool, &session2);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(session2, session);
+    assert_int_equal(tcti->started, 1);
+
+    /* Acquired sessions are left to the caller */
+    assert_int_equal(Esys_SessionPool_Free(&pool), TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->flushed, 0);
+    assert_int_equal(Esys_FlushContext(ectx, session2), TSS2_RC_SUCCESS);
+}
+
+/** Only sessions acquired from the pool are taken back, and only once. */
+static void
+test_release_unknown(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_SESSIONS *tcti = get_tcti(ectx);
+    ESYS_SESSION_POOL *pool;
+    ESYS_TR session, session2;
+    TSS2_RC r;
+
+    r = Esys_SessionPool_Create(ectx, &hmac_template, 2, 2, &pool);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_SessionPool_Acquire(pool, &session);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_SessionPool_Acquire(pool, &session2);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    r = Esys_SessionPool_Release(pool, ESYS_TR_RH_OWNER);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_VALUE);
+    r = Esys_SessionPool_Release(pool, session);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_SessionPool_Release(pool, session);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_VALUE);
+    r = Esys_SessionPool_Release(pool, session2);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_SessionPool_Release(pool, session2);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
+
+    assert_int_equal(Esys_SessionPool_Free(&pool), TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->started, 2);
+    assert_int_equal(tcti->flushed, 2);
+}
+
+/** Sessions that are gone or about to go are dropped instead of reused. */
+static void
+test_release_dropped(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_SESSIONS *tcti = get_tcti(ectx);
+    ESYS_SESSION_POOL *pool;
+    ESYS_TR session, session2;
+    TSS2_RC r;
+
+    r = Esys_SessionPool_Create(ectx, &hmac_template, 0, 1, &pool);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    /* Flushed by the caller */
+    r = Esys_SessionPool_Acquire(pool, &session);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_FlushContext(ectx, session), TSS2_RC_SUCCESS);
+    r = Esys_SessionPool_Release(pool, session);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->flushed, 1);
+
+    /* continueSession cleared, so the TPM flushes it after its next use */
+    r = Esys_SessionPool_Acquire(pool, &session2);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->started, 2);
+    r = Esys_TRSess_SetAttributes(ectx, session2, 0,
+                                  TPMA_SESSION_CONTINUESESSION);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_SessionPool_Release(pool, session2);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->flushed, 1);
+
+    /* Neither came back into the pool */
+    r = Esys_SessionPool_Acquire(pool, &session);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->started, 3);
+    r = Esys_SessionPool_Release(pool, session);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    assert_int_equal(Esys_SessionPool_Free(&pool), TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->flushed, 2);
+}
+
+/** Policy sessions are reset with PolicyRestart instead of being flushed. */
+static void
+test_policy_restart(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_SESSIONS *tcti = get_tcti(ectx);
+    ESYS_SESSION_TEMPLATE policy_template = hmac_template;
+    ESYS_SESSION_POOL *pool;
+    ESYS_TR session;
+    TSS2_RC r;
+
+    policy_template.sessionType = TPM2_SE_POLICY;
+    r = Esys_SessionPool_Create(ectx, &policy_template, 1, 1, &pool);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    r = Esys_SessionPool_Acquire(pool, &session);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_SessionPool_Release(pool, session);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->restarted, 1);
+    assert_int_equal(tcti->flushed, 0);
+    assert_int_equal(tcti->started, 1);
+
+    assert_int_equal(Esys_SessionPool_Free(&pool), TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->flushed, 1);
+}
+
+/** Refill_Async/_Finish start one session per call pair, up to min. */
+static void
+test_refill_async(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_SESSIONS *tcti = get_tcti(ectx);
+    ESYS_SESSION_POOL *pool;
+    ESYS_TR session[2];
+    TSS2_RC r;
+
+    r = Esys_SessionPool_Create(ectx, &hmac_template, 1, 3, &pool);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_SessionPool_Acquire(pool, &session[0]);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->started, 1);
+
+    r = Esys_SessionPool_Refill_Async(pool);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->started, 2);
+    r = Esys_SessionPool_Refill_Async(pool);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_SEQUENCE);
+
+    tcti->try_again = 1;
+    r = Esys_SessionPool_Refill_Finish(pool);
+    assert_int_equal(r & ~TSS2_RC_LAYER_MASK, TSS2_BASE_RC_TRY_AGAIN);
+    r = Esys_SessionPool_Refill_Finish(pool);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    /* The pool holds min ready sessions, so this is a no-op */
+    r = Esys_SessionPool_Refill_Async(pool);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_SessionPool_Refill_Finish(pool);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->started, 2);
+
+    /* An outstanding refill is completed by Release */
+    r = Esys_SessionPool_Acquire(pool, &session[1]);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_SessionPool_Refill_Async(pool);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->started, 3);
+    r = Esys_SessionPool_Release(pool, session[0]);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_SessionPool_Release(pool, session[1]);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+
+    assert_int_equal(Esys_SessionPool_Free(&pool), TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->flushed, 3);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_bad_parameters, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_hmac_reuse, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_acquire_limit, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_release_unknown, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_release_dropped, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_policy_restart, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_refill_async, setup, teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
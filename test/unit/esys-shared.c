@@ -0,0 +1,471 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+#include "tss2_mu.h"
+
+#include "tss2-esys/esys_iutil.h"
+#define LOGMODULE tests
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/**
+ * This unit test checks the shared context with several threads against a
+ * TCTI that answers TPM2_GetRandom, TPM2_StartAuthSession and
+ * TPM2_FlushContext and counts the commands it receives. A TPM2_GetRandom
+ * with a session is answered with TPM2_RC_VALUE, so that it does not need a
+ * response HMAC.
+ */
+
+#define TCTI_SHARED_MAGIC 0x5348415245440000ULL        /* 'SHARED\0\0' */
+#define TCTI_SHARED_VERSION 0x1
+
+#define THREADS 8
+#define JOBS 200
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC(*finalize) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*cancel) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*getPollHandles) (TSS2_TCTI_CONTEXT * tctiContext,
+                           TSS2_TCTI_POLL_HANDLE * handles,
+                           size_t * num_handles);
+    TSS2_RC(*setLocality) (TSS2_TCTI_CONTEXT * tctiContext, uint8_t locality);
+    TPM2_ST tag;
+    TPM2_CC command;
+    UINT16 bytesRequested;
+    TPM2_HANDLE next_handle;
+    size_t random;
+    size_t started;
+    size_t flushed;
+} TSS2_TCTI_CONTEXT_SHARED;
+
+static TSS2_RC
+tcti_shared_transmit(TSS2_TCTI_CONTEXT * tctiContext,
+                     size_t size, const uint8_t * buffer)
+{
+    TSS2_TCTI_CONTEXT_SHARED *tcti = (TSS2_TCTI_CONTEXT_SHARED *) tctiContext;
+    size_t offset = 0;
+
+    Tss2_MU_TPM2_ST_Unmarshal(buffer, size, &offset, &tcti->tag);
+    offset += sizeof(UINT32);
+    Tss2_MU_TPM2_CC_Unmarshal(buffer, size, &offset, &tcti->command);
+    switch (tcti->command) {
+    case TPM2_CC_GetRandom:
+        tcti->random++;
+        if (tcti->tag == TPM2_ST_NO_SESSIONS) {
+            Tss2_MU_UINT16_Unmarshal(buffer, size, &offset,
+                                     &tcti->bytesRequested);
+        }
+        break;
+    case TPM2_CC_StartAuthSession:
+        tcti->started++;
+        break;
+    case TPM2_CC_FlushContext:
+        tcti->flushed++;
+        break;
+    default:
+        fail_msg("Unexpected command 0x%" PRIx32, tcti->command);
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_shared_receive(TSS2_TCTI_CONTEXT * tctiContext,
+                    size_t * response_size,
+                    uint8_t * response_buffer, int32_t timeout)
+{
+    TSS2_TCTI_CONTEXT_SHARED *tcti = (TSS2_TCTI_CONTEXT_SHARED *) tctiContext;
+    TPM2B_NONCE nonceTPM = { .size = 32 };
+    TPM2B_DIGEST randomBytes = { .size = tcti->bytesRequested };
+    TPM2_RC rc = TPM2_RC_SUCCESS;
+    size_t offset = 0;
+    (void) timeout;
+
+    if (tcti->command == TPM2_CC_GetRandom && tcti->tag == TPM2_ST_SESSIONS)
+        rc = TPM2_RC_VALUE;
+
+    Tss2_MU_TPM2_ST_Marshal(TPM2_ST_NO_SESSIONS, response_buffer,
+                            *response_size, &offset);
+    offset += sizeof(UINT32);
+    Tss2_MU_UINT32_Marshal(rc, response_buffer, *response_size, &offset);
+    if (rc == TPM2_RC_SUCCESS && tcti->command == TPM2_CC_GetRandom) {
+        memset(&randomBytes.buffer[0], 0xa5, randomBytes.size);
+        Tss2_MU_TPM2B_DIGEST_Marshal(&randomBytes, response_buffer,
+                                     *response_size, &offset);
+    } else if (tcti->command == TPM2_CC_StartAuthSession) {
+        Tss2_MU_TPM2_HANDLE_Marshal(tcti->next_handle++, response_buffer,
+                                    *response_size, &offset);
+        memset(&nonceTPM.buffer[0], 0x5a, nonceTPM.size);
+        Tss2_MU_TPM2B_NONCE_Marshal(&nonceTPM, response_buffer,
+                                    *response_size, &offset);
+    }
+    *response_size = offset;
+    offset = sizeof(TPM2_ST);
+    Tss2_MU_UINT32_Marshal(*response_size, response_buffer,
+                           sizeof(TPM2_ST) + sizeof(UINT32), &offset);
+
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+tcti_shared_finalize(TSS2_TCTI_CONTEXT * tctiContext)
+{
+    (void)(tctiContext);
+}
+
+typedef struct {
+    TSS2_TCTI_CONTEXT_SHARED tcti;
+    ESYS_SHARED *shared;
+} test_state_t;
+
+static int
+setup(void **state)
+{
+    TSS2_RC r;
+    test_state_t *test = calloc(1, sizeof(*test));
+
+    if (test == NULL)
+        return -1;
+    TSS2_TCTI_MAGIC(&test->tcti) = TCTI_SHARED_MAGIC;
+    TSS2_TCTI_VERSION(&test->tcti) = TCTI_SHARED_VERSION;
+    TSS2_TCTI_TRANSMIT(&test->tcti) = tcti_shared_transmit;
+    TSS2_TCTI_RECEIVE(&test->tcti) = tcti_shared_receive;
+    TSS2_TCTI_FINALIZE(&test->tcti) = tcti_shared_finalize;
+    test->tcti.next_handle = TPM2_HMAC_SESSION_FIRST;
+
+    r = Esys_Shared_Initialize(&test->shared,
+                               (TSS2_TCTI_CONTEXT *) &test->tcti, NULL);
+    if (r)
+        return (int)r;
+    *state = (void *)test;
+    return 0;
+}
+
+static int
+teardown(void **state)
+{
+    test_state_t *test = (test_state_t *) * state;
+
+    Esys_Shared_Finalize(&test->shared);
+    free(test);
+    return 0;
+}
+
+static TSS2_RC
+job_get_random(ESYS_CONTEXT *esysContext, void *userdata)
+{
+    TPM2B_DIGEST *randomBytes = NULL;
+    TSS2_RC r;
+
+    r = Esys_GetRandom(esysContext, ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                       16, &randomBytes);
+    if (r == TSS2_RC_SUCCESS && randomBytes->size != 16)
+        r = TSS2_ESYS_RC_MALFORMED_RESPONSE;
+    free(randomBytes);
+    if (userdata != NULL)
+        (*(size_t *) userdata)++;
+    return r;
+}
+
+static void
+test_bad_parameters(void **state)
+{
+    test_state_t *test = (test_state_t *) * state;
+    ESYS_SHARED_CLIENT *client = NULL;
+    ESYS_SHARED_FUTURE *future = NULL;
+    TSS2_RC r;
+
+    r = Esys_Shared_Initialize(NULL, NULL, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+    r = Esys_Shared_ClientOpen(NULL, &client);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+    r = Esys_Shared_ClientOpen(test->shared, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+    r = Esys_Shared_ClientClose(&client);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+    r = Esys_Shared_Wait(&future, 0);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+
+    r = Esys_Shared_ClientOpen(test->shared, &client);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    r = Esys_Shared_Submit(client, NULL, NULL, &future);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+    r = Esys_Shared_Submit(client, job_get_random, NULL, NULL);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+    r = Esys_Shared_Submit(NULL, job_get_random, NULL, &future);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_REFERENCE);
+    assert_null(future);
+
+    r = Esys_Shared_ClientClose(&client);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_null(client);
+}
+
+typedef struct thread_state thread_state_t;
+
+typedef struct {
+    thread_state_t *thread;
+    size_t index;
+} job_t;
+
+struct thread_state {
+    ESYS_SHARED *shared;
+    job_t jobs[JOBS];
+    size_t runs[JOBS];
+    size_t next;                 /* The index of the next expected job */
+    size_t out_of_order;
+    TSS2_RC rc;
+};
+
+/** Check that the jobs of a client run in the order of submission. */
+static TSS2_RC
+job_ordered(ESYS_CONTEXT *esysContext, void *userdata)
+{
+    job_t *job = userdata;
+    thread_state_t *thread = job->thread;
+
+    if (thread->next != job->index)
+        thread->out_of_order++;
+    thread->next = job->index + 1;
+    return job_get_random(esysContext, &thread->runs[job->index]);
+}
+
+static void *
+thread_submit(void *arg)
+{
+    thread_state_t *thread = arg;
+    ESYS_SHARED_CLIENT *client = NULL;
+    ESYS_SHARED_FUTURE *futures[JOBS];
+    size_t i;
+    TSS2_RC r;
+
+    thread->rc = Esys_Shared_ClientOpen(thread->shared, &client);
+    if (thread->rc != TSS2_RC_SUCCESS)
+        return NULL;
+    for (i = 0; i < JOBS; i++) {
+        thread->jobs[i].thread = thread;
+        thread->jobs[i].index = i;
+        r = Esys_Shared_Submit(client, job_ordered, &thread->jobs[i],
+                               &futures[i]);
+        if (r != TSS2_RC_SUCCESS) {
+            thread->rc = r;
+            return NULL;
+        }
+    }
+    for (i = 0; i < JOBS; i++) {
+        r = Esys_Shared_Wait(&futures[i], TSS2_TCTI_TIMEOUT_BLOCK);
+        if (r != TSS2_RC_SUCCESS)
+            thread->rc = r;
+    }
+    r = Esys_Shared_ClientClose(&client);
+    if (r != TSS2_RC_SUCCESS)
+        thread->rc = r;
+    return NULL;
+}
+
+/** Test that the jobs of many threads are all run once and in order. */
+static void
+test_threads(void **state)
+{
+    test_state_t *test = (test_state_t *) * state;
+    thread_state_t *threads = calloc(THREADS, sizeof(*threads));
+    pthread_t ids[THREADS];
+    size_t i, j;
+
+    assert_non_null(threads);
+    for (i = 0; i < THREADS; i++) {
+        threads[i].shared = test->shared;
+        assert_int_equal(pthread_create(&ids[i], NULL, thread_submit,
+                                        &threads[i]), 0);
+    }
+    for (i = 0; i < THREADS; i++)
+        assert_int_equal(pthread_join(ids[i], NULL), 0);
+
+    for (i = 0; i < THREADS; i++) {
+        assert_int_equal(threads[i].rc, TSS2_RC_SUCCESS);
+        assert_int_equal(threads[i].out_of_order, 0);
+        for (j = 0; j < JOBS; j++)
+            assert_int_equal(threads[i].runs[j], 1);
+    }
+    assert_int_equal(test->tcti.random, THREADS * JOBS);
+    free(threads);
+}
+
+static TSS2_RC
+job_start_session(ESYS_CONTEXT *esysContext, void *userdata)
+{
+    TPMT_SYM_DEF symmetric = { .algorithm = TPM2_ALG_NULL };
+
+    return Esys_StartAuthSession(esysContext, ESYS_TR_NONE, ESYS_TR_NONE,
+                                 ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                                 NULL, TPM2_SE_HMAC, &symmetric,
+                                 TPM2_ALG_SHA256, (ESYS_TR *) userdata);
+}
+
+static TSS2_RC
+job_session_get_random(ESYS_CONTEXT *esysContext, void *userdata)
+{
+    TPM2B_DIGEST *randomBytes = NULL;
+    TSS2_RC r;
+
+    r = Esys_GetRandom(esysContext, *(ESYS_TR *) userdata, ESYS_TR_NONE,
+                       ESYS_TR_NONE, 16, &randomBytes);
+    free(randomBytes);
+    return r;
+}
+
+static TSS2_RC
+job_session_flush(ESYS_CONTEXT *esysContext, void *userdata)
+{
+    return Esys_FlushContext(esysContext, *(ESYS_TR *) userdata);
+}
+
+static TSS2_RC
+job_session_close(ESYS_CONTEXT *esysContext, void *userdata)
+{
+    ESYS_TR session = *(ESYS_TR *) userdata;
+
+    return Esys_TR_Close(esysContext, &session);
+}
+
+static TSS2_RC
+job_session_set_auth(ESYS_CONTEXT *esysContext, void *userdata)
+{
+    TPM2B_AUTH auth = { .size = 1, .buffer = { 0x01 } };
+
+    return Esys_TR_SetAuth(esysContext, *(ESYS_TR *) userdata, &auth);
+}
+
+/** Test that a session can only be used, flushed or closed by the client
+ *  that started it and is flushed when that client is closed. */
+static void
+test_session_owner(void **state)
+{
+    test_state_t *test = (test_state_t *) * state;
+    ESYS_SHARED_CLIENT *owner = NULL, *other = NULL;
+    ESYS_TR session = ESYS_TR_NONE;
+    TSS2_RC r;
+
+    assert_int_equal(Esys_Shared_ClientOpen(test->shared, &owner),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_Shared_ClientOpen(test->shared, &other),
+                     TSS2_RC_SUCCESS);
+
+    r = Esys_Shared_Call(owner, job_start_session, &session);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(test->tcti.started, 1);
+
+    /* The other client is rejected before anything is sent */
+    r = Esys_Shared_Call(other, job_session_get_random, &session);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_TR);
+    assert_int_equal(test->tcti.random, 0);
+    r = Esys_Shared_Call(other, job_session_flush, &session);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_TR);
+    assert_int_equal(test->tcti.flushed, 0);
+    r = Esys_Shared_Call(other, job_session_close, &session);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_TR);
+    r = Esys_Shared_Call(other, job_session_set_auth, &session);
+    assert_int_equal(r, TSS2_ESYS_RC_BAD_TR);
+
+    r = Esys_Shared_Call(owner, job_session_get_random, &session);
+    assert_int_equal(r, TPM2_RC_VALUE);
+    assert_int_equal(test->tcti.random, 1);
+
+    /* Closing the other client leaves the session alone */
+    assert_int_equal(Esys_Shared_ClientClose(&other), TSS2_RC_SUCCESS);
+    assert_int_equal(test->tcti.flushed, 0);
+    assert_int_equal(Esys_Shared_ClientClose(&owner), TSS2_RC_SUCCESS);
+    assert_int_equal(test->tcti.flushed, 1);
+}
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int open;
+} gate_t;
+
+/** Block the worker until the test opens the gate. */
+static TSS2_RC
+job_gate(ESYS_CONTEXT *esysContext, void *userdata)
+{
+    gate_t *gate = userdata;
+    (void) esysContext;
+
+    pthread_mutex_lock(&gate->mutex);
+    while (!gate->open)
+        pthread_cond_wait(&gate->cond, &gate->mutex);
+    pthread_mutex_unlock(&gate->mutex);
+    return TSS2_ESYS_RC_BAD_VALUE;
+}
+
+/** Test polling and timed waiting for a job that is not done. */
+static void
+test_wait_timeout(void **state)
+{
+    test_state_t *test = (test_state_t *) * state;
+    ESYS_SHARED_CLIENT *client = NULL;
+    ESYS_SHARED_FUTURE *future = NULL, *queued = NULL;
+    size_t runs = 0;
+    gate_t gate = {
+        .mutex = PTHREAD_MUTEX_INITIALIZER,
+        .cond = PTHREAD_COND_INITIALIZER,
+    };
+
+    assert_int_equal(Esys_Shared_ClientOpen(test->shared, &client),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_Shared_Submit(client, job_gate, &gate, &future),
+                     TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_Shared_Submit(client, job_get_random, &runs,
+                                        &queued),
+                     TSS2_RC_SUCCESS);
+
+    assert_int_equal(Esys_Shared_Wait(&future, 0), TSS2_ESYS_RC_TRY_AGAIN);
+    assert_int_equal(Esys_Shared_Wait(&future, 10), TSS2_ESYS_RC_TRY_AGAIN);
+    assert_int_equal(Esys_Shared_Wait(&queued, 0), TSS2_ESYS_RC_TRY_AGAIN);
+    assert_non_null(future);
+    assert_non_null(queued);
+
+    pthread_mutex_lock(&gate.mutex);
+    gate.open = 1;
+    pthread_cond_signal(&gate.cond);
+    pthread_mutex_unlock(&gate.mutex);
+
+    /* The result of the callback is passed through */
+    assert_int_equal(Esys_Shared_Wait(&future, TSS2_TCTI_TIMEOUT_BLOCK),
+                     TSS2_ESYS_RC_BAD_VALUE);
+    assert_null(future);
+    assert_int_equal(Esys_Shared_Wait(&queued, 1000), TSS2_RC_SUCCESS);
+    assert_null(queued);
+    assert_int_equal(runs, 1);
+
+    assert_int_equal(Esys_Shared_ClientClose(&client), TSS2_RC_SUCCESS);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_bad_parameters, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_threads, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_session_owner, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_wait_timeout, setup, teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,465 @@
+/* SPDX-License-Identifier: BSD-2 */
+/*******************************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ * All rights reserved.
+ ******************************************************************************/
+
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_esys.h"
+#include "tss2_mu.h"
+
+#include "tss2-esys/esys_iutil.h"
+#define LOGMODULE tests
+#include "util/log.h"
+#include "util/aux_util.h"
+
+/**
+ * This unit test checks the swapping of transient objects and sessions
+ * against a TCTI that emulates a TPM with a fixed number of object and
+ * session slots. The TPM fails the test if a slot limit is exceeded or if a
+ * handle is used that is not loaded.
+ */
+
+#define TCTI_SWAP_MAGIC 0x5357415054504d00ULL        /* 'SWAPTPM\0' */
+#define TCTI_SWAP_VERSION 0x1
+
+#define SLOTS 2
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC(*finalize) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*cancel) (TSS2_TCTI_CONTEXT * tctiContext);
+    TSS2_RC(*getPollHandles) (TSS2_TCTI_CONTEXT * tctiContext,
+                           TSS2_TCTI_POLL_HANDLE * handles,
+                           size_t * num_handles);
+    TSS2_RC(*setLocality) (TSS2_TCTI_CONTEXT * tctiContext, uint8_t locality);
+    TPM2_CC command;
+    TPM2_HANDLE objects[SLOTS];     /* loaded objects, 0 if the slot is free */
+    TPM2_HANDLE sessions[SLOTS];    /* loaded sessions, 0 if the slot is free */
+    TPM2_HANDLE next_object;
+    TPM2_HANDLE next_session;
+    TPM2_HANDLE response_handle;
+    TPMS_CONTEXT response_context;
+    size_t saved;
+    size_t loaded;
+    size_t flushed;
+} TSS2_TCTI_CONTEXT_SWAP;
+
+static TPM2_HANDLE *
+tpm_slot(TPM2_HANDLE *slots, TPM2_HANDLE handle)
+{
+    for (size_t i = 0; i < SLOTS; i++) {
+        if (slots[i] == handle)
+            return &slots[i];
+    }
+    return NULL;
+}
+
+static TPM2_HANDLE *
+tpm_slots(TSS2_TCTI_CONTEXT_SWAP *tcti, TPM2_HANDLE handle)
+{
+    return ((handle >> TPM2_HR_SHIFT) == TPM2_HT_TRANSIENT) ? tcti->objects
+                                                            : tcti->sessions;
+}
+
+static void
+tpm_load(TSS2_TCTI_CONTEXT_SWAP *tcti, TPM2_HANDLE handle)
+{
+    TPM2_HANDLE *slot = tpm_slot(tpm_slots(tcti, handle), 0);
+
+    if (slot == NULL)
+        fail_msg("TPM out of memory loading 0x%08" PRIx32, handle);
+    *slot = handle;
+}
+
+static void
+tpm_unload(TSS2_TCTI_CONTEXT_SWAP *tcti, TPM2_HANDLE handle)
+{
+    TPM2_HANDLE *slot = tpm_slot(tpm_slots(tcti, handle), handle);
+
+    if (slot == NULL)
+        fail_msg("Handle 0x%08" PRIx32 " not loaded", handle);
+    *slot = 0;
+}
+
+static TSS2_RC
+tcti_swap_transmit(TSS2_TCTI_CONTEXT * tctiContext,
+                   size_t size, const uint8_t * buffer)
+{
+    TSS2_TCTI_CONTEXT_SWAP *tcti = (TSS2_TCTI_CONTEXT_SWAP *) tctiContext;
+    size_t offset = sizeof(TPM2_ST) + sizeof(UINT32);
+    TPM2_HANDLE handle;
+    TPMS_CONTEXT context;
+
+    assert_int_equal(Tss2_MU_TPM2_CC_Unmarshal(buffer, size, &offset,
+                                               &tcti->command),
+                     TSS2_RC_SUCCESS);
+    switch (tcti->command) {
+    case TPM2_CC_ContextSave:
+        Tss2_MU_TPM2_HANDLE_Unmarshal(buffer, size, &offset, &handle);
+        if (tpm_slot(tpm_slots(tcti, handle), handle) == NULL)
+            fail_msg("Saving 0x%08" PRIx32 " not loaded", handle);
+        /* Saving a session removes it from the TPM's memory */
+        if ((handle >> TPM2_HR_SHIFT) != TPM2_HT_TRANSIENT)
+            tpm_unload(tcti, handle);
+        memset(&tcti->response_context, 0, sizeof(tcti->response_context));
+        tcti->response_context.sequence = ++tcti->saved;
+        tcti->response_context.savedHandle = handle;
+        tcti->response_context.hierarchy = TPM2_RH_NULL;
+        tcti->response_context.contextBlob.size = 16;
+        break;
+    case TPM2_CC_ContextLoad:
+        Tss2_MU_TPMS_CONTEXT_Unmarshal(buffer, size, &offset, &context);
+        tcti->loaded++;
+        if ((context.savedHandle >> TPM2_HR_SHIFT) == TPM2_HT_TRANSIENT)
+            tcti->response_handle = tcti->next_object++;
+        else
+            tcti->response_handle = context.savedHandle;
+        tpm_load(tcti, tcti->response_handle);
+        break;
+    case TPM2_CC_FlushContext:
+        Tss2_MU_TPM2_HANDLE_Unmarshal(buffer, size, &offset, &handle);
+        tcti->flushed++;
+        /* A saved session is flushed without loading it */
+        if ((handle >> TPM2_HR_SHIFT) != TPM2_HT_TRANSIENT &&
+            tpm_slot(tcti->sessions, handle) == NULL)
+            break;
+        tpm_unload(tcti, handle);
+        break;
+    case TPM2_CC_StartAuthSession:
+        tcti->response_handle = tcti->next_session++;
+        tpm_load(tcti, tcti->response_handle);
+        break;
+    case TPM2_CC_PolicyRestart:
+        Tss2_MU_TPM2_HANDLE_Unmarshal(buffer, size, &offset, &handle);
+        if (tpm_slot(tcti->sessions, handle) == NULL)
+            fail_msg("Session 0x%08" PRIx32 " not loaded", handle);
+        break;
+    case TPM2_CC_GetCapability:
+        break;
+    default:
+        fail_msg("Unexpected command 0x%" PRIx32, tcti->command);
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_swap_receive(TSS2_TCTI_CONTEXT * tctiContext,
+                  size_t * response_size,
+                  uint8_t * response_buffer, int32_t timeout)
+{
+    TSS2_TCTI_CONTEXT_SWAP *tcti = (TSS2_TCTI_CONTEXT_SWAP *) tctiContext;
+    TPM2B_NONCE nonceTPM = { .size = 32 };
+    TPMS_CAPABILITY_DATA capabilityData = {
+        .capability = TPM2_CAP_TPM_PROPERTIES,
+        .data.tpmProperties = {
+            .count = 3,
+            .tpmProperty = {
+                { TPM2_PT_TPM2_HR_TRANSIENT_MIN, 3 },
+                { TPM2_PT_TPM2_HR_PERSISTENT_MIN, 7 },
+                { TPM2_PT_HR_LOADED_MIN, 4 } } } };
+    size_t offset = 0;
+    (void) timeout;
+
+    Tss2_MU_TPM2_ST_Marshal(TPM2_ST_NO_SESSIONS, response_buffer,
+                            *response_size, &offset);
+    offset += sizeof(UINT32);
+    Tss2_MU_UINT32_Marshal(TPM2_RC_SUCCESS, response_buffer, *response_size,
+                           &offset);
+    switch (tcti->command) {
+    case TPM2_CC_ContextSave:
+        Tss2_MU_TPMS_CONTEXT_Marshal(&tcti->response_context, response_buffer,
+                                     *response_size, &offset);
+        break;
+    case TPM2_CC_ContextLoad:
+        Tss2_MU_TPM2_HANDLE_Marshal(tcti->response_handle, response_buffer,
+                                    *response_size, &offset);
+        break;
+    case TPM2_CC_StartAuthSession:
+        Tss2_MU_TPM2_HANDLE_Marshal(tcti->response_handle, response_buffer,
+                                    *response_size, &offset);
+        memset(&nonceTPM.buffer[0], 0x5a, nonceTPM.size);
+        Tss2_MU_TPM2B_NONCE_Marshal(&nonceTPM, response_buffer,
+                                    *response_size, &offset);
+        break;
+    case TPM2_CC_GetCapability:
+        Tss2_MU_BYTE_Marshal(TPM2_NO, response_buffer, *response_size,
+                             &offset);
+        Tss2_MU_TPMS_CAPABILITY_DATA_Marshal(&capabilityData, response_buffer,
+                                             *response_size, &offset);
+        break;
+    default:
+        break;
+    }
+    *response_size = offset;
+    offset = sizeof(TPM2_ST);
+    Tss2_MU_UINT32_Marshal(*response_size, response_buffer,
+                           sizeof(TPM2_ST) + sizeof(UINT32), &offset);
+
+    return TSS2_RC_SUCCESS;
+}
+
+static void
+tcti_swap_finalize(TSS2_TCTI_CONTEXT * tctiContext)
+{
+    (void)(tctiContext);
+}
+
+static int
+setup(void **state)
+{
+    TSS2_RC r;
+    ESYS_CONTEXT *ectx;
+    TSS2_TCTI_CONTEXT_SWAP *tcti = calloc(1, sizeof(*tcti));
+
+    if (tcti == NULL)
+        return -1;
+    TSS2_TCTI_MAGIC(tcti) = TCTI_SWAP_MAGIC;
+    TSS2_TCTI_VERSION(tcti) = TCTI_SWAP_VERSION;
+    TSS2_TCTI_TRANSMIT(tcti) = tcti_swap_transmit;
+    TSS2_TCTI_RECEIVE(tcti) = tcti_swap_receive;
+    TSS2_TCTI_FINALIZE(tcti) = tcti_swap_finalize;
+    tcti->next_object = TPM2_TRANSIENT_FIRST;
+    tcti->next_session = TPM2_POLICY_SESSION_FIRST;
+
+    r = Esys_Initialize(&ectx, (TSS2_TCTI_CONTEXT *) tcti, NULL);
+    if (r)
+        return (int)r;
+    *state = (void *)ectx;
+    return 0;
+}
+
+static int
+teardown(void **state)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+
+    Esys_GetTcti(ectx, &tcti);
+    Esys_Finalize(&ectx);
+    free(tcti);
+    return 0;
+}
+
+static TSS2_TCTI_CONTEXT_SWAP *
+get_tcti(ESYS_CONTEXT *ectx)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+
+    assert_int_equal(Esys_GetTcti(ectx, &tcti), TSS2_RC_SUCCESS);
+    return (TSS2_TCTI_CONTEXT_SWAP *) tcti;
+}
+
+/** Create a resource object for an object already loaded in the TPM. */
+static ESYS_TR
+create_object(ESYS_CONTEXT *ectx, ESYS_TR esys_handle)
+{
+    TSS2_TCTI_CONTEXT_SWAP *tcti = get_tcti(ectx);
+    RSRC_NODE_T *node;
+
+    assert_int_equal(esys_CreateResourceObject(ectx, esys_handle, &node),
+                     TSS2_RC_SUCCESS);
+    node->rsrc.handle = tcti->next_object++;
+    tpm_load(tcti, node->rsrc.handle);
+    return esys_handle;
+}
+
+static TPM2_HANDLE
+tpm_handle(ESYS_CONTEXT *ectx, ESYS_TR esys_handle)
+{
+    RSRC_NODE_T *node;
+
+    assert_int_equal(esys_GetResourceObject(ectx, esys_handle, &node),
+                     TSS2_RC_SUCCESS);
+    return (node->swapped == NULL) ? node->rsrc.handle : 0;
+}
+
+static void
+test_bad_parameters(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    ESYS_SWAP_STATS stats;
+
+    assert_int_equal(Esys_SetSwapLimits(NULL, 1, 1),
+                     TSS2_ESYS_RC_BAD_REFERENCE);
+    assert_int_equal(Esys_GetSwapStats(NULL, &stats),
+                     TSS2_ESYS_RC_BAD_REFERENCE);
+    assert_int_equal(Esys_GetSwapStats(ectx, NULL),
+                     TSS2_ESYS_RC_BAD_REFERENCE);
+}
+
+/** A limit of 0 is taken from the TPM's properties. */
+static void
+test_limits_from_tpm(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+
+    assert_int_equal(Esys_SetSwapLimits(ectx, 0, 0), TSS2_RC_SUCCESS);
+    assert_int_equal(ectx->swap.max_objects, 3);
+    assert_int_equal(ectx->swap.max_sessions, 4);
+
+    assert_int_equal(Esys_SetSwapLimits(ectx, 0, 1), TSS2_RC_SUCCESS);
+    assert_int_equal(ectx->swap.max_objects, 3);
+    assert_int_equal(ectx->swap.max_sessions, 1);
+}
+
+/** Without limits the TPM runs out of object slots. */
+static void
+test_disabled(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_SWAP *tcti = get_tcti(ectx);
+    ESYS_SWAP_STATS stats;
+    TPMS_CONTEXT *context;
+
+    create_object(ectx, ESYS_TR_MIN_OBJECT);
+    assert_int_equal(Esys_ContextSave(ectx, ESYS_TR_MIN_OBJECT, &context),
+                     TSS2_RC_SUCCESS);
+    free(context);
+
+    assert_int_equal(Esys_GetSwapStats(ectx, &stats), TSS2_RC_SUCCESS);
+    assert_int_equal(stats.hits, 0);
+    assert_int_equal(stats.misses, 0);
+    assert_int_equal(stats.swapOuts, 0);
+    assert_int_equal(tcti->flushed, 0);
+}
+
+/** The least recently used object makes room and is loaded again on use. */
+static void
+test_object_lru(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_SWAP *tcti = get_tcti(ectx);
+    ESYS_TR a = ESYS_TR_MIN_OBJECT, b = ESYS_TR_MIN_OBJECT + 1, c;
+    ESYS_SWAP_STATS stats;
+    TPMS_CONTEXT *context, *context2;
+
+    assert_int_equal(Esys_SetSwapLimits(ectx, SLOTS, SLOTS), TSS2_RC_SUCCESS);
+    create_object(ectx, a);
+    create_object(ectx, b);
+
+    /* a is used, so b is the least recently used object */
+    assert_int_equal(Esys_ContextSave(ectx, a, &context), TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_ContextLoad(ectx, context, &c), TSS2_RC_SUCCESS);
+    free(context);
+    assert_int_equal(tpm_handle(ectx, b), 0);
+    assert_int_not_equal(tpm_handle(ectx, a), 0);
+    assert_int_not_equal(tpm_handle(ectx, c), 0);
+    assert_int_equal(tcti->flushed, 1);
+
+    /* b is loaded again in place of a */
+    assert_int_equal(Esys_ContextSave(ectx, b, &context2), TSS2_RC_SUCCESS);
+    free(context2);
+    assert_int_equal(tpm_handle(ectx, a), 0);
+    assert_int_not_equal(tpm_handle(ectx, b), 0);
+    assert_int_not_equal(tpm_handle(ectx, c), 0);
+    assert_int_equal(tcti->flushed, 2);
+
+    assert_int_equal(Esys_GetSwapStats(ectx, &stats), TSS2_RC_SUCCESS);
+    assert_int_equal(stats.hits, 1);
+    assert_int_equal(stats.misses, 1);
+    assert_int_equal(stats.swapOuts, 2);
+
+    /* Closing a swapped out object releases its saved context */
+    assert_int_equal(Esys_TR_Close(ectx, &a), TSS2_RC_SUCCESS);
+}
+
+/** Sessions are swapped out by starting sessions and in by their use. */
+static void
+test_session_lru(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_SWAP *tcti = get_tcti(ectx);
+    TPMT_SYM_DEF symmetric = { .algorithm = TPM2_ALG_NULL };
+    ESYS_SWAP_STATS stats;
+    ESYS_TR session[2];
+    TSS2_RC r;
+
+    assert_int_equal(Esys_SetSwapLimits(ectx, SLOTS, 1), TSS2_RC_SUCCESS);
+    for (size_t i = 0; i < 2; i++) {
+        r = Esys_StartAuthSession(ectx, ESYS_TR_NONE, ESYS_TR_NONE,
+                                  ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                                  NULL, TPM2_SE_POLICY, &symmetric,
+                                  TPM2_ALG_SHA256, &session[i]);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+    }
+    assert_int_equal(tpm_handle(ectx, session[0]), 0);
+
+    r = Esys_PolicyRestart(ectx, session[0], ESYS_TR_NONE, ESYS_TR_NONE,
+                           ESYS_TR_NONE);
+    assert_int_equal(r, TSS2_RC_SUCCESS);
+    assert_int_equal(tpm_handle(ectx, session[0]), TPM2_POLICY_SESSION_FIRST);
+    assert_int_equal(tpm_handle(ectx, session[1]), 0);
+    assert_int_equal(tcti->loaded, 1);
+
+    assert_int_equal(Esys_GetSwapStats(ectx, &stats), TSS2_RC_SUCCESS);
+    assert_int_equal(stats.misses, 1);
+    assert_int_equal(stats.swapOuts, 2);
+}
+
+/** Flushing a swapped out resource does not load it again. */
+static void
+test_flush_swapped(void **state)
+{
+    ESYS_CONTEXT *ectx = (ESYS_CONTEXT *) * state;
+    TSS2_TCTI_CONTEXT_SWAP *tcti = get_tcti(ectx);
+    TPMT_SYM_DEF symmetric = { .algorithm = TPM2_ALG_NULL };
+    ESYS_TR a = ESYS_TR_MIN_OBJECT, b = ESYS_TR_MIN_OBJECT + 1, c;
+    ESYS_TR session[2];
+    TPMS_CONTEXT *context;
+    TSS2_RC r;
+
+    assert_int_equal(Esys_SetSwapLimits(ectx, SLOTS, 1), TSS2_RC_SUCCESS);
+    create_object(ectx, a);
+    create_object(ectx, b);
+    assert_int_equal(Esys_ContextSave(ectx, a, &context), TSS2_RC_SUCCESS);
+    assert_int_equal(Esys_ContextLoad(ectx, context, &c), TSS2_RC_SUCCESS);
+    free(context);
+    assert_int_equal(tpm_handle(ectx, b), 0);
+    assert_int_equal(tcti->flushed, 1);
+
+    /* The saved context of the object is dropped without a TPM command */
+    assert_int_equal(Esys_FlushContext(ectx, b), TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->command, TPM2_CC_ContextLoad);
+    assert_int_equal(tcti->flushed, 1);
+    assert_int_equal(Esys_TR_Close(ectx, &b), TSS2_ESYS_RC_BAD_TR);
+
+    /* The saved session is flushed by its handle */
+    for (size_t i = 0; i < 2; i++) {
+        r = Esys_StartAuthSession(ectx, ESYS_TR_NONE, ESYS_TR_NONE,
+                                  ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+                                  NULL, TPM2_SE_POLICY, &symmetric,
+                                  TPM2_ALG_SHA256, &session[i]);
+        assert_int_equal(r, TSS2_RC_SUCCESS);
+    }
+    assert_int_equal(tpm_handle(ectx, session[0]), 0);
+    assert_int_equal(Esys_FlushContext(ectx, session[0]), TSS2_RC_SUCCESS);
+    assert_int_equal(tcti->loaded, 1);
+    assert_int_equal(tcti->flushed, 2);
+    assert_int_not_equal(tpm_handle(ectx, session[1]), 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_bad_parameters, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_limits_from_tpm, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_disabled, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_object_lru, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_session_lru, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_flush_swapped, setup, teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -57,6 +57,13 @@ __wrap_write (int fd, const void *buffer, size_t buffer_size)
     return mock_type (ssize_t);
 }
 
+ssize_t
+__wrap_writev (int fd, const struct iovec *iov, int iovcnt)
+{
+    LOG_DEBUG ("writing %d buffers to fd: %d", iovcnt, fd);
+    return mock_type (ssize_t);
+}
+
 /*
  * A test case for a successful call to the receive function. This requires
  * that the context and the command buffer be valid (including the size
@@ -74,6 +81,46 @@ write_all_simple_success_test (void **state)
     ret = write_all (99, buf, sizeof (buf));
     assert_int_equal(ret, sizeof (buf));
 }
+/*
+ * The 'writev_all' function must continue after short writes, including
+ * ones that end in the middle of a buffer or exactly at a buffer boundary.
+ */
+static void
+writev_all_short_write_test (void **state)
+{
+    ssize_t ret;
+    uint8_t buf0 [9], buf1 [12];
+    struct iovec iov [] = {
+        { .iov_base = buf0, .iov_len = sizeof (buf0) },
+        { .iov_base = buf1, .iov_len = sizeof (buf1) },
+    };
+
+    will_return (__wrap_writev, 4);
+    will_return (__wrap_writev, 5);
+    will_return (__wrap_writev, sizeof (buf1));
+    ret = writev_all (99, iov, 2);
+    assert_int_equal (ret, sizeof (buf0) + sizeof (buf1));
+    assert_int_equal (iov [1].iov_len, 0);
+}
+/*
+ * An error from the underlying 'writev' returns the number of bytes written
+ * before it.
+ */
+static void
+writev_all_error_test (void **state)
+{
+    ssize_t ret;
+    uint8_t buf0 [9], buf1 [12];
+    struct iovec iov [] = {
+        { .iov_base = buf0, .iov_len = sizeof (buf0) },
+        { .iov_base = buf1, .iov_len = sizeof (buf1) },
+    };
+
+    will_return (__wrap_writev, 10);
+    will_return (__wrap_writev, -1);
+    ret = writev_all (99, iov, 2);
+    assert_int_equal (ret, 10);
+}
 /*
  * This test causes the underlying 'read' operation to return '0' bytes
  * indicating EOF.
@@ -198,6 +245,8 @@ main (int   argc,
 {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test (write_all_simple_success_test),
+        cmocka_unit_test (writev_all_short_write_test),
+        cmocka_unit_test (writev_all_error_test),
         cmocka_unit_test (read_all_eof_test),
         cmocka_unit_test (read_all_twice_eof),
         cmocka_unit_test (socket_connect_test),
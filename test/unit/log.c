@@ -0,0 +1,416 @@
+/* SPDX-License-Identifier: BSD-2 */
+/***********************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+/* Exercise every level regardless of --with-maxloglevel. */
+#undef MAXLOGLEVEL
+#define MAXLOGLEVEL 6
+#define LOGMODULE test
+#include "util/log.h"
+
+/*
+ * stderr is redirected into a temporary file while the log functions run so
+ * the formatted lines can be compared. It is restored before any assertion
+ * so cmocka's own messages stay visible.
+ */
+typedef struct {
+    FILE *file;
+    int saved_fd;
+    char *out;
+} log_capture;
+
+static int
+capture_setup (void **state)
+{
+    log_capture *cap = calloc (1, sizeof (*cap));
+    assert_non_null (cap);
+    cap->file = tmpfile ();
+    assert_non_null (cap->file);
+    cap->saved_fd = dup (fileno (stderr));
+    assert_true (cap->saved_fd >= 0);
+    LOGMODULE_status = LOGLEVEL_UNDEFINED;
+    *state = cap;
+    return 0;
+}
+
+static int
+capture_teardown (void **state)
+{
+    log_capture *cap = *state;
+    fflush (stderr);
+    dup2 (cap->saved_fd, fileno (stderr));
+    close (cap->saved_fd);
+    fclose (cap->file);
+    free (cap->out);
+    free (cap);
+    unsetenv ("TSS2_LOG");
+    return 0;
+}
+
+/*
+ * Start sending stderr into the capture file, dropping earlier output.
+ */
+static void
+capture_begin (log_capture *cap)
+{
+    fflush (stderr);
+    assert_int_equal (ftruncate (fileno (cap->file), 0), 0);
+    assert_int_equal (lseek (fileno (cap->file), 0, SEEK_SET), 0);
+    assert_true (dup2 (fileno (cap->file), fileno (stderr)) >= 0);
+}
+
+/*
+ * Restore stderr and return everything written to it since capture_begin.
+ * The buffer is owned by the capture and freed on teardown.
+ */
+static const char *
+captured (log_capture *cap)
+{
+    fflush (stderr);
+    assert_true (dup2 (cap->saved_fd, fileno (stderr)) >= 0);
+    long len = lseek (fileno (cap->file), 0, SEEK_END);
+    assert_true (len >= 0);
+    free (cap->out);
+    cap->out = calloc (1, len + 1);
+    assert_non_null (cap->out);
+    assert_int_equal (lseek (fileno (cap->file), 0, SEEK_SET), 0);
+    assert_int_equal (read (fileno (cap->file), cap->out, len), len);
+    return cap->out;
+}
+
+/*
+ * The expected output of doLog, built with an unbounded buffer.
+ */
+static char *
+expected_line (const char *level, const char *module, const char *file,
+               int line, const char *func, const char *msg)
+{
+    size_t len = strlen (level) + strlen (module) + strlen (file) +
+                 strlen (func) + strlen (msg) + 32;
+    char *exp = malloc (len);
+    assert_non_null (exp);
+    snprintf (exp, len, "%s:%s:%s:%d:%s() %s \n",
+              level, module, file, line, func, msg);
+    return exp;
+}
+
+static char *
+repeat (char c, size_t n)
+{
+    char *s = malloc (n + 1);
+    assert_non_null (s);
+    memset (s, c, n);
+    s[n] = '\0';
+    return s;
+}
+
+/*
+ * Messages above the module's level are dropped, and the level is taken
+ * from TSS2_LOG on the first message and cached in the module status.
+ */
+static void
+log_level_filter_test (void **state)
+{
+    log_capture *cap = *state;
+
+    assert_int_equal (setenv ("TSS2_LOG", "all+error,test+warning", 1), 0);
+    capture_begin (cap);
+    LOG_TRACE ("trace %d", 1);
+    LOG_DEBUG ("debug %d", 2);
+    LOG_INFO ("info %d", 3);
+    LOG_WARNING ("warning %d", 4);
+    LOG_ERROR ("error %d", 5);
+
+    const char *out = captured (cap);
+    assert_int_equal (LOGMODULE_status, LOGLEVEL_WARNING);
+    assert_null (strstr (out, "trace 1"));
+    assert_null (strstr (out, "debug 2"));
+    assert_null (strstr (out, "info 3"));
+    assert_non_null (strstr (out, "WARNING:test:"));
+    assert_non_null (strstr (out, "() warning 4 \n"));
+    assert_non_null (strstr (out, "ERROR:test:"));
+    assert_non_null (strstr (out, "() error 5 \n"));
+}
+
+/*
+ * A module that TSS2_LOG does not mention falls back to the "all" level,
+ * and "none" silences everything.
+ */
+static void
+log_level_none_test (void **state)
+{
+    log_capture *cap = *state;
+    log_level status = LOGLEVEL_UNDEFINED;
+
+    assert_int_equal (setenv ("TSS2_LOG", "all+none", 1), 0);
+    capture_begin (cap);
+    doLog (LOGLEVEL_ERROR, "other", LOGLEVEL_WARNING, &status,
+           "f", "fn", 1, "dropped");
+    assert_string_equal (captured (cap), "");
+    assert_int_equal (status, LOGLEVEL_NONE);
+
+    status = LOGLEVEL_UNDEFINED;
+    assert_int_equal (setenv ("TSS2_LOG", "all+debug", 1), 0);
+    capture_begin (cap);
+    doLog (LOGLEVEL_DEBUG, "other", LOGLEVEL_WARNING, &status,
+           "f", "fn", 1, "kept %s", "arg");
+    assert_string_equal (captured (cap), "debug:other:f:1:fn() kept arg \n");
+    assert_int_equal (status, LOGLEVEL_DEBUG);
+}
+
+/*
+ * Without TSS2_LOG the module default applies.
+ */
+static void
+log_level_default_test (void **state)
+{
+    log_capture *cap = *state;
+    log_level status = LOGLEVEL_UNDEFINED;
+
+    unsetenv ("TSS2_LOG");
+    capture_begin (cap);
+    doLog (LOGLEVEL_INFO, "other", LOGLEVEL_WARNING, &status,
+           "f", "fn", 1, "dropped");
+    doLog (LOGLEVEL_WARNING, "other", LOGLEVEL_WARNING, &status,
+           "f", "fn", 2, "kept");
+    assert_string_equal (captured (cap), "WARNING:other:f:2:fn() kept \n");
+    assert_int_equal (status, LOGLEVEL_WARNING);
+}
+
+/*
+ * The location prefix and the format are combined in a fixed buffer. Lines
+ * around and beyond that buffer's size must come out unchanged, whether the
+ * length comes from the function name, the module or the format string.
+ */
+static void
+log_long_prefix_test (void **state)
+{
+    log_capture *cap = *state;
+    log_level status = LOGLEVEL_TRACE;
+
+    for (size_t n = 400; n < 1200; n++) {
+        char *func = repeat ('f', n);
+        char *module = repeat ('m', n);
+        char *msg = repeat ('x', n);
+        char *msg_fmt = malloc (n + 3);
+        assert_non_null (msg_fmt);
+        sprintf (msg_fmt, "%.*s%%c", (int)(n - 1), msg);
+        msg[n - 1] = 'y';
+
+        char *exp_func = expected_line ("ERROR", "test", "f", 1, func, "m");
+        char *exp_module = expected_line ("ERROR", module, "f", 2, "fn", "m");
+        char *exp_msg = expected_line ("ERROR", "test", "f", 3, "fn", msg);
+        size_t len_func = strlen (exp_func);
+        size_t len_module = strlen (exp_module);
+        size_t len_msg = strlen (exp_msg);
+
+        capture_begin (cap);
+        doLog (LOGLEVEL_ERROR, "test", LOGLEVEL_WARNING, &status,
+               "f", func, 1, "%s", "m");
+        doLog (LOGLEVEL_ERROR, module, LOGLEVEL_WARNING, &status,
+               "f", "fn", 2, "m");
+        doLog (LOGLEVEL_ERROR, "test", LOGLEVEL_WARNING, &status,
+               "f", "fn", 3, msg_fmt, 'y');
+
+        const char *out = captured (cap);
+        assert_int_equal (strlen (out), len_func + len_module + len_msg);
+        assert_memory_equal (out, exp_func, len_func);
+        assert_memory_equal (out + len_func, exp_module, len_module);
+        assert_memory_equal (out + len_func + len_module, exp_msg, len_msg);
+
+        free (func);
+        free (module);
+        free (msg);
+        free (msg_fmt);
+        free (exp_func);
+        free (exp_module);
+        free (exp_msg);
+    }
+}
+
+/*
+ * Arguments are not part of the combined format, so a long argument never
+ * takes the piecewise path and is printed in full.
+ */
+static void
+log_long_argument_test (void **state)
+{
+    log_capture *cap = *state;
+    log_level status = LOGLEVEL_TRACE;
+    char *arg = repeat ('a', 4096);
+    char *exp = expected_line ("info", "test", "f", 1, "fn", arg);
+
+    capture_begin (cap);
+    doLog (LOGLEVEL_INFO, "test", LOGLEVEL_WARNING, &status,
+           "f", "fn", 1, "%s", arg);
+    assert_string_equal (captured (cap), exp);
+
+    free (arg);
+    free (exp);
+}
+
+/*
+ * The hex dump of a blob, eight bytes per line, as doLogBlob prints it.
+ */
+static char *
+expected_blob (const uint8_t *blob, size_t size)
+{
+    char *exp = malloc (size * 3 + 16);
+    assert_non_null (exp);
+    size_t off = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (i % 8 == 0)
+            off += sprintf (&exp[off], "\n\t");
+        off += sprintf (&exp[off], "%02x", blob[i]);
+    }
+    exp[off] = '\0';
+    return exp;
+}
+
+static void
+log_blob_test (void **state)
+{
+    log_capture *cap = *state;
+    log_level status = LOGLEVEL_TRACE;
+    uint8_t blob[] = { 0x00, 0x01, 0x7f, 0x80, 0xab, 0xcd, 0xef, 0xff, 0x10 };
+
+    capture_begin (cap);
+    doLogBlob (LOGLEVEL_DEBUG, "test", LOGLEVEL_WARNING, &status,
+               "f", "fn", 1, blob, sizeof (blob), "blob %d", 7);
+    assert_string_equal (captured (cap), "debug:test:f:1:fn() blob 7 (size=9): "
+                         "\n\t00017f80abcdefff\n\t10 \n");
+
+    capture_begin (cap);
+    doLogBlob (LOGLEVEL_DEBUG, "test", LOGLEVEL_WARNING, &status,
+               "f", "fn", 1, blob, 0, "empty");
+    assert_string_equal (captured (cap), "debug:test:f:1:fn() empty (size=0):  \n");
+}
+
+/*
+ * Blobs of up to LOGBLOB_MAXSIZE bytes are dumped in full. Longer blobs are
+ * cut at LOGBLOB_MAXSIZE bytes and marked with "...", while the reported
+ * size stays the real one. The dump is far larger than the combined format
+ * buffer in doLog; it is passed as an argument and must not be cut there.
+ */
+static void
+log_blob_truncate_test (void **state)
+{
+    log_capture *cap = *state;
+    log_level status = LOGLEVEL_TRACE;
+    size_t sizes[] = { LOGBLOB_MAXSIZE - 1, LOGBLOB_MAXSIZE,
+                       LOGBLOB_MAXSIZE + 1, LOGBLOB_MAXSIZE * 4 };
+    uint8_t *blob = malloc (LOGBLOB_MAXSIZE * 4);
+    assert_non_null (blob);
+    for (size_t i = 0; i < LOGBLOB_MAXSIZE * 4; i++)
+        blob[i] = (uint8_t)(i * 7);
+
+    for (size_t s = 0; s < sizeof (sizes) / sizeof (sizes[0]); s++) {
+        size_t size = sizes[s];
+        size_t dumped = size > LOGBLOB_MAXSIZE ? LOGBLOB_MAXSIZE : size;
+        char *hex = expected_blob (blob, dumped);
+        char *exp = malloc (strlen (hex) + 128);
+        assert_non_null (exp);
+        sprintf (exp, "trace:test:f:1:fn() b (size=%zu): %s%s \n",
+                 size, hex, size > LOGBLOB_MAXSIZE ? "\n\t..." : "");
+
+        capture_begin (cap);
+        doLogBlob (LOGLEVEL_TRACE, "test", LOGLEVEL_WARNING, &status,
+                   "f", "fn", 1, blob, size, "b");
+        assert_string_equal (captured (cap), exp);
+
+        free (hex);
+        free (exp);
+    }
+    free (blob);
+}
+
+/*
+ * The blob message is formatted into a 256 byte buffer and cut at 255
+ * characters. A function name that overflows doLog's format buffer still
+ * gets the blob printed through the piecewise path.
+ */
+static void
+log_blob_long_message_test (void **state)
+{
+    log_capture *cap = *state;
+    log_level status = LOGLEVEL_TRACE;
+    uint8_t blob[] = { 0xde, 0xad };
+    char *arg = repeat ('a', 300);
+    char *func = repeat ('f', 1000);
+    char *msg = repeat ('a', 255);
+    char *tail = malloc (512);
+    assert_non_null (tail);
+    snprintf (tail, 512, "%s (size=2): \n\tdead", msg);
+    char *exp = expected_line ("ERROR", "test", "f", 1, func, tail);
+
+    capture_begin (cap);
+    doLogBlob (LOGLEVEL_ERROR, "test", LOGLEVEL_WARNING, &status,
+               "f", func, 1, blob, sizeof (blob), "%s", arg);
+    assert_string_equal (captured (cap), exp);
+
+    free (arg);
+    free (func);
+    free (msg);
+    free (tail);
+    free (exp);
+}
+
+/*
+ * Blobs above the level are dropped like any other message.
+ */
+static void
+log_blob_filter_test (void **state)
+{
+    log_capture *cap = *state;
+    uint8_t blob[] = { 0x01 };
+
+    assert_int_equal (setenv ("TSS2_LOG", "test+info", 1), 0);
+    capture_begin (cap);
+    LOGBLOB_DEBUG (blob, sizeof (blob), "debug blob");
+    LOGBLOB_INFO (blob, sizeof (blob), "info blob");
+
+    const char *out = captured (cap);
+    assert_int_equal (LOGMODULE_status, LOGLEVEL_INFO);
+    assert_null (strstr (out, "debug blob"));
+    assert_non_null (strstr (out, "() info blob (size=1): \n\t01 \n"));
+}
+
+int
+main (int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown (log_level_filter_test,
+                                         capture_setup, capture_teardown),
+        cmocka_unit_test_setup_teardown (log_level_none_test,
+                                         capture_setup, capture_teardown),
+        cmocka_unit_test_setup_teardown (log_level_default_test,
+                                         capture_setup, capture_teardown),
+        cmocka_unit_test_setup_teardown (log_long_prefix_test,
+                                         capture_setup, capture_teardown),
+        cmocka_unit_test_setup_teardown (log_long_argument_test,
+                                         capture_setup, capture_teardown),
+        cmocka_unit_test_setup_teardown (log_blob_test,
+                                         capture_setup, capture_teardown),
+        cmocka_unit_test_setup_teardown (log_blob_truncate_test,
+                                         capture_setup, capture_teardown),
+        cmocka_unit_test_setup_teardown (log_blob_long_message_test,
+                                         capture_setup, capture_teardown),
+        cmocka_unit_test_setup_teardown (log_blob_filter_test,
+                                         capture_setup, capture_teardown),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,326 @@
+/* SPDX-License-Identifier: BSD-2 */
+/***********************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_mu.h"
+#include "tss2_sys.h"
+#include "sysapi_util.h"
+
+#define TCTI_AUTHS_MAGIC 0x6175746873746374ULL
+#define TCTI_AUTHS_VERSION 0x1
+#define NV_DATA_SIZE 1024
+
+/*
+ * A TCTI that records the last command transmitted. The command is never
+ * answered; the tests only compare the bytes sent.
+ */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC (*finalize) (TSS2_TCTI_CONTEXT *tctiContext);
+    TSS2_RC (*cancel) (TSS2_TCTI_CONTEXT *tctiContext);
+    TSS2_RC (*getPollHandles) (TSS2_TCTI_CONTEXT *tctiContext,
+                               TSS2_TCTI_POLL_HANDLE *handles,
+                               size_t *num_handles);
+    TSS2_RC (*setLocality) (TSS2_TCTI_CONTEXT *tctiContext, uint8_t locality);
+    size_t size;
+    uint8_t buffer [TPM2_MAX_COMMAND_SIZE];
+} TSS2_TCTI_AUTHS_CONTEXT;
+
+static TSS2_RC
+tcti_auths_transmit (TSS2_TCTI_CONTEXT *tctiContext,
+                     size_t size,
+                     const uint8_t *buffer)
+{
+    TSS2_TCTI_AUTHS_CONTEXT *tcti = (TSS2_TCTI_AUTHS_CONTEXT*)tctiContext;
+
+    assert_true (size <= sizeof (tcti->buffer));
+    memcpy (tcti->buffer, buffer, size);
+    tcti->size = size;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_auths_receive (TSS2_TCTI_CONTEXT *tctiContext,
+                    size_t *response_size,
+                    uint8_t *response_buffer,
+                    int32_t timeout)
+{
+    (void)tctiContext;
+    (void)response_size;
+    (void)response_buffer;
+    (void)timeout;
+
+    return TSS2_TCTI_RC_NOT_IMPLEMENTED;
+}
+
+static int
+CmdAuths_setup (void **state)
+{
+    TSS2_TCTI_AUTHS_CONTEXT *tcti;
+    TSS2_SYS_CONTEXT *sys;
+    TSS2_ABI_VERSION abi_version = TSS2_ABI_VERSION_CURRENT;
+    size_t size;
+    TSS2_RC rc;
+
+    tcti = calloc (1, sizeof (*tcti));
+    assert_non_null (tcti);
+    TSS2_TCTI_MAGIC (tcti) = TCTI_AUTHS_MAGIC;
+    TSS2_TCTI_VERSION (tcti) = TCTI_AUTHS_VERSION;
+    TSS2_TCTI_TRANSMIT (tcti) = tcti_auths_transmit;
+    TSS2_TCTI_RECEIVE (tcti) = tcti_auths_receive;
+
+    size = Tss2_Sys_GetContextSize (0);
+    sys = calloc (1, size);
+    assert_non_null (sys);
+    rc = Tss2_Sys_Initialize (sys, size, (TSS2_TCTI_CONTEXT*)tcti,
+                              &abi_version);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    *state = sys;
+    return 0;
+}
+
+static int
+CmdAuths_teardown (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    TSS2_TCTI_CONTEXT *tcti;
+
+    Tss2_Sys_GetTctiContext (sys, &tcti);
+    Tss2_Sys_Finalize (sys);
+    free (sys);
+    free (tcti);
+
+    return 0;
+}
+
+/* Two HMAC sessions with SHA256 sized nonces and HMACs. */
+static void
+CmdAuths_init (TSS2L_SYS_AUTH_COMMAND *auths)
+{
+    memset (auths, 0, sizeof (*auths));
+    auths->count = 2;
+    auths->auths [0].sessionHandle = TPM2_HMAC_SESSION_FIRST;
+    auths->auths [0].nonce.size = 32;
+    memset (auths->auths [0].nonce.buffer, 0x01, 32);
+    auths->auths [0].sessionAttributes = TPMA_SESSION_CONTINUESESSION;
+    auths->auths [0].hmac.size = 32;
+    memset (auths->auths [0].hmac.buffer, 0x02, 32);
+    auths->auths [1].sessionHandle = TPM2_HMAC_SESSION_FIRST + 1;
+    auths->auths [1].nonce.size = 32;
+    memset (auths->auths [1].nonce.buffer, 0x03, 32);
+    auths->auths [1].hmac.size = 32;
+    memset (auths->auths [1].hmac.buffer, 0x04, 32);
+}
+
+/*
+ * Send a TPM2_NV_Write with 'auths' (or none if NULL), after declaring
+ * 'layout' (or nothing if NULL), and return the command sent in 'command'.
+ */
+static size_t
+CmdAuths_nv_write (TSS2_SYS_CONTEXT *sys,
+                   const TSS2L_SYS_AUTH_COMMAND *layout,
+                   const TSS2L_SYS_AUTH_COMMAND *auths,
+                   uint8_t *command)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+    TPM2B_MAX_NV_BUFFER data = { .size = NV_DATA_SIZE };
+    TSS2_RC rc;
+
+    memset (data.buffer, 0x5a, data.size);
+    if (layout != NULL) {
+        rc = Tss2_Sys_ReserveCmdAuths (sys, layout);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    rc = Tss2_Sys_NV_Write_Prepare (sys, TPM2_RH_OWNER, 0x01000000, &data,
+                                    0);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    if (auths != NULL) {
+        rc = Tss2_Sys_SetCmdAuths (sys, auths);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    rc = Tss2_Sys_ExecuteAsync (sys);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    Tss2_Sys_GetTctiContext (sys, &tcti);
+    memcpy (command, ((TSS2_TCTI_AUTHS_CONTEXT*)tcti)->buffer,
+            ((TSS2_TCTI_AUTHS_CONTEXT*)tcti)->size);
+    /* Start over with the next command */
+    syscontext_cast (sys)->previousStage = CMD_STAGE_INITIALIZE;
+    return ((TSS2_TCTI_AUTHS_CONTEXT*)tcti)->size;
+}
+
+/**
+ * Pass Tss2_Sys_ReserveCmdAuths NULL and out of range parameters.
+ */
+static void
+CmdAuths_bad_parameters (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    TSS2L_SYS_AUTH_COMMAND auths;
+    TSS2_RC rc;
+
+    CmdAuths_init (&auths);
+    rc = Tss2_Sys_ReserveCmdAuths (NULL, &auths);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_REFERENCE);
+    auths.count = TPM2_MAX_SESSION_NUM + 1;
+    rc = Tss2_Sys_ReserveCmdAuths (sys, &auths);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_VALUE);
+    assert_int_equal (syscontext_cast (sys)->reservedAuthSize, 0);
+
+    /* NULL drops an earlier reservation */
+    auths.count = 1;
+    rc = Tss2_Sys_ReserveCmdAuths (sys, &auths);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (syscontext_cast (sys)->reservedAuthSize,
+                      sizeof (UINT32) + 4 + 2 + 32 + 1 + 2 + 32);
+    rc = Tss2_Sys_ReserveCmdAuths (sys, NULL);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (syscontext_cast (sys)->reservedAuthSize, 0);
+}
+
+/**
+ * A matching reservation puts the parameters behind the auth area right
+ * away and produces the same command as Tss2_Sys_SetCmdAuths alone.
+ */
+static void
+CmdAuths_reserved (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast (sys);
+    TSS2L_SYS_AUTH_COMMAND auths;
+    uint8_t *expected, *command;
+    size_t expected_size, size;
+    UINT8 *cp_buffer;
+    TPM2B_MAX_NV_BUFFER data = { .size = NV_DATA_SIZE };
+    TSS2_RC rc;
+
+    expected = calloc (2, TPM2_MAX_COMMAND_SIZE);
+    assert_non_null (expected);
+    command = expected + TPM2_MAX_COMMAND_SIZE;
+    CmdAuths_init (&auths);
+
+    expected_size = CmdAuths_nv_write (sys, NULL, &auths, expected);
+    size = CmdAuths_nv_write (sys, &auths, &auths, command);
+    assert_int_equal (size, expected_size);
+    assert_memory_equal (command, expected, size);
+
+    /* The parameters are marshalled behind the gap, which is not part of
+       the command size until it is filled */
+    rc = Tss2_Sys_ReserveCmdAuths (sys, &auths);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_NV_Write_Prepare (sys, TPM2_RH_OWNER, 0x01000000, &data, 0);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (ctx->reservedAuthSize, 0);
+    cp_buffer = ctx->cpBuffer;
+    assert_ptr_equal (cp_buffer, ctx->cmdBuffer + sizeof (TPM20_Header_In) +
+                      2 * sizeof (UINT32) + ctx->authGapSize);
+    assert_int_equal (GetCommandSize (ctx),
+                      expected_size - ctx->authGapSize);
+    rc = Tss2_Sys_SetCmdAuths (sys, &auths);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_ptr_equal (ctx->cpBuffer, cp_buffer);
+    assert_int_equal (GetCommandSize (ctx), expected_size);
+    ctx->previousStage = CMD_STAGE_INITIALIZE;
+
+    /* The reservation only applies to one Prepare */
+    rc = Tss2_Sys_NV_Write_Prepare (sys, TPM2_RH_OWNER, 0x01000000, &data, 0);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (ctx->authGapSize, 0);
+
+    free (expected);
+}
+
+/**
+ * A reservation that does not match the authorizations, or that is not
+ * filled at all, falls back to the layout without reservation.
+ */
+static void
+CmdAuths_fallback (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    TSS2L_SYS_AUTH_COMMAND auths, layout;
+    TSS2L_SYS_AUTH_COMMAND none = { .count = 0 };
+    uint8_t *expected, *command;
+    size_t expected_size, size;
+
+    expected = calloc (2, TPM2_MAX_COMMAND_SIZE);
+    assert_non_null (expected);
+    command = expected + TPM2_MAX_COMMAND_SIZE;
+    CmdAuths_init (&auths);
+    expected_size = CmdAuths_nv_write (sys, NULL, &auths, expected);
+
+    /* Smaller and larger gaps than needed */
+    CmdAuths_init (&layout);
+    layout.count = 1;
+    size = CmdAuths_nv_write (sys, &layout, &auths, command);
+    assert_int_equal (size, expected_size);
+    assert_memory_equal (command, expected, size);
+    layout.count = 3;
+    size = CmdAuths_nv_write (sys, &layout, &auths, command);
+    assert_int_equal (size, expected_size);
+    assert_memory_equal (command, expected, size);
+
+    /* No authorizations at all */
+    expected_size = CmdAuths_nv_write (sys, NULL, NULL, expected);
+    size = CmdAuths_nv_write (sys, &auths, &none, command);
+    assert_int_equal (size, expected_size);
+    assert_memory_equal (command, expected, size);
+    size = CmdAuths_nv_write (sys, &auths, NULL, command);
+    assert_int_equal (size, expected_size);
+    assert_memory_equal (command, expected, size);
+
+    free (expected);
+}
+
+/**
+ * Commands without authorizations drop the gap in Prepare.
+ */
+static void
+CmdAuths_auth_not_allowed (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    _TSS2_SYS_CONTEXT_BLOB *ctx = syscontext_cast (sys);
+    TSS2L_SYS_AUTH_COMMAND auths;
+    TSS2_RC rc;
+
+    CmdAuths_init (&auths);
+    rc = Tss2_Sys_ReserveCmdAuths (sys, &auths);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_Startup_Prepare (sys, TPM2_SU_CLEAR);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (ctx->authGapSize, 0);
+    assert_int_equal (GetCommandSize (ctx),
+                      sizeof (TPM20_Header_In) + sizeof (TPM2_SU));
+    assert_ptr_equal (ctx->cpBuffer,
+                      ctx->cmdBuffer + sizeof (TPM20_Header_In));
+}
+
+int
+main (int argc, char *argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown (CmdAuths_bad_parameters,
+                                         CmdAuths_setup, CmdAuths_teardown),
+        cmocka_unit_test_setup_teardown (CmdAuths_reserved,
+                                         CmdAuths_setup, CmdAuths_teardown),
+        cmocka_unit_test_setup_teardown (CmdAuths_fallback,
+                                         CmdAuths_setup, CmdAuths_teardown),
+        cmocka_unit_test_setup_teardown (CmdAuths_auth_not_allowed,
+                                         CmdAuths_setup, CmdAuths_teardown),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
@@ -0,0 +1,616 @@
+/* SPDX-License-Identifier: BSD-2 */
+/***********************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_mu.h"
+#include "tss2_sys.h"
+#include "sysapi_util.h"
+
+#define TCTI_LOOPBACK_MAGIC 0x6c6f6f706261636bULL
+#define TCTI_LOOPBACK_VERSION 0x1
+#define OBJECT_HANDLE 0x80000001
+
+/*
+ * A loopback TCTI answering every command with the response built by the
+ * test case. The results of the *_Complete functions are compared with
+ * those of the Tss2_MU functions over the parameters of the same bytes.
+ */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC (*finalize) (TSS2_TCTI_CONTEXT *tctiContext);
+    TSS2_RC (*cancel) (TSS2_TCTI_CONTEXT *tctiContext);
+    TSS2_RC (*getPollHandles) (TSS2_TCTI_CONTEXT *tctiContext,
+                               TSS2_TCTI_POLL_HANDLE *handles,
+                               size_t *num_handles);
+    TSS2_RC (*setLocality) (TSS2_TCTI_CONTEXT *tctiContext, uint8_t locality);
+    TPM2_ST tag;
+    size_t params;
+    size_t size;
+    uint8_t response [TPM2_MAX_COMMAND_SIZE];
+} TSS2_TCTI_LOOPBACK_CONTEXT;
+
+static TSS2_RC
+tcti_loopback_transmit (TSS2_TCTI_CONTEXT *tctiContext,
+                       size_t size,
+                       const uint8_t *buffer)
+{
+    (void)tctiContext;
+    (void)size;
+    (void)buffer;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_loopback_receive (TSS2_TCTI_CONTEXT *tctiContext,
+                      size_t *response_size,
+                      uint8_t *response_buffer,
+                      int32_t timeout)
+{
+    TSS2_TCTI_LOOPBACK_CONTEXT *tcti = (TSS2_TCTI_LOOPBACK_CONTEXT*)tctiContext;
+
+    (void)timeout;
+    if (*response_size < tcti->size)
+        return TSS2_TCTI_RC_INSUFFICIENT_BUFFER;
+
+    memcpy (response_buffer, tcti->response, tcti->size);
+    *response_size = tcti->size;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_TCTI_LOOPBACK_CONTEXT *
+loopback_tcti (TSS2_SYS_CONTEXT *sys)
+{
+    TSS2_TCTI_CONTEXT *tcti;
+
+    Tss2_Sys_GetTctiContext (sys, &tcti);
+    return (TSS2_TCTI_LOOPBACK_CONTEXT*)tcti;
+}
+
+/*
+ * Start a response with an optional response handle. The parameters are
+ * marshaled to tcti->response at tcti->size.
+ */
+static void
+response_begin (TSS2_TCTI_LOOPBACK_CONTEXT *tcti, TPM2_ST tag, int handle)
+{
+    tcti->tag = tag;
+    tcti->size = sizeof (TPM20_Header_Out);
+    if (handle)
+        Tss2_MU_UINT32_Marshal (OBJECT_HANDLE, tcti->response,
+                                sizeof (tcti->response), &tcti->size);
+    if (tag == TPM2_ST_SESSIONS)
+        tcti->size += sizeof (UINT32);
+    tcti->params = tcti->size;
+}
+
+/*
+ * Fill in the header and, for responses with sessions, the parameter size
+ * and a password session.
+ */
+static void
+response_end (TSS2_TCTI_LOOPBACK_CONTEXT *tcti)
+{
+    size_t offset = 0;
+    size_t params_size = tcti->size - tcti->params;
+
+    if (tcti->tag == TPM2_ST_SESSIONS) {
+        offset = tcti->params - sizeof (UINT32);
+        Tss2_MU_UINT32_Marshal (params_size, tcti->response,
+                                sizeof (tcti->response), &offset);
+        Tss2_MU_UINT16_Marshal (0, tcti->response, sizeof (tcti->response),
+                                &tcti->size);
+        Tss2_MU_UINT8_Marshal (TPMA_SESSION_CONTINUESESSION, tcti->response,
+                               sizeof (tcti->response), &tcti->size);
+        Tss2_MU_UINT16_Marshal (0, tcti->response, sizeof (tcti->response),
+                                &tcti->size);
+    }
+
+    offset = 0;
+    Tss2_MU_TPM2_ST_Marshal (tcti->tag, tcti->response,
+                             sizeof (tcti->response), &offset);
+    Tss2_MU_UINT32_Marshal (tcti->size, tcti->response,
+                            sizeof (tcti->response), &offset);
+    Tss2_MU_UINT32_Marshal (TPM2_RC_SUCCESS, tcti->response,
+                            sizeof (tcti->response), &offset);
+}
+
+static int
+Complete_setup (void **state)
+{
+    TSS2_TCTI_LOOPBACK_CONTEXT *tcti;
+    TSS2_SYS_CONTEXT *sys;
+    TSS2_ABI_VERSION abi_version = TSS2_ABI_VERSION_CURRENT;
+    size_t size;
+    TSS2_RC rc;
+
+    tcti = calloc (1, sizeof (*tcti));
+    assert_non_null (tcti);
+    TSS2_TCTI_MAGIC (tcti) = TCTI_LOOPBACK_MAGIC;
+    TSS2_TCTI_VERSION (tcti) = TCTI_LOOPBACK_VERSION;
+    TSS2_TCTI_TRANSMIT (tcti) = tcti_loopback_transmit;
+    TSS2_TCTI_RECEIVE (tcti) = tcti_loopback_receive;
+
+    size = Tss2_Sys_GetContextSize (0);
+    sys = calloc (1, size);
+    assert_non_null (sys);
+    rc = Tss2_Sys_Initialize (sys, size, (TSS2_TCTI_CONTEXT*)tcti,
+                              &abi_version);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    *state = sys;
+    return 0;
+}
+
+static int
+Complete_teardown (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    TSS2_TCTI_CONTEXT *tcti;
+
+    Tss2_Sys_GetTctiContext (sys, &tcti);
+    Tss2_Sys_Finalize (sys);
+    free (sys);
+    free (tcti);
+
+    return 0;
+}
+
+static const TSS2L_SYS_AUTH_COMMAND auths = {
+    .count = 1,
+    .auths = {{ .sessionHandle = TPM2_RS_PW }},
+};
+
+static void
+quote_response (TSS2_TCTI_LOOPBACK_CONTEXT *tcti)
+{
+    TPM2B_ATTEST quoted = { .size = 129 };
+    TPMT_SIGNATURE signature = {
+        .sigAlg = TPM2_ALG_RSASSA,
+        .signature.rsassa = {
+            .hash = TPM2_ALG_SHA256,
+            .sig = { .size = 256 },
+        },
+    };
+
+    memset (quoted.attestationData, 0x11, quoted.size);
+    memset (signature.signature.rsassa.sig.buffer, 0x22, 256);
+
+    response_begin (tcti, TPM2_ST_SESSIONS, 0);
+    Tss2_MU_TPM2B_ATTEST_Marshal (&quoted, tcti->response,
+                                  sizeof (tcti->response), &tcti->size);
+    Tss2_MU_TPMT_SIGNATURE_Marshal (&signature, tcti->response,
+                                    sizeof (tcti->response), &tcti->size);
+    response_end (tcti);
+}
+
+static TSS2_RC
+quote (TSS2_SYS_CONTEXT *sys, TPM2B_ATTEST *quoted, TPMT_SIGNATURE *signature)
+{
+    TPMT_SIG_SCHEME scheme = { .scheme = TPM2_ALG_NULL };
+    TPML_PCR_SELECTION pcrs = { .count = 0 };
+
+    return Tss2_Sys_Quote (sys, OBJECT_HANDLE, &auths, NULL, &scheme, &pcrs,
+                           quoted, signature, NULL);
+}
+
+/**
+ * A response with sessions decodes to the same bytes as with the Tss2_MU
+ * functions.
+ */
+static void
+Complete_quote (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    TSS2_TCTI_LOOPBACK_CONTEXT *tcti = loopback_tcti (sys);
+    TPM2B_ATTEST quoted, quoted_mu;
+    TPMT_SIGNATURE signature, signature_mu;
+    size_t offset;
+    TSS2_RC rc;
+
+    quote_response (tcti);
+    memset (&quoted, 0xa5, sizeof (quoted));
+    memset (&quoted_mu, 0xa5, sizeof (quoted_mu));
+    memset (&signature, 0xa5, sizeof (signature));
+    memset (&signature_mu, 0xa5, sizeof (signature_mu));
+
+    rc = quote (sys, &quoted, &signature);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    offset = tcti->params;
+    rc = Tss2_MU_TPM2B_ATTEST_Unmarshal (tcti->response, tcti->size, &offset,
+                                         &quoted_mu);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPMT_SIGNATURE_Unmarshal (tcti->response, tcti->size,
+                                           &offset, &signature_mu);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    assert_memory_equal (&quoted, &quoted_mu, sizeof (quoted));
+    assert_memory_equal (&signature, &signature_mu, sizeof (signature));
+}
+
+/**
+ * Output parameters passed as NULL are skipped.
+ */
+static void
+Complete_quote_null (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    TPMT_SIGNATURE signature;
+    TSS2_RC rc;
+
+    quote_response (loopback_tcti (sys));
+
+    rc = quote (sys, NULL, &signature);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (signature.sigAlg, TPM2_ALG_RSASSA);
+    assert_int_equal (signature.signature.rsassa.sig.size, 256);
+    assert_int_equal (signature.signature.rsassa.sig.buffer [255], 0x22);
+}
+
+static void
+create_primary_response (TSS2_TCTI_LOOPBACK_CONTEXT *tcti)
+{
+    TPM2B_PUBLIC public = {
+        .publicArea = {
+            .type = TPM2_ALG_ECC,
+            .nameAlg = TPM2_ALG_SHA256,
+            .objectAttributes = TPMA_OBJECT_SIGN_ENCRYPT,
+            .authPolicy = { .size = 32 },
+            .parameters.eccDetail = {
+                .symmetric = { .algorithm = TPM2_ALG_NULL },
+                .scheme = {
+                    .scheme = TPM2_ALG_ECDAA,
+                    .details.ecdaa = { TPM2_ALG_SHA256, 7 },
+                },
+                .curveID = TPM2_ECC_NIST_P256,
+                .kdf = { .scheme = TPM2_ALG_NULL },
+            },
+            .unique.ecc = { .x = { .size = 32 }, .y = { .size = 32 } },
+        },
+    };
+    TPM2B_CREATION_DATA creation = {
+        .creationData = {
+            .pcrSelect = {
+                .count = 2,
+                .pcrSelections = {
+                    { TPM2_ALG_SHA1, 3, { 0x01, 0x02, 0x03 } },
+                    { TPM2_ALG_SHA256, 2, { 0xff, 0xff } },
+                },
+            },
+            .pcrDigest = { .size = 32 },
+            .locality = TPMA_LOCALITY_TPM2_LOC_ZERO,
+            .parentNameAlg = TPM2_ALG_SHA256,
+            .parentName = { .size = 4 },
+            .parentQualifiedName = { .size = 34 },
+            .outsideInfo = { .size = 3 },
+        },
+    };
+    TPM2B_DIGEST hash = { .size = 32 };
+    TPMT_TK_CREATION ticket = {
+        .tag = TPM2_ST_CREATION,
+        .hierarchy = TPM2_RH_OWNER,
+        .digest = { .size = 32 },
+    };
+    TPM2B_NAME name = { .size = 34 };
+    uint8_t *buffer = tcti->response;
+    size_t size = sizeof (tcti->response);
+
+    memset (public.publicArea.authPolicy.buffer, 0x33, 32);
+    memset (public.publicArea.unique.ecc.x.buffer, 0x44, 32);
+    memset (public.publicArea.unique.ecc.y.buffer, 0x55, 32);
+    memset (creation.creationData.pcrDigest.buffer, 0x66, 32);
+    memset (creation.creationData.parentName.name, 0x77, 4);
+    memset (creation.creationData.parentQualifiedName.name, 0x88, 34);
+    memset (creation.creationData.outsideInfo.buffer, 0x99, 3);
+    memset (hash.buffer, 0xaa, 32);
+    memset (ticket.digest.buffer, 0xbb, 32);
+    memset (name.name, 0xcc, 34);
+
+    response_begin (tcti, TPM2_ST_SESSIONS, 1);
+    Tss2_MU_TPM2B_PUBLIC_Marshal (&public, buffer, size, &tcti->size);
+    Tss2_MU_TPM2B_CREATION_DATA_Marshal (&creation, buffer, size,
+                                         &tcti->size);
+    Tss2_MU_TPM2B_DIGEST_Marshal (&hash, buffer, size, &tcti->size);
+    Tss2_MU_TPMT_TK_CREATION_Marshal (&ticket, buffer, size, &tcti->size);
+    Tss2_MU_TPM2B_NAME_Marshal (&name, buffer, size, &tcti->size);
+    response_end (tcti);
+}
+
+static TSS2_RC
+create_primary (TSS2_SYS_CONTEXT *sys, TPM2B_PUBLIC *public,
+                TPM2B_CREATION_DATA *creation, TPM2B_DIGEST *hash,
+                TPMT_TK_CREATION *ticket, TPM2B_NAME *name)
+{
+    TPM2B_SENSITIVE_CREATE in_sensitive = { .size = 0 };
+    TPM2B_PUBLIC in_public = { .size = 0 };
+    TPM2B_DATA outside_info = { .size = 0 };
+    TPML_PCR_SELECTION creation_pcr = { .count = 0 };
+    TPM2_HANDLE handle;
+
+    return Tss2_Sys_CreatePrimary (sys, TPM2_RH_OWNER, &auths, &in_sensitive,
+                                   &in_public, &outside_info, &creation_pcr,
+                                   &handle, public, creation, hash, ticket,
+                                   name, NULL);
+}
+
+/**
+ * Nested structures, unions and lists decode to the same bytes as with the
+ * Tss2_MU functions.
+ */
+static void
+Complete_create_primary (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    TSS2_TCTI_LOOPBACK_CONTEXT *tcti = loopback_tcti (sys);
+    TPM2B_PUBLIC public, public_mu;
+    TPM2B_CREATION_DATA creation, creation_mu;
+    TPM2B_DIGEST hash, hash_mu;
+    TPMT_TK_CREATION ticket, ticket_mu;
+    TPM2B_NAME name, name_mu;
+    size_t offset;
+    TSS2_RC rc;
+
+    create_primary_response (tcti);
+    memset (&public, 0xa5, sizeof (public));
+    memset (&creation, 0xa5, sizeof (creation));
+    memset (&hash, 0xa5, sizeof (hash));
+    memset (&ticket, 0xa5, sizeof (ticket));
+    memset (&name, 0xa5, sizeof (name));
+    public.size = 0;
+    creation.size = 0;
+    public_mu = public;
+    creation_mu = creation;
+    hash_mu = hash;
+    ticket_mu = ticket;
+    name_mu = name;
+
+    rc = create_primary (sys, &public, &creation, &hash, &ticket, &name);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    offset = tcti->params;
+    rc = Tss2_MU_TPM2B_PUBLIC_Unmarshal (tcti->response, tcti->size, &offset,
+                                         &public_mu);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPM2B_CREATION_DATA_Unmarshal (tcti->response, tcti->size,
+                                                &offset, &creation_mu);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPM2B_DIGEST_Unmarshal (tcti->response, tcti->size, &offset,
+                                         &hash_mu);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPMT_TK_CREATION_Unmarshal (tcti->response, tcti->size,
+                                             &offset, &ticket_mu);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPM2B_NAME_Unmarshal (tcti->response, tcti->size, &offset,
+                                       &name_mu);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    assert_memory_equal (&public, &public_mu, sizeof (public));
+    assert_memory_equal (&creation, &creation_mu, sizeof (creation));
+    assert_memory_equal (&hash, &hash_mu, sizeof (hash));
+    assert_memory_equal (&ticket, &ticket_mu, sizeof (ticket));
+    assert_memory_equal (&name, &name_mu, sizeof (name));
+}
+
+/**
+ * A TPM2B wrapping a structure must be passed in empty, as with the Tss2_MU
+ * functions.
+ */
+static void
+Complete_create_primary_size_set (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    TPM2B_PUBLIC public = { .size = 1 };
+    TSS2_RC rc;
+
+    create_primary_response (loopback_tcti (sys));
+
+    rc = create_primary (sys, &public, NULL, NULL, NULL, NULL);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_VALUE);
+}
+
+static void
+pcr_read_response (TSS2_TCTI_LOOPBACK_CONTEXT *tcti, UINT32 count)
+{
+    TPML_PCR_SELECTION selection = {
+        .count = 1,
+        .pcrSelections = {{ TPM2_ALG_SHA256, 3, { 0xff, 0x00, 0x00 } }},
+    };
+    TPM2B_DIGEST digest = { .size = 32 };
+    uint8_t *buffer = tcti->response;
+    size_t size = sizeof (tcti->response);
+    UINT32 i;
+
+    response_begin (tcti, TPM2_ST_NO_SESSIONS, 0);
+    Tss2_MU_UINT32_Marshal (42, buffer, size, &tcti->size);
+    Tss2_MU_TPML_PCR_SELECTION_Marshal (&selection, buffer, size,
+                                        &tcti->size);
+    Tss2_MU_UINT32_Marshal (count, buffer, size, &tcti->size);
+    for (i = 0; i < count; i++) {
+        memset (digest.buffer, i, digest.size);
+        Tss2_MU_TPM2B_DIGEST_Marshal (&digest, buffer, size, &tcti->size);
+    }
+    response_end (tcti);
+}
+
+/**
+ * A response without sessions decodes to the same bytes as with the
+ * Tss2_MU functions.
+ */
+static void
+Complete_pcr_read (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    TSS2_TCTI_LOOPBACK_CONTEXT *tcti = loopback_tcti (sys);
+    TPML_PCR_SELECTION selection_in = { .count = 0 };
+    TPML_PCR_SELECTION selection, selection_mu;
+    TPML_DIGEST digests, digests_mu;
+    UINT32 counter, counter_mu;
+    size_t offset;
+    TSS2_RC rc;
+
+    pcr_read_response (tcti, 8);
+    memset (&selection, 0xa5, sizeof (selection));
+    memset (&digests, 0xa5, sizeof (digests));
+
+    rc = Tss2_Sys_PCR_Read (sys, NULL, &selection_in, &counter, &selection,
+                            &digests, NULL);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    offset = tcti->params;
+    rc = Tss2_MU_UINT32_Unmarshal (tcti->response, tcti->size, &offset,
+                                   &counter_mu);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPML_PCR_SELECTION_Unmarshal (tcti->response, tcti->size,
+                                               &offset, &selection_mu);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_MU_TPML_DIGEST_Unmarshal (tcti->response, tcti->size, &offset,
+                                        &digests_mu);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    assert_int_equal (counter, counter_mu);
+    assert_memory_equal (&selection, &selection_mu, sizeof (selection));
+    assert_memory_equal (&digests, &digests_mu, sizeof (digests));
+}
+
+/**
+ * A list longer than its destination is reported as a malformed response.
+ */
+static void
+Complete_pcr_read_count (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    TPML_PCR_SELECTION selection_in = { .count = 0 };
+    TPML_PCR_SELECTION selection;
+    TPML_DIGEST digests;
+    UINT32 counter;
+    TSS2_RC rc;
+
+    pcr_read_response (loopback_tcti (sys), 9);
+
+    rc = Tss2_Sys_PCR_Read (sys, NULL, &selection_in, &counter, &selection,
+                            &digests, NULL);
+    assert_int_equal (rc, TSS2_SYS_RC_MALFORMED_RESPONSE);
+}
+
+/**
+ * Every capability union member decodes to the same bytes as with the
+ * Tss2_MU functions.
+ */
+static void
+Complete_get_capability (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    TSS2_TCTI_LOOPBACK_CONTEXT *tcti = loopback_tcti (sys);
+    TPMS_CAPABILITY_DATA data, data_mu, caps [3];
+    TPML_TAGGED_TPM_PROPERTY *properties = &caps [0].data.tpmProperties;
+    TPMI_YES_NO more;
+    size_t offset;
+    size_t i;
+    TSS2_RC rc;
+
+    memset (caps, 0, sizeof (caps));
+    caps [0].capability = TPM2_CAP_TPM_PROPERTIES;
+    properties->count = 2;
+    properties->tpmProperty [0].property = TPM2_PT_FAMILY_INDICATOR;
+    properties->tpmProperty [0].value = 0x322e3000;
+    properties->tpmProperty [1].property = TPM2_PT_LEVEL;
+    caps [1].capability = TPM2_CAP_HANDLES;
+    caps [1].data.handles.count = 3;
+    caps [1].data.handles.handle [2] = OBJECT_HANDLE;
+    caps [2].capability = TPM2_CAP_PCR_PROPERTIES;
+    caps [2].data.pcrProperties.count = 1;
+    caps [2].data.pcrProperties.pcrProperty [0].tag = TPM2_PT_PCR_SAVE;
+    caps [2].data.pcrProperties.pcrProperty [0].sizeofSelect = 3;
+    caps [2].data.pcrProperties.pcrProperty [0].pcrSelect [1] = 0x0f;
+
+    for (i = 0; i < sizeof (caps) / sizeof (caps [0]); i++) {
+        response_begin (tcti, TPM2_ST_NO_SESSIONS, 0);
+        Tss2_MU_UINT8_Marshal (TPM2_YES, tcti->response,
+                               sizeof (tcti->response), &tcti->size);
+        Tss2_MU_TPMS_CAPABILITY_DATA_Marshal (&caps [i], tcti->response,
+                                              sizeof (tcti->response),
+                                              &tcti->size);
+        response_end (tcti);
+        memset (&data, 0xa5, sizeof (data));
+
+        rc = Tss2_Sys_GetCapability (sys, NULL, caps [i].capability, 0, 1,
+                                     &more, &data, NULL);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_int_equal (more, TPM2_YES);
+
+        offset = tcti->params + sizeof (UINT8);
+        rc = Tss2_MU_TPMS_CAPABILITY_DATA_Unmarshal (tcti->response,
+                                                     tcti->size, &offset,
+                                                     &data_mu);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_memory_equal (&data, &data_mu, sizeof (data));
+        assert_memory_equal (&data, &caps [i], sizeof (data));
+    }
+}
+
+/**
+ * A TPM2B larger than its destination is reported by the Tss2_MU functions.
+ */
+static void
+Complete_get_random_size (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    TSS2_TCTI_LOOPBACK_CONTEXT *tcti = loopback_tcti (sys);
+    TPM2B_DIGEST random;
+    TSS2_RC rc;
+
+    response_begin (tcti, TPM2_ST_NO_SESSIONS, 0);
+    Tss2_MU_UINT16_Marshal (sizeof (random.buffer) + 1, tcti->response,
+                            sizeof (tcti->response), &tcti->size);
+    tcti->size += sizeof (random.buffer) + 1;
+    response_end (tcti);
+
+    rc = Tss2_Sys_GetRandom (sys, NULL, 8, &random, NULL);
+    assert_int_equal (rc, TSS2_MU_RC_INSUFFICIENT_BUFFER);
+}
+
+int
+main (int argc, char* argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown (Complete_quote,
+                                         Complete_setup,
+                                         Complete_teardown),
+        cmocka_unit_test_setup_teardown (Complete_quote_null,
+                                         Complete_setup,
+                                         Complete_teardown),
+        cmocka_unit_test_setup_teardown (Complete_create_primary,
+                                         Complete_setup,
+                                         Complete_teardown),
+        cmocka_unit_test_setup_teardown (Complete_create_primary_size_set,
+                                         Complete_setup,
+                                         Complete_teardown),
+        cmocka_unit_test_setup_teardown (Complete_pcr_read,
+                                         Complete_setup,
+                                         Complete_teardown),
+        cmocka_unit_test_setup_teardown (Complete_pcr_read_count,
+                                         Complete_setup,
+                                         Complete_teardown),
+        cmocka_unit_test_setup_teardown (Complete_get_capability,
+                                         Complete_setup,
+                                         Complete_teardown),
+        cmocka_unit_test_setup_teardown (Complete_get_random_size,
+                                         Complete_setup,
+                                         Complete_teardown),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
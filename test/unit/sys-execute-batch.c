@@ -0,0 +1,265 @@
+/* SPDX-License-Identifier: BSD-2 */
+/***********************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_mu.h"
+#include "tss2_sys.h"
+#include "sysapi_util.h"
+
+#define BATCH_SIZE 4
+#define TCTI_BATCH_MAGIC 0x6261746368746374ULL
+#define TCTI_BATCH_VERSION 0x1
+
+/*
+ * A loopback TCTI answering TPM2_GetRandom. Each response is filled with
+ * the sequence number of the command it answers so the tests can tell
+ * which context got which response. The command with sequence number
+ * 'fail_at' is answered with TPM2_RC_FAILURE.
+ */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC (*finalize) (TSS2_TCTI_CONTEXT *tctiContext);
+    TSS2_RC (*cancel) (TSS2_TCTI_CONTEXT *tctiContext);
+    TSS2_RC (*getPollHandles) (TSS2_TCTI_CONTEXT *tctiContext,
+                               TSS2_TCTI_POLL_HANDLE *handles,
+                               size_t *num_handles);
+    TSS2_RC (*setLocality) (TSS2_TCTI_CONTEXT *tctiContext, uint8_t locality);
+    size_t transmitted;
+    size_t received;
+    size_t fail_at;
+    UINT16 requested;
+} TSS2_TCTI_BATCH_CONTEXT;
+
+static TSS2_RC
+tcti_batch_transmit (TSS2_TCTI_CONTEXT *tctiContext,
+                     size_t size,
+                     const uint8_t *buffer)
+{
+    TSS2_TCTI_BATCH_CONTEXT *tcti = (TSS2_TCTI_BATCH_CONTEXT*)tctiContext;
+    size_t offset = sizeof (TPM20_Header_In);
+
+    /* Only one command may be in flight. */
+    assert_int_equal (tcti->transmitted, tcti->received);
+    assert_int_equal (Tss2_MU_UINT16_Unmarshal (buffer, size, &offset,
+                                                &tcti->requested),
+                      TSS2_RC_SUCCESS);
+    tcti->transmitted++;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_batch_receive (TSS2_TCTI_CONTEXT *tctiContext,
+                    size_t *response_size,
+                    uint8_t *response_buffer,
+                    int32_t timeout)
+{
+    TSS2_TCTI_BATCH_CONTEXT *tcti = (TSS2_TCTI_BATCH_CONTEXT*)tctiContext;
+    TPM2B_DIGEST random = { .size = tcti->requested };
+    size_t offset = 0;
+    TSS2_RC rc = TPM2_RC_SUCCESS;
+
+    (void)timeout;
+    assert_int_equal (tcti->transmitted, tcti->received + 1);
+
+    if (tcti->received == tcti->fail_at) {
+        rc = TPM2_RC_FAILURE;
+        random.size = 0;
+    }
+    memset (random.buffer, (int)tcti->received, random.size);
+    tcti->received++;
+
+    Tss2_MU_TPM2_ST_Marshal (TPM2_ST_NO_SESSIONS, response_buffer,
+                             *response_size, &offset);
+    offset += sizeof (UINT32);
+    Tss2_MU_UINT32_Marshal (rc, response_buffer, *response_size, &offset);
+    if (rc == TPM2_RC_SUCCESS)
+        Tss2_MU_TPM2B_DIGEST_Marshal (&random, response_buffer,
+                                      *response_size, &offset);
+    *response_size = offset;
+    offset = sizeof (TPM2_ST);
+    Tss2_MU_UINT32_Marshal (*response_size, response_buffer,
+                            sizeof (TPM20_Header_Out), &offset);
+
+    return TSS2_RC_SUCCESS;
+}
+
+static int
+ExecuteBatch_setup (void **state)
+{
+    TSS2_TCTI_BATCH_CONTEXT *tcti;
+    TSS2_SYS_CONTEXT **contexts;
+    TSS2_ABI_VERSION abi_version = TSS2_ABI_VERSION_CURRENT;
+    size_t size, i;
+    TSS2_RC rc;
+
+    tcti = calloc (1, sizeof (*tcti));
+    assert_non_null (tcti);
+    TSS2_TCTI_MAGIC (tcti) = TCTI_BATCH_MAGIC;
+    TSS2_TCTI_VERSION (tcti) = TCTI_BATCH_VERSION;
+    TSS2_TCTI_TRANSMIT (tcti) = tcti_batch_transmit;
+    TSS2_TCTI_RECEIVE (tcti) = tcti_batch_receive;
+    tcti->fail_at = BATCH_SIZE;
+
+    /* The last slot is for the TCTI so teardown can find it. */
+    contexts = calloc (BATCH_SIZE + 1, sizeof (*contexts));
+    assert_non_null (contexts);
+    size = Tss2_Sys_GetContextSize (0);
+    for (i = 0; i < BATCH_SIZE; i++) {
+        contexts [i] = calloc (1, size);
+        assert_non_null (contexts [i]);
+        rc = Tss2_Sys_Initialize (contexts [i], size,
+                                  (TSS2_TCTI_CONTEXT*)tcti, &abi_version);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+    }
+    contexts [BATCH_SIZE] = (TSS2_SYS_CONTEXT*)tcti;
+
+    *state = contexts;
+    return 0;
+}
+
+static int
+ExecuteBatch_teardown (void **state)
+{
+    TSS2_SYS_CONTEXT **contexts = *state;
+    size_t i;
+
+    for (i = 0; i < BATCH_SIZE; i++) {
+        Tss2_Sys_Finalize (contexts [i]);
+        free (contexts [i]);
+    }
+    free (contexts [BATCH_SIZE]);
+    free (contexts);
+
+    return 0;
+}
+
+static void
+ExecuteBatch_prepare_all (TSS2_SYS_CONTEXT **contexts)
+{
+    size_t i;
+
+    for (i = 0; i < BATCH_SIZE; i++)
+        assert_int_equal (Tss2_Sys_GetRandom_Prepare (contexts [i], 8 + i),
+                          TSS2_RC_SUCCESS);
+}
+
+/**
+ * Pass ExecuteBatch NULL parameters.
+ */
+static void
+ExecuteBatch_null_parameters (void **state)
+{
+    TSS2_SYS_CONTEXT **contexts = *state;
+    size_t executed;
+    TSS2_RC rc;
+
+    rc = Tss2_Sys_ExecuteBatch (NULL, BATCH_SIZE, &executed);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_REFERENCE);
+    rc = Tss2_Sys_ExecuteBatch (contexts, BATCH_SIZE, NULL);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_REFERENCE);
+}
+
+/**
+ * Every command in the batch is executed in order and each context holds
+ * the response to its own command afterwards.
+ */
+static void
+ExecuteBatch_success (void **state)
+{
+    TSS2_SYS_CONTEXT **contexts = *state;
+    TSS2_TCTI_BATCH_CONTEXT *tcti =
+        (TSS2_TCTI_BATCH_CONTEXT*)contexts [BATCH_SIZE];
+    TPM2B_DIGEST random;
+    size_t executed = 0, i;
+    TSS2_RC rc;
+
+    ExecuteBatch_prepare_all (contexts);
+    rc = Tss2_Sys_ExecuteBatch (contexts, BATCH_SIZE, &executed);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (executed, BATCH_SIZE);
+    assert_int_equal (tcti->transmitted, BATCH_SIZE);
+
+    for (i = 0; i < BATCH_SIZE; i++) {
+        random.size = 0;
+        rc = Tss2_Sys_GetRandom_Complete (contexts [i], &random);
+        assert_int_equal (rc, TSS2_RC_SUCCESS);
+        assert_int_equal (random.size, 8 + i);
+        assert_int_equal (random.buffer [0], i);
+    }
+}
+
+/**
+ * The batch stops at the first command that fails and 'executed' points
+ * at it. Nothing after it is sent.
+ */
+static void
+ExecuteBatch_tpm_error (void **state)
+{
+    TSS2_SYS_CONTEXT **contexts = *state;
+    TSS2_TCTI_BATCH_CONTEXT *tcti =
+        (TSS2_TCTI_BATCH_CONTEXT*)contexts [BATCH_SIZE];
+    size_t executed = 0;
+    TSS2_RC rc;
+
+    tcti->fail_at = 1;
+    ExecuteBatch_prepare_all (contexts);
+    rc = Tss2_Sys_ExecuteBatch (contexts, BATCH_SIZE, &executed);
+    assert_int_equal (rc, TPM2_RC_FAILURE);
+    assert_int_equal (executed, 1);
+    assert_int_equal (tcti->transmitted, 2);
+}
+
+/**
+ * A context that isn't in the prepared stage fails the whole batch before
+ * any command is sent.
+ */
+static void
+ExecuteBatch_bad_sequence (void **state)
+{
+    TSS2_SYS_CONTEXT **contexts = *state;
+    TSS2_TCTI_BATCH_CONTEXT *tcti =
+        (TSS2_TCTI_BATCH_CONTEXT*)contexts [BATCH_SIZE];
+    size_t executed = 1;
+    TSS2_RC rc;
+
+    ExecuteBatch_prepare_all (contexts);
+    syscontext_cast (contexts [BATCH_SIZE - 1])->previousStage =
+        CMD_STAGE_RECEIVE_RESPONSE;
+    rc = Tss2_Sys_ExecuteBatch (contexts, BATCH_SIZE, &executed);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_SEQUENCE);
+    assert_int_equal (executed, 0);
+    assert_int_equal (tcti->transmitted, 0);
+}
+
+int
+main (int argc, char* argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown (ExecuteBatch_null_parameters,
+                                         ExecuteBatch_setup,
+                                         ExecuteBatch_teardown),
+        cmocka_unit_test_setup_teardown (ExecuteBatch_success,
+                                         ExecuteBatch_setup,
+                                         ExecuteBatch_teardown),
+        cmocka_unit_test_setup_teardown (ExecuteBatch_tpm_error,
+                                         ExecuteBatch_setup,
+                                         ExecuteBatch_teardown),
+        cmocka_unit_test_setup_teardown (ExecuteBatch_bad_sequence,
+                                         ExecuteBatch_setup,
+                                         ExecuteBatch_teardown),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
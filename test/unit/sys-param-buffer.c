@@ -0,0 +1,288 @@
+/* SPDX-License-Identifier: BSD-2 */
+/***********************************************************************
+ * Copyright 2026, tpm2-tss-verified contributors
+ *
+ * All rights reserved.
+ ***********************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tss2_mu.h"
+#include "tss2_sys.h"
+#include "sysapi_util.h"
+
+#define TCTI_PARAM_MAGIC 0x706172616d746374ULL
+#define TCTI_PARAM_VERSION 0x1
+#define PARAM_SIZE 16
+
+/*
+ * A loopback TCTI answering TPM2_NV_Read with a response carrying an
+ * authorization area. The data of the response is filled with 0xa5. The
+ * size field of the data can be overridden with 'claimed_size' to produce
+ * a malformed response.
+ */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    TSS2_TCTI_TRANSMIT_FCN transmit;
+    TSS2_TCTI_RECEIVE_FCN receive;
+    TSS2_RC (*finalize) (TSS2_TCTI_CONTEXT *tctiContext);
+    TSS2_RC (*cancel) (TSS2_TCTI_CONTEXT *tctiContext);
+    TSS2_RC (*getPollHandles) (TSS2_TCTI_CONTEXT *tctiContext,
+                               TSS2_TCTI_POLL_HANDLE *handles,
+                               size_t *num_handles);
+    TSS2_RC (*setLocality) (TSS2_TCTI_CONTEXT *tctiContext, uint8_t locality);
+    UINT16 claimed_size;
+} TSS2_TCTI_PARAM_CONTEXT;
+
+static TSS2_RC
+tcti_param_transmit (TSS2_TCTI_CONTEXT *tctiContext,
+                     size_t size,
+                     const uint8_t *buffer)
+{
+    (void)tctiContext;
+    (void)size;
+    (void)buffer;
+
+    return TSS2_RC_SUCCESS;
+}
+
+static TSS2_RC
+tcti_param_receive (TSS2_TCTI_CONTEXT *tctiContext,
+                    size_t *response_size,
+                    uint8_t *response_buffer,
+                    int32_t timeout)
+{
+    TSS2_TCTI_PARAM_CONTEXT *tcti = (TSS2_TCTI_PARAM_CONTEXT*)tctiContext;
+    size_t offset = 0;
+    uint8_t data [PARAM_SIZE];
+
+    (void)timeout;
+    memset (data, 0xa5, sizeof (data));
+
+    Tss2_MU_TPM2_ST_Marshal (TPM2_ST_SESSIONS, response_buffer,
+                             *response_size, &offset);
+    offset += sizeof (UINT32);
+    Tss2_MU_UINT32_Marshal (TPM2_RC_SUCCESS, response_buffer,
+                            *response_size, &offset);
+    Tss2_MU_UINT32_Marshal (sizeof (UINT16) + sizeof (data), response_buffer,
+                            *response_size, &offset);
+    Tss2_MU_UINT16_Marshal (tcti->claimed_size, response_buffer,
+                            *response_size, &offset);
+    memcpy (&response_buffer [offset], data, sizeof (data));
+    offset += sizeof (data);
+    /* Password session response: empty nonce, attributes, empty hmac */
+    Tss2_MU_UINT16_Marshal (0, response_buffer, *response_size, &offset);
+    Tss2_MU_UINT8_Marshal (TPMA_SESSION_CONTINUESESSION, response_buffer,
+                           *response_size, &offset);
+    Tss2_MU_UINT16_Marshal (0, response_buffer, *response_size, &offset);
+    *response_size = offset;
+    offset = sizeof (TPM2_ST);
+    Tss2_MU_UINT32_Marshal (*response_size, response_buffer,
+                            sizeof (TPM20_Header_Out), &offset);
+
+    return TSS2_RC_SUCCESS;
+}
+
+static int
+ParamBuffer_setup (void **state)
+{
+    TSS2_TCTI_PARAM_CONTEXT *tcti;
+    TSS2_SYS_CONTEXT *sys;
+    TSS2_ABI_VERSION abi_version = TSS2_ABI_VERSION_CURRENT;
+    size_t size;
+    TSS2_RC rc;
+
+    tcti = calloc (1, sizeof (*tcti));
+    assert_non_null (tcti);
+    TSS2_TCTI_MAGIC (tcti) = TCTI_PARAM_MAGIC;
+    TSS2_TCTI_VERSION (tcti) = TCTI_PARAM_VERSION;
+    TSS2_TCTI_TRANSMIT (tcti) = tcti_param_transmit;
+    TSS2_TCTI_RECEIVE (tcti) = tcti_param_receive;
+    tcti->claimed_size = PARAM_SIZE;
+
+    size = Tss2_Sys_GetContextSize (0);
+    sys = calloc (1, size);
+    assert_non_null (sys);
+    rc = Tss2_Sys_Initialize (sys, size, (TSS2_TCTI_CONTEXT*)tcti,
+                              &abi_version);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+
+    *state = sys;
+    return 0;
+}
+
+static int
+ParamBuffer_teardown (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    TSS2_TCTI_CONTEXT *tcti;
+
+    Tss2_Sys_GetTctiContext (sys, &tcti);
+    Tss2_Sys_Finalize (sys);
+    free (sys);
+    free (tcti);
+
+    return 0;
+}
+
+static void
+ParamBuffer_execute_nv_read (TSS2_SYS_CONTEXT *sys)
+{
+    TSS2L_SYS_AUTH_COMMAND auths = {
+        .count = 1,
+        .auths = {{ .sessionHandle = TPM2_RS_PW }},
+    };
+    TSS2_RC rc;
+
+    rc = Tss2_Sys_NV_Read_Prepare (sys, TPM2_RH_OWNER, 0x01000000,
+                                   PARAM_SIZE, 0);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_SetCmdAuths (sys, &auths);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_Execute (sys);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+}
+
+/**
+ * Pass the accessors NULL parameters.
+ */
+static void
+ParamBuffer_null_parameters (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    size_t size;
+    uint8_t *buffer;
+    TSS2_RC rc;
+
+    rc = Tss2_Sys_GetDecryptParamBuffer (NULL, &size, &buffer);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_REFERENCE);
+    rc = Tss2_Sys_GetDecryptParamBuffer (sys, NULL, &buffer);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_REFERENCE);
+    rc = Tss2_Sys_GetDecryptParamBuffer (sys, &size, NULL);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_REFERENCE);
+    rc = Tss2_Sys_GetEncryptParamBuffer (NULL, &size, &buffer);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_REFERENCE);
+    rc = Tss2_Sys_GetEncryptParamBuffer (sys, NULL, &buffer);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_REFERENCE);
+    rc = Tss2_Sys_GetEncryptParamBuffer (sys, &size, NULL);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_REFERENCE);
+}
+
+/**
+ * The decrypt parameter buffer is the first command parameter inside the
+ * command buffer; changes to it are sent without Tss2_Sys_SetDecryptParam.
+ */
+static void
+ParamBuffer_decrypt_in_place (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    TPM2B_MAX_NV_BUFFER data = { .size = PARAM_SIZE };
+    const uint8_t *const_buffer, *cp_buffer;
+    uint8_t *buffer;
+    size_t size, cp_size;
+    TSS2_RC rc;
+
+    rc = Tss2_Sys_GetDecryptParamBuffer (sys, &size, &buffer);
+    assert_int_equal (rc, TSS2_SYS_RC_BAD_SEQUENCE);
+
+    /* TPM2_NV_Read has no TPM2B as first command parameter */
+    rc = Tss2_Sys_NV_Read_Prepare (sys, TPM2_RH_OWNER, 0x01000000, 8, 0);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_GetDecryptParamBuffer (sys, &size, &buffer);
+    assert_int_equal (rc, TSS2_SYS_RC_NO_DECRYPT_PARAM);
+
+    memset (data.buffer, 0x11, data.size);
+    rc = Tss2_Sys_NV_Write_Prepare (sys, TPM2_RH_OWNER, 0x01000000, &data, 0);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    rc = Tss2_Sys_GetDecryptParamBuffer (sys, &size, &buffer);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, PARAM_SIZE);
+    rc = Tss2_Sys_GetDecryptParam (sys, &size, &const_buffer);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_ptr_equal (buffer, const_buffer);
+    assert_memory_equal (buffer, data.buffer, size);
+
+    memset (buffer, 0x22, size);
+    rc = Tss2_Sys_GetCpBuffer (sys, &cp_size, &cp_buffer);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (cp_size, sizeof (UINT16) + PARAM_SIZE + sizeof (UINT16));
+    assert_int_equal (cp_buffer [sizeof (UINT16)], 0x22);
+    assert_int_equal (cp_buffer [sizeof (UINT16) + PARAM_SIZE - 1], 0x22);
+}
+
+/**
+ * The encrypt parameter buffer is the first response parameter inside the
+ * response buffer; changes to it are seen by the _Complete function.
+ */
+static void
+ParamBuffer_encrypt_in_place (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    TPM2B_MAX_NV_BUFFER data = { .size = 0 };
+    const uint8_t *const_buffer;
+    uint8_t *buffer;
+    size_t size;
+    TSS2_RC rc;
+
+    ParamBuffer_execute_nv_read (sys);
+
+    rc = Tss2_Sys_GetEncryptParamBuffer (sys, &size, &buffer);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (size, PARAM_SIZE);
+    rc = Tss2_Sys_GetEncryptParam (sys, &size, &const_buffer);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_ptr_equal (buffer, const_buffer);
+    assert_int_equal (buffer [0], 0xa5);
+
+    memset (buffer, 0x5a, size);
+    rc = Tss2_Sys_NV_Read_Complete (sys, &data);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (data.size, PARAM_SIZE);
+    assert_int_equal (data.buffer [0], 0x5a);
+    assert_int_equal (data.buffer [PARAM_SIZE - 1], 0x5a);
+}
+
+/**
+ * A size field reaching beyond the response is rejected.
+ */
+static void
+ParamBuffer_encrypt_malformed (void **state)
+{
+    TSS2_SYS_CONTEXT *sys = *state;
+    TSS2_TCTI_CONTEXT *tcti;
+    uint8_t *buffer;
+    size_t size;
+    TSS2_RC rc;
+
+    Tss2_Sys_GetTctiContext (sys, &tcti);
+    ((TSS2_TCTI_PARAM_CONTEXT*)tcti)->claimed_size = 0xffff;
+    ParamBuffer_execute_nv_read (sys);
+
+    rc = Tss2_Sys_GetEncryptParamBuffer (sys, &size, &buffer);
+    assert_int_equal (rc, TSS2_SYS_RC_MALFORMED_RESPONSE);
+}
+
+int
+main (int argc, char* argv[])
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown (ParamBuffer_null_parameters,
+                                         ParamBuffer_setup,
+                                         ParamBuffer_teardown),
+        cmocka_unit_test_setup_teardown (ParamBuffer_decrypt_in_place,
+                                         ParamBuffer_setup,
+                                         ParamBuffer_teardown),
+        cmocka_unit_test_setup_teardown (ParamBuffer_encrypt_in_place,
+                                         ParamBuffer_setup,
+                                         ParamBuffer_teardown),
+        cmocka_unit_test_setup_teardown (ParamBuffer_encrypt_malformed,
+                                         ParamBuffer_setup,
+                                         ParamBuffer_teardown),
+    };
+    return cmocka_run_group_tests (tests, NULL, NULL);
+}
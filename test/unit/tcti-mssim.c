@@ -184,6 +184,41 @@ __wrap_read (int sockfd,
     memcpy (buf, buf_in, ret);
     return ret;
 }
+/*
+ * Wrap the 'readv' system call. The mock queue for this function must have
+ * an integer return value (the number of bytes read), as well as a pointer
+ * to a buffer to copy data from. The data is spread over the buffers of
+ * 'iov' in order.
+ */
+ssize_t
+__wrap_readv (int sockfd,
+              const struct iovec *iov,
+              int iovcnt)
+{
+    ssize_t  ret = mock_type (ssize_t);
+    uint8_t *buf_in = mock_ptr_type (uint8_t*);
+    size_t left = ret;
+
+    for (int i = 0; i < iovcnt && left > 0; i++) {
+        size_t len = left < iov [i].iov_len ? left : iov [i].iov_len;
+        memcpy (iov [i].iov_base, buf_in, len);
+        buf_in += len;
+        left -= len;
+    }
+    assert_int_equal (left, 0);
+    return ret;
+}
+/*
+ * Wrap the 'poll' system call. The mock queue for this function must have
+ * an integer return value: 1 if the socket is readable, 0 on timeout.
+ */
+int
+__wrap_poll (struct pollfd *fds,
+             nfds_t nfds,
+             int timeout)
+{
+    return mock_type (int);
+}
 /*
  * Wrap the 'send' system call. The mock queue for this function must have an
  * integer to return as a response.
@@ -196,6 +231,17 @@ __wrap_write (int sockfd,
 {
     return mock_type (TSS2_RC);
 }
+/*
+ * Wrap the 'writev' system call. The mock queue for this function must have
+ * an integer to return as a response.
+ */
+ssize_t
+__wrap_writev (int sockfd,
+               const struct iovec *iov,
+               int iovcnt)
+{
+    return mock_type (ssize_t);
+}
 /*
  * This is a utility function used by other tests to setup a TCTI context. It
  * effectively wraps the init / allocate / init pattern as well as priming the
@@ -270,21 +316,36 @@ tcti_socket_teardown (void **state)
     return 0;
 }
 /*
- * This test ensures that the GetPollHandles function in the device TCTI
- * returns the expected value. Since this TCTI does not support async I/O
- * on account of limitations in the kernel it just returns the
- * NOT_IMPLEMENTED response code.
+ * This test ensures that the GetPollHandles function in the mssim TCTI
+ * returns the TPM socket as the only handle, and reports the number of
+ * handles when no array is provided.
  */
 static void
 tcti_mssim_get_poll_handles_test (void **state)
 {
     TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)*state;
-    size_t num_handles = 5;
+    TSS2_TCTI_MSSIM_CONTEXT *tcti_mssim = (TSS2_TCTI_MSSIM_CONTEXT*)ctx;
+    size_t num_handles = 0;
     TSS2_TCTI_POLL_HANDLE handles [5] = { 0 };
     TSS2_RC rc;
 
+    rc = Tss2_Tcti_GetPollHandles (ctx, NULL, &num_handles);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (num_handles, 1);
+
+    num_handles = 0;
+    rc = Tss2_Tcti_GetPollHandles (ctx, handles, &num_handles);
+    assert_int_equal (rc, TSS2_TCTI_RC_INSUFFICIENT_BUFFER);
+
+    num_handles = 5;
     rc = Tss2_Tcti_GetPollHandles (ctx, handles, &num_handles);
-    assert_int_equal (rc, TSS2_TCTI_RC_NOT_IMPLEMENTED);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_int_equal (num_handles, 1);
+    assert_int_equal (handles [0].fd, tcti_mssim->tpm_sock);
+    assert_int_equal (handles [0].events, POLLIN);
+
+    rc = Tss2_Tcti_GetPollHandles (ctx, handles, NULL);
+    assert_int_equal (rc, TSS2_TCTI_RC_BAD_REFERENCE);
 }
 /*
  */
@@ -329,20 +390,20 @@ tcti_socket_receive_success_test (void **state)
     /* Keep state machine check in `receive` from returning error. */
     tcti_common->state = TCTI_STATE_RECEIVE;
     /* receive response size */
-    will_return (__wrap_read, 4);
-    will_return (__wrap_read, &response_in [2]);
+    will_return (__wrap_readv, 4);
+    will_return (__wrap_readv, &response_in [2]);
     /* receive tag */
-    will_return (__wrap_read, 2);
-    will_return (__wrap_read, response_in);
+    will_return (__wrap_readv, 2);
+    will_return (__wrap_readv, response_in);
     /* receive size (again)  */
-    will_return (__wrap_read, 4);
-    will_return (__wrap_read, &response_in [2]);
+    will_return (__wrap_readv, 4);
+    will_return (__wrap_readv, &response_in [2]);
     /* receive the rest of the command */
-    will_return (__wrap_read, 0xc - sizeof (TPM2_ST) - sizeof (UINT32));
-    will_return (__wrap_read, &response_in [6]);
+    will_return (__wrap_readv, 0xc - sizeof (TPM2_ST) - sizeof (UINT32));
+    will_return (__wrap_readv, &response_in [6]);
     /* receive the 4 bytes of 0's appended by the simulator */
-    will_return (__wrap_read, 4);
-    will_return (__wrap_read, &response_in [12]);
+    will_return (__wrap_readv, 4);
+    will_return (__wrap_readv, &response_in [12]);
 
     rc = Tss2_Tcti_Receive (ctx, &response_size, response_out, TSS2_TCTI_TIMEOUT_BLOCK);
     assert_int_equal (rc, TSS2_RC_SUCCESS);
@@ -368,24 +429,24 @@ tcti_socket_receive_size_success_test (void **state)
     /* Keep state machine check in `receive` from returning error. */
     tcti_common->state = TCTI_STATE_RECEIVE;
     /* receive response size */
-    will_return (__wrap_read, 4);
-    will_return (__wrap_read, &response_in [2]);
+    will_return (__wrap_readv, 4);
+    will_return (__wrap_readv, &response_in [2]);
     rc = Tss2_Tcti_Receive (ctx, &response_size, NULL, TSS2_TCTI_TIMEOUT_BLOCK);
 
     assert_int_equal (rc, TSS2_RC_SUCCESS);
     assert_int_equal (response_size, 0xc);
     /* receive tag */
-    will_return (__wrap_read, 2);
-    will_return (__wrap_read, response_in);
+    will_return (__wrap_readv, 2);
+    will_return (__wrap_readv, response_in);
     /* receive size (again)  */
-    will_return (__wrap_read, 4);
-    will_return (__wrap_read, &response_in [2]);
+    will_return (__wrap_readv, 4);
+    will_return (__wrap_readv, &response_in [2]);
     /* receive the rest of the command */
-    will_return (__wrap_read, 0xc - sizeof (TPM2_ST) - sizeof (UINT32));
-    will_return (__wrap_read, &response_in [6]);
+    will_return (__wrap_readv, 0xc - sizeof (TPM2_ST) - sizeof (UINT32));
+    will_return (__wrap_readv, &response_in [6]);
     /* receive the 4 bytes of 0's appended by the simulator */
-    will_return (__wrap_read, 4);
-    will_return (__wrap_read, &response_in [12]);
+    will_return (__wrap_readv, 4);
+    will_return (__wrap_readv, &response_in [12]);
 
     rc = Tss2_Tcti_Receive (ctx, &response_size, response_out, TSS2_TCTI_TIMEOUT_BLOCK);
     assert_int_equal (rc, TSS2_RC_SUCCESS);
@@ -408,8 +469,8 @@ tcti_mssim_receive_eof_first_read_test (void **state)
 
     /* Keep state machine check in `receive` from returning error. */
     tcti_common->state = TCTI_STATE_RECEIVE;
-    will_return (__wrap_read, 0);
-    will_return (__wrap_read, buf);
+    will_return (__wrap_readv, 0);
+    will_return (__wrap_readv, buf);
     rc = Tss2_Tcti_Receive (ctx,
                             &size,
                             buf,
@@ -441,17 +502,127 @@ tcti_mssim_receive_eof_second_read_test (void **state)
     /* Keep state machine check in `receive` from returning error. */
     tcti_common->state = TCTI_STATE_RECEIVE;
     /* setup response size for first read */
-    will_return (__wrap_read, 4);
-    will_return (__wrap_read, &response_in [2]);
+    will_return (__wrap_readv, 4);
+    will_return (__wrap_readv, &response_in [2]);
     /* setup 0 for EOF on second read */
-    will_return (__wrap_read, 0);
-    will_return (__wrap_read, response_in);
+    will_return (__wrap_readv, 0);
+    will_return (__wrap_readv, response_in);
     rc = Tss2_Tcti_Receive (ctx,
                             &size,
                             response_out,
                             TSS2_TCTI_TIMEOUT_BLOCK);
     assert_true (rc == TSS2_TCTI_RC_IO_ERROR);
 }
+/*
+ * This test delivers the response in small pieces with a poll timeout
+ * between them. Each timeout makes the non-blocking receive return
+ * TRY_AGAIN, and the next call resumes in the middle of the size prefix,
+ * the response body and the trailing 0's.
+ */
+static void
+tcti_mssim_receive_nonblocking_resume_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)*state;
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_common_context_cast (ctx);
+    TSS2_RC rc;
+    uint8_t response_in [] = { 0x00, 0x00, 0x00, 0x0c,
+                               0x80, 0x02,
+                               0x00, 0x00, 0x00, 0x0c,
+                               0x00, 0x00, 0x00, 0x00,
+                               0x01, 0x02,
+    /* simulator appends 4 bytes of 0's to every response */
+                               0x00, 0x00, 0x00, 0x00 };
+    uint8_t response_out [12] = { 0 };
+    size_t response_size = sizeof (response_out);
+    size_t chunks [] = { 2, 2, 5, 8, 3 };
+    size_t offset = 0;
+
+    /* Keep state machine check in `receive` from returning error. */
+    tcti_common->state = TCTI_STATE_RECEIVE;
+    for (size_t i = 0; i < sizeof (chunks) / sizeof (chunks [0]); i++) {
+        /* no data available yet */
+        will_return (__wrap_poll, 0);
+        rc = Tss2_Tcti_Receive (ctx, &response_size, response_out,
+                                TSS2_TCTI_TIMEOUT_NONE);
+        assert_int_equal (rc, TSS2_TCTI_RC_TRY_AGAIN);
+        assert_int_equal (tcti_common->state, TCTI_STATE_RECEIVE);
+
+        /* the next chunk arrives, then nothing more */
+        will_return (__wrap_poll, 1);
+        will_return (__wrap_readv, chunks [i]);
+        will_return (__wrap_readv, &response_in [offset]);
+        offset += chunks [i];
+        if (offset < sizeof (response_in)) {
+            will_return (__wrap_poll, 0);
+        }
+        rc = Tss2_Tcti_Receive (ctx, &response_size, response_out,
+                                TSS2_TCTI_TIMEOUT_NONE);
+        if (offset < sizeof (response_in)) {
+            assert_int_equal (rc, TSS2_TCTI_RC_TRY_AGAIN);
+        } else {
+            assert_int_equal (rc, TSS2_RC_SUCCESS);
+        }
+    }
+    assert_int_equal (response_size, sizeof (response_out));
+    assert_memory_equal (&response_in [4], response_out, response_size);
+    assert_int_equal (tcti_common->state, TCTI_STATE_TRANSMIT);
+}
+/*
+ * A buffer that is too small for the response is reported without losing
+ * the response size that was already received.
+ */
+static void
+tcti_mssim_receive_insufficient_buffer_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)*state;
+    TSS2_TCTI_COMMON_CONTEXT *tcti_common = tcti_common_context_cast (ctx);
+    TSS2_RC rc;
+    uint8_t response_in [] = { 0x00, 0x00, 0x00, 0x0c,
+                               0x80, 0x02,
+                               0x00, 0x00, 0x00, 0x0c,
+                               0x00, 0x00, 0x00, 0x00,
+                               0x01, 0x02,
+                               0x00, 0x00, 0x00, 0x00 };
+    uint8_t response_out [12] = { 0 };
+    size_t response_size = 10;
+
+    /* Keep state machine check in `receive` from returning error. */
+    tcti_common->state = TCTI_STATE_RECEIVE;
+    will_return (__wrap_readv, 4);
+    will_return (__wrap_readv, response_in);
+    rc = Tss2_Tcti_Receive (ctx, &response_size, response_out,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_TCTI_RC_INSUFFICIENT_BUFFER);
+    assert_int_equal (response_size, 0xc);
+
+    /* the response and the trailing 0's are received by a single read */
+    will_return (__wrap_readv, 0xc + 4);
+    will_return (__wrap_readv, &response_in [4]);
+    rc = Tss2_Tcti_Receive (ctx, &response_size, response_out,
+                            TSS2_TCTI_TIMEOUT_BLOCK);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+    assert_memory_equal (&response_in [4], response_out, response_size);
+}
+/*
+ * This test exercises the successful code path through the transmit function
+ * when the socket accepts only part of the data at first.
+ */
+static void
+tcti_mssim_transmit_short_write_test (void **state)
+{
+    TSS2_TCTI_CONTEXT *ctx = (TSS2_TCTI_CONTEXT*)*state;
+    TSS2_RC rc = TSS2_RC_SUCCESS;
+    uint8_t command [] = { 0x80, 0x02,
+                           0x00, 0x00, 0x00, 0x0c,
+                           0x00, 0x00, 0x00, 0x00,
+                           0x01, 0x02 };
+
+    will_return (__wrap_writev, 7);
+    will_return (__wrap_writev, 6);
+    will_return (__wrap_writev, 4 + 1 + 4 + 0xc - 13);
+    rc = Tss2_Tcti_Transmit (ctx, sizeof (command), command);
+    assert_int_equal (rc, TSS2_RC_SUCCESS);
+}
 /*
  * This test exercises the successful code path through the transmit function.
  */
@@ -466,14 +637,11 @@ tcti_socket_transmit_success_test (void **state)
                            0x01, 0x02 };
     size_t  command_size = sizeof (command);
 
-    /* send the TPM2_SEND_COMMAND code */
-    will_return (__wrap_write, 4);
-    /* send the locality for the command */
-    will_return (__wrap_write, 1);
-    /* send the number of bytes in command */
-    will_return (__wrap_write, 4);
-    /* send the command buffer */
-    will_return (__wrap_write, 0xc);
+    /*
+     * send the TPM2_SEND_COMMAND code, the locality, the number of bytes in
+     * the command and the command buffer with a single write
+     */
+    will_return (__wrap_writev, 4 + 1 + 4 + 0xc);
     rc = Tss2_Tcti_Transmit (ctx, command_size, command);
     assert_int_equal (rc, TSS2_RC_SUCCESS);
 }
@@ -510,6 +678,15 @@ main (int   argc,
         cmocka_unit_test_setup_teardown (tcti_mssim_receive_eof_second_read_test,
                                          tcti_socket_setup,
                                          tcti_socket_teardown),
+        cmocka_unit_test_setup_teardown (tcti_mssim_receive_nonblocking_resume_test,
+                                         tcti_socket_setup,
+                                         tcti_socket_teardown),
+        cmocka_unit_test_setup_teardown (tcti_mssim_receive_insufficient_buffer_test,
+                                         tcti_socket_setup,
+                                         tcti_socket_teardown),
+        cmocka_unit_test_setup_teardown (tcti_mssim_transmit_short_write_test,
+                                         tcti_socket_setup,
+                                         tcti_socket_teardown),
         cmocka_unit_test_setup_teardown (tcti_socket_transmit_success_test,
                                   tcti_socket_setup,
                                   tcti_socket_teardown)